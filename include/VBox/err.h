@@ -1195,6 +1195,9 @@
 #define VINF_IOM_MMIO_UNUSED_00             2615
 /** Unused MMIO register read, fill with FF. */
 #define VINF_IOM_MMIO_UNUSED_FF             2616
+/** A shared read handler cannot complete the access without the exclusive
+ * locks; IOM shall redo it using the regular read handler. */
+#define VINF_IOM_READ_NEEDS_EXCLUSIVE       2617
 
 /** Reason for leaving RZ: I/O port read. */
 #define VINF_IOM_R3_IOPORT_READ             2620
@@ -3357,16 +3357,23 @@ typedef FNDBGFPROGRESS *PFNDBGFPROGRESS;
  * @{ */
 /** The report creates the call stack in reverse order (bottom to top). */
 #define DBGF_SAMPLE_REPORT_F_STACK_REVERSE  RT_BIT(0)
+/** Continuous mode: Keep the raw samples in a bounded per VCPU ring for
+ * exporting with DBGFR3SampleReportDumpFoldedToFile() instead of building
+ * the frame tree and the textual report. */
+#define DBGF_SAMPLE_REPORT_F_CONTINUOUS     RT_BIT(1)
 /** Mask containing the valid flags. */
-#define DBGF_SAMPLE_REPORT_F_VALID_MASK     UINT32_C(0x00000001)
+#define DBGF_SAMPLE_REPORT_F_VALID_MASK     UINT32_C(0x00000003)
 /** @} */
 
 VMMR3DECL(int)      DBGFR3SampleReportCreate(PUVM pUVM, uint32_t cSampleIntervalMs, uint32_t fFlags, PDBGFSAMPLEREPORT phSample);
+VMMR3DECL(int)      DBGFR3SampleReportCreateEx(PUVM pUVM, uint32_t cSampleIntervalUs, uint32_t cRingSamples, uint32_t fFlags,
+                                               PDBGFSAMPLEREPORT phSample);
 VMMR3DECL(uint32_t) DBGFR3SampleReportRetain(DBGFSAMPLEREPORT hSample);
 VMMR3DECL(uint32_t) DBGFR3SampleReportRelease(DBGFSAMPLEREPORT hSample);
 VMMR3DECL(int)      DBGFR3SampleReportStart(DBGFSAMPLEREPORT hSample, uint64_t cSampleUs, PFNDBGFPROGRESS pfnProgress, void *pvUser);
 VMMR3DECL(int)      DBGFR3SampleReportStop(DBGFSAMPLEREPORT hSample);
 VMMR3DECL(int)      DBGFR3SampleReportDumpToFile(DBGFSAMPLEREPORT hSample, const char *pszFilename);
+VMMR3DECL(int)      DBGFR3SampleReportDumpFoldedToFile(DBGFSAMPLEREPORT hSample, const char *pszFilename);
 /** @} */
 
 /** @} */
@@ -724,6 +724,51 @@ typedef GMMUNREGISTERSHAREDMODULEREQ *PGMMUNREGISTERSHAREDMODULEREQ;
 
 GMMR0DECL(int) GMMR0UnregisterSharedModuleReq(PGVM pGVM, VMCPUID idCpu, PGMMUNREGISTERSHAREDMODULEREQ pReq);
 
+/** The max number of pages in a GMMMERGEPAGESREQ. */
+#define GMM_MERGE_PAGES_MAX                     256
+
+/**
+ * Page descriptor for GMMR0MergeDuplicatePagesReq.
+ */
+typedef struct GMMMERGEPAGEDESC
+{
+    /** Guest physical address of the page (in). */
+    RTGCPHYS                    GCPhys;
+    /** The page id PGM has for this page (in). */
+    uint32_t                    idPage;
+    /** Content hash calculated by ring-3 (in).  This is only a hint for
+     * finding merge candidates, pages are compared before being merged. */
+    uint32_t                    u32Hash;
+} GMMMERGEPAGEDESC;
+/** Pointer to a GMMMERGEPAGEDESC. */
+typedef GMMMERGEPAGEDESC *PGMMMERGEPAGEDESC;
+
+/**
+ * Request buffer for GMMR0MergeDuplicatePagesReq / VMMR0_DO_GMM_MERGE_DUPLICATE_PAGES.
+ * @see GMMR0MergeDuplicatePages.
+ */
+typedef struct GMMMERGEPAGESREQ
+{
+    /** The header. */
+    SUPVMMR0REQHDR              Hdr;
+    /** The number of pages in aPages (in). */
+    uint32_t                    cPages;
+    /** The number of pages replaced by an identical shared page (out). */
+    uint32_t                    cMerged;
+    /** The number of pages converted into shared pages for others to merge
+     * with (out). */
+    uint32_t                    cConverted;
+    /** Align at 8 byte boundary. */
+    uint32_t                    u32Alignment;
+    /** The pages. */
+    GMMMERGEPAGEDESC            aPages[1];
+} GMMMERGEPAGESREQ;
+/** Pointer to a GMMR0MergeDuplicatePagesReq / VMMR0_DO_GMM_MERGE_DUPLICATE_PAGES request buffer. */
+typedef GMMMERGEPAGESREQ *PGMMMERGEPAGESREQ;
+
+GMMR0DECL(int) GMMR0MergeDuplicatePage(PGVM pGVM, uint32_t u32Hash, PGMMSHAREDPAGEDESC pPageDesc);
+GMMR0DECL(int) GMMR0MergeDuplicatePagesReq(PGVM pGVM, VMCPUID idCpu, PGMMMERGEPAGESREQ pReq);
+
 #if defined(VBOX_STRICT) && HC_ARCH_BITS == 64
 /**
  * Request buffer for GMMR0FindDuplicatePageReq / VMMR0_DO_GMM_FIND_DUPLICATE_PAGE.
@@ -812,6 +857,7 @@ GMMR3DECL(int)  GMMR3RegisterSharedModule(PVM pVM, PGMMREGISTERSHAREDMODULEREQ p
 GMMR3DECL(int)  GMMR3UnregisterSharedModule(PVM pVM, PGMMUNREGISTERSHAREDMODULEREQ pReq);
 GMMR3DECL(int)  GMMR3CheckSharedModules(PVM pVM);
 GMMR3DECL(int)  GMMR3ResetSharedModules(PVM pVM);
+GMMR3DECL(int)  GMMR3MergeDuplicatePages(PVM pVM, PGMMMERGEPAGESREQ pReq);
 
 # if defined(VBOX_STRICT) && HC_ARCH_BITS == 64
 GMMR3DECL(bool) GMMR3IsDuplicatePage(PVM pVM, uint32_t idPage);
@@ -2431,7 +2431,7 @@ typedef const PDMRTCHLP *PCPDMRTCHLP;
 /** @} */
 
 /** Current PDMDEVHLPR3 version number. */
-#define PDM_DEVHLPR3_VERSION                    PDM_VERSION_MAKE_PP(0xffe7, 66, 0)
+#define PDM_DEVHLPR3_VERSION                    PDM_VERSION_MAKE_PP(0xffe7, 68, 0)
 
 /**
  * PDM Device API.
@@ -2516,6 +2516,37 @@ typedef struct PDMDEVHLPR3
      */
     DECLR3CALLBACKMEMBER(uint32_t, pfnIoPortGetMappingAddress,(PPDMDEVINS pDevIns, IOMIOPORTHANDLE hIoPorts));
 
+    /**
+     * Sets up a shared IN handler for an I/O port range.
+     *
+     * IN accesses to the range are first offered to @a pfnInShared, which is
+     * called while owning @a pCritSectRw in shared mode and WITHOUT entering the
+     * device critical section.  This allows several EMTs to poll side-effect
+     * free status registers concurrently.  If the handler cannot complete the
+     * access, it returns VINF_IOM_READ_NEEDS_EXCLUSIVE and IOM redoes it using
+     * the regular IN handler while owning the device critical section.
+     *
+     * The device must enter @a pCritSectRw exclusively while updating state the
+     * shared handler depends upon in ways that must not be observed half done.
+     * The lock order is the device critical section first, then @a pCritSectRw,
+     * as the regular handlers are called owning the former.  The shared handler
+     * must therefore not enter the device critical section (IOM leaves
+     * @a pCritSectRw before falling back on the regular handler).
+     *
+     * @returns VBox status.
+     * @param   pDevIns         The device instance.
+     * @param   hIoPorts        The I/O port range handle.
+     * @param   pCritSectRw     The read/write critical section guarding the
+     *                          state accessed by @a pfnInShared.
+     * @param   pfnInShared     The shared IN handler.
+     * @thread  EMT(0)
+     * @note    Only available at VM creation time.
+     *
+     * @sa      PDMDevHlpIoPortSetUpContext(), PDMDevHlpCritSectRwInit().
+     */
+    DECLR3CALLBACKMEMBER(int, pfnIoPortSetInShared,(PPDMDEVINS pDevIns, IOMIOPORTHANDLE hIoPorts,
+                                                    PPDMCRITSECTRW pCritSectRw, PFNIOMIOPORTNEWIN pfnInShared));
+
     /**
      * Reads from an I/O port register.
      *
@@ -2649,6 +2680,27 @@ typedef struct PDMDEVHLPR3
      * @param   hRegion     The MMIO region handle.
      */
     DECLR3CALLBACKMEMBER(RTGCPHYS, pfnMmioGetMappingAddress,(PPDMDEVINS pDevIns, IOMMMIOHANDLE hRegion));
+
+    /**
+     * Sets up a shared read handler for an MMIO region.
+     *
+     * Same as pfnIoPortSetInShared, only for MMIO.  Only reads that IOM would
+     * pass straight on to the regular read handler (i.e. not split up according
+     * to the IOMMMIO_FLAGS_READ_XXX mode) are offered to @a pfnReadShared.
+     *
+     * @returns VBox status.
+     * @param   pDevIns         The device instance.
+     * @param   hRegion         The MMIO region handle.
+     * @param   pCritSectRw     The read/write critical section guarding the
+     *                          state accessed by @a pfnReadShared.
+     * @param   pfnReadShared   The shared read handler.
+     * @thread  EMT(0)
+     * @note    Only available at VM creation time.
+     *
+     * @sa      PDMDevHlpMmioSetUpContext(), PDMDevHlpCritSectRwInit().
+     */
+    DECLR3CALLBACKMEMBER(int, pfnMmioSetReadShared,(PPDMDEVINS pDevIns, IOMMMIOHANDLE hRegion,
+                                                    PPDMCRITSECTRW pCritSectRw, PFNIOMMMIONEWREAD pfnReadShared));
     /** @} */
 
     /** @name MMIO2
@@ -3287,6 +3339,43 @@ typedef struct PDMDEVHLPR3
      */
     DECLR3CALLBACKMEMBER(int, pfnPhysChangeMemBalloon,(PPDMDEVINS pDevIns, bool fInflate, unsigned cPages, RTGCPHYS *paPhysPage));
 
+    /**
+     * Inflate or deflate a memory balloon, waiting for the change to complete.
+     *
+     * Unlike pfnPhysChangeMemBalloon the change is never postponed, so the pages
+     * can be handed back to the guest as soon as this returns successfully.  Must
+     * not be called while owning a lock other EMTs may be blocking on.
+     *
+     * @returns VBox status code.
+     * @param   pDevIns             The device instance.
+     * @param   fInflate            Inflate or deflate memory balloon
+     * @param   cPages              Number of pages to free
+     * @param   paPhysPage          Array of guest physical addresses
+     * @thread  EMT
+     * @sa      PGMR3PhysChangeMemBalloonSync
+     */
+    DECLR3CALLBACKMEMBER(int, pfnPhysChangeMemBalloonSync,(PPDMDEVINS pDevIns, bool fInflate, unsigned cPages, RTGCPHYS *paPhysPage));
+
+    /**
+     * Returns guest RAM the guest reported as unused to the host.
+     *
+     * The backing of the allocated pages in the given ranges is replaced by the
+     * zero page, the pages remain ordinary RAM.  Pages which cannot be freed are
+     * skipped.  The guest must not be told that the ranges can be reused before
+     * this returns.
+     *
+     * @returns VBox status code.
+     * @param   pDevIns             The device instance.
+     * @param   cRanges             Number of ranges in @a paRanges.
+     * @param   paRanges            The guest physical ranges (page aligned).
+     * @param   pcPagesFreed        Where to return the number of pages freed.
+     *                              Optional.
+     * @thread  EMT
+     * @sa      PGMR3PhysFreeReportedPages
+     */
+    DECLR3CALLBACKMEMBER(int, pfnPhysFreeReportedPages,(PPDMDEVINS pDevIns, uint32_t cRanges, PCPGMPHYSRANGE paRanges,
+                                                        uint32_t *pcPagesFreed));
+
     /**
      * Allocate memory which is associated with current VM instance
      * and automatically freed on it's destruction.
@@ -5554,6 +5643,38 @@ typedef struct PDMDEVHLPR0
                                                        PFNIOMIOPORTNEWOUTSTRING pfnOutStr, PFNIOMIOPORTNEWINSTRING pfnInStr,
                                                        void *pvUser));
 
+    /**
+     * Sets up a shared IN handler for an I/O port range in ring-0.
+     *
+     * IN accesses to the range are first offered to @a pfnInShared, which is
+     * called while owning @a pCritSectRw in shared mode and WITHOUT entering the
+     * device critical section.  This allows several EMTs to poll side-effect
+     * free status registers concurrently.  If the handler cannot complete the
+     * access, it returns VINF_IOM_READ_NEEDS_EXCLUSIVE and IOM redoes it using
+     * the regular IN handler while owning the device critical section.
+     *
+     * The device must enter @a pCritSectRw exclusively while updating state the
+     * shared handler depends upon in ways that must not be observed half done.
+     * The lock order is the device critical section first, then @a pCritSectRw,
+     * as the regular handlers are called owning the former.  The shared handler
+     * must therefore not enter the device critical section (IOM leaves
+     * @a pCritSectRw before falling back on the regular handler).
+     *
+     * @returns VBox status.
+     * @param   pDevIns         The device instance.
+     * @param   hIoPorts        The I/O port range handle.
+     * @param   pCritSectRw     The read/write critical section guarding the
+     *                          state accessed by @a pfnInShared.
+     * @param   pfnInShared     The shared IN handler.
+     * @thread  EMT(0)
+     * @note    Only available at VM creation time.  The ring-0 handlers must have been set
+     *          up first.
+     *
+     * @sa      PDMDevHlpIoPortSetUpContext(), PDMDevHlpCritSectRwInit().
+     */
+    DECLR0CALLBACKMEMBER(int, pfnIoPortSetInShared,(PPDMDEVINS pDevIns, IOMIOPORTHANDLE hIoPorts,
+                                                    PPDMCRITSECTRW pCritSectRw, PFNIOMIOPORTNEWIN pfnInShared));
+
     /**
      * Sets up ring-0 callback handlers for an MMIO region.
      *
@@ -5581,6 +5702,28 @@ typedef struct PDMDEVHLPR0
     DECLR0CALLBACKMEMBER(int, pfnMmioSetUpContextEx,(PPDMDEVINS pDevIns, IOMMMIOHANDLE hRegion, PFNIOMMMIONEWWRITE pfnWrite,
                                                      PFNIOMMMIONEWREAD pfnRead, PFNIOMMMIONEWFILL pfnFill, void *pvUser));
 
+    /**
+     * Sets up a shared read handler for an MMIO region in ring-0.
+     *
+     * Same as pfnIoPortSetInShared, only for MMIO.  Only reads that IOM would
+     * pass straight on to the regular read handler (i.e. not split up according
+     * to the IOMMMIO_FLAGS_READ_XXX mode) are offered to @a pfnReadShared.
+     *
+     * @returns VBox status.
+     * @param   pDevIns         The device instance.
+     * @param   hRegion         The MMIO region handle.
+     * @param   pCritSectRw     The read/write critical section guarding the
+     *                          state accessed by @a pfnReadShared.
+     * @param   pfnReadShared   The shared read handler.
+     * @thread  EMT(0)
+     * @note    Only available at VM creation time.  The ring-0 handlers must have been set
+     *          up first.
+     *
+     * @sa      PDMDevHlpMmioSetUpContext(), PDMDevHlpCritSectRwInit().
+     */
+    DECLR0CALLBACKMEMBER(int, pfnMmioSetReadShared,(PPDMDEVINS pDevIns, IOMMMIOHANDLE hRegion,
+                                                    PPDMCRITSECTRW pCritSectRw, PFNIOMMMIONEWREAD pfnReadShared));
+
     /**
      * Sets up a ring-0 mapping for an MMIO2 region.
      *
@@ -6101,7 +6244,7 @@ typedef R0PTRTYPE(struct PDMDEVHLPR0 *) PPDMDEVHLPR0;
 typedef R0PTRTYPE(const struct PDMDEVHLPR0 *) PCPDMDEVHLPR0;
 
 /** Current PDMDEVHLP version number. */
-#define PDM_DEVHLPR0_VERSION                    PDM_VERSION_MAKE(0xffe5, 27, 0)
+#define PDM_DEVHLPR0_VERSION                    PDM_VERSION_MAKE(0xffe5, 28, 0)
 
 
 /**
@@ -6709,6 +6852,18 @@ DECLINLINE(int) PDMDevHlpIoPortSetUpContextEx(PPDMDEVINS pDevIns, IOMIOPORTHANDL
 }
 
 #endif /* !IN_RING3 || DOXYGEN_RUNNING */
+#if defined(IN_RING3) || defined(IN_RING0) || defined(DOXYGEN_RUNNING)
+
+/**
+ * @copydoc PDMDEVHLPR3::pfnIoPortSetInShared
+ */
+DECLINLINE(int) PDMDevHlpIoPortSetInShared(PPDMDEVINS pDevIns, IOMIOPORTHANDLE hIoPorts,
+                                           PPDMCRITSECTRW pCritSectRw, PFNIOMIOPORTNEWIN pfnInShared)
+{
+    return pDevIns->CTX_SUFF(pHlp)->pfnIoPortSetInShared(pDevIns, hIoPorts, pCritSectRw, pfnInShared);
+}
+
+#endif /* IN_RING3 || IN_RING0 || DOXYGEN_RUNNING */
 #ifdef IN_RING3
 
 /**
@@ -6817,6 +6972,18 @@ DECLINLINE(int) PDMDevHlpMmioSetUpContextEx(PPDMDEVINS pDevIns, IOMMMIOHANDLE hR
 }
 
 #endif /* !IN_RING3 || DOXYGEN_RUNNING */
+#if defined(IN_RING3) || defined(IN_RING0) || defined(DOXYGEN_RUNNING)
+
+/**
+ * @copydoc PDMDEVHLPR3::pfnMmioSetReadShared
+ */
+DECLINLINE(int) PDMDevHlpMmioSetReadShared(PPDMDEVINS pDevIns, IOMMMIOHANDLE hRegion,
+                                           PPDMCRITSECTRW pCritSectRw, PFNIOMMMIONEWREAD pfnReadShared)
+{
+    return pDevIns->CTX_SUFF(pHlp)->pfnMmioSetReadShared(pDevIns, hRegion, pCritSectRw, pfnReadShared);
+}
+
+#endif /* IN_RING3 || IN_RING0 || DOXYGEN_RUNNING */
 #ifdef IN_RING3
 
 /**
@@ -7372,6 +7539,22 @@ DECLINLINE(int) PDMDevHlpPhysChangeMemBalloon(PPDMDEVINS pDevIns, bool fInflate,
     return pDevIns->CTX_SUFF(pHlp)->pfnPhysChangeMemBalloon(pDevIns, fInflate, cPages, paPhysPage);
 }
 
+/**
+ * @copydoc PDMDEVHLPR3::pfnPhysChangeMemBalloonSync
+ */
+DECLINLINE(int) PDMDevHlpPhysChangeMemBalloonSync(PPDMDEVINS pDevIns, bool fInflate, unsigned cPages, RTGCPHYS *paPhysPage)
+{
+    return pDevIns->CTX_SUFF(pHlp)->pfnPhysChangeMemBalloonSync(pDevIns, fInflate, cPages, paPhysPage);
+}
+
+/**
+ * @copydoc PDMDEVHLPR3::pfnPhysFreeReportedPages
+ */
+DECLINLINE(int) PDMDevHlpPhysFreeReportedPages(PPDMDEVINS pDevIns, uint32_t cRanges, PCPGMPHYSRANGE paRanges, uint32_t *pcPagesFreed)
+{
+    return pDevIns->CTX_SUFF(pHlp)->pfnPhysFreeReportedPages(pDevIns, cRanges, paRanges, pcPagesFreed);
+}
+
 /**
  * @copydoc PDMDEVHLPR3::pfnCpuGetGuestArch
  */
@@ -884,6 +884,10 @@ typedef struct PGMPHYSRANGE
     uint64_t        cPages;
 } PGMPHYSRANGE;
 AssertCompileSize(PGMPHYSRANGE, 16);
+/** Pointer to a physical memory range. */
+typedef PGMPHYSRANGE *PPGMPHYSRANGE;
+/** Pointer to a const physical memory range. */
+typedef PGMPHYSRANGE const *PCPGMPHYSRANGE;
 
 /**
  * A list of physical memory ranges.
@@ -1128,6 +1132,7 @@ VMMR0_INT_DECL(void) PGMR0CleanupVM(PGVM pGVM);
 VMMR0_INT_DECL(int)  PGMR0PhysAllocateHandyPages(PGVM pGVM, VMCPUID idCpu);
 VMMR0_INT_DECL(int)  PGMR0PhysFlushHandyPages(PGVM pGVM, VMCPUID idCpu);
 VMMR0_INT_DECL(int)  PGMR0PhysAllocateLargePage(PGVM pGVM, VMCPUID idCpu, RTGCPHYS GCPhys);
+VMMR0_INT_DECL(int)  PGMR0PhysCoalesceLargePage(PGVM pGVM, VMCPUID idCpu, RTGCPHYS GCPhys);
 VMMR0_INT_DECL(int)  PGMR0PhysMMIO2MapKernel(PGVM pGVM, PPDMDEVINS pDevIns, PGMMMIO2HANDLE hMmio2,
                                              size_t offSub, size_t cbSub, void **ppvMapping);
 VMMR0_INT_DECL(int)  PGMR0PhysSetupIoMmu(PGVM pGVM);
@@ -1139,6 +1144,7 @@ VMMR0_INT_DECL(int)  PGMR0HandlerPhysicalTypeSetUpContext(PGVM pGVM, PGMPHYSHAND
 
 VMMR0DECL(int)       PGMR0SharedModuleCheck(PVMCC pVM, PGVM pGVM, VMCPUID idCpu, PGMMSHAREDMODULE pModule,
                                             PCRTGCPTR64 paRegionsGCPtrs);
+VMMR0DECL(int)       PGMR0SharedPageMerge(PGVM pGVM, VMCPUID idCpu, PGMMMERGEPAGESREQ pReq);
 VMMR0DECL(int)       PGMR0Trap0eHandlerNestedPaging(PGVM pGVM, PGVMCPU pGVCpu, PGMMODE enmShwPagingMode, RTGCUINT uErr,
                                                     PCPUMCTX pCtx, RTGCPHYS pvFault);
 VMMR0DECL(VBOXSTRICTRC) PGMR0Trap0eHandlerNPMisconfig(PGVM pGVM, PGVMCPU pGVCpu, PGMMODE enmShwPagingMode,
@@ -1269,6 +1275,8 @@ VMMR3DECL(int)      PGMR3Term(PVM pVM);
 
 VMMR3DECL(int)      PGMR3PhysRegisterRam(PVM pVM, RTGCPHYS GCPhys, RTGCPHYS cb, const char *pszDesc);
 VMMR3DECL(int)      PGMR3PhysChangeMemBalloon(PVM pVM, bool fInflate, unsigned cPages, RTGCPHYS *paPhysPage);
+VMMR3DECL(int)      PGMR3PhysChangeMemBalloonSync(PVM pVM, bool fInflate, unsigned cPages, RTGCPHYS *paPhysPage);
+VMMR3DECL(int)      PGMR3PhysFreeReportedPages(PVM pVM, uint32_t cRanges, PCPGMPHYSRANGE paRanges, uint32_t *pcPagesFreed);
 VMMR3DECL(int)      PGMR3PhysWriteProtectRAM(PVM pVM);
 VMMR3DECL(uint32_t) PGMR3PhysGetRamRangeCount(PVM pVM);
 VMMR3DECL(int)      PGMR3PhysGetRange(PVM pVM, uint32_t iRange, PRTGCPHYS pGCPhysStart, PRTGCPHYS pGCPhysLast,
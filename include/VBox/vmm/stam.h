@@ -1370,6 +1370,34 @@ VMMR3DECL(int)  STAMR3DeregisterByAddr(PUVM pUVM, void *pvSample);
 VMMR3DECL(int)  STAMR3Reset(PUVM pUVM, const char *pszPat);
 VMMR3DECL(int)  STAMR3Snapshot(PUVM pUVM, const char *pszPat, char **ppszSnapshot, size_t *pcchSnapshot, bool fWithDesc);
 VMMR3DECL(int)  STAMR3SnapshotFree(PUVM pUVM, char *pszSnapshot);
+
+/** Handle to a statistics exporter (STAMR3ExportCreate). */
+typedef struct STAMEXPORTINT   *STAMEXPORT;
+/** Pointer to a statistics exporter handle. */
+typedef STAMEXPORT             *PSTAMEXPORT;
+/** NIL statistics exporter handle. */
+#define NIL_STAMEXPORT          ((STAMEXPORT)NULL)
+
+/** @name STAMR3ExportCreate flags.
+ * @{ */
+/** Include HELP lines with the sample descriptions and units. */
+#define STAM_EXPORT_CREATE_F_WITH_DESC      RT_BIT_32(0)
+/** Mask of valid flags. */
+#define STAM_EXPORT_CREATE_F_VALID_MASK     UINT32_C(0x00000001)
+/** @} */
+
+/** @name STAMR3ExportCollect flags.
+ * @{ */
+/** Only output the samples which changed since the previous collection. */
+#define STAM_EXPORT_COLLECT_F_CHANGED_ONLY  RT_BIT_32(0)
+/** Mask of valid flags. */
+#define STAM_EXPORT_COLLECT_F_VALID_MASK    UINT32_C(0x00000001)
+/** @} */
+
+VMMR3DECL(int)  STAMR3ExportCreate(PUVM pUVM, const char *pszPat, uint32_t fFlags, PSTAMEXPORT phExport);
+VMMR3DECL(int)  STAMR3ExportCollect(PUVM pUVM, STAMEXPORT hExport, uint32_t fFlags, char **ppszMetrics, size_t *pcchMetrics);
+VMMR3DECL(int)  STAMR3ExportDestroy(STAMEXPORT hExport);
+
 VMMR3DECL(int)  STAMR3Dump(PUVM pUVM, const char *pszPat);
 VMMR3DECL(int)  STAMR3DumpToReleaseLog(PUVM pUVM, const char *pszPat);
 VMMR3DECL(int)  STAMR3Print(PUVM pUVM, const char *pszPat);
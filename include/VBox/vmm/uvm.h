@@ -68,7 +68,7 @@ typedef struct UVMCPU
 #ifdef VMM_INCLUDED_SRC_include_VMInternal_h
         struct VMINTUSERPERVMCPU    s;
 #endif
-        uint8_t                     padding[512];
+        uint8_t                     padding[1024];
     } vm;
 
     /** The DBGF data. */
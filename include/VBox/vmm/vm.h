@@ -1447,7 +1447,7 @@ typedef struct VM
 #ifdef VMM_INCLUDED_SRC_include_TMInternal_h
         struct TM   s;
 #endif
-        uint8_t     padding[10112];      /* multiple of 64 */
+        uint8_t     padding[11392];      /* multiple of 64 */
     } tm;
 
     /** DBGF part. */
@@ -1573,7 +1573,7 @@ typedef struct VM
     } gcm;
 
     /** Padding for aligning the structure size on a page boundrary. */
-    uint8_t         abAlignment2[0x3A80 - sizeof(PVMCPUR3) * VMM_MAX_CPU_COUNT];
+    uint8_t         abAlignment2[0x3580 - sizeof(PVMCPUR3) * VMM_MAX_CPU_COUNT];
 
     /* ---- end small stuff ---- */
 
@@ -284,6 +284,8 @@ typedef enum VMMR0OPERATION
     VMMR0_DO_PGM_FLUSH_HANDY_PAGES,
     /** Call PGMR0AllocateLargePage(). */
     VMMR0_DO_PGM_ALLOCATE_LARGE_PAGE,
+    /** Call PGMR0PhysCoalesceLargePage(). */
+    VMMR0_DO_PGM_COALESCE_LARGE_PAGE,
     /** Call PGMR0PhysSetupIommu(). */
     VMMR0_DO_PGM_PHYS_SETUP_IOMMU,
     /** Call PGMR0PoolGrow(). */
@@ -325,6 +327,8 @@ typedef enum VMMR0OPERATION
     VMMR0_DO_GMM_RESET_SHARED_MODULES,
     /** Call GMMR0CheckSharedModules. */
     VMMR0_DO_GMM_CHECK_SHARED_MODULES,
+    /** Call GMMR0MergeDuplicatePagesReq. */
+    VMMR0_DO_GMM_MERGE_DUPLICATE_PAGES,
     /** Call GMMR0FindDuplicatePage. */
     VMMR0_DO_GMM_FIND_DUPLICATE_PAGE,
     /** Call GMMR0QueryStatistics(). */
@@ -358,9 +358,9 @@ VTABLE_ENTRY(STAMR3GetUnit)
 VTABLE_ENTRY(STAMR3GetUnit1)
 VTABLE_ENTRY(STAMR3GetUnit2)
 
-VTABLE_RESERVED(pfnSTAMR3Reserved1)
-VTABLE_RESERVED(pfnSTAMR3Reserved2)
-VTABLE_RESERVED(pfnSTAMR3Reserved3)
+VTABLE_ENTRY(STAMR3ExportCreate)
+VTABLE_ENTRY(STAMR3ExportCollect)
+VTABLE_ENTRY(STAMR3ExportDestroy)
 VTABLE_RESERVED(pfnSTAMR3Reserved4)
 VTABLE_RESERVED(pfnSTAMR3Reserved5)
 /** @} */
@@ -537,8 +537,8 @@ VTABLE_ENTRY(DBGFR3TypeSetSize)
 VTABLE_ENTRY(DBGFR3TypeValFree)
 VTABLE_ENTRY(DBGFR3TypeValDumpEx)
 
-VTABLE_RESERVED(pfnDBGFR3Reserved1)
-VTABLE_RESERVED(pfnDBGFR3Reserved2)
+VTABLE_ENTRY(DBGFR3SampleReportCreateEx)
+VTABLE_ENTRY(DBGFR3SampleReportDumpFoldedToFile)
 VTABLE_RESERVED(pfnDBGFR3Reserved3)
 VTABLE_RESERVED(pfnDBGFR3Reserved4)
 VTABLE_RESERVED(pfnDBGFR3Reserved5)
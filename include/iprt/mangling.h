@@ -2791,6 +2791,8 @@
 # define RTTraceLogRdrDestroy                           RT_MANGLER(RTTraceLogRdrDestroy)
 # define RTTraceLogRdrEvtFillVals                       RT_MANGLER(RTTraceLogRdrEvtFillVals)
 # define RTTraceLogRdrEvtGetDesc                        RT_MANGLER(RTTraceLogRdrEvtGetDesc)
+# define RTTraceLogRdrEvtGetGrpId                       RT_MANGLER(RTTraceLogRdrEvtGetGrpId)
+# define RTTraceLogRdrEvtGetParentGrpId                 RT_MANGLER(RTTraceLogRdrEvtGetParentGrpId)
 # define RTTraceLogRdrEvtGetSeqNo                       RT_MANGLER(RTTraceLogRdrEvtGetSeqNo)
 # define RTTraceLogRdrEvtGetTs                          RT_MANGLER(RTTraceLogRdrEvtGetTs)
 # define RTTraceLogRdrEvtIsGrouped                      RT_MANGLER(RTTraceLogRdrEvtIsGrouped)
@@ -662,6 +662,24 @@ RTDECL(uint64_t) RTTraceLogRdrEvtGetTs(RTTRACELOGRDREVT hRdrEvt);
 RTDECL(bool) RTTraceLogRdrEvtIsGrouped(RTTRACELOGRDREVT hRdrEvt);
 
 
+/**
+ * Returns the group ID of the given event.
+ *
+ * @returns Group ID of the event, 0 if not grouped.
+ * @param   hRdrEvt             The reader event handle.
+ */
+RTDECL(RTTRACELOGEVTGRPID) RTTraceLogRdrEvtGetGrpId(RTTRACELOGRDREVT hRdrEvt);
+
+
+/**
+ * Returns the parent group ID of the given event.
+ *
+ * @returns Parent group ID the event originated from, 0 if none.
+ * @param   hRdrEvt             The reader event handle.
+ */
+RTDECL(RTTRACELOGEVTGRPID) RTTraceLogRdrEvtGetParentGrpId(RTTRACELOGRDREVT hRdrEvt);
+
+
 /**
  * Returns the event descriptor associated with the given event.
  *
@@ -3266,6 +3266,97 @@ static DECLCALLBACK(VBOXSTRICTRC) hdaMmioRead(PPDMDEVINS pDevIns, void *pvUser,
 }
 
 
+/**
+ * Checks if a dword read starting with @a idxRegDsc only involves the plain
+ * register readers and can thus be done by hdaMmioReadShared.
+ *
+ * @returns true if it can, false if hdaMmioRead must do it.
+ * @param   idxRegDsc       The first register descriptor in the DWORD being read.
+ */
+DECLINLINE(bool) hdaIsPlainRead(unsigned idxRegDsc)
+{
+    int32_t cbLeft = 4; /* signed on purpose */
+    do
+    {
+        if (   g_aHdaRegMap[idxRegDsc].pfnRead == hdaRegReadU32
+            || g_aHdaRegMap[idxRegDsc].pfnRead == hdaRegReadU24
+            || g_aHdaRegMap[idxRegDsc].pfnRead == hdaRegReadU16
+            || g_aHdaRegMap[idxRegDsc].pfnRead == hdaRegReadU8)
+        { /* okay */ }
+        else
+            return false;
+
+        idxRegDsc++;
+        if (idxRegDsc < RT_ELEMENTS(g_aHdaRegMap))
+            cbLeft -= g_aHdaRegMap[idxRegDsc].off - g_aHdaRegMap[idxRegDsc - 1].off;
+        else
+            break;
+    } while (cbLeft > 0);
+    return true;
+}
+
+
+/**
+ * @callback_method_impl{FNIOMMMIONEWREAD,
+ *      Shared read handler for the plain registers.}
+ *
+ * IOM calls this with only HDASTATE::CritSectRegs entered in shared mode, so
+ * several EMTs can poll status registers like INTSTS, SDnSTS or RIRBWP without
+ * queuing up on HDASTATE::CritSect behind the timer and DMA code.  Anything but
+ * plain register reads is deferred to hdaMmioRead.
+ *
+ * The timer and DMA code update the registers read here using simple dword
+ * stores while owning CritSect only, so the guest sees either the old or the
+ * new value, just as when racing the update on real hardware.  Guest writes,
+ * which may update several registers at once (e.g. a reset), are serialized
+ * against this by hdaMmioWrite entering CritSectRegs exclusively.
+ */
+static DECLCALLBACK(VBOXSTRICTRC) hdaMmioReadShared(PPDMDEVINS pDevIns, void *pvUser, RTGCPHYS off, void *pv, unsigned cb)
+{
+    PHDASTATE pThis = PDMDEVINS_2_DATA(pDevIns, PHDASTATE);
+    RT_NOREF_PV(pvUser);
+    Assert(pThis->uAlignmentCheckMagic == HDASTATE_ALIGNMENT_CHECK_MAGIC);
+    Assert(cb == 4); Assert((off & 3) == 0); RT_NOREF(cb);
+
+    int idxRegDsc = hdaRegLookup(off);
+    if (   idxRegDsc < 0
+        || !hdaIsPlainRead(idxRegDsc))
+        return VINF_IOM_READ_NEEDS_EXCLUSIVE;
+
+    if (g_aHdaRegMap[idxRegDsc].cb == 4)
+    {
+        VBOXSTRICTRC rc = hdaRegReadU32(pDevIns, pThis, idxRegDsc, (uint32_t *)pv);
+        Log3Func(("  Read %s => %x (%Rrc)\n", g_aHdaRegMap[idxRegDsc].pszName, *(uint32_t *)pv, VBOXSTRICTRC_VAL(rc)));
+        STAM_COUNTER_INC(&pThis->aStatRegReads[idxRegDsc]);
+        return rc;
+    }
+
+    /*
+     * Multi register read, see hdaMmioRead.  All the readers are plain ones
+     * which cannot fail.
+     */
+    STAM_COUNTER_INC(&pThis->CTX_SUFF_Z(StatRegMultiReads));
+    uint32_t u32Value = 0;
+    unsigned cbLeft   = 4;
+    do
+    {
+        uint32_t const  cbReg  = g_aHdaRegMap[idxRegDsc].cb;
+        uint32_t        u32Tmp = 0;
+        hdaRegReadU32(pDevIns, pThis, idxRegDsc, &u32Tmp);
+        Log4Func(("  Read %s[%db] => %x*\n", g_aHdaRegMap[idxRegDsc].pszName, cbReg, u32Tmp));
+        STAM_COUNTER_INC(&pThis->aStatRegReads[idxRegDsc]);
+        u32Value |= (u32Tmp & g_afMasks[cbReg]) << ((4 - cbLeft) * 8);
+
+        cbLeft -= cbReg;
+        off    += cbReg;
+        idxRegDsc++;
+    } while (cbLeft > 0 && g_aHdaRegMap[idxRegDsc].off == off);
+
+    *(uint32_t *)pv = u32Value;
+    return VINF_SUCCESS;
+}
+
+
 DECLINLINE(VBOXSTRICTRC) hdaWriteReg(PPDMDEVINS pDevIns, PHDASTATE pThis, int idxRegDsc, uint32_t u32Value, char const *pszLog)
 {
     if (   (HDA_REG(pThis, GCTL) & HDA_GCTL_CRST)
@@ -3329,14 +3420,17 @@ DECLINLINE(VBOXSTRICTRC) hdaWriteReg(PPDMDEVINS pDevIns, PHDASTATE pThis, int id
 
 
 /**
- * @callback_method_impl{FNIOMMMIONEWWRITE,
- *      Looks up and calls the appropriate handler.}
+ * Worker for hdaMmioWrite that looks up and calls the appropriate handler.
+ *
+ * @returns Strict VBox status code.
+ * @param   pDevIns     The device instance.
+ * @param   pThis       The shared HDA device state.
+ * @param   off         The offset into the MMIO region.
+ * @param   pv          The value being written.
+ * @param   cb          The size of the access.
  */
-static DECLCALLBACK(VBOXSTRICTRC) hdaMmioWrite(PPDMDEVINS pDevIns, void *pvUser, RTGCPHYS off, void const *pv, unsigned cb)
+static VBOXSTRICTRC hdaMmioWriteWorker(PPDMDEVINS pDevIns, PHDASTATE pThis, RTGCPHYS off, void const *pv, unsigned cb)
 {
-    PHDASTATE pThis  = PDMDEVINS_2_DATA(pDevIns, PHDASTATE);
-    RT_NOREF_PV(pvUser);
-    Assert(pThis->uAlignmentCheckMagic == HDASTATE_ALIGNMENT_CHECK_MAGIC);
 
     /*
      * Look up and log the access.
@@ -3517,6 +3611,27 @@ static DECLCALLBACK(VBOXSTRICTRC) hdaMmioWrite(PPDMDEVINS pDevIns, void *pvUser,
     return rc;
 }
 
+
+/**
+ * @callback_method_impl{FNIOMMMIONEWWRITE,
+ *      Serializes against hdaMmioReadShared and calls hdaMmioWriteWorker.}
+ */
+static DECLCALLBACK(VBOXSTRICTRC) hdaMmioWrite(PPDMDEVINS pDevIns, void *pvUser, RTGCPHYS off, void const *pv, unsigned cb)
+{
+    PHDASTATE pThis  = PDMDEVINS_2_DATA(pDevIns, PHDASTATE);
+    RT_NOREF_PV(pvUser);
+    Assert(pThis->uAlignmentCheckMagic == HDASTATE_ALIGNMENT_CHECK_MAGIC);
+
+    /* Lock order: CritSectRegs before CritSect. */
+    VBOXSTRICTRC rc = PDMDevHlpCritSectRwEnterExcl(pDevIns, &pThis->CritSectRegs, VINF_IOM_R3_MMIO_WRITE);
+    if (rc == VINF_SUCCESS)
+    {
+        rc = hdaMmioWriteWorker(pDevIns, pThis, off, pv, cb);
+        PDMDevHlpCritSectRwLeaveExcl(pDevIns, &pThis->CritSectRegs);
+    }
+    return rc;
+}
+
 #ifdef IN_RING3
 
 
@@ -4816,6 +4931,8 @@ static DECLCALLBACK(int) hdaR3Destruct(PPDMDEVINS pDevIns)
         PDMDevHlpCritSectLeave(pDevIns, &pThis->CritSect);
         PDMDevHlpCritSectDelete(pDevIns, &pThis->CritSect);
     }
+    if (PDMDevHlpCritSectRwIsInitialized(pDevIns, &pThis->CritSectRegs))
+        PDMDevHlpCritSectRwDelete(pDevIns, &pThis->CritSectRegs);
     return VINF_SUCCESS;
 }
 
@@ -4920,6 +5037,9 @@ static DECLCALLBACK(int) hdaR3Construct(PPDMDEVINS pDevIns, int iInstance, PCFGM
     rc = PDMDevHlpCritSectInit(pDevIns, &pThis->CritSect, RT_SRC_POS, "HDA");
     AssertRCReturn(rc, rc);
 
+    rc = PDMDevHlpCritSectRwInit(pDevIns, &pThis->CritSectRegs, RT_SRC_POS, "HDA-Regs");
+    AssertRCReturn(rc, rc);
+
     rc = PDMDevHlpSetDeviceCritSect(pDevIns, PDMDevHlpCritSectGetNop(pDevIns));
     AssertRCReturn(rc, rc);
 
@@ -5038,6 +5158,8 @@ static DECLCALLBACK(int) hdaR3Construct(PPDMDEVINS pDevIns, int iInstance, PCFGM
     rc = PDMDevHlpPCIIORegionCreateMmio(pDevIns, 0, 0x4000, PCI_ADDRESS_SPACE_MEM, hdaMmioWrite, hdaMmioRead, NULL /*pvUser*/,
                                         IOMMMIO_FLAGS_READ_DWORD | IOMMMIO_FLAGS_WRITE_PASSTHRU, "HDA", &pThis->hMmio);
     AssertRCReturn(rc, rc);
+    rc = PDMDevHlpMmioSetReadShared(pDevIns, pThis->hMmio, &pThis->CritSectRegs, hdaMmioReadShared);
+    AssertRCReturn(rc, rc);
 
 # ifdef VBOX_WITH_MSI_DEVICES
     PDMMSIREG MsiReg;
@@ -5377,6 +5499,8 @@ static DECLCALLBACK(int) hdaRZConstruct(PPDMDEVINS pDevIns)
 
     rc = PDMDevHlpMmioSetUpContext(pDevIns, pThis->hMmio, hdaMmioWrite, hdaMmioRead, NULL /*pvUser*/);
     AssertRCReturn(rc, rc);
+    rc = PDMDevHlpMmioSetReadShared(pDevIns, pThis->hMmio, &pThis->CritSectRegs, hdaMmioReadShared);
+    AssertRCReturn(rc, rc);
 
 # if 0 /* Codec is not yet kosher enough for ring-0.  @bugref{9890c64} */
     /* Construct the R0 codec part. */
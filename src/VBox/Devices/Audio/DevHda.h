@@ -650,6 +650,10 @@ typedef struct HDASTATE
 {
     /** Critical section protecting the HDA state. */
     PDMCRITSECT             CritSect;
+    /** Read/write critical section for the register set.
+     * Entered in shared mode by IOM around hdaMmioReadShared and exclusively by
+     * hdaMmioWrite before CritSect is entered. */
+    PDMCRITSECTRW           CritSectRegs;
     /** Internal stream states (aligned on 64 byte boundrary). */
     HDASTREAM               aStreams[HDA_MAX_STREAMS];
     /** The HDA's register set. */
@@ -2915,6 +2915,10 @@ static void vgaR3InitExpand(void)
         AssertCompile(RT_IS_POWER_OF_TWO(a_cPorts)); \
         Assert((unsigned)offPort - (unsigned)(a_uPort) < (unsigned)(a_cPorts)); \
         NOREF(pvUser); \
+        /* Lock order: device critical section (owned by IOM) -> CritSectRegs. */ \
+        int const rcLock = PDMDevHlpCritSectRwEnterExcl(pDevIns, &pThis->CritSectRegs, VINF_IOM_R3_IOPORT_WRITE); \
+        if (rcLock != VINF_SUCCESS) \
+            return rcLock; \
         if (cb == 1) \
             vga_ioport_write(pDevIns, pThis, offPort, u32); \
         else if (cb == 2) \
@@ -2922,6 +2926,7 @@ static void vgaR3InitExpand(void)
             vga_ioport_write(pDevIns, pThis, offPort, u32 & 0xff); \
             vga_ioport_write(pDevIns, pThis, offPort + 1, u32 >> 8); \
         } \
+        PDMDevHlpCritSectRwLeaveExcl(pDevIns, &pThis->CritSectRegs); \
         return VINF_SUCCESS; \
     } while (0)
 
@@ -3139,6 +3144,44 @@ static DECLCALLBACK(VBOXSTRICTRC) vgaIoPortCgaStRead(PPDMDEVINS pDevIns, void *p
 }
 
 
+/**
+ * @callback_method_impl{FNIOMIOPORTNEWIN,
+ *      0x3ba/0x3da MDA/CGA input status - shared variant.}
+ *
+ * Guests poll the input status register in tight loops while waiting for the
+ * vertical retrace, so IOM calls this with VGASTATE::CritSectRegs entered in
+ * shared mode instead of the device critical section.  The state consulted
+ * here is only changed by vga_ioport_write, which owns CritSectRegs exclusively
+ * when doing so.  The OUT handlers enter it after the device critical section,
+ * so this handler must never try to enter the latter.  Concurrent readers may
+ * both store ST01 and reset the attribute controller flip-flop, which is
+ * harmless as they store the same values.  With retrace emulation disabled
+ * they may however read the same value instead of alternating ones.
+ */
+static DECLCALLBACK(VBOXSTRICTRC) vgaIoPortStReadShared(PPDMDEVINS pDevIns, void *pvUser, RTIOPORT offPort, uint32_t *pu32, unsigned cb)
+{
+    PVGASTATE pThis = PDMDEVINS_2_DATA(pDevIns, PVGASTATE);
+    Assert(offPort == 0x3ba || offPort == 0x3da);
+    NOREF(pvUser);
+    if (cb != 1)
+        return VINF_IOM_READ_NEEDS_EXCLUSIVE;
+
+    uint32_t uValue;
+    if (vga_ioport_invalid(pThis, offPort))
+        uValue = 0xff;
+    else
+    {
+        uint8_t const bSt01 = vga_retrace(pDevIns, pThis);
+        pThis->st01         = bSt01;
+        pThis->ar_flip_flop = 0;
+        uValue = bSt01;
+    }
+    Log(("VGA: read addr=0x%04x data=0x%02x (shared)\n", offPort, uValue));
+    *pu32 = uValue;
+    return VINF_SUCCESS;
+}
+
+
 /**
  * @callback_method_impl{FNIOMIOPORTNEWOUT,VBE Data Port OUT handler (0x1ce).}
  */
@@ -6378,6 +6421,8 @@ static DECLCALLBACK(int) vgaR3Destruct(PPDMDEVINS pDevIns)
     PDMDevHlpCritSectDelete(pDevIns, &pThis->CritSectIRQ);
 # endif
     PDMDevHlpCritSectDelete(pDevIns, &pThis->CritSect);
+    if (PDMDevHlpCritSectRwIsInitialized(pDevIns, &pThis->CritSectRegs))
+        PDMDevHlpCritSectRwDelete(pDevIns, &pThis->CritSectRegs);
     return VINF_SUCCESS;
 }
 
@@ -6665,6 +6710,8 @@ static DECLCALLBACK(int)   vgaR3Construct(PPDMDEVINS pDevIns, int iInstance, PCF
     AssertRCReturn(rc, rc);
     rc = PDMDevHlpSetDeviceCritSect(pDevIns, &pThis->CritSect);
     AssertRCReturn(rc, rc);
+    rc = PDMDevHlpCritSectRwInit(pDevIns, &pThis->CritSectRegs, RT_SRC_POS, "VGA#%u-Regs", iInstance);
+    AssertRCReturn(rc, rc);
 
 # ifdef VBOX_WITH_HGSMI
     /*
@@ -6764,6 +6811,12 @@ static DECLCALLBACK(int)   vgaR3Construct(PPDMDEVINS pDevIns, int iInstance, PCF
 
 # undef REG_PORT
 
+        /* The input status registers get polled a lot, so let IOM read them without the device lock. */
+        rc = PDMDevHlpIoPortSetInShared(pDevIns, pThis->hIoPortMdaFcrSt, &pThis->CritSectRegs, vgaIoPortStReadShared);
+        AssertRCReturn(rc, rc);
+        rc = PDMDevHlpIoPortSetInShared(pDevIns, pThis->hIoPortCgaFcrSt, &pThis->CritSectRegs, vgaIoPortStReadShared);
+        AssertRCReturn(rc, rc);
+
         /* vga bios */
         rc = PDMDevHlpIoPortCreateAndMap(pDevIns, VBE_PRINTF_PORT, 1 /*cPorts*/, vgaIoPortWriteBios, vgaIoPortReadBios,
                                          "VGA BIOS debug/panic", NULL /*paExtDescs*/, &pThis->hIoPortBios);
@@ -7403,6 +7456,11 @@ static DECLCALLBACK(int) vgaRZConstruct(PPDMDEVINS pDevIns)
 
 # undef REG_PORT
 
+        rc = PDMDevHlpIoPortSetInShared(pDevIns, pThis->hIoPortMdaFcrSt, &pThis->CritSectRegs, vgaIoPortStReadShared);
+        AssertRCReturn(rc, rc);
+        rc = PDMDevHlpIoPortSetInShared(pDevIns, pThis->hIoPortCgaFcrSt, &pThis->CritSectRegs, vgaIoPortStReadShared);
+        AssertRCReturn(rc, rc);
+
         /* BIOS port: */
         rc = PDMDevHlpIoPortSetUpContext(pDevIns, pThis->hIoPortBios, vgaIoPortWriteBios, vgaIoPortReadBios, NULL /*pvUser*/);
         AssertRCReturn(rc, rc);
@@ -403,6 +403,9 @@ typedef struct VGAState
     RTGCPHYS                    GCPhysVRAM;
     /** The critical section protect the instance data. */
     PDMCRITSECT                 CritSect;
+    /** Serializes vgaIoPortStReadShared against the VGA register writes, which
+     * enter it exclusively while owning CritSect. */
+    PDMCRITSECTRW               CritSectRegs;
 
     /* Keep track of ring 0 latched accesses to the VGA MMIO memory. */
     uint64_t                    u64LastLatchedAccess;
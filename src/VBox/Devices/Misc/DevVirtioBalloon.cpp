@@ -0,0 +1,1436 @@
+/* $Id: DevVirtioBalloon.cpp $ */
+/** @file
+ * VBox misc devices - Virtio memory balloon device.
+ *
+ * Implements the traditional virtio memory balloon (device type 5) on top of
+ * the VirtIO core, so stock guest kernels can hand memory back to the host
+ * without the Guest Additions:
+ *    - inflateq / deflateq:  Host driven ballooning, mapped onto the same PGM
+ *                            balloon as the VMMDev based one.
+ *    - statsq:               Guest memory statistics, exported via STAM.
+ *    - reportingq:           Free page reporting.  The guest reports runs of
+ *                            free pages which are returned to the host right
+ *                            away, the pages stay guest RAM.
+ *
+ * Log-levels used:
+ *    - Level 1:   The most important (but usually rare) things to note
+ *    - Level 2:   Balloon size changes and free page reports
+ *    - Level 6:   Device <-> Guest Driver negotation, traffic, notifications and state handling
+ */
+
+/*
+ * Copyright (C) 2006-2023 Oracle and/or its affiliates.
+ *
+ * This file is part of VirtualBox base platform packages, as
+ * available from https://www.virtualbox.org.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, in version 3 of the
+ * License.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#define LOG_GROUP LOG_GROUP_DEV_VIRTIO
+
+#include <VBox/vmm/pdmdev.h>
+#include <VBox/vmm/pgm.h>
+#include <VBox/AssertGuest.h>
+#include <VBox/msi.h>
+#include <VBox/version.h>
+#include <VBox/log.h>
+#include <iprt/errcore.h>
+#include <iprt/assert.h>
+#include <iprt/string.h>
+#include <VBox/sup.h>
+#ifdef IN_RING3
+# include <iprt/mem.h>
+#endif
+#include "../VirtIO/VirtioCore.h"
+
+#include "VBoxDD.h"
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** The current saved state version. */
+#define VIRTIOBALLOON_SAVED_STATE_VERSION           UINT32_C(2)
+
+/** @name VirtIO 1.1 memory balloon feature bits (See VirtIO 1.1 specification, Section 5.5.3)
+ * @{  */
+#define VIRTIO_BALLOON_F_MUST_TELL_HOST             RT_BIT_64(0)    /**< Host must be told before pages are reused   */
+#define VIRTIO_BALLOON_F_STATS_VQ                   RT_BIT_64(1)    /**< Memory statistics virtqueue present          */
+#define VIRTIO_BALLOON_F_DEFLATE_ON_OOM             RT_BIT_64(2)    /**< Guest deflates balloon on OOM                */
+#define VIRTIO_BALLOON_F_FREE_PAGE_HINT             RT_BIT_64(3)    /**< Free page hinting (migration), not offered  */
+#define VIRTIO_BALLOON_F_PAGE_POISON                RT_BIT_64(4)    /**< Guest poisons free pages, see poison_val     */
+#define VIRTIO_BALLOON_F_REPORTING                  RT_BIT_64(5)    /**< Free page reporting virtqueue present        */
+/** @} */
+
+#define VIRTIOBALLOON_FEATURES_BASE \
+    (VIRTIO_BALLOON_F_MUST_TELL_HOST | VIRTIO_BALLOON_F_STATS_VQ | VIRTIO_BALLOON_F_DEFLATE_ON_OOM | VIRTIO_BALLOON_F_PAGE_POISON)
+
+/** @name Virtqueue indexes.
+ * The queues of features not negotiated are skipped by the guest, so the
+ * reporting queue moves down when the statistics queue is absent.
+ * @{ */
+#define VIRTIOBALLOON_INFLATEQ_IDX                  0
+#define VIRTIOBALLOON_DEFLATEQ_IDX                  1
+#define VIRTIOBALLOON_VIRTQ_CNT                     4               /**< inflateq, deflateq, statsq, reportingq       */
+#define VIRTIOBALLOON_VIRTQ_NONE                    UINT16_MAX
+/** @} */
+
+/** The balloon PFNs are always in 4KiB units, regardless of the guest page size. */
+#define VIRTIO_BALLOON_PFN_SHIFT                    12
+/** Max number of PFNs handed to PGM in one go (same as the Linux driver's batch size). */
+#define VIRTIOBALLOON_PFN_BATCH                     256
+/** Upper bound of an inflate/deflate buffer we accept. */
+#define VIRTIOBALLOON_MAX_PFN_BUF_SIZE              _64K
+/** Max number of free page ranges handed to PGM in one go. */
+#define VIRTIOBALLOON_REPORT_BATCH                  32
+
+/** @name Statistics tags (VirtIO 1.1 specification, Section 5.5.6.3)
+ * @{ */
+#define VIRTIO_BALLOON_S_SWAP_IN                    0
+#define VIRTIO_BALLOON_S_SWAP_OUT                   1
+#define VIRTIO_BALLOON_S_MAJFLT                     2
+#define VIRTIO_BALLOON_S_MINFLT                     3
+#define VIRTIO_BALLOON_S_MEMFREE                    4
+#define VIRTIO_BALLOON_S_MEMTOT                     5
+#define VIRTIO_BALLOON_S_AVAIL                      6
+#define VIRTIO_BALLOON_S_CACHES                     7
+#define VIRTIO_BALLOON_S_HTLB_PGALLOC               8
+#define VIRTIO_BALLOON_S_HTLB_PGFAIL                9
+#define VIRTIO_BALLOON_S_NR                         10
+/** @} */
+/** Max number of statistics entries read from one buffer. */
+#define VIRTIOBALLOON_MAX_STATS                     64
+
+#define PCI_DEVICE_ID_VIRTIOBALLOON                 0x1045          /**< 0x1040 + VIRTIO_DEVICE_TYPE_MEMORY_BALLOONING_TRAD */
+#define PCI_CLASS_BASE_OTHER                        0xff            /**< Unassigned class, same as other implementations */
+#define PCI_CLASS_SUB_OTHER                         0x00
+#define PCI_CLASS_PROG_UNSPECIFIED                  0x00
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/**
+ * virtio_balloon_config (VirtIO 1.1 specification, Section 5.5.4).
+ */
+#pragma pack(1)
+typedef struct virtio_balloon_config
+{
+    uint32_t uNumPages;                                         /**< num_pages: Requested balloon size (4K pages)  */
+    uint32_t uActual;                                           /**< actual: Balloon size reported by the guest    */
+    uint32_t uFreePageHintCmdId;                                /**< free_page_hint_cmd_id: Unused, not offered     */
+    uint32_t uPoisonVal;                                        /**< poison_val: Guest free page poison value      */
+} VIRTIOBALLOON_CONFIG_T, *PVIRTIOBALLOON_CONFIG_T;
+#pragma pack()
+AssertCompileSize(VIRTIOBALLOON_CONFIG_T, 16);
+
+/**
+ * A statistics entry (virtio_balloon_stat).
+ */
+#pragma pack(1)
+typedef struct VIRTIOBALLOONSTAT
+{
+    uint16_t uTag;
+    uint64_t uVal;
+} VIRTIOBALLOONSTAT;
+#pragma pack()
+AssertCompileSize(VIRTIOBALLOONSTAT, 10);
+
+
+/**
+ * The virtio memory balloon device shared state.
+ *
+ * @extends     VIRTIOCORE
+ */
+typedef struct VIRTIOBALLOON
+{
+    /** The core virtio state.   */
+    VIRTIOCORE                      Virtio;
+
+    /** The device specific configuration space. */
+    VIRTIOBALLOON_CONFIG_T          Config;
+
+    /** Instance name */
+    char                            szInstance[16];
+
+    /** Event semaphore the worker thread waits on. */
+    SUPSEMEVENT                     hEvtProcess;
+    /** Flag whether the worker is sleeping. */
+    bool volatile                   fSleeping;
+    /** Flag whether a notification was sent while the worker was busy. */
+    bool volatile                   fNotified;
+    /** Set while the worker is processing a buffer (quiescing). */
+    bool volatile                   fBusy;
+    /** Whether free page reporting is offered (CFGM). */
+    bool                            fOfferReporting;
+
+    /** True if the guest/driver and VirtIO framework are in the ready state */
+    uint32_t                        fVirtioReady;
+    /** The virtq used for statistics, VIRTIOBALLOON_VIRTQ_NONE if not negotiated. */
+    uint16_t                        uStatsVirtq;
+    /** The virtq used for free page reporting, VIRTIOBALLOON_VIRTQ_NONE if not negotiated. */
+    uint16_t                        uReportingVirtq;
+    /** Head index of the statistics buffer we hold on to, for saved state. */
+    uint16_t                        uStatsHeadIdx;
+    /** Set if a statistics buffer is held (pStatsBuf) or must be re-fetched after loading. */
+    bool                            fStatsBufHeld;
+    /** Free page reporting disabled because PGM can't free pages (NEM mode). */
+    bool                            fReportingBroken;
+
+    /** Interval at which updated statistics are requested, in milliseconds (0 = never). */
+    uint32_t                        cMsStatsInterval;
+    /** Number of pages currently in the balloon according to us. */
+    uint32_t                        cInflatedPages;
+    /** Virtual time (ns) when the statistics buffer was received. */
+    uint64_t                        nsStatsReceived;
+
+    /** The last statistics reported by the guest, indexed by VIRTIO_BALLOON_S_XXX. */
+    uint64_t                        au64GuestStats[VIRTIO_BALLOON_S_NR];
+
+    /** @name Statistics.
+     * @{ */
+    STAMCOUNTER                     StatInflatedPages;
+    STAMCOUNTER                     StatDeflatedPages;
+    STAMCOUNTER                     StatReports;
+    STAMCOUNTER                     StatReportedPages;
+    STAMCOUNTER                     StatFreedPages;
+    STAMCOUNTER                     StatStatsUpdates;
+    STAMPROFILE                     StatReport;
+    /** @} */
+} VIRTIOBALLOON;
+/** Pointer to the shared state of the virtio memory balloon device. */
+typedef VIRTIOBALLOON *PVIRTIOBALLOON;
+
+
+/**
+ * The virtio memory balloon device state, ring-3 edition.
+ *
+ * @extends     VIRTIOCORER3
+ */
+typedef struct VIRTIOBALLOONR3
+{
+    /** The core virtio ring-3 state. */
+    VIRTIOCORER3                    Virtio;
+
+    /** The worker thread servicing all the queues. */
+    R3PTRTYPE(PPDMTHREAD)           pThread;
+
+    /** The statistics buffer we hold until we want new statistics. */
+    R3PTRTYPE(PVIRTQBUF)            pStatsBuf;
+
+    /** Bitmap of the pages this device put into the balloon, one bit per 4KiB
+     * PFN.  Only accessed on EMT(0), or while all EMTs are in a rendezvous. */
+    uint32_t                       *pbmInflated;
+    /** Number of bits in pbmInflated (multiple of 64). */
+    uint32_t                        cInflatedBits;
+    /** Incremented when the balloon is dropped by a device or VM reset, so that
+     * inflate/deflate requests from before the reset are discarded. */
+    uint32_t volatile               uResetGen;
+
+    /** True if in the process of quiescing. */
+    bool volatile                   fQuiescing;
+    bool                            afPadding0[3];
+
+    /** For which purpose we're quiescing. */
+    VIRTIOVMSTATECHANGED            enmQuiescingFor;
+} VIRTIOBALLOONR3;
+/** Pointer to the ring-3 state of the virtio memory balloon device. */
+typedef VIRTIOBALLOONR3 *PVIRTIOBALLOONR3;
+
+
+/**
+ * The virtio memory balloon device state, ring-0 edition.
+ */
+typedef struct VIRTIOBALLOONR0
+{
+    /** The core virtio ring-0 state. */
+    VIRTIOCORER0                    Virtio;
+} VIRTIOBALLOONR0;
+/** Pointer to the ring-0 state of the virtio memory balloon device. */
+typedef VIRTIOBALLOONR0 *PVIRTIOBALLOONR0;
+
+
+/**
+ * The virtio memory balloon device state, raw-mode edition.
+ */
+typedef struct VIRTIOBALLOONRC
+{
+    /** The core virtio raw-mode state. */
+    VIRTIOCORERC                    Virtio;
+} VIRTIOBALLOONRC;
+/** Pointer to the raw-mode state of the virtio memory balloon device. */
+typedef VIRTIOBALLOONRC *PVIRTIOBALLOONRC;
+
+
+/** @typedef VIRTIOBALLOONCC
+ * The instance data for the current context. */
+typedef CTX_SUFF(VIRTIOBALLOON) VIRTIOBALLOONCC;
+/** @typedef PVIRTIOBALLOONCC
+ * Pointer to the instance data for the current context. */
+typedef CTX_SUFF(PVIRTIOBALLOON) PVIRTIOBALLOONCC;
+
+
+#ifdef IN_RING3
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+/** Names and descriptions of the guest statistics, indexed by tag. */
+static const struct
+{
+    const char *pszName;
+    const char *pszDesc;
+    STAMUNIT    enmUnit;
+} g_aVirtioBalloonStatNames[VIRTIO_BALLOON_S_NR] =
+{
+    { "SwapIn",         "Amount of memory swapped in.",                     STAMUNIT_BYTES },
+    { "SwapOut",        "Amount of memory swapped out.",                    STAMUNIT_BYTES },
+    { "MajorFaults",    "Number of major page faults.",                     STAMUNIT_COUNT },
+    { "MinorFaults",    "Number of minor page faults.",                     STAMUNIT_COUNT },
+    { "FreeMemory",     "Amount of memory not used for any purpose.",       STAMUNIT_BYTES },
+    { "TotalMemory",    "Total amount of memory available to the guest.",   STAMUNIT_BYTES },
+    { "Available",      "Estimate of memory available for new workloads.",  STAMUNIT_BYTES },
+    { "DiskCaches",     "Amount of memory used for disk caches.",           STAMUNIT_BYTES },
+    { "HugeTlbAllocs",  "Number of successful huge page allocations.",      STAMUNIT_COUNT },
+    { "HugeTlbFails",   "Number of failed huge page allocations.",          STAMUNIT_COUNT },
+};
+
+
+/**
+ * Returns the name of the given virtq as the guest sees it.
+ */
+static const char *virtioBalloonVirtqName(PVIRTIOBALLOON pThis, uint16_t uVirtq)
+{
+    if (uVirtq == VIRTIOBALLOON_INFLATEQ_IDX)
+        return "inflateq";
+    if (uVirtq == VIRTIOBALLOON_DEFLATEQ_IDX)
+        return "deflateq";
+    if (uVirtq == pThis->uStatsVirtq)
+        return "statsq";
+    if (uVirtq == pThis->uReportingVirtq)
+        return "reportingq";
+    return "unused";
+}
+
+/**
+ * Works out which virtqs the guest is going to use from the negotiated features.
+ */
+static void virtioBalloonR3SetupVirtqs(PVIRTIOBALLOON pThis, uint64_t fFeatures)
+{
+    uint16_t uNext = VIRTIOBALLOON_DEFLATEQ_IDX + 1;
+    pThis->uStatsVirtq     = fFeatures & VIRTIO_BALLOON_F_STATS_VQ  ? uNext++ : VIRTIOBALLOON_VIRTQ_NONE;
+    pThis->uReportingVirtq = fFeatures & VIRTIO_BALLOON_F_REPORTING ? uNext++ : VIRTIOBALLOON_VIRTQ_NONE;
+
+    for (uint16_t uVirtq = 0; uVirtq < VIRTIOBALLOON_VIRTQ_CNT; uVirtq++)
+        virtioCoreR3VirtqAttach(&pThis->Virtio, uVirtq, virtioBalloonVirtqName(pThis, uVirtq));
+}
+
+#endif /* IN_RING3 */
+
+/**
+ * callback_method_impl{VIRTIOCORER0,pfnVirtqNotified}
+ */
+static DECLCALLBACK(void) virtioBalloonNotified(PPDMDEVINS pDevIns, PVIRTIOCORE pVirtio, uint16_t uVirtqNbr)
+{
+    RT_NOREF(pVirtio);
+    PVIRTIOBALLOON pThis = PDMDEVINS_2_DATA(pDevIns, PVIRTIOBALLOON);
+
+    AssertReturnVoid(uVirtqNbr < VIRTIOBALLOON_VIRTQ_CNT);
+    Log6Func(("virtq %u has available data\n", uVirtqNbr));
+
+    /* Wake the worker thread up if sleeping */
+    if (!ASMAtomicXchgBool(&pThis->fNotified, true))
+    {
+        if (ASMAtomicReadBool(&pThis->fSleeping))
+        {
+            int rc = PDMDevHlpSUPSemEventSignal(pDevIns, pThis->hEvtProcess);
+            AssertRC(rc);
+        }
+    }
+}
+
+#ifdef IN_RING3
+
+/*********************************************************************************************************************************
+*   Virtq processing                                                                                                             *
+*********************************************************************************************************************************/
+
+/**
+ * Reads the device readable part of a buffer into @a pvDst.
+ *
+ * @returns Number of bytes read.
+ */
+static size_t virtioBalloonR3ReadBuf(PPDMDEVINS pDevIns, PVIRTIOBALLOON pThis, PVIRTQBUF pVirtqBuf, void *pvDst, size_t cbDst)
+{
+    PVIRTIOSGBUF pSgPhysSend = pVirtqBuf->pSgPhysSend;
+    size_t       cbRead      = 0;
+    for (unsigned iSeg = 0; pSgPhysSend && iSeg < pSgPhysSend->cSegs && cbRead < cbDst; iSeg++)
+    {
+        size_t const cbSeg = RT_MIN(pSgPhysSend->paSegs[iSeg].cbSeg, cbDst - cbRead);
+        virtioCoreGCPhysRead(&pThis->Virtio, pDevIns, pSgPhysSend->paSegs[iSeg].GCPhys, (uint8_t *)pvDst + cbRead, cbSeg);
+        cbRead += cbSeg;
+    }
+    return cbRead;
+}
+
+/**
+ * Hands a buffer back to the guest, nothing is written to it.
+ */
+static void virtioBalloonR3ReturnBuf(PPDMDEVINS pDevIns, PVIRTIOBALLOON pThis, uint16_t uVirtq, PVIRTQBUF pVirtqBuf)
+{
+    int rc = virtioCoreR3VirtqUsedBufPut(pDevIns, &pThis->Virtio, uVirtq, NULL /*pSgVirtReturn*/, pVirtqBuf, true /*fFence*/);
+    if (RT_SUCCESS(rc))
+        virtioCoreVirtqUsedRingSync(pDevIns, &pThis->Virtio, uVirtq);
+}
+
+/**
+ * Changes the balloon and keeps track of the pages, EMT(0) worker for
+ * virtioBalloonR3InflateDeflate().
+ *
+ * Pages already in (inflate) or not put into (deflate) the balloon by this
+ * device are dropped from the array, so a guest can neither deflate pages the
+ * VMMDev ballooned nor confuse the page count by inflating pages twice.
+ *
+ * @returns VBox status code.
+ * @param   pDevIns     The device instance.
+ * @param   fInflate    Inflate or deflate.
+ * @param   uResetGen   The reset generation the request was made in, nothing
+ *                      is done if the balloon was reset since.
+ * @param   pcPages     On input the number of pages in @a paGCPhys, on output
+ *                      the number of pages actually changed.
+ * @param   paGCPhys    The pages, filtered in place.
+ */
+static DECLCALLBACK(int) virtioBalloonR3ChangeOnEmt(PPDMDEVINS pDevIns, bool fInflate, uint32_t uResetGen,
+                                                    unsigned *pcPages, RTGCPHYS *paGCPhys)
+{
+    PVIRTIOBALLOON   pThis   = PDMDEVINS_2_DATA(pDevIns, PVIRTIOBALLOON);
+    PVIRTIOBALLOONCC pThisCC = PDMDEVINS_2_DATA_CC(pDevIns, PVIRTIOBALLOONCC);
+
+    unsigned const cPagesIn = *pcPages;
+    *pcPages = 0;
+    if (ASMAtomicReadU32(&pThisCC->uResetGen) != uResetGen)
+    {
+        Log2Func(("dropping stale %s request\n", fInflate ? "inflate" : "deflate"));
+        return VINF_SUCCESS;
+    }
+
+    unsigned cPages = 0;
+    for (unsigned i = 0; i < cPagesIn; i++)
+    {
+        uint64_t const iPfn = paGCPhys[i] >> VIRTIO_BALLOON_PFN_SHIFT;
+        if (iPfn >= pThisCC->cInflatedBits)
+            LogRelMax(16, ("%s: Ignoring %s of %RGp, outside guest RAM\n",
+                           pThis->szInstance, fInflate ? "inflate" : "deflate", paGCPhys[i]));
+        else if (ASMBitTest(pThisCC->pbmInflated, (int32_t)iPfn) == fInflate)
+            LogRelMax(16, ("%s: Ignoring %s of %RGp, %s\n", pThis->szInstance, fInflate ? "inflate" : "deflate",
+                           paGCPhys[i], fInflate ? "already in the balloon" : "not in our balloon"));
+        else
+            paGCPhys[cPages++] = paGCPhys[i];
+    }
+    if (!cPages)
+        return VINF_SUCCESS;
+
+    int rc = PDMDevHlpPhysChangeMemBalloonSync(pDevIns, fInflate, cPages, paGCPhys);
+    if (RT_SUCCESS(rc))
+    {
+        for (unsigned i = 0; i < cPages; i++)
+        {
+            int32_t const iPfn = (int32_t)(paGCPhys[i] >> VIRTIO_BALLOON_PFN_SHIFT);
+            if (fInflate)
+                ASMBitSet(pThisCC->pbmInflated, iPfn);
+            else
+                ASMBitClear(pThisCC->pbmInflated, iPfn);
+        }
+        if (fInflate)
+            pThis->cInflatedPages += cPages;
+        else
+            pThis->cInflatedPages -= cPages;
+        *pcPages = cPages;
+    }
+    return rc;
+}
+
+/**
+ * Hands all the pages this device put into the balloon back to the guest,
+ * EMT(0) worker for virtioBalloonR3StatusChanged().
+ */
+static DECLCALLBACK(void) virtioBalloonR3DeflateAllOnEmt(PPDMDEVINS pDevIns)
+{
+    PVIRTIOBALLOON   pThis   = PDMDEVINS_2_DATA(pDevIns, PVIRTIOBALLOON);
+    PVIRTIOBALLOONCC pThisCC = PDMDEVINS_2_DATA_CC(pDevIns, PVIRTIOBALLOONCC);
+    if (!pThisCC->pbmInflated)
+        return;
+
+    RTGCPHYS aGCPhys[VIRTIOBALLOON_PFN_BATCH];
+    uint32_t cDeflated = 0;
+    int32_t  iPfn = ASMBitFirstSet(pThisCC->pbmInflated, pThisCC->cInflatedBits);
+    while (iPfn >= 0)
+    {
+        unsigned cPages = 0;
+        for (; iPfn >= 0 && cPages < RT_ELEMENTS(aGCPhys); iPfn = ASMBitNextSet(pThisCC->pbmInflated, pThisCC->cInflatedBits, iPfn))
+            aGCPhys[cPages++] = (RTGCPHYS)iPfn << VIRTIO_BALLOON_PFN_SHIFT;
+
+        int rc = PDMDevHlpPhysChangeMemBalloonSync(pDevIns, false /*fInflate*/, cPages, &aGCPhys[0]);
+        if (RT_FAILURE(rc))
+        {
+            LogRel(("%s: Failed to release %u ballooned pages: %Rrc\n", pThis->szInstance, pThis->cInflatedPages - cDeflated, rc));
+            break;
+        }
+        cDeflated += cPages;
+    }
+    STAM_REL_COUNTER_ADD(&pThis->StatDeflatedPages, cDeflated);
+    Log2Func(("deflated %u pages\n", cDeflated));
+
+    /* Whatever is left we can't do anything about, forget it. */
+    ASMMemZero32(pThisCC->pbmInflated, pThisCC->cInflatedBits / 8);
+    pThis->cInflatedPages = 0;
+}
+
+/**
+ * Processes an inflateq or deflateq buffer.
+ *
+ * The PFN array is handed to the PGM balloon code on EMT(0) in batches and
+ * the pages have changed state when that returns.  The caller must only return
+ * the buffer to the guest on success, which satisfies
+ * VIRTIO_BALLOON_F_MUST_TELL_HOST.
+ *
+ * @returns VBox status code.
+ */
+static int virtioBalloonR3InflateDeflate(PPDMDEVINS pDevIns, PVIRTIOBALLOON pThis, PVIRTIOBALLOONCC pThisCC,
+                                         bool fInflate, PVIRTQBUF pVirtqBuf)
+{
+    uint32_t const uResetGen = ASMAtomicReadU32(&pThisCC->uResetGen);
+    size_t cbBuf = RT_MIN(pVirtqBuf->cbPhysSend, VIRTIOBALLOON_MAX_PFN_BUF_SIZE);
+    if (cbBuf != pVirtqBuf->cbPhysSend)
+        LogRelMax(16, ("%s: %s buffer too large (%zu bytes), truncated\n",
+                       pThis->szInstance, fInflate ? "Inflate" : "Deflate", pVirtqBuf->cbPhysSend));
+
+    uint32_t *pau32Pfns = (uint32_t *)RTMemTmpAlloc(RT_MAX(cbBuf, sizeof(uint32_t)));
+    if (!pau32Pfns)
+    {
+        LogRelMax(16, ("%s: Out of memory processing balloon buffer\n", pThis->szInstance));
+        return VERR_NO_TMP_MEMORY;
+    }
+    uint32_t const cPfns = (uint32_t)(virtioBalloonR3ReadBuf(pDevIns, pThis, pVirtqBuf, pau32Pfns, cbBuf) / sizeof(uint32_t));
+
+    int      rc = VINF_SUCCESS;
+    RTGCPHYS aGCPhys[VIRTIOBALLOON_PFN_BATCH];
+    uint32_t iPfn = 0;
+    while (iPfn < cPfns)
+    {
+        /* Collect a batch, dropping anything which isn't plain RAM (inflate). */
+        unsigned cPages = 0;
+        for (; iPfn < cPfns && cPages < RT_ELEMENTS(aGCPhys); iPfn++)
+        {
+            RTGCPHYS const GCPhys = (RTGCPHYS)RT_LE2H_U32(pau32Pfns[iPfn]) << VIRTIO_BALLOON_PFN_SHIFT;
+            if (fInflate && !PDMDevHlpPhysIsGCPhysNormal(pDevIns, GCPhys))
+            {
+                LogRelMax(16, ("%s: Ignoring inflate of non-RAM page %RGp\n", pThis->szInstance, GCPhys));
+                continue;
+            }
+            aGCPhys[cPages++] = GCPhys;
+        }
+        if (!cPages)
+            continue;
+
+        /* PGM wants to be called on an EMT and the balloon code must not be
+           entered while owning the IOM lock; priority requests are serviced
+           even while the VM is being suspended.  The synchronous variant is
+           used so the pages really are in their new state afterwards.  All
+           balloon changes go to EMT(0) which serializes the page tracking. */
+        rc = PDMDevHlpVMReqPriorityCallWait(pDevIns, 0 /*idDstCpu*/, (PFNRT)virtioBalloonR3ChangeOnEmt, 5,
+                                            pDevIns, fInflate, uResetGen, &cPages, &aGCPhys[0]);
+        if (RT_FAILURE(rc))
+        {
+            LogRelMax(16, ("%s: Changing the memory balloon failed: %Rrc\n", pThis->szInstance, rc));
+            break;
+        }
+
+        Log2Func(("%s %u pages\n", fInflate ? "inflated" : "deflated", cPages));
+        if (fInflate)
+            STAM_REL_COUNTER_ADD(&pThis->StatInflatedPages, cPages);
+        else
+            STAM_REL_COUNTER_ADD(&pThis->StatDeflatedPages, cPages);
+    }
+
+    RTMemTmpFree(pau32Pfns);
+    return rc;
+}
+
+/**
+ * Processes a statsq buffer.
+ *
+ * The buffer is kept until we want an update, returning it is the request.
+ */
+static void virtioBalloonR3Stats(PPDMDEVINS pDevIns, PVIRTIOBALLOON pThis, PVIRTIOBALLOONCC pThisCC, PVIRTQBUF pVirtqBuf)
+{
+    VIRTIOBALLOONSTAT aStats[VIRTIOBALLOON_MAX_STATS];
+    size_t const cbRead = virtioBalloonR3ReadBuf(pDevIns, pThis, pVirtqBuf, &aStats[0], sizeof(aStats));
+    for (size_t i = 0; i < cbRead / sizeof(aStats[0]); i++)
+    {
+        uint16_t const uTag = RT_LE2H_U16(aStats[i].uTag);
+        if (uTag < RT_ELEMENTS(pThis->au64GuestStats))
+            pThis->au64GuestStats[uTag] = RT_LE2H_U64(aStats[i].uVal);
+    }
+    STAM_REL_COUNTER_INC(&pThis->StatStatsUpdates);
+
+    /* Release any buffer we might still hold (shouldn't happen). */
+    if (pThisCC->pStatsBuf)
+        virtioCoreR3VirtqBufRelease(&pThis->Virtio, pThisCC->pStatsBuf);
+
+    virtioCoreR3VirtqBufRetain(pVirtqBuf);
+    pThisCC->pStatsBuf      = pVirtqBuf;
+    pThis->uStatsHeadIdx    = (uint16_t)pVirtqBuf->uHeadIdx;
+    pThis->fStatsBufHeld    = true;
+    pThis->nsStatsReceived  = PDMDevHlpTMTimeVirtGetNano(pDevIns);
+}
+
+/**
+ * Returns the held statistics buffer if it is time to ask for new statistics.
+ *
+ * @returns Milliseconds until the next request is due, RT_INDEFINITE_WAIT if
+ *          none is pending.
+ */
+static RTMSINTERVAL virtioBalloonR3StatsRequest(PPDMDEVINS pDevIns, PVIRTIOBALLOON pThis, PVIRTIOBALLOONCC pThisCC)
+{
+    PVIRTQBUF pVirtqBuf = pThisCC->pStatsBuf;
+    if (!pVirtqBuf || !pThis->cMsStatsInterval)
+        return RT_INDEFINITE_WAIT;
+
+    uint64_t const cMsElapsed = (PDMDevHlpTMTimeVirtGetNano(pDevIns) - pThis->nsStatsReceived) / RT_NS_1MS;
+    if (cMsElapsed < pThis->cMsStatsInterval)
+        return (RTMSINTERVAL)(pThis->cMsStatsInterval - cMsElapsed);
+
+    pThisCC->pStatsBuf   = NULL;
+    pThis->fStatsBufHeld = false;
+    virtioBalloonR3ReturnBuf(pDevIns, pThis, pThis->uStatsVirtq, pVirtqBuf);
+    virtioCoreR3VirtqBufRelease(&pThis->Virtio, pVirtqBuf);
+    return RT_INDEFINITE_WAIT;
+}
+
+/**
+ * Processes a reportingq buffer.
+ *
+ * The free ranges are the device writable segments of the buffer themselves.
+ * The pages are freed synchronously, the guest reuses them as soon as it sees
+ * the buffer in the used ring.
+ */
+static void virtioBalloonR3Report(PPDMDEVINS pDevIns, PVIRTIOBALLOON pThis, PVIRTQBUF pVirtqBuf)
+{
+    PVIRTIOSGBUF pSgPhysReturn = pVirtqBuf->pSgPhysReturn;
+    if (!pSgPhysReturn || !pSgPhysReturn->cSegs)
+        return;
+    STAM_REL_COUNTER_INC(&pThis->StatReports);
+
+    /* Freeing poisoned pages would hand the guest back zeros instead of the poison pattern. */
+    if (   (virtioCoreGetNegotiatedFeatures(&pThis->Virtio) & VIRTIO_BALLOON_F_PAGE_POISON)
+        && pThis->Config.uPoisonVal != 0)
+        return;
+    if (pThis->fReportingBroken)
+        return;
+
+    STAM_REL_PROFILE_START(&pThis->StatReport, a);
+
+    PGMPHYSRANGE aRanges[VIRTIOBALLOON_REPORT_BATCH];
+    uint32_t     cRanges = 0;
+    uint32_t     cPagesTotal = 0;
+    for (unsigned iSeg = 0; iSeg <= pSgPhysReturn->cSegs; iSeg++)
+    {
+        if (iSeg < pSgPhysReturn->cSegs)
+        {
+            RTGCPHYS const GCPhysFirst = RT_ALIGN_T(pSgPhysReturn->paSegs[iSeg].GCPhys, GUEST_PAGE_SIZE, RTGCPHYS);
+            RTGCPHYS const GCPhysEnd   = (pSgPhysReturn->paSegs[iSeg].GCPhys + pSgPhysReturn->paSegs[iSeg].cbSeg)
+                                       & ~(RTGCPHYS)GUEST_PAGE_OFFSET_MASK;
+            if (GCPhysEnd <= GCPhysFirst)
+                continue;
+            aRanges[cRanges].GCPhysStart = GCPhysFirst;
+            aRanges[cRanges].cPages      = (GCPhysEnd - GCPhysFirst) >> GUEST_PAGE_SHIFT;
+            cPagesTotal += (uint32_t)aRanges[cRanges].cPages;
+            cRanges++;
+            if (cRanges < RT_ELEMENTS(aRanges))
+                continue;
+        }
+        else if (!cRanges)
+            break;
+
+        uint32_t cPagesFreed = 0;
+        int rc = PDMDevHlpVMReqPriorityCallWait(pDevIns, VMCPUID_ANY, (PFNRT)pDevIns->pHlpR3->pfnPhysFreeReportedPages, 4,
+                                                pDevIns, cRanges, &aRanges[0], &cPagesFreed);
+        if (RT_FAILURE(rc))
+        {
+            LogRel(("%s: Free page reporting failed (%Rrc), ignoring further reports\n", pThis->szInstance, rc));
+            pThis->fReportingBroken = true;
+            break;
+        }
+        STAM_REL_COUNTER_ADD(&pThis->StatFreedPages, cPagesFreed);
+        cRanges = 0;
+    }
+    STAM_REL_COUNTER_ADD(&pThis->StatReportedPages, cPagesTotal);
+    Log2Func(("%u pages reported free\n", cPagesTotal));
+
+    STAM_REL_PROFILE_STOP(&pThis->StatReport, a);
+}
+
+/**
+ * Fetches and processes one buffer from the given virtq.
+ *
+ * @returns true if a buffer was processed, false if the queue is empty.
+ */
+static bool virtioBalloonR3ProcessVirtq(PPDMDEVINS pDevIns, PVIRTIOBALLOON pThis, PVIRTIOBALLOONCC pThisCC, uint16_t uVirtq)
+{
+    if (   uVirtq == VIRTIOBALLOON_VIRTQ_NONE
+        || !virtioCoreIsVirtqEnabled(&pThis->Virtio, uVirtq)
+        || virtioCoreVirtqAvailBufCount(pDevIns, &pThis->Virtio, uVirtq) == 0)
+        return false;
+
+    PVIRTQBUF pVirtqBuf = virtioCoreR3VirtqBufAlloc();
+    if (!pVirtqBuf)
+    {
+        LogRel(("Failed to allocate memory for VIRTQBUF\n"));
+        return false;
+    }
+
+    int rc = virtioCoreR3VirtqAvailBufGet(pDevIns, &pThis->Virtio, uVirtq, pVirtqBuf, true /*fRemove*/);
+    if (RT_SUCCESS(rc))
+    {
+        Log6Func(("processing %s buffer\n", virtioBalloonVirtqName(pThis, uVirtq)));
+        if (uVirtq == pThis->uStatsVirtq)
+            virtioBalloonR3Stats(pDevIns, pThis, pThisCC, pVirtqBuf);
+        else if (uVirtq == VIRTIOBALLOON_INFLATEQ_IDX || uVirtq == VIRTIOBALLOON_DEFLATEQ_IDX)
+        {
+            /* If PGM couldn't do what the guest asked for, the buffer must not
+               be completed as the guest would go on and touch the pages.  We
+               can't recover from that, so have the guest reset the device. */
+            int rc2 = virtioBalloonR3InflateDeflate(pDevIns, pThis, pThisCC, uVirtq == VIRTIOBALLOON_INFLATEQ_IDX, pVirtqBuf);
+            if (RT_SUCCESS(rc2))
+                virtioBalloonR3ReturnBuf(pDevIns, pThis, uVirtq, pVirtqBuf);
+            else
+            {
+                LogRelMax(16, ("%s: Failed to process %s buffer (%Rrc), device needs reset\n",
+                               pThis->szInstance, virtioBalloonVirtqName(pThis, uVirtq), rc2));
+                virtioCoreResetAll(&pThis->Virtio);
+            }
+        }
+        else
+        {
+            if (uVirtq == pThis->uReportingVirtq)
+                virtioBalloonR3Report(pDevIns, pThis, pVirtqBuf);
+            virtioBalloonR3ReturnBuf(pDevIns, pThis, uVirtq, pVirtqBuf);
+        }
+    }
+    virtioCoreR3VirtqBufRelease(&pThis->Virtio, pVirtqBuf);
+    return RT_SUCCESS(rc);
+}
+
+
+/*********************************************************************************************************************************
+*   Worker thread                                                                                                                *
+*********************************************************************************************************************************/
+
+/**
+ * @callback_method_impl{FNPDMTHREADWAKEUPDEV}
+ */
+static DECLCALLBACK(int) virtioBalloonR3WorkerWakeUp(PPDMDEVINS pDevIns, PPDMTHREAD pThread)
+{
+    RT_NOREF(pThread);
+    PVIRTIOBALLOON pThis = PDMDEVINS_2_DATA(pDevIns, PVIRTIOBALLOON);
+    return PDMDevHlpSUPSemEventSignal(pDevIns, pThis->hEvtProcess);
+}
+
+/**
+ * @callback_method_impl{FNPDMTHREADDEV}
+ */
+static DECLCALLBACK(int) virtioBalloonR3WorkerThread(PPDMDEVINS pDevIns, PPDMTHREAD pThread)
+{
+    PVIRTIOBALLOON   pThis   = PDMDEVINS_2_DATA(pDevIns, PVIRTIOBALLOON);
+    PVIRTIOBALLOONCC pThisCC = PDMDEVINS_2_DATA_CC(pDevIns, PVIRTIOBALLOONCC);
+
+    if (pThread->enmState == PDMTHREADSTATE_INITIALIZING)
+        return VINF_SUCCESS;
+
+    while (pThread->enmState == PDMTHREADSTATE_RUNNING)
+    {
+        bool fWorkDone = false;
+        RTMSINTERVAL cMsWait = RT_INDEFINITE_WAIT;
+
+        ASMAtomicWriteBool(&pThis->fBusy, true);
+        if (   !ASMAtomicReadBool(&pThisCC->fQuiescing)
+            && pThis->fVirtioReady)
+        {
+            /* Re-fetch the statistics buffer we held when the state was saved. */
+            if (   pThis->fStatsBufHeld
+                && !pThisCC->pStatsBuf
+                && pThis->uStatsVirtq != VIRTIOBALLOON_VIRTQ_NONE)
+            {
+                pThis->fStatsBufHeld = false;
+                PVIRTQBUF pVirtqBuf = virtioCoreR3VirtqBufAlloc();
+                if (pVirtqBuf)
+                {
+                    int rc = virtioCoreR3VirtqAvailBufGet(pDevIns, &pThis->Virtio, pThis->uStatsVirtq,
+                                                          pThis->uStatsHeadIdx, pVirtqBuf);
+                    if (RT_SUCCESS(rc))
+                    {
+                        pThisCC->pStatsBuf   = pVirtqBuf;
+                        pThis->fStatsBufHeld = true;
+                    }
+                    else
+                    {
+                        LogRel(("%s: Error fetching the statistics buffer, %Rrc\n", pThis->szInstance, rc));
+                        virtioCoreR3VirtqBufRelease(&pThis->Virtio, pVirtqBuf);
+                    }
+                }
+            }
+
+            /* Deflate first, the guest may be waiting for memory. */
+            fWorkDone |= virtioBalloonR3ProcessVirtq(pDevIns, pThis, pThisCC, VIRTIOBALLOON_DEFLATEQ_IDX);
+            fWorkDone |= virtioBalloonR3ProcessVirtq(pDevIns, pThis, pThisCC, VIRTIOBALLOON_INFLATEQ_IDX);
+            fWorkDone |= virtioBalloonR3ProcessVirtq(pDevIns, pThis, pThisCC, pThis->uReportingVirtq);
+            fWorkDone |= virtioBalloonR3ProcessVirtq(pDevIns, pThis, pThisCC, pThis->uStatsVirtq);
+            cMsWait = virtioBalloonR3StatsRequest(pDevIns, pThis, pThisCC);
+        }
+        ASMAtomicWriteBool(&pThis->fBusy, false);
+        if (ASMAtomicReadBool(&pThisCC->fQuiescing))
+            PDMDevHlpAsyncNotificationCompleted(pDevIns);
+
+        if (fWorkDone)
+            continue;
+
+        /* Atomic interlocks avoid missing alarm while going to sleep & notifier waking the awoken */
+        ASMAtomicWriteBool(&pThis->fSleeping, true);
+        bool fNotificationSent = ASMAtomicXchgBool(&pThis->fNotified, false);
+        if (!fNotificationSent)
+        {
+            Log6Func(("worker sleeping...\n"));
+            int rc = PDMDevHlpSUPSemEventWaitNoResume(pDevIns, pThis->hEvtProcess, cMsWait);
+            AssertLogRelMsgReturn(RT_SUCCESS(rc) || rc == VERR_INTERRUPTED || rc == VERR_TIMEOUT, ("%Rrc\n", rc), rc);
+            if (RT_UNLIKELY(pThread->enmState != PDMTHREADSTATE_RUNNING))
+                break;
+            ASMAtomicWriteBool(&pThis->fNotified, false);
+        }
+        ASMAtomicWriteBool(&pThis->fSleeping, false);
+    }
+    return VINF_SUCCESS;
+}
+
+
+/*********************************************************************************************************************************
+*   Virtio config.                                                                                                               *
+*********************************************************************************************************************************/
+
+/**
+ * @callback_method_impl{VIRTIOCORER3,pfnFeatureNegotiationComplete}
+ */
+static DECLCALLBACK(void) virtioBalloonR3FeatureNegotiationComplete(PVIRTIOCORE pVirtio, uint64_t fDriverFeatures, uint32_t fLegacy)
+{
+    PVIRTIOBALLOON pThis = RT_FROM_MEMBER(pVirtio, VIRTIOBALLOON, Virtio);
+    RT_NOREF(fLegacy);
+    virtioBalloonR3SetupVirtqs(pThis, fDriverFeatures);
+}
+
+/**
+ * @callback_method_impl{VIRTIOCORER3,pfnStatusChanged}
+ */
+static DECLCALLBACK(void) virtioBalloonR3StatusChanged(PVIRTIOCORE pVirtio, PVIRTIOCORECC pVirtioCC, uint32_t fVirtioReady)
+{
+    PVIRTIOBALLOON   pThis   = RT_FROM_MEMBER(pVirtio, VIRTIOBALLOON, Virtio);
+    PVIRTIOBALLOONCC pThisCC = RT_FROM_MEMBER(pVirtioCC, VIRTIOBALLOONCC, Virtio);
+
+    pThis->fVirtioReady = fVirtioReady;
+    if (fVirtioReady)
+    {
+        LogFunc(("VirtIO ready\n"));
+        virtioBalloonR3SetupVirtqs(pThis, virtioCoreGetNegotiatedFeatures(&pThis->Virtio));
+        pThis->fReportingBroken = false;
+        ASMAtomicWriteBool(&pThisCC->fQuiescing, false);
+        PDMDevHlpSUPSemEventSignal(pThis->Virtio.pDevInsR3, pThis->hEvtProcess);
+    }
+    else
+    {
+        LogFunc(("VirtIO is resetting\n"));
+        /* The driver forgot about the buffer, so do we. */
+        if (pThisCC->pStatsBuf)
+        {
+            virtioCoreR3VirtqBufRelease(&pThis->Virtio, pThisCC->pStatsBuf);
+            pThisCC->pStatsBuf = NULL;
+        }
+        pThis->fStatsBufHeld = false;
+        pThis->Config.uActual    = 0;
+        pThis->Config.uPoisonVal = 0;
+
+        /* The driver also forgot what is in the balloon and PGM won't drop it
+           for us as this isn't a VM reset.  Discard requests still in flight
+           and give the pages back before the guest gets to reuse them; we're
+           on an EMT and may own the IOM lock here, so this can't rendezvous
+           right away but has to be queued. */
+        ASMAtomicIncU32(&pThisCC->uResetGen);
+        if (pThis->cInflatedPages)
+        {
+            PPDMDEVINS pDevIns = pThis->Virtio.pDevInsR3;
+            int rc = PDMDevHlpVMReqCallNoWait(pDevIns, 0 /*idDstCpu*/, (PFNRT)virtioBalloonR3DeflateAllOnEmt, 1, pDevIns);
+            AssertRC(rc);
+        }
+    }
+}
+
+/**
+ * Worker for virtioBalloonR3DevCapWrite and virtioBalloonR3DevCapRead.
+ */
+static int virtioBalloonR3CfgAccessed(PVIRTIOBALLOON pThis, uint32_t uOffsetOfAccess, void *pv, uint32_t cb, bool fWrite)
+{
+    AssertReturn(pv && cb <= sizeof(uint32_t), fWrite ? VINF_SUCCESS : VINF_IOM_MMIO_UNUSED_00);
+
+    if (VIRTIO_DEV_CONFIG_SUBMATCH_MEMBER(    uNumPages,          VIRTIOBALLOON_CONFIG_T, uOffsetOfAccess))
+        VIRTIO_DEV_CONFIG_ACCESS_READONLY(    uNumPages,          VIRTIOBALLOON_CONFIG_T, uOffsetOfAccess, &pThis->Config);
+    else
+    if (VIRTIO_DEV_CONFIG_SUBMATCH_MEMBER(    uActual,            VIRTIOBALLOON_CONFIG_T, uOffsetOfAccess))
+        VIRTIO_DEV_CONFIG_ACCESS(             uActual,            VIRTIOBALLOON_CONFIG_T, uOffsetOfAccess, &pThis->Config);
+    else
+    if (VIRTIO_DEV_CONFIG_SUBMATCH_MEMBER(    uFreePageHintCmdId, VIRTIOBALLOON_CONFIG_T, uOffsetOfAccess))
+        VIRTIO_DEV_CONFIG_ACCESS_READONLY(    uFreePageHintCmdId, VIRTIOBALLOON_CONFIG_T, uOffsetOfAccess, &pThis->Config);
+    else
+    if (VIRTIO_DEV_CONFIG_SUBMATCH_MEMBER(    uPoisonVal,         VIRTIOBALLOON_CONFIG_T, uOffsetOfAccess))
+        VIRTIO_DEV_CONFIG_ACCESS(             uPoisonVal,         VIRTIOBALLOON_CONFIG_T, uOffsetOfAccess, &pThis->Config);
+    else
+    {
+        LogFunc(("Bad access by guest to virtio_balloon_config: off=%u (%#x), cb=%u\n", uOffsetOfAccess, uOffsetOfAccess, cb));
+        return fWrite ? VINF_SUCCESS : VINF_IOM_MMIO_UNUSED_00;
+    }
+    return VINF_SUCCESS;
+}
+
+/**
+ * @callback_method_impl{VIRTIOCORER3,pfnDevCapRead}
+ */
+static DECLCALLBACK(int) virtioBalloonR3DevCapRead(PPDMDEVINS pDevIns, uint32_t uOffset, void *pv, uint32_t cb)
+{
+    return virtioBalloonR3CfgAccessed(PDMDEVINS_2_DATA(pDevIns, PVIRTIOBALLOON), uOffset, pv, cb, false /*fWrite*/);
+}
+
+/**
+ * @callback_method_impl{VIRTIOCORER3,pfnDevCapWrite}
+ */
+static DECLCALLBACK(int) virtioBalloonR3DevCapWrite(PPDMDEVINS pDevIns, uint32_t uOffset, const void *pv, uint32_t cb)
+{
+    return virtioBalloonR3CfgAccessed(PDMDEVINS_2_DATA(pDevIns, PVIRTIOBALLOON), uOffset, (void *)pv, cb, true /*fWrite*/);
+}
+
+
+/*********************************************************************************************************************************
+*   Misc                                                                                                                         *
+*********************************************************************************************************************************/
+
+/**
+ * @callback_method_impl{FNDBGFHANDLERDEV, virtio-balloon debugger info callback.}
+ */
+static DECLCALLBACK(void) virtioBalloonR3Info(PPDMDEVINS pDevIns, PCDBGFINFOHLP pHlp, const char *pszArgs)
+{
+    PVIRTIOBALLOON pThis = PDMDEVINS_2_DATA(pDevIns, PVIRTIOBALLOON);
+    RT_NOREF(pszArgs);
+
+    uint64_t const fFeatures = virtioCoreGetNegotiatedFeatures(&pThis->Virtio);
+    pHlp->pfnPrintf(pHlp, "%s#%d: virtio-balloon ready=%RTbool\n", pDevIns->pReg->szName, pDevIns->iInstance,
+                    pThis->fVirtioReady != 0);
+    pHlp->pfnPrintf(pHlp, "  Target:     %u pages (%u MB)\n", pThis->Config.uNumPages, pThis->Config.uNumPages / (_1M / _4K));
+    pHlp->pfnPrintf(pHlp, "  Actual:     %u pages (guest), %u pages (host)\n", pThis->Config.uActual, pThis->cInflatedPages);
+    pHlp->pfnPrintf(pHlp, "  Features:   stats=%RTbool reporting=%RTbool deflate-on-oom=%RTbool poison=%RTbool (%#x)%s\n",
+                    RT_BOOL(fFeatures & VIRTIO_BALLOON_F_STATS_VQ), RT_BOOL(fFeatures & VIRTIO_BALLOON_F_REPORTING),
+                    RT_BOOL(fFeatures & VIRTIO_BALLOON_F_DEFLATE_ON_OOM), RT_BOOL(fFeatures & VIRTIO_BALLOON_F_PAGE_POISON),
+                    pThis->Config.uPoisonVal, pThis->fReportingBroken ? " reporting-disabled" : "");
+    if (fFeatures & VIRTIO_BALLOON_F_STATS_VQ)
+        for (unsigned i = 0; i < RT_ELEMENTS(g_aVirtioBalloonStatNames); i++)
+            pHlp->pfnPrintf(pHlp, "  %-14s %RU64\n", g_aVirtioBalloonStatNames[i].pszName, pThis->au64GuestStats[i]);
+}
+
+
+/*********************************************************************************************************************************
+*   Saved state                                                                                                                  *
+*********************************************************************************************************************************/
+
+/**
+ * @callback_method_impl{FNSSMDEVLOADEXEC}
+ */
+static DECLCALLBACK(int) virtioBalloonR3LoadExec(PPDMDEVINS pDevIns, PSSMHANDLE pSSM, uint32_t uVersion, uint32_t uPass)
+{
+    PVIRTIOBALLOON   pThis   = PDMDEVINS_2_DATA(pDevIns, PVIRTIOBALLOON);
+    PVIRTIOBALLOONCC pThisCC = PDMDEVINS_2_DATA_CC(pDevIns, PVIRTIOBALLOONCC);
+    PCPDMDEVHLPR3    pHlp    = pDevIns->pHlpR3;
+
+    AssertReturn(uPass == SSM_PASS_FINAL, VERR_SSM_UNEXPECTED_PASS);
+    /* Without the list of inflated pages we would not know which pages the
+       guest may deflate, refuse rather than corrupting guest memory later. */
+    AssertLogRelMsgReturn(uVersion == VIRTIOBALLOON_SAVED_STATE_VERSION,
+                          ("uVersion=%u\n", uVersion), VERR_SSM_UNSUPPORTED_DATA_UNIT_VERSION);
+
+    pHlp->pfnSSMGetU32(pSSM,  &pThis->Config.uNumPages);
+    pHlp->pfnSSMGetU32(pSSM,  &pThis->Config.uActual);
+    pHlp->pfnSSMGetU32(pSSM,  &pThis->Config.uPoisonVal);
+    pHlp->pfnSSMGetU32(pSSM,  &pThis->cInflatedPages);
+    pHlp->pfnSSMGetU32(pSSM,  &pThis->fVirtioReady);
+    pHlp->pfnSSMGetBool(pSSM, &pThis->fStatsBufHeld);
+    pHlp->pfnSSMGetU16(pSSM,  &pThis->uStatsHeadIdx);
+    for (unsigned i = 0; i < RT_ELEMENTS(pThis->au64GuestStats); i++)
+        pHlp->pfnSSMGetU64(pSSM, &pThis->au64GuestStats[i]);
+
+    /* The inflated pages, terminated by UINT32_MAX. */
+    ASMMemZero32(pThisCC->pbmInflated, pThisCC->cInflatedBits / 8);
+    uint32_t cPages = 0;
+    for (;;)
+    {
+        uint32_t iPfn = UINT32_MAX;
+        int rc = pHlp->pfnSSMGetU32(pSSM, &iPfn);
+        AssertRCReturn(rc, rc);
+        if (iPfn == UINT32_MAX)
+            break;
+        if (iPfn >= pThisCC->cInflatedBits || ASMBitTestAndSet(pThisCC->pbmInflated, (int32_t)iPfn))
+            return pHlp->pfnSSMSetLoadError(pSSM, VERR_SSM_DATA_UNIT_FORMAT_CHANGED, RT_SRC_POS,
+                                            N_("Bad or duplicate inflated page %#x (RAM size changed?)"), iPfn);
+        cPages++;
+    }
+    if (cPages != pThis->cInflatedPages)
+        return pHlp->pfnSSMSetLoadError(pSSM, VERR_SSM_DATA_UNIT_FORMAT_CHANGED, RT_SRC_POS,
+                                        N_("Inflated page count mismatch: %u, expected %u"), cPages, pThis->cInflatedPages);
+
+    int rc = virtioCoreR3ModernDeviceLoadExec(&pThis->Virtio, pDevIns->pHlpR3, pSSM,
+                                              uVersion, VIRTIOBALLOON_SAVED_STATE_VERSION, VIRTIOBALLOON_VIRTQ_CNT);
+    AssertRCReturn(rc, rc);
+
+    virtioBalloonR3SetupVirtqs(pThis, virtioCoreGetNegotiatedFeatures(&pThis->Virtio));
+    pThis->nsStatsReceived = PDMDevHlpTMTimeVirtGetNano(pDevIns);
+
+    /* Nudge the worker so it re-fetches the statistics buffer and checks the queues. */
+    return PDMDevHlpSUPSemEventSignal(pDevIns, pThis->hEvtProcess);
+}
+
+/**
+ * @callback_method_impl{FNSSMDEVSAVEEXEC}
+ */
+static DECLCALLBACK(int) virtioBalloonR3SaveExec(PPDMDEVINS pDevIns, PSSMHANDLE pSSM)
+{
+    PVIRTIOBALLOON   pThis   = PDMDEVINS_2_DATA(pDevIns, PVIRTIOBALLOON);
+    PVIRTIOBALLOONCC pThisCC = PDMDEVINS_2_DATA_CC(pDevIns, PVIRTIOBALLOONCC);
+    PCPDMDEVHLPR3    pHlp    = pDevIns->pHlpR3;
+
+    AssertMsg(!pThis->fBusy, ("The worker is still processing a buffer\n"));
+
+    pHlp->pfnSSMPutU32(pSSM,  pThis->Config.uNumPages);
+    pHlp->pfnSSMPutU32(pSSM,  pThis->Config.uActual);
+    pHlp->pfnSSMPutU32(pSSM,  pThis->Config.uPoisonVal);
+    pHlp->pfnSSMPutU32(pSSM,  pThis->cInflatedPages);
+    pHlp->pfnSSMPutU32(pSSM,  pThis->fVirtioReady);
+    pHlp->pfnSSMPutBool(pSSM, pThis->fStatsBufHeld);
+    pHlp->pfnSSMPutU16(pSSM,  pThis->uStatsHeadIdx);
+    for (unsigned i = 0; i < RT_ELEMENTS(pThis->au64GuestStats); i++)
+        pHlp->pfnSSMPutU64(pSSM, pThis->au64GuestStats[i]);
+
+    /* The inflated pages, terminated by UINT32_MAX. */
+    for (int32_t iPfn = ASMBitFirstSet(pThisCC->pbmInflated, pThisCC->cInflatedBits);
+         iPfn >= 0;
+         iPfn = ASMBitNextSet(pThisCC->pbmInflated, pThisCC->cInflatedBits, iPfn))
+        pHlp->pfnSSMPutU32(pSSM, (uint32_t)iPfn);
+    pHlp->pfnSSMPutU32(pSSM, UINT32_MAX);
+
+    return virtioCoreR3SaveExec(&pThis->Virtio, pDevIns->pHlpR3, pSSM, VIRTIOBALLOON_SAVED_STATE_VERSION, VIRTIOBALLOON_VIRTQ_CNT);
+}
+
+
+/*********************************************************************************************************************************
+*   Device interface.                                                                                                            *
+*********************************************************************************************************************************/
+
+/**
+ * @callback_method_impl{FNPDMDEVASYNCNOTIFY}
+ */
+static DECLCALLBACK(bool) virtioBalloonR3DeviceQuiesced(PPDMDEVINS pDevIns)
+{
+    PVIRTIOBALLOON   pThis   = PDMDEVINS_2_DATA(pDevIns, PVIRTIOBALLOON);
+    PVIRTIOBALLOONCC pThisCC = PDMDEVINS_2_DATA_CC(pDevIns, PVIRTIOBALLOONCC);
+
+    if (ASMAtomicReadBool(&pThis->fBusy))
+        return false;
+
+    LogFunc(("Device quiesced: %s\n", virtioCoreGetStateChangeText(pThisCC->enmQuiescingFor)));
+    virtioCoreR3VmStateChanged(&pThis->Virtio, pThisCC->enmQuiescingFor);
+    return true;
+}
+
+/**
+ * Worker for virtioBalloonR3Reset() and virtioBalloonR3SuspendOrPowerOff().
+ */
+static void virtioBalloonR3QuiesceDevice(PPDMDEVINS pDevIns, VIRTIOVMSTATECHANGED enmQuiescingFor)
+{
+    PVIRTIOBALLOON   pThis   = PDMDEVINS_2_DATA(pDevIns, PVIRTIOBALLOON);
+    PVIRTIOBALLOONCC pThisCC = PDMDEVINS_2_DATA_CC(pDevIns, PVIRTIOBALLOONCC);
+
+    /* Prevent the worker from pulling more buffers off the virtqs. */
+    ASMAtomicWriteBool(&pThisCC->fQuiescing, true);
+    pThisCC->enmQuiescingFor = enmQuiescingFor;
+
+    PDMDevHlpSetAsyncNotification(pDevIns, virtioBalloonR3DeviceQuiesced);
+
+    /* If already quiesced invoke async callback.  */
+    if (!ASMAtomicReadBool(&pThis->fBusy))
+        PDMDevHlpAsyncNotificationCompleted(pDevIns);
+}
+
+/**
+ * @interface_method_impl{PDMDEVREGR3,pfnReset}
+ */
+static DECLCALLBACK(void) virtioBalloonR3Reset(PPDMDEVINS pDevIns)
+{
+    PVIRTIOBALLOON   pThis   = PDMDEVINS_2_DATA(pDevIns, PVIRTIOBALLOON);
+    PVIRTIOBALLOONCC pThisCC = PDMDEVINS_2_DATA_CC(pDevIns, PVIRTIOBALLOONCC);
+    LogFunc(("\n"));
+
+    /* PGM drops the whole balloon on reset, so just forget about the pages and
+       discard requests still in flight.  All EMTs are in the reset rendezvous,
+       so nothing is using the bitmap. */
+    ASMAtomicIncU32(&pThisCC->uResetGen);
+    ASMMemZero32(pThisCC->pbmInflated, pThisCC->cInflatedBits / 8);
+    pThis->cInflatedPages = 0;
+    virtioBalloonR3QuiesceDevice(pDevIns, kvirtIoVmStateChangedReset);
+}
+
+/**
+ * @interface_method_impl{PDMDEVREGR3,pfnPowerOff}
+ */
+static DECLCALLBACK(void) virtioBalloonR3PowerOff(PPDMDEVINS pDevIns)
+{
+    LogFunc(("\n"));
+    virtioBalloonR3QuiesceDevice(pDevIns, kvirtIoVmStateChangedPowerOff);
+}
+
+/**
+ * @interface_method_impl{PDMDEVREGR3,pfnSuspend}
+ */
+static DECLCALLBACK(void) virtioBalloonR3Suspend(PPDMDEVINS pDevIns)
+{
+    LogFunc(("\n"));
+    virtioBalloonR3QuiesceDevice(pDevIns, kvirtIoVmStateChangedSuspend);
+}
+
+/**
+ * @interface_method_impl{PDMDEVREGR3,pfnResume}
+ */
+static DECLCALLBACK(void) virtioBalloonR3Resume(PPDMDEVINS pDevIns)
+{
+    PVIRTIOBALLOON   pThis   = PDMDEVINS_2_DATA(pDevIns, PVIRTIOBALLOON);
+    PVIRTIOBALLOONCC pThisCC = PDMDEVINS_2_DATA_CC(pDevIns, PVIRTIOBALLOONCC);
+    LogFunc(("\n"));
+
+    ASMAtomicWriteBool(&pThisCC->fQuiescing, false);
+
+    /* Wake the worker so it re-checks the queues. */
+    int rc = PDMDevHlpSUPSemEventSignal(pDevIns, pThis->hEvtProcess);
+    AssertRC(rc);
+
+    /* Ensure guest is working the queues too. */
+    virtioCoreR3VmStateChanged(&pThis->Virtio, kvirtIoVmStateChangedResume);
+}
+
+/**
+ * @interface_method_impl{PDMDEVREGR3,pfnDestruct}
+ */
+static DECLCALLBACK(int) virtioBalloonR3Destruct(PPDMDEVINS pDevIns)
+{
+    PDMDEV_CHECK_VERSIONS_RETURN_QUIET(pDevIns);
+    PVIRTIOBALLOON   pThis   = PDMDEVINS_2_DATA(pDevIns, PVIRTIOBALLOON);
+    PVIRTIOBALLOONCC pThisCC = PDMDEVINS_2_DATA_CC(pDevIns, PVIRTIOBALLOONCC);
+
+    if (pThisCC->pThread)
+    {
+        int rcThread;
+        int rc = PDMDevHlpThreadDestroy(pDevIns, pThisCC->pThread, &rcThread);
+        if (RT_FAILURE(rc) || RT_FAILURE(rcThread))
+            AssertMsgFailed(("%s Failed to destroy thread rc=%Rrc rcThread=%Rrc\n", __FUNCTION__, rc, rcThread));
+        pThisCC->pThread = NULL;
+    }
+
+    if (pThis->hEvtProcess != NIL_SUPSEMEVENT)
+    {
+        PDMDevHlpSUPSemEventClose(pDevIns, pThis->hEvtProcess);
+        pThis->hEvtProcess = NIL_SUPSEMEVENT;
+    }
+
+    if (pThisCC->pStatsBuf)
+    {
+        virtioCoreR3VirtqBufRelease(&pThis->Virtio, pThisCC->pStatsBuf);
+        pThisCC->pStatsBuf = NULL;
+    }
+
+    /* The device can't be unplugged, so we only get here when the VM is
+       destroyed.  The EMTs are gone and can't rendezvous any more, PGM and
+       GMM release the ballooned pages together with the rest of the RAM. */
+    if (pThisCC->pbmInflated)
+    {
+        if (pThis->cInflatedPages)
+            LogRel(("%s: %u pages still in the balloon, left to PGM\n", pThis->szInstance, pThis->cInflatedPages));
+        RTMemFree(pThisCC->pbmInflated);
+        pThisCC->pbmInflated   = NULL;
+        pThisCC->cInflatedBits = 0;
+    }
+
+    virtioCoreR3Term(pDevIns, &pThis->Virtio, &pThisCC->Virtio);
+    return VINF_SUCCESS;
+}
+
+/**
+ * @interface_method_impl{PDMDEVREGR3,pfnConstruct}
+ */
+static DECLCALLBACK(int) virtioBalloonR3Construct(PPDMDEVINS pDevIns, int iInstance, PCFGMNODE pCfg)
+{
+    PDMDEV_CHECK_VERSIONS_RETURN(pDevIns);
+    PVIRTIOBALLOON   pThis   = PDMDEVINS_2_DATA(pDevIns, PVIRTIOBALLOON);
+    PVIRTIOBALLOONCC pThisCC = PDMDEVINS_2_DATA_CC(pDevIns, PVIRTIOBALLOONCC);
+    PCPDMDEVHLPR3    pHlp    = pDevIns->pHlpR3;
+
+    /*
+     * Quick initialization of the state data, making sure that the destructor always works.
+     */
+    RTStrPrintf(pThis->szInstance, sizeof(pThis->szInstance), "VIRTIOBALLOON%d", iInstance);
+    pThis->hEvtProcess     = NIL_SUPSEMEVENT;
+    pThis->uStatsVirtq     = VIRTIOBALLOON_VIRTQ_NONE;
+    pThis->uReportingVirtq = VIRTIOBALLOON_VIRTQ_NONE;
+
+    /*
+     * Validate and read configuration.
+     */
+    PDMDEV_VALIDATE_CONFIG_RETURN(pDevIns, "TargetMB"
+                                           "|FreePageReporting"
+                                           "|StatsIntervalMs"
+                                           "|MmioBase"
+                                           "|Irq", "");
+
+    /** @cfgm{/Devices/virtio-balloon/0/Config/TargetMB, uint32_t, 0}
+     * The balloon size (in MB) requested from the guest at startup. */
+    uint32_t cMbTarget = 0;
+    int rc = pHlp->pfnCFGMQueryU32Def(pCfg, "TargetMB", &cMbTarget, 0);
+    if (RT_FAILURE(rc))
+        return PDMDEV_SET_ERROR(pDevIns, rc, N_("virtio-balloon configuration error: failed to read TargetMB as integer"));
+    if (cMbTarget >= UINT32_MAX / (_1M >> VIRTIO_BALLOON_PFN_SHIFT))
+        return PDMDevHlpVMSetError(pDevIns, VERR_OUT_OF_RANGE, RT_SRC_POS,
+                                   N_("virtio-balloon configuration error: TargetMB=%u is out of range"), cMbTarget);
+    pThis->Config.uNumPages = cMbTarget * (_1M >> VIRTIO_BALLOON_PFN_SHIFT);
+
+    /** @cfgm{/Devices/virtio-balloon/0/Config/FreePageReporting, bool, true}
+     * Whether to offer free page reporting, i.e. let the guest return its
+     * free memory to the host as it goes along. */
+    rc = pHlp->pfnCFGMQueryBoolDef(pCfg, "FreePageReporting", &pThis->fOfferReporting, true);
+    if (RT_FAILURE(rc))
+        return PDMDEV_SET_ERROR(pDevIns, rc, N_("virtio-balloon configuration error: failed to read FreePageReporting as boolean"));
+
+    /** @cfgm{/Devices/virtio-balloon/0/Config/StatsIntervalMs, uint32_t, 10000}
+     * How often to ask the guest for updated memory statistics, 0 to only
+     * take the ones the guest provides on its own. */
+    rc = pHlp->pfnCFGMQueryU32Def(pCfg, "StatsIntervalMs", &pThis->cMsStatsInterval, 10000);
+    if (RT_FAILURE(rc))
+        return PDMDEV_SET_ERROR(pDevIns, rc, N_("virtio-balloon configuration error: failed to read StatsIntervalMs as integer"));
+
+    LogRel(("%s: TargetMB=%u FreePageReporting=%RTbool StatsIntervalMs=%u\n",
+            pThis->szInstance, cMbTarget, pThis->fOfferReporting, pThis->cMsStatsInterval));
+
+    /*
+     * The bitmap of inflated pages covers all of guest RAM, the part above 4GB
+     * starts at 4GB.
+     */
+    uint64_t const cbRamAbove4GB = PDMDevHlpMMPhysGetRamSizeAbove4GB(pDevIns);
+    uint64_t const GCPhysRamEnd  = cbRamAbove4GB ? _4G + cbRamAbove4GB : PDMDevHlpMMPhysGetRamSizeBelow4GB(pDevIns);
+    uint64_t const cRamPages     = RT_ALIGN_64(GCPhysRamEnd >> VIRTIO_BALLOON_PFN_SHIFT, 64);
+    if (cRamPages > (uint64_t)INT32_MAX + 1)
+        return PDMDevHlpVMSetError(pDevIns, VERR_OUT_OF_RANGE, RT_SRC_POS,
+                                   N_("virtio-balloon: Too much guest RAM (%RU64 bytes)"), GCPhysRamEnd);
+    pThisCC->cInflatedBits = (uint32_t)cRamPages;
+    pThisCC->pbmInflated   = (uint32_t *)RTMemAllocZ(cRamPages / 8);
+    if (!pThisCC->pbmInflated)
+        return PDMDevHlpVMSetError(pDevIns, VERR_NO_MEMORY, RT_SRC_POS, N_("virtio-balloon: Out of memory"));
+
+    /*
+     * Do core virtio initialization.
+     */
+    pThisCC->Virtio.pfnFeatureNegotiationComplete = virtioBalloonR3FeatureNegotiationComplete;
+    pThisCC->Virtio.pfnVirtqNotified              = virtioBalloonNotified;
+    pThisCC->Virtio.pfnStatusChanged              = virtioBalloonR3StatusChanged;
+    pThisCC->Virtio.pfnDevCapRead                 = virtioBalloonR3DevCapRead;
+    pThisCC->Virtio.pfnDevCapWrite                = virtioBalloonR3DevCapWrite;
+
+    VIRTIOPCIPARAMS VirtioPciParams;
+    VirtioPciParams.uDeviceId                     = PCI_DEVICE_ID_VIRTIOBALLOON;
+    VirtioPciParams.uClassBase                    = PCI_CLASS_BASE_OTHER;
+    VirtioPciParams.uClassSub                     = PCI_CLASS_SUB_OTHER;
+    VirtioPciParams.uClassProg                    = PCI_CLASS_PROG_UNSPECIFIED;
+    VirtioPciParams.uSubsystemId                  = PCI_DEVICE_ID_VIRTIOBALLOON;  /* VirtIO 1.0 spec allows PCI Device ID here */
+    VirtioPciParams.uInterruptLine                = 0x00;
+    VirtioPciParams.uInterruptPin                 = 0x01;
+    VirtioPciParams.uDeviceType                   = VIRTIO_DEVICE_TYPE_MEMORY_BALLOONING_TRAD;
+
+    uint64_t const fFeatures = VIRTIOBALLOON_FEATURES_BASE | (pThis->fOfferReporting ? VIRTIO_BALLOON_F_REPORTING : 0);
+    rc = virtioCoreR3Init(pDevIns, &pThis->Virtio, &pThisCC->Virtio, &VirtioPciParams, pThis->szInstance,
+                          fFeatures, 0 /*fOfferLegacy*/, &pThis->Config /*pvDevSpecificCap*/, sizeof(pThis->Config));
+    if (RT_FAILURE(rc))
+        return PDMDEV_SET_ERROR(pDevIns, rc, N_("virtio-balloon: failed to initialize VirtIO"));
+
+    /* Until the guest tells us otherwise all the queues are there. */
+    virtioBalloonR3SetupVirtqs(pThis, fFeatures);
+
+    /*
+     * The worker thread.
+     */
+    rc = PDMDevHlpSUPSemEventCreate(pDevIns, &pThis->hEvtProcess);
+    if (RT_FAILURE(rc))
+        return PDMDevHlpVMSetError(pDevIns, rc, RT_SRC_POS, N_("virtio-balloon: Failed to create SUP event semaphore"));
+
+    rc = PDMDevHlpThreadCreate(pDevIns, &pThisCC->pThread, NULL, virtioBalloonR3WorkerThread,
+                               virtioBalloonR3WorkerWakeUp, 0, RTTHREADTYPE_IO, pThis->szInstance);
+    if (RT_FAILURE(rc))
+        return PDMDevHlpVMSetError(pDevIns, rc, RT_SRC_POS, N_("virtio-balloon: Failed to create worker thread"));
+
+    /*
+     * Register saved state.
+     */
+    rc = PDMDevHlpSSMRegister(pDevIns, VIRTIOBALLOON_SAVED_STATE_VERSION, sizeof(*pThis),
+                              virtioBalloonR3SaveExec, virtioBalloonR3LoadExec);
+    AssertRCReturn(rc, rc);
+
+    /*
+     * Statistics.
+     */
+    PDMDevHlpSTAMRegister(pDevIns, &pThis->StatInflatedPages, STAMTYPE_COUNTER, "InflatedPages", STAMUNIT_PAGES,
+                          "Pages added to the balloon");
+    PDMDevHlpSTAMRegister(pDevIns, &pThis->StatDeflatedPages, STAMTYPE_COUNTER, "DeflatedPages", STAMUNIT_PAGES,
+                          "Pages removed from the balloon");
+    PDMDevHlpSTAMRegister(pDevIns, &pThis->StatReports,       STAMTYPE_COUNTER, "Reports",       STAMUNIT_OCCURENCES,
+                          "Free page reports received");
+    PDMDevHlpSTAMRegister(pDevIns, &pThis->StatReportedPages, STAMTYPE_COUNTER, "ReportedPages", STAMUNIT_PAGES,
+                          "Pages reported free by the guest");
+    PDMDevHlpSTAMRegister(pDevIns, &pThis->StatFreedPages,    STAMTYPE_COUNTER, "FreedPages",    STAMUNIT_PAGES,
+                          "Reported pages actually returned to the host");
+    PDMDevHlpSTAMRegister(pDevIns, &pThis->StatStatsUpdates,  STAMTYPE_COUNTER, "StatsUpdates",  STAMUNIT_OCCURENCES,
+                          "Guest memory statistics updates received");
+    PDMDevHlpSTAMRegister(pDevIns, &pThis->StatReport,        STAMTYPE_PROFILE, "Report",        STAMUNIT_TICKS_PER_CALL,
+                          "Profiling free page report processing");
+    for (unsigned i = 0; i < RT_ELEMENTS(g_aVirtioBalloonStatNames); i++)
+        PDMDevHlpSTAMRegisterF(pDevIns, &pThis->au64GuestStats[i], STAMTYPE_U64, STAMVISIBILITY_ALWAYS,
+                               g_aVirtioBalloonStatNames[i].enmUnit, g_aVirtioBalloonStatNames[i].pszDesc,
+                               "Guest/%s", g_aVirtioBalloonStatNames[i].pszName);
+
+    /*
+     * Register the debugger info callback (ignore errors).
+     */
+    char szTmp[128];
+    RTStrPrintf(szTmp, sizeof(szTmp), "%s%u", pDevIns->pReg->szName, pDevIns->iInstance);
+    PDMDevHlpDBGFInfoRegister(pDevIns, szTmp, "virtio-balloon info", virtioBalloonR3Info);
+
+    return VINF_SUCCESS;
+}
+
+#else  /* !IN_RING3 */
+
+/**
+ * @callback_method_impl{PDMDEVREGR0,pfnConstruct}
+ */
+static DECLCALLBACK(int) virtioBalloonRZConstruct(PPDMDEVINS pDevIns)
+{
+    PDMDEV_CHECK_VERSIONS_RETURN(pDevIns);
+
+    PVIRTIOBALLOON   pThis   = PDMDEVINS_2_DATA(pDevIns, PVIRTIOBALLOON);
+    PVIRTIOBALLOONCC pThisCC = PDMDEVINS_2_DATA_CC(pDevIns, PVIRTIOBALLOONCC);
+
+    pThisCC->Virtio.pfnVirtqNotified = virtioBalloonNotified;
+    return virtioCoreRZInit(pDevIns, &pThis->Virtio);
+}
+
+#endif /* !IN_RING3 */
+
+
+/**
+ * The device registration structure.
+ */
+const PDMDEVREG g_DeviceVirtioBalloon =
+{
+    /* .u32Version = */             PDM_DEVREG_VERSION,
+    /* .uReserved0 = */             0,
+    /* .szName = */                 "virtio-balloon",
+    /* .fFlags = */                 PDM_DEVREG_FLAGS_DEFAULT_BITS | PDM_DEVREG_FLAGS_NEW_STYLE
+                                    | PDM_DEVREG_FLAGS_FIRST_SUSPEND_NOTIFICATION
+                                    | PDM_DEVREG_FLAGS_FIRST_POWEROFF_NOTIFICATION,
+    /* .fClass = */                 PDM_DEVREG_CLASS_MISC,
+    /* .cMaxInstances = */          1,
+    /* .uSharedVersion = */         42,
+    /* .cbInstanceShared = */       sizeof(VIRTIOBALLOON),
+    /* .cbInstanceCC = */           sizeof(VIRTIOBALLOONCC),
+    /* .cbInstanceRC = */           sizeof(VIRTIOBALLOONRC),
+    /* .cMaxPciDevices = */         1,
+    /* .cMaxMsixVectors = */        VBOX_MSIX_MAX_ENTRIES,
+    /* .pszDescription = */         "Virtio memory balloon with free page reporting.\n",
+#if defined(IN_RING3)
+    /* .pszRCMod = */               "",
+    /* .pszR0Mod = */               "",
+    /* .pfnConstruct = */           virtioBalloonR3Construct,
+    /* .pfnDestruct = */            virtioBalloonR3Destruct,
+    /* .pfnRelocate = */            NULL,
+    /* .pfnMemSetup = */            NULL,
+    /* .pfnPowerOn = */             NULL,
+    /* .pfnReset = */               virtioBalloonR3Reset,
+    /* .pfnSuspend = */             virtioBalloonR3Suspend,
+    /* .pfnResume = */              virtioBalloonR3Resume,
+    /* .pfnAttach = */              NULL,
+    /* .pfnDetach = */              NULL,
+    /* .pfnQueryInterface = */      NULL,
+    /* .pfnInitComplete = */        NULL,
+    /* .pfnPowerOff = */            virtioBalloonR3PowerOff,
+    /* .pfnSoftReset = */           NULL,
+    /* .pfnReserved0 = */           NULL,
+    /* .pfnReserved1 = */           NULL,
+    /* .pfnReserved2 = */           NULL,
+    /* .pfnReserved3 = */           NULL,
+    /* .pfnReserved4 = */           NULL,
+    /* .pfnReserved5 = */           NULL,
+    /* .pfnReserved6 = */           NULL,
+    /* .pfnReserved7 = */           NULL,
+#elif defined(IN_RING0)
+    /* .pfnEarlyConstruct = */      NULL,
+    /* .pfnConstruct = */           virtioBalloonRZConstruct,
+    /* .pfnDestruct = */            NULL,
+    /* .pfnFinalDestruct = */       NULL,
+    /* .pfnRequest = */             NULL,
+    /* .pfnReserved0 = */           NULL,
+    /* .pfnReserved1 = */           NULL,
+    /* .pfnReserved2 = */           NULL,
+    /* .pfnReserved3 = */           NULL,
+    /* .pfnReserved4 = */           NULL,
+    /* .pfnReserved5 = */           NULL,
+    /* .pfnReserved6 = */           NULL,
+    /* .pfnReserved7 = */           NULL,
+#elif defined(IN_RC)
+    /* .pfnConstruct = */           virtioBalloonRZConstruct,
+    /* .pfnReserved0 = */           NULL,
+    /* .pfnReserved1 = */           NULL,
+    /* .pfnReserved2 = */           NULL,
+    /* .pfnReserved3 = */           NULL,
+    /* .pfnReserved4 = */           NULL,
+    /* .pfnReserved5 = */           NULL,
+    /* .pfnReserved6 = */           NULL,
+    /* .pfnReserved7 = */           NULL,
+#else
+# error "Not in IN_RING3, IN_RING0 or IN_RC!"
+#endif
+    /* .u32VersionEnd = */          PDM_DEVREG_VERSION
+};
+
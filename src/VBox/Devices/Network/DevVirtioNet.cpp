@@ -2112,17 +2112,27 @@ static DECLCALLBACK(int) virtioNetR3NetworkDown_ReceiveGso(PPDMINETWORKDOWN pInt
         rxPktHdr.uGsoSize      = pGso->cbMaxSeg;
         rxPktHdr.uChksumStart  = pGso->offHdr2;
 
+        /*
+         * The guest must have negotiated the matching receive offload feature,
+         * otherwise let the caller segment the frame (see DrvIntNet, DrvNetLro).
+         */
         switch (pGso->u8Type)
         {
             case PDMNETWORKGSOTYPE_IPV4_TCP:
+                if (FEATURE_DISABLED(GUEST_TSO4))
+                    return VERR_NOT_SUPPORTED;
                 rxPktHdr.uGsoType = VIRTIONET_HDR_GSO_TCPV4;
                 rxPktHdr.uChksumOffset = RT_OFFSETOF(RTNETTCP, th_sum);
                 break;
             case PDMNETWORKGSOTYPE_IPV6_TCP:
+                if (FEATURE_DISABLED(GUEST_TSO6))
+                    return VERR_NOT_SUPPORTED;
                 rxPktHdr.uGsoType = VIRTIONET_HDR_GSO_TCPV6;
                 rxPktHdr.uChksumOffset = RT_OFFSETOF(RTNETTCP, th_sum);
                 break;
             case PDMNETWORKGSOTYPE_IPV4_UDP:
+                if (FEATURE_DISABLED(GUEST_UFO))
+                    return VERR_NOT_SUPPORTED;
                 rxPktHdr.uGsoType = VIRTIONET_HDR_GSO_UDP;
                 rxPktHdr.uChksumOffset = RT_OFFSETOF(RTNETUDP, uh_sum);
                 break;
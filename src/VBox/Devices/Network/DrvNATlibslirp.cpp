@@ -66,6 +66,7 @@
 #include <iprt/cidr.h>
 #include <iprt/file.h>
 #include <iprt/mem.h>
+#include <iprt/memcache.h>
 #include <iprt/net.h>
 #include <iprt/pipe.h>
 #include <iprt/string.h>
@@ -92,6 +93,9 @@
 *********************************************************************************************************************************/
 #define DRVNAT_MAXFRAMESIZE (16 * 1024)
 #define DRVNAT_DEFAULT_TIMEOUT (3600*1000)
+/** Frame size covered by the RX and TX buffer caches.  This fits the frames
+ * of the default MTU, bigger ones (jumbo, GSO) are allocated from the heap. */
+#define DRVNAT_CACHED_FRAMESIZE _2K
 
 /**
  * @todo: This is a bad hack to prevent freezing the guest during high network
@@ -184,6 +188,43 @@ typedef struct SlirpState
 } SlirpState;
 typedef SlirpState *pSlirpState;
 
+/**
+ * A frame from libslirp queued for delivery to the guest.
+ */
+typedef struct DRVNATRXPKT
+{
+    /** Size of the frame. */
+    size_t                  cbFrame;
+    /** Set if allocated from DRVNAT::hRecvPktCache, clear if from the heap. */
+    bool                    fCached;
+    /** The frame data. */
+    RT_FLEXIBLE_ARRAY_EXTENSION
+    uint8_t                 abFrame[RT_FLEXIBLE_ARRAY];
+} DRVNATRXPKT;
+/** Pointer to a frame queued for the guest. */
+typedef DRVNATRXPKT *PDRVNATRXPKT;
+
+/**
+ * A transmit buffer handed to the device by drvNATNetworkUp_AllocBuf.
+ *
+ * The S/G descriptor, the GSO context and the frame live in a single
+ * allocation so that libslirp can be fed straight from the S/G segment.
+ */
+typedef struct DRVNATTXBUF
+{
+    /** The S/G buffer, must be first. */
+    PDMSCATTERGATHER        SgBuf;
+    /** The GSO context, SgBuf.pvUser points here for GSO frames. */
+    PDMNETWORKGSO           Gso;
+    /** Set if allocated from DRVNAT::hXmitBufCache, clear if from the heap. */
+    bool                    fCached;
+    /** The frame data. */
+    RT_FLEXIBLE_ARRAY_EXTENSION
+    uint8_t                 abFrame[RT_FLEXIBLE_ARRAY];
+} DRVNATTXBUF;
+/** Pointer to a transmit buffer. */
+typedef DRVNATTXBUF *PDRVNATTXBUF;
+
 /**
  * NAT network transport driver instance data.
  *
@@ -251,6 +292,11 @@ typedef struct DRVNAT
     /** Transmit lock taken by BeginXmit and released by EndXmit. */
     RTCRITSECT              XmitLock;
 
+    /** Cache of DRVNATRXPKT buffers for frames going to the guest. */
+    RTMEMCACHE              hRecvPktCache;
+    /** Cache of DRVNATTXBUF buffers for frames coming from the guest. */
+    RTMEMCACHE              hXmitBufCache;
+
 #ifdef RT_OS_DARWIN
     /* Handle of the DNS watcher runloop source. */
     CFRunLoopSourceRef      hRunLoopSrcDnsWatcher;
@@ -312,16 +358,66 @@ static DECLCALLBACK(int) drvNATRecvWakeup(PPDMDRVINS pDrvIns, PPDMTHREAD pThread
     return VINF_SUCCESS;
 }
 
+/**
+ * Allocates a buffer for a frame going to the guest.
+ *
+ * @returns Pointer to the buffer, NULL if out of memory.
+ * @param   pThis   Pointer to the NAT instance.
+ * @param   cbFrame Size of the frame.
+ *
+ * @thread  NAT
+ */
+static PDRVNATRXPKT drvNATRecvPktAlloc(PDRVNAT pThis, size_t cbFrame)
+{
+    PDRVNATRXPKT pPkt;
+    if (cbFrame <= DRVNAT_CACHED_FRAMESIZE)
+    {
+        pPkt = (PDRVNATRXPKT)RTMemCacheAlloc(pThis->hRecvPktCache);
+        if (pPkt)
+        {
+            pPkt->fCached = true;
+            STAM_COUNTER_INC(&pThis->StatNATRecvCached);
+        }
+    }
+    else
+    {
+        pPkt = (PDRVNATRXPKT)RTMemAlloc(RT_UOFFSETOF_DYN(DRVNATRXPKT, abFrame[cbFrame]));
+        if (pPkt)
+        {
+            pPkt->fCached = false;
+            STAM_COUNTER_INC(&pThis->StatNATRecvHeap);
+        }
+    }
+    if (pPkt)
+        pPkt->cbFrame = cbFrame;
+    return pPkt;
+}
+
+/**
+ * Frees a buffer allocated by drvNATRecvPktAlloc.
+ *
+ * @param   pThis   Pointer to the NAT instance.
+ * @param   pPkt    The buffer to free.
+ *
+ * @thread  NATRX
+ */
+static void drvNATRecvPktFree(PDRVNAT pThis, PDRVNATRXPKT pPkt)
+{
+    if (pPkt->fCached)
+        RTMemCacheFree(pThis->hRecvPktCache, pPkt);
+    else
+        RTMemFree(pPkt);
+}
+
 /**
  * @brief Processes incoming packet (to guest).
  *
  * @param   pThis   Pointer to DRVNAT state for current context.
- * @param   pBuf    Pointer to packet buffer.
- * @param   cb      Size of packet in buffer.
+ * @param   pPkt    The frame, freed by this function.
  *
- * @thread  NAT
+ * @thread  NATRX
  */
-static DECLCALLBACK(void) drvNATRecvWorker(PDRVNAT pThis, void *pBuf, size_t cb)
+static DECLCALLBACK(void) drvNATRecvWorker(PDRVNAT pThis, PDRVNATRXPKT pPkt)
 {
     int rc;
     STAM_PROFILE_START(&pThis->StatNATRecv, a);
@@ -335,19 +431,20 @@ static DECLCALLBACK(void) drvNATRecvWorker(PDRVNAT pThis, void *pBuf, size_t cb)
 
     if (RT_SUCCESS(rc))
     {
-        rc = pThis->pIAboveNet->pfnReceive(pThis->pIAboveNet, pBuf, cb);
+        rc = pThis->pIAboveNet->pfnReceive(pThis->pIAboveNet, pPkt->abFrame, pPkt->cbFrame);
         AssertRC(rc);
-        RTMemFree(pBuf);
-        pBuf = NULL;
     }
-    else if (   rc != VERR_TIMEOUT
-             && rc != VERR_INTERRUPTED)
+    else
     {
-        AssertRC(rc);
+        if (   rc != VERR_TIMEOUT
+            && rc != VERR_INTERRUPTED)
+            AssertRC(rc);
+        STAM_COUNTER_INC(&pThis->StatQueuePktDropped);
     }
 
     rc = RTCritSectLeave(&pThis->DevAccessLock);
     AssertRC(rc);
+    drvNATRecvPktFree(pThis, pPkt);
     ASMAtomicDecU32(&pThis->cPkts);
     drvNATNotifyNATThread(pThis, "drvNATRecvWorker");
     STAM_PROFILE_STOP(&pThis->StatNATRecv, a);
@@ -363,22 +460,14 @@ static DECLCALLBACK(void) drvNATRecvWorker(PDRVNAT pThis, void *pBuf, size_t cb)
  */
 static void drvNATFreeSgBuf(PDRVNAT pThis, PPDMSCATTERGATHER pSgBuf)
 {
-    RT_NOREF(pThis);
     Assert((pSgBuf->fFlags & PDMSCATTERGATHER_FLAGS_MAGIC_MASK) == PDMSCATTERGATHER_FLAGS_MAGIC);
+    PDRVNATTXBUF pTxBuf = (PDRVNATTXBUF)pSgBuf->pvAllocator;
+    Assert(&pTxBuf->SgBuf == pSgBuf);
     pSgBuf->fFlags = 0;
-    if (pSgBuf->pvAllocator)
-    {
-        Assert(!pSgBuf->pvUser);
-        RTMemFree(pSgBuf->aSegs[0].pvSeg);
-    }
-    else if (pSgBuf->pvUser)
-    {
-        RTMemFree(pSgBuf->aSegs[0].pvSeg);
-        pSgBuf->aSegs[0].pvSeg = NULL;
-        RTMemFree(pSgBuf->pvUser);
-        pSgBuf->pvUser = NULL;
-    }
-    RTMemFree(pSgBuf);
+    if (pTxBuf->fCached)
+        RTMemCacheFree(pThis->hXmitBufCache, pTxBuf);
+    else
+        RTMemFree(pTxBuf);
 }
 
 /**
@@ -394,40 +483,35 @@ static DECLCALLBACK(void) drvNATSendWorker(PDRVNAT pThis, PPDMSCATTERGATHER pSgB
 
     if (pThis->enmLinkState == PDMNETWORKLINKSTATE_UP)
     {
-        const uint8_t *m = static_cast<const uint8_t*>(pSgBuf->pvAllocator);
-        if (m)
+        uint8_t *pbFrame = (uint8_t *)pSgBuf->aSegs[0].pvSeg;
+        if (!pSgBuf->pvUser)
         {
             /*
-             * A normal frame.
+             * A normal frame, libslirp copies it into an mbuf of its own.
              */
-            LogFlowFunc(("m=%p\n", m));
-            slirp_input(pThis->pNATState->pSlirp, (uint8_t const *)pSgBuf->pvAllocator, (int)pSgBuf->cbUsed);
+            LogFlowFunc(("pbFrame=%p\n", pbFrame));
+            slirp_input(pThis->pNATState->pSlirp, pbFrame, (int)pSgBuf->cbUsed);
         }
         else
         {
             /*
-             * M_EXT buf, need to segment it.
+             * GSO frame, need to segment it.  The buffer is ours and is freed
+             * right after this, so carve the segments in place instead of
+             * copying each of them into a separate buffer.
              */
-
-            uint8_t const  *pbFrame = (uint8_t const *)pSgBuf->aSegs[0].pvSeg;
-            PCPDMNETWORKGSO pGso    = (PCPDMNETWORKGSO)pSgBuf->pvUser;
+            uint8_t         abHdrScratch[256];
+            PCPDMNETWORKGSO pGso = (PCPDMNETWORKGSO)pSgBuf->pvUser;
             /* Do not attempt to segment frames with invalid GSO parameters. */
-            if (PDMNetGsoIsValid((const PDMNETWORKGSO *)pGso, sizeof(*pGso), pSgBuf->cbUsed))
+            if (PDMNetGsoIsValid(pGso, sizeof(*pGso), pSgBuf->cbUsed))
             {
                 uint32_t const cSegs = PDMNetGsoCalcSegmentCount(pGso, pSgBuf->cbUsed);
                 Assert(cSegs > 1);
                 for (uint32_t iSeg = 0; iSeg < cSegs; iSeg++)
                 {
-                    void  *pvSeg;
-                    pvSeg = RTMemAlloc(DRVNAT_MAXFRAMESIZE);
-
-                    uint32_t cbPayload, cbHdrs;
-                    uint32_t offPayload = PDMNetGsoCarveSegment(pGso, pbFrame, pSgBuf->cbUsed,
-                                                                iSeg, cSegs, (uint8_t *)pvSeg, &cbHdrs, &cbPayload);
-                    memcpy((uint8_t *)pvSeg + cbHdrs, pbFrame + offPayload, cbPayload);
-
-                    slirp_input(pThis->pNATState->pSlirp, (uint8_t const *)pvSeg, cbPayload + cbHdrs);
-                    RTMemFree(pvSeg);
+                    uint32_t cbSegFrame;
+                    void *pvSegFrame = PDMNetGsoCarveSegmentQD(pGso, pbFrame, pSgBuf->cbUsed, abHdrScratch,
+                                                               iSeg, cSegs, &cbSegFrame);
+                    slirp_input(pThis->pNATState->pSlirp, (uint8_t const *)pvSegFrame, (int)cbSegFrame);
                 }
             }
         }
@@ -475,62 +559,59 @@ static DECLCALLBACK(int) drvNATNetworkUp_AllocBuf(PPDMINETWORKUP pInterface, siz
     }
 
     /*
-     * Allocate a scatter/gather buffer and an mbuf.
+     * Drop the frame if it (or its segments) is too big.
      */
-    PPDMSCATTERGATHER pSgBuf = (PPDMSCATTERGATHER)RTMemAllocZ(sizeof(PDMSCATTERGATHER));
-    if (!pSgBuf)
-        return VERR_NO_MEMORY;
     if (!pGso)
     {
-        /*
-         * Drop the frame if it is too big.
-         */
         if (cbMin >= DRVNAT_MAXFRAMESIZE)
         {
             Log(("drvNATNetowrkUp_AllocBuf: drops over-sized frame (%u bytes), returns VERR_INVALID_PARAMETER\n",
                  cbMin));
-            RTMemFree(pSgBuf);
             return VERR_INVALID_PARAMETER;
         }
+    }
+    else if (pGso->cbHdrsTotal + pGso->cbMaxSeg >= DRVNAT_MAXFRAMESIZE)
+    {
+        Log(("drvNATNetowrkUp_AllocBuf: drops over-sized frame (%u bytes), returns VERR_INVALID_PARAMETER\n",
+             pGso->cbHdrsTotal + pGso->cbMaxSeg));
+        return VERR_INVALID_PARAMETER;
+    }
 
-        pSgBuf->pvUser      = NULL;
-        pSgBuf->aSegs[0].cbSeg = RT_ALIGN_Z(cbMin, 128);
-        pSgBuf->aSegs[0].pvSeg = RTMemAlloc(pSgBuf->aSegs[0].cbSeg);
-        pSgBuf->pvAllocator = pSgBuf->aSegs[0].pvSeg;
-
-        if (!pSgBuf->pvAllocator)
-        {
-            RTMemFree(pSgBuf);
+    /*
+     * Allocate the S/G buffer together with the frame, from the cache if
+     * the frame fits.
+     */
+    size_t const cbFrame = RT_ALIGN_Z(cbMin, 128);
+    PDRVNATTXBUF pTxBuf;
+    if (cbFrame <= DRVNAT_CACHED_FRAMESIZE)
+    {
+        pTxBuf = (PDRVNATTXBUF)RTMemCacheAlloc(pThis->hXmitBufCache);
+        if (!pTxBuf)
             return VERR_TRY_AGAIN;
-        }
+        pTxBuf->fCached = true;
+        STAM_COUNTER_INC(&pThis->StatNATXmitCached);
     }
     else
     {
-        /*
-         * Drop the frame if its segment is too big.
-         */
-        if (pGso->cbHdrsTotal + pGso->cbMaxSeg >= DRVNAT_MAXFRAMESIZE)
-        {
-            Log(("drvNATNetowrkUp_AllocBuf: drops over-sized frame (%u bytes), returns VERR_INVALID_PARAMETER\n",
-                 pGso->cbHdrsTotal + pGso->cbMaxSeg));
-            RTMemFree(pSgBuf);
-            return VERR_INVALID_PARAMETER;
-        }
-
-        pSgBuf->pvUser      = RTMemDup(pGso, sizeof(*pGso));
-        pSgBuf->pvAllocator = NULL;
-
-        pSgBuf->aSegs[0].cbSeg = RT_ALIGN_Z(cbMin, 128);
-        pSgBuf->aSegs[0].pvSeg = RTMemAlloc(pSgBuf->aSegs[0].cbSeg);
-        if (!pSgBuf->pvUser || !pSgBuf->aSegs[0].pvSeg)
-        {
-            RTMemFree(pSgBuf->aSegs[0].pvSeg);
-            RTMemFree(pSgBuf->pvUser);
-            RTMemFree(pSgBuf);
+        pTxBuf = (PDRVNATTXBUF)RTMemAlloc(RT_UOFFSETOF_DYN(DRVNATTXBUF, abFrame[cbFrame]));
+        if (!pTxBuf)
             return VERR_TRY_AGAIN;
-        }
+        pTxBuf->fCached = false;
+        STAM_COUNTER_INC(&pThis->StatNATXmitHeap);
     }
 
+    PPDMSCATTERGATHER pSgBuf = &pTxBuf->SgBuf;
+    if (pGso)
+    {
+        pTxBuf->Gso    = *pGso;
+        pSgBuf->pvUser = &pTxBuf->Gso;
+    }
+    else
+        pSgBuf->pvUser = NULL;
+    pSgBuf->pvAllocator    = pTxBuf;
+    pSgBuf->aSegs[0].cbSeg = cbFrame;
+    pSgBuf->aSegs[0].pvSeg = pTxBuf->abFrame;
+
     /*
      * Initialize the S/G buffer and return.
      */
@@ -1201,26 +1282,27 @@ static int drvNAT_PollEventHostToSlirp(int iEvents) {
  */
 static DECLCALLBACK(ssize_t) drvNAT_SendPacketCb(const void *pBuf, size_t cb, void *opaque /* PDRVNAT */)
 {
-    char *pNewBuf = (char *)RTMemAlloc(cb);
-    if (pNewBuf == NULL)
-        return -1;
-
-    memcpy(pNewBuf, pBuf, cb);
-
     PDRVNAT pThis = (PDRVNAT)opaque;
     Assert(pThis);
 
-    LogFlow(("slirp_output BEGIN %p %d\n", pNewBuf, cb));
-    Log6(("slirp_output: pNewBuf=%p cb=%#x (pThis=%p)\n"
-          "%.*Rhxd\n", pNewBuf, cb, pThis, cb, pNewBuf));
-
     /* don't queue new requests when the NAT thread is about to stop */
     if (pThis->pSlirpThread->enmState != PDMTHREADSTATE_RUNNING)
         return -1;
 
+    /* libslirp reuses its buffer on return, so this is the one copy we need. */
+    PDRVNATRXPKT pPkt = drvNATRecvPktAlloc(pThis, cb);
+    if (pPkt == NULL)
+        return -1;
+
+    memcpy(pPkt->abFrame, pBuf, cb);
+
+    LogFlow(("slirp_output BEGIN %p %d\n", pPkt, cb));
+    Log6(("slirp_output: pPkt=%p cb=%#x (pThis=%p)\n"
+          "%.*Rhxd\n", pPkt, cb, pThis, cb, pPkt->abFrame));
+
     ASMAtomicIncU32(&pThis->cPkts);
     int rc = RTReqQueueCallEx(pThis->hRecvReqQueue, NULL /*ppReq*/, 0 /*cMillies*/, RTREQFLAGS_VOID | RTREQFLAGS_NO_WAIT,
-                              (PFNRT)drvNATRecvWorker, 3, pThis, pNewBuf, cb);
+                              (PFNRT)drvNATRecvWorker, 2, pThis, pPkt);
     AssertRC(rc);
     drvNATRecvWakeup(pThis->pDrvIns, pThis->pRecvThread);
     drvNATNotifyNATThread(pThis, "drvNAT_SendPacketCb");
@@ -1472,6 +1554,12 @@ static DECLCALLBACK(void) drvNATDestruct(PPDMDRVINS pDrvIns)
     if (RTCritSectIsInitialized(&pThis->XmitLock))
         RTCritSectDelete(&pThis->XmitLock);
 
+    RTMemCacheDestroy(pThis->hRecvPktCache);
+    pThis->hRecvPktCache = NIL_RTMEMCACHE;
+
+    RTMemCacheDestroy(pThis->hXmitBufCache);
+    pThis->hXmitBufCache = NIL_RTMEMCACHE;
+
 #ifndef RT_OS_WINDOWS
     RTPipeClose(pThis->hPipeRead);
     RTPipeClose(pThis->hPipeWrite);
@@ -1506,6 +1594,8 @@ static DECLCALLBACK(int) drvNATConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg, uin
 
     pThis->hSlirpReqQueue               = NIL_RTREQQUEUE;
     pThis->EventRecv                    = NIL_RTSEMEVENT;
+    pThis->hRecvPktCache                = NIL_RTMEMCACHE;
+    pThis->hXmitBufCache                = NIL_RTMEMCACHE;
 
     /* IBase */
     pDrvIns->IBase.pfnQueryInterface    = drvNATQueryInterface;
@@ -1687,6 +1777,14 @@ static DECLCALLBACK(int) drvNATConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg, uin
     rc = RTCritSectInit(&pThis->XmitLock);
     AssertRCReturn(rc, rc);
 
+    rc = RTMemCacheCreate(&pThis->hRecvPktCache, RT_UOFFSETOF(DRVNATRXPKT, abFrame) + DRVNAT_CACHED_FRAMESIZE,
+                          0, UINT32_MAX, NULL, NULL, pThis, 0);
+    AssertRCReturn(rc, rc);
+
+    rc = RTMemCacheCreate(&pThis->hXmitBufCache, RT_UOFFSETOF(DRVNATTXBUF, abFrame) + DRVNAT_CACHED_FRAMESIZE,
+                          0, UINT32_MAX, NULL, NULL, pThis, 0);
+    AssertRCReturn(rc, rc);
+
     char szTmp[128];
     RTStrPrintf(szTmp, sizeof(szTmp), "nat%d", pDrvIns->iInstance);
     PDMDrvHlpDBGFInfoRegister(pDrvIns, szTmp, "NAT info.", drvNATInfo);
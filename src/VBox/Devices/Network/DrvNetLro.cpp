@@ -0,0 +1,1218 @@
+/* $Id: DrvNetLro.cpp $ */
+/** @file
+ * DrvNetLro - Network large receive offload (receive coalescing) filter driver.
+ */
+
+/*
+ * Copyright (C) 2006-2023 Oracle and/or its affiliates.
+ *
+ * This file is part of VirtualBox base platform packages, as
+ * available from https://www.virtualbox.org.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, in version 3 of the
+ * License.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+/** @page pg_drv_net_lro    Network LRO Filter Driver
+ *
+ * This filter driver sits between a network device and the transport driver
+ * (NAT, internal networking, ...) and merges consecutive in-order TCP segments
+ * of the same flow into one large frame, which is then passed up using
+ * PDMINETWORKDOWN::pfnReceiveGso together with a GSO context describing how
+ * the frame was put together.  A device which can hand such frames to the
+ * guest in one go (virtio-net with GUEST_TSO4/6 negotiated) thus gets one
+ * receive call, one descriptor chain and one interrupt per up to 64KB of
+ * stream data instead of one per MTU sized segment.
+ *
+ * Only plain segments are merged: no IP options or fragments, only the ACK and
+ * PSH flags, identical TCP options and acknowledgement numbers, and all but the
+ * last segment of equal size.  The IPv4 header and TCP checksums of each segment
+ * are verified before merging, as the merged frame only carries the pseudo
+ * header checksum and the guest would never see a corrupted segment otherwise.
+ * Anything else flushes the flow and is passed up unchanged.  A flow is flushed when the PSH flag is seen, when it has grown
+ * to the maximum size, or when it has been pending for longer than the flush
+ * timeout, the latter being taken care of by a small flush thread.
+ *
+ * If the device above rejects a GSO frame with VERR_NOT_SUPPORTED (guest has
+ * not negotiated the offload, or the device has no receive offload at all,
+ * like the E1000 models), the frame is segmented again and coalescing for that
+ * GSO type is suspended for a while before it's retried.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#define LOG_GROUP LOG_GROUP_DRV_NAT
+#include <VBox/vmm/pdmdrv.h>
+#include <VBox/vmm/pdmnetifs.h>
+#include <VBox/vmm/pdmnetinline.h>
+
+#include <VBox/log.h>
+#include <iprt/assert.h>
+#include <iprt/critsect.h>
+#include <iprt/mem.h>
+#include <iprt/net.h>
+#include <iprt/semaphore.h>
+#include <iprt/string.h>
+#include <iprt/time.h>
+#include <iprt/uuid.h>
+
+#include "VBoxDD.h"
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** Max number of flows being coalesced concurrently. */
+#define DRVNETLRO_MAX_FLOWS                 8
+/** The size of the per flow frame buffer. */
+#define DRVNETLRO_FLOW_BUF_SIZE             (_64K + 256)
+/** The default flush timeout in microseconds. */
+#define DRVNETLRO_FLUSH_TIMEOUT_US_DEFAULT  100
+/** How long coalescing of a GSO type stays disabled after the device above
+ *  rejected it (nanoseconds). */
+#define DRVNETLRO_REJECT_RETRY_NS           (RT_NS_1SEC_64)
+/** The TCP flags we accept in segments to merge. */
+#define DRVNETLRO_TCP_FLAGS_OK              (RTNETTCP_F_ACK | RTNETTCP_F_PSH)
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/**
+ * Parsed information about a TCP segment which can be merged.
+ */
+typedef struct DRVNETLROSEG
+{
+    /** The GSO type (PDMNETWORKGSOTYPE_IPV4_TCP or PDMNETWORKGSOTYPE_IPV6_TCP). */
+    PDMNETWORKGSOTYPE   enmType;
+    /** Offset of the IP header. */
+    uint8_t             offIpHdr;
+    /** Offset of the TCP header. */
+    uint8_t             offTcpHdr;
+    /** Total size of the headers. */
+    uint8_t             cbHdrs;
+    /** The TCP flags. */
+    uint8_t             fTcpFlags;
+    /** The TCP payload size. */
+    uint32_t            cbPayload;
+    /** The TCP sequence number (host order). */
+    uint32_t            uSeq;
+} DRVNETLROSEG;
+/** Pointer to parsed segment information. */
+typedef DRVNETLROSEG *PDRVNETLROSEG;
+/** Pointer to const parsed segment information. */
+typedef DRVNETLROSEG const *PCDRVNETLROSEG;
+
+/**
+ * A flow being coalesced.
+ */
+typedef struct DRVNETLROFLOW
+{
+    /** The frame buffer holding the headers of the first segment and the
+     *  payload of all merged segments. */
+    uint8_t            *pbFrame;
+    /** Number of bytes used in the frame buffer, 0 if the slot is free. */
+    uint32_t            cbFrame;
+    /** Number of segments merged. */
+    uint32_t            cSegs;
+    /** The payload size of the first segment (the MSS). */
+    uint32_t            cbMss;
+    /** The next expected sequence number (host order). */
+    uint32_t            uSeqNext;
+    /** The RTTimeNanoTS of the first segment. */
+    uint64_t            nsFirst;
+    /** The parsed info of the first segment. */
+    DRVNETLROSEG        Seg;
+} DRVNETLROFLOW;
+/** Pointer to a flow. */
+typedef DRVNETLROFLOW *PDRVNETLROFLOW;
+/** Pointer to a const flow. */
+typedef DRVNETLROFLOW const *PCDRVNETLROFLOW;
+
+/**
+ * Frame classification returned by drvNetLroParseSegment.
+ */
+typedef enum DRVNETLROPARSE
+{
+    /** Not TCP, doesn't affect any flow. */
+    DRVNETLROPARSE_OTHER = 0,
+    /** TCP, but we cannot tell the flow (IP options, fragments, ...). */
+    DRVNETLROPARSE_TCP,
+    /** TCP segment of a known flow which cannot be merged. */
+    DRVNETLROPARSE_FLOW,
+    /** TCP segment which can be merged. */
+    DRVNETLROPARSE_MERGE
+} DRVNETLROPARSE;
+
+/**
+ * LRO filter driver instance data.
+ *
+ * @implements  PDMINETWORKUP
+ * @implements  PDMINETWORKDOWN
+ * @implements  PDMINETWORKCONFIG
+ */
+typedef struct DRVNETLRO
+{
+    /** The network interface. */
+    PDMINETWORKUP           INetworkUp;
+    /** The network interface. */
+    PDMINETWORKDOWN         INetworkDown;
+    /** The network config interface. */
+    PDMINETWORKCONFIG       INetworkConfig;
+    /** The port we're attached to. */
+    PPDMINETWORKDOWN        pIAboveNet;
+    /** The config port interface we're attached to. */
+    PPDMINETWORKCONFIG      pIAboveConfig;
+    /** The connector that's attached to us. */
+    PPDMINETWORKUP          pIBelowNet;
+    /** Pointer to the driver instance. */
+    PPDMDRVINS              pDrvIns;
+    /** For when we're the leaf driver. */
+    RTCRITSECT              XmitLock;
+
+    /** Lock protecting the flows, serializes the receive and flush threads. */
+    RTCRITSECT              RecvLock;
+    /** The flows. */
+    DRVNETLROFLOW           aFlows[DRVNETLRO_MAX_FLOWS];
+    /** Number of active flows. */
+    uint32_t                cActiveFlows;
+    /** Max frame size (IP packet size) to produce. */
+    uint32_t                cbMaxIpPkt;
+    /** The flush timeout in nanoseconds. */
+    uint64_t                cNsFlushTimeout;
+    /** RTTimeNanoTS until which IPv4 coalescing is disabled. */
+    uint64_t                nsIpv4RejectedUntil;
+    /** RTTimeNanoTS until which IPv6 coalescing is disabled. */
+    uint64_t                nsIpv6RejectedUntil;
+    /** The flush thread. */
+    PPDMTHREAD              pFlushThread;
+    /** Event semaphore the flush thread waits on. */
+    RTSEMEVENT              hFlushEvt;
+
+    /** Number of segments merged into larger frames. */
+    STAMCOUNTER             StatSegsMerged;
+    /** Number of coalesced frames passed up. */
+    STAMCOUNTER             StatFramesCoalesced;
+    /** Number of frames passed up unchanged. */
+    STAMCOUNTER             StatFramesPassed;
+    /** Flushes due to the PSH flag. */
+    STAMCOUNTER             StatFlushPsh;
+    /** Flushes due to the flow reaching the max size. */
+    STAMCOUNTER             StatFlushFull;
+    /** Flushes due to a non-mergable segment of the same flow. */
+    STAMCOUNTER             StatFlushMismatch;
+    /** Flushes due to the timeout. */
+    STAMCOUNTER             StatFlushTimeout;
+    /** Flushes due to running out of flow slots. */
+    STAMCOUNTER             StatFlushEvict;
+    /** Number of coalesced frames rejected by the device above. */
+    STAMCOUNTER             StatGsoRejected;
+    /** Number of segments dropped because the device above had no room. */
+    STAMCOUNTER             StatDropped;
+    /** Number of segments passed up unmerged because of bad checksums. */
+    STAMCOUNTER             StatBadChecksum;
+} DRVNETLRO;
+/** Pointer to the LRO filter driver instance data. */
+typedef DRVNETLRO *PDRVNETLRO;
+
+
+
+/*
+ *
+ * Segment parsing and flow handling.
+ *
+ */
+
+/**
+ * Parses a frame, checking whether it is a TCP segment we can merge.
+ *
+ * @returns DRVNETLROPARSE_XXX.
+ * @param   pbFrame         The frame.
+ * @param   cbFrame         The frame size.
+ * @param   pSeg            Where to return the parsed segment info.  Only valid
+ *                          for DRVNETLROPARSE_FLOW and DRVNETLROPARSE_MERGE.
+ */
+static DRVNETLROPARSE drvNetLroParseSegment(uint8_t const *pbFrame, size_t cbFrame, PDRVNETLROSEG pSeg)
+{
+    if (cbFrame < sizeof(RTNETETHERHDR) + RTNETIPV4_MIN_LEN + RTNETTCP_MIN_LEN)
+        return DRVNETLROPARSE_OTHER;
+
+    PCRTNETETHERHDR pEthHdr  = (PCRTNETETHERHDR)pbFrame;
+    uint32_t const  offIpHdr = sizeof(RTNETETHERHDR);
+    uint32_t        offTcpHdr;
+    uint32_t        cbIpPkt;
+    if (pEthHdr->EtherType == RT_H2N_U16_C(RTNET_ETHERTYPE_IPV4))
+    {
+        PCRTNETIPV4 pIpHdr = (PCRTNETIPV4)&pbFrame[offIpHdr];
+        if (   pIpHdr->ip_v != 4
+            || pIpHdr->ip_p != RTNETIPV4_PROT_TCP)
+            return DRVNETLROPARSE_OTHER;
+        if (   pIpHdr->ip_hl != RTNETIPV4_MIN_LEN / 4                  /* no options */
+            || (RT_N2H_U16(pIpHdr->ip_off) & ~RTNETIPV4_FLAGS_DF) != 0) /* no fragments */
+            return DRVNETLROPARSE_TCP;
+        cbIpPkt       = RT_N2H_U16(pIpHdr->ip_len);
+        offTcpHdr     = offIpHdr + RTNETIPV4_MIN_LEN;
+        pSeg->enmType = PDMNETWORKGSOTYPE_IPV4_TCP;
+    }
+    else if (pEthHdr->EtherType == RT_H2N_U16_C(RTNET_ETHERTYPE_IPV6))
+    {
+        if (cbFrame < sizeof(RTNETETHERHDR) + RTNETIPV6_MIN_LEN + RTNETTCP_MIN_LEN)
+            return DRVNETLROPARSE_OTHER;
+        PCRTNETIPV6 pIpHdr = (PCRTNETIPV6)&pbFrame[offIpHdr];
+        if ((pbFrame[offIpHdr] >> 4) != 6)
+            return DRVNETLROPARSE_OTHER;
+        if (pIpHdr->ip6_nxt != RTNETIPV4_PROT_TCP)
+            /* Could be TCP behind extension headers, we don't bother looking. */
+            return pIpHdr->ip6_nxt == 17 /*UDP*/ || pIpHdr->ip6_nxt == 58 /*ICMPv6*/
+                 ? DRVNETLROPARSE_OTHER : DRVNETLROPARSE_TCP;
+        cbIpPkt       = RTNETIPV6_MIN_LEN + RT_N2H_U16(pIpHdr->ip6_plen);
+        offTcpHdr     = offIpHdr + RTNETIPV6_MIN_LEN;
+        pSeg->enmType = PDMNETWORKGSOTYPE_IPV6_TCP;
+    }
+    else
+        return DRVNETLROPARSE_OTHER;
+
+    /* The frame may be padded, so the IP packet length is what counts. */
+    PCRTNETTCP     pTcpHdr = (PCRTNETTCP)&pbFrame[offTcpHdr];
+    uint32_t const cbHdrs  = offTcpHdr + pTcpHdr->th_off * 4;
+    if (   offIpHdr + cbIpPkt > cbFrame
+        || pTcpHdr->th_off * 4 < RTNETTCP_MIN_LEN
+        || cbHdrs > offIpHdr + cbIpPkt)
+        return DRVNETLROPARSE_TCP;
+
+    pSeg->offIpHdr  = (uint8_t)offIpHdr;
+    pSeg->offTcpHdr = (uint8_t)offTcpHdr;
+    pSeg->cbHdrs    = (uint8_t)cbHdrs;
+    pSeg->fTcpFlags = pTcpHdr->th_flags;
+    pSeg->cbPayload = offIpHdr + cbIpPkt - cbHdrs;
+    pSeg->uSeq      = RT_N2H_U32(pTcpHdr->th_seq);
+
+    if (   pSeg->cbPayload == 0                                     /* pure ACKs go straight up */
+        || (pTcpHdr->th_flags & ~DRVNETLRO_TCP_FLAGS_OK) != 0       /* SYN, FIN, RST, URG, ECN */
+        || !(pTcpHdr->th_flags & RTNETTCP_F_ACK))
+        return DRVNETLROPARSE_FLOW;
+    return DRVNETLROPARSE_MERGE;
+}
+
+
+/**
+ * Verifies the IPv4 header and TCP checksums of a segment.
+ *
+ * @returns true if good, false if not.
+ * @param   pbFrame         The frame.
+ * @param   pSeg            The parsed segment.
+ */
+static bool drvNetLroIsChecksumOk(uint8_t const *pbFrame, PCDRVNETLROSEG pSeg)
+{
+    uint32_t u32Sum;
+    if (pSeg->enmType == PDMNETWORKGSOTYPE_IPV4_TCP)
+    {
+        PCRTNETIPV4 pIpHdr = (PCRTNETIPV4)&pbFrame[pSeg->offIpHdr];
+        if (RTNetIPv4HdrChecksum(pIpHdr) != pIpHdr->ip_sum)
+            return false;
+        u32Sum = RTNetIPv4PseudoChecksum(pIpHdr);
+    }
+    else
+        u32Sum = RTNetIPv6PseudoChecksum((PCRTNETIPV6)&pbFrame[pSeg->offIpHdr]);
+
+    PCRTNETTCP pTcpHdr = (PCRTNETTCP)&pbFrame[pSeg->offTcpHdr];
+    return RTNetTCPChecksum(u32Sum, pTcpHdr, &pbFrame[pSeg->cbHdrs], pSeg->cbPayload) == pTcpHdr->th_sum;
+}
+
+
+/**
+ * Checks whether a segment belongs to the given flow.
+ *
+ * @returns true if same flow (addresses and ports), false if not.
+ */
+static bool drvNetLroIsSameFlow(PCDRVNETLROFLOW pFlow, uint8_t const *pbFrame, PCDRVNETLROSEG pSeg)
+{
+    if (   pFlow->Seg.enmType   != pSeg->enmType
+        || pFlow->Seg.offTcpHdr != pSeg->offTcpHdr)
+        return false;
+
+    /* Ethernet addresses. */
+    if (memcmp(pFlow->pbFrame, pbFrame, RT_UOFFSETOF(RTNETETHERHDR, EtherType)))
+        return false;
+
+    /* IP addresses. */
+    if (pSeg->enmType == PDMNETWORKGSOTYPE_IPV4_TCP)
+    {
+        PCRTNETIPV4 pIpHdrFlow = (PCRTNETIPV4)&pFlow->pbFrame[pSeg->offIpHdr];
+        PCRTNETIPV4 pIpHdr     = (PCRTNETIPV4)&pbFrame[pSeg->offIpHdr];
+        if (   pIpHdrFlow->ip_src.u != pIpHdr->ip_src.u
+            || pIpHdrFlow->ip_dst.u != pIpHdr->ip_dst.u)
+            return false;
+    }
+    else
+    {
+        PCRTNETIPV6 pIpHdrFlow = (PCRTNETIPV6)&pFlow->pbFrame[pSeg->offIpHdr];
+        PCRTNETIPV6 pIpHdr     = (PCRTNETIPV6)&pbFrame[pSeg->offIpHdr];
+        if (memcmp(&pIpHdrFlow->ip6_src, &pIpHdr->ip6_src, sizeof(pIpHdr->ip6_src) * 2))
+            return false;
+    }
+
+    /* Ports. */
+    PCRTNETTCP pTcpHdrFlow = (PCRTNETTCP)&pFlow->pbFrame[pSeg->offTcpHdr];
+    PCRTNETTCP pTcpHdr     = (PCRTNETTCP)&pbFrame[pSeg->offTcpHdr];
+    return pTcpHdrFlow->th_sport == pTcpHdr->th_sport
+        && pTcpHdrFlow->th_dport == pTcpHdr->th_dport;
+}
+
+
+/**
+ * Checks whether a segment of the same flow can be appended to it.
+ *
+ * @returns true if it can be merged, false if the flow must be flushed first.
+ */
+static bool drvNetLroCanMerge(PDRVNETLRO pThis, PCDRVNETLROFLOW pFlow, uint8_t const *pbFrame, PCDRVNETLROSEG pSeg)
+{
+    /* In order, equally sized segments (the last one may be smaller) and room left. */
+    if (   pSeg->uSeq != pFlow->uSeqNext
+        || pSeg->cbHdrs != pFlow->Seg.cbHdrs
+        || pSeg->cbPayload > pFlow->cbMss
+        || pFlow->cbFrame != pFlow->Seg.cbHdrs + pFlow->cSegs * pFlow->cbMss
+        || pFlow->cbFrame - pFlow->Seg.offIpHdr + pSeg->cbPayload > pThis->cbMaxIpPkt)
+        return false;
+
+    /* Same IP type of service / traffic class and TTL / hop limit. */
+    if (pSeg->enmType == PDMNETWORKGSOTYPE_IPV4_TCP)
+    {
+        PCRTNETIPV4 pIpHdrFlow = (PCRTNETIPV4)&pFlow->pbFrame[pSeg->offIpHdr];
+        PCRTNETIPV4 pIpHdr     = (PCRTNETIPV4)&pbFrame[pSeg->offIpHdr];
+        if (   pIpHdrFlow->ip_tos != pIpHdr->ip_tos
+            || pIpHdrFlow->ip_ttl != pIpHdr->ip_ttl)
+            return false;
+    }
+    else
+    {
+        PCRTNETIPV6 pIpHdrFlow = (PCRTNETIPV6)&pFlow->pbFrame[pSeg->offIpHdr];
+        PCRTNETIPV6 pIpHdr     = (PCRTNETIPV6)&pbFrame[pSeg->offIpHdr];
+        if (   (pIpHdrFlow->ip6_vfc & RT_H2N_U32_C(UINT32_C(0xfff00000))) != (pIpHdr->ip6_vfc & RT_H2N_U32_C(UINT32_C(0xfff00000)))
+            || pIpHdrFlow->ip6_hlim != pIpHdr->ip6_hlim)
+            return false;
+    }
+
+    /* Same acknowledgement number and identical options (timestamps included). */
+    PCRTNETTCP pTcpHdrFlow = (PCRTNETTCP)&pFlow->pbFrame[pSeg->offTcpHdr];
+    PCRTNETTCP pTcpHdr     = (PCRTNETTCP)&pbFrame[pSeg->offTcpHdr];
+    if (pTcpHdrFlow->th_ack != pTcpHdr->th_ack)
+        return false;
+    uint32_t const offOpts = pSeg->offTcpHdr + RTNETTCP_MIN_LEN;
+    return memcmp(&pFlow->pbFrame[offOpts], &pbFrame[offOpts], pSeg->cbHdrs - offOpts) == 0;
+}
+
+
+/**
+ * Passes a single frame up, waiting for receive buffers if requested.
+ *
+ * @returns VBox status code.
+ * @param   pThis           The LRO instance.
+ * @param   pvFrame         The frame.
+ * @param   cbFrame         The frame size.
+ * @param   cMillies        How long to wait for receive buffers.
+ */
+static int drvNetLroPassUp(PDRVNETLRO pThis, const void *pvFrame, size_t cbFrame, RTMSINTERVAL cMillies)
+{
+    int rc = pThis->pIAboveNet->pfnWaitReceiveAvail(pThis->pIAboveNet, cMillies);
+    if (RT_SUCCESS(rc))
+        rc = pThis->pIAboveNet->pfnReceive(pThis->pIAboveNet, pvFrame, cbFrame);
+    if (RT_FAILURE(rc))
+        STAM_REL_COUNTER_INC(&pThis->StatDropped);
+    return rc;
+}
+
+
+/**
+ * Flushes a flow, passing the coalesced frame up.
+ *
+ * @returns VBox status code.
+ * @param   pThis           The LRO instance.
+ * @param   pFlow           The flow to flush.
+ * @param   cMillies        How long to wait for receive buffers.
+ */
+static int drvNetLroFlushFlow(PDRVNETLRO pThis, PDRVNETLROFLOW pFlow, RTMSINTERVAL cMillies)
+{
+    Assert(pFlow->cbFrame);
+    int rc;
+    if (pFlow->cSegs == 1)
+    {
+        STAM_REL_COUNTER_INC(&pThis->StatFramesPassed);
+        rc = drvNetLroPassUp(pThis, pFlow->pbFrame, pFlow->cbFrame, cMillies);
+    }
+    else
+    {
+        PDMNETWORKGSO Gso;
+        Gso.u8Type      = (uint8_t)pFlow->Seg.enmType;
+        Gso.cbHdrsTotal = pFlow->Seg.cbHdrs;
+        Gso.cbHdrsSeg   = pFlow->Seg.cbHdrs;
+        Gso.cbMaxSeg    = (uint16_t)pFlow->cbMss;
+        Gso.offHdr1     = pFlow->Seg.offIpHdr;
+        Gso.offHdr2     = pFlow->Seg.offTcpHdr;
+        Gso.u8Unused    = 0;
+        Assert(PDMNetGsoIsValid(&Gso, sizeof(Gso), pFlow->cbFrame));
+
+        /* Fix up the IP length and checksum, the TCP checksum covers the pseudo header only. */
+        PDMNetGsoPrepForDirectUse(&Gso, pFlow->pbFrame, pFlow->cbFrame, PDMNETCSUMTYPE_PSEUDO);
+
+        rc = pThis->pIAboveNet->pfnWaitReceiveAvail(pThis->pIAboveNet, cMillies);
+        if (RT_SUCCESS(rc))
+            rc = pThis->pIAboveNet->pfnReceiveGso(pThis->pIAboveNet, pFlow->pbFrame, pFlow->cbFrame, &Gso);
+        if (RT_SUCCESS(rc))
+        {
+            STAM_REL_COUNTER_INC(&pThis->StatFramesCoalesced);
+            STAM_REL_COUNTER_ADD(&pThis->StatSegsMerged, pFlow->cSegs);
+        }
+        else if (rc == VERR_NOT_SUPPORTED)
+        {
+            /*
+             * The device (or the guest) can't take it.  Stop coalescing this type
+             * for a while and pass up the original segments.
+             */
+            STAM_REL_COUNTER_INC(&pThis->StatGsoRejected);
+            uint64_t const nsRetry = RTTimeNanoTS() + DRVNETLRO_REJECT_RETRY_NS;
+            if (Gso.u8Type == PDMNETWORKGSOTYPE_IPV4_TCP)
+                pThis->nsIpv4RejectedUntil = nsRetry;
+            else
+                pThis->nsIpv6RejectedUntil = nsRetry;
+
+            uint8_t         abHdrScratch[256];
+            uint32_t const  cSegs = PDMNetGsoCalcSegmentCount(&Gso, pFlow->cbFrame);
+            for (uint32_t iSeg = 0; iSeg < cSegs; iSeg++)
+            {
+                uint32_t cbSegFrame;
+                void    *pvSegFrame = PDMNetGsoCarveSegmentQD(&Gso, pFlow->pbFrame, pFlow->cbFrame,
+                                                              abHdrScratch, iSeg, cSegs, &cbSegFrame);
+                STAM_REL_COUNTER_INC(&pThis->StatFramesPassed);
+                rc = drvNetLroPassUp(pThis, pvSegFrame, cbSegFrame, cMillies);
+                if (RT_FAILURE(rc))
+                    break; /* we drop the rest. */
+            }
+        }
+        else
+            STAM_REL_COUNTER_INC(&pThis->StatDropped);
+    }
+
+    pFlow->cbFrame = 0;
+    pFlow->cSegs   = 0;
+    Assert(pThis->cActiveFlows > 0);
+    pThis->cActiveFlows--;
+    return rc;
+}
+
+
+/**
+ * Flushes all flows.
+ *
+ * @param   pThis           The LRO instance.
+ * @param   cMillies        How long to wait for receive buffers.
+ */
+static void drvNetLroFlushAll(PDRVNETLRO pThis, RTMSINTERVAL cMillies)
+{
+    for (unsigned i = 0; i < RT_ELEMENTS(pThis->aFlows) && pThis->cActiveFlows > 0; i++)
+        if (pThis->aFlows[i].cbFrame)
+            drvNetLroFlushFlow(pThis, &pThis->aFlows[i], cMillies);
+}
+
+
+/**
+ * Starts a new flow with the given segment.
+ *
+ * @param   pThis           The LRO instance.
+ * @param   pFlow           The free flow slot.
+ * @param   pbFrame         The frame.
+ * @param   pSeg            The parsed segment.
+ */
+static void drvNetLroStartFlow(PDRVNETLRO pThis, PDRVNETLROFLOW pFlow, uint8_t const *pbFrame, PCDRVNETLROSEG pSeg)
+{
+    Assert(!pFlow->cbFrame);
+    pFlow->cbFrame  = pSeg->cbHdrs + pSeg->cbPayload;
+    pFlow->cSegs    = 1;
+    pFlow->cbMss    = pSeg->cbPayload;
+    pFlow->uSeqNext = pSeg->uSeq + pSeg->cbPayload;
+    pFlow->nsFirst  = RTTimeNanoTS();
+    pFlow->Seg      = *pSeg;
+    memcpy(pFlow->pbFrame, pbFrame, pFlow->cbFrame);
+
+    if (pThis->cActiveFlows++ == 0)
+        RTSemEventSignal(pThis->hFlushEvt);
+}
+
+
+/**
+ * Feeds a received frame into the coalescing engine.
+ *
+ * @returns VBox status code.
+ * @param   pThis           The LRO instance.
+ * @param   pbFrame         The frame.
+ * @param   cbFrame         The frame size.
+ * @thread  The receive thread of the driver below.
+ */
+static int drvNetLroReceiveLocked(PDRVNETLRO pThis, uint8_t const *pbFrame, size_t cbFrame)
+{
+    DRVNETLROSEG   Seg;
+    DRVNETLROPARSE enmParse = drvNetLroParseSegment(pbFrame, cbFrame, &Seg);
+    if (enmParse == DRVNETLROPARSE_MERGE)
+    {
+        uint64_t const nsRejectedUntil = Seg.enmType == PDMNETWORKGSOTYPE_IPV4_TCP
+                                       ? pThis->nsIpv4RejectedUntil : pThis->nsIpv6RejectedUntil;
+        if (RT_UNLIKELY(nsRejectedUntil) && RTTimeNanoTS() < nsRejectedUntil)
+            enmParse = DRVNETLROPARSE_FLOW;
+        else if (!drvNetLroIsChecksumOk(pbFrame, &Seg))
+        {
+            /* Let the guest stack deal with it. */
+            STAM_REL_COUNTER_INC(&pThis->StatBadChecksum);
+            enmParse = DRVNETLROPARSE_FLOW;
+        }
+    }
+    else if (enmParse == DRVNETLROPARSE_TCP)
+    {
+        /* TCP we can't attribute to a flow, flush everything to keep the ordering. */
+        drvNetLroFlushAll(pThis, RT_INDEFINITE_WAIT);
+        enmParse = DRVNETLROPARSE_OTHER;
+    }
+    bool const fMergable = enmParse == DRVNETLROPARSE_MERGE;
+
+    /*
+     * Look for the flow, merging the segment or flushing the flow as needed.
+     */
+    PDRVNETLROFLOW pFree = NULL;
+    PDRVNETLROFLOW pOldest = NULL;
+    if (pThis->cActiveFlows && enmParse != DRVNETLROPARSE_OTHER)
+    {
+        for (unsigned i = 0; i < RT_ELEMENTS(pThis->aFlows); i++)
+        {
+            PDRVNETLROFLOW pFlow = &pThis->aFlows[i];
+            if (!pFlow->cbFrame)
+                pFree = pFree ? pFree : pFlow;
+            else if (drvNetLroIsSameFlow(pFlow, pbFrame, &Seg))
+            {
+                if (fMergable && drvNetLroCanMerge(pThis, pFlow, pbFrame, &Seg))
+                {
+                    memcpy(&pFlow->pbFrame[pFlow->cbFrame], &pbFrame[Seg.cbHdrs], Seg.cbPayload);
+                    pFlow->cbFrame  += Seg.cbPayload;
+                    pFlow->uSeqNext += Seg.cbPayload;
+                    pFlow->cSegs++;
+
+                    /* Take the most recent window and the PSH flag. */
+                    PRTNETTCP  pTcpHdrFlow = (PRTNETTCP)&pFlow->pbFrame[Seg.offTcpHdr];
+                    PCRTNETTCP pTcpHdr     = (PCRTNETTCP)&pbFrame[Seg.offTcpHdr];
+                    pTcpHdrFlow->th_win    = pTcpHdr->th_win;
+                    if (Seg.fTcpFlags & RTNETTCP_F_PSH)
+                    {
+                        pTcpHdrFlow->th_flags |= RTNETTCP_F_PSH;
+                        STAM_REL_COUNTER_INC(&pThis->StatFlushPsh);
+                        return drvNetLroFlushFlow(pThis, pFlow, RT_INDEFINITE_WAIT);
+                    }
+                    if (   Seg.cbPayload < pFlow->cbMss
+                        || pFlow->cbFrame - Seg.offIpHdr + pFlow->cbMss > pThis->cbMaxIpPkt)
+                    {
+                        STAM_REL_COUNTER_INC(&pThis->StatFlushFull);
+                        return drvNetLroFlushFlow(pThis, pFlow, RT_INDEFINITE_WAIT);
+                    }
+                    return VINF_SUCCESS;
+                }
+
+                STAM_REL_COUNTER_INC(&pThis->StatFlushMismatch);
+                drvNetLroFlushFlow(pThis, pFlow, RT_INDEFINITE_WAIT);
+                pFree = pFlow;
+                break;
+            }
+            else if (!pOldest || pFlow->nsFirst < pOldest->nsFirst)
+                pOldest = pFlow;
+        }
+    }
+    else if (!pThis->cActiveFlows)
+        pFree = &pThis->aFlows[0];
+
+    /*
+     * Not merged: start a new flow or pass it on unchanged.
+     */
+    if (!fMergable || (Seg.fTcpFlags & RTNETTCP_F_PSH))
+    {
+        STAM_REL_COUNTER_INC(&pThis->StatFramesPassed);
+        return drvNetLroPassUp(pThis, pbFrame, cbFrame, RT_INDEFINITE_WAIT);
+    }
+
+    if (!pFree)
+    {
+        AssertReturn(pOldest, VERR_INTERNAL_ERROR_3);
+        STAM_REL_COUNTER_INC(&pThis->StatFlushEvict);
+        drvNetLroFlushFlow(pThis, pOldest, RT_INDEFINITE_WAIT);
+        pFree = pOldest;
+    }
+    drvNetLroStartFlow(pThis, pFree, pbFrame, &Seg);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * The flush thread, flushes flows which have been pending for too long.
+ *
+ * @returns VBox status code. Returning failure will naturally terminate the thread.
+ * @param   pDrvIns     The LRO driver instance.
+ * @param   pThread     The thread.
+ */
+static DECLCALLBACK(int) drvNetLroFlushThread(PPDMDRVINS pDrvIns, PPDMTHREAD pThread)
+{
+    PDRVNETLRO pThis = PDMINS_2_DATA(pDrvIns, PDRVNETLRO);
+
+    if (pThread->enmState == PDMTHREADSTATE_INITIALIZING)
+        return VINF_SUCCESS;
+
+    while (pThread->enmState == PDMTHREADSTATE_RUNNING)
+    {
+        uint64_t cNsWait = UINT64_MAX;
+
+        RTCritSectEnter(&pThis->RecvLock);
+        if (pThis->cActiveFlows)
+        {
+            uint64_t const nsNow = RTTimeNanoTS();
+            for (unsigned i = 0; i < RT_ELEMENTS(pThis->aFlows); i++)
+            {
+                PDRVNETLROFLOW pFlow = &pThis->aFlows[i];
+                if (pFlow->cbFrame)
+                {
+                    uint64_t const nsDeadline = pFlow->nsFirst + pThis->cNsFlushTimeout;
+                    /* Never block here, the receive thread may be waiting for buffers already. */
+                    if (   nsDeadline > nsNow
+                        || RT_FAILURE(pThis->pIAboveNet->pfnWaitReceiveAvail(pThis->pIAboveNet, 0)))
+                        cNsWait = RT_MIN(cNsWait, nsDeadline > nsNow ? nsDeadline - nsNow : pThis->cNsFlushTimeout);
+                    else
+                    {
+                        STAM_REL_COUNTER_INC(&pThis->StatFlushTimeout);
+                        drvNetLroFlushFlow(pThis, pFlow, 0);
+                    }
+                }
+            }
+        }
+        RTCritSectLeave(&pThis->RecvLock);
+
+        int rc;
+        if (cNsWait == UINT64_MAX)
+            rc = RTSemEventWait(pThis->hFlushEvt, RT_INDEFINITE_WAIT);
+        else
+            rc = RTSemEventWaitEx(pThis->hFlushEvt, RTSEMWAIT_FLAGS_RELATIVE | RTSEMWAIT_FLAGS_NANOSECS | RTSEMWAIT_FLAGS_RESUME,
+                                  cNsWait);
+        AssertLogRelMsgReturn(RT_SUCCESS(rc) || rc == VERR_TIMEOUT || rc == VERR_INTERRUPTED, ("%Rrc\n", rc), rc);
+    }
+
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @copydoc FNPDMTHREADWAKEUPDRV
+ */
+static DECLCALLBACK(int) drvNetLroFlushWakeUp(PPDMDRVINS pDrvIns, PPDMTHREAD pThread)
+{
+    RT_NOREF(pThread);
+    PDRVNETLRO pThis = PDMINS_2_DATA(pDrvIns, PDRVNETLRO);
+    return RTSemEventSignal(pThis->hFlushEvt);
+}
+
+
+
+/*
+ *
+ * Interfaces.
+ *
+ */
+
+/**
+ * @interface_method_impl{PDMINETWORKUP,pfnBeginXmit}
+ */
+static DECLCALLBACK(int) drvNetLroUp_BeginXmit(PPDMINETWORKUP pInterface, bool fOnWorkerThread)
+{
+    PDRVNETLRO pThis = RT_FROM_MEMBER(pInterface, DRVNETLRO, INetworkUp);
+    if (RT_UNLIKELY(!pThis->pIBelowNet))
+    {
+        int rc = RTCritSectTryEnter(&pThis->XmitLock);
+        if (RT_UNLIKELY(rc == VERR_SEM_BUSY))
+            rc = VERR_TRY_AGAIN;
+        return rc;
+    }
+    return pThis->pIBelowNet->pfnBeginXmit(pThis->pIBelowNet, fOnWorkerThread);
+}
+
+
+/**
+ * @interface_method_impl{PDMINETWORKUP,pfnAllocBuf}
+ */
+static DECLCALLBACK(int) drvNetLroUp_AllocBuf(PPDMINETWORKUP pInterface, size_t cbMin,
+                                              PCPDMNETWORKGSO pGso, PPPDMSCATTERGATHER ppSgBuf)
+{
+    PDRVNETLRO pThis = RT_FROM_MEMBER(pInterface, DRVNETLRO, INetworkUp);
+    if (RT_UNLIKELY(!pThis->pIBelowNet))
+        return VERR_NET_DOWN;
+    return pThis->pIBelowNet->pfnAllocBuf(pThis->pIBelowNet, cbMin, pGso, ppSgBuf);
+}
+
+
+/**
+ * @interface_method_impl{PDMINETWORKUP,pfnFreeBuf}
+ */
+static DECLCALLBACK(int) drvNetLroUp_FreeBuf(PPDMINETWORKUP pInterface, PPDMSCATTERGATHER pSgBuf)
+{
+    PDRVNETLRO pThis = RT_FROM_MEMBER(pInterface, DRVNETLRO, INetworkUp);
+    if (RT_UNLIKELY(!pThis->pIBelowNet))
+        return VERR_NET_DOWN;
+    return pThis->pIBelowNet->pfnFreeBuf(pThis->pIBelowNet, pSgBuf);
+}
+
+
+/**
+ * @interface_method_impl{PDMINETWORKUP,pfnSendBuf}
+ */
+static DECLCALLBACK(int) drvNetLroUp_SendBuf(PPDMINETWORKUP pInterface, PPDMSCATTERGATHER pSgBuf, bool fOnWorkerThread)
+{
+    PDRVNETLRO pThis = RT_FROM_MEMBER(pInterface, DRVNETLRO, INetworkUp);
+    if (RT_UNLIKELY(!pThis->pIBelowNet))
+        return VERR_NET_DOWN;
+    return pThis->pIBelowNet->pfnSendBuf(pThis->pIBelowNet, pSgBuf, fOnWorkerThread);
+}
+
+
+/**
+ * @interface_method_impl{PDMINETWORKUP,pfnEndXmit}
+ */
+static DECLCALLBACK(void) drvNetLroUp_EndXmit(PPDMINETWORKUP pInterface)
+{
+    PDRVNETLRO pThis = RT_FROM_MEMBER(pInterface, DRVNETLRO, INetworkUp);
+    if (RT_LIKELY(pThis->pIBelowNet))
+        pThis->pIBelowNet->pfnEndXmit(pThis->pIBelowNet);
+    else
+        RTCritSectLeave(&pThis->XmitLock);
+}
+
+
+/**
+ * @interface_method_impl{PDMINETWORKUP,pfnSetPromiscuousMode}
+ */
+static DECLCALLBACK(void) drvNetLroUp_SetPromiscuousMode(PPDMINETWORKUP pInterface, bool fPromiscuous)
+{
+    PDRVNETLRO pThis = RT_FROM_MEMBER(pInterface, DRVNETLRO, INetworkUp);
+    if (pThis->pIBelowNet)
+        pThis->pIBelowNet->pfnSetPromiscuousMode(pThis->pIBelowNet, fPromiscuous);
+}
+
+
+/**
+ * @interface_method_impl{PDMINETWORKUP,pfnNotifyLinkChanged}
+ */
+static DECLCALLBACK(void) drvNetLroUp_NotifyLinkChanged(PPDMINETWORKUP pInterface, PDMNETWORKLINKSTATE enmLinkState)
+{
+    PDRVNETLRO pThis = RT_FROM_MEMBER(pInterface, DRVNETLRO, INetworkUp);
+    if (pThis->pIBelowNet)
+        pThis->pIBelowNet->pfnNotifyLinkChanged(pThis->pIBelowNet, enmLinkState);
+}
+
+
+/**
+ * @interface_method_impl{PDMINETWORKDOWN,pfnWaitReceiveAvail}
+ */
+static DECLCALLBACK(int) drvNetLroDown_WaitReceiveAvail(PPDMINETWORKDOWN pInterface, RTMSINTERVAL cMillies)
+{
+    PDRVNETLRO pThis = RT_FROM_MEMBER(pInterface, DRVNETLRO, INetworkDown);
+    return pThis->pIAboveNet->pfnWaitReceiveAvail(pThis->pIAboveNet, cMillies);
+}
+
+
+/**
+ * @interface_method_impl{PDMINETWORKDOWN,pfnReceive}
+ */
+static DECLCALLBACK(int) drvNetLroDown_Receive(PPDMINETWORKDOWN pInterface, const void *pvBuf, size_t cb)
+{
+    PDRVNETLRO pThis = RT_FROM_MEMBER(pInterface, DRVNETLRO, INetworkDown);
+    RTCritSectEnter(&pThis->RecvLock);
+    int rc = drvNetLroReceiveLocked(pThis, (uint8_t const *)pvBuf, cb);
+    RTCritSectLeave(&pThis->RecvLock);
+    return rc;
+}
+
+
+/**
+ * @interface_method_impl{PDMINETWORKDOWN,pfnReceiveGso}
+ */
+static DECLCALLBACK(int) drvNetLroDown_ReceiveGso(PPDMINETWORKDOWN pInterface, const void *pvBuf, size_t cb,
+                                                  PCPDMNETWORKGSO pGso)
+{
+    PDRVNETLRO pThis = RT_FROM_MEMBER(pInterface, DRVNETLRO, INetworkDown);
+
+    /* Already coalesced by the sender, keep the ordering and pass it on. */
+    RTCritSectEnter(&pThis->RecvLock);
+    drvNetLroFlushAll(pThis, RT_INDEFINITE_WAIT);
+    RTCritSectLeave(&pThis->RecvLock);
+    return pThis->pIAboveNet->pfnReceiveGso(pThis->pIAboveNet, pvBuf, cb, pGso);
+}
+
+
+/**
+ * @interface_method_impl{PDMINETWORKDOWN,pfnXmitPending}
+ */
+static DECLCALLBACK(void) drvNetLroDown_XmitPending(PPDMINETWORKDOWN pInterface)
+{
+    PDRVNETLRO pThis = RT_FROM_MEMBER(pInterface, DRVNETLRO, INetworkDown);
+    pThis->pIAboveNet->pfnXmitPending(pThis->pIAboveNet);
+}
+
+
+/**
+ * @interface_method_impl{PDMINETWORKCONFIG,pfnGetMac}
+ */
+static DECLCALLBACK(int) drvNetLroDownCfg_GetMac(PPDMINETWORKCONFIG pInterface, PRTMAC pMac)
+{
+    PDRVNETLRO pThis = RT_FROM_MEMBER(pInterface, DRVNETLRO, INetworkConfig);
+    return pThis->pIAboveConfig->pfnGetMac(pThis->pIAboveConfig, pMac);
+}
+
+
+/**
+ * @interface_method_impl{PDMINETWORKCONFIG,pfnGetLinkState}
+ */
+static DECLCALLBACK(PDMNETWORKLINKSTATE) drvNetLroDownCfg_GetLinkState(PPDMINETWORKCONFIG pInterface)
+{
+    PDRVNETLRO pThis = RT_FROM_MEMBER(pInterface, DRVNETLRO, INetworkConfig);
+    return pThis->pIAboveConfig->pfnGetLinkState(pThis->pIAboveConfig);
+}
+
+
+/**
+ * @interface_method_impl{PDMINETWORKCONFIG,pfnSetLinkState}
+ */
+static DECLCALLBACK(int) drvNetLroDownCfg_SetLinkState(PPDMINETWORKCONFIG pInterface, PDMNETWORKLINKSTATE enmState)
+{
+    PDRVNETLRO pThis = RT_FROM_MEMBER(pInterface, DRVNETLRO, INetworkConfig);
+    return pThis->pIAboveConfig->pfnSetLinkState(pThis->pIAboveConfig, enmState);
+}
+
+
+/**
+ * @interface_method_impl{PDMIBASE,pfnQueryInterface}
+ */
+static DECLCALLBACK(void *) drvNetLroQueryInterface(PPDMIBASE pInterface, const char *pszIID)
+{
+    PPDMDRVINS  pDrvIns = PDMIBASE_2_PDMDRV(pInterface);
+    PDRVNETLRO  pThis   = PDMINS_2_DATA(pDrvIns, PDRVNETLRO);
+    PDMIBASE_RETURN_INTERFACE(pszIID, PDMIBASE, &pDrvIns->IBase);
+    PDMIBASE_RETURN_INTERFACE(pszIID, PDMINETWORKUP, &pThis->INetworkUp);
+    PDMIBASE_RETURN_INTERFACE(pszIID, PDMINETWORKDOWN, &pThis->INetworkDown);
+    PDMIBASE_RETURN_INTERFACE(pszIID, PDMINETWORKCONFIG, &pThis->INetworkConfig);
+    return NULL;
+}
+
+
+/**
+ * @interface_method_impl{PDMDRVREG,pfnDetach}
+ */
+static DECLCALLBACK(void) drvNetLroDetach(PPDMDRVINS pDrvIns, uint32_t fFlags)
+{
+    RT_NOREF(fFlags);
+    PDRVNETLRO pThis = PDMINS_2_DATA(pDrvIns, PDRVNETLRO);
+
+    LogFlow(("drvNetLroDetach: pDrvIns: %p, fFlags: %u\n", pDrvIns, fFlags));
+    RTCritSectEnter(&pThis->XmitLock);
+    pThis->pIBelowNet = NULL;
+    RTCritSectLeave(&pThis->XmitLock);
+}
+
+
+/**
+ * @interface_method_impl{PDMDRVREG,pfnAttach}
+ */
+static DECLCALLBACK(int) drvNetLroAttach(PPDMDRVINS pDrvIns, uint32_t fFlags)
+{
+    PDRVNETLRO pThis = PDMINS_2_DATA(pDrvIns, PDRVNETLRO);
+    LogFlow(("drvNetLroAttach/#%#x: fFlags=%#x\n", pDrvIns->iInstance, fFlags));
+    RTCritSectEnter(&pThis->XmitLock);
+
+    /*
+     * Query the network connector interface.
+     */
+    PPDMIBASE   pBaseDown;
+    int rc = PDMDrvHlpAttach(pDrvIns, fFlags, &pBaseDown);
+    if (   rc == VERR_PDM_NO_ATTACHED_DRIVER
+        || rc == VERR_PDM_CFG_MISSING_DRIVER_NAME)
+    {
+        pThis->pIBelowNet = NULL;
+        rc = VINF_SUCCESS;
+    }
+    else if (RT_SUCCESS(rc))
+    {
+        pThis->pIBelowNet = PDMIBASE_QUERY_INTERFACE(pBaseDown, PDMINETWORKUP);
+        if (pThis->pIBelowNet)
+            rc = VINF_SUCCESS;
+        else
+        {
+            AssertMsgFailed(("Configuration error: the driver below didn't export the network connector interface!\n"));
+            rc = VERR_PDM_MISSING_INTERFACE_BELOW;
+        }
+    }
+    else
+        AssertMsgFailed(("Failed to attach to driver below! rc=%Rrc\n", rc));
+
+    RTCritSectLeave(&pThis->XmitLock);
+    return rc;
+}
+
+
+/**
+ * @interface_method_impl{PDMDRVREG,pfnDestruct}
+ */
+static DECLCALLBACK(void) drvNetLroDestruct(PPDMDRVINS pDrvIns)
+{
+    PDRVNETLRO pThis = PDMINS_2_DATA(pDrvIns, PDRVNETLRO);
+    PDMDRV_CHECK_VERSIONS_RETURN_VOID(pDrvIns);
+
+    if (pThis->pFlushThread)
+    {
+        int rc = PDMDrvHlpThreadDestroy(pDrvIns, pThis->pFlushThread, NULL);
+        AssertRC(rc);
+        pThis->pFlushThread = NULL;
+    }
+
+    for (unsigned i = 0; i < RT_ELEMENTS(pThis->aFlows); i++)
+        if (pThis->aFlows[i].pbFrame)
+        {
+            RTMemFree(pThis->aFlows[i].pbFrame);
+            pThis->aFlows[i].pbFrame = NULL;
+        }
+
+    if (pThis->hFlushEvt != NIL_RTSEMEVENT)
+    {
+        RTSemEventDestroy(pThis->hFlushEvt);
+        pThis->hFlushEvt = NIL_RTSEMEVENT;
+    }
+
+    if (RTCritSectIsInitialized(&pThis->RecvLock))
+        RTCritSectDelete(&pThis->RecvLock);
+
+    if (RTCritSectIsInitialized(&pThis->XmitLock))
+        RTCritSectDelete(&pThis->XmitLock);
+}
+
+
+/**
+ * @interface_method_impl{PDMDRVREG,pfnConstruct}
+ */
+static DECLCALLBACK(int) drvNetLroConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg, uint32_t fFlags)
+{
+    PDMDRV_CHECK_VERSIONS_RETURN(pDrvIns);
+    PDRVNETLRO      pThis = PDMINS_2_DATA(pDrvIns, PDRVNETLRO);
+    PCPDMDRVHLPR3   pHlp  = pDrvIns->pHlpR3;
+
+    LogFlow(("drvNetLroConstruct:\n"));
+
+    /*
+     * Init the static parts.
+     */
+    pThis->pDrvIns                                  = pDrvIns;
+    pThis->hFlushEvt                                = NIL_RTSEMEVENT;
+    /* IBase */
+    pDrvIns->IBase.pfnQueryInterface                = drvNetLroQueryInterface;
+    /* INetworkUp */
+    pThis->INetworkUp.pfnBeginXmit                  = drvNetLroUp_BeginXmit;
+    pThis->INetworkUp.pfnAllocBuf                   = drvNetLroUp_AllocBuf;
+    pThis->INetworkUp.pfnFreeBuf                    = drvNetLroUp_FreeBuf;
+    pThis->INetworkUp.pfnSendBuf                    = drvNetLroUp_SendBuf;
+    pThis->INetworkUp.pfnEndXmit                    = drvNetLroUp_EndXmit;
+    pThis->INetworkUp.pfnSetPromiscuousMode         = drvNetLroUp_SetPromiscuousMode;
+    pThis->INetworkUp.pfnNotifyLinkChanged          = drvNetLroUp_NotifyLinkChanged;
+    /* INetworkDown */
+    pThis->INetworkDown.pfnWaitReceiveAvail         = drvNetLroDown_WaitReceiveAvail;
+    pThis->INetworkDown.pfnReceive                  = drvNetLroDown_Receive;
+    pThis->INetworkDown.pfnReceiveGso               = drvNetLroDown_ReceiveGso;
+    pThis->INetworkDown.pfnXmitPending              = drvNetLroDown_XmitPending;
+    /* INetworkConfig */
+    pThis->INetworkConfig.pfnGetMac                 = drvNetLroDownCfg_GetMac;
+    pThis->INetworkConfig.pfnGetLinkState           = drvNetLroDownCfg_GetLinkState;
+    pThis->INetworkConfig.pfnSetLinkState           = drvNetLroDownCfg_SetLinkState;
+
+    /*
+     * Create the locks.
+     */
+    int rc = RTCritSectInit(&pThis->XmitLock);
+    AssertRCReturn(rc, rc);
+    rc = RTCritSectInit(&pThis->RecvLock);
+    AssertRCReturn(rc, rc);
+    rc = RTSemEventCreate(&pThis->hFlushEvt);
+    AssertRCReturn(rc, rc);
+
+    /*
+     * Validate the config.
+     */
+    PDMDRV_VALIDATE_CONFIG_RETURN(pDrvIns, "MaxFrameSize|FlushTimeoutUs", "");
+
+    /** @cfgm{MaxFrameSize, uint32_t, 65535}
+     * The max size of the IP packets produced by coalescing. */
+    rc = pHlp->pfnCFGMQueryU32Def(pCfg, "MaxFrameSize", &pThis->cbMaxIpPkt, UINT16_MAX);
+    if (RT_FAILURE(rc))
+        return PDMDRV_SET_ERROR(pDrvIns, rc, N_("Configuration error: Failed to get the \"MaxFrameSize\" value"));
+    if (pThis->cbMaxIpPkt < 2 * _1K || pThis->cbMaxIpPkt > UINT16_MAX)
+        return PDMDrvHlpVMSetError(pDrvIns, VERR_OUT_OF_RANGE, RT_SRC_POS,
+                                   N_("Configuration error: \"MaxFrameSize\" must be between 2048 and 65535"));
+
+    /** @cfgm{FlushTimeoutUs, uint32_t, 100}
+     * How long a partially coalesced flow is held back at most. */
+    uint32_t cUsFlushTimeout;
+    rc = pHlp->pfnCFGMQueryU32Def(pCfg, "FlushTimeoutUs", &cUsFlushTimeout, DRVNETLRO_FLUSH_TIMEOUT_US_DEFAULT);
+    if (RT_FAILURE(rc))
+        return PDMDRV_SET_ERROR(pDrvIns, rc, N_("Configuration error: Failed to get the \"FlushTimeoutUs\" value"));
+    if (!cUsFlushTimeout || cUsFlushTimeout > RT_US_1SEC)
+        return PDMDrvHlpVMSetError(pDrvIns, VERR_OUT_OF_RANGE, RT_SRC_POS,
+                                   N_("Configuration error: \"FlushTimeoutUs\" must be between 1 and 1000000"));
+    pThis->cNsFlushTimeout = cUsFlushTimeout * RT_NS_1US_64;
+
+    /*
+     * Query the network port interface.
+     */
+    pThis->pIAboveNet = PDMIBASE_QUERY_INTERFACE(pDrvIns->pUpBase, PDMINETWORKDOWN);
+    if (!pThis->pIAboveNet)
+    {
+        AssertMsgFailed(("Configuration error: the above device/driver didn't export the network port interface!\n"));
+        return VERR_PDM_MISSING_INTERFACE_ABOVE;
+    }
+
+    /* Without GSO receive support above there is nothing to coalesce for. */
+    if (!pThis->pIAboveNet->pfnReceiveGso)
+    {
+        LogRel(("NetLro#%u: The device above doesn't support receiving GSO frames, passing frames through\n",
+                pDrvIns->iInstance));
+        pThis->nsIpv4RejectedUntil = UINT64_MAX;
+        pThis->nsIpv6RejectedUntil = UINT64_MAX;
+        pThis->INetworkDown.pfnReceiveGso = NULL;
+    }
+
+    /*
+     * Query the network config interface.
+     */
+    pThis->pIAboveConfig = PDMIBASE_QUERY_INTERFACE(pDrvIns->pUpBase, PDMINETWORKCONFIG);
+    if (!pThis->pIAboveConfig)
+    {
+        AssertMsgFailed(("Configuration error: the above device/driver didn't export the network config interface!\n"));
+        return VERR_PDM_MISSING_INTERFACE_ABOVE;
+    }
+
+    /*
+     * Query the network connector interface.
+     */
+    PPDMIBASE   pBaseDown;
+    rc = PDMDrvHlpAttach(pDrvIns, fFlags, &pBaseDown);
+    if (   rc == VERR_PDM_NO_ATTACHED_DRIVER
+        || rc == VERR_PDM_CFG_MISSING_DRIVER_NAME)
+        pThis->pIBelowNet = NULL;
+    else if (RT_SUCCESS(rc))
+    {
+        pThis->pIBelowNet = PDMIBASE_QUERY_INTERFACE(pBaseDown, PDMINETWORKUP);
+        if (!pThis->pIBelowNet)
+        {
+            AssertMsgFailed(("Configuration error: the driver below didn't export the network connector interface!\n"));
+            return VERR_PDM_MISSING_INTERFACE_BELOW;
+        }
+    }
+    else
+    {
+        AssertMsgFailed(("Failed to attach to driver below! rc=%Rrc\n", rc));
+        return rc;
+    }
+
+    /*
+     * Allocate the flow buffers and start the flush thread.
+     */
+    for (unsigned i = 0; i < RT_ELEMENTS(pThis->aFlows); i++)
+    {
+        pThis->aFlows[i].pbFrame = (uint8_t *)RTMemAlloc(DRVNETLRO_FLOW_BUF_SIZE);
+        if (!pThis->aFlows[i].pbFrame)
+            return VERR_NO_MEMORY;
+    }
+
+    rc = PDMDrvHlpThreadCreate(pDrvIns, &pThis->pFlushThread, pThis, drvNetLroFlushThread,
+                               drvNetLroFlushWakeUp, 0, RTTHREADTYPE_IO, "NetLro");
+    AssertRCReturn(rc, rc);
+
+    /*
+     * Statistics.
+     */
+    PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->StatSegsMerged,      "SegsMerged",       "Number of segments merged into coalesced frames.");
+    PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->StatFramesCoalesced, "FramesCoalesced",  "Number of coalesced frames passed up.");
+    PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->StatFramesPassed,    "FramesPassed",     "Number of frames passed up unchanged.");
+    PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->StatFlushPsh,        "Flush/Psh",        "Flows flushed because of the PSH flag.");
+    PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->StatFlushFull,       "Flush/Full",       "Flows flushed because they reached the max size.");
+    PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->StatFlushMismatch,   "Flush/Mismatch",   "Flows flushed because of an unmergable segment.");
+    PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->StatFlushTimeout,    "Flush/Timeout",    "Flows flushed by the timeout.");
+    PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->StatFlushEvict,      "Flush/Evict",      "Flows flushed to make room for a new flow.");
+    PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->StatGsoRejected,     "GsoRejected",      "Coalesced frames rejected by the device above.");
+    PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->StatDropped,         "Dropped",          "Frames dropped because the device above had no room.");
+    PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->StatBadChecksum,     "BadChecksum",      "Segments passed up unmerged because of bad checksums.");
+
+    LogRel(("NetLro#%u: Max IP packet size %u, flush timeout %u us\n", pDrvIns->iInstance, pThis->cbMaxIpPkt, cUsFlushTimeout));
+    return VINF_SUCCESS;
+}
+
+
+
+/**
+ * Network LRO filter driver registration record.
+ */
+const PDMDRVREG g_DrvNetLro =
+{
+    /* u32Version */
+    PDM_DRVREG_VERSION,
+    /* szName */
+    "NetLro",
+    /* szRCMod */
+    "",
+    /* szR0Mod */
+    "",
+    /* pszDescription */
+    "Network Large Receive Offload Filter Driver",
+    /* fFlags */
+    PDM_DRVREG_FLAGS_HOST_BITS_DEFAULT,
+    /* fClass. */
+    PDM_DRVREG_CLASS_NETWORK,
+    /* cMaxInstances */
+    UINT32_MAX,
+    /* cbInstance */
+    sizeof(DRVNETLRO),
+    /* pfnConstruct */
+    drvNetLroConstruct,
+    /* pfnDestruct */
+    drvNetLroDestruct,
+    /* pfnRelocate */
+    NULL,
+    /* pfnIOCtl */
+    NULL,
+    /* pfnPowerOn */
+    NULL,
+    /* pfnReset */
+    NULL,
+    /* pfnSuspend */
+    NULL,
+    /* pfnResume */
+    NULL,
+    /* pfnAttach */
+    drvNetLroAttach,
+    /* pfnDetach */
+    drvNetLroDetach,
+    /* pfnPowerOff */
+    NULL,
+    /* pfnSoftReset */
+    NULL,
+    /* u32EndVersion */
+    PDM_DRVREG_VERSION
+};
+
@@ -34,10 +34,14 @@
 #include <VBox/vmm/pdmnetifs.h>
 
 #include <VBox/log.h>
+#include <iprt/asm.h>
 #include <iprt/assert.h>
 #include <iprt/critsect.h>
 #include <iprt/file.h>
+#include <iprt/mem.h>
 #include <iprt/process.h>
+#include <iprt/semaphore.h>
+#include <iprt/stream.h>
 #include <iprt/string.h>
 #include <iprt/time.h>
 #include <iprt/uuid.h>
@@ -48,9 +52,86 @@
 #include "VBoxDD.h"
 
 
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** The default capture ring buffer size (per direction) for the pcapng mode. */
+#define DRVNETSNIFFER_RING_SIZE_DEFAULT     _2M
+/** How long the writer thread sleeps between draining the rings (ms). */
+#define DRVNETSNIFFER_WRITER_INTERVAL_MS    20
+
+
 /*********************************************************************************************************************************
 *   Structures and Typedefs                                                                                                      *
 *********************************************************************************************************************************/
+/**
+ * Capture file formats.
+ */
+typedef enum DRVNETSNIFFERFMT
+{
+    /** Classic libpcap, written synchronously on the I/O thread. */
+    DRVNETSNIFFERFMT_PCAP = 0,
+    /** pcapng with nanosecond timestamps, written by a dedicated writer thread. */
+    DRVNETSNIFFERFMT_PCAPNG
+} DRVNETSNIFFERFMT;
+
+/**
+ * Record header in a capture ring.
+ *
+ * The frame data follows immediately.  Records never wrap around the end of the
+ * ring, the producer skips the tail end when there isn't room for the whole
+ * record (see drvNetSnifferRingPut).
+ */
+typedef struct DRVNETSNIFFERREC
+{
+    /** The size of the record including this header, 8 byte aligned. */
+    uint32_t                cbRec;
+    /** The original frame size. */
+    uint32_t                cbFrame;
+    /** Number of frame bytes stored after the header. */
+    uint32_t                cbData;
+    /** PCAPNG_EPB_F_XXX. */
+    uint32_t                fFlags;
+    /** The capture timestamp (nanoseconds since the epoch). */
+    uint64_t                NanoTS;
+    /** The GSO context if fGso is set. */
+    PDMNETWORKGSO           Gso;
+    /** Whether this is a GSO frame. */
+    bool                    fGso;
+    /** Explicit padding. */
+    uint8_t                 abPadding[7];
+} DRVNETSNIFFERREC;
+AssertCompileSizeAlignment(DRVNETSNIFFERREC, 8);
+/** Pointer to a capture ring record. */
+typedef DRVNETSNIFFERREC *PDRVNETSNIFFERREC;
+
+/**
+ * Single producer, single consumer capture ring.
+ *
+ * There is one ring per direction, as transmits are serialized by
+ * pfnBeginXmit/pfnEndXmit and receives come from the single receive thread of
+ * the driver below us, so no producer side locking is needed.
+ */
+typedef struct DRVNETSNIFFERRING
+{
+    /** The ring buffer. */
+    uint8_t                *pbBuf;
+    /** The ring buffer size (power of two). */
+    uint32_t                cbBuf;
+    /** PCAPNG_EPB_F_XXX direction for frames in this ring. */
+    uint32_t                fDir;
+    /** The producer offset (free running). */
+    uint64_t volatile       offWrite;
+    /** The consumer offset (free running). */
+    uint64_t volatile       offRead;
+    /** Number of frames seen. */
+    STAMCOUNTER             StatFrames;
+    /** Number of frames dropped because the ring was full. */
+    STAMCOUNTER             StatDropped;
+} DRVNETSNIFFERRING;
+/** Pointer to a capture ring. */
+typedef DRVNETSNIFFERRING *PDRVNETSNIFFERRING;
+
 /**
  * Block driver instance data.
  *
@@ -86,10 +167,342 @@ typedef struct DRVNETSNIFFER
     /** For when we're the leaf driver. */
     RTCRITSECT              XmitLock;
 
+    /** The capture file format. */
+    DRVNETSNIFFERFMT        enmFmt;
+    /** The snap length, i.e. max number of bytes saved per frame (UINT32_MAX
+     *  when unlimited). */
+    uint32_t                cbSnapLen;
+
+    /** @name pcapng mode.
+     * @{ */
+    /** The output stream for the writer thread. */
+    PRTSTREAM               pStream;
+    /** The receive (inbound) ring. */
+    DRVNETSNIFFERRING       RingRx;
+    /** The transmit (outbound) ring. */
+    DRVNETSNIFFERRING       RingTx;
+    /** Offset to add to RTTimeNanoTS to get nanoseconds since the epoch. */
+    int64_t                 offEpochNanoTS;
+    /** The writer thread. */
+    PPDMTHREAD              pWriterThread;
+    /** Event semaphore the writer thread waits on. */
+    RTSEMEVENT              hWriterEvt;
+    /** Bytes written to the current file. */
+    size_t                  cbFileCur;
+    /** Max file size before rotating to a new file, 0 if no rotation. */
+    uint64_t                cbMaxFile;
+    /** Number of rotated files to keep, 0 for unlimited. */
+    uint32_t                cMaxFiles;
+    /** The sequence number of the current file when rotating. */
+    uint32_t                iFileSeq;
+    /** Whether a write error was logged already. */
+    bool                    fWriteErrorLogged;
+    /** Number of frames written. */
+    STAMCOUNTER             StatFramesWritten;
+    /** Number of bytes written. */
+    STAMCOUNTER             StatBytesWritten;
+    /** Number of file rotations. */
+    STAMCOUNTER             StatRotations;
+    /** @} */
 } DRVNETSNIFFER, *PDRVNETSNIFFER;
 
 
 
+/*
+ *
+ * pcapng capture rings and writer thread.
+ *
+ */
+
+/**
+ * Copies a frame into a capture ring.
+ *
+ * Called by the (single) producer of the ring, never blocks.  The frame is
+ * dropped and counted if the ring is full.
+ *
+ * @param   pThis           The sniffer instance.
+ * @param   pRing           The ring to put the frame into.
+ * @param   pGso            The GSO context, NULL if not a GSO frame.
+ * @param   pvFrame         The frame.
+ * @param   cbFrame         The size of the frame.
+ * @param   cbAvail         Number of frame bytes available at @a pvFrame.
+ */
+static void drvNetSnifferRingPut(PDRVNETSNIFFER pThis, PDRVNETSNIFFERRING pRing, PCPDMNETWORKGSO pGso,
+                                 const void *pvFrame, size_t cbFrame, size_t cbAvail)
+{
+    STAM_REL_COUNTER_INC(&pRing->StatFrames);
+
+    /* GSO frames need the complete frame for carving segments on the writer
+       thread, the snap length is applied per segment there. */
+    uint32_t const cbData = (uint32_t)(pGso ? cbAvail : RT_MIN(cbAvail, pThis->cbSnapLen));
+    uint32_t const cbRec  = RT_ALIGN_32(sizeof(DRVNETSNIFFERREC) + cbData, 8);
+
+    uint64_t const offRead  = ASMAtomicReadU64(&pRing->offRead);
+    uint64_t       offWrite = pRing->offWrite;
+    uint32_t       offBuf   = (uint32_t)offWrite & (pRing->cbBuf - 1);
+    uint32_t const cbTail   = pRing->cbBuf - offBuf;
+    uint32_t const cbSkip   = cbTail < cbRec ? cbTail : 0;
+    if (RT_UNLIKELY(pRing->cbBuf - (offWrite - offRead) < (uint64_t)cbRec + cbSkip))
+    {
+        STAM_REL_COUNTER_INC(&pRing->StatDropped);
+        return;
+    }
+
+    /* Skip the tail end of the ring if the record doesn't fit there.  The
+       consumer recognizes this by a zero cbRec or a tail too small for a header. */
+    if (cbSkip)
+    {
+        if (cbSkip >= sizeof(DRVNETSNIFFERREC))
+            ((PDRVNETSNIFFERREC)&pRing->pbBuf[offBuf])->cbRec = 0;
+        offWrite += cbSkip;
+        offBuf    = 0;
+    }
+
+    PDRVNETSNIFFERREC pRec = (PDRVNETSNIFFERREC)&pRing->pbBuf[offBuf];
+    pRec->cbRec   = cbRec;
+    pRec->cbFrame = (uint32_t)cbFrame;
+    pRec->cbData  = cbData;
+    pRec->fFlags  = pRing->fDir;
+    pRec->NanoTS  = RTTimeNanoTS() + pThis->offEpochNanoTS;
+    pRec->fGso    = pGso != NULL;
+    if (pGso)
+        pRec->Gso = *pGso;
+    memcpy(pRec + 1, pvFrame, cbData);
+
+    ASMAtomicWriteU64(&pRing->offWrite, offWrite + cbRec);
+
+    /* Kick the writer when the ring is getting full, otherwise let it batch up. */
+    if (offWrite + cbRec - offRead >= pRing->cbBuf / 4)
+        RTSemEventSignal(pThis->hWriterEvt);
+}
+
+
+/**
+ * Gets the next record from a capture ring, skipping the tail end padding.
+ *
+ * @returns Pointer to the record, NULL if the ring is empty.
+ * @param   pRing           The ring.
+ */
+static PDRVNETSNIFFERREC drvNetSnifferRingPeek(PDRVNETSNIFFERRING pRing)
+{
+    uint64_t const offWrite = ASMAtomicReadU64(&pRing->offWrite);
+    uint64_t       offRead  = pRing->offRead;
+    if (offRead == offWrite)
+        return NULL;
+
+    uint32_t const offBuf = (uint32_t)offRead & (pRing->cbBuf - 1);
+    uint32_t const cbTail = pRing->cbBuf - offBuf;
+    if (   cbTail < sizeof(DRVNETSNIFFERREC)
+        || ((PDRVNETSNIFFERREC)&pRing->pbBuf[offBuf])->cbRec == 0)
+    {
+        offRead += cbTail;
+        ASMAtomicWriteU64(&pRing->offRead, offRead);
+        if (offRead == offWrite)
+            return NULL;
+        return (PDRVNETSNIFFERREC)&pRing->pbBuf[0];
+    }
+    return (PDRVNETSNIFFERREC)&pRing->pbBuf[offBuf];
+}
+
+
+/**
+ * Formats the name of the capture file with the given sequence number.
+ *
+ * Without rotation this is just the configured filename, otherwise the
+ * sequence number is inserted before the suffix: capture-00001.pcapng.
+ */
+static void drvNetSnifferFormatFilename(PDRVNETSNIFFER pThis, uint32_t iSeq, char *pszDst, size_t cbDst)
+{
+    if (!pThis->cbMaxFile)
+    {
+        RTStrCopy(pszDst, cbDst, pThis->szFilename);
+        return;
+    }
+    const char  *pszSuff = RTPathSuffix(pThis->szFilename);
+    size_t const cchBase = pszSuff ? (size_t)(pszSuff - pThis->szFilename) : strlen(pThis->szFilename);
+    RTStrPrintf(pszDst, cbDst, "%.*s-%05u%s", cchBase, pThis->szFilename, iSeq, pszSuff ? pszSuff : "");
+}
+
+
+/**
+ * Opens the next pcapng file and writes the header blocks.
+ *
+ * @returns VBox status code.
+ * @param   pThis           The sniffer instance.
+ */
+static int drvNetSnifferNgOpen(PDRVNETSNIFFER pThis)
+{
+    char szFilename[RTPATH_MAX];
+    drvNetSnifferFormatFilename(pThis, pThis->iFileSeq, szFilename, sizeof(szFilename));
+    int rc = RTStrmOpen(szFilename, "wb", &pThis->pStream);
+    if (RT_SUCCESS(rc))
+    {
+        char szIfName[32];
+        RTStrPrintf(szIfName, sizeof(szIfName), "NetSniffer#%u", pThis->pDrvIns->iInstance);
+        pThis->cbFileCur = 0;
+        rc = PcapNgStreamHdr(pThis->pStream, szIfName, pThis->cbSnapLen == UINT32_MAX ? 0 : pThis->cbSnapLen,
+                             &pThis->cbFileCur);
+        if (RT_SUCCESS(rc))
+        {
+            /* Drop the oldest file if we're limiting the number of files. */
+            if (pThis->cMaxFiles && pThis->iFileSeq >= pThis->cMaxFiles)
+            {
+                drvNetSnifferFormatFilename(pThis, pThis->iFileSeq - pThis->cMaxFiles, szFilename, sizeof(szFilename));
+                RTFileDelete(szFilename);
+            }
+        }
+    }
+    return rc;
+}
+
+
+/**
+ * Writes the statistics block and closes the current pcapng file.
+ *
+ * @param   pThis           The sniffer instance.
+ */
+static void drvNetSnifferNgClose(PDRVNETSNIFFER pThis)
+{
+    if (pThis->pStream)
+    {
+        uint64_t const cFrames  = pThis->RingRx.StatFrames.c  + pThis->RingTx.StatFrames.c;
+        uint64_t const cDropped = pThis->RingRx.StatDropped.c + pThis->RingTx.StatDropped.c;
+        PcapNgStreamStats(pThis->pStream, 0 /*idIf*/, RTTimeNanoTS() + pThis->offEpochNanoTS, cFrames, cDropped, NULL);
+        RTStrmClose(pThis->pStream);
+        pThis->pStream = NULL;
+    }
+}
+
+
+/**
+ * Writes one record from a capture ring to the pcapng file and advances the
+ * ring read position.
+ *
+ * @param   pThis           The sniffer instance.
+ * @param   pRing           The ring.
+ * @param   pRec            The record (from drvNetSnifferRingPeek).
+ */
+static void drvNetSnifferNgWriteRec(PDRVNETSNIFFER pThis, PDRVNETSNIFFERRING pRing, PDRVNETSNIFFERREC pRec)
+{
+    if (pThis->pStream)
+    {
+        size_t const cbBefore = pThis->cbFileCur;
+        int rc;
+        if (!pRec->fGso)
+            rc = PcapNgStreamFrame(pThis->pStream, 0 /*idIf*/, pRec->NanoTS, pRec->fFlags,
+                                   pRec + 1, pRec->cbFrame, pRec->cbData, &pThis->cbFileCur);
+        else
+            rc = PcapNgStreamGsoFrame(pThis->pStream, 0 /*idIf*/, pRec->NanoTS, pRec->fFlags, &pRec->Gso,
+                                      pRec + 1, pRec->cbData, pThis->cbSnapLen, &pThis->cbFileCur);
+        if (RT_SUCCESS(rc))
+        {
+            STAM_REL_COUNTER_INC(&pThis->StatFramesWritten);
+            STAM_REL_COUNTER_ADD(&pThis->StatBytesWritten, pThis->cbFileCur - cbBefore);
+        }
+        else if (!pThis->fWriteErrorLogged)
+        {
+            pThis->fWriteErrorLogged = true;
+            LogRel(("NetSniffer#%u: Writing to the capture file failed: %Rrc\n", pThis->pDrvIns->iInstance, rc));
+        }
+    }
+
+    ASMAtomicWriteU64(&pRing->offRead, pRing->offRead + pRec->cbRec);
+}
+
+
+/**
+ * Drains both capture rings into the pcapng file, merging them in timestamp
+ * order, and rotates the file when it has grown too big.
+ *
+ * @param   pThis           The sniffer instance.
+ */
+static void drvNetSnifferNgDrain(PDRVNETSNIFFER pThis)
+{
+    for (;;)
+    {
+        PDRVNETSNIFFERREC pRecRx = drvNetSnifferRingPeek(&pThis->RingRx);
+        PDRVNETSNIFFERREC pRecTx = drvNetSnifferRingPeek(&pThis->RingTx);
+        if (pRecRx && (!pRecTx || pRecRx->NanoTS <= pRecTx->NanoTS))
+            drvNetSnifferNgWriteRec(pThis, &pThis->RingRx, pRecRx);
+        else if (pRecTx)
+            drvNetSnifferNgWriteRec(pThis, &pThis->RingTx, pRecTx);
+        else
+            break;
+
+        if (   pThis->cbMaxFile
+            && pThis->cbFileCur >= pThis->cbMaxFile
+            && pThis->pStream)
+        {
+            drvNetSnifferNgClose(pThis);
+            pThis->iFileSeq++;
+            int rc = drvNetSnifferNgOpen(pThis);
+            if (RT_FAILURE(rc))
+                LogRel(("NetSniffer#%u: Failed to open the next capture file: %Rrc\n", pThis->pDrvIns->iInstance, rc));
+            STAM_REL_COUNTER_INC(&pThis->StatRotations);
+        }
+    }
+
+    if (pThis->pStream)
+        RTStrmFlush(pThis->pStream);
+}
+
+
+/**
+ * The pcapng writer thread.
+ *
+ * @returns VBox status code. Returning failure will naturally terminate the thread.
+ * @param   pDrvIns     The sniffer driver instance.
+ * @param   pThread     The thread.
+ */
+static DECLCALLBACK(int) drvNetSnifferWriterThread(PPDMDRVINS pDrvIns, PPDMTHREAD pThread)
+{
+    PDRVNETSNIFFER pThis = PDMINS_2_DATA(pDrvIns, PDRVNETSNIFFER);
+
+    if (pThread->enmState == PDMTHREADSTATE_INITIALIZING)
+        return VINF_SUCCESS;
+
+    while (pThread->enmState == PDMTHREADSTATE_RUNNING)
+    {
+        drvNetSnifferNgDrain(pThis);
+
+        int rc = RTSemEventWait(pThis->hWriterEvt, DRVNETSNIFFER_WRITER_INTERVAL_MS);
+        AssertLogRelMsgReturn(RT_SUCCESS(rc) || rc == VERR_TIMEOUT || rc == VERR_INTERRUPTED, ("%Rrc\n", rc), rc);
+    }
+
+    /* Flush whatever is left when suspending or terminating. */
+    drvNetSnifferNgDrain(pThis);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @copydoc FNPDMTHREADWAKEUPDRV
+ */
+static DECLCALLBACK(int) drvNetSnifferWriterWakeUp(PPDMDRVINS pDrvIns, PPDMTHREAD pThread)
+{
+    RT_NOREF(pThread);
+    PDRVNETSNIFFER pThis = PDMINS_2_DATA(pDrvIns, PDRVNETSNIFFER);
+    return RTSemEventSignal(pThis->hWriterEvt);
+}
+
+
+/**
+ * Initializes a capture ring.
+ */
+static int drvNetSnifferRingInit(PDRVNETSNIFFERRING pRing, uint32_t cbBuf, uint32_t fDir)
+{
+    pRing->pbBuf = (uint8_t *)RTMemPageAllocZ(cbBuf);
+    if (!pRing->pbBuf)
+        return VERR_NO_MEMORY;
+    pRing->cbBuf    = cbBuf;
+    pRing->fDir     = fDir;
+    pRing->offRead  = 0;
+    pRing->offWrite = 0;
+    return VINF_SUCCESS;
+}
+
+
+
 /**
  * @interface_method_impl{PDMINETWORKUP,pfnBeginXmit}
  */
@@ -142,18 +555,24 @@ static DECLCALLBACK(int) drvNetSnifferUp_SendBuf(PPDMINETWORKUP pInterface, PPDM
         return VERR_NET_DOWN;
 
     /* output to sniffer */
-    RTCritSectEnter(&pThis->Lock);
-    if (!pSgBuf->pvUser)
-        PcapFileFrame(pThis->hFile, pThis->StartNanoTS,
-                      pSgBuf->aSegs[0].pvSeg,
-                      pSgBuf->cbUsed,
-                      RT_MIN(pSgBuf->cbUsed, pSgBuf->aSegs[0].cbSeg));
+    if (pThis->enmFmt == DRVNETSNIFFERFMT_PCAPNG)
+        drvNetSnifferRingPut(pThis, &pThis->RingTx, (PCPDMNETWORKGSO)pSgBuf->pvUser, pSgBuf->aSegs[0].pvSeg,
+                             pSgBuf->cbUsed, RT_MIN(pSgBuf->cbUsed, pSgBuf->aSegs[0].cbSeg));
     else
-        PcapFileGsoFrame(pThis->hFile, pThis->StartNanoTS, (PCPDMNETWORKGSO)pSgBuf->pvUser,
-                         pSgBuf->aSegs[0].pvSeg,
-                         pSgBuf->cbUsed,
-                         RT_MIN(pSgBuf->cbUsed, pSgBuf->aSegs[0].cbSeg));
-    RTCritSectLeave(&pThis->Lock);
+    {
+        RTCritSectEnter(&pThis->Lock);
+        if (!pSgBuf->pvUser)
+            PcapFileFrame(pThis->hFile, pThis->StartNanoTS,
+                          pSgBuf->aSegs[0].pvSeg,
+                          pSgBuf->cbUsed,
+                          RT_MIN(RT_MIN(pSgBuf->cbUsed, pSgBuf->aSegs[0].cbSeg), pThis->cbSnapLen));
+        else
+            PcapFileGsoFrame(pThis->hFile, pThis->StartNanoTS, (PCPDMNETWORKGSO)pSgBuf->pvUser,
+                             pSgBuf->aSegs[0].pvSeg,
+                             pSgBuf->cbUsed,
+                             RT_MIN(RT_MIN(pSgBuf->cbUsed, pSgBuf->aSegs[0].cbSeg), pThis->cbSnapLen));
+        RTCritSectLeave(&pThis->Lock);
+    }
 
     return pThis->pIBelowNet->pfnSendBuf(pThis->pIBelowNet, pSgBuf, fOnWorkerThread);
 }
@@ -215,9 +634,14 @@ static DECLCALLBACK(int) drvNetSnifferDown_Receive(PPDMINETWORKDOWN pInterface,
     PDRVNETSNIFFER pThis = RT_FROM_MEMBER(pInterface, DRVNETSNIFFER, INetworkDown);
 
     /* output to sniffer */
-    RTCritSectEnter(&pThis->Lock);
-    PcapFileFrame(pThis->hFile, pThis->StartNanoTS, pvBuf, cb, cb);
-    RTCritSectLeave(&pThis->Lock);
+    if (pThis->enmFmt == DRVNETSNIFFERFMT_PCAPNG)
+        drvNetSnifferRingPut(pThis, &pThis->RingRx, NULL, pvBuf, cb, cb);
+    else
+    {
+        RTCritSectEnter(&pThis->Lock);
+        PcapFileFrame(pThis->hFile, pThis->StartNanoTS, pvBuf, cb, RT_MIN(cb, pThis->cbSnapLen));
+        RTCritSectLeave(&pThis->Lock);
+    }
 
     /* pass up */
     int rc = pThis->pIAboveNet->pfnReceive(pThis->pIAboveNet, pvBuf, cb);
@@ -363,6 +787,40 @@ static DECLCALLBACK(void) drvNetSnifferDestruct(PPDMDRVINS pDrvIns)
     PDRVNETSNIFFER pThis = PDMINS_2_DATA(pDrvIns, PDRVNETSNIFFER);
     PDMDRV_CHECK_VERSIONS_RETURN_VOID(pDrvIns);
 
+    /*
+     * Stop the pcapng writer, flush what's left in the rings and report drops.
+     */
+    if (pThis->pWriterThread)
+    {
+        int rc = PDMDrvHlpThreadDestroy(pDrvIns, pThis->pWriterThread, NULL);
+        AssertRC(rc);
+        pThis->pWriterThread = NULL;
+    }
+    if (pThis->enmFmt == DRVNETSNIFFERFMT_PCAPNG)
+    {
+        if (pThis->RingRx.pbBuf && pThis->RingTx.pbBuf)
+            drvNetSnifferNgDrain(pThis);
+        drvNetSnifferNgClose(pThis);
+        if (pThis->RingRx.StatDropped.c || pThis->RingTx.StatDropped.c)
+            LogRel(("NetSniffer#%u: Dropped %RU64 received and %RU64 transmitted frames (capture ring full)\n",
+                    pDrvIns->iInstance, pThis->RingRx.StatDropped.c, pThis->RingTx.StatDropped.c));
+    }
+    if (pThis->RingRx.pbBuf)
+    {
+        RTMemPageFree(pThis->RingRx.pbBuf, pThis->RingRx.cbBuf);
+        pThis->RingRx.pbBuf = NULL;
+    }
+    if (pThis->RingTx.pbBuf)
+    {
+        RTMemPageFree(pThis->RingTx.pbBuf, pThis->RingTx.cbBuf);
+        pThis->RingTx.pbBuf = NULL;
+    }
+    if (pThis->hWriterEvt != NIL_RTSEMEVENT)
+    {
+        RTSemEventDestroy(pThis->hWriterEvt);
+        pThis->hWriterEvt = NIL_RTSEMEVENT;
+    }
+
     if (RTCritSectIsInitialized(&pThis->Lock))
         RTCritSectDelete(&pThis->Lock);
 
@@ -394,6 +852,7 @@ static DECLCALLBACK(int) drvNetSnifferConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pC
      */
     pThis->pDrvIns                                  = pDrvIns;
     pThis->hFile                                    = NIL_RTFILE;
+    pThis->hWriterEvt                               = NIL_RTSEMEVENT;
     /* The pcap file *must* start at time offset 0,0. */
     pThis->StartNanoTS                              = RTTimeNanoTS() - RTTimeProgramNanoTS();
     /* IBase */
@@ -426,7 +885,7 @@ static DECLCALLBACK(int) drvNetSnifferConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pC
     /*
      * Validate the config.
      */
-    PDMDRV_VALIDATE_CONFIG_RETURN(pDrvIns, "File", "");
+    PDMDRV_VALIDATE_CONFIG_RETURN(pDrvIns, "File|Format|SnapLen|RingBufferSize|MaxFileSize|MaxFiles", "");
 
     if (pHlp->pfnCFGMGetFirstChild(pCfg))
         LogRel(("NetSniffer: Found child config entries -- are you trying to redirect ports?\n"));
@@ -449,6 +908,45 @@ static DECLCALLBACK(int) drvNetSnifferConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pC
         return rc;
     }
 
+    /*
+     * Get the capture format and its parameters.
+     */
+    char szFormat[16];
+    rc = pHlp->pfnCFGMQueryStringDef(pCfg, "Format", szFormat, sizeof(szFormat), "pcap");
+    if (RT_FAILURE(rc))
+        return PDMDRV_SET_ERROR(pDrvIns, rc, N_("Configuration error: Failed to get the \"Format\" value"));
+    if (!RTStrICmp(szFormat, "pcap"))
+        pThis->enmFmt = DRVNETSNIFFERFMT_PCAP;
+    else if (!RTStrICmp(szFormat, "pcapng"))
+        pThis->enmFmt = DRVNETSNIFFERFMT_PCAPNG;
+    else
+        return PDMDrvHlpVMSetError(pDrvIns, VERR_INVALID_PARAMETER, RT_SRC_POS,
+                                   N_("Configuration error: Unknown \"Format\" value '%s', expected 'pcap' or 'pcapng'"), szFormat);
+
+    rc = pHlp->pfnCFGMQueryU32Def(pCfg, "SnapLen", &pThis->cbSnapLen, 0);
+    if (RT_FAILURE(rc))
+        return PDMDRV_SET_ERROR(pDrvIns, rc, N_("Configuration error: Failed to get the \"SnapLen\" value"));
+    if (!pThis->cbSnapLen)
+        pThis->cbSnapLen = UINT32_MAX;
+
+    uint32_t cbRing;
+    rc = pHlp->pfnCFGMQueryU32Def(pCfg, "RingBufferSize", &cbRing, DRVNETSNIFFER_RING_SIZE_DEFAULT);
+    if (RT_FAILURE(rc))
+        return PDMDRV_SET_ERROR(pDrvIns, rc, N_("Configuration error: Failed to get the \"RingBufferSize\" value"));
+    if (cbRing < _64K || cbRing > _256M || !RT_IS_POWER_OF_TWO(cbRing))
+        return PDMDrvHlpVMSetError(pDrvIns, VERR_OUT_OF_RANGE, RT_SRC_POS,
+                                   N_("Configuration error: \"RingBufferSize\" must be a power of two between 64KB and 256MB"));
+
+    rc = pHlp->pfnCFGMQueryU64Def(pCfg, "MaxFileSize", &pThis->cbMaxFile, 0);
+    if (RT_FAILURE(rc))
+        return PDMDRV_SET_ERROR(pDrvIns, rc, N_("Configuration error: Failed to get the \"MaxFileSize\" value"));
+    rc = pHlp->pfnCFGMQueryU32Def(pCfg, "MaxFiles", &pThis->cMaxFiles, 0);
+    if (RT_FAILURE(rc))
+        return PDMDRV_SET_ERROR(pDrvIns, rc, N_("Configuration error: Failed to get the \"MaxFiles\" value"));
+    if (pThis->cbMaxFile && pThis->enmFmt != DRVNETSNIFFERFMT_PCAPNG)
+        return PDMDrvHlpVMSetError(pDrvIns, VERR_NOT_SUPPORTED, RT_SRC_POS,
+                                   N_("Configuration error: \"MaxFileSize\" requires the 'pcapng' format"));
+
     /*
      * Query the network port interface.
      */
@@ -492,6 +990,46 @@ static DECLCALLBACK(int) drvNetSnifferConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pC
         return rc;
     }
 
+    /*
+     * In pcapng mode the frames are copied into per direction rings on the I/O
+     * threads and written out by a dedicated writer thread.
+     */
+    if (pThis->enmFmt == DRVNETSNIFFERFMT_PCAPNG)
+    {
+        RTTIMESPEC Now;
+        pThis->offEpochNanoTS = RTTimeSpecGetNano(RTTimeNow(&Now)) - (int64_t)RTTimeNanoTS();
+
+        rc = RTSemEventCreate(&pThis->hWriterEvt);
+        AssertRCReturn(rc, rc);
+        rc = drvNetSnifferRingInit(&pThis->RingRx, cbRing, PCAPNG_EPB_F_DIR_INBOUND);
+        if (RT_SUCCESS(rc))
+            rc = drvNetSnifferRingInit(&pThis->RingTx, cbRing, PCAPNG_EPB_F_DIR_OUTBOUND);
+        if (RT_FAILURE(rc))
+            return PDMDrvHlpVMSetError(pDrvIns, rc, RT_SRC_POS, N_("NetSniffer: Failed to allocate the capture rings"));
+
+        rc = drvNetSnifferNgOpen(pThis);
+        if (RT_FAILURE(rc))
+            return PDMDrvHlpVMSetError(pDrvIns, rc, RT_SRC_POS,
+                                       N_("Netsniffer cannot open '%s' for writing. The directory must exist and it must be writable for the current user"), pThis->szFilename);
+
+        PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->RingRx.StatFrames,   "Rx/Frames",  "Number of received frames seen by the capture ring.");
+        PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->RingRx.StatDropped,  "Rx/Dropped", "Number of received frames dropped because the capture ring was full.");
+        PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->RingTx.StatFrames,   "Tx/Frames",  "Number of transmitted frames seen by the capture ring.");
+        PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->RingTx.StatDropped,  "Tx/Dropped", "Number of transmitted frames dropped because the capture ring was full.");
+        PDMDrvHlpSTAMRegCounterEx(pDrvIns, &pThis->StatFramesWritten, "FramesWritten", STAMUNIT_COUNT,       "Number of frames written to the capture file.");
+        PDMDrvHlpSTAMRegCounterEx(pDrvIns, &pThis->StatBytesWritten,  "BytesWritten",  STAMUNIT_BYTES,       "Number of bytes written to the capture file.");
+        PDMDrvHlpSTAMRegCounterEx(pDrvIns, &pThis->StatRotations,     "Rotations",     STAMUNIT_OCCURENCES,  "Number of capture file rotations.");
+
+        rc = PDMDrvHlpThreadCreate(pDrvIns, &pThis->pWriterThread, pThis, drvNetSnifferWriterThread,
+                                   drvNetSnifferWriterWakeUp, 0, RTTHREADTYPE_IO, "NetSnifferW");
+        AssertRCReturn(rc, rc);
+
+        LogRel(("NetSniffer: Sniffing to '%s' (pcapng, ring %u KB, snaplen %u, max file size %RU64, max files %u)\n",
+                pThis->szFilename, cbRing / _1K, pThis->cbSnapLen == UINT32_MAX ? 0 : pThis->cbSnapLen,
+                pThis->cbMaxFile, pThis->cMaxFiles));
+        return VINF_SUCCESS;
+    }
+
     /*
      * Open output file / pipe.
      */
@@ -1,6 +1,6 @@
 /* $Id: Pcap.cpp $ */
 /** @file
- * Helpers for writing libpcap files.
+ * Helpers for writing libpcap and pcapng files.
  */
 
 /*
@@ -35,9 +35,41 @@
 #include <iprt/stream.h>
 #include <iprt/time.h>
 #include <iprt/errcore.h>
+#include <iprt/string.h>
 #include <VBox/vmm/pdmnetinline.h>
 
 
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** pcapng Section Header Block type. */
+#define PCAPNG_SHB_BLOCK_TYPE           UINT32_C(0x0a0d0d0a)
+/** pcapng byte order magic value. */
+#define PCAPNG_SHB_BYTE_ORDER_MAGIC     UINT32_C(0x1a2b3c4d)
+/** pcapng Interface Description Block type. */
+#define PCAPNG_IDB_BLOCK_TYPE           UINT32_C(0x00000001)
+/** pcapng Interface Statistics Block type. */
+#define PCAPNG_ISB_BLOCK_TYPE           UINT32_C(0x00000005)
+/** pcapng Enhanced Packet Block type. */
+#define PCAPNG_EPB_BLOCK_TYPE           UINT32_C(0x00000006)
+/** Ethernet link type. */
+#define PCAPNG_LINK_TYPE_ETHERNET       UINT16_C(1)
+
+/** @name pcapng option codes.
+ * @{ */
+#define PCAPNG_OPT_END                  UINT16_C(0)
+#define PCAPNG_OPT_SHB_USERAPPL         UINT16_C(4)
+#define PCAPNG_OPT_IDB_NAME             UINT16_C(2)
+#define PCAPNG_OPT_IDB_TSRESOL          UINT16_C(9)
+#define PCAPNG_OPT_EPB_FLAGS            UINT16_C(2)
+#define PCAPNG_OPT_ISB_IFRECV           UINT16_C(4)
+#define PCAPNG_OPT_ISB_IFDROP           UINT16_C(5)
+/** @} */
+
+/** Size of the on-stack buffer used for composing block headers and options. */
+#define PCAPNG_HDR_BUF_SIZE             256
+
+
 /*********************************************************************************************************************************
 *   Structures and Typedefs                                                                                                      *
 *********************************************************************************************************************************/
@@ -71,6 +103,33 @@ struct pcaprec_hdr_init
     struct pcap_hdr     pcap;
 };
 
+/** pcapng Enhanced Packet Block header (fixed part). */
+struct pcapng_epb_hdr
+{
+    uint32_t    block_type;     /* PCAPNG_EPB_BLOCK_TYPE */
+    uint32_t    block_len;      /* total block length, including the trailing copy */
+    uint32_t    if_id;          /* interface ID (index of the IDB) */
+    uint32_t    ts_high;        /* upper 32 bits of the timestamp */
+    uint32_t    ts_low;         /* lower 32 bits of the timestamp */
+    uint32_t    cap_len;        /* number of octets of packet saved in file */
+    uint32_t    orig_len;       /* actual length of packet */
+};
+
+/**
+ * Helper for composing a pcapng block (without packet data) in a fixed buffer.
+ */
+typedef struct PCAPNGBLOCKBUF
+{
+    /** Number of bytes used. */
+    uint32_t    cb;
+    /** The buffer, 32-bit aligned. */
+    union
+    {
+        uint8_t     ab[PCAPNG_HDR_BUF_SIZE];
+        uint32_t    au32[PCAPNG_HDR_BUF_SIZE / sizeof(uint32_t)];
+    } u;
+} PCAPNGBLOCKBUF;
+
 
 /*********************************************************************************************************************************
 *   Global Variables                                                                                                             *
@@ -265,3 +324,246 @@ int PcapFileGsoFrame(RTFILE File, uint64_t StartNanoTS, PCPDMNETWORKGSO pGso,
     return VINF_SUCCESS;
 }
 
+
+
+
+/*
+ *
+ * pcapng
+ *
+ */
+
+/**
+ * Appends raw data to a pcapng block buffer, padding it to 32 bits.
+ */
+static void pcapNgBufAdd(PCAPNGBLOCKBUF *pBuf, const void *pvData, size_t cbData)
+{
+    size_t const cbPadded = RT_ALIGN_Z(cbData, 4);
+    AssertReturnVoid(pBuf->cb + cbPadded <= sizeof(pBuf->u));
+    memcpy(&pBuf->u.ab[pBuf->cb], pvData, cbData);
+    memset(&pBuf->u.ab[pBuf->cb + cbData], 0, cbPadded - cbData);
+    pBuf->cb += (uint32_t)cbPadded;
+}
+
+
+/**
+ * Appends a U32 to a pcapng block buffer.
+ */
+DECLINLINE(void) pcapNgBufAddU32(PCAPNGBLOCKBUF *pBuf, uint32_t u32)
+{
+    pcapNgBufAdd(pBuf, &u32, sizeof(u32));
+}
+
+
+/**
+ * Appends an option (header + padded value) to a pcapng block buffer.
+ */
+static void pcapNgBufAddOption(PCAPNGBLOCKBUF *pBuf, uint16_t uCode, const void *pvValue, size_t cbValue)
+{
+    uint16_t const au16Hdr[2] = { uCode, (uint16_t)cbValue };
+    pcapNgBufAdd(pBuf, au16Hdr, sizeof(au16Hdr));
+    if (cbValue)
+        pcapNgBufAdd(pBuf, pvValue, cbValue);
+}
+
+
+/**
+ * Terminates a block without packet data, setting both length fields.
+ */
+static void pcapNgBufFinish(PCAPNGBLOCKBUF *pBuf)
+{
+    pcapNgBufAddOption(pBuf, PCAPNG_OPT_END, NULL, 0);
+    uint32_t const cbBlock = pBuf->cb + sizeof(uint32_t);
+    pBuf->u.au32[1] = cbBlock;
+    pcapNgBufAddU32(pBuf, cbBlock);
+}
+
+
+/**
+ * Writes the pcapng section header and interface description blocks.
+ *
+ * Timestamps are recorded with nanosecond resolution (if_tsresol = 9), so the
+ * NanoTS values passed to the frame writers must be nanoseconds since the
+ * UNIX epoch.
+ *
+ * @returns IPRT status code, @see RTStrmWrite.
+ *
+ * @param   pStream         The stream handle.
+ * @param   pszIfName       The interface name to record, optional.
+ * @param   cbSnapLen       The snap length to record, 0 for unlimited.
+ * @param   pcbWritten      Where to add the number of bytes written. Optional.
+ */
+int PcapNgStreamHdr(PRTSTREAM pStream, const char *pszIfName, uint32_t cbSnapLen, size_t *pcbWritten)
+{
+    /* Section header block. */
+    PCAPNGBLOCKBUF Buf;
+    Buf.cb = 0;
+    pcapNgBufAddU32(&Buf, PCAPNG_SHB_BLOCK_TYPE);
+    pcapNgBufAddU32(&Buf, 0);
+    pcapNgBufAddU32(&Buf, PCAPNG_SHB_BYTE_ORDER_MAGIC);
+    pcapNgBufAddU32(&Buf, RT_MAKE_U32(1 /*major*/, 0 /*minor*/));
+    pcapNgBufAddU32(&Buf, UINT32_MAX); /* section length: -1 (unspecified) */
+    pcapNgBufAddU32(&Buf, UINT32_MAX);
+    static const char s_szUserAppl[] = "VirtualBox";
+    pcapNgBufAddOption(&Buf, PCAPNG_OPT_SHB_USERAPPL, s_szUserAppl, sizeof(s_szUserAppl) - 1);
+    pcapNgBufFinish(&Buf);
+    int rc = RTStrmWrite(pStream, Buf.u.ab, Buf.cb);
+    if (RT_FAILURE(rc))
+        return rc;
+    size_t cbWritten = Buf.cb;
+
+    /* Interface description block. */
+    Buf.cb = 0;
+    pcapNgBufAddU32(&Buf, PCAPNG_IDB_BLOCK_TYPE);
+    pcapNgBufAddU32(&Buf, 0);
+    pcapNgBufAddU32(&Buf, RT_MAKE_U32(PCAPNG_LINK_TYPE_ETHERNET, 0 /*reserved*/));
+    pcapNgBufAddU32(&Buf, cbSnapLen);
+    if (pszIfName && *pszIfName)
+        pcapNgBufAddOption(&Buf, PCAPNG_OPT_IDB_NAME, pszIfName, RT_MIN(strlen(pszIfName), 64));
+    uint8_t const bTsResol = 9; /* nanoseconds */
+    pcapNgBufAddOption(&Buf, PCAPNG_OPT_IDB_TSRESOL, &bTsResol, sizeof(bTsResol));
+    pcapNgBufFinish(&Buf);
+    rc = RTStrmWrite(pStream, Buf.u.ab, Buf.cb);
+    if (RT_SUCCESS(rc) && pcbWritten)
+        *pcbWritten += cbWritten + Buf.cb;
+    return rc;
+}
+
+
+/**
+ * Writes one enhanced packet block consisting of up to two data parts.
+ */
+static int pcapNgStreamWriteEpb(PRTSTREAM pStream, uint32_t idIf, uint64_t NanoTS, uint32_t fFlags,
+                                const void *pvPart1, uint32_t cbPart1, const void *pvPart2, uint32_t cbPart2,
+                                uint32_t cbOrig, size_t *pcbWritten)
+{
+    static uint8_t const s_abPad[4] = { 0, 0, 0, 0 };
+    uint32_t const cbCapture = cbPart1 + cbPart2;
+    uint32_t const cbPad     = RT_ALIGN_32(cbCapture, 4) - cbCapture;
+
+    /* The trailer: flags option + end option + total block length. */
+    uint32_t au32Trailer[5];
+    unsigned cTrailer = 0;
+    if (fFlags)
+    {
+        au32Trailer[cTrailer++] = RT_MAKE_U32(PCAPNG_OPT_EPB_FLAGS, sizeof(uint32_t));
+        au32Trailer[cTrailer++] = fFlags;
+    }
+    au32Trailer[cTrailer++] = RT_MAKE_U32(PCAPNG_OPT_END, 0);
+
+    struct pcapng_epb_hdr Hdr;
+    Hdr.block_type = PCAPNG_EPB_BLOCK_TYPE;
+    Hdr.block_len  = (uint32_t)sizeof(Hdr) + cbCapture + cbPad + (cTrailer + 1) * sizeof(uint32_t);
+    Hdr.if_id      = idIf;
+    Hdr.ts_high    = (uint32_t)(NanoTS >> 32);
+    Hdr.ts_low     = (uint32_t)NanoTS;
+    Hdr.cap_len    = cbCapture;
+    Hdr.orig_len   = cbOrig;
+    au32Trailer[cTrailer++] = Hdr.block_len;
+
+    int rc = RTStrmWrite(pStream, &Hdr, sizeof(Hdr));
+    if (RT_SUCCESS(rc) && cbPart1)
+        rc = RTStrmWrite(pStream, pvPart1, cbPart1);
+    if (RT_SUCCESS(rc) && cbPart2)
+        rc = RTStrmWrite(pStream, pvPart2, cbPart2);
+    if (RT_SUCCESS(rc) && cbPad)
+        rc = RTStrmWrite(pStream, s_abPad, cbPad);
+    if (RT_SUCCESS(rc))
+        rc = RTStrmWrite(pStream, au32Trailer, cTrailer * sizeof(uint32_t));
+    if (RT_SUCCESS(rc) && pcbWritten)
+        *pcbWritten += Hdr.block_len;
+    return rc;
+}
+
+
+/**
+ * Writes a frame to a pcapng stream.
+ *
+ * @returns IPRT status code, @see RTStrmWrite.
+ *
+ * @param   pStream         The stream handle.
+ * @param   idIf            The interface ID (index of the IDB).
+ * @param   NanoTS          The capture timestamp, nanoseconds since the epoch.
+ * @param   fFlags          PCAPNG_EPB_F_XXX.
+ * @param   pvFrame         The start of the frame.
+ * @param   cbFrame         The size of the frame.
+ * @param   cbMax           The max number of bytes to include in the file.
+ * @param   pcbWritten      Where to add the number of bytes written. Optional.
+ */
+int PcapNgStreamFrame(PRTSTREAM pStream, uint32_t idIf, uint64_t NanoTS, uint32_t fFlags,
+                      const void *pvFrame, size_t cbFrame, size_t cbMax, size_t *pcbWritten)
+{
+    return pcapNgStreamWriteEpb(pStream, idIf, NanoTS, fFlags, pvFrame, (uint32_t)RT_MIN(cbFrame, cbMax), NULL, 0,
+                                (uint32_t)cbFrame, pcbWritten);
+}
+
+
+/**
+ * Writes a GSO frame to a pcapng stream, one block per segment.
+ *
+ * @returns IPRT status code, @see RTStrmWrite.
+ *
+ * @param   pStream         The stream handle.
+ * @param   idIf            The interface ID (index of the IDB).
+ * @param   NanoTS          The capture timestamp, nanoseconds since the epoch.
+ * @param   fFlags          PCAPNG_EPB_F_XXX.
+ * @param   pGso            Pointer to the GSO context.
+ * @param   pvFrame         The start of the GSO frame.
+ * @param   cbFrame         The size of the GSO frame.
+ * @param   cbSegMax        The max number of bytes to include in the file for
+ *                          each segment.
+ * @param   pcbWritten      Where to add the number of bytes written. Optional.
+ */
+int PcapNgStreamGsoFrame(PRTSTREAM pStream, uint32_t idIf, uint64_t NanoTS, uint32_t fFlags, PCPDMNETWORKGSO pGso,
+                         const void *pvFrame, size_t cbFrame, size_t cbSegMax, size_t *pcbWritten)
+{
+    uint8_t const  *pbFrame = (uint8_t const *)pvFrame;
+    uint8_t         abHdrs[256];
+    uint32_t const  cSegs   = PDMNetGsoCalcSegmentCount(pGso, cbFrame);
+    for (uint32_t iSeg = 0; iSeg < cSegs; iSeg++)
+    {
+        uint32_t cbSegPayload, cbHdrs;
+        uint32_t offSegPayload = PDMNetGsoCarveSegment(pGso, pbFrame, cbFrame, iSeg, cSegs, abHdrs, &cbHdrs, &cbSegPayload);
+
+        uint32_t const cbIncl  = (uint32_t)RT_MIN(cbHdrs + cbSegPayload, cbSegMax);
+        uint32_t const cbPart1 = RT_MIN(cbIncl, cbHdrs);
+        int rc = pcapNgStreamWriteEpb(pStream, idIf, NanoTS, fFlags, abHdrs, cbPart1,
+                                      pbFrame + offSegPayload, cbIncl - cbPart1, cbHdrs + cbSegPayload, pcbWritten);
+        if (RT_FAILURE(rc))
+            return rc;
+    }
+
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Writes an interface statistics block to a pcapng stream.
+ *
+ * @returns IPRT status code, @see RTStrmWrite.
+ *
+ * @param   pStream         The stream handle.
+ * @param   idIf            The interface ID (index of the IDB).
+ * @param   NanoTS          The timestamp, nanoseconds since the epoch.
+ * @param   cFramesRecv     Number of frames seen by the capture point.
+ * @param   cFramesDropped  Number of frames dropped by the capture point.
+ * @param   pcbWritten      Where to add the number of bytes written. Optional.
+ */
+int PcapNgStreamStats(PRTSTREAM pStream, uint32_t idIf, uint64_t NanoTS, uint64_t cFramesRecv, uint64_t cFramesDropped,
+                      size_t *pcbWritten)
+{
+    PCAPNGBLOCKBUF Buf;
+    Buf.cb = 0;
+    pcapNgBufAddU32(&Buf, PCAPNG_ISB_BLOCK_TYPE);
+    pcapNgBufAddU32(&Buf, 0);
+    pcapNgBufAddU32(&Buf, idIf);
+    pcapNgBufAddU32(&Buf, (uint32_t)(NanoTS >> 32));
+    pcapNgBufAddU32(&Buf, (uint32_t)NanoTS);
+    pcapNgBufAddOption(&Buf, PCAPNG_OPT_ISB_IFRECV, &cFramesRecv, sizeof(cFramesRecv));
+    pcapNgBufAddOption(&Buf, PCAPNG_OPT_ISB_IFDROP, &cFramesDropped, sizeof(cFramesDropped));
+    pcapNgBufFinish(&Buf);
+    int rc = RTStrmWrite(pStream, Buf.u.ab, Buf.cb);
+    if (RT_SUCCESS(rc) && pcbWritten)
+        *pcbWritten += Buf.cb;
+    return rc;
+}
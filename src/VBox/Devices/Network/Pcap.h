@@ -1,6 +1,6 @@
 /* $Id: Pcap.h $ */
 /** @file
- * Helpers for writing libpcap files.
+ * Helpers for writing libpcap and pcapng files.
  */
 
 /*
@@ -46,6 +46,24 @@ int PcapFileFrame(RTFILE File, uint64_t StartNanoTS, const void *pvFrame, size_t
 int PcapFileGsoFrame(RTFILE File, uint64_t StartNanoTS, PCPDMNETWORKGSO pGso,
                      const void *pvFrame, size_t cbFrame, size_t cbSegMax);
 
+/** @name PCAPNG_EPB_F_XXX - Packet direction flags for the pcapng writers.
+ * @{ */
+/** Direction not known. */
+#define PCAPNG_EPB_F_DIR_UNKNOWN    UINT32_C(0)
+/** Inbound (received) frame. */
+#define PCAPNG_EPB_F_DIR_INBOUND    UINT32_C(1)
+/** Outbound (transmitted) frame. */
+#define PCAPNG_EPB_F_DIR_OUTBOUND   UINT32_C(2)
+/** @} */
+
+int PcapNgStreamHdr(PRTSTREAM pStream, const char *pszIfName, uint32_t cbSnapLen, size_t *pcbWritten);
+int PcapNgStreamFrame(PRTSTREAM pStream, uint32_t idIf, uint64_t NanoTS, uint32_t fFlags,
+                      const void *pvFrame, size_t cbFrame, size_t cbMax, size_t *pcbWritten);
+int PcapNgStreamGsoFrame(PRTSTREAM pStream, uint32_t idIf, uint64_t NanoTS, uint32_t fFlags, PCPDMNETWORKGSO pGso,
+                         const void *pvFrame, size_t cbFrame, size_t cbSegMax, size_t *pcbWritten);
+int PcapNgStreamStats(PRTSTREAM pStream, uint32_t idIf, uint64_t NanoTS, uint64_t cFramesRecv, uint64_t cFramesDropped,
+                      size_t *pcbWritten);
+
 RT_C_DECLS_END
 
 #endif /* !VBOX_INCLUDED_SRC_Network_Pcap_h */
@@ -55,8 +55,9 @@
 #define LWIPMutexRelease RTSemMutexRelease
 #endif
 
-/** Maximum number of threads lwIP is allowed to create. */
-#define THREADS_MAX 5
+/** Maximum number of threads lwIP is allowed to create.
+ * The NAT network service runs up to 16 poll manager threads. */
+#define THREADS_MAX 24
 
 /** Maximum number of mbox entries needed for reasonable performance. */
 #define MBOX_ENTRIES_MAX 128
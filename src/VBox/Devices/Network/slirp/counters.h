@@ -129,6 +129,10 @@ DRV_PROFILE_COUNTER(NATRecvWait,"Time spent in NATRecv worker in waiting of free
 DRV_COUNTING_COUNTER(QueuePktSent, "counting packet sent via PDM Queue");
 DRV_COUNTING_COUNTER(QueuePktDropped, "counting packet drops by PDM Queue");
 DRV_COUNTING_COUNTER(ConsumerFalse, "counting consumer's reject number to process the queue's item");
+DRV_COUNTING_COUNTER(NATRecvCached, "counting RX frames buffered from the frame cache");
+DRV_COUNTING_COUNTER(NATRecvHeap, "counting RX frames too big for the frame cache");
+DRV_COUNTING_COUNTER(NATXmitCached, "counting TX buffers allocated from the frame cache");
+DRV_COUNTING_COUNTER(NATXmitHeap, "counting TX buffers too big for the frame cache");
 # endif
 #endif /*!COUNTERS_INIT*/
 
@@ -125,6 +125,9 @@ extern "C" DECLEXPORT(int) VBoxDevicesRegister(PPDMDEVREGCB pCallbacks, uint32_t
     rc = pCallbacks->pfnRegister(pCallbacks, &g_DeviceVirtioNet);
     if (RT_FAILURE(rc))
         return rc;
+    rc = pCallbacks->pfnRegister(pCallbacks, &g_DeviceVirtioBalloon);
+    if (RT_FAILURE(rc))
+        return rc;
 #endif
     rc = pCallbacks->pfnRegister(pCallbacks, &g_DeviceDP8390);
     if (RT_FAILURE(rc))
@@ -354,6 +357,9 @@ extern "C" DECLEXPORT(int) VBoxDriversRegister(PCPDMDRVREGCB pCallbacks, uint32_
     rc = pCallbacks->pfnRegister(pCallbacks, &g_DrvNetSniffer);
     if (RT_FAILURE(rc))
         return rc;
+    rc = pCallbacks->pfnRegister(pCallbacks, &g_DrvNetLro);
+    if (RT_FAILURE(rc))
+        return rc;
 #ifdef VBOX_WITH_NETSHAPER
     rc = pCallbacks->pfnRegister(pCallbacks, &g_DrvNetShaper);
     if (RT_FAILURE(rc))
@@ -65,6 +65,7 @@ extern const PDMDEVREG g_DeviceE1000;
 #endif
 #ifdef VBOX_WITH_VIRTIO
 extern const PDMDEVREG g_DeviceVirtioNet;
+extern const PDMDEVREG g_DeviceVirtioBalloon;
 #endif
 extern const PDMDEVREG g_DeviceDP8390;
 extern const PDMDEVREG g_Device3C501;
@@ -150,6 +151,7 @@ extern const PDMDRVREG g_DrvNetShaper;
 extern const PDMDRVREG g_DrvVMNet;
 #endif /* VBOX_WITH_VMNET */
 extern const PDMDRVREG g_DrvNetSniffer;
+extern const PDMDRVREG g_DrvNetLro;
 extern const PDMDRVREG g_DrvAUDIO;
 #ifdef VBOX_WITH_AUDIO_DEBUG
 extern const PDMDRVREG g_DrvHostDebugAudio;
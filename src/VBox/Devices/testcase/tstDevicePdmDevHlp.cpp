@@ -211,6 +211,23 @@ static DECLCALLBACK(uint32_t) pdmR3DevHlp_IoPortGetMappingAddress(PPDMDEVINS pDe
 }
 
 
+/** @interface_method_impl{PDMDEVHLPR3,pfnIoPortSetInShared} */
+static DECLCALLBACK(int) pdmR3DevHlp_IoPortSetInShared(PPDMDEVINS pDevIns, IOMIOPORTHANDLE hIoPorts,
+                                                       PPDMCRITSECTRW pCritSectRw, PFNIOMIOPORTNEWIN pfnInShared)
+{
+    PDMDEV_ASSERT_DEVINS(pDevIns);
+    LogFlow(("pdmR3DevHlp_IoPortSetInShared: caller='%s'/%d: hIoPorts=%#x pCritSectRw=%p pfnInShared=%p\n",
+             pDevIns->pReg->szName, pDevIns->iInstance, hIoPorts, pCritSectRw, pfnInShared));
+
+    /* The regular IN handler is always used here. */
+    RT_NOREF(hIoPorts, pCritSectRw, pfnInShared);
+    int rc = VINF_SUCCESS;
+
+    LogFlow(("pdmR3DevHlp_IoPortSetInShared: caller='%s'/%d: returns %Rrc\n", pDevIns->pReg->szName, pDevIns->iInstance, rc));
+    return rc;
+}
+
+
 /** @interface_method_impl{PDMDEVHLPR3,pfnIoPortWrite} */
 static DECLCALLBACK(VBOXSTRICTRC) pdmR3DevHlp_IoPortWrite(PPDMDEVINS pDevIns, RTIOPORT Port, uint32_t u32Value, size_t cbValue)
 {
@@ -320,6 +337,23 @@ static DECLCALLBACK(RTGCPHYS) pdmR3DevHlp_MmioGetMappingAddress(PPDMDEVINS pDevI
 }
 
 
+/** @interface_method_impl{PDMDEVHLPR3,pfnMmioSetReadShared} */
+static DECLCALLBACK(int) pdmR3DevHlp_MmioSetReadShared(PPDMDEVINS pDevIns, IOMMMIOHANDLE hRegion,
+                                                       PPDMCRITSECTRW pCritSectRw, PFNIOMMMIONEWREAD pfnReadShared)
+{
+    PDMDEV_ASSERT_DEVINS(pDevIns);
+    LogFlow(("pdmR3DevHlp_MmioSetReadShared: caller='%s'/%d: hRegion=%#x pCritSectRw=%p pfnReadShared=%p\n",
+             pDevIns->pReg->szName, pDevIns->iInstance, hRegion, pCritSectRw, pfnReadShared));
+
+    /* The regular read handler is always used here. */
+    RT_NOREF(hRegion, pCritSectRw, pfnReadShared);
+    int rc = VINF_SUCCESS;
+
+    LogFlow(("pdmR3DevHlp_MmioSetReadShared: caller='%s'/%d: returns %Rrc\n", pDevIns->pReg->szName, pDevIns->iInstance, rc));
+    return rc;
+}
+
+
 /** @interface_method_impl{PDMDEVHLPR3,pfnMmio2Create} */
 static DECLCALLBACK(int) pdmR3DevHlp_Mmio2Create(PPDMDEVINS pDevIns, PPDMPCIDEV pPciDev, uint32_t iPciRegion, RTGCPHYS cbRegion,
                                                  uint32_t fFlags, const char *pszDesc, void **ppvMapping, PPGMMMIO2HANDLE phRegion)
@@ -3058,6 +3092,38 @@ static DECLCALLBACK(int) pdmR3DevHlp_PhysChangeMemBalloon(PPDMDEVINS pDevIns, bo
 }
 
 
+/** @interface_method_impl{PDMDEVHLPR3,pfnPhysChangeMemBalloonSync} */
+static DECLCALLBACK(int) pdmR3DevHlp_PhysChangeMemBalloonSync(PPDMDEVINS pDevIns, bool fInflate, unsigned cPages, RTGCPHYS *paPhysPage)
+{
+    PDMDEV_ASSERT_DEVINS(pDevIns);
+    LogFlow(("pdmR3DevHlp_PhysChangeMemBalloonSync: caller='%s'/%d: fInflate=%RTbool cPages=%u paPhysPage=%p\n",
+             pDevIns->pReg->szName, pDevIns->iInstance, fInflate, cPages, paPhysPage));
+
+    int rc = VERR_NOT_IMPLEMENTED;
+    AssertFailed();
+
+    Log(("pdmR3DevHlp_PhysChangeMemBalloonSync: caller='%s'/%d: returns %Rrc\n", pDevIns->pReg->szName, pDevIns->iInstance, rc));
+    return rc;
+}
+
+
+/** @interface_method_impl{PDMDEVHLPR3,pfnPhysFreeReportedPages} */
+static DECLCALLBACK(int) pdmR3DevHlp_PhysFreeReportedPages(PPDMDEVINS pDevIns, uint32_t cRanges, PCPGMPHYSRANGE paRanges,
+                                                           uint32_t *pcPagesFreed)
+{
+    PDMDEV_ASSERT_DEVINS(pDevIns);
+    LogFlow(("pdmR3DevHlp_PhysFreeReportedPages: caller='%s'/%d: cRanges=%u paRanges=%p\n",
+             pDevIns->pReg->szName, pDevIns->iInstance, cRanges, paRanges));
+    RT_NOREF(pcPagesFreed);
+
+    int rc = VERR_NOT_IMPLEMENTED;
+    AssertFailed();
+
+    Log(("pdmR3DevHlp_PhysFreeReportedPages: caller='%s'/%d: returns %Rrc\n", pDevIns->pReg->szName, pDevIns->iInstance, rc));
+    return rc;
+}
+
+
 /** @interface_method_impl{PDMDEVHLPR3,pfnCpuGetGuestMicroarch} */
 static DECLCALLBACK(CPUMMICROARCH) pdmR3DevHlp_CpuGetGuestMicroarch(PPDMDEVINS pDevIns)
 {
@@ -5807,12 +5873,14 @@ const PDMDEVHLPR3 g_tstDevPdmDevHlpR3 =
     pdmR3DevHlp_IoPortMap,
     pdmR3DevHlp_IoPortUnmap,
     pdmR3DevHlp_IoPortGetMappingAddress,
+    pdmR3DevHlp_IoPortSetInShared,
     pdmR3DevHlp_IoPortWrite,
     pdmR3DevHlp_MmioCreateEx,
     pdmR3DevHlp_MmioMap,
     pdmR3DevHlp_MmioUnmap,
     pdmR3DevHlp_MmioReduce,
     pdmR3DevHlp_MmioGetMappingAddress,
+    pdmR3DevHlp_MmioSetReadShared,
     pdmR3DevHlp_Mmio2Create,
     pdmR3DevHlp_Mmio2Destroy,
     pdmR3DevHlp_Mmio2Map,
@@ -6007,6 +6075,8 @@ const PDMDEVHLPR3 g_tstDevPdmDevHlpR3 =
     pdmR3DevHlp_PhysGCPtr2GCPhys,
     pdmR3DevHlp_PhysIsGCPhysNormal,
     pdmR3DevHlp_PhysChangeMemBalloon,
+    pdmR3DevHlp_PhysChangeMemBalloonSync,
+    pdmR3DevHlp_PhysFreeReportedPages,
     pdmR3DevHlp_MMHeapAlloc,
     pdmR3DevHlp_MMHeapAllocZ,
     pdmR3DevHlp_MMHeapAPrintfV,
@@ -124,6 +124,23 @@ static DECLCALLBACK(int) pdmR0DevHlp_IoPortSetUpContextEx(PPDMDEVINS pDevIns, IO
 }
 
 
+/** @interface_method_impl{PDMDEVHLPR0,pfnIoPortSetInShared} */
+static DECLCALLBACK(int) pdmR0DevHlp_IoPortSetInShared(PPDMDEVINS pDevIns, IOMIOPORTHANDLE hIoPorts,
+                                                       PPDMCRITSECTRW pCritSectRw, PFNIOMIOPORTNEWIN pfnInShared)
+{
+    PDMDEV_ASSERT_DEVINS(pDevIns);
+    LogFlow(("pdmR0DevHlp_IoPortSetInShared: caller='%s'/%d: hIoPorts=%#x pCritSectRw=%p pfnInShared=%p\n",
+             pDevIns->pReg->szName, pDevIns->iInstance, hIoPorts, pCritSectRw, pfnInShared));
+
+    /* The regular IN handler is always used here. */
+    RT_NOREF(hIoPorts, pCritSectRw, pfnInShared);
+    int rc = VINF_SUCCESS;
+
+    LogFlow(("pdmR0DevHlp_IoPortSetInShared: caller='%s'/%d: returns %Rrc\n", pDevIns->pReg->szName, pDevIns->iInstance, rc));
+    return rc;
+}
+
+
 /** @interface_method_impl{PDMDEVHLPR0,pfnMmioSetUpContextEx} */
 static DECLCALLBACK(int) pdmR0DevHlp_MmioSetUpContextEx(PPDMDEVINS pDevIns, IOMMMIOHANDLE hRegion, PFNIOMMMIONEWWRITE pfnWrite,
                                                         PFNIOMMMIONEWREAD pfnRead, PFNIOMMMIONEWFILL pfnFill, void *pvUser)
@@ -149,6 +166,23 @@ static DECLCALLBACK(int) pdmR0DevHlp_MmioSetUpContextEx(PPDMDEVINS pDevIns, IOMM
 }
 
 
+/** @interface_method_impl{PDMDEVHLPR0,pfnMmioSetReadShared} */
+static DECLCALLBACK(int) pdmR0DevHlp_MmioSetReadShared(PPDMDEVINS pDevIns, IOMMMIOHANDLE hRegion,
+                                                       PPDMCRITSECTRW pCritSectRw, PFNIOMMMIONEWREAD pfnReadShared)
+{
+    PDMDEV_ASSERT_DEVINS(pDevIns);
+    LogFlow(("pdmR0DevHlp_MmioSetReadShared: caller='%s'/%d: hRegion=%#x pCritSectRw=%p pfnReadShared=%p\n",
+             pDevIns->pReg->szName, pDevIns->iInstance, hRegion, pCritSectRw, pfnReadShared));
+
+    /* The regular read handler is always used here. */
+    RT_NOREF(hRegion, pCritSectRw, pfnReadShared);
+    int rc = VINF_SUCCESS;
+
+    LogFlow(("pdmR0DevHlp_MmioSetReadShared: caller='%s'/%d: returns %Rrc\n", pDevIns->pReg->szName, pDevIns->iInstance, rc));
+    return rc;
+}
+
+
 /** @interface_method_impl{PDMDEVHLPR0,pfnMmio2SetUpContext} */
 static DECLCALLBACK(int) pdmR0DevHlp_Mmio2SetUpContext(PPDMDEVINS pDevIns, PGMMMIO2HANDLE hRegion,
                                                        size_t offSub, size_t cbSub, void **ppvMapping)
@@ -1419,7 +1453,9 @@ const PDMDEVHLPR0 g_tstDevPdmDevHlpR0 =
 {
     PDM_DEVHLPR0_VERSION,
     pdmR0DevHlp_IoPortSetUpContextEx,
+    pdmR0DevHlp_IoPortSetInShared,
     pdmR0DevHlp_MmioSetUpContextEx,
+    pdmR0DevHlp_MmioSetReadShared,
     pdmR0DevHlp_Mmio2SetUpContext,
     pdmR0DevHlp_PCIPhysRead,
     pdmR0DevHlp_PCIPhysWrite,
@@ -856,6 +856,91 @@ static RTEXITCODE handleDebugVM_GuestSample(HandlerArg *pArgs, IMachineDebugger
     return RTEXITCODE_SUCCESS;
 }
 
+/**
+ * Handles the guestprofile sub-command.
+ *
+ * @returns Suitable exit code.
+ * @param   pArgs               The handler arguments.
+ * @param   pDebugger           Pointer to the debugger interface.
+ */
+static RTEXITCODE handleDebugVM_GuestProfile(HandlerArg *pArgs, IMachineDebugger *pDebugger)
+{
+    if (pArgs->argc < 3)
+        return errorSyntax(DebugVM::tr("The guestprofile sub-command requires an action: start, dump or stop"));
+    const char *pszAction = pArgs->argv[2];
+
+    /*
+     * Parse arguments.
+     */
+    const char                 *pszFilename         = NULL;
+    uint32_t                   cSampleIntervalUs    = 1000;
+    uint32_t                   cSamplesPerCpu       = 0;
+    bool                       fSamplingOpts        = false;
+
+    RTGETOPTSTATE               GetState;
+    RTGETOPTUNION               ValueUnion;
+    static const RTGETOPTDEF    s_aOptions[] =
+    {
+        { "--filename",           'f', RTGETOPT_REQ_STRING },
+        { "--sample-interval-us", 'i', RTGETOPT_REQ_UINT32 },
+        { "--samples-per-cpu",    'n', RTGETOPT_REQ_UINT32 },
+    };
+    int vrc = RTGetOptInit(&GetState, pArgs->argc, pArgs->argv, s_aOptions, RT_ELEMENTS(s_aOptions), 3, 0 /*fFlags*/);
+    AssertRCReturn(vrc, RTEXITCODE_FAILURE);
+
+    while ((vrc = RTGetOpt(&GetState, &ValueUnion)) != 0)
+    {
+        switch (vrc)
+        {
+            case 'f':
+                pszFilename = ValueUnion.psz;
+                break;
+            case 'i':
+                cSampleIntervalUs = ValueUnion.u32;
+                fSamplingOpts     = true;
+                break;
+            case 'n':
+                cSamplesPerCpu    = ValueUnion.u32;
+                fSamplingOpts     = true;
+                break;
+
+            default:
+                return errorGetOpt(vrc, &ValueUnion);
+        }
+    }
+
+    /*
+     * Execute the order.
+     */
+    if (!strcmp(pszAction, "start"))
+    {
+        setCurrentSubcommand(HELP_SCOPE_DEBUGVM_GUESTPROFILE_START);
+        if (pszFilename)
+            return errorSyntax(DebugVM::tr("The --filename option does not apply to 'start'"));
+        CHECK_ERROR2I_RET(pDebugger, StartGuestProfiling(cSampleIntervalUs, cSamplesPerCpu), RTEXITCODE_FAILURE);
+    }
+    else if (!strcmp(pszAction, "dump"))
+    {
+        setCurrentSubcommand(HELP_SCOPE_DEBUGVM_GUESTPROFILE_DUMP);
+        if (!pszFilename)
+            return errorSyntax(DebugVM::tr("The --filename is missing"));
+        if (fSamplingOpts)
+            return errorSyntax(DebugVM::tr("The --sample-interval-us and --samples-per-cpu options do not apply to 'dump'"));
+        CHECK_ERROR2I_RET(pDebugger, DumpGuestProfile(com::Bstr(pszFilename).raw()), RTEXITCODE_FAILURE);
+    }
+    else if (!strcmp(pszAction, "stop"))
+    {
+        setCurrentSubcommand(HELP_SCOPE_DEBUGVM_GUESTPROFILE_STOP);
+        if (pszFilename || fSamplingOpts)
+            return errorSyntax(DebugVM::tr("The 'stop' action takes no options"));
+        CHECK_ERROR2I_RET(pDebugger, StopGuestProfiling(), RTEXITCODE_FAILURE);
+    }
+    else
+        return errorUnknownSubcommand(pszAction);
+
+    return RTEXITCODE_SUCCESS;
+}
+
 RTEXITCODE handleDebugVM(HandlerArg *pArgs)
 {
     RTEXITCODE rcExit = RTEXITCODE_FAILURE;
@@ -962,6 +1047,12 @@ RTEXITCODE handleDebugVM(HandlerArg *pArgs)
                     setCurrentSubcommand(HELP_SCOPE_DEBUGVM_GUESTSAMPLE);
                     rcExit = handleDebugVM_GuestSample(pArgs, ptrDebugger);
                 }
+                else if (!strcmp(pszSubCmd, "guestprofile"))
+                {
+                    setCurrentSubcommand(HELP_SCOPE_DEBUGVM_GUESTPROFILE_START | HELP_SCOPE_DEBUGVM_GUESTPROFILE_DUMP
+                                         | HELP_SCOPE_DEBUGVM_GUESTPROFILE_STOP);
+                    rcExit = handleDebugVM_GuestProfile(pArgs, ptrDebugger);
+                }
                 else
                     errorUnknownSubcommand(pszSubCmd);
             }
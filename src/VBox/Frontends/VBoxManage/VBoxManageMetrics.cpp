@@ -36,6 +36,9 @@
 #include <VBox/com/VirtualBox.h>
 
 #include <iprt/asm.h>
+#include <iprt/file.h>
+#include <iprt/getopt.h>
+#include <iprt/path.h>
 #include <iprt/stream.h>
 #include <iprt/string.h>
 #include <iprt/time.h>
@@ -553,6 +556,163 @@ static RTEXITCODE handleMetricsCollect(int argc, char *argv[],
     return RTEXITCODE_SUCCESS;
 }
 
+/**
+ * Writes one OpenMetrics exposition to the given file, replacing it
+ * atomically so a scraper never sees a partial one.
+ */
+static int writeMetricsExposition(const char *pszFilename, Utf8Str const &strMetrics)
+{
+    char szTmp[RTPATH_MAX];
+    int vrc = RTStrPrintf2(szTmp, sizeof(szTmp), "%s.tmp", pszFilename) > 0 ? VINF_SUCCESS : VERR_FILENAME_TOO_LONG;
+    if (RT_SUCCESS(vrc))
+    {
+        PRTSTREAM pStrm;
+        vrc = RTStrmOpen(szTmp, "w", &pStrm);
+        if (RT_SUCCESS(vrc))
+        {
+            vrc = RTStrmWrite(pStrm, strMetrics.c_str(), strMetrics.length());
+            int vrc2 = RTStrmClose(pStrm);
+            if (RT_SUCCESS(vrc))
+                vrc = vrc2;
+            if (RT_SUCCESS(vrc))
+                vrc = RTFileRename(szTmp, pszFilename, RTFILEMOVE_FLAGS_REPLACE);
+            if (RT_FAILURE(vrc))
+                RTFileDelete(szTmp);
+        }
+    }
+    return vrc;
+}
+
+/**
+ * export
+ */
+static RTEXITCODE handleMetricsExport(HandlerArg *a)
+{
+    setCurrentSubcommand(HELP_SCOPE_METRICS_EXPORT);
+
+    static const RTGETOPTDEF s_aOptions[] =
+    {
+        { "--pattern",      'p', RTGETOPT_REQ_STRING },
+        { "--changed-only", 'c', RTGETOPT_REQ_NOTHING },
+        { "--period",       'P', RTGETOPT_REQ_UINT32 },
+        { "--samples",      's', RTGETOPT_REQ_UINT32 },
+        { "--output",       'o', RTGETOPT_REQ_STRING },
+    };
+
+    const char *pszVM       = NULL;
+    const char *pszPattern  = NULL;
+    const char *pszOutput   = NULL;
+    bool        fChangedOnly = false;
+    uint32_t    cSecsPeriod = 1;
+    uint32_t    cSamples    = 1;
+
+    RTGETOPTSTATE GetState;
+    RTGetOptInit(&GetState, a->argc, a->argv, s_aOptions, RT_ELEMENTS(s_aOptions), 1, 0 /*fFlags*/);
+    RTGETOPTUNION ValueUnion;
+    int ch;
+    while ((ch = RTGetOpt(&GetState, &ValueUnion)) != 0)
+    {
+        switch (ch)
+        {
+            case 'p':
+                pszPattern = ValueUnion.psz;
+                break;
+            case 'c':
+                fChangedOnly = true;
+                break;
+            case 'P':
+                if (!ValueUnion.u32)
+                    return errorArgument(Metrics::tr("Invalid value for 'period' parameter: '%u'"), ValueUnion.u32);
+                cSecsPeriod = ValueUnion.u32;
+                break;
+            case 's':
+                cSamples = ValueUnion.u32;
+                break;
+            case 'o':
+                pszOutput = ValueUnion.psz;
+                break;
+            case VINF_GETOPT_NOT_OPTION:
+                if (pszVM)
+                    return errorTooManyParameters(&a->argv[GetState.iNext - 1]);
+                pszVM = ValueUnion.psz;
+                break;
+            default:
+                return errorGetOpt(ch, &ValueUnion);
+        }
+    }
+    if (!pszVM)
+        return errorSyntax(Metrics::tr("Missing VM name or UUID"));
+    /* The output file is replaced by each sample, so it must always get a complete exposition. */
+    if (fChangedOnly && pszOutput)
+        return errorSyntax(Metrics::tr("The --changed-only option cannot be combined with --output"));
+
+    /*
+     * Open a shared session to the VM and get hold of the machine debugger.
+     */
+    HRESULT hrc;
+    ComPtr<IMachine> ptrMachine;
+    CHECK_ERROR2I_RET(a->virtualBox, FindMachine(Bstr(pszVM).raw(), ptrMachine.asOutParam()), RTEXITCODE_FAILURE);
+    CHECK_ERROR2I_RET(ptrMachine, LockMachine(a->session, LockType_Shared), RTEXITCODE_FAILURE);
+
+    RTEXITCODE rcExit = RTEXITCODE_FAILURE;
+    ComPtr<IConsole> ptrConsole;
+    CHECK_ERROR2(hrc, a->session, COMGETTER(Console)(ptrConsole.asOutParam()));
+    if (SUCCEEDED(hrc) && ptrConsole.isNotNull())
+    {
+        ComPtr<IMachineDebugger> ptrDebugger;
+        CHECK_ERROR2(hrc, ptrConsole, COMGETTER(Debugger)(ptrDebugger.asOutParam()));
+        if (SUCCEEDED(hrc))
+        {
+#ifdef RT_OS_WINDOWS
+            SetConsoleCtrlHandler(ctrlHandler, true);
+#endif
+            /*
+             * The sampling loop.  The machine debugger keeps the resolved
+             * pattern and the cursor for --changed-only between the calls.
+             */
+            rcExit = RTEXITCODE_SUCCESS;
+            for (uint32_t iSample = 0; g_fKeepGoing && (!cSamples || iSample < cSamples); iSample++)
+            {
+                if (iSample)
+                    RTThreadSleep(cSecsPeriod * RT_MS_1SEC);
+
+                Bstr bstrMetrics;
+                CHECK_ERROR2(hrc, ptrDebugger, GetStatsOpenMetrics(Bstr(pszPattern ? pszPattern : "").raw(), fChangedOnly,
+                                                                   bstrMetrics.asOutParam()));
+                if (FAILED(hrc))
+                {
+                    rcExit = RTEXITCODE_FAILURE;
+                    break;
+                }
+
+                Utf8Str strMetrics(bstrMetrics);
+                if (pszOutput)
+                {
+                    int vrc = writeMetricsExposition(pszOutput, strMetrics);
+                    if (RT_FAILURE(vrc))
+                    {
+                        rcExit = RTMsgErrorExitFailure(Metrics::tr("Failed to write '%s': %Rrc"), pszOutput, vrc);
+                        break;
+                    }
+                }
+                else
+                {
+                    RTStrmWrite(g_pStdOut, strMetrics.c_str(), strMetrics.length());
+                    RTStrmFlush(g_pStdOut);
+                }
+            }
+#ifdef RT_OS_WINDOWS
+            SetConsoleCtrlHandler(ctrlHandler, false);
+#endif
+        }
+    }
+    else if (SUCCEEDED(hrc))
+        RTMsgError(Metrics::tr("Machine '%s' is not currently running."), pszVM);
+
+    a->session->UnlockMachine();
+    return rcExit;
+}
+
 /**
  * Enable metrics
  */
@@ -648,6 +808,10 @@ RTEXITCODE handleMetrics(HandlerArg *a)
     if (a->argc < 1)
         return errorSyntax(Metrics::tr("Subcommand missing"));
 
+    /* The statistics export talks to the VM rather than the performance collector. */
+    if (!strcmp(a->argv[0], "export"))
+        return handleMetricsExport(a);
+
     ComPtr<IPerformanceCollector> performanceCollector;
     CHECK_ERROR2I_RET(a->virtualBox, COMGETTER(PerformanceCollector)(performanceCollector.asOutParam()), RTEXITCODE_FAILURE);
 
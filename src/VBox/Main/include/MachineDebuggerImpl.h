@@ -34,6 +34,7 @@
 #include "MachineDebuggerWrap.h"
 #include <iprt/log.h>
 #include <VBox/vmm/em.h>
+#include <VBox/vmm/stam.h>
 
 class Console;
 class Progress;
@@ -55,6 +56,7 @@ public:
 
     // "public-private methods"
     void i_flushQueuedSettings();
+    void i_notifyPowerDown();
 
 private:
 
@@ -133,8 +135,14 @@ private:
     HRESULT getStats(const com::Utf8Str &aPattern,
                      BOOL aWithDescriptions,
                      com::Utf8Str &aStats) RT_OVERRIDE;
+    HRESULT getStatsOpenMetrics(const com::Utf8Str &aPattern,
+                                BOOL aChangedOnly,
+                                com::Utf8Str &aMetrics) RT_OVERRIDE;
     HRESULT getCPULoad(ULONG aCpuId, ULONG *aPctExecuting, ULONG *aPctHalted, ULONG *aPctOther, LONG64 *aMsInterval) RT_OVERRIDE;
     HRESULT takeGuestSample(const com::Utf8Str &aFilename, ULONG aUsInterval, LONG64 aUsSampleTime, ComPtr<IProgress> &pProgress) RT_OVERRIDE;
+    HRESULT startGuestProfiling(ULONG aUsInterval, ULONG aSamplesPerCpu) RT_OVERRIDE;
+    HRESULT dumpGuestProfile(const com::Utf8Str &aFilename) RT_OVERRIDE;
+    HRESULT stopGuestProfiling() RT_OVERRIDE;
     HRESULT getUVMAndVMMFunctionTable(LONG64 aMagicVersion, LONG64 *aVMMFunctionTable, LONG64 *aUVM) RT_OVERRIDE;
 
     // private methods
@@ -149,6 +157,7 @@ private:
     HRESULT i_logStringProps(PRTLOGGER pLogger, PFNLOGGETSTR pfnLogGetStr, const char *pszLogGetStr, Utf8Str *pstrSettings);
 
     static DECLCALLBACK(int) i_dbgfProgressCallback(void *pvUser, unsigned uPercentage);
+    static DECLCALLBACK(int) i_dbgfProfileProgressCallback(void *pvUser, unsigned uPercentage);
 
     Console * const mParent;
     /** @name Flags whether settings have been queued because they could not be sent
@@ -170,6 +179,25 @@ private:
     /** Filename to dump the report to. */
     com::Utf8Str            m_strFilename;
     /** @} */
+
+    /** @name Continuous guest profiling related things.
+     * @{ */
+    /** Sample report handle of the active profiling session. */
+    DBGFSAMPLEREPORT        m_hSampleProfile;
+    /** Sample report handle of a stopped profiling session the EMTs haven't
+     * finished with yet, released by i_dbgfProfileProgressCallback(). */
+    DBGFSAMPLEREPORT        m_hSampleProfileStopping;
+    /** @} */
+
+    /** @name OpenMetrics statistics export related things.
+     * @{ */
+    /** The STAM exporter handle, NIL_STAMEXPORT if none. */
+    STAMEXPORT              m_hStatsExport;
+    /** The user mode VM handle m_hStatsExport was created for. */
+    PUVM                    m_pUVMStatsExport;
+    /** The pattern m_hStatsExport was created for. */
+    com::Utf8Str            m_strStatsExportPattern;
+    /** @} */
 };
 
 #endif /* !MAIN_INCLUDED_MachineDebuggerImpl_h */
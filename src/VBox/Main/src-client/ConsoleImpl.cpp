@@ -9162,6 +9162,17 @@ HRESULT Console::i_powerDown(IProgress *aProgress /*= NULL*/)
         alock.acquire();
     }
 
+    /* Stop guest sampling while the EMTs can still finish it up and drop the
+       statistics exporter's UVM reference. */
+    if (mDebugger)
+    {
+        alock.release();
+
+        mDebugger->i_notifyPowerDown();
+
+        alock.acquire();
+    }
+
     /* Stop the VRDP server to prevent new clients connection while VM is being
      * powered off. */
     if (mConsoleVRDPServer)
@@ -2181,6 +2181,11 @@ int Console::i_configNetwork(const char *pszDevice,
         BOOL fSniffer;
         hrc = aNetworkAdapter->COMGETTER(TraceEnabled)(&fSniffer);                          H();
 
+        /* Receive coalescing for devices which can take GSO frames (virtio-net). */
+        Utf8Str strLro;
+        GetExtraDataBoth(virtualBox, pMachine, "VBoxInternal2/Network/LargeReceiveOffload", &strLro);
+        bool const fLro = strLro == "1";
+
         NetworkAdapterPromiscModePolicy_T enmPromiscModePolicy;
         hrc = aNetworkAdapter->COMGETTER(PromiscModePolicy)(&enmPromiscModePolicy);         H();
         const char *pszPromiscuousGuestPolicy;
@@ -2222,9 +2227,16 @@ int Console::i_configNetwork(const char *pszDevice,
         InsertConfigNodeF(pInst, &pLunL0, "LUN#%u", uLun);
 
         /*
-         * Do not insert neither a shaper nor a sniffer if we are not attached to anything.
+         * Do not insert neither LRO, a shaper nor a sniffer if we are not attached to anything.
          * This way we can easily detect if we are attached to anything at the device level.
          */
+        if (fLro && eAttachmentType != NetworkAttachmentType_Null)
+        {
+            InsertConfigString(pLunL0, "Driver", "NetLro");
+            InsertConfigNode(pLunL0, "Config", &pCfg);
+            InsertConfigNode(pLunL0, "AttachedDriver", &pLunL0);
+        }
+
 #ifdef VBOX_WITH_NETSHAPER
         if (bstrBwGroup.isNotEmpty() && eAttachmentType != NetworkAttachmentType_Null)
         {
@@ -46,7 +46,9 @@
 #include <VBox/vmm/tm.h>
 #include <VBox/vmm/hm.h>
 #include <VBox/err.h>
+#include <iprt/asm.h>
 #include <iprt/cpp/utils.h>
+#include <iprt/thread.h>
 
 
 // constructor / destructor
@@ -102,6 +104,11 @@ HRESULT MachineDebugger::init(Console *aParent)
     mFlushMode = false;
 
     m_hSampleReport = NULL;
+    m_hSampleProfile = NULL;
+    m_hSampleProfileStopping = NULL;
+
+    m_hStatsExport = NIL_STAMEXPORT;
+    m_pUVMStatsExport = NULL;
 
     /* Confirm a successful initialization */
     autoInitSpan.setSucceeded();
@@ -122,10 +129,85 @@ void MachineDebugger::uninit()
     if (autoUninitSpan.uninitDone())
         return;
 
+    if (m_hStatsExport != NIL_STAMEXPORT)
+    {
+        PCVMMR3VTABLE const pVMM = mParent ? mParent->i_getVMMVTable() : NULL;
+        if (pVMM)
+            pVMM->pfnSTAMR3ExportDestroy(m_hStatsExport);
+        m_hStatsExport = NIL_STAMEXPORT;
+        m_pUVMStatsExport = NULL;
+    }
+
+    /* i_notifyPowerDown() took care of the sample reports, they lived on the
+       UVM heap and must not be touched once the VM is gone. */
+    AssertMsg(!m_hSampleReport && !m_hSampleProfile && !m_hSampleProfileStopping,
+              ("%p %p %p\n", m_hSampleReport, m_hSampleProfile, m_hSampleProfileStopping));
+    m_hSampleReport          = NULL;
+    m_hSampleProfile         = NULL;
+    m_hSampleProfileStopping = NULL;
+
     unconst(mParent) = NULL;
     mFlushMode = false;
 }
 
+/**
+ * Called by Console::i_powerDown() before the VM is powered off and destroyed.
+ *
+ * Destroys the statistics exporter and stops any guest sampling, waiting for
+ * the EMTs to finish with it, as the sample reports are allocated from the UVM
+ * heap and their timers keep queuing EMT requests until the final sampling
+ * round is done.
+ */
+void MachineDebugger::i_notifyPowerDown()
+{
+    LogFlowThisFunc(("\n"));
+
+    AutoCaller autoCaller(this);
+    if (FAILED(autoCaller.hrc()))
+        return;
+
+    PCVMMR3VTABLE const pVMM = mParent->i_getVMMVTable();
+    AssertPtrReturnVoid(pVMM);
+
+    AutoWriteLock alock(this COMMA_LOCKVAL_SRC_POS);
+
+    /* The statistics exporter holds a UVM reference, drop it so the UVM can go away. */
+    if (m_hStatsExport != NIL_STAMEXPORT)
+    {
+        pVMM->pfnSTAMR3ExportDestroy(m_hStatsExport);
+        m_hStatsExport = NIL_STAMEXPORT;
+        m_pUVMStatsExport = NULL;
+    }
+
+    if (m_hSampleReport)
+        pVMM->pfnDBGFR3SampleReportStop(m_hSampleReport); /* Fails if already stopping, harmless. */
+
+    if (m_hSampleProfile)
+    {
+        DBGFSAMPLEREPORT hSample = m_hSampleProfile;
+        m_hSampleProfile = NULL;
+        int vrc = pVMM->pfnDBGFR3SampleReportStop(hSample);
+        if (RT_SUCCESS(vrc))
+            m_hSampleProfileStopping = hSample;
+        else
+            pVMM->pfnDBGFR3SampleReportRelease(hSample);
+    }
+
+    alock.release();
+
+    /* The progress callbacks clear the handles from the last EMT sampling round. */
+    uint32_t cMsWaited = 0;
+    while (   (   ASMAtomicReadPtrT(&m_hSampleReport, DBGFSAMPLEREPORT)
+               || ASMAtomicReadPtrT(&m_hSampleProfileStopping, DBGFSAMPLEREPORT))
+           && cMsWaited < RT_MS_30SEC)
+    {
+        RTThreadSleep(10);
+        cMsWaited += 10;
+    }
+    if (m_hSampleReport || m_hSampleProfileStopping)
+        LogRel(("MachineDebugger: Guest sampling did not stop within %u ms\n", cMsWaited));
+}
+
 /**
  * @callback_method_impl{FNDBGFPROGRESS}
  */
@@ -160,6 +242,26 @@ void MachineDebugger::uninit()
     return vrc;
 }
 
+/**
+ * @callback_method_impl{FNDBGFPROGRESS,
+ *      Releases the sample report of a stopped profiling session once the EMTs are done with it.}
+ */
+/*static*/ DECLCALLBACK(int) MachineDebugger::i_dbgfProfileProgressCallback(void *pvUser, unsigned uPercentage)
+{
+    MachineDebugger *pThis = (MachineDebugger *)pvUser;
+
+    if (uPercentage == 100)
+    {
+        PCVMMR3VTABLE const pVMM = pThis->mParent->i_getVMMVTable();
+        AssertPtrReturn(pVMM, VERR_INTERNAL_ERROR_3);
+
+        DBGFSAMPLEREPORT hSample = ASMAtomicXchgPtrT(&pThis->m_hSampleProfileStopping, NULL, DBGFSAMPLEREPORT);
+        pVMM->pfnDBGFR3SampleReportRelease(hSample);
+    }
+
+    return VINF_SUCCESS;
+}
+
 // IMachineDebugger properties
 /////////////////////////////////////////////////////////////////////////////
 
@@ -1381,6 +1483,49 @@ HRESULT MachineDebugger::getStats(const com::Utf8Str &aPattern, BOOL aWithDescri
     return hrc;
 }
 
+HRESULT MachineDebugger::getStatsOpenMetrics(const com::Utf8Str &aPattern, BOOL aChangedOnly, com::Utf8Str &aMetrics)
+{
+    AutoWriteLock alock(this COMMA_LOCKVAL_SRC_POS);
+    Console::SafeVMPtrQuiet ptrVM(mParent);
+    if (!ptrVM.isOk())
+        return setError(VBOX_E_INVALID_VM_STATE, tr("Machine is not running"));
+
+    /*
+     * (Re-)create the exporter if the pattern or the VM changed.  The
+     * exporter holds a reference to the UVM, so the pointer comparison is safe.
+     */
+    if (   m_hStatsExport != NIL_STAMEXPORT
+        && (   m_pUVMStatsExport != ptrVM.rawUVM()
+            || !m_strStatsExportPattern.equals(aPattern)))
+    {
+        ptrVM.vtable()->pfnSTAMR3ExportDestroy(m_hStatsExport);
+        m_hStatsExport = NIL_STAMEXPORT;
+        m_pUVMStatsExport = NULL;
+    }
+    if (m_hStatsExport == NIL_STAMEXPORT)
+    {
+        int vrc = ptrVM.vtable()->pfnSTAMR3ExportCreate(ptrVM.rawUVM(), aPattern.c_str(),
+                                                        STAM_EXPORT_CREATE_F_WITH_DESC, &m_hStatsExport);
+        if (RT_FAILURE(vrc))
+            return setErrorBoth(VBOX_E_VM_ERROR, vrc, tr("Creating the statistics exporter failed: %Rrc"), vrc);
+        m_pUVMStatsExport = ptrVM.rawUVM();
+        m_strStatsExportPattern = aPattern;
+    }
+
+    char  *pszMetrics = NULL;
+    size_t cchMetrics = 0;
+    int vrc = ptrVM.vtable()->pfnSTAMR3ExportCollect(ptrVM.rawUVM(), m_hStatsExport,
+                                                     aChangedOnly ? STAM_EXPORT_COLLECT_F_CHANGED_ONLY : 0,
+                                                     &pszMetrics, &cchMetrics);
+    if (RT_FAILURE(vrc))
+        return vrc == VERR_NO_MEMORY ? E_OUTOFMEMORY : setErrorVrc(vrc);
+
+    HRESULT hrc = aMetrics.assignEx(pszMetrics, cchMetrics);
+    ptrVM.vtable()->pfnSTAMR3SnapshotFree(ptrVM.rawUVM(), pszMetrics);
+    return hrc;
+}
+
+
 
 /** Wrapper around TMR3GetCpuLoadPercents. */
 HRESULT MachineDebugger::getCPULoad(ULONG aCpuId, ULONG *aPctExecuting, ULONG *aPctHalted, ULONG *aPctOther, LONG64 *aMsInterval)
@@ -1464,6 +1609,103 @@ HRESULT MachineDebugger::takeGuestSample(const com::Utf8Str &aFilename, ULONG aU
     return hrc;
 }
 
+HRESULT MachineDebugger::startGuestProfiling(ULONG aUsInterval, ULONG aSamplesPerCpu)
+{
+    /*
+     * The prologue.
+     */
+    LogFlowThisFunc(("\n"));
+    AutoWriteLock alock(this COMMA_LOCKVAL_SRC_POS);
+    Console::SafeVMPtr ptrVM(mParent);
+    HRESULT hrc = ptrVM.hrc();
+    if (SUCCEEDED(hrc))
+    {
+        if (!m_hSampleProfile && !m_hSampleProfileStopping)
+        {
+            DBGFSAMPLEREPORT hSample = NULL;
+            int vrc = ptrVM.vtable()->pfnDBGFR3SampleReportCreateEx(ptrVM.rawUVM(), aUsInterval, aSamplesPerCpu,
+                                                                    DBGF_SAMPLE_REPORT_F_CONTINUOUS, &hSample);
+            if (RT_SUCCESS(vrc))
+            {
+                vrc = ptrVM.vtable()->pfnDBGFR3SampleReportStart(hSample, UINT64_MAX, i_dbgfProfileProgressCallback,
+                                                                 static_cast<MachineDebugger *>(this));
+                if (RT_SUCCESS(vrc))
+                    m_hSampleProfile = hSample;
+                else
+                {
+                    ptrVM.vtable()->pfnDBGFR3SampleReportRelease(hSample);
+                    hrc = setErrorVrc(vrc);
+                }
+            }
+            else if (vrc == VERR_OUT_OF_RANGE)
+                hrc = setError(E_INVALIDARG, tr("The number of samples per CPU is out of range: %u"), aSamplesPerCpu);
+            else
+                hrc = setErrorVrc(vrc);
+        }
+        else
+            hrc = setError(VBOX_E_INVALID_VM_STATE, tr("Guest profiling is already active"));
+    }
+
+    return hrc;
+}
+
+HRESULT MachineDebugger::dumpGuestProfile(const com::Utf8Str &aFilename)
+{
+    /*
+     * The prologue.
+     */
+    LogFlowThisFunc(("\n"));
+    AutoWriteLock alock(this COMMA_LOCKVAL_SRC_POS);
+    Console::SafeVMPtr ptrVM(mParent);
+    HRESULT hrc = ptrVM.hrc();
+    if (SUCCEEDED(hrc))
+    {
+        if (m_hSampleProfile)
+        {
+            int vrc = ptrVM.vtable()->pfnDBGFR3SampleReportDumpFoldedToFile(m_hSampleProfile, aFilename.c_str());
+            if (RT_FAILURE(vrc))
+                hrc = setErrorBoth(VBOX_E_IPRT_ERROR, vrc, tr("Writing the guest profile to '%s' failed with %Rrc"),
+                                   aFilename.c_str(), vrc);
+        }
+        else
+            hrc = setError(VBOX_E_INVALID_VM_STATE, tr("Guest profiling is not active"));
+    }
+
+    return hrc;
+}
+
+HRESULT MachineDebugger::stopGuestProfiling()
+{
+    /*
+     * The prologue.
+     */
+    LogFlowThisFunc(("\n"));
+    AutoWriteLock alock(this COMMA_LOCKVAL_SRC_POS);
+    Console::SafeVMPtr ptrVM(mParent);
+    HRESULT hrc = ptrVM.hrc();
+    if (SUCCEEDED(hrc))
+    {
+        if (m_hSampleProfile)
+        {
+            /* The EMTs finish asynchronously and the progress callback drops our reference. */
+            m_hSampleProfileStopping = m_hSampleProfile;
+            m_hSampleProfile         = NULL;
+            int vrc = ptrVM.vtable()->pfnDBGFR3SampleReportStop(m_hSampleProfileStopping);
+            if (RT_FAILURE(vrc))
+            {
+                /* No final sampling round, so the callback won't release it. */
+                ptrVM.vtable()->pfnDBGFR3SampleReportRelease(m_hSampleProfileStopping);
+                m_hSampleProfileStopping = NULL;
+                hrc = setErrorVrc(vrc);
+            }
+        }
+        else
+            hrc = setError(VBOX_E_INVALID_VM_STATE, tr("Guest profiling is not active"));
+    }
+
+    return hrc;
+}
+
 /**
  * Hack for getting the user mode VM handle (UVM) and VMM function table.
  *
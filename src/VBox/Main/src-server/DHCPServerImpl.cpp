@@ -34,10 +34,12 @@
 #include "LoggingNew.h"
 
 #include <iprt/asm.h>
+#include <iprt/ctype.h>
 #include <iprt/err.h>
 #include <iprt/file.h>
 #include <iprt/net.h>
 #include <iprt/path.h>
+#include <iprt/stream.h>
 #include <iprt/cpp/path.h>
 #include <iprt/cpp/utils.h>
 #include <iprt/cpp/xml.h>
@@ -958,6 +960,83 @@ HRESULT DHCPServer::stop(void)
 }
 
 
+/**
+ * Applies the lease journal written by the DHCP server to a lease lookup.
+ *
+ * The DHCP server appends lease changes to "<leases file>.journal" and only
+ * rewrites the leases file now and then, so the journal has the latest word.
+ *
+ * @param   pszLeasesFilename   The leases file name.
+ * @param   pMacAddress         The MAC address being looked up.
+ * @param   pfFound             Whether there is a lease for the MAC address.
+ *                              Input and output.
+ * @param   rStrAddress         The lease address.  Input and output.
+ * @param   rStrState           The lease state.  Input and output.
+ * @param   psecIssued          The lease issue time.  Input and output.
+ * @param   pcSecsToLive        The lease time.  Input and output.
+ * @note    Dhcpd/Db.cpp contains the writer, keep it in sync.
+ */
+static void dhcpServerApplyLeaseJournal(const char *pszLeasesFilename, PCRTMAC pMacAddress, bool *pfFound,
+                                        com::Utf8Str &rStrAddress, com::Utf8Str &rStrState,
+                                        int64_t *psecIssued, uint32_t *pcSecsToLive)
+{
+    char szJournal[RTPATH_MAX];
+    int vrc = RTStrPrintf2(szJournal, sizeof(szJournal), "%s.journal", pszLeasesFilename) > 0 ? VINF_SUCCESS : VERR_FILENAME_TOO_LONG;
+    PRTSTREAM pStrm = NULL;
+    if (RT_SUCCESS(vrc))
+        vrc = RTStrmOpen(szJournal, "r", &pStrm);
+    if (RT_FAILURE(vrc))
+        return;
+
+    char szLine[1024];
+    while (RT_SUCCESS(RTStrmGetLine(pStrm, szLine, sizeof(szLine))))
+    {
+        /* lease <mac> <address> <state> <issued> <expiration> [<client-id>]
+           del <address> */
+        char    *apszFields[6];
+        unsigned cFields = 0;
+        char    *psz     = RTStrStripL(szLine);
+        while (*psz != '\0' && cFields < RT_ELEMENTS(apszFields))
+        {
+            apszFields[cFields++] = psz;
+            while (*psz != '\0' && !RT_C_IS_SPACE(*psz))
+                psz++;
+            if (*psz != '\0')
+                *psz++ = '\0';
+            psz = RTStrStripL(psz);
+        }
+
+        if (cFields == 2 && strcmp(apszFields[0], "del") == 0)
+        {
+            if (*pfFound && rStrAddress.equals(apszFields[1]))
+                *pfFound = false;
+        }
+        else if (cFields == 6 && strcmp(apszFields[0], "lease") == 0)
+        {
+            RTMAC CurMacAddress;
+            if (   RT_SUCCESS(RTNetStrToMacAddr(apszFields[1], &CurMacAddress))
+                && memcmp(&CurMacAddress, pMacAddress, sizeof(CurMacAddress)) == 0)
+            {
+                int64_t  secIssued   = 0;
+                uint32_t cSecsToLive = 0;
+                RTStrToInt64Full(apszFields[4], 10, &secIssued);
+                RTStrToUInt32Full(apszFields[5], 10, &cSecsToLive);
+                if (   RT_SUCCESS(rStrAddress.assignNoThrow(apszFields[2]))
+                    && RT_SUCCESS(rStrState.assignNoThrow(apszFields[3])))
+                {
+                    *pfFound      = true;
+                    *psecIssued   = secIssued;
+                    *pcSecsToLive = cSecsToLive;
+                }
+            }
+            else if (*pfFound && rStrAddress.equals(apszFields[2]))
+                *pfFound = false; /* the address went to another client */
+        }
+    }
+    RTStrmClose(pStrm);
+}
+
+
 HRESULT DHCPServer::findLeaseByMAC(const com::Utf8Str &aMac, LONG aType,
                                     com::Utf8Str &aAddress, com::Utf8Str &aState, LONG64 *aIssued, LONG64 *aExpire)
 {
@@ -1048,6 +1127,9 @@ HRESULT DHCPServer::findLeaseByMAC(const com::Utf8Str &aMac, LONG aType,
         /*
          * Look for that mac address.
          */
+        bool     fFound      = false;
+        int64_t  secIssued   = 0;
+        uint32_t cSecsToLive = 0;
         xml::ElementNode *pElmRoot = doc.getRootElement();
         if (pElmRoot && pElmRoot->nameEquals("Leases"))
         {
@@ -1065,15 +1147,11 @@ HRESULT DHCPServer::findLeaseByMAC(const com::Utf8Str &aMac, LONG aType,
                         /*
                          * Found it!
                          */
-                        xml::ElementNode const *pElmTime    = pElmLease->findChildElement("Time");
-                        int64_t                 secIssued   = 0;
-                        uint32_t                cSecsToLive = 0;
+                        xml::ElementNode const *pElmTime = pElmLease->findChildElement("Time");
                         if (pElmTime)
                         {
                             pElmTime->getAttributeValue("issued", &secIssued);
                             pElmTime->getAttributeValue("expiration", &cSecsToLive);
-                            *aIssued = secIssued;
-                            *aExpire = secIssued + cSecsToLive;
                         }
                         try
                         {
@@ -1084,17 +1162,32 @@ HRESULT DHCPServer::findLeaseByMAC(const com::Utf8Str &aMac, LONG aType,
                         {
                             return E_OUTOFMEMORY;
                         }
-
-                        /* Check if the lease has expired in the mean time. */
-                        HRESULT hrc = S_OK;
-                        RTTIMESPEC Now;
-                        if (   (aState.equals("acked") || aState.equals("offered") || aState.isEmpty())
-                            && secIssued + cSecsToLive < RTTimeSpecGetSeconds(RTTimeNow(&Now)))
-                            hrc = RT_SUCCESS(aState.assignNoThrow("expired")) ? S_OK : E_OUTOFMEMORY;
-                        return hrc;
+                        fFound = true;
+                        break;
                     }
                 }
         }
+
+        /*
+         * The journal holds the changes made since the leases file was written.
+         */
+        dhcpServerApplyLeaseJournal(m->strLeasesFilename.c_str(), &MacAddress, &fFound, aAddress, aState,
+                                    &secIssued, &cSecsToLive);
+        if (fFound)
+        {
+            *aIssued = secIssued;
+            *aExpire = secIssued + cSecsToLive;
+
+            /* Check if the lease has expired in the mean time. */
+            HRESULT hrc = S_OK;
+            RTTIMESPEC Now;
+            if (   (aState.equals("acked") || aState.equals("offered") || aState.isEmpty())
+                && secIssued + cSecsToLive < RTTimeSpecGetSeconds(RTTimeNow(&Now)))
+                hrc = RT_SUCCESS(aState.assignNoThrow("expired")) ? S_OK : E_OUTOFMEMORY;
+            return hrc;
+        }
+        aAddress.setNull();
+        aState.setNull();
         break;
     }
 
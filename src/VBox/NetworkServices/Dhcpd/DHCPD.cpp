@@ -79,19 +79,19 @@ int DHCPD::i_loadLeases() RT_NOEXCEPT
 
 
 /**
- * Save the current leases to pConfig->getLeasesFilename(), doing expiry first.
+ * Save the changed leases to pConfig->getLeasesFilename().
  *
  * This is called after m_db is updated during a client request, so the on disk
  * database is always up-to-date.   This means it doesn't matter if we're
  * terminated with extreme prejudice, and it allows Main to look up IP addresses
- * for VMs.
+ * for VMs.  The changes go to the journal next to the leases file, which is
+ * folded into it (with expiry) from time to time.
  *
  * @throws nothing
  */
 void DHCPD::i_saveLeases() RT_NOEXCEPT
 {
-    m_db.expire();
-    m_db.writeLeases(m_pConfig->getLeasesFilename());
+    m_db.saveLeases(m_pConfig->getLeasesFilename());
 }
 
 
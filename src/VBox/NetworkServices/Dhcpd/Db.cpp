@@ -30,11 +30,21 @@
 *   Header Files                                                                                                                 *
 *********************************************************************************************************************************/
 #include "DhcpdInternal.h"
+#include <iprt/ctype.h>
 #include <iprt/errcore.h>
+#include <iprt/file.h>
 
 #include "Db.h"
 
 
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** The journal is always allowed to grow to this many records before it is
+ * folded into the leases file, however small the database is. */
+#define DHCPD_JOURNAL_MIN_RECORDS   64
+
+
 /*********************************************************************************************************************************
 *   Global Variables                                                                                                             *
 *********************************************************************************************************************************/
@@ -349,6 +359,107 @@ Binding *Binding::fromXML(const xml::ElementNode *pElmLease)
 }
 
 
+/**
+ * Appends the binding to the lease journal.
+ *
+ * The record is a single line:
+ * @verbatim
+   lease <mac> <address> <state> <issued> <expiration> [<client-id>]
+   @endverbatim
+ *
+ * @returns IPRT status code.
+ * @param   pStrm       The journal stream.
+ * @note    DHCPServerImpl.cpp contains a reader, keep it in sync.
+ */
+int Binding::toJournal(PRTSTREAM pStrm) const RT_NOEXCEPT
+{
+    char szId[255 * 2 + 1];
+    szId[0] = '\0';
+    if (m_id.id().present() && !m_id.id().value().empty())
+    {
+        int rc = RTStrPrintHexBytes(szId, sizeof(szId), &m_id.id().value().front(), m_id.id().value().size(), 0);
+        AssertRCReturn(rc, rc);
+    }
+
+    int rc = RTStrmPrintf(pStrm, "lease %RTmac %RTnaipv4 %s %RI64 %RU32%s%s\n",
+                          &m_id.mac(), m_addr.u, stateName(), m_issued.getAbsSeconds(), m_secLease,
+                          szId[0] ? " " : "", szId);
+    return rc >= 0 ? VINF_SUCCESS : VERR_WRITE_ERROR;
+}
+
+
+/**
+ * Deserializes a "lease" record from the lease journal.
+ *
+ * @param   pszLine     The journal line, modified.
+ * @return  Pointer to the resulting binding, NULL on failure.
+ * @throw   std::bad_alloc
+ */
+Binding *Binding::fromJournal(char *pszLine)
+{
+    /*
+     * Split the line into space separated fields.
+     */
+    char    *apszFields[8];
+    unsigned cFields = 0;
+    char    *psz     = RTStrStripL(pszLine);
+    while (*psz != '\0' && cFields < RT_ELEMENTS(apszFields))
+    {
+        apszFields[cFields++] = psz;
+        while (*psz != '\0' && !RT_C_IS_SPACE(*psz))
+            psz++;
+        if (*psz != '\0')
+            *psz++ = '\0';
+        psz = RTStrStripL(psz);
+    }
+    if (cFields < 6 || cFields > 7 || strcmp(apszFields[0], "lease") != 0)
+        DHCP_LOG_RET_NULL(("Binding::fromJournal: Malformed record with %u fields! Skipping.\n", cFields));
+
+    RTMAC mac;
+    int rc = RTNetStrToMacAddr(apszFields[1], &mac);
+    if (RT_FAILURE(rc))
+        DHCP_LOG_RET_NULL(("Binding::fromJournal: Malformed mac address '%s': %Rrc - Skipping.\n", apszFields[1], rc));
+
+    RTNETADDRIPV4 addr;
+    rc = RTNetStrToIPv4Addr(apszFields[2], &addr);
+    if (RT_FAILURE(rc))
+        DHCP_LOG_RET_NULL(("Binding::fromJournal: Malformed IPv4 address '%s': %Rrc - Skipping.\n", apszFields[2], rc));
+
+    int64_t secIssued;
+    rc = RTStrToInt64Full(apszFields[4], 10, &secIssued);
+    if (rc != VINF_SUCCESS)
+        DHCP_LOG_RET_NULL(("Binding::fromJournal: Malformed issued time '%s' for %RTmac - Skipping.\n", apszFields[4], &mac));
+
+    uint32_t cSecToLive;
+    rc = RTStrToUInt32Full(apszFields[5], 10, &cSecToLive);
+    if (rc != VINF_SUCCESS)
+        DHCP_LOG_RET_NULL(("Binding::fromJournal: Malformed expiration '%s' for %RTmac - Skipping.\n", apszFields[5], &mac));
+
+    std::unique_ptr<Binding> b(new Binding(addr));
+    b->setState(apszFields[3]);
+    b->m_issued   = Timestamp::absSeconds(secIssued);
+    b->m_secLease = cSecToLive;
+
+    if (cFields > 6)
+    {
+        uint8_t abBytes[255];
+        size_t  cbActual;
+        rc = RTStrConvertHexBytesEx(apszFields[6], abBytes, sizeof(abBytes), 0, NULL, &cbActual);
+        if (RT_SUCCESS(rc))
+            b->m_id = ClientId(mac, OptClientId(std::vector<uint8_t>(&abBytes[0], &abBytes[cbActual]))); /* throws bad_alloc */
+        else
+        {
+            LogRel(("Binding::fromJournal: ignoring malformed client id: rc=%Rrc, '%s'\n", rc, apszFields[6]));
+            b->m_id = ClientId(mac, OptClientId());
+        }
+    }
+    else
+        b->m_id = ClientId(mac, OptClientId());
+
+    return b.release();
+}
+
+
 
 /*********************************************************************************************************************************
 *   Class Db Implementation                                                                                                      *
@@ -356,13 +467,25 @@ Binding *Binding::fromXML(const xml::ElementNode *pElmLease)
 
 Db::Db()
     : m_pConfig(NULL)
+    , m_pJournal(NULL)
+    , m_cJournalRecords(0)
 {
 }
 
 
 Db::~Db()
 {
-    /** @todo free bindings */
+    if (m_pJournal)
+    {
+        RTStrmClose(m_pJournal);
+        m_pJournal = NULL;
+    }
+
+    for (addrmap_t::iterator it = m_byAddr.begin(); it != m_byAddr.end(); ++it)
+        delete it->second;
+    m_byAddr.clear();
+    m_byId.clear();
+    m_fixedByMac.clear();
 }
 
 
@@ -420,6 +543,11 @@ int Db::i_enterFixedAddressAssignment(RTNETADDRIPV4 const &a_rAddress, RTMAC con
             return VERR_ADDRESS_CONFLICT;
         }
     }
+    else if (i_findByAddr(a_rAddress) != NULL)
+    {
+        LogRelFunc(("%RTnaipv4 already assigned?\n", a_rAddress));
+        return VERR_ADDRESS_CONFLICT;
+    }
 
     /*
      * Create the binding.
@@ -428,7 +556,17 @@ int Db::i_enterFixedAddressAssignment(RTNETADDRIPV4 const &a_rAddress, RTMAC con
     try
     {
         pBinding = new Binding(a_rAddress, a_rMACAddress, true /*fFixed*/);
-        m_bindings.push_front(pBinding);
+        m_byAddr[RT_N2H_U32(a_rAddress.u)] = pBinding;
+        try
+        {
+            /* The first assignment for a MAC wins, like it did with the list. */
+            m_fixedByMac.insert(macmap_t::value_type(a_rMACAddress, pBinding));
+        }
+        catch (std::bad_alloc &)
+        {
+            m_byAddr.erase(RT_N2H_U32(a_rAddress.u));
+            throw;
+        }
     }
     catch (std::bad_alloc &)
     {
@@ -446,14 +584,36 @@ int Db::i_enterFixedAddressAssignment(RTNETADDRIPV4 const &a_rAddress, RTMAC con
 void Db::expire() RT_NOEXCEPT
 {
     const Timestamp now = Timestamp::now();
-    for (bindings_t::iterator it = m_bindings.begin(); it != m_bindings.end(); ++it)
+    for (addrmap_t::iterator it = m_byAddr.begin(); it != m_byAddr.end(); ++it)
     {
-        Binding *b = *it;
+        Binding *b = it->second;
         b->expire(now);
     }
 }
 
 
+/**
+ * Notes that a binding needs to be written to the lease journal.
+ *
+ * @param   b           The binding that was changed, created or is about to be
+ *                      removed.
+ */
+void Db::i_markDirty(const Binding *b) RT_NOEXCEPT
+{
+    if (b->isFixed())
+        return;
+    try
+    {
+        m_dirty.insert(RT_N2H_U32(b->addr().u));
+    }
+    catch (std::bad_alloc &)
+    {
+        /* Forces a full rewrite on the next save. */
+        m_cJournalRecords = UINT32_MAX;
+    }
+}
+
+
 /**
  * Internal worker that creates a binding for the given client, allocating new
  * IPv4 address for it.
@@ -470,13 +630,14 @@ Binding *Db::i_createBinding(const ClientId &id)
         try
         {
             pBinding = new Binding(addr, id);
-            m_bindings.push_front(pBinding);
+            m_byAddr[RT_N2H_U32(addr.u)] = pBinding;
         }
         catch (std::bad_alloc &)
         {
             if (pBinding)
                 delete pBinding;
-            /** @todo free address (no pool method for that)  */
+            pBinding = NULL;
+            m_pool.release(addr);
         }
     }
     return pBinding;
@@ -506,11 +667,94 @@ Binding *Db::i_createBinding(RTNETADDRIPV4 addr, const ClientId &id)
     }
 
     Binding *b = new Binding(addr, id);
-    m_bindings.push_front(b);
+    try
+    {
+        m_byAddr[RT_N2H_U32(addr.u)] = b;
+    }
+    catch (std::bad_alloc &)
+    {
+        delete b;
+        m_pool.release(addr);
+        throw;
+    }
     return b;
 }
 
 
+/**
+ * Internal worker that unlinks a dynamic binding from the indexes, returns its
+ * address to the pool and deletes it.
+ *
+ * @param   b           The binding to remove.
+ */
+void Db::i_removeBinding(Binding *b) RT_NOEXCEPT
+{
+    Assert(!b->isFixed());
+    i_markDirty(b);
+
+    idmap_t::iterator itId = m_byId.find(b->m_id);
+    if (itId != m_byId.end() && itId->second == b)
+        m_byId.erase(itId);
+    m_byAddr.erase(RT_N2H_U32(b->m_addr.u));
+    m_pool.release(b->m_addr);
+    delete b;
+}
+
+
+/**
+ * Makes room in an exhausted pool by dropping the least valuable bindings.
+ *
+ * Unused bindings are kept around so that returning clients get their old
+ * address back.  When the pool runs dry we scan the database once and return a
+ * batch of them to the pool: free ones first, then released, then expired,
+ * oldest first within each group.  Reclaiming in batches keeps the amortized
+ * cost per allocation logarithmic.
+ *
+ * @returns true if any addresses were reclaimed, false if none were available.
+ */
+bool Db::i_reclaimAddresses() RT_NOEXCEPT
+{
+    /*
+     * Collect the candidates, keyed by (state, expiry time).
+     */
+    typedef std::multimap<std::pair<int, int64_t>, Binding *> candidates_t;
+    candidates_t    candidates;
+    const Timestamp now = Timestamp::now();
+    try
+    {
+        for (addrmap_t::iterator it = m_byAddr.begin(); it != m_byAddr.end(); ++it)
+        {
+            Binding *b = it->second;
+            b->expire(now);
+            if (!b->isFixed() && b->m_state <= Binding::EXPIRED)
+            {
+                Timestamp tsExpire = b->m_issued;
+                tsExpire.addSeconds(b->m_secLease);
+                candidates.insert(candidates_t::value_type(std::make_pair((int)b->m_state, tsExpire.getAbsSeconds()), b));
+            }
+        }
+    }
+    catch (std::bad_alloc &)
+    {
+        if (candidates.empty())
+            return false;
+    }
+    if (candidates.empty())
+        return false;
+
+    /*
+     * Release a sixteenth of the database, but at least a few addresses.
+     */
+    size_t cReclaim = RT_MAX(m_byAddr.size() / 16, 16);
+    for (candidates_t::iterator it = candidates.begin(); it != candidates.end() && cReclaim > 0; ++it, cReclaim--)
+    {
+        LogRel2(("> .... reclaiming %R[binding]\n", it->second));
+        i_removeBinding(it->second);
+    }
+    return true;
+}
+
+
 /**
  * Internal worker that allocates an IPv4 address for the given client, taking
  * the preferred address (@a addr) into account when possible and if non-zero.
@@ -524,128 +768,86 @@ Binding *Db::i_allocateAddress(const ClientId &id, RTNETADDRIPV4 addr)
     else
         LogRel(("> allocateAddress to client %R[id]\n", &id));
 
+    const Timestamp now = Timestamp::now();
+
     /*
-     * Allocate existing address if client has one.  Ignore requested
-     * address in that case.  While here, look for free addresses and
-     * addresses that can be reused.
+     * If the client's MAC address is configured with a fixed
+     * address, give its preconfigured binding.  This takes
+     * precedence over any old leases of the client.
      */
-    Binding        *addrBinding  = NULL;
-    Binding        *freeBinding  = NULL;
-    Binding        *reuseBinding = NULL;
-    const Timestamp now          = Timestamp::now();
-    for (bindings_t::iterator it = m_bindings.begin(); it != m_bindings.end(); ++it)
+    macmap_t::iterator itFixed = m_fixedByMac.find(id.mac());
+    if (itFixed != m_fixedByMac.end())
     {
-        Binding *b = *it;
-        b->expire(now);
-
-        /*
-         * We've already seen this client, give it its old binding.
-         *
-         * If the client's MAC address is configured with a fixed
-         * address, give its preconfigured binding.  Fixed bindings
-         * are always at the head of the m_bindings list, so we
-         * won't be confused by any old leases of the client.
-         */
-        if (b->m_id == id)
-        {
-            LogRel(("> ... found existing binding %R[binding]\n", b));
-            return b;
-        }
-        if (b->isFixed() && b->id().mac() == id.mac())
-        {
+        Binding *b = itFixed->second;
+        if (b->m_id != id)
             b->idUpdate(id);
-            LogRel(("> ... found fixed binding %R[binding]\n", b));
-            return b;
-        }
-
-        if (addr.u != 0 && b->m_addr.u == addr.u)
-        {
-            Assert(addrBinding == NULL);
-            addrBinding = b;
-            LogRel(("> .... noted existing binding %R[binding]\n", addrBinding));
-        }
-
-        /* if we haven't found a free binding yet, keep looking */
-        if (freeBinding == NULL)
-        {
-            if (b->m_state == Binding::FREE)
-            {
-                freeBinding = b;
-                LogRel(("> .... noted free binding %R[binding]\n", freeBinding));
-                continue;
-            }
+        LogRel(("> ... found fixed binding %R[binding]\n", b));
+        return b;
+    }
 
-            /* still no free binding, can this one be reused? */
-            if (b->m_state == Binding::RELEASED)
-            {
-                if (   reuseBinding == NULL
-                    /* released binding is better than an expired one */
-                    || reuseBinding->m_state == Binding::EXPIRED)
-                {
-                    reuseBinding = b;
-                    LogRel(("> .... noted released binding %R[binding]\n", reuseBinding));
-                }
-            }
-            else if (b->m_state == Binding::EXPIRED)
-            {
-                if (   reuseBinding == NULL
-                    /* long expired binding is bettern than a recent one */
-                    /* || (reuseBinding->m_state == Binding::EXPIRED && b->olderThan(reuseBinding)) */)
-                {
-                    reuseBinding = b;
-                    LogRel(("> .... noted expired binding %R[binding]\n", reuseBinding));
-                }
-            }
-        }
+    /*
+     * We've already seen this client, give it its old binding.
+     * Ignore requested address in that case.
+     */
+    idmap_t::iterator itId = m_byId.find(id);
+    if (itId != m_byId.end())
+    {
+        Binding *b = itId->second;
+        b->expire(now);
+        LogRel(("> ... found existing binding %R[binding]\n", b));
+        return b;
     }
 
     /*
      * Allocate requested address if we can.
      */
+    Binding *idBinding = NULL;
     if (addr.u != 0)
     {
+        Binding *addrBinding = i_findByAddr(addr);
         if (addrBinding == NULL)
         {
             addrBinding = i_createBinding(addr, id);
             Assert(addrBinding != NULL);
             LogRel(("> .... creating new binding for this address %R[binding]\n", addrBinding));
-            return addrBinding;
+            idBinding = addrBinding;
         }
-
-        if (addrBinding->m_state <= Binding::EXPIRED) /* not in use */
+        else
         {
-            LogRel(("> .... reusing %s binding for this address\n", addrBinding->stateName()));
-            addrBinding->giveTo(id);
-            return addrBinding;
+            LogRel(("> .... noted existing binding %R[binding]\n", addrBinding));
+            addrBinding->expire(now);
+            if (addrBinding->m_state <= Binding::EXPIRED && !addrBinding->isFixed()) /* not in use */
+            {
+                LogRel(("> .... reusing %s binding for this address\n", addrBinding->stateName()));
+                idBinding = addrBinding;
+            }
+            else
+                LogRel(("> .... cannot reuse %s binding for this address\n", addrBinding->stateName()));
         }
-        LogRel(("> .... cannot reuse %s binding for this address\n", addrBinding->stateName()));
     }
 
     /*
-     * Allocate new (or reuse).
+     * Allocate new, reclaiming unused bindings when the pool is exhausted.
      */
-    Binding *idBinding = NULL;
-    if (freeBinding != NULL)
-    {
-        idBinding = freeBinding;
-        LogRel(("> .... reusing free binding\n"));
-    }
-    else
+    if (idBinding == NULL)
     {
         idBinding = i_createBinding();
+        if (idBinding == NULL && i_reclaimAddresses())
+            idBinding = i_createBinding();
         if (idBinding != NULL)
             LogRel(("> .... creating new binding\n"));
         else
-        {
-            idBinding = reuseBinding;
-            if (idBinding != NULL)
-                LogRel(("> .... reusing %s binding %R[binding]\n", reuseBinding->stateName(), reuseBinding));
-            else
-                DHCP_LOG_RET_NULL(("> .... failed to allocate binding\n"));
-        }
+            DHCP_LOG_RET_NULL(("> .... failed to allocate binding\n"));
     }
 
+    /*
+     * Re-key the binding under its new owner.
+     */
+    idmap_t::iterator itOld = m_byId.find(idBinding->m_id);
+    if (itOld != m_byId.end() && itOld->second == idBinding)
+        m_byId.erase(itOld);
     idBinding->giveTo(id);
+    m_byId[id] = idBinding;
     LogRel(("> .... allocated %R[binding]\n", idBinding));
 
     return idBinding;
@@ -669,23 +871,16 @@ Binding *Db::allocateBinding(const DhcpClientMessage &req, Config::ConfigVec con
      * Get and validate the requested address (if present).
      *
      * Fixed assignments are often outside the dynamic range, so we much detect
-     * those to make sure they aren't rejected based on IP range.  ASSUMES fixed
-     * assignments are at the head of the binding list.
+     * those to make sure they aren't rejected based on IP range.
      */
     OptRequestedAddress reqAddr(req);
     if (reqAddr.present() && !addressBelongs(reqAddr.value()))
     {
-        bool fIsFixed = false;
-        for (bindings_t::iterator it = m_bindings.begin(); it != m_bindings.end() && (*it)->isFixed(); ++it)
-            if (reqAddr.value().u == (*it)->addr().u)
-            {
-                if (   (*it)->id() == id
-                    || (*it)->id().mac() == id.mac())
-                {
-                    fIsFixed = true;
-                    break;
-                }
-            }
+        Binding const *pFixed = i_findByAddr(reqAddr.value());
+        bool const fIsFixed = pFixed
+                           && pFixed->isFixed()
+                           && (   pFixed->id() == id
+                               || pFixed->id().mac() == id.mac());
         if (fIsFixed)
             reqAddr = OptRequestedAddress();
         else if (req.messageType() == RTNET_DHCP_MT_DISCOVER)
@@ -704,6 +899,7 @@ Binding *Db::allocateBinding(const DhcpClientMessage &req, Config::ConfigVec con
     if (b != NULL)
     {
         Assert(b->id() == id);
+        i_markDirty(b);
 
         /*
          * Figure out the lease time.
@@ -768,43 +964,76 @@ int Db::i_addBinding(Binding *pNewBinding) RT_NOEXCEPT
         return VERR_OUT_OF_RANGE;
     }
 
-    for (bindings_t::iterator it = m_bindings.begin(); it != m_bindings.end(); ++it)
+    Binding *b = i_findByAddr(pNewBinding->m_addr);
+    if (b != NULL)
     {
-        Binding *b = *it;
-
-        if (pNewBinding->m_addr.u == b->m_addr.u)
-        {
-            LogRel(("> ADD: %R[binding]\n", pNewBinding));
-            LogRel(("> .... duplicate ip: %R[binding]\n", b));
-            return VERR_DUPLICATE;
-        }
+        LogRel(("> ADD: %R[binding]\n", pNewBinding));
+        LogRel(("> .... duplicate ip: %R[binding]\n", b));
+        return VERR_DUPLICATE;
+    }
 
-        if (pNewBinding->m_id == b->m_id)
-        {
-            LogRel(("> ADD: %R[binding]\n", pNewBinding));
-            LogRel(("> .... duplicate id: %R[binding]\n", b));
-            return VERR_DUPLICATE;
-        }
+    idmap_t::const_iterator itId = m_byId.find(pNewBinding->m_id);
+    macmap_t::const_iterator itFixed = m_fixedByMac.find(pNewBinding->m_id.mac());
+    if (itId != m_byId.end())
+        b = itId->second;
+    else if (itFixed != m_fixedByMac.end() && itFixed->second->m_id == pNewBinding->m_id)
+        b = itFixed->second;
+    if (b != NULL)
+    {
+        LogRel(("> ADD: %R[binding]\n", pNewBinding));
+        LogRel(("> .... duplicate id: %R[binding]\n", b));
+        return VERR_DUPLICATE;
     }
 
     /*
-     * Allocate the address and add the binding to the list.
+     * Allocate the address and add the binding to the indexes.
      */
     AssertLogRelMsgReturn(m_pool.allocate(pNewBinding->m_addr),
                           ("> ADD: failed to claim IP %R[binding]\n", pNewBinding),
                           VERR_INTERNAL_ERROR);
     try
     {
-        m_bindings.push_back(pNewBinding);
+        m_byAddr[RT_N2H_U32(pNewBinding->m_addr.u)] = pNewBinding;
+        try
+        {
+            m_byId[pNewBinding->m_id] = pNewBinding;
+        }
+        catch (std::bad_alloc &)
+        {
+            m_byAddr.erase(RT_N2H_U32(pNewBinding->m_addr.u));
+            throw;
+        }
     }
     catch (std::bad_alloc &)
     {
+        m_pool.release(pNewBinding->m_addr);
         return VERR_NO_MEMORY;
     }
     return VINF_SUCCESS;
 }
 
 
+/**
+ * Internal worker used by i_loadJournal() that adds a binding, replacing any
+ * older dynamic binding for the same address or client.
+ *
+ * @returns IPRT status code.
+ * @param   pNewBinding     The new binding to add.
+ */
+int Db::i_replaceBinding(Binding *pNewBinding) RT_NOEXCEPT
+{
+    Binding *b = i_findByAddr(pNewBinding->m_addr);
+    if (b != NULL && !b->isFixed())
+        i_removeBinding(b);
+
+    idmap_t::iterator itId = m_byId.find(pNewBinding->m_id);
+    if (itId != m_byId.end())
+        i_removeBinding(itId->second);
+
+    return i_addBinding(pNewBinding);
+}
+
+
 /**
  * Called by DHCP to cancel an offset.
  *
@@ -819,27 +1048,24 @@ void Db::cancelOffer(const DhcpClientMessage &req) RT_NOEXCEPT
     const RTNETADDRIPV4 addr = reqAddr.value();
     const ClientId     &id(req.clientId());
 
-    for (bindings_t::iterator it = m_bindings.begin(); it != m_bindings.end(); ++it)
+    Binding *b = i_findByAddr(addr);
+    if (b != NULL && b->id() == id)
     {
-        Binding *b = *it;
-
-        if (b->addr().u == addr.u && b->id() == id)
+        if (b->state() == Binding::OFFERED)
         {
-            if (b->state() == Binding::OFFERED)
+            LogRel2(("Db::cancelOffer: cancelling %R[binding]\n", b));
+            if (!b->isFixed())
             {
-                LogRel2(("Db::cancelOffer: cancelling %R[binding]\n", b));
-                if (!b->isFixed())
-                {
-                    b->setLeaseTime(0);
-                    b->setState(Binding::RELEASED);
-                }
-                else
-                    b->setState(Binding::ACKED);
+                b->setLeaseTime(0);
+                b->setState(Binding::RELEASED);
+                i_markDirty(b);
             }
             else
-                LogRel2(("Db::cancelOffer: not offered state: %R[binding]\n", b));
-            return;
+                b->setState(Binding::ACKED);
         }
+        else
+            LogRel2(("Db::cancelOffer: not offered state: %R[binding]\n", b));
+        return;
     }
     LogRel2(("Db::cancelOffer: not found (%RTnaipv4, %R[id])\n", addr.u, &id));
 }
@@ -857,21 +1083,18 @@ bool Db::releaseBinding(const DhcpClientMessage &req) RT_NOEXCEPT
     const RTNETADDRIPV4 addr = req.ciaddr();
     const ClientId     &id(req.clientId());
 
-    for (bindings_t::iterator it = m_bindings.begin(); it != m_bindings.end(); ++it)
+    Binding *b = i_findByAddr(addr);
+    if (b != NULL && b->id() == id)
     {
-        Binding *b = *it;
-
-        if (b->addr().u == addr.u && b->id() == id)
+        LogRel2(("Db::releaseBinding: releasing %R[binding]\n", b));
+        if (!b->isFixed())
         {
-            LogRel2(("Db::releaseBinding: releasing %R[binding]\n", b));
-            if (!b->isFixed())
-            {
-                b->setState(Binding::RELEASED);
-                return true;
-            }
-            b->setState(Binding::ACKED);
-            return false;
+            b->setState(Binding::RELEASED);
+            i_markDirty(b);
+            return true;
         }
+        b->setState(Binding::ACKED);
+        return false;
     }
 
     LogRel2(("Db::releaseBinding: not found (%RTnaipv4, %R[id])\n", addr.u, &id));
@@ -908,9 +1131,9 @@ int Db::writeLeases(const RTCString &strFilename) const RT_NOEXCEPT
         /*
          * Add the leases.
          */
-        for (bindings_t::const_iterator it = m_bindings.begin(); it != m_bindings.end(); ++it)
+        for (addrmap_t::const_iterator it = m_byAddr.begin(); it != m_byAddr.end(); ++it)
         {
-            const Binding *b = *it;
+            const Binding *b = it->second;
             if (!b->isFixed())
                 b->toXML(pElmRoot);
         }
@@ -949,9 +1172,123 @@ int Db::writeLeases(const RTCString &strFilename) const RT_NOEXCEPT
 }
 
 
+/**
+ * Called by DHCPD to persist the changes made to the lease database.
+ *
+ * The changed bindings are appended to the journal.  Once the journal holds
+ * more records than there are bindings, the database is expired and written
+ * out to @a strFilename in full and the journal is started afresh.
+ *
+ * @returns IPRT status code.
+ * @param   strFilename         The leases file.
+ */
+int Db::saveLeases(const RTCString &strFilename) RT_NOEXCEPT
+{
+    if (m_strJournal.isEmpty())
+    {
+        int rc = m_strJournal.assignNoThrow(strFilename);
+        if (RT_SUCCESS(rc))
+            rc = m_strJournal.appendNoThrow(".journal");
+        if (RT_FAILURE(rc))
+            return rc;
+    }
+
+    /* The journal is relative to the leases file, so that must exist first. */
+    size_t const cMaxRecords = RT_MAX(m_byAddr.size(), (size_t)DHCPD_JOURNAL_MIN_RECORDS);
+    if (   (m_pJournal || RTFileExists(strFilename.c_str()))
+        && m_cJournalRecords < cMaxRecords
+        && m_dirty.size() <= cMaxRecords - m_cJournalRecords)
+    {
+        int rc = i_flushJournal();
+        if (RT_SUCCESS(rc))
+            return rc;
+        LogRel(("Db::saveLeases: failed to update journal (%Rrc), rewriting leases\n", rc));
+    }
+
+    return i_compactJournal(strFilename);
+}
+
+
+/**
+ * Appends the changed bindings to the journal.
+ *
+ * @returns IPRT status code.
+ */
+int Db::i_flushJournal() RT_NOEXCEPT
+{
+    if (m_dirty.empty())
+        return VINF_SUCCESS;
+
+    if (!m_pJournal)
+    {
+        int rc = RTStrmOpen(m_strJournal.c_str(), "a", &m_pJournal);
+        if (RT_FAILURE(rc))
+        {
+            m_pJournal = NULL;
+            return rc;
+        }
+    }
+
+    int rc = VINF_SUCCESS;
+    for (std::set<IPV4HADDR>::const_iterator it = m_dirty.begin(); it != m_dirty.end() && RT_SUCCESS(rc); ++it)
+    {
+        addrmap_t::const_iterator itBinding = m_byAddr.find(*it);
+        if (itBinding == m_byAddr.end())
+            rc = RTStrmPrintf(m_pJournal, "del %RTnaipv4\n", RT_H2N_U32(*it)) >= 0 ? VINF_SUCCESS : VERR_WRITE_ERROR;
+        else if (!itBinding->second->isFixed())
+            rc = itBinding->second->toJournal(m_pJournal);
+        else
+            continue;
+        m_cJournalRecords++;
+    }
+    if (RT_SUCCESS(rc))
+        rc = RTStrmFlush(m_pJournal);
+    if (RT_SUCCESS(rc))
+        m_dirty.clear();
+    return rc;
+}
+
+
+/**
+ * Folds the journal into the leases file.
+ *
+ * The leases file is written first (safely) and the journal deleted after, so
+ * a crash in between only means the journal is replayed once more on load.
+ *
+ * @returns IPRT status code.
+ * @param   strFilename         The leases file.
+ */
+int Db::i_compactJournal(const RTCString &strFilename) RT_NOEXCEPT
+{
+    expire();
+
+    int rc = writeLeases(strFilename);
+    if (RT_SUCCESS(rc))
+    {
+        m_dirty.clear();
+        m_cJournalRecords = 0;
+        if (m_pJournal)
+        {
+            RTStrmClose(m_pJournal);
+            m_pJournal = NULL;
+        }
+        if (m_strJournal.isNotEmpty())
+        {
+            int rc2 = RTFileDelete(m_strJournal.c_str());
+            if (RT_FAILURE(rc2) && rc2 != VERR_FILE_NOT_FOUND)
+                LogRel(("Db::i_compactJournal: failed to delete '%s': %Rrc\n", m_strJournal.c_str(), rc2));
+        }
+    }
+    return rc;
+}
+
+
 /**
  * Called by DHCPD to load the lease database to @a strFilename.
  *
+ * Any journal left behind is replayed on top of the leases file and then
+ * folded into it.
+ *
  * @note Does not clear the database state before doing the load.
  *
  * @returns IPRT status code.
@@ -962,10 +1299,17 @@ int Db::loadLeases(const RTCString &strFilename) RT_NOEXCEPT
 {
     LogRel(("loading leases from %s\n", strFilename.c_str()));
 
+    int rc = m_strJournal.assignNoThrow(strFilename);
+    if (RT_SUCCESS(rc))
+        rc = m_strJournal.appendNoThrow(".journal");
+    if (RT_FAILURE(rc))
+        return rc;
+
     /*
      * Load the file into an XML document.
      */
     xml::Document doc;
+    bool fHaveDoc = true;
     try
     {
         xml::XmlFileParser parser;
@@ -974,7 +1318,8 @@ int Db::loadLeases(const RTCString &strFilename) RT_NOEXCEPT
     catch (const xml::EIPRTFailure &e)
     {
         LogRel(("%s\n", e.what()));
-        return e.rc();
+        rc = e.rc();
+        fHaveDoc = false;
     }
     catch (const RTCError &e)
     {
@@ -990,35 +1335,52 @@ int Db::loadLeases(const RTCString &strFilename) RT_NOEXCEPT
     /*
      * Check that the root element is "Leases" and process its children.
      */
-    xml::ElementNode *pElmRoot = doc.getRootElement();
-    if (!pElmRoot)
+    if (fHaveDoc)
     {
-        LogRel(("No root element in '%s'\n", strFilename.c_str()));
-        return VERR_NOT_FOUND;
-    }
-    if (!pElmRoot->nameEquals("Leases"))
-    {
-        LogRel(("No root element is not 'Leases' in '%s', but '%s'\n", strFilename.c_str(), pElmRoot->getName()));
-        return VERR_NOT_FOUND;
-    }
+        xml::ElementNode *pElmRoot = doc.getRootElement();
+        if (!pElmRoot)
+        {
+            LogRel(("No root element in '%s'\n", strFilename.c_str()));
+            return VERR_NOT_FOUND;
+        }
+        if (!pElmRoot->nameEquals("Leases"))
+        {
+            LogRel(("No root element is not 'Leases' in '%s', but '%s'\n", strFilename.c_str(), pElmRoot->getName()));
+            return VERR_NOT_FOUND;
+        }
 
-    int                     rc = VINF_SUCCESS;
-    xml::NodesLoop          it(*pElmRoot);
-    const xml::ElementNode *pElmLease;
-    while ((pElmLease = it.forAllNodes()) != NULL)
-    {
-        if (pElmLease->nameEquals("Lease"))
+        xml::NodesLoop          it(*pElmRoot);
+        const xml::ElementNode *pElmLease;
+        while ((pElmLease = it.forAllNodes()) != NULL)
         {
-            int rc2 = i_loadLease(pElmLease);
-            if (RT_SUCCESS(rc2))
-            { /* likely */ }
-            else if (rc2 == VERR_NO_MEMORY)
-                return rc2;
+            if (pElmLease->nameEquals("Lease"))
+            {
+                int rc2 = i_loadLease(pElmLease);
+                if (RT_SUCCESS(rc2))
+                { /* likely */ }
+                else if (rc2 == VERR_NO_MEMORY)
+                    return rc2;
+                else
+                    rc = -rc2;
+            }
             else
-                rc = -rc2;
+                LogRel(("Ignoring unexpected element '%s' under 'Leases'...\n", pElmLease->getName()));
         }
-        else
-            LogRel(("Ignoring unexpected element '%s' under 'Leases'...\n", pElmLease->getName()));
+    }
+
+    /*
+     * Replay the journal (if any) and fold it into the leases file.
+     */
+    int rc2 = i_loadJournal();
+    if (rc2 == VERR_NO_MEMORY)
+        return rc2;
+    if (rc2 != VERR_FILE_NOT_FOUND)
+    {
+        if (RT_FAILURE(rc2))
+            LogRel(("Failed to read journal '%s': %Rrc\n", m_strJournal.c_str(), rc2));
+        rc2 = i_compactJournal(strFilename);
+        if (RT_SUCCESS(rc2) && !fHaveDoc)
+            rc = VINF_SUCCESS;
     }
 
     return rc;
@@ -1058,3 +1420,78 @@ int Db::i_loadLease(const xml::ElementNode *pElmLease) RT_NOEXCEPT
     LogRel(("> LOAD: failed to load lease!\n"));
     return VERR_PARSE_ERROR;
 }
+
+
+/**
+ * Internal worker for loadLeases() that replays the journal.
+ *
+ * Records are applied in order, later ones replacing earlier ones.  A torn
+ * record at the end (crash while appending) is skipped like any other
+ * malformed one.
+ *
+ * @returns IPRT status code, VERR_FILE_NOT_FOUND if there is no journal.
+ */
+int Db::i_loadJournal() RT_NOEXCEPT
+{
+    PRTSTREAM pStrm;
+    int rc = RTStrmOpen(m_strJournal.c_str(), "r", &pStrm);
+    if (RT_FAILURE(rc))
+        return rc == VERR_PATH_NOT_FOUND ? VERR_FILE_NOT_FOUND : rc;
+
+    LogRel(("replaying lease journal %s\n", m_strJournal.c_str()));
+
+    uint32_t cRecords = 0;
+    char     szLine[1024];
+    while (RT_SUCCESS(rc = RTStrmGetLine(pStrm, szLine, sizeof(szLine))))
+    {
+        cRecords++;
+        if (strncmp(szLine, RT_STR_TUPLE("del ")) == 0)
+        {
+            RTNETADDRIPV4 addr;
+            char *pszAddr = RTStrStrip(&szLine[sizeof("del ") - 1]);
+            if (RT_SUCCESS(RTNetStrToIPv4Addr(pszAddr, &addr)))
+            {
+                Binding *b = i_findByAddr(addr);
+                if (b != NULL && !b->isFixed())
+                {
+                    LogRel2(("> JOURNAL: removing %R[binding]\n", b));
+                    i_removeBinding(b);
+                }
+            }
+            else
+                LogRel(("> JOURNAL: malformed address '%s' in del record\n", pszAddr));
+            continue;
+        }
+
+        Binding *pBinding = NULL;
+        try
+        {
+            pBinding = Binding::fromJournal(szLine);
+        }
+        catch (std::bad_alloc &)
+        {
+            rc = VERR_NO_MEMORY;
+            break;
+        }
+        if (pBinding)
+        {
+            LogRel2(("> JOURNAL: lease %R[binding]\n", pBinding));
+            pBinding->expire();
+            int rc2 = i_replaceBinding(pBinding);
+            if (RT_FAILURE(rc2))
+                delete pBinding;
+            if (rc2 == VERR_NO_MEMORY)
+            {
+                rc = rc2;
+                break;
+            }
+        }
+    }
+    RTStrmClose(pStrm);
+
+    /* The replayed changes are folded into the leases file by the caller. */
+    m_dirty.clear();
+
+    LogRel(("replayed %u journal records\n", cRecords));
+    return rc == VERR_EOF ? VINF_SUCCESS : rc;
+}
@@ -34,10 +34,12 @@
 #include "DhcpdInternal.h"
 #include <iprt/net.h>
 
+#include <iprt/stream.h>
 #include <iprt/cpp/ministring.h>
 #include <iprt/cpp/xml.h>
 
-#include <list>
+#include <map>
+#include <set>
 
 #include "Timestamp.h"
 #include "ClientId.h"
@@ -143,6 +145,8 @@ public:
      * @{ */
     static Binding *fromXML(const xml::ElementNode *pElmLease);
     void            toXML(xml::ElementNode *pElmParent) const;
+    static Binding *fromJournal(char *pszLine);
+    int             toJournal(PRTSTREAM pStrm) const RT_NOEXCEPT;
     /** @} */
 
     /** @name String formatting of %R[binding].
@@ -170,18 +174,40 @@ private:
 class Db
 {
 private:
-    typedef std::list<Binding *> bindings_t;
+    /** Bindings keyed by host order IPv4 address. */
+    typedef std::map<IPV4HADDR, Binding *> addrmap_t;
+    /** Dynamic bindings keyed by client ID. */
+    typedef std::map<ClientId, Binding *>  idmap_t;
+    /** Fixed bindings keyed by MAC address. */
+    typedef std::map<RTMAC, Binding *>     macmap_t;
 
     /** Configuration (set at init).
      * @note Currently not used.  */
     const Config   *m_pConfig;
-    /** The lease database.
-     * @note Since fixed assignments are added during initialization, they will
-     *       always be first.  The allocateBinding() code depends on this.  */
-    bindings_t      m_bindings;
+    /** The lease database, owns all the bindings. */
+    addrmap_t       m_byAddr;
+    /** Index of the dynamic bindings by client ID. */
+    idmap_t         m_byId;
+    /** Index of the fixed assignments by MAC address.  These are looked up
+     *  before m_byId, so a configured client always gets its fixed address. */
+    macmap_t        m_fixedByMac;
     /** Address allocation pool. */
     IPv4Pool        m_pool;
 
+    /** @name Lease journal
+     * Changes are appended to "<leases file>.journal" and folded into the XML
+     * leases file when the journal grows larger than the database.
+     * @{ */
+    /** Addresses of the bindings changed since the last journal flush. */
+    std::set<IPV4HADDR> m_dirty;
+    /** The journal file name. */
+    RTCString       m_strJournal;
+    /** The journal stream, NULL if not open. */
+    PRTSTREAM       m_pJournal;
+    /** Number of records in the journal. */
+    uint32_t        m_cJournalRecords;
+    /** @} */
+
 public:
     Db();
     ~Db();
@@ -201,8 +227,12 @@ public:
     /** @name Database serialization methods
      * @{ */
     int      loadLeases(const RTCString &strFilename) RT_NOEXCEPT;
+    int      saveLeases(const RTCString &strFilename) RT_NOEXCEPT;
 private:
     int      i_loadLease(const xml::ElementNode *pElmLease) RT_NOEXCEPT;
+    int      i_loadJournal() RT_NOEXCEPT;
+    int      i_flushJournal() RT_NOEXCEPT;
+    int      i_compactJournal(const RTCString &strFilename) RT_NOEXCEPT;
 public:
     int      writeLeases(const RTCString &strFilename) const RT_NOEXCEPT;
     /** @} */
@@ -213,9 +243,19 @@ private:
     Binding *i_createBinding(RTNETADDRIPV4 addr, const ClientId &id = ClientId());
 
     Binding *i_allocateAddress(const ClientId &id, RTNETADDRIPV4 addr);
+    bool     i_reclaimAddresses() RT_NOEXCEPT;
+
+    Binding *i_findByAddr(RTNETADDRIPV4 addr) const RT_NOEXCEPT
+    {
+        addrmap_t::const_iterator it = m_byAddr.find(RT_N2H_U32(addr.u));
+        return it != m_byAddr.end() ? it->second : NULL;
+    }
+    void     i_markDirty(const Binding *b) RT_NOEXCEPT;
 
     /* add binding e.g. from the leases file */
     int      i_addBinding(Binding *pNewBinding) RT_NOEXCEPT;
+    int      i_replaceBinding(Binding *pNewBinding) RT_NOEXCEPT;
+    void     i_removeBinding(Binding *b) RT_NOEXCEPT;
 };
 
 #endif /* !VBOX_INCLUDED_SRC_Dhcpd_Db_h */
@@ -75,29 +75,18 @@ int IPv4Pool::i_insert(const IPv4Range &a_Range) RT_NOEXCEPT
 
     /*
      * Check that the incoming range doesn't overlap with existing ranges in the pool.
+     * Since the ranges are disjoint and sorted, only the predecessor needs checking.
      */
     it_t itHint = m_pool.upper_bound(IPv4Range(a_Range.LastAddr)); /* successor, insertion hint */
-#if 0 /** @todo r=bird: This code is wrong.  It has no end() check for starters.  Since the method is
-       *                only for internal consumption, I've replaced it with a strict build assertion. */
     if (itHint != m_pool.begin())
     {
-        it_t prev(itHint);
-        --prev;
-        if (a_Range.FirstAddr <= prev->LastAddr)
-        {
-            LogRel(("%08x-%08x conflicts with %08x-%08x\n",
-                     a_Range.FirstAddr, a_Range.LastAddr,
-                     prev->FirstAddr, prev->LastAddr));
-            return VERR_INVALID_PARAMETER;
-        }
+        it_t itPrev(itHint);
+        --itPrev;
+        AssertMsgReturn(itPrev->LastAddr < a_Range.FirstAddr,
+                        ("%08RX32-%08RX32 conflicts with %08RX32-%08RX32\n",
+                         a_Range.FirstAddr, a_Range.LastAddr, itPrev->FirstAddr, itPrev->LastAddr),
+                        VERR_INVALID_PARAMETER);
     }
-#endif
-#ifdef VBOX_STRICT
-    for (it_t it2 = m_pool.begin(); it2 != m_pool.end(); ++it2)
-        AssertMsg(it2->LastAddr < a_Range.FirstAddr || it2->FirstAddr > a_Range.LastAddr,
-                  ("%08RX32-%08RX32 conflicts with %08RX32-%08RX32\n",
-                   a_Range.FirstAddr, a_Range.LastAddr, it2->FirstAddr, it2->LastAddr));
-#endif
 
     /*
      * No overlaps, insert it.
@@ -132,30 +121,10 @@ RTNETADDRIPV4 IPv4Pool::allocate()
         if (itBeg->FirstAddr == itBeg->LastAddr)
             m_pool.erase(itBeg);
         else
-        {
-            /* Trim the entry (re-inserting it): */
-            IPv4Range trimmed = *itBeg;
-            trimmed.FirstAddr += 1;
-            Assert(trimmed.FirstAddr <= trimmed.LastAddr);
-            m_pool.erase(itBeg);
-            try
-            {
-                m_pool.insert(trimmed);
-            }
-            catch (std::bad_alloc &)
-            {
-                /** @todo r=bird: Theortically the insert could fail with a bad_alloc and we'd
-                 * drop a range of IP address.  It would be nice if we could safely modify itBit
-                 * without having to re-insert it.  The author of this code (not bird) didn't
-                 * seem to think this safe?
-                 *
-                 * If we want to play safe and all that, just use a AVLRU32TREE (or AVLRU64TREE
-                 * if lazy) AVL tree from IPRT.  Since we know exactly how it's implemented and
-                 * works, there will be no uncertanties like this when using it (both here
-                 * and in the i_insert validation logic). */
-                LogRelFunc(("Caught bad_alloc! We're truely buggered now!\n"));
-            }
-        }
+            /* Trim the entry in place.  Shrinking a range cannot change its
+               position relative to the other (disjoint) ranges, so the set
+               ordering stays valid and we avoid a re-insert that could throw. */
+            i_mutable(itBeg).FirstAddr += 1;
     }
     else
         RetAddr.u = 0;
@@ -182,28 +151,91 @@ bool IPv4Pool::allocate(RTNETADDRIPV4 a_Addr)
         if (it->contains(a_Addr))
         {
             /*
-             * Remove a_Addr from the range by way of re-insertion.
+             * Remove a_Addr from the range, trimming it in place where possible.
              */
             const IPV4HADDR haddr = RT_N2H_U32(a_Addr.u);
-            IPV4HADDR       first = it->FirstAddr;
-            IPV4HADDR       last  = it->LastAddr;
-
-            m_pool.erase(it);
-            if (first != last)
+            IPV4HADDR const first = it->FirstAddr;
+            IPV4HADDR const last  = it->LastAddr;
+
+            if (first == last)
+                m_pool.erase(it);
+            else if (haddr == first)
+                i_mutable(it).FirstAddr = first + 1;
+            else if (haddr == last)
+                i_mutable(it).LastAddr = last - 1;
+            else
             {
-                if (haddr == first)
-                    i_insert(++first, last);
-                else if (haddr == last)
-                    i_insert(first, --last);
-                else
+                /* Split: keep the lower part in place, insert the upper part. */
+                i_mutable(it).LastAddr = haddr - 1;
+                int rc = i_insert(haddr + 1, last);
+                if (RT_FAILURE(rc))
                 {
-                    i_insert(first, haddr - 1);
-                    i_insert(haddr + 1, last);
+                    i_mutable(it).LastAddr = last;
+                    return false;
                 }
             }
-
             return true;
         }
     }
     return false;
 }
+
+
+/**
+ * Returns the given address to the pool.
+ *
+ * The address is merged with the adjacent available ranges, so the pool does
+ * not fragment when addresses are allocated and released in random order.
+ *
+ * @returns Success indicator, false if the address is outside the pool range
+ *          or already available.
+ * @param   a_Addr      The IP address to release (network order).
+ */
+bool IPv4Pool::release(RTNETADDRIPV4 a_Addr)
+{
+    if (!m_range.contains(a_Addr))
+        return false;
+    const IPV4HADDR haddr = RT_N2H_U32(a_Addr.u);
+
+    /*
+     * Locate the neighbours: the first range above the address and the one below it.
+     */
+    it_t itNext = m_pool.lower_bound(IPv4Range(haddr));
+    if (itNext != m_pool.end() && itNext->contains(haddr))
+        return false; /* not allocated */
+
+    it_t itPrev = itNext;
+    bool fMergePrev = false;
+    if (itPrev != m_pool.begin())
+    {
+        --itPrev;
+        fMergePrev = itPrev->LastAddr + 1 == haddr;
+    }
+    bool const fMergeNext = itNext != m_pool.end() && itNext->FirstAddr == haddr + 1;
+
+    /*
+     * Extend or join the neighbours in place, or insert a new single address range.
+     */
+    if (fMergePrev && fMergeNext)
+    {
+        IPV4HADDR const last = itNext->LastAddr;
+        m_pool.erase(itNext);
+        i_mutable(itPrev).LastAddr = last;
+    }
+    else if (fMergePrev)
+        i_mutable(itPrev).LastAddr = haddr;
+    else if (fMergeNext)
+        i_mutable(itNext).FirstAddr = haddr;
+    else
+    {
+        try
+        {
+            m_pool.insert(itNext, IPv4Range(haddr));
+        }
+        catch (std::bad_alloc &)
+        {
+            return false;
+        }
+    }
+    return true;
+}
@@ -120,7 +120,9 @@ class IPv4Pool
 
     /** The IPv4 range of this pool. */
     IPv4Range   m_range;
-    /** Pool of available IPv4 ranges. */
+    /** Pool of available IPv4 ranges.
+     * The ranges never overlap or touch, so allocating and releasing a single
+     * address is one lookup plus at most one insert or erase. */
     set_t       m_pool;
 
 public:
@@ -132,6 +134,7 @@ public:
 
     RTNETADDRIPV4 allocate();
     bool          allocate(RTNETADDRIPV4);
+    bool          release(RTNETADDRIPV4);
 
     /**
      * Checks if the pool range includes @a a_Addr (allocation status not considered).
@@ -142,6 +145,11 @@ public:
     }
 
 private:
+    /** Gets a modifiable reference to a pool entry.
+     * Only for changes that keep the entry disjoint from its neighbours, as
+     * that preserves the set ordering. */
+    static IPv4Range &i_mutable(it_t it) RT_NOEXCEPT { return const_cast<IPv4Range &>(*it); }
+
     int i_insert(const IPv4Range &range) RT_NOEXCEPT;
 #if 0
     int i_insert(IPV4HADDR a_Single) RT_NOEXCEPT                          { return i_insert(IPv4Range(a_Single)); }
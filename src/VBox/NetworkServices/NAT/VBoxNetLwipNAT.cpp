@@ -57,6 +57,7 @@
 #include <iprt/pipe.h>
 #include <iprt/string.h>
 #include <iprt/mem.h>
+#include <iprt/mp.h>
 #include <iprt/message.h>
 #include <iprt/req.h>
 #include <iprt/file.h>
@@ -107,6 +108,7 @@ extern "C"
 #include "netif/etharp.h"
 
 #include "proxy.h"
+#include "proxy_pollmgr.h"
 #include "pxremap.h"
 #include "portfwd.h"
 }
@@ -215,6 +217,7 @@ private:
     int initIPv4();
     int initIPv4LoopbackMap();
     int initIPv6();
+    int initPollManager();
     int initComEvents();
 
     int getExtraData(com::Utf8Str &strValueOut, const char *pcszKey);
@@ -282,6 +285,7 @@ VBoxNetLwipNAT::VBoxNetLwipNAT()
 #endif
     m_ProxyOptions.lomap_desc = NULL;
     m_ProxyOptions.nameservers = NULL;
+    m_ProxyOptions.pollmgr_threads = 1;
 
     m_LwipNetIf.name[0] = 'N';
     m_LwipNetIf.name[1] = 'T';
@@ -464,6 +468,9 @@ int VBoxNetLwipNAT::init()
     if (RT_FAILURE(rc))
         return rc;
 
+    /* How many threads to poll proxied host sockets with. */
+    initPollManager();
+
 
     fetchNatPortForwardRules(m_vecPortForwardRule4, /* :fIsIPv6 */ false);
     if (m_ProxyOptions.ipv6_enabled)
@@ -670,6 +677,41 @@ int VBoxNetLwipNAT::initIPv4()
 }
 
 
+/**
+ * Get the number of poll manager threads from extra data.
+ *
+ * "NAT/<network>/PollThreads" selects how many threads poll the host
+ * sockets of proxied connections.  Zero means pick a default based on
+ * the number of online CPUs.  lwIP itself stays on its single tcpip
+ * thread regardless.
+ */
+int VBoxNetLwipNAT::initPollManager()
+{
+    com::Utf8Str strPollThreads;
+    int rc = getExtraData(strPollThreads, "PollThreads");
+    if (RT_FAILURE(rc) || strPollThreads.isEmpty())
+        return VINF_SUCCESS;
+
+    uint32_t cThreads;
+    rc = RTStrToUInt32Full(strPollThreads.c_str(), 10, &cThreads);
+    if (rc != VINF_SUCCESS)
+    {
+        LogRel(("Failed to parse \"%s\" poll thread count\n",
+                strPollThreads.c_str()));
+        return VINF_SUCCESS;
+    }
+
+    if (cThreads == 0)
+        cThreads = RT_CLAMP(RTMpGetOnlineCount() / 2, 1, 4);
+    else if (cThreads > POLLMGR_MAX_THREADS)
+        cThreads = POLLMGR_MAX_THREADS;
+
+    m_ProxyOptions.pollmgr_threads = (int)cThreads;
+    LogRel(("Will use %u poll manager threads\n", cThreads));
+    return VINF_SUCCESS;
+}
+
+
 /**
  * Create raw IPv4 socket for sending and snooping ICMP.
  */
@@ -1391,6 +1433,9 @@ VBoxNetLwipNAT::run()
      * Tell other threads to wrap up.
      */
 
+    /* per-thread proxy traffic, useful to check the sharding */
+    pollmgr_stats_log();
+
     /* tell the intnet input pump to terminate */
     IntNetR3IfWaitAbort(m_hIf);
 
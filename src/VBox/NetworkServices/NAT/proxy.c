@@ -66,7 +66,7 @@ static FNRTSTRFORMATTYPE proxy_sockerr_rtstrfmt;
 static SOCKET proxy_create_socket(int, int);
 
 volatile struct proxy_options *g_proxy_options;
-static sys_thread_t pollmgr_tid;
+static sys_thread_t pollmgr_tid[POLLMGR_MAX_THREADS];
 
 /* XXX: for mapping loopbacks to addresses in our network (ip4) */
 struct netif *g_proxy_netif;
@@ -81,6 +81,7 @@ void
 proxy_init(struct netif *proxy_netif, struct proxy_options *opts)
 {
     int status;
+    int i;
 
     LWIP_ASSERT1(opts != NULL);
     LWIP_UNUSED_ARG(proxy_netif);
@@ -108,7 +109,7 @@ proxy_init(struct netif *proxy_netif, struct proxy_options *opts)
         tftpd_init(proxy_netif, opts->tftp_root);
     }
 
-    status = pollmgr_init();
+    status = pollmgr_init(opts->pollmgr_threads);
     if (status < 0) {
         errx(EXIT_FAILURE, "failed to initialize poll manager");
         /* NOTREACHED */
@@ -123,13 +124,23 @@ proxy_init(struct netif *proxy_netif, struct proxy_options *opts)
 
     pxping_init(proxy_netif, opts->icmpsock4, opts->icmpsock6);
 
-    pollmgr_tid = sys_thread_new("pollmgr_thread",
-                                 pollmgr_thread, NULL,
-                                 DEFAULT_THREAD_STACKSIZE,
-                                 DEFAULT_THREAD_PRIO);
-    if (!pollmgr_tid) {
-        errx(EXIT_FAILURE, "failed to create poll manager thread");
-        /* NOTREACHED */
+    /*
+     * The first poll manager thread also serves the channels, port
+     * forwarding, dns and ping.  Proxied connections are spread over
+     * all of them.
+     */
+    for (i = 0; i < pollmgr_nthreads(); ++i) {
+        pollmgr_tid[i] = sys_thread_new("pollmgr_thread",
+                                        pollmgr_thread, (void *)(intptr_t)i,
+                                        DEFAULT_THREAD_STACKSIZE,
+                                        DEFAULT_THREAD_PRIO);
+        if (!pollmgr_tid[i]) {
+            errx(EXIT_FAILURE, "failed to create poll manager thread");
+            /* NOTREACHED */
+        }
+    }
+    if (pollmgr_nthreads() > 1) {
+        LogRel(("NAT: using %d poll manager threads\n", pollmgr_nthreads()));
     }
 }
 
@@ -51,8 +51,11 @@
 #include "winpoll.h"
 #endif
 
+#include <iprt/asm.h>
 #include <iprt/req.h>
 #include <iprt/errcore.h>
+#include <iprt/thread.h>
+#include <VBox/log.h>
 
 
 #define POLLMGR_GARBAGE (-1)
@@ -72,7 +75,30 @@ struct pollmgr_chan {
     bool arg_valid;
 };
 
+/*
+ * Per-thread counters.  Updated with atomics since connection
+ * traffic is also accounted from the lwip thread.
+ */
+struct pollmgr_stats {
+    volatile uint64_t npolls;     /* poll(2) wakeups */
+    volatile uint64_t nevents;    /* handler callbacks */
+    volatile uint64_t nrequests;  /* channel requests */
+    volatile uint64_t nconns;     /* dynamic slots added */
+    volatile uint64_t nbytes_in;  /* read from host sockets */
+    volatile uint64_t nbytes_out; /* written to host sockets */
+};
+
+/*
+ * There is one poll manager per poll manager thread.  The first one
+ * polls the channels, port-forwarding listeners, dns and ping
+ * sockets.  Proxied tcp connections and udp conversations are
+ * distributed over all of them by flow hash (see
+ * pollmgr_flow_shard()).  All callbacks for a given socket run on
+ * the thread of the poll manager it was added to.
+ */
 struct pollmgr {
+    int index;
+
     struct pollfd *fds;
     struct pollmgr_handler **handlers;
     nfds_t capacity;            /* allocated size of the arrays */
@@ -88,15 +114,29 @@ struct pollmgr {
     RTREQQUEUE queue;
     struct pollmgr_handler queue_handler;
     struct pollmgr_chan chan_handlers[POLLMGR_CHAN_COUNT];
-} pollmgr;
 
+    /* see pollmgr_udpbuf */
+    u8_t *udpbuf;
+
+    struct pollmgr_stats stats;
+};
+
+static struct pollmgr pollmgr_instances[POLLMGR_MAX_THREADS];
+static int pollmgr_count;
+
+/* poll manager of the current thread, see pollmgr_self() */
+static RTTLS pollmgr_tls = NIL_RTTLS;
+
+
+static int pollmgr_init_one(struct pollmgr *, int);
+static struct pollmgr *pollmgr_self(void);
 
 static int pollmgr_queue_callback(struct pollmgr_handler *, SOCKET, int);
-static DECLCALLBACK(void) pollmgr_chan_call_handler(int, void *);
+static DECLCALLBACK(void) pollmgr_chan_call_handler(struct pollmgr *, int, void *);
 
-static void pollmgr_loop(void);
+static void pollmgr_loop(struct pollmgr *);
 
-static void pollmgr_add_at(int, struct pollmgr_handler *, SOCKET, int);
+static void pollmgr_add_at(struct pollmgr *, int, struct pollmgr_handler *, SOCKET, int);
 static void pollmgr_refptr_delete(struct pollmgr_refptr *);
 
 
@@ -109,13 +149,58 @@ static void pollmgr_refptr_delete(struct pollmgr_refptr *);
  * fragmentation.
  *
  * We can use shared buffer here since we read from sockets
- * sequentially in a loop over pollfd.
+ * sequentially in a loop over pollfd.  This one belongs to the first
+ * poll manager, the others allocate their own, see
+ * pollmgr_thread_udpbuf().
  */
 u8_t pollmgr_udpbuf[64 * 1024];
 
 
+/*
+ * Create "nthreads" poll managers.  The threads themselves are
+ * started by the caller with pollmgr_thread().
+ */
 int
-pollmgr_init(void)
+pollmgr_init(int nthreads)
+{
+    int status;
+    int i;
+
+    if (nthreads < 1) {
+        nthreads = 1;
+    }
+    else if (nthreads > POLLMGR_MAX_THREADS) {
+        nthreads = POLLMGR_MAX_THREADS;
+    }
+
+    if (nthreads > 1) {
+        int rc = RTTlsAllocEx(&pollmgr_tls, NULL);
+        if (RT_FAILURE(rc)) {
+            DPRINTF0(("%s: RTTlsAllocEx: %Rrc\n", __func__, rc));
+            nthreads = 1;
+        }
+    }
+
+    for (i = 0; i < nthreads; ++i) {
+        status = pollmgr_init_one(&pollmgr_instances[i], i);
+        if (status < 0) {
+            if (i == 0) {
+                return -1;
+            }
+
+            /* run with what we've got */
+            LogRel(("NAT: failed to create poll manager #%d, using %d\n", i, i));
+            break;
+        }
+    }
+
+    pollmgr_count = i;
+    return 0;
+}
+
+
+static int
+pollmgr_init_one(struct pollmgr *pm, int index)
 {
     struct pollfd *newfds;
     struct pollmgr_handler **newhdls;
@@ -123,25 +208,37 @@ pollmgr_init(void)
     int rc, status;
     nfds_t i;
 
-    rc = RTReqQueueCreate(&pollmgr.queue);
+    pm->index = index;
+
+    if (index == 0) {
+        pm->udpbuf = pollmgr_udpbuf;
+    }
+    else {
+        pm->udpbuf = (u8_t *)malloc(sizeof(pollmgr_udpbuf));
+        if (pm->udpbuf == NULL) {
+            return -1;
+        }
+    }
+
+    rc = RTReqQueueCreate(&pm->queue);
     if (RT_FAILURE(rc))
-        return -1;
+        goto cleanup_buf;
 
-    pollmgr.fds = NULL;
-    pollmgr.handlers = NULL;
-    pollmgr.capacity = 0;
-    pollmgr.nfds = 0;
+    pm->fds = NULL;
+    pm->handlers = NULL;
+    pm->capacity = 0;
+    pm->nfds = 0;
 
     for (i = 0; i < POLLMGR_SLOT_STATIC_COUNT; ++i) {
-        pollmgr.chan[i][POLLMGR_CHFD_RD] = INVALID_SOCKET;
-        pollmgr.chan[i][POLLMGR_CHFD_WR] = INVALID_SOCKET;
+        pm->chan[i][POLLMGR_CHFD_RD] = INVALID_SOCKET;
+        pm->chan[i][POLLMGR_CHFD_WR] = INVALID_SOCKET;
     }
 
     for (i = 0; i < POLLMGR_SLOT_STATIC_COUNT; ++i) {
 #ifndef RT_OS_WINDOWS
         int j;
 
-        status = socketpair(PF_LOCAL, SOCK_DGRAM, 0, pollmgr.chan[i]);
+        status = socketpair(PF_LOCAL, SOCK_DGRAM, 0, pm->chan[i]);
         if (status < 0) {
             DPRINTF(("socketpair: %R[sockerr]\n", SOCKERRNO()));
             goto cleanup_close;
@@ -149,7 +246,7 @@ pollmgr_init(void)
 
         /* now manually make them O_NONBLOCK */
         for (j = 0; j < 2; ++j) {
-            int s = pollmgr.chan[i][j];
+            int s = pm->chan[i][j];
             int sflags;
 
             sflags = fcntl(s, F_GETFL, 0);
@@ -165,7 +262,7 @@ pollmgr_init(void)
             }
         }
 #else
-        status = RTWinSocketPair(PF_INET, SOCK_DGRAM, 0, pollmgr.chan[i]);
+        status = RTWinSocketPair(PF_INET, SOCK_DGRAM, 0, pm->chan[i]);
         if (RT_FAILURE(status)) {
             goto cleanup_close;
         }
@@ -177,89 +274,208 @@ pollmgr_init(void)
     LWIP_ASSERT1(newcap >= POLLMGR_SLOT_STATIC_COUNT);
 
     newfds = (struct pollfd *)
-        malloc(newcap * sizeof(*pollmgr.fds));
+        malloc(newcap * sizeof(*pm->fds));
     if (newfds == NULL) {
         DPRINTF(("%s: Failed to allocate fds array\n", __func__));
         goto cleanup_close;
     }
 
     newhdls = (struct pollmgr_handler **)
-        malloc(newcap * sizeof(*pollmgr.handlers));
+        malloc(newcap * sizeof(*pm->handlers));
     if (newhdls == NULL) {
         DPRINTF(("%s: Failed to allocate handlers array\n", __func__));
         free(newfds);
         goto cleanup_close;
     }
 
-    pollmgr.capacity = newcap;
-    pollmgr.fds = newfds;
-    pollmgr.handlers = newhdls;
+    pm->capacity = newcap;
+    pm->fds = newfds;
+    pm->handlers = newhdls;
 
-    pollmgr.nfds = POLLMGR_SLOT_STATIC_COUNT;
+    pm->nfds = POLLMGR_SLOT_STATIC_COUNT;
 
-    for (i = 0; i < pollmgr.capacity; ++i) {
-        pollmgr.fds[i].fd = INVALID_SOCKET;
-        pollmgr.fds[i].events = 0;
-        pollmgr.fds[i].revents = 0;
+    for (i = 0; i < pm->capacity; ++i) {
+        pm->fds[i].fd = INVALID_SOCKET;
+        pm->fds[i].events = 0;
+        pm->fds[i].revents = 0;
     }
 
     /* add request queue notification */
-    pollmgr.queue_handler.callback = pollmgr_queue_callback;
-    pollmgr.queue_handler.data = NULL;
-    pollmgr.queue_handler.slot = -1;
+    pm->queue_handler.callback = pollmgr_queue_callback;
+    pm->queue_handler.data = pm;
+    pm->queue_handler.slot = -1;
+    pm->queue_handler.shard = index;
 
-    pollmgr_add_at(POLLMGR_QUEUE, &pollmgr.queue_handler,
-                   pollmgr.chan[POLLMGR_QUEUE][POLLMGR_CHFD_RD],
+    pollmgr_add_at(pm, POLLMGR_QUEUE, &pm->queue_handler,
+                   pm->chan[POLLMGR_QUEUE][POLLMGR_CHFD_RD],
                    POLLIN);
 
     return 0;
 
   cleanup_close:
     for (i = 0; i < POLLMGR_SLOT_STATIC_COUNT; ++i) {
-        SOCKET *chan = pollmgr.chan[i];
+        SOCKET *chan = pm->chan[i];
         if (chan[POLLMGR_CHFD_RD] != INVALID_SOCKET) {
             closesocket(chan[POLLMGR_CHFD_RD]);
             closesocket(chan[POLLMGR_CHFD_WR]);
         }
     }
+    RTReqQueueDestroy(pm->queue);
+    pm->queue = NIL_RTREQQUEUE;
+
+  cleanup_buf:
+    if (pm->udpbuf != pollmgr_udpbuf) {
+        free(pm->udpbuf);
+    }
+    pm->udpbuf = NULL;
 
     return -1;
 }
 
 
+/*
+ * Poll manager of the calling thread.  Code that runs before the
+ * poll manager threads are started (e.g. pxdns_init()) and the
+ * lwip thread get the first one.
+ */
+static struct pollmgr *
+pollmgr_self(void)
+{
+    struct pollmgr *pm = NULL;
+
+    if (pollmgr_tls != NIL_RTTLS) {
+        pm = (struct pollmgr *)RTTlsGet(pollmgr_tls);
+    }
+
+    return pm != NULL ? pm : &pollmgr_instances[0];
+}
+
+
+int
+pollmgr_nthreads(void)
+{
+    return pollmgr_count;
+}
+
+
+/*
+ * Pick the poll manager for a new proxied connection by hashing its
+ * addresses and ports (FNV-1a), so that the connections are spread
+ * evenly and the same flow always lands on the same thread.
+ */
+int
+pollmgr_flow_shard(const void *key, size_t keylen)
+{
+    const u8_t *p = (const u8_t *)key;
+    uint32_t hash = UINT32_C(2166136261);
+    size_t i;
+
+    if (pollmgr_count <= 1) {
+        return 0;
+    }
+
+    for (i = 0; i < keylen; ++i) {
+        hash ^= p[i];
+        hash *= UINT32_C(16777619);
+    }
+
+    return (int)(hash % (uint32_t)pollmgr_count);
+}
+
+
+/*
+ * Pick the poll manager for a new proxied TCP connection or UDP
+ * conversation from its lwIP pcb addresses and ports.
+ */
+int
+pollmgr_flow_shard_pcb(int is_ipv6,
+                       const ipX_addr_t *local_ip, const ipX_addr_t *remote_ip,
+                       u16_t local_port, u16_t remote_port)
+{
+    struct {
+        ipX_addr_t local_ip;
+        ipX_addr_t remote_ip;
+        u16_t local_port;
+        u16_t remote_port;
+    } key;
+
+    if (pollmgr_count <= 1) {
+        return 0;
+    }
+
+    memset(&key, 0, sizeof(key));
+    ipX_addr_copy(is_ipv6, key.local_ip, *local_ip);
+    ipX_addr_copy(is_ipv6, key.remote_ip, *remote_ip);
+    key.local_port = local_port;
+    key.remote_port = remote_port;
+
+    return pollmgr_flow_shard(&key, sizeof(key));
+}
+
+
+/*
+ * Datagram buffer of the calling poll manager thread.  Same size as
+ * pollmgr_udpbuf.
+ */
+u8_t *
+pollmgr_thread_udpbuf(void)
+{
+    return pollmgr_self()->udpbuf;
+}
+
+
 /*
  * Add new channel.  We now implement channels with request queue, so
  * all channels get the same socket that triggers queue processing.
+ * The handler is shared by all poll managers.
  *
  * Must be called before pollmgr loop is started, so no locking.
  */
 SOCKET
 pollmgr_add_chan(int slot, struct pollmgr_handler *handler)
 {
+    int i;
+
     AssertReturn(0 <= slot && slot < POLLMGR_CHAN_COUNT, INVALID_SOCKET);
     AssertReturn(handler != NULL && handler->callback != NULL, INVALID_SOCKET);
 
     handler->slot = slot;
-    pollmgr.chan_handlers[slot].handler = handler;
-    return pollmgr.chan[POLLMGR_QUEUE][POLLMGR_CHFD_WR];
+    handler->shard = 0;
+    for (i = 0; i < pollmgr_count; ++i) {
+        pollmgr_instances[i].chan_handlers[slot].handler = handler;
+    }
+    return pollmgr_instances[0].chan[POLLMGR_QUEUE][POLLMGR_CHFD_WR];
+}
+
+
+/*
+ * Send to the channel of the first poll manager.
+ */
+ssize_t
+pollmgr_chan_send(int slot, void *buf, size_t nbytes)
+{
+    return pollmgr_chan_send_to(0, slot, buf, nbytes);
 }
 
 
 /*
  * This used to actually send data over the channel's socket.  Now we
  * queue a request and send single byte notification over shared
- * POLLMGR_QUEUE socket.
+ * POLLMGR_QUEUE socket of the specified poll manager.
  */
 ssize_t
-pollmgr_chan_send(int slot, void *buf, size_t nbytes)
+pollmgr_chan_send_to(int shard, int slot, void *buf, size_t nbytes)
 {
     static const char notification = 0x5a;
 
+    struct pollmgr *pm;
     void *ptr;
     SOCKET fd;
     ssize_t nsent;
 
     AssertReturn(0 <= slot && slot < POLLMGR_CHAN_COUNT, -1);
+    AssertReturn(0 <= shard && shard < pollmgr_count, -1);
+    pm = &pollmgr_instances[shard];
 
     /*
      * XXX: Hack alert.  We only ever "sent" single pointer which was
@@ -274,15 +490,15 @@ pollmgr_chan_send(int slot, void *buf, size_t nbytes)
 
     ptr = *(void **)buf;
 
-    int rc = RTReqQueueCallEx(pollmgr.queue, NULL, 0, RTREQFLAGS_VOID | RTREQFLAGS_NO_WAIT,
-                              (PFNRT)pollmgr_chan_call_handler, 2, slot, ptr);
+    int rc = RTReqQueueCallEx(pm->queue, NULL, 0, RTREQFLAGS_VOID | RTREQFLAGS_NO_WAIT,
+                              (PFNRT)pollmgr_chan_call_handler, 3, pm, slot, ptr);
     if (RT_FAILURE(rc))
     {
         DPRINTF(("Queuing pollmgr_chan_call_handler() on poll manager queue failed with %Rrc\n", rc));
         return -1;
     }
 
-    fd = pollmgr.chan[POLLMGR_QUEUE][POLLMGR_CHFD_WR];
+    fd = pm->chan[POLLMGR_QUEUE][POLLMGR_CHFD_WR];
     nsent = send(fd, &notification, 1, 0);
     if (nsent == SOCKET_ERROR) {
         DPRINTF(("send on chan %d: %R[sockerr]\n", slot, SOCKERRNO()));
@@ -305,10 +521,11 @@ pollmgr_chan_send(int slot, void *buf, size_t nbytes)
 static int
 pollmgr_queue_callback(struct pollmgr_handler *handler, SOCKET fd, int revents)
 {
-    RT_NOREF(handler, revents);
-    Assert(pollmgr.queue != NIL_RTREQQUEUE);
+    struct pollmgr *pm = (struct pollmgr *)handler->data;
+    RT_NOREF(revents);
+    Assert(pm->queue != NIL_RTREQQUEUE);
 
-    ssize_t nread = recv(fd, (char *)pollmgr_udpbuf, sizeof(pollmgr_udpbuf), 0);
+    ssize_t nread = recv(fd, (char *)pm->udpbuf, sizeof(pollmgr_udpbuf), 0);
     if (nread == SOCKET_ERROR) {
         DPRINTF0(("%s: recv: %R[sockerr]\n", __func__, SOCKERRNO()));
         return POLLIN;
@@ -319,7 +536,7 @@ pollmgr_queue_callback(struct pollmgr_handler *handler, SOCKET fd, int revents)
         return POLLIN;
     }
 
-    int rc = RTReqQueueProcess(pollmgr.queue, 0);
+    int rc = RTReqQueueProcess(pm->queue, 0);
     if (RT_UNLIKELY(rc != VERR_TIMEOUT && RT_FAILURE_NP(rc))) {
         DPRINTF0(("%s: RTReqQueueProcess: %Rrc\n", __func__, rc));
     }
@@ -333,19 +550,21 @@ pollmgr_queue_callback(struct pollmgr_handler *handler, SOCKET fd, int revents)
  * handler's callback.
  */
 static void
-pollmgr_chan_call_handler(int slot, void *arg)
+pollmgr_chan_call_handler(struct pollmgr *pm, int slot, void *arg)
 {
     struct pollmgr_handler *handler;
     int nevents;
 
     AssertReturnVoid(0 <= slot && slot < POLLMGR_CHAN_COUNT);
 
-    handler = pollmgr.chan_handlers[slot].handler;
+    handler = pm->chan_handlers[slot].handler;
     AssertReturnVoid(handler != NULL && handler->callback != NULL);
 
+    ASMAtomicIncU64(&pm->stats.nrequests);
+
     /* arrange for pollmgr_chan_recv_ptr() to "receive" the arg */
-    pollmgr.chan_handlers[slot].arg = arg;
-    pollmgr.chan_handlers[slot].arg_valid = true;
+    pm->chan_handlers[slot].arg = arg;
+    pm->chan_handlers[slot].arg_valid = true;
 
     nevents = handler->callback(handler, INVALID_SOCKET, POLLIN);
     if (nevents != POLLIN) {
@@ -360,6 +579,7 @@ pollmgr_chan_call_handler(int slot, void *arg)
 void *
 pollmgr_chan_recv_ptr(struct pollmgr_handler *handler, SOCKET fd, int revents)
 {
+    struct pollmgr *pm = pollmgr_self();
     int slot;
     void *ptr;
 
@@ -380,13 +600,13 @@ pollmgr_chan_recv_ptr(struct pollmgr_handler *handler, SOCKET fd, int revents)
 
     LWIP_ASSERT1(revents & POLLIN);
 
-    if (!pollmgr.chan_handlers[slot].arg_valid) {
+    if (!pm->chan_handlers[slot].arg_valid) {
         err(EXIT_FAILURE, "chan %d: recv", (int)handler->slot);
         /* NOTREACHED */
     }
 
-    ptr = pollmgr.chan_handlers[slot].arg;
-    pollmgr.chan_handlers[slot].arg_valid = false;
+    ptr = pm->chan_handlers[slot].arg;
+    pm->chan_handlers[slot].arg_valid = false;
 
     return ptr;
 }
@@ -394,35 +614,37 @@ pollmgr_chan_recv_ptr(struct pollmgr_handler *handler, SOCKET fd, int revents)
 
 /*
  * Must be called from pollmgr loop (via callbacks), so no locking.
+ * The socket is added to the poll manager of the calling thread.
  */
 int
 pollmgr_add(struct pollmgr_handler *handler, SOCKET fd, int events)
 {
+    struct pollmgr *pm = pollmgr_self();
     int slot;
 
     DPRINTF2(("%s: new fd %d\n", __func__, fd));
 
-    if (pollmgr.nfds == pollmgr.capacity) {
+    if (pm->nfds == pm->capacity) {
         struct pollfd *newfds;
         struct pollmgr_handler **newhdls;
         nfds_t newcap;
         nfds_t i;
 
-        newcap = pollmgr.capacity * 2;
+        newcap = pm->capacity * 2;
 
         newfds = (struct pollfd *)
-            realloc(pollmgr.fds, newcap * sizeof(*pollmgr.fds));
+            realloc(pm->fds, newcap * sizeof(*pm->fds));
         if (newfds == NULL) {
             DPRINTF(("%s: Failed to reallocate fds array\n", __func__));
             handler->slot = -1;
             return -1;
         }
 
-        pollmgr.fds = newfds; /* don't crash/leak if realloc(handlers) fails */
+        pm->fds = newfds; /* don't crash/leak if realloc(handlers) fails */
         /* but don't update capacity yet! */
 
         newhdls = (struct pollmgr_handler **)
-            realloc(pollmgr.handlers, newcap * sizeof(*pollmgr.handlers));
+            realloc(pm->handlers, newcap * sizeof(*pm->handlers));
         if (newhdls == NULL) {
             DPRINTF(("%s: Failed to reallocate handlers array\n", __func__));
             /* if we failed to realloc here, then fds points to the
@@ -431,10 +653,10 @@ pollmgr_add(struct pollmgr_handler *handler, SOCKET fd, int events)
             return -1;
         }
 
-        pollmgr.handlers = newhdls;
-        pollmgr.capacity = newcap;
+        pm->handlers = newhdls;
+        pm->capacity = newcap;
 
-        for (i = pollmgr.nfds; i < newcap; ++i) {
+        for (i = pm->nfds; i < newcap; ++i) {
             newfds[i].fd = INVALID_SOCKET;
             newfds[i].events = 0;
             newfds[i].revents = 0;
@@ -442,21 +664,23 @@ pollmgr_add(struct pollmgr_handler *handler, SOCKET fd, int events)
         }
     }
 
-    slot = pollmgr.nfds;
-    ++pollmgr.nfds;
+    slot = pm->nfds;
+    ++pm->nfds;
 
-    pollmgr_add_at(slot, handler, fd, events);
+    pollmgr_add_at(pm, slot, handler, fd, events);
+    handler->shard = pm->index;
+    ASMAtomicIncU64(&pm->stats.nconns);
     return slot;
 }
 
 
 static void
-pollmgr_add_at(int slot, struct pollmgr_handler *handler, SOCKET fd, int events)
+pollmgr_add_at(struct pollmgr *pm, int slot, struct pollmgr_handler *handler, SOCKET fd, int events)
 {
-    pollmgr.fds[slot].fd = fd;
-    pollmgr.fds[slot].events = events;
-    pollmgr.fds[slot].revents = 0;
-    pollmgr.handlers[slot] = handler;
+    pm->fds[slot].fd = fd;
+    pm->fds[slot].events = events;
+    pm->fds[slot].revents = 0;
+    pm->handlers[slot] = handler;
 
     handler->slot = slot;
 }
@@ -465,35 +689,97 @@ pollmgr_add_at(int slot, struct pollmgr_handler *handler, SOCKET fd, int events)
 void
 pollmgr_update_events(int slot, int events)
 {
+    struct pollmgr *pm = pollmgr_self();
+
     LWIP_ASSERT1(slot >= POLLMGR_SLOT_FIRST_DYNAMIC);
-    LWIP_ASSERT1((nfds_t)slot < pollmgr.nfds);
+    LWIP_ASSERT1((nfds_t)slot < pm->nfds);
 
-    pollmgr.fds[slot].events = events;
+    pm->fds[slot].events = events;
 }
 
 
 void
 pollmgr_del_slot(int slot)
 {
+    struct pollmgr *pm = pollmgr_self();
+
     LWIP_ASSERT1(slot >= POLLMGR_SLOT_FIRST_DYNAMIC);
 
     DPRINTF2(("%s(%d): fd %d ! DELETED\n",
-              __func__, slot, pollmgr.fds[slot].fd));
+              __func__, slot, pm->fds[slot].fd));
 
-    pollmgr.fds[slot].fd = INVALID_SOCKET; /* see poll loop */
+    pm->fds[slot].fd = INVALID_SOCKET; /* see poll loop */
 }
 
 
+/*
+ * Account traffic of a connection to the poll manager that owns it.
+ * Called from both the poll manager and the lwip threads.
+ */
 void
-pollmgr_thread(void *ignored)
+pollmgr_stats_add_in(int shard, size_t nbytes)
 {
-    LWIP_UNUSED_ARG(ignored);
-    pollmgr_loop();
+    if (RT_LIKELY(0 <= shard && shard < pollmgr_count)) {
+        ASMAtomicAddU64(&pollmgr_instances[shard].stats.nbytes_in, nbytes);
+    }
+}
+
+
+void
+pollmgr_stats_add_out(int shard, size_t nbytes)
+{
+    if (RT_LIKELY(0 <= shard && shard < pollmgr_count)) {
+        ASMAtomicAddU64(&pollmgr_instances[shard].stats.nbytes_out, nbytes);
+    }
+}
+
+
+/*
+ * Dump per-thread counters to the release log.
+ */
+void
+pollmgr_stats_log(void)
+{
+    int i;
+
+    for (i = 0; i < pollmgr_count; ++i) {
+        struct pollmgr *pm = &pollmgr_instances[i];
+
+        LogRel(("NAT: pollmgr#%d: %RU64 polls, %RU64 events, %RU64 requests, %RU64 sockets added,"
+                " %RU64 bytes in, %RU64 bytes out\n",
+                i,
+                ASMAtomicReadU64(&pm->stats.npolls),
+                ASMAtomicReadU64(&pm->stats.nevents),
+                ASMAtomicReadU64(&pm->stats.nrequests),
+                ASMAtomicReadU64(&pm->stats.nconns),
+                ASMAtomicReadU64(&pm->stats.nbytes_in),
+                ASMAtomicReadU64(&pm->stats.nbytes_out)));
+    }
+}
+
+
+/*
+ * Thread function, the argument is the poll manager index.
+ */
+void
+pollmgr_thread(void *arg)
+{
+    const int index = (int)(intptr_t)arg;
+    struct pollmgr *pm;
+
+    AssertReturnVoid(0 <= index && index < pollmgr_count);
+    pm = &pollmgr_instances[index];
+
+    if (pollmgr_tls != NIL_RTTLS) {
+        RTTlsSet(pollmgr_tls, pm);
+    }
+
+    pollmgr_loop(pm);
 }
 
 
 static void
-pollmgr_loop(void)
+pollmgr_loop(struct pollmgr *pm)
 {
     int nready;
     SOCKET delfirst;
@@ -502,9 +788,9 @@ pollmgr_loop(void)
 
     for (;;) {
 #ifndef RT_OS_WINDOWS
-        nready = poll(pollmgr.fds, pollmgr.nfds, -1);
+        nready = poll(pm->fds, pm->nfds, -1);
 #else
-        int rc = RTWinPoll(pollmgr.fds, pollmgr.nfds,RT_INDEFINITE_WAIT, &nready);
+        int rc = RTWinPoll(pm->fds, pm->nfds,RT_INDEFINITE_WAIT, &nready);
         if (RT_FAILURE(rc)) {
             err(EXIT_FAILURE, "poll"); /* XXX: what to do on error? */
             /* NOTREACHED*/
@@ -526,17 +812,19 @@ pollmgr_loop(void)
             continue;           /* - but be defensive */
         }
 
+        ASMAtomicIncU64(&pm->stats.npolls);
+
 
         delfirst = INVALID_SOCKET;
         pdelprev = &delfirst;
 
-        for (i = 0; (nfds_t)i < pollmgr.nfds && nready > 0; ++i) {
+        for (i = 0; (nfds_t)i < pm->nfds && nready > 0; ++i) {
             struct pollmgr_handler *handler;
             SOCKET fd;
             int revents, nevents;
 
-            fd = pollmgr.fds[i].fd;
-            revents = pollmgr.fds[i].revents;
+            fd = pm->fds[i].fd;
+            revents = pm->fds[i].revents;
 
             /*
              * Channel handlers can request deletion of dynamic slots
@@ -558,7 +846,7 @@ pollmgr_loop(void)
             }
             --nready;
 
-            handler = pollmgr.handlers[i];
+            handler = pm->handlers[i];
 
             if (handler != NULL && handler->callback != NULL) {
 #ifdef LWIP_PROXY_DEBUG
@@ -578,6 +866,7 @@ pollmgr_loop(void)
                 }
 # endif /* LWIP_PROXY_DEBUG / DEBUG */
 #endif
+                ASMAtomicIncU64(&pm->stats.nevents);
                 nevents = (*handler->callback)(handler, fd, revents);
             }
             else {
@@ -593,32 +882,32 @@ pollmgr_loop(void)
 
           update_events:
             if (nevents >= 0) {
-                if (nevents != pollmgr.fds[i].events) {
+                if (nevents != pm->fds[i].events) {
                     DPRINTF2(("%s: fd %d ! nevents 0x%x\n",
                               __func__, fd, nevents));
                 }
-                pollmgr.fds[i].events = nevents;
+                pm->fds[i].events = nevents;
             }
             else if (i < POLLMGR_SLOT_FIRST_DYNAMIC) {
                 /* Don't garbage-collect channels. */
                 DPRINTF2(("%s: fd %d ! DELETED (channel %d)\n",
                           __func__, fd, i));
-                pollmgr.fds[i].fd = INVALID_SOCKET;
-                pollmgr.fds[i].events = 0;
-                pollmgr.fds[i].revents = 0;
-                pollmgr.handlers[i] = NULL;
+                pm->fds[i].fd = INVALID_SOCKET;
+                pm->fds[i].events = 0;
+                pm->fds[i].revents = 0;
+                pm->handlers[i] = NULL;
             }
             else {
                 DPRINTF2(("%s: fd %d ! DELETED\n", __func__, fd));
 
                 /* schedule for deletion (see g/c loop for details) */
                 *pdelprev = i;  /* make previous entry point to us */
-                pdelprev = &pollmgr.fds[i].fd;
+                pdelprev = &pm->fds[i].fd;
 
-                pollmgr.fds[i].fd = INVALID_SOCKET; /* end of list (for now) */
-                pollmgr.fds[i].events = POLLMGR_GARBAGE;
-                pollmgr.fds[i].revents = 0;
-                pollmgr.handlers[i] = NULL;
+                pm->fds[i].fd = INVALID_SOCKET; /* end of list (for now) */
+                pm->fds[i].events = POLLMGR_GARBAGE;
+                pm->fds[i].revents = 0;
+                pm->handlers[i] = NULL;
             }
         } /* processing loop */
 
@@ -636,33 +925,33 @@ pollmgr_loop(void)
          * processing loop above.
          */
         while (delfirst != INVALID_SOCKET) {
-            const int last = pollmgr.nfds - 1;
+            const int last = pm->nfds - 1;
 
             /*
              * We want a live entry in the last slot to swap into the
              * freed slot, so make sure we have one.
              */
-            if (pollmgr.fds[last].events == POLLMGR_GARBAGE /* garbage */
-                || pollmgr.fds[last].fd == INVALID_SOCKET)  /* or killed */
+            if (pm->fds[last].events == POLLMGR_GARBAGE /* garbage */
+                || pm->fds[last].fd == INVALID_SOCKET)  /* or killed */
             {
                 /* drop garbage entry at the end of the array */
-                --pollmgr.nfds;
+                --pm->nfds;
 
                 if (delfirst == (SOCKET)last) {
-                    /* congruent to delnext >= pollmgr.nfds test below */
+                    /* congruent to delnext >= pm->nfds test below */
                     delfirst = INVALID_SOCKET; /* done */
                 }
             }
             else {
-                const SOCKET delnext = pollmgr.fds[delfirst].fd;
+                const SOCKET delnext = pm->fds[delfirst].fd;
 
                 /* copy live entry at the end to the first slot being freed */
-                pollmgr.fds[delfirst] = pollmgr.fds[last]; /* struct copy */
-                pollmgr.handlers[delfirst] = pollmgr.handlers[last];
-                pollmgr.handlers[delfirst]->slot = (int)delfirst;
-                --pollmgr.nfds;
+                pm->fds[delfirst] = pm->fds[last]; /* struct copy */
+                pm->handlers[delfirst] = pm->handlers[last];
+                pm->handlers[delfirst]->slot = (int)delfirst;
+                --pm->nfds;
 
-                if ((nfds_t)delnext >= pollmgr.nfds) {
+                if ((nfds_t)delnext >= pm->nfds) {
                     delfirst = INVALID_SOCKET; /* done */
                 }
                 else {
@@ -670,10 +959,10 @@ pollmgr_loop(void)
                 }
             }
 
-            pollmgr.fds[last].fd = INVALID_SOCKET;
-            pollmgr.fds[last].events = 0;
-            pollmgr.fds[last].revents = 0;
-            pollmgr.handlers[last] = NULL;
+            pm->fds[last].fd = INVALID_SOCKET;
+            pm->fds[last].events = 0;
+            pm->fds[last].revents = 0;
+            pm->handlers[last] = NULL;
         }
     } /* poll loop */
 }
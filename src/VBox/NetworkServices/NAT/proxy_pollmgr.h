@@ -35,6 +35,7 @@
 # include <unistd.h>             /* for ssize_t */
 #endif
 #include "lwip/sys.h"
+#include "lwip/ip_addr.h"
 
 enum pollmgr_slot_t {
     POLLMGR_CHAN_PXTCP_ADD,     /* new proxy tcp connection from guest */
@@ -59,6 +60,7 @@ struct pollmgr_handler {
     pollmgr_callback callback;
     void *data;
     int slot;
+    int shard;                  /* poll manager (thread) polling us */
 };
 
 struct pollmgr_refptr {
@@ -68,11 +70,20 @@ struct pollmgr_refptr {
     size_t weak;
 };
 
-int pollmgr_init(void);
+/* upper limit for the number of poll manager threads */
+#define POLLMGR_MAX_THREADS 16
+
+int pollmgr_init(int nthreads);
+int pollmgr_nthreads(void);
+int pollmgr_flow_shard(const void *key, size_t keylen);
+int pollmgr_flow_shard_pcb(int is_ipv6,
+                           const ipX_addr_t *local_ip, const ipX_addr_t *remote_ip,
+                           u16_t local_port, u16_t remote_port);
 
 /* static named slots (aka "channels") */
 SOCKET pollmgr_add_chan(int, struct pollmgr_handler *);
 ssize_t pollmgr_chan_send(int, void *buf, size_t nbytes);
+ssize_t pollmgr_chan_send_to(int shard, int, void *buf, size_t nbytes);
 void *pollmgr_chan_recv_ptr(struct pollmgr_handler *, SOCKET, int);
 
 /* dynamic slots */
@@ -89,7 +100,14 @@ void pollmgr_del_slot(int);
 
 void pollmgr_thread(void *);
 
+/* per-thread statistics */
+void pollmgr_stats_add_in(int shard, size_t nbytes);
+void pollmgr_stats_add_out(int shard, size_t nbytes);
+void pollmgr_stats_log(void);
+
 /* buffer for callbacks to receive udp without worrying about truncation */
 extern u8_t pollmgr_udpbuf[64 * 1024];
+/* - the same for code that may run on any poll manager thread */
+u8_t *pollmgr_thread_udpbuf(void);
 
 #endif /* !VBOX_INCLUDED_SRC_NAT_proxy_pollmgr_h */
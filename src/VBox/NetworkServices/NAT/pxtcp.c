@@ -354,7 +354,7 @@ pxtcp_init(void)
 static ssize_t
 pxtcp_chan_send(enum pollmgr_slot_t slot, struct pxtcp *pxtcp)
 {
-    return pollmgr_chan_send(slot, &pxtcp, sizeof(pxtcp));
+    return pollmgr_chan_send_to(pxtcp->pmhdl.shard, slot, &pxtcp, sizeof(pxtcp));
 }
 
 
@@ -366,7 +366,7 @@ static ssize_t
 pxtcp_chan_send_weak(enum pollmgr_slot_t slot, struct pxtcp *pxtcp)
 {
     pollmgr_refptr_weak_ref(pxtcp->rp);
-    return pollmgr_chan_send(slot, &pxtcp->rp, sizeof(pxtcp->rp));
+    return pollmgr_chan_send_to(pxtcp->pmhdl.shard, slot, &pxtcp->rp, sizeof(pxtcp->rp));
 }
 
 
@@ -604,6 +604,7 @@ pxtcp_allocate(void)
     pxtcp->pmhdl.callback = NULL;
     pxtcp->pmhdl.data = (void *)pxtcp;
     pxtcp->pmhdl.slot = -1;
+    pxtcp->pmhdl.shard = 0;
 
     pxtcp->pcb = NULL;
     pxtcp->sock = INVALID_SOCKET;
@@ -1080,6 +1081,9 @@ pxtcp_pcb_accept_outbound(struct tcp_pcb *newpcb, struct pbuf *p,
     pxtcp->sock = sock;
 
     pxtcp->pmhdl.callback = pxtcp_pmgr_connect;
+    pxtcp->pmhdl.shard = pollmgr_flow_shard_pcb(PCB_ISIPV6(newpcb),
+                                                &newpcb->local_ip, &newpcb->remote_ip,
+                                                newpcb->local_port, newpcb->remote_port);
     pxtcp->events = POLLOUT;
 
     nsent = pxtcp_chan_send(POLLMGR_CHAN_PXTCP_ADD, pxtcp);
@@ -1540,6 +1544,9 @@ pxtcp_pcb_forward_outbound(struct pxtcp *pxtcp, struct pbuf *p)
          * to process outbound traffic.
          */
         nsent = pxtcp_sock_send(pxtcp, iov, i);
+        if (nsent > 0) {
+            pollmgr_stats_add_out(pxtcp->pmhdl.shard, nsent);
+        }
 
         if (nsent == (ssize_t)fwd1) {
             /* successfully sent this chain fragment completely */
@@ -1925,6 +1932,7 @@ pxtcp_sock_read(struct pxtcp *pxtcp, int *pstop)
     nread = pxtcp_sock_recv(pxtcp, iov, iovlen);
 
     if (nread > 0) {
+        pollmgr_stats_add_in(pxtcp->pmhdl.shard, nread);
         wrnew = beg + nread;
         if (wrnew >= sz) {
             wrnew -= sz;
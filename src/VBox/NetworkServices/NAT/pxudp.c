@@ -192,7 +192,7 @@ pxudp_init(void)
 static ssize_t
 pxudp_chan_send(enum pollmgr_slot_t chan, struct pxudp *pxudp)
 {
-    return pollmgr_chan_send(chan, &pxudp, sizeof(pxudp));
+    return pollmgr_chan_send_to(pxudp->pmhdl.shard, chan, &pxudp, sizeof(pxudp));
 }
 
 
@@ -204,7 +204,7 @@ static ssize_t
 pxudp_chan_send_weak(enum pollmgr_slot_t chan, struct pxudp *pxudp)
 {
     pollmgr_refptr_weak_ref(pxudp->rp);
-    return pollmgr_chan_send(chan, &pxudp->rp, sizeof(pxudp->rp));
+    return pollmgr_chan_send_to(pxudp->pmhdl.shard, chan, &pxudp->rp, sizeof(pxudp->rp));
 }
 
 
@@ -310,6 +310,7 @@ pxudp_allocate(void)
     pxudp->pmhdl.callback = NULL;
     pxudp->pmhdl.data = (void *)pxudp;
     pxudp->pmhdl.slot = -1;
+    pxudp->pmhdl.shard = 0;
 
     pxudp->pcb = NULL;
     pxudp->sock = INVALID_SOCKET;
@@ -557,6 +558,9 @@ pxudp_pcb_accept(void *arg, struct udp_pcb *newpcb, struct pbuf *p,
     udp_recv(newpcb, pxudp_pcb_recv, pxudp);
 
     pxudp->pmhdl.callback = pxudp_pmgr_pump;
+    pxudp->pmhdl.shard = pollmgr_flow_shard_pcb(PCB_ISIPV6(newpcb),
+                                                &newpcb->local_ip, &newpcb->remote_ip,
+                                                newpcb->local_port, newpcb->remote_port);
     pxudp_chan_send(POLLMGR_CHAN_PXUDP_ADD, pxudp);
 
     /* dispatch directly instead of calling pxudp_pcb_recv() */
@@ -694,7 +698,9 @@ pxudp_pcb_forward_outbound(struct pxudp *pxudp, struct pbuf *p,
         ++pxudp->count;
     }
 
-    proxy_sendto(pxudp->sock, p, NULL, 0);
+    if (proxy_sendto(pxudp->sock, p, NULL, 0) == 0) {
+        pollmgr_stats_add_out(pxudp->pmhdl.shard, p->tot_len);
+    }
     pbuf_free(p);
 }
 
@@ -729,6 +735,7 @@ pxudp_pmgr_pump(struct pollmgr_handler *handler, SOCKET fd, int revents)
 {
     struct pxudp *pxudp;
     struct pbuf *p;
+    u8_t *udpbuf;
     ssize_t nread;
     err_t error;
 
@@ -769,10 +776,11 @@ pxudp_pmgr_pump(struct pollmgr_handler *handler, SOCKET fd, int revents)
         return POLLIN;
     }
 
+    udpbuf = pollmgr_thread_udpbuf();
 #ifdef RT_OS_WINDOWS
-    nread = recv(pxudp->sock, (char *)pollmgr_udpbuf, sizeof(pollmgr_udpbuf), 0);
+    nread = recv(pxudp->sock, (char *)udpbuf, sizeof(pollmgr_udpbuf), 0);
 #else
-    nread = recv(pxudp->sock, pollmgr_udpbuf, sizeof(pollmgr_udpbuf), 0);
+    nread = recv(pxudp->sock, udpbuf, sizeof(pollmgr_udpbuf), 0);
 #endif
     if (nread == SOCKET_ERROR) {
         DPRINTF(("%s: %R[sockerr]\n", __func__, SOCKERRNO()));
@@ -785,7 +793,9 @@ pxudp_pmgr_pump(struct pollmgr_handler *handler, SOCKET fd, int revents)
         return POLLIN;
     }
 
-    error = pbuf_take(p, pollmgr_udpbuf, (u16_t)nread);
+    pollmgr_stats_add_in(pxudp->pmhdl.shard, nread);
+
+    error = pbuf_take(p, udpbuf, (u16_t)nread);
     if (error != ERR_OK) {
         DPRINTF(("%s: pbuf_take(%d) failed\n", __func__, (int)nread));
         pbuf_free(p);
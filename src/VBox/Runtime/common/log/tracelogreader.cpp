@@ -1006,9 +1006,11 @@ static DECLCALLBACK(int) rtTraceLogRdrEvtMarkerRecvd(PRTTRACELOGRDRINT pThis, RT
                 pEvt->u64SeqNo    = pEvtStrm->u64SeqNo;
                 pEvt->u64Ts       = pEvtStrm->u64Ts;
                 pEvt->pEvtDesc    = pEvtDesc;
+                pEvt->idGrp       = pEvtStrm->u64EvtGrpId;
+                pEvt->idGrpParent = pEvtStrm->u64EvtParentGrpId;
                 pEvt->cbEvtData   = pEvtStrm->cbEvtData;
                 pEvt->pacbRawData = pEvtDesc->cRawDataNonStatic ? (size_t *)&pEvt->abEvtData[pEvtStrm->cbEvtData] : NULL;
-                /** @todo Group handling and parenting. */
+                /** @todo Group start/finish handling. */
 
                 size_t cbEvtDataRecv = pEvtStrm->cRawEvtDataSz * pThis->cbTypeSize + pEvtStrm->cbEvtData;
                 if (cbEvtDataRecv)
@@ -1113,7 +1115,13 @@ static DECLCALLBACK(int) rtTraceLogRdrFileStream(void *pvUser, void *pvBuf, size
 {
     RT_NOREF(cMsTimeout);
     RTFILE hFile = (RTFILE)pvUser;
-    return RTFileRead(hFile, pvBuf, cbBuf, pcbRead);
+    int rc = RTFileRead(hFile, pvBuf, cbBuf, pcbRead);
+    /* Signal the end of the file instead of polling forever for more data which can't come. */
+    if (   RT_SUCCESS(rc)
+        && cbBuf
+        && !*pcbRead)
+        rc = VERR_EOF;
+    return rc;
 }
 
 
@@ -1884,6 +1892,24 @@ RTDECL(bool) RTTraceLogRdrEvtIsGrouped(RTTRACELOGRDREVT hRdrEvt)
 }
 
 
+RTDECL(RTTRACELOGEVTGRPID) RTTraceLogRdrEvtGetGrpId(RTTRACELOGRDREVT hRdrEvt)
+{
+    PRTTRACELOGRDREVTINT pEvt = hRdrEvt;
+    AssertPtrReturn(pEvt, 0);
+
+    return pEvt->idGrp;
+}
+
+
+RTDECL(RTTRACELOGEVTGRPID) RTTraceLogRdrEvtGetParentGrpId(RTTRACELOGRDREVT hRdrEvt)
+{
+    PRTTRACELOGRDREVTINT pEvt = hRdrEvt;
+    AssertPtrReturn(pEvt, 0);
+
+    return pEvt->idGrpParent;
+}
+
+
 RTDECL(PCRTTRACELOGEVTDESC) RTTraceLogRdrEvtGetDesc(RTTRACELOGRDREVT hRdrEvt)
 {
     PRTTRACELOGRDREVTINT pEvt = hRdrEvt;
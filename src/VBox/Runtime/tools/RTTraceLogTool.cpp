@@ -42,7 +42,7 @@
 #include <iprt/tracelog-decoder-plugin.h>
 
 #include <iprt/assert.h>
-#include <iprt/errcore.h>
+#include <iprt/err.h>
 #include <iprt/file.h>
 #include <iprt/getopt.h>
 #include <iprt/initterm.h>
@@ -793,7 +793,7 @@ int main(int argc, char **argv)
                         RTMsgInfo("Invalid event received: %d\n", enmEvt);
                 }
             }
-            else
+            else if (rc != VERR_EOF) /* End of the trace log file. */
                 rcExit = RTMsgErrorExit(RTEXITCODE_FAILURE, "Polling for an event failed with %Rrc\n", rc);
         } while (RT_SUCCESS(rc));
 
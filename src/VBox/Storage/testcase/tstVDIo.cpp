@@ -1546,6 +1546,8 @@ static DECLCALLBACK(int) vdScriptHandlerIoLogReplay(PVDSCRIPTARG paScriptArgs, v
                         if (RT_SUCCESS(rc))
                         {
                             rc = RTTraceLogRdrEvtPoll(hIoLogRdr, &enmEvt, RT_INDEFINITE_WAIT);
+                            if (rc == VERR_EOF) /* The completion of the request is missing. */
+                                rc = VERR_TRACELOG_READER_MALFORMED_LOG;
                             if (RT_SUCCESS(rc))
                             {
                                 AssertMsg(enmEvt == RTTRACELOGRDRPOLLEVT_TRACE_EVENT_RECVD,
@@ -1570,6 +1572,10 @@ static DECLCALLBACK(int) vdScriptHandlerIoLogReplay(PVDSCRIPTARG paScriptArgs, v
 
                     rc = RTTraceLogRdrEvtPoll(hIoLogRdr, &enmEvt, RT_INDEFINITE_WAIT);
                 }
+
+                /* Reaching the end of the log between requests is the normal way out. */
+                if (rc == VERR_EOF)
+                    rc = VINF_SUCCESS;
             }
 
             RTTraceLogRdrDestroy(hIoLogRdr);
@@ -84,6 +84,19 @@ DECLINLINE(size_t) dbgfTracerGetRingBufSz(PDBGFTRACERINSCC pThisCC)
 }
 
 
+/**
+ * Checks whether the given event type passes the record time filter.
+ *
+ * @returns true if the event should be recorded, false if it is filtered out.
+ * @param   pThisCC                 The event tracer instance current context data.
+ * @param   enmTraceEvt             The trace event type to check.
+ */
+DECLINLINE(bool) dbgfTracerEvtIsEnabled(PDBGFTRACERINSCC pThisCC, DBGFTRACEREVT enmTraceEvt)
+{
+    return RT_BOOL(ASMAtomicUoReadU32(&pThisCC->CTX_SUFF(pShared)->fEvtsEnabled) & RT_BIT_32(enmTraceEvt));
+}
+
+
 /**
  * Posts a single event descriptor to the ring buffer of the given tracer instance - extended version.
  *
@@ -105,6 +118,15 @@ static int dbgfTracerEvtPostEx(PVMCC pVM, PDBGFTRACERINSCC pThisCC, DBGFTRACEREV
                  pVM, pThisCC, hEvtSrc, enmTraceEvt, idEvtPrev, pvEvtDesc, cbEvtDesc, pidEvt));
 
     PDBGFTRACERSHARED pSharedCC = pThisCC->CTX_SUFF(pShared);
+
+    /* Filtered events don't consume an event ID or ring buffer space. */
+    if (!dbgfTracerEvtIsEnabled(pThisCC, enmTraceEvt))
+    {
+        if (pidEvt)
+            *pidEvt = DBGF_TRACER_EVT_HDR_ID_INVALID;
+        return VINF_SUCCESS;
+    }
+
     size_t cRingBufEvts = dbgfTracerGetRingBufSz(pThisCC) / DBGF_TRACER_EVT_SZ;
     AssertReturn(cRingBufEvts, VERR_DBGF_TRACER_IPE_1);
     AssertReturn(cbEvtDesc <= DBGF_TRACER_EVT_PAYLOAD_SZ, VERR_DBGF_TRACER_IPE_1);
@@ -256,6 +278,10 @@ static void dbgfTracerEvtIoPortCopyVal(PDBGFTRACEREVTIOPORT pEvtIoPort, const vo
 static int dbgfTracerEvtGCPhys(PVMCC pVM, PDBGFTRACERINSCC pThisCC, DBGFTRACEREVT enmTraceEvt, DBGFTRACEREVTSRC hEvtSrc,
                                RTGCPHYS GCPhys, const void *pvBuf, size_t cbXfer)
 {
+    /* Don't bother splitting up the data if the event is filtered. */
+    if (!dbgfTracerEvtIsEnabled(pThisCC, enmTraceEvt))
+        return VINF_SUCCESS;
+
     /* Fast path for really small transfers where everything fits into the descriptor. */
     DBGFTRACEREVTGCPHYS EvtGCPhys;
     EvtGCPhys.GCPhys = GCPhys;
@@ -313,6 +339,10 @@ static int dbgfTracerEvtIoPortStr(PVMCC pVM, PDBGFTRACERINSCC pThisCC, DBGFTRACE
                                   uint64_t hIoPorts, RTIOPORT offPort, const void *pv, size_t cb, size_t cbItem, uint32_t cTransfersReq,
                                   uint32_t cTransfersRet)
 {
+    /* Don't bother splitting up the data if the event is filtered. */
+    if (!dbgfTracerEvtIsEnabled(pThisCC, enmTraceEvt))
+        return VINF_SUCCESS;
+
     /* Fast path for really small transfers where everything fits into the descriptor. */
     DBGFTRACEREVTIOPORTSTR EvtIoPortStr;
     EvtIoPortStr.hIoPorts      = hIoPorts;
@@ -671,6 +671,223 @@ DECL_FORCE_INLINE(void) iemTlbLoadedLargePage(PVMCPUCC pVCpu, IEMTLB *pTlb, RTGC
 #endif
 
 
+#if defined(IEMTLB_WITH_VICTIM_BUFFER) && (defined(IEM_WITH_CODE_TLB) || defined(IEM_WITH_DATA_TLB))
+AssertCompile(RT_IS_POWER_OF_TWO(IEMTLB_VICTIM_COUNT));
+AssertCompile(RT_IS_POWER_OF_TWO(IEMTLB_LARGE_PAGE_COUNT));
+
+/**
+ * Helper for moving a valid TLB entry that's about to be replaced by a TLB
+ * load into the victim buffer.
+ *
+ * @param   pTlb            The TLB.
+ * @param   pTlbe           The main TLB entry about to be replaced.
+ * @param   uTagNoRev       The tag (sans revision) of the replacement entry.
+ * @param   uTlbRevision    The current revision for the @a pTlbe slot, i.e.
+ *                          IEMTLB::uTlbRevision or IEMTLB::uTlbRevisionGlobal.
+ */
+DECL_FORCE_INLINE(void) iemTlbVictimSave(IEMTLB *pTlb, PCIEMTLBENTRY pTlbe, uint64_t uTagNoRev, uint64_t uTlbRevision)
+{
+    if (   (pTlbe->uTag & IEMTLB_REVISION_MASK) == uTlbRevision
+        && (pTlbe->uTag & ~IEMTLB_REVISION_MASK) != uTagNoRev)
+    {
+        pTlb->aVictims[pTlb->idxVictimNext++ % IEMTLB_VICTIM_COUNT] = *pTlbe;
+        pTlb->cTlbConflictEvictions++;
+    }
+}
+
+
+/**
+ * Helper for recording a large page at TLB load time.
+ *
+ * The physical address of each 4K page is derived from the base of the large
+ * page, so this is skipped when the walk went thru a second level (SLAT) page
+ * table or A20 masking applies, as the guest physical pages backing the large
+ * page needn't be contiguous then.
+ *
+ * @param   pVCpu           The cross context virtual CPU structure of the
+ *                          calling thread.
+ * @param   pTlb            The TLB.
+ * @param   pTlbe           The freshly loaded TLB entry (physical page info not
+ *                          yet resolved).
+ * @param   uTagNoRev       The tag (sans revision) of @a pTlbe.
+ * @param   fWalkInfo       The PGM_WALKINFO_XXX flags of the page walk.
+ * @param   f2MbLargePages  Set if 2 MB pages (PAE), clear if 4 MB pages.
+ */
+DECL_FORCE_INLINE(void) iemTlbLargePageSave(PVMCPUCC pVCpu, IEMTLB *pTlb, PCIEMTLBENTRY pTlbe, uint64_t uTagNoRev,
+                                            uint32_t fWalkInfo, bool f2MbLargePages)
+{
+    if (   !(fWalkInfo & PGM_WALKINFO_IS_SLAT)
+        && PGMPhysIsA20Enabled(pVCpu))
+    { /* likely */ }
+    else
+        return;
+
+    uint64_t const fTagOffMask = (f2MbLargePages ? _2M - 1U : _4M - 1U) >> GUEST_PAGE_SHIFT;
+    uint64_t const uTag        = (uTagNoRev & ~fTagOffMask) | (pTlbe->uTag & IEMTLB_REVISION_MASK);
+
+    /* Update an existing entry for the page (dirty bit change) or replace the oldest one. */
+    unsigned idx = 0;
+    while (idx < RT_ELEMENTS(pTlb->aLargePages) && pTlb->aLargePages[idx].uTag != uTag)
+        idx++;
+    if (idx >= RT_ELEMENTS(pTlb->aLargePages))
+        idx = pTlb->idxLargePageNext++ % IEMTLB_LARGE_PAGE_COUNT;
+
+    IEMTLBLARGEENTRY * const pLarge = &pTlb->aLargePages[idx];
+    pLarge->uTag        = uTag;
+    pLarge->fFlags      = pTlbe->fFlagsAndPhysRev & ~IEMTLBE_GCPHYS2PTR_MASK;
+    pLarge->GCPhys      = pTlbe->GCPhys - ((uTagNoRev & fTagOffMask) << GUEST_PAGE_SHIFT);
+    pLarge->fTagOffMask = fTagOffMask;
+}
+
+
+/**
+ * Looks for a main TLB miss in the victim buffer and large page entries.
+ *
+ * On success the entry is placed in the main TLB slot for the address (the one
+ * already there goes into the victim buffer), so that the inline TLB lookup
+ * code and the native recompiler will hit it directly on the next access.
+ *
+ * A large page hit only provides the page table part of the entry, the
+ * physical revision is left as zero so that the caller will resolve the
+ * physical page info as for any other stale TLB entry.
+ *
+ * @returns true if found (*ppTlbe updated), false if not (*ppTlbe unchanged).
+ * @param   pVCpu       The cross context virtual CPU structure of the calling
+ *                      thread.
+ * @param   pTlb        The TLB.
+ * @param   uTagNoRev   The tag (sans revision) of the address.
+ * @param   ppTlbe      Pointer to the TLB entry pointer.  This points to the
+ *                      odd (global) entry of the slot pair on input.
+ * @param   fTlbeAD     IEMTLBE_F_PT_NO_ACCESSED and IEMTLBE_F_PT_NO_DIRTY
+ *                      bits that must be clear for the entry to be usable.
+ */
+template<bool const a_fDataTlb>
+DECL_NO_INLINE(static, bool) iemTlbLookupSecondary(PVMCPUCC pVCpu, IEMTLB *pTlb, uint64_t uTagNoRev,
+                                                   PIEMTLBENTRY *ppTlbe, uint64_t fTlbeAD)
+{
+    PIEMTLBENTRY const pTlbeEven  = *ppTlbe - 1;
+    uint64_t const     uTag       = uTagNoRev | pTlb->uTlbRevision;
+    uint64_t const     uTagGlobal = uTagNoRev | pTlb->uTlbRevisionGlobal;
+    Assert(pTlbeEven == IEMTLB_TAG_TO_EVEN_ENTRY(pTlb, uTagNoRev));
+
+    /*
+     * The victim buffer.
+     */
+    for (unsigned i = 0; i < RT_ELEMENTS(pTlb->aVictims); i++)
+    {
+        PIEMTLBENTRY const pVictim = &pTlb->aVictims[i];
+        if (   (pVictim->uTag == uTag || pVictim->uTag == uTagGlobal)
+            && !(pVictim->fFlagsAndPhysRev & fTlbeAD))
+        {
+            bool const         fGlobal = pVictim->uTag != uTag;
+            PIEMTLBENTRY const pTlbe   = pTlbeEven + fGlobal;
+            IEMTLBENTRY const  Tmp     = *pTlbe;
+            *pTlbe   = *pVictim;
+            *pVictim = Tmp;
+# ifdef IEMTLB_WITH_LARGE_PAGE_BITMAP
+            if (pTlbe->fFlagsAndPhysRev & IEMTLBE_F_PT_LARGE_PAGE)
+                ASMBitSet(pTlb->bmLargePage, IEMTLB_TAG_TO_EVEN_INDEX(uTagNoRev) + fGlobal);
+            else
+                ASMBitClear(pTlb->bmLargePage, IEMTLB_TAG_TO_EVEN_INDEX(uTagNoRev) + fGlobal);
+# endif
+            pTlb->cTlbVictimHits++;
+            *ppTlbe = pTlbe;
+            return true;
+        }
+    }
+
+    /*
+     * The large pages.  For data accesses we must do the walk when there
+     * are data breakpoints around, see iemMemCheckDataBreakpoint.
+     */
+    if (!a_fDataTlb || !(pVCpu->iem.s.fExec & IEM_F_PENDING_BRK_DATA))
+        for (unsigned i = 0; i < RT_ELEMENTS(pTlb->aLargePages); i++)
+        {
+            IEMTLBLARGEENTRY const * const pLarge       = &pTlb->aLargePages[i];
+            uint64_t const                 uTagLarge    = uTagNoRev & ~pLarge->fTagOffMask;
+            bool const                     fLargeGlobal = pLarge->uTag == (uTagLarge | pTlb->uTlbRevisionGlobal);
+            if (   (fLargeGlobal || pLarge->uTag == (uTagLarge | pTlb->uTlbRevision))
+                && !(pLarge->fFlags & fTlbeAD))
+            {
+                /* Same slot selection as a regular load: PTE.G=1 entries only in ring-0. */
+                bool const         fGlobal = fLargeGlobal && IEM_GET_CPL(pVCpu) == 0;
+                PIEMTLBENTRY const pTlbe   = pTlbeEven + fGlobal;
+                bool const         f2Mb    = pLarge->fTagOffMask == (_2M - 1U) >> GUEST_PAGE_SHIFT;
+                if (fGlobal)
+                {
+                    iemTlbVictimSave(pTlb, pTlbe, uTagNoRev, pTlb->uTlbRevisionGlobal);
+                    pTlbe->uTag = uTagGlobal;
+                    iemTlbLoadedLargePage<true>(pVCpu, pTlb, uTagNoRev, f2Mb);
+                }
+                else
+                {
+                    iemTlbVictimSave(pTlb, pTlbe, uTagNoRev, pTlb->uTlbRevision);
+                    pTlbe->uTag = uTag;
+                    iemTlbLoadedLargePage<false>(pVCpu, pTlb, uTagNoRev, f2Mb);
+                }
+                pTlbe->fFlagsAndPhysRev = pLarge->fFlags;
+                pTlbe->GCPhys           = pLarge->GCPhys + ((uTagNoRev & pLarge->fTagOffMask) << GUEST_PAGE_SHIFT);
+                pTlbe->pbMappingR3      = NULL;
+                Assert(!(pTlbe->fFlagsAndPhysRev & IEMTLBE_F_PHYS_REV));
+                pTlb->cTlbLargePageHits++;
+                *ppTlbe = pTlbe;
+                return true;
+            }
+        }
+
+    return false;
+}
+
+
+/**
+ * Invalidates the victim buffer and large page entries affected by an INVLPG.
+ */
+template<bool const a_fDataTlb>
+DECLINLINE(void) iemTlbInvalidatePageSecondary(PVMCPUCC pVCpu, IEMTLB *pTlb, RTGCPTR GCPtrTag) RT_NOEXCEPT
+{
+    RTGCPTR const fLargeOffMask = ((pVCpu->cpum.GstCtx.cr4 & X86_CR4_PAE) ? _2M - 1U : _4M - 1U) >> GUEST_PAGE_SHIFT;
+    for (unsigned i = 0; i < RT_ELEMENTS(pTlb->aVictims); i++)
+    {
+        uint64_t const uTagRev = pTlb->aVictims[i].uTag & IEMTLB_REVISION_MASK;
+        if (uTagRev == pTlb->uTlbRevision || uTagRev == pTlb->uTlbRevisionGlobal)
+        {
+            RTGCPTR const uTagNoRev = pTlb->aVictims[i].uTag & ~IEMTLB_REVISION_MASK;
+            if (   uTagNoRev == GCPtrTag
+                || (   (pTlb->aVictims[i].fFlagsAndPhysRev & IEMTLBE_F_PT_LARGE_PAGE)
+                    && (uTagNoRev & ~fLargeOffMask) == (GCPtrTag & ~fLargeOffMask)))
+            {
+                pTlb->aVictims[i].uTag = 0;
+                if (!a_fDataTlb && uTagNoRev == IEMTLB_CALC_TAG_NO_REV(pVCpu->iem.s.uInstrBufPc))
+                    pVCpu->iem.s.cbInstrBufTotal = 0;
+            }
+        }
+    }
+
+    for (unsigned i = 0; i < RT_ELEMENTS(pTlb->aLargePages); i++)
+        if (   (pTlb->aLargePages[i].uTag & ~IEMTLB_REVISION_MASK)
+            == (GCPtrTag & ~pTlb->aLargePages[i].fTagOffMask))
+            pTlb->aLargePages[i].uTag = 0;
+}
+#endif /* IEMTLB_WITH_VICTIM_BUFFER && (IEM_WITH_CODE_TLB || IEM_WITH_DATA_TLB) */
+
+
+#if defined(IEMTLB_WITH_VICTIM_BUFFER) && (defined(IEM_WITH_CODE_TLB) || defined(IEM_WITH_DATA_TLB))
+/**
+ * Worker for iemTlbInvalidateOne that wipes the victim buffer and large page
+ * entries when one of the TLB revisions rolls over.
+ *
+ * The entries of both revisions are mixed here, so we just drop them all.
+ */
+static void iemTlbInvalidateSecondaryOnRollover(IEMTLB *pTlb)
+{
+    for (unsigned i = 0; i < RT_ELEMENTS(pTlb->aVictims); i++)
+        pTlb->aVictims[i].uTag = 0;
+    for (unsigned i = 0; i < RT_ELEMENTS(pTlb->aLargePages); i++)
+        pTlb->aLargePages[i].uTag = 0;
+}
+#endif
+
+
 #if defined(IEM_WITH_CODE_TLB) || defined(IEM_WITH_DATA_TLB)
 /**
  * Worker for iemTlbInvalidateAll.
@@ -693,6 +910,9 @@ DECL_FORCE_INLINE(void) iemTlbInvalidateOne(IEMTLB *pTlb)
         unsigned i = RT_ELEMENTS(pTlb->aEntries) / 2;
         while (i-- > 0)
             pTlb->aEntries[i * 2].uTag = 0;
+# ifdef IEMTLB_WITH_VICTIM_BUFFER
+        iemTlbInvalidateSecondaryOnRollover(pTlb);
+# endif
     }
 
     pTlb->cTlbNonGlobalLargePageCurLoads    = 0;
@@ -711,6 +931,9 @@ DECL_FORCE_INLINE(void) iemTlbInvalidateOne(IEMTLB *pTlb)
             unsigned i = RT_ELEMENTS(pTlb->aEntries) / 2;
             while (i-- > 0)
                 pTlb->aEntries[i * 2 + 1].uTag = 0;
+# ifdef IEMTLB_WITH_VICTIM_BUFFER
+            iemTlbInvalidateSecondaryOnRollover(pTlb);
+# endif
         }
 
         pTlb->cTlbGlobalLargePageCurLoads    = 0;
@@ -1164,6 +1387,10 @@ DECLINLINE(void) iemTlbInvalidatePageWorker(PVMCPUCC pVCpu, IEMTLB *pTlb, RTGCPT
         else
             iemTlbInvalidateLargePageWorker<a_fDataTlb, false>(pVCpu, pTlb, GCPtrTag, GCPtrInstrBufPcTag);
     }
+
+# ifdef IEMTLB_WITH_VICTIM_BUFFER
+    iemTlbInvalidatePageSecondary<a_fDataTlb>(pVCpu, pTlb, GCPtrTag);
+# endif
 }
 
 #endif /* defined(IEM_WITH_CODE_TLB) || defined(IEM_WITH_DATA_TLB) */
@@ -1222,6 +1449,15 @@ static void IEMTlbInvalidateAllPhysicalSlow(PVMCPUCC pVCpu)
         pVCpu->iem.s.CodeTlb.aEntries[i].fFlagsAndPhysRev &= ~(  IEMTLBE_F_PG_NO_WRITE   | IEMTLBE_F_PG_NO_READ
                                                                | IEMTLBE_F_PG_UNASSIGNED | IEMTLBE_F_PHYS_REV);
     }
+#  ifdef IEMTLB_WITH_VICTIM_BUFFER
+    i = RT_ELEMENTS(pVCpu->iem.s.CodeTlb.aVictims);
+    while (i-- > 0)
+    {
+        pVCpu->iem.s.CodeTlb.aVictims[i].pbMappingR3       = NULL;
+        pVCpu->iem.s.CodeTlb.aVictims[i].fFlagsAndPhysRev &= ~(  IEMTLBE_F_PG_NO_WRITE   | IEMTLBE_F_PG_NO_READ
+                                                               | IEMTLBE_F_PG_UNASSIGNED | IEMTLBE_F_PHYS_REV);
+    }
+#  endif
     pVCpu->iem.s.CodeTlb.cTlbPhysRevRollovers++;
     pVCpu->iem.s.CodeTlb.cTlbPhysRevFlushes++;
 # endif
@@ -1233,6 +1469,15 @@ static void IEMTlbInvalidateAllPhysicalSlow(PVMCPUCC pVCpu)
         pVCpu->iem.s.DataTlb.aEntries[i].fFlagsAndPhysRev &= ~(  IEMTLBE_F_PG_NO_WRITE   | IEMTLBE_F_PG_NO_READ
                                                                | IEMTLBE_F_PG_UNASSIGNED | IEMTLBE_F_PHYS_REV);
     }
+#  ifdef IEMTLB_WITH_VICTIM_BUFFER
+    i = RT_ELEMENTS(pVCpu->iem.s.DataTlb.aVictims);
+    while (i-- > 0)
+    {
+        pVCpu->iem.s.DataTlb.aVictims[i].pbMappingR3       = NULL;
+        pVCpu->iem.s.DataTlb.aVictims[i].fFlagsAndPhysRev &= ~(  IEMTLBE_F_PG_NO_WRITE   | IEMTLBE_F_PG_NO_READ
+                                                               | IEMTLBE_F_PG_UNASSIGNED | IEMTLBE_F_PHYS_REV);
+    }
+#  endif
     pVCpu->iem.s.DataTlb.cTlbPhysRevRollovers++;
     pVCpu->iem.s.DataTlb.cTlbPhysRevFlushes++;
 # endif
@@ -1455,7 +1700,11 @@ void iemOpcodeFetchBytesJmp(PVMCPUCC pVCpu, size_t cbDst, void *pvDst) IEM_NOEXC
         uint64_t const uTagNoRev = IEMTLB_CALC_TAG_NO_REV(GCPtrFirst);
         PIEMTLBENTRY   pTlbe     = IEMTLB_TAG_TO_EVEN_ENTRY(&pVCpu->iem.s.CodeTlb, uTagNoRev);
         if (   pTlbe->uTag               == (uTagNoRev | pVCpu->iem.s.CodeTlb.uTlbRevision)
-            || (pTlbe = pTlbe + 1)->uTag == (uTagNoRev | pVCpu->iem.s.CodeTlb.uTlbRevisionGlobal))
+            || (pTlbe = pTlbe + 1)->uTag == (uTagNoRev | pVCpu->iem.s.CodeTlb.uTlbRevisionGlobal)
+#  ifdef IEMTLB_WITH_VICTIM_BUFFER
+            || iemTlbLookupSecondary<false>(pVCpu, &pVCpu->iem.s.CodeTlb, uTagNoRev, &pTlbe, IEMTLBE_F_PT_NO_ACCESSED)
+#  endif
+           )
         {
             /* likely when executing lots of code, otherwise unlikely */
 #  ifdef IEM_WITH_TLB_STATISTICS
@@ -1521,6 +1770,9 @@ void iemOpcodeFetchBytesJmp(PVMCPUCC pVCpu, size_t cbDst, void *pvDst) IEM_NOEXC
                 || IEM_GET_CPL(pVCpu) != 0) /* optimization: Only use the PTE.G=1 entries in ring-0. */
             {
                 pTlbe--;
+#  ifdef IEMTLB_WITH_VICTIM_BUFFER
+                iemTlbVictimSave(&pVCpu->iem.s.CodeTlb, pTlbe, uTagNoRev, pVCpu->iem.s.CodeTlb.uTlbRevision);
+#  endif
                 pTlbe->uTag         = uTagNoRev | pVCpu->iem.s.CodeTlb.uTlbRevision;
                 if (WalkFast.fInfo & PGM_WALKINFO_BIG_PAGE)
                     iemTlbLoadedLargePage<false>(pVCpu, &pVCpu->iem.s.CodeTlb, uTagNoRev, RT_BOOL(pVCpu->cpum.GstCtx.cr4 & X86_CR4_PAE));
@@ -1532,6 +1784,9 @@ void iemOpcodeFetchBytesJmp(PVMCPUCC pVCpu, size_t cbDst, void *pvDst) IEM_NOEXC
             else
             {
                 pVCpu->iem.s.CodeTlb.cTlbCoreGlobalLoads++;
+#  ifdef IEMTLB_WITH_VICTIM_BUFFER
+                iemTlbVictimSave(&pVCpu->iem.s.CodeTlb, pTlbe, uTagNoRev, pVCpu->iem.s.CodeTlb.uTlbRevisionGlobal);
+#  endif
                 pTlbe->uTag         = uTagNoRev | pVCpu->iem.s.CodeTlb.uTlbRevisionGlobal;
                 if (WalkFast.fInfo & PGM_WALKINFO_BIG_PAGE)
                     iemTlbLoadedLargePage<true>(pVCpu, &pVCpu->iem.s.CodeTlb, uTagNoRev, RT_BOOL(pVCpu->cpum.GstCtx.cr4 & X86_CR4_PAE));
@@ -1546,6 +1801,11 @@ void iemOpcodeFetchBytesJmp(PVMCPUCC pVCpu, size_t cbDst, void *pvDst) IEM_NOEXC
             RTGCPHYS const GCPhysPg = WalkFast.GCPhys & ~(RTGCPHYS)GUEST_PAGE_OFFSET_MASK;
             pTlbe->GCPhys           = GCPhysPg;
             pTlbe->pbMappingR3      = NULL;
+#  ifdef IEMTLB_WITH_VICTIM_BUFFER
+            if (WalkFast.fInfo & PGM_WALKINFO_BIG_PAGE)
+                iemTlbLargePageSave(pVCpu, &pVCpu->iem.s.CodeTlb, pTlbe, uTagNoRev, WalkFast.fInfo,
+                                    RT_BOOL(pVCpu->cpum.GstCtx.cr4 & X86_CR4_PAE));
+#  endif
             Assert(!(pTlbe->fFlagsAndPhysRev & IEMTLBE_F_PT_NO_EXEC) || !(pVCpu->cpum.GstCtx.msrEFER & MSR_K6_EFER_NXE));
             Assert(!(pTlbe->fFlagsAndPhysRev & IEMTLBE_F_PT_NO_USER) || IEM_GET_CPL(pVCpu) != 3);
             Assert(!(pTlbe->fFlagsAndPhysRev & IEMTLBE_F_PT_NO_ACCESSED));
@@ -6995,7 +7255,11 @@ VBOXSTRICTRC iemMemMap(PVMCPUCC pVCpu, void **ppvMem, uint8_t *pbUnmapInfo, size
     if (   (   pTlbe->uTag               == (uTagNoRev | pVCpu->iem.s.DataTlb.uTlbRevision)
             && !(pTlbe->fFlagsAndPhysRev & fTlbeAD) )
         || (   (pTlbe = pTlbe + 1)->uTag == (uTagNoRev | pVCpu->iem.s.DataTlb.uTlbRevisionGlobal)
-            && !(pTlbe->fFlagsAndPhysRev & fTlbeAD) ) )
+            && !(pTlbe->fFlagsAndPhysRev & fTlbeAD) )
+# ifdef IEMTLB_WITH_VICTIM_BUFFER
+        || iemTlbLookupSecondary<true>(pVCpu, &pVCpu->iem.s.DataTlb, uTagNoRev, &pTlbe, fTlbeAD)
+# endif
+       )
     {
 # ifdef IEM_WITH_TLB_STATISTICS
         pVCpu->iem.s.DataTlb.cTlbCoreHits++;
@@ -7086,6 +7350,9 @@ VBOXSTRICTRC iemMemMap(PVMCPUCC pVCpu, void **ppvMem, uint8_t *pbUnmapInfo, size
                 || IEM_GET_CPL(pVCpu) != 0) /* optimization: Only use the PTE.G=1 entries in ring-0. */
             {
                 pTlbe--;
+# ifdef IEMTLB_WITH_VICTIM_BUFFER
+                iemTlbVictimSave(&pVCpu->iem.s.DataTlb, pTlbe, uTagNoRev, pVCpu->iem.s.DataTlb.uTlbRevision);
+# endif
                 pTlbe->uTag         = uTagNoRev | pVCpu->iem.s.DataTlb.uTlbRevision;
                 if (WalkFast.fInfo & PGM_WALKINFO_BIG_PAGE)
                     iemTlbLoadedLargePage<false>(pVCpu, &pVCpu->iem.s.DataTlb, uTagNoRev, RT_BOOL(pVCpu->cpum.GstCtx.cr4 & X86_CR4_PAE));
@@ -7097,6 +7364,9 @@ VBOXSTRICTRC iemMemMap(PVMCPUCC pVCpu, void **ppvMem, uint8_t *pbUnmapInfo, size
             else
             {
                 pVCpu->iem.s.DataTlb.cTlbCoreGlobalLoads++;
+# ifdef IEMTLB_WITH_VICTIM_BUFFER
+                iemTlbVictimSave(&pVCpu->iem.s.DataTlb, pTlbe, uTagNoRev, pVCpu->iem.s.DataTlb.uTlbRevisionGlobal);
+# endif
                 pTlbe->uTag         = uTagNoRev | pVCpu->iem.s.DataTlb.uTlbRevisionGlobal;
                 if (WalkFast.fInfo & PGM_WALKINFO_BIG_PAGE)
                     iemTlbLoadedLargePage<true>(pVCpu, &pVCpu->iem.s.DataTlb, uTagNoRev, RT_BOOL(pVCpu->cpum.GstCtx.cr4 & X86_CR4_PAE));
@@ -7122,6 +7392,11 @@ VBOXSTRICTRC iemMemMap(PVMCPUCC pVCpu, void **ppvMem, uint8_t *pbUnmapInfo, size
         RTGCPHYS const GCPhysPg = WalkFast.GCPhys & ~(RTGCPHYS)GUEST_PAGE_OFFSET_MASK;
         pTlbe->GCPhys           = GCPhysPg;
         pTlbe->pbMappingR3      = NULL;
+# ifdef IEMTLB_WITH_VICTIM_BUFFER
+        if ((WalkFast.fInfo & PGM_WALKINFO_BIG_PAGE) && pTlbe != &pVCpu->iem.s.DataBreakpointTlbe)
+            iemTlbLargePageSave(pVCpu, &pVCpu->iem.s.DataTlb, pTlbe, uTagNoRev, WalkFast.fInfo,
+                                RT_BOOL(pVCpu->cpum.GstCtx.cr4 & X86_CR4_PAE));
+# endif
         Assert(!(pTlbe->fFlagsAndPhysRev & IEMTLBE_F_PT_NO_ACCESSED));
         Assert(!(pTlbe->fFlagsAndPhysRev & IEMTLBE_F_PT_NO_DIRTY) || !(fAccess & IEM_ACCESS_TYPE_WRITE));
         Assert(   !(pTlbe->fFlagsAndPhysRev & IEMTLBE_F_PT_NO_WRITE)
@@ -7450,7 +7725,11 @@ static void *iemMemMapJmp(PVMCPUCC pVCpu, uint8_t *pbUnmapInfo, size_t cbMem, ui
     if (   (   pTlbe->uTag               == (uTagNoRev | pVCpu->iem.s.DataTlb.uTlbRevision)
             && !(pTlbe->fFlagsAndPhysRev & fTlbeAD) )
         || (   (pTlbe = pTlbe + 1)->uTag == (uTagNoRev | pVCpu->iem.s.DataTlb.uTlbRevisionGlobal)
-            && !(pTlbe->fFlagsAndPhysRev & fTlbeAD) ) )
+            && !(pTlbe->fFlagsAndPhysRev & fTlbeAD) )
+# ifdef IEMTLB_WITH_VICTIM_BUFFER
+        || iemTlbLookupSecondary<true>(pVCpu, &pVCpu->iem.s.DataTlb, uTagNoRev, &pTlbe, fTlbeAD)
+# endif
+       )
     {
 # ifdef IEM_WITH_TLB_STATISTICS
         if (a_fSafeCall)
@@ -7500,6 +7779,9 @@ static void *iemMemMapJmp(PVMCPUCC pVCpu, uint8_t *pbUnmapInfo, size_t cbMem, ui
                 || IEM_GET_CPL(pVCpu) != 0) /* optimization: Only use the PTE.G=1 entries in ring-0. */
             {
                 pTlbe--;
+# ifdef IEMTLB_WITH_VICTIM_BUFFER
+                iemTlbVictimSave(&pVCpu->iem.s.DataTlb, pTlbe, uTagNoRev, pVCpu->iem.s.DataTlb.uTlbRevision);
+# endif
                 pTlbe->uTag         = uTagNoRev | pVCpu->iem.s.DataTlb.uTlbRevision;
                 if (WalkFast.fInfo & PGM_WALKINFO_BIG_PAGE)
                     iemTlbLoadedLargePage<false>(pVCpu, &pVCpu->iem.s.DataTlb, uTagNoRev, RT_BOOL(pVCpu->cpum.GstCtx.cr4 & X86_CR4_PAE));
@@ -7514,6 +7796,9 @@ static void *iemMemMapJmp(PVMCPUCC pVCpu, uint8_t *pbUnmapInfo, size_t cbMem, ui
                     pVCpu->iem.s.DataTlb.cTlbSafeGlobalLoads++;
                 else
                     pVCpu->iem.s.DataTlb.cTlbCoreGlobalLoads++;
+# ifdef IEMTLB_WITH_VICTIM_BUFFER
+                iemTlbVictimSave(&pVCpu->iem.s.DataTlb, pTlbe, uTagNoRev, pVCpu->iem.s.DataTlb.uTlbRevisionGlobal);
+# endif
                 pTlbe->uTag         = uTagNoRev | pVCpu->iem.s.DataTlb.uTlbRevisionGlobal;
                 if (WalkFast.fInfo & PGM_WALKINFO_BIG_PAGE)
                     iemTlbLoadedLargePage<true>(pVCpu, &pVCpu->iem.s.DataTlb, uTagNoRev, RT_BOOL(pVCpu->cpum.GstCtx.cr4 & X86_CR4_PAE));
@@ -7539,6 +7824,11 @@ static void *iemMemMapJmp(PVMCPUCC pVCpu, uint8_t *pbUnmapInfo, size_t cbMem, ui
         RTGCPHYS const GCPhysPg = WalkFast.GCPhys & ~(RTGCPHYS)GUEST_PAGE_OFFSET_MASK;
         pTlbe->GCPhys           = GCPhysPg;
         pTlbe->pbMappingR3      = NULL;
+# ifdef IEMTLB_WITH_VICTIM_BUFFER
+        if ((WalkFast.fInfo & PGM_WALKINFO_BIG_PAGE) && pTlbe != &pVCpu->iem.s.DataBreakpointTlbe)
+            iemTlbLargePageSave(pVCpu, &pVCpu->iem.s.DataTlb, pTlbe, uTagNoRev, WalkFast.fInfo,
+                                RT_BOOL(pVCpu->cpum.GstCtx.cr4 & X86_CR4_PAE));
+# endif
         Assert(!(pTlbe->fFlagsAndPhysRev & ((fNoWriteNoDirty & IEMTLBE_F_PT_NO_DIRTY) | IEMTLBE_F_PT_NO_ACCESSED)));
         Assert(   !(pTlbe->fFlagsAndPhysRev & fNoWriteNoDirty & IEMTLBE_F_PT_NO_WRITE)
                || (fQPage & (PGMQPAGE_F_CR0_WP0 | PGMQPAGE_F_USER_MODE)) == PGMQPAGE_F_CR0_WP0);
@@ -59,6 +59,19 @@ RT_C_DECLS_END
 # undef IEM_WITHOUT_ASSEMBLY
 #endif
 
+/** @def IEM_WITH_X87_HOST_DOUBLE
+ * Use host double precision arithmetic for x87 FADD, FSUB, FMUL and FDIV
+ * when the guest runs with 53-bit precision, round to nearest and all
+ * exceptions masked.  This is limited to ring-3 on AMD64 where double
+ * arithmetic is done by SSE2 without implicit FMA contraction. */
+#if !defined(IEM_WITH_X87_HOST_DOUBLE) && !defined(IEM_WITHOUT_X87_HOST_DOUBLE) \
+ && defined(IN_RING3) && defined(RT_ARCH_AMD64)
+# define IEM_WITH_X87_HOST_DOUBLE
+#endif
+#if defined(IEM_WITH_X87_HOST_DOUBLE) && !RT_INLINE_ASM_GNU_STYLE
+# include <xmmintrin.h> /* _mm_getcsr, _mm_setcsr */
+#endif
+
 /**
  * Calculates the signed flag value given a result and it's bit width.
  *
@@ -5907,6 +5920,262 @@ IEM_DECL_IMPL_DEF(void, a_Name,(PCX86FXSTATE pFpuState, PIEMFPURESULT pFpuRes, P
 
 
 
+#ifdef IEM_WITH_X87_HOST_DOUBLE
+
+/*********************************************************************************************************************************
+*   x87 FPU Host Double Fast Path                                                                                                *
+*********************************************************************************************************************************/
+
+/** Operations for iemFpuHostDoubleBinaryOp. */
+typedef enum IEMFPUHOSTDBLOP
+{
+    kIemFpuHostDblOp_Add = 0,
+    kIemFpuHostDblOp_Sub,
+    kIemFpuHostDblOp_Mul,
+    kIemFpuHostDblOp_Div
+} IEMFPUHOSTDBLOP;
+
+/** The largest unbiased operand exponent taken by the fast path.  This keeps
+ * all intermediate values, including the error terms, well within the normal
+ * double range so neither overflow nor underflow can occur. */
+# define IEM_FPU_HOST_DBL_MAX_EXP       448
+
+
+/** The host MXCSR value the fast path operates with: round to nearest, no
+ * denormal flushing, all exceptions masked. */
+# define IEM_FPU_HOST_DBL_MXCSR         X86_MXCSR_XCPT_MASK
+
+
+/**
+ * Reads the host MXCSR.
+ */
+DECL_FORCE_INLINE(uint32_t) iemFpuHostDoubleGetMxcsr(void)
+{
+# if RT_INLINE_ASM_GNU_STYLE
+    uint32_t fMxcsr;
+    __asm__ __volatile__("stmxcsr %0" : "=m" (fMxcsr) : : "memory");
+    return fMxcsr;
+# else
+    return _mm_getcsr();
+# endif
+}
+
+
+/**
+ * Loads the host MXCSR.
+ */
+DECL_FORCE_INLINE(void) iemFpuHostDoubleSetMxcsr(uint32_t fMxcsr)
+{
+# if RT_INLINE_ASM_GNU_STYLE
+    __asm__ __volatile__("ldmxcsr %0" : : "m" (fMxcsr) : "memory");
+# else
+    _mm_setcsr(fMxcsr);
+# endif
+}
+
+
+/**
+ * Converts an 80-bit value to a host double if it is zero or a normal value
+ * that can be represented exactly and is within the fast path range.
+ *
+ * @returns true if converted, false if not suitable.
+ * @param   pr80Val     The value to convert.
+ * @param   prdDst      Where to return the host double.
+ */
+DECL_FORCE_INLINE(bool) iemFpuHostDoubleFromR80(PCRTFLOAT80U pr80Val, double *prdDst)
+{
+    RTFLOAT64U r64;
+    if (RTFLOAT80U_IS_ZERO(pr80Val))
+        r64.u = (uint64_t)pr80Val->s.fSign << 63;
+    else
+    {
+        int32_t const iExp = (int32_t)pr80Val->s.uExponent - RTFLOAT80U_EXP_BIAS;
+        if (   !(pr80Val->s.uMantissa & RT_BIT_64(63))
+            || (pr80Val->s.uMantissa & (RT_BIT_64(RTFLOAT80U_FRACTION_BITS - RTFLOAT64U_FRACTION_BITS) - 1))
+            || iExp >  IEM_FPU_HOST_DBL_MAX_EXP
+            || iExp < -IEM_FPU_HOST_DBL_MAX_EXP)
+            return false;
+        r64.s64.fSign     = pr80Val->s.fSign;
+        r64.s64.uExponent = (uint64_t)(iExp + RTFLOAT64U_EXP_BIAS);
+        r64.s64.uFraction = (pr80Val->s.uMantissa & ~RT_BIT_64(63)) >> (RTFLOAT80U_FRACTION_BITS - RTFLOAT64U_FRACTION_BITS);
+    }
+    *prdDst = r64.rd;
+    return true;
+}
+
+
+/**
+ * Converts a host double produced by iemFpuHostDoubleBinaryOp back to 80-bit.
+ */
+DECL_FORCE_INLINE(void) iemFpuHostDoubleToR80(double rdSrc, PRTFLOAT80U pr80Dst)
+{
+    RTFLOAT64U r64;
+    r64.rd = rdSrc;
+    pr80Dst->s.fSign = r64.s64.fSign;
+    if (r64.s64.uExponent == 0)
+    {
+        Assert(r64.s64.uFraction == 0);
+        pr80Dst->s.uExponent = 0;
+        pr80Dst->s.uMantissa = 0;
+    }
+    else
+    {
+        Assert(r64.s64.uExponent != RTFLOAT64U_EXP_MAX);
+        pr80Dst->s.uExponent = (uint16_t)(r64.s64.uExponent - RTFLOAT64U_EXP_BIAS + RTFLOAT80U_EXP_BIAS);
+        pr80Dst->s.uMantissa = RT_BIT_64(63)
+                             | (r64.s64.uFraction << (RTFLOAT80U_FRACTION_BITS - RTFLOAT64U_FRACTION_BITS));
+    }
+}
+
+
+/**
+ * Returns the rounding error of @a rdSum = @a rd1 + @a rd2 (Knuth's TwoSum).
+ *
+ * The result is exact as long as nothing overflows.
+ */
+DECL_FORCE_INLINE(double) iemFpuHostDoubleAddErr(double rd1, double rd2, double rdSum)
+{
+    double const rd2Virtual = rdSum - rd1;
+    double const rd1Virtual = rdSum - rd2Virtual;
+    return (rd1 - rd1Virtual) + (rd2 - rd2Virtual);
+}
+
+
+/**
+ * Returns the rounding error of @a rdProd = @a rd1 * @a rd2 (Dekker's
+ * TwoProduct with Veltkamp splitting, no FMA required).
+ *
+ * The result is exact as long as nothing overflows or underflows, which the
+ * IEM_FPU_HOST_DBL_MAX_EXP operand limit takes care of.
+ */
+DECL_FORCE_INLINE(double) iemFpuHostDoubleMulErr(double rd1, double rd2, double rdProd)
+{
+    double const rdSplitter = 134217729.0; /* 2^27 + 1 */
+    double const rdTmp1     = rdSplitter * rd1;
+    double const rd1Hi      = rdTmp1 - (rdTmp1 - rd1);
+    double const rd1Lo      = rd1 - rd1Hi;
+    double const rdTmp2     = rdSplitter * rd2;
+    double const rd2Hi      = rdTmp2 - (rdTmp2 - rd2);
+    double const rd2Lo      = rd2 - rd2Hi;
+    return ((rd1Hi * rd2Hi - rdProd) + rd1Hi * rd2Lo + rd1Lo * rd2Hi) + rd1Lo * rd2Lo;
+}
+
+
+/**
+ * Tries to perform an x87 binary operation using host double arithmetic.
+ *
+ * With 53-bit precision control and round to nearest the x87 produces the
+ * same result as IEEE double arithmetic, provided the operands are exactly
+ * representable as doubles and the result neither overflows nor becomes
+ * denormal in the double format.  The exact rounding error is calculated to
+ * set PE and C1 the way the FPU does.  Only taken when all exceptions are
+ * masked, so a PE never needs raising.
+ *
+ * The host MXCSR cannot be assumed to hold the default value, as native TBs
+ * load the guest's MXCSR while using SSE/AVX.  So it is switched to
+ * IEM_FPU_HOST_DBL_MXCSR for the operation when different, and restored
+ * afterwards if that or the operation changed it.  The operands and results
+ * go thru volatile variables to keep the compiler from moving the arithmetic
+ * across the MXCSR accesses.
+ *
+ * @returns true if the operation was carried out, false if SoftFloat should
+ *          be used instead.
+ * @param   enmOp       The operation.
+ * @param   pr80Val1    The first operand.
+ * @param   pr80Val2    The second operand.
+ * @param   pr80Result  Where to return the result.
+ * @param   fFcw        The FPU control word.
+ * @param   pfFsw       The FPU status word to update.
+ */
+DECL_FORCE_INLINE(bool) iemFpuHostDoubleBinaryOp(IEMFPUHOSTDBLOP enmOp, PCRTFLOAT80U pr80Val1, PCRTFLOAT80U pr80Val2,
+                                                 PRTFLOAT80U pr80Result, uint16_t fFcw, uint16_t *pfFsw)
+{
+    if (   (fFcw & (X86_FCW_PC_MASK | X86_FCW_RC_MASK | X86_FCW_XCPT_MASK))
+        != (X86_FCW_PC_53 | X86_FCW_RC_NEAREST | X86_FCW_XCPT_MASK))
+        return false;
+    AssertReturn((unsigned)enmOp <= (unsigned)kIemFpuHostDblOp_Div, false);
+
+    double volatile rd1Vol, rd2Vol;
+    {
+        double rd1Tmp, rd2Tmp;
+        if (   !iemFpuHostDoubleFromR80(pr80Val1, &rd1Tmp)
+            || !iemFpuHostDoubleFromR80(pr80Val2, &rd2Tmp))
+            return false;
+        if (enmOp == kIemFpuHostDblOp_Div && rd2Tmp == 0.0)
+            return false;
+        rd1Vol = rd1Tmp;
+        rd2Vol = rd2Tmp;
+    }
+
+    uint32_t const fMxcsrSaved = iemFpuHostDoubleGetMxcsr();
+    uint32_t const fMxcsrOp    = (fMxcsrSaved & ~(X86_MXCSR_RC_MASK | X86_MXCSR_FZ | X86_MXCSR_DAZ)) | IEM_FPU_HOST_DBL_MXCSR;
+    if (fMxcsrOp != fMxcsrSaved)
+        iemFpuHostDoubleSetMxcsr(fMxcsrOp);
+    double const rd1 = rd1Vol;
+    double const rd2 = rd2Vol;
+
+    /* rdErr gets the sign of (exact result - rdResult), or zero if exact. */
+    double volatile rdResultVol;
+    double volatile rdErrVol;
+    switch (enmOp)
+    {
+        case kIemFpuHostDblOp_Add:
+        {
+            double const rdResult = rd1 + rd2;
+            rdResultVol = rdResult;
+            rdErrVol    = iemFpuHostDoubleAddErr(rd1, rd2, rdResult);
+            break;
+        }
+        case kIemFpuHostDblOp_Sub:
+        {
+            double const rdResult = rd1 - rd2;
+            rdResultVol = rdResult;
+            rdErrVol    = iemFpuHostDoubleAddErr(rd1, -rd2, rdResult);
+            break;
+        }
+        case kIemFpuHostDblOp_Mul:
+        {
+            double const rdResult = rd1 * rd2;
+            rdResultVol = rdResult;
+            rdErrVol    = iemFpuHostDoubleMulErr(rd1, rd2, rdResult);
+            break;
+        }
+        case kIemFpuHostDblOp_Div:
+        {
+            double const rdResult = rd1 / rd2;
+            /* The remainder rd1 - rdResult * rd2 is exactly representable, and
+               so is rd1 - rdProd (Sterbenz), so this is exact. */
+            double const rdProd = rdResult * rd2;
+            double const rdRem  = (rd1 - rdProd) - iemFpuHostDoubleMulErr(rdResult, rd2, rdProd);
+            rdResultVol = rdResult;
+            rdErrVol    = rd2 < 0.0 ? -rdRem : rdRem;
+            break;
+        }
+        default: /* checked above */
+            AssertFailed();
+            rdResultVol = 0.0;
+            rdErrVol    = 0.0;
+            break;
+    }
+
+    if (iemFpuHostDoubleGetMxcsr() != fMxcsrSaved)
+        iemFpuHostDoubleSetMxcsr(fMxcsrSaved);
+    double const rdResult = rdResultVol;
+    double const rdErr    = rdErrVol;
+
+    iemFpuHostDoubleToR80(rdResult, pr80Result);
+    if (rdErr != 0.0)
+    {
+        *pfFsw |= X86_FSW_PE;
+        if ((rdErr < 0.0) != (rdResult < 0.0)) /* Magnitude rounded up. */
+            *pfFsw |= X86_FSW_C1;
+    }
+    return true;
+}
+
+#endif /* IEM_WITH_X87_HOST_DOUBLE */
+
+
 /*********************************************************************************************************************************
 *   x86 FPU Division Operations                                                                                                  *
 *********************************************************************************************************************************/
@@ -5917,6 +6186,10 @@ static uint16_t iemAImpl_fdiv_f80_r80_worker(PCRTFLOAT80U pr80Val1, PCRTFLOAT80U
 {
     if (!RTFLOAT80U_IS_ZERO(pr80Val2) || RTFLOAT80U_IS_NAN(pr80Val1) || RTFLOAT80U_IS_INF(pr80Val1))
     {
+#ifdef IEM_WITH_X87_HOST_DOUBLE
+        if (iemFpuHostDoubleBinaryOp(kIemFpuHostDblOp_Div, pr80Val1, pr80Val2, pr80Result, fFcw, &fFsw))
+            return fFsw;
+#endif
         softfloat_state_t SoftState = IEM_SOFTFLOAT_STATE_INITIALIZER_FROM_FCW(fFcw);
         extFloat80_t r80XResult = extF80_div(iemFpuSoftF80FromIprt(pr80Val1), iemFpuSoftF80FromIprt(pr80Val2), &SoftState);
         return iemFpuSoftStateAndF80ToFswAndIprtResult(&SoftState, r80XResult, pr80Result, fFcw, fFsw, pr80Val1Org);
@@ -6154,6 +6427,10 @@ IEM_DECL_IMPL_DEF(void, iemAImpl_fprem1_r80_by_r80,(PCX86FXSTATE pFpuState, PIEM
 static uint16_t iemAImpl_fmul_f80_r80_worker(PCRTFLOAT80U pr80Val1, PCRTFLOAT80U pr80Val2, PRTFLOAT80U pr80Result,
                                              uint16_t fFcw, uint16_t fFsw, PCRTFLOAT80U pr80Val1Org)
 {
+#ifdef IEM_WITH_X87_HOST_DOUBLE
+    if (iemFpuHostDoubleBinaryOp(kIemFpuHostDblOp_Mul, pr80Val1, pr80Val2, pr80Result, fFcw, &fFsw))
+        return fFsw;
+#endif
     softfloat_state_t SoftState = IEM_SOFTFLOAT_STATE_INITIALIZER_FROM_FCW(fFcw);
     extFloat80_t r80XResult = extF80_mul(iemFpuSoftF80FromIprt(pr80Val1), iemFpuSoftF80FromIprt(pr80Val2), &SoftState);
     return iemFpuSoftStateAndF80ToFswAndIprtResult(&SoftState, r80XResult, pr80Result, fFcw, fFsw, pr80Val1Org);
@@ -6218,6 +6495,10 @@ EMIT_R80_BY_I16(iemAImpl_fimul_r80_by_i16, iemAImpl_fmul_r80_by_r80)
 static uint16_t iemAImpl_fadd_f80_r80_worker(PCRTFLOAT80U pr80Val1, PCRTFLOAT80U pr80Val2, PRTFLOAT80U pr80Result,
                                              uint16_t fFcw, uint16_t fFsw, PCRTFLOAT80U pr80Val1Org)
 {
+#ifdef IEM_WITH_X87_HOST_DOUBLE
+    if (iemFpuHostDoubleBinaryOp(kIemFpuHostDblOp_Add, pr80Val1, pr80Val2, pr80Result, fFcw, &fFsw))
+        return fFsw;
+#endif
     softfloat_state_t SoftState = IEM_SOFTFLOAT_STATE_INITIALIZER_FROM_FCW(fFcw);
     extFloat80_t r80XResult = extF80_add(iemFpuSoftF80FromIprt(pr80Val1), iemFpuSoftF80FromIprt(pr80Val2), &SoftState);
     return iemFpuSoftStateAndF80ToFswAndIprtResult(&SoftState, r80XResult, pr80Result, fFcw, fFsw, pr80Val1Org);
@@ -6282,6 +6563,10 @@ EMIT_R80_BY_I16(iemAImpl_fiadd_r80_by_i16, iemAImpl_fadd_r80_by_r80)
 static uint16_t iemAImpl_fsub_f80_r80_worker(PCRTFLOAT80U pr80Val1, PCRTFLOAT80U pr80Val2, PRTFLOAT80U pr80Result,
                                              uint16_t fFcw, uint16_t fFsw, PCRTFLOAT80U pr80Val1Org)
 {
+#ifdef IEM_WITH_X87_HOST_DOUBLE
+    if (iemFpuHostDoubleBinaryOp(kIemFpuHostDblOp_Sub, pr80Val1, pr80Val2, pr80Result, fFcw, &fFsw))
+        return fFsw;
+#endif
     softfloat_state_t SoftState = IEM_SOFTFLOAT_STATE_INITIALIZER_FROM_FCW(fFcw);
     extFloat80_t r80XResult = extF80_sub(iemFpuSoftF80FromIprt(pr80Val1), iemFpuSoftF80FromIprt(pr80Val2), &SoftState);
     return iemFpuSoftStateAndF80ToFswAndIprtResult(&SoftState, r80XResult, pr80Result, fFcw, fFsw, pr80Val1Org);
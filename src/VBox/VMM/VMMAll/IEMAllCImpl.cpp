@@ -8323,6 +8323,28 @@ IEM_CIMPL_DEF_3(iemCImpl_bound_32, int32_t, idxArray, int32_t, idxLowerBound, in
 
 
 
+/**
+ * Calculates how many whole string elements can be processed within the page
+ * of @a uVirtAddr, starting at @a uVirtAddr and going in the direction
+ * given by @a cbIncr.
+ *
+ * @returns Number of elements, zero if the first element crosses the page
+ *          boundary.
+ * @param   uVirtAddr   The flat address of the current element.
+ * @param   cbElement   The element size.
+ * @param   cbIncr      The signed address increment (EFLAGS.DF).
+ */
+DECL_FORCE_INLINE(uint32_t) iemStrInstrElementsLeftInPage(uint64_t uVirtAddr, uint8_t cbElement, int8_t cbIncr)
+{
+    uint32_t const offPage = (uint32_t)uVirtAddr & GUEST_PAGE_OFFSET_MASK;
+    if (cbIncr > 0)
+        return (GUEST_PAGE_SIZE - offPage) / cbElement;
+    if (offPage <= GUEST_PAGE_SIZE - cbElement)
+        return offPage / cbElement + 1;
+    return 0;
+}
+
+
 /*
  * Instantiate the various string operation combinations.
  */
@@ -177,29 +177,39 @@ IEM_CIMPL_DEF_1(RT_CONCAT4(iemCImpl_repe_cmps_op,OP_SIZE,_addr,ADDR_SIZE), uint8
          */
         ADDR2_TYPE  uVirtSrc1Addr = uSrc1AddrReg + (ADDR2_TYPE)uSrc1Base;
         ADDR2_TYPE  uVirtSrc2Addr = uSrc2AddrReg + (ADDR2_TYPE)uSrc2Base;
-        uint32_t    cLeftSrc1Page = (GUEST_PAGE_SIZE - (uVirtSrc1Addr & GUEST_PAGE_OFFSET_MASK)) / (OP_SIZE / 8);
+        uint32_t    cLeftSrc1Page = iemStrInstrElementsLeftInPage(uVirtSrc1Addr, OP_SIZE / 8, cbIncr);
         if (cLeftSrc1Page > uCounterReg)
             cLeftSrc1Page = uCounterReg;
-        uint32_t    cLeftSrc2Page = (GUEST_PAGE_SIZE - (uVirtSrc2Addr & GUEST_PAGE_OFFSET_MASK)) / (OP_SIZE / 8);
+        uint32_t    cLeftSrc2Page = iemStrInstrElementsLeftInPage(uVirtSrc2Addr, OP_SIZE / 8, cbIncr);
         uint32_t    cLeftPage     = RT_MIN(cLeftSrc1Page, cLeftSrc2Page);
 
         if (   cLeftPage > 0 /* can be null if unaligned, do one fallback round. */
-            && cbIncr > 0    /** @todo Optimize reverse direction string ops. */
-            && (   IS_64_BIT_CODE(pVCpu)
-                || (   uSrc1AddrReg < pSrc1Hid->u32Limit
-                    && uSrc1AddrReg + (cLeftPage * (OP_SIZE / 8)) <= pSrc1Hid->u32Limit
-                    && uSrc2AddrReg < pVCpu->cpum.GstCtx.es.u32Limit
-                    && uSrc2AddrReg + (cLeftPage * (OP_SIZE / 8)) <= pVCpu->cpum.GstCtx.es.u32Limit)
-               )
+            && (  cbIncr > 0
+                ? (   IS_64_BIT_CODE(pVCpu)
+                   || (   uSrc1AddrReg < pSrc1Hid->u32Limit
+                       && uSrc1AddrReg + (cLeftPage * (OP_SIZE / 8)) <= pSrc1Hid->u32Limit
+                       && uSrc2AddrReg < pVCpu->cpum.GstCtx.es.u32Limit
+                       && uSrc2AddrReg + (cLeftPage * (OP_SIZE / 8)) <= pVCpu->cpum.GstCtx.es.u32Limit))
+                :    (cLeftPage - 1) * (OP_SIZE / 8) <= RT_MIN(uSrc1AddrReg, uSrc2AddrReg) /* no register wraparound */
+                  && (   IS_64_BIT_CODE(pVCpu)
+                      || (   uSrc1AddrReg + (OP_SIZE / 8) <= pSrc1Hid->u32Limit
+                          && uSrc2AddrReg + (OP_SIZE / 8) <= pVCpu->cpum.GstCtx.es.u32Limit)))
            )
         {
+            /* The block starts at the lowest address, which is the current
+               one when going forward and the last element when going backwards. */
+            uint32_t const   cbBlock      = cLeftPage * (OP_SIZE / 8);
+            ADDR2_TYPE const offBlockBack = cbIncr > 0 ? 0 : cbBlock - (OP_SIZE / 8);
+
             RTGCPHYS GCPhysSrc1Mem;
-            rcStrict = iemMemPageTranslateAndCheckAccess(pVCpu, uVirtSrc1Addr, OP_SIZE / 8, IEM_ACCESS_DATA_R, &GCPhysSrc1Mem);
+            rcStrict = iemMemPageTranslateAndCheckAccess(pVCpu, uVirtSrc1Addr - offBlockBack, OP_SIZE / 8, IEM_ACCESS_DATA_R,
+                                                         &GCPhysSrc1Mem);
             if (rcStrict != VINF_SUCCESS)
                 return rcStrict;
 
             RTGCPHYS GCPhysSrc2Mem;
-            rcStrict = iemMemPageTranslateAndCheckAccess(pVCpu, uVirtSrc2Addr, OP_SIZE / 8, IEM_ACCESS_DATA_R, &GCPhysSrc2Mem);
+            rcStrict = iemMemPageTranslateAndCheckAccess(pVCpu, uVirtSrc2Addr - offBlockBack, OP_SIZE / 8, IEM_ACCESS_DATA_R,
+                                                         &GCPhysSrc2Mem);
             if (rcStrict != VINF_SUCCESS)
                 return rcStrict;
 
@@ -217,29 +227,35 @@ IEM_CIMPL_DEF_1(RT_CONCAT4(iemCImpl_repe_cmps_op,OP_SIZE,_addr,ADDR_SIZE), uint8
                 rcStrict = iemMemPageMap(pVCpu, GCPhysSrc1Mem, IEM_ACCESS_DATA_R, (void **)&puSrc1Mem, &PgLockSrc1Mem);
                 if (rcStrict == VINF_SUCCESS)
                 {
-                    if (!memcmp(puSrc2Mem, puSrc1Mem, cLeftPage * (OP_SIZE / 8)))
+                    /* Elements are compared from the low end going forward and
+                       from the high end going backwards, so the last one
+                       compared is at index cLeftPage - 1 or 0 respectively. */
+                    uint32_t off;
+                    if (!memcmp(puSrc2Mem, puSrc1Mem, cbBlock))
                     {
-                        /* All matches, only compare the last itme to get the right eflags. */
-                        uEFlags = RT_CONCAT(iemAImpl_cmp_u,OP_SIZE)(uEFlags, (OP_TYPE *)&puSrc1Mem[cLeftPage-1], puSrc2Mem[cLeftPage-1]);
-                        uSrc1AddrReg += cLeftPage * cbIncr;
-                        uSrc2AddrReg += cLeftPage * cbIncr;
-                        uCounterReg  -= cLeftPage;
+                        /* All matches, only compare the last item to get the right eflags. */
+                        uint32_t const idxLast = cbIncr > 0 ? cLeftPage - 1 : 0;
+                        uEFlags = RT_CONCAT(iemAImpl_cmp_u,OP_SIZE)(uEFlags, (OP_TYPE *)&puSrc1Mem[idxLast], puSrc2Mem[idxLast]);
+                        off = cLeftPage;
                     }
                     else
                     {
                         /* Some mismatch, compare each item (and keep volatile
                            memory in mind). */
-                        uint32_t off = 0;
+                        off = 0;
                         do
                         {
-                            uEFlags = RT_CONCAT(iemAImpl_cmp_u,OP_SIZE)(uEFlags, (OP_TYPE *)&puSrc1Mem[off], puSrc2Mem[off]);
+                            uint32_t const idx = cbIncr > 0 ? off : cLeftPage - 1 - off;
+                            uEFlags = RT_CONCAT(iemAImpl_cmp_u,OP_SIZE)(uEFlags, (OP_TYPE *)&puSrc1Mem[idx], puSrc2Mem[idx]);
                             off++;
                         } while (   off < cLeftPage
                                  && (uEFlags & X86_EFL_ZF));
-                        uSrc1AddrReg += cbIncr * off;
-                        uSrc2AddrReg += cbIncr * off;
-                        uCounterReg  -= off;
                     }
+                    uint32_t const  cbDone    = off * (OP_SIZE / 8);
+                    ADDR_TYPE const cbAdvance = cbIncr > 0 ? (ADDR_TYPE)cbDone : (ADDR_TYPE)0 - (ADDR_TYPE)cbDone;
+                    uSrc1AddrReg += cbAdvance;
+                    uSrc2AddrReg += cbAdvance;
+                    uCounterReg  -= off;
 
                     /* Update the registers before looping. */
                     pVCpu->cpum.GstCtx.ADDR_rCX = uCounterReg;
@@ -343,29 +359,39 @@ IEM_CIMPL_DEF_1(RT_CONCAT4(iemCImpl_repne_cmps_op,OP_SIZE,_addr,ADDR_SIZE), uint
          */
         ADDR2_TYPE  uVirtSrc1Addr = uSrc1AddrReg + (ADDR2_TYPE)uSrc1Base;
         ADDR2_TYPE  uVirtSrc2Addr = uSrc2AddrReg + (ADDR2_TYPE)uSrc2Base;
-        uint32_t    cLeftSrc1Page = (GUEST_PAGE_SIZE - (uVirtSrc1Addr & GUEST_PAGE_OFFSET_MASK)) / (OP_SIZE / 8);
+        uint32_t    cLeftSrc1Page = iemStrInstrElementsLeftInPage(uVirtSrc1Addr, OP_SIZE / 8, cbIncr);
         if (cLeftSrc1Page > uCounterReg)
             cLeftSrc1Page = uCounterReg;
-        uint32_t    cLeftSrc2Page = (GUEST_PAGE_SIZE - (uVirtSrc2Addr & GUEST_PAGE_OFFSET_MASK)) / (OP_SIZE / 8);
+        uint32_t    cLeftSrc2Page = iemStrInstrElementsLeftInPage(uVirtSrc2Addr, OP_SIZE / 8, cbIncr);
         uint32_t    cLeftPage = RT_MIN(cLeftSrc1Page, cLeftSrc2Page);
 
         if (   cLeftPage > 0 /* can be null if unaligned, do one fallback round. */
-            && cbIncr > 0    /** @todo Optimize reverse direction string ops. */
-            && (   IS_64_BIT_CODE(pVCpu)
-                || (   uSrc1AddrReg < pSrc1Hid->u32Limit
-                    && uSrc1AddrReg + (cLeftPage * (OP_SIZE / 8)) <= pSrc1Hid->u32Limit
-                    && uSrc2AddrReg < pVCpu->cpum.GstCtx.es.u32Limit
-                    && uSrc2AddrReg + (cLeftPage * (OP_SIZE / 8)) <= pVCpu->cpum.GstCtx.es.u32Limit)
-                )
+            && (  cbIncr > 0
+                ? (   IS_64_BIT_CODE(pVCpu)
+                   || (   uSrc1AddrReg < pSrc1Hid->u32Limit
+                       && uSrc1AddrReg + (cLeftPage * (OP_SIZE / 8)) <= pSrc1Hid->u32Limit
+                       && uSrc2AddrReg < pVCpu->cpum.GstCtx.es.u32Limit
+                       && uSrc2AddrReg + (cLeftPage * (OP_SIZE / 8)) <= pVCpu->cpum.GstCtx.es.u32Limit))
+                :    (cLeftPage - 1) * (OP_SIZE / 8) <= RT_MIN(uSrc1AddrReg, uSrc2AddrReg) /* no register wraparound */
+                  && (   IS_64_BIT_CODE(pVCpu)
+                      || (   uSrc1AddrReg + (OP_SIZE / 8) <= pSrc1Hid->u32Limit
+                          && uSrc2AddrReg + (OP_SIZE / 8) <= pVCpu->cpum.GstCtx.es.u32Limit)))
            )
         {
+            /* The block starts at the lowest address, which is the current
+               one when going forward and the last element when going backwards. */
+            uint32_t const   cbBlock      = cLeftPage * (OP_SIZE / 8);
+            ADDR2_TYPE const offBlockBack = cbIncr > 0 ? 0 : cbBlock - (OP_SIZE / 8);
+
             RTGCPHYS GCPhysSrc1Mem;
-            rcStrict = iemMemPageTranslateAndCheckAccess(pVCpu, uVirtSrc1Addr, OP_SIZE / 8, IEM_ACCESS_DATA_R, &GCPhysSrc1Mem);
+            rcStrict = iemMemPageTranslateAndCheckAccess(pVCpu, uVirtSrc1Addr - offBlockBack, OP_SIZE / 8, IEM_ACCESS_DATA_R,
+                                                         &GCPhysSrc1Mem);
             if (rcStrict != VINF_SUCCESS)
                 return rcStrict;
 
             RTGCPHYS GCPhysSrc2Mem;
-            rcStrict = iemMemPageTranslateAndCheckAccess(pVCpu, uVirtSrc2Addr, OP_SIZE / 8, IEM_ACCESS_DATA_R, &GCPhysSrc2Mem);
+            rcStrict = iemMemPageTranslateAndCheckAccess(pVCpu, uVirtSrc2Addr - offBlockBack, OP_SIZE / 8, IEM_ACCESS_DATA_R,
+                                                         &GCPhysSrc2Mem);
             if (rcStrict != VINF_SUCCESS)
                 return rcStrict;
 
@@ -383,29 +409,23 @@ IEM_CIMPL_DEF_1(RT_CONCAT4(iemCImpl_repne_cmps_op,OP_SIZE,_addr,ADDR_SIZE), uint
                 rcStrict = iemMemPageMap(pVCpu, GCPhysSrc1Mem, IEM_ACCESS_DATA_R, (void **)&puSrc1Mem, &PgLockSrc1Mem);
                 if (rcStrict == VINF_SUCCESS)
                 {
-                    if (memcmp(puSrc2Mem, puSrc1Mem, cLeftPage * (OP_SIZE / 8)))
+                    /* Compare each item till we find a match.  Unlike REPE, a
+                       memcmp() mismatch says nothing about whether some pair
+                       is equal, so there is no shortcut here.  Elements are
+                       compared from the high end when going backwards. */
+                    uint32_t off = 0;
+                    do
                     {
-                        /* All matches, only compare the last item to get the right eflags. */
-                        uEFlags = RT_CONCAT(iemAImpl_cmp_u,OP_SIZE)(uEFlags, (OP_TYPE *)&puSrc1Mem[cLeftPage-1], puSrc2Mem[cLeftPage-1]);
-                        uSrc1AddrReg += cLeftPage * cbIncr;
-                        uSrc2AddrReg += cLeftPage * cbIncr;
-                        uCounterReg  -= cLeftPage;
-                    }
-                    else
-                    {
-                        /* Some mismatch, compare each item (and keep volatile
-                           memory in mind). */
-                        uint32_t off = 0;
-                        do
-                        {
-                            uEFlags = RT_CONCAT(iemAImpl_cmp_u,OP_SIZE)(uEFlags, (OP_TYPE *)&puSrc1Mem[off], puSrc2Mem[off]);
-                            off++;
-                        } while (   off < cLeftPage
-                                 && !(uEFlags & X86_EFL_ZF));
-                        uSrc1AddrReg += cbIncr * off;
-                        uSrc2AddrReg += cbIncr * off;
-                        uCounterReg  -= off;
-                    }
+                        uint32_t const idx = cbIncr > 0 ? off : cLeftPage - 1 - off;
+                        uEFlags = RT_CONCAT(iemAImpl_cmp_u,OP_SIZE)(uEFlags, (OP_TYPE *)&puSrc1Mem[idx], puSrc2Mem[idx]);
+                        off++;
+                    } while (   off < cLeftPage
+                             && !(uEFlags & X86_EFL_ZF));
+                    uint32_t const  cbDone    = off * (OP_SIZE / 8);
+                    ADDR_TYPE const cbAdvance = cbIncr > 0 ? (ADDR_TYPE)cbDone : (ADDR_TYPE)0 - (ADDR_TYPE)cbDone;
+                    uSrc1AddrReg += cbAdvance;
+                    uSrc2AddrReg += cbAdvance;
+                    uCounterReg  -= off;
 
                     /* Update the registers before looping. */
                     pVCpu->cpum.GstCtx.ADDR_rCX = uCounterReg;
@@ -501,19 +521,26 @@ IEM_CIMPL_DEF_0(RT_CONCAT4(iemCImpl_repe_scas_,OP_rAX,_m,ADDR_SIZE))
          * Do segmentation and virtual page stuff.
          */
         ADDR2_TYPE  uVirtAddr = uAddrReg + (ADDR2_TYPE)uBaseAddr;
-        uint32_t    cLeftPage = (GUEST_PAGE_SIZE - (uVirtAddr & GUEST_PAGE_OFFSET_MASK)) / (OP_SIZE / 8);
+        uint32_t    cLeftPage = iemStrInstrElementsLeftInPage(uVirtAddr, OP_SIZE / 8, cbIncr);
         if (cLeftPage > uCounterReg)
             cLeftPage = uCounterReg;
         if (   cLeftPage > 0 /* can be null if unaligned, do one fallback round. */
-            && cbIncr > 0    /** @todo Implement reverse direction string ops. */
-            && (   IS_64_BIT_CODE(pVCpu)
-                || (   uAddrReg < pVCpu->cpum.GstCtx.es.u32Limit
-                    && uAddrReg + (cLeftPage * (OP_SIZE / 8)) <= pVCpu->cpum.GstCtx.es.u32Limit)
-               )
+            && (  cbIncr > 0
+                ? (   IS_64_BIT_CODE(pVCpu)
+                   || (   uAddrReg < pVCpu->cpum.GstCtx.es.u32Limit
+                       && uAddrReg + (cLeftPage * (OP_SIZE / 8)) <= pVCpu->cpum.GstCtx.es.u32Limit))
+                :    (cLeftPage - 1) * (OP_SIZE / 8) <= uAddrReg /* no register wraparound */
+                  && (   IS_64_BIT_CODE(pVCpu)
+                      || uAddrReg + (OP_SIZE / 8) <= pVCpu->cpum.GstCtx.es.u32Limit))
            )
         {
+            /* The block starts at the lowest address; going backwards we
+               scan it from the high end. */
+            uint32_t const cbBlock = cLeftPage * (OP_SIZE / 8);
+
             RTGCPHYS GCPhysMem;
-            rcStrict = iemMemPageTranslateAndCheckAccess(pVCpu, uVirtAddr, OP_SIZE / 8, IEM_ACCESS_DATA_R, &GCPhysMem);
+            rcStrict = iemMemPageTranslateAndCheckAccess(pVCpu, cbIncr > 0 ? uVirtAddr : uVirtAddr - (cbBlock - OP_SIZE / 8),
+                                                         OP_SIZE / 8, IEM_ACCESS_DATA_R, &GCPhysMem);
             if (rcStrict != VINF_SUCCESS)
                 return rcStrict;
 
@@ -532,14 +559,17 @@ IEM_CIMPL_DEF_0(RT_CONCAT4(iemCImpl_repe_scas_,OP_rAX,_m,ADDR_SIZE))
                 uint32_t i = 0;
                 do
                 {
-                    uTmpValue = puMem[i++];
+                    uTmpValue = puMem[cbIncr > 0 ? i : cLeftPage - 1 - i];
+                    i++;
                     fQuit = uTmpValue != uValueReg;
                 } while (i < cLeftPage && !fQuit);
 
                 /* Update the regs. */
                 uEFlags = RT_CONCAT(iemAImpl_cmp_u,OP_SIZE)(uEFlags, (OP_TYPE *)&uValueReg, uTmpValue);
                 pVCpu->cpum.GstCtx.ADDR_rCX = uCounterReg -= i;
-                pVCpu->cpum.GstCtx.ADDR_rDI = uAddrReg    += i * cbIncr;
+                pVCpu->cpum.GstCtx.ADDR_rDI = uAddrReg    += cbIncr > 0
+                                                           ? (ADDR_TYPE)(i * (OP_SIZE / 8))
+                                                           : (ADDR_TYPE)0 - (ADDR_TYPE)(i * (OP_SIZE / 8));
                 pVCpu->cpum.GstCtx.eflags.u = uEFlags;
                 Assert(!(uEFlags & X86_EFL_ZF) == fQuit);
                 iemMemPageUnmap(pVCpu, GCPhysMem, IEM_ACCESS_DATA_R, puMem, &PgLockMem);
@@ -629,19 +659,26 @@ IEM_CIMPL_DEF_0(RT_CONCAT4(iemCImpl_repne_scas_,OP_rAX,_m,ADDR_SIZE))
          * Do segmentation and virtual page stuff.
          */
         ADDR2_TYPE  uVirtAddr = uAddrReg + (ADDR2_TYPE)uBaseAddr;
-        uint32_t    cLeftPage = (GUEST_PAGE_SIZE - (uVirtAddr & GUEST_PAGE_OFFSET_MASK)) / (OP_SIZE / 8);
+        uint32_t    cLeftPage = iemStrInstrElementsLeftInPage(uVirtAddr, OP_SIZE / 8, cbIncr);
         if (cLeftPage > uCounterReg)
             cLeftPage = uCounterReg;
         if (   cLeftPage > 0 /* can be null if unaligned, do one fallback round. */
-            && cbIncr > 0    /** @todo Implement reverse direction string ops. */
-            && (   IS_64_BIT_CODE(pVCpu)
-                || (   uAddrReg < pVCpu->cpum.GstCtx.es.u32Limit
-                    && uAddrReg + (cLeftPage * (OP_SIZE / 8)) <= pVCpu->cpum.GstCtx.es.u32Limit)
-               )
+            && (  cbIncr > 0
+                ? (   IS_64_BIT_CODE(pVCpu)
+                   || (   uAddrReg < pVCpu->cpum.GstCtx.es.u32Limit
+                       && uAddrReg + (cLeftPage * (OP_SIZE / 8)) <= pVCpu->cpum.GstCtx.es.u32Limit))
+                :    (cLeftPage - 1) * (OP_SIZE / 8) <= uAddrReg /* no register wraparound */
+                  && (   IS_64_BIT_CODE(pVCpu)
+                      || uAddrReg + (OP_SIZE / 8) <= pVCpu->cpum.GstCtx.es.u32Limit))
            )
         {
+            /* The block starts at the lowest address; going backwards we
+               scan it from the high end. */
+            uint32_t const cbBlock = cLeftPage * (OP_SIZE / 8);
+
             RTGCPHYS GCPhysMem;
-            rcStrict = iemMemPageTranslateAndCheckAccess(pVCpu, uVirtAddr, OP_SIZE / 8, IEM_ACCESS_DATA_R, &GCPhysMem);
+            rcStrict = iemMemPageTranslateAndCheckAccess(pVCpu, cbIncr > 0 ? uVirtAddr : uVirtAddr - (cbBlock - OP_SIZE / 8),
+                                                         OP_SIZE / 8, IEM_ACCESS_DATA_R, &GCPhysMem);
             if (rcStrict != VINF_SUCCESS)
                 return rcStrict;
 
@@ -660,14 +697,17 @@ IEM_CIMPL_DEF_0(RT_CONCAT4(iemCImpl_repne_scas_,OP_rAX,_m,ADDR_SIZE))
                 uint32_t i = 0;
                 do
                 {
-                    uTmpValue = puMem[i++];
+                    uTmpValue = puMem[cbIncr > 0 ? i : cLeftPage - 1 - i];
+                    i++;
                     fQuit = uTmpValue == uValueReg;
                 } while (i < cLeftPage && !fQuit);
 
                 /* Update the regs. */
                 uEFlags = RT_CONCAT(iemAImpl_cmp_u,OP_SIZE)(uEFlags, (OP_TYPE *)&uValueReg, uTmpValue);
                 pVCpu->cpum.GstCtx.ADDR_rCX = uCounterReg -= i;
-                pVCpu->cpum.GstCtx.ADDR_rDI = uAddrReg    += i * cbIncr;
+                pVCpu->cpum.GstCtx.ADDR_rDI = uAddrReg    += cbIncr > 0
+                                                           ? (ADDR_TYPE)(i * (OP_SIZE / 8))
+                                                           : (ADDR_TYPE)0 - (ADDR_TYPE)(i * (OP_SIZE / 8));
                 pVCpu->cpum.GstCtx.eflags.u = uEFlags;
                 Assert(!!(uEFlags & X86_EFL_ZF) == fQuit);
                 iemMemPageUnmap(pVCpu, GCPhysMem, IEM_ACCESS_DATA_R, puMem, &PgLockMem);
@@ -774,29 +814,39 @@ IEM_CIMPL_DEF_1(RT_CONCAT4(iemCImpl_rep_movs_op,OP_SIZE,_addr,ADDR_SIZE), uint8_
          */
         ADDR2_TYPE  uVirtSrcAddr = uSrcAddrReg + (ADDR2_TYPE)uSrcBase;
         ADDR2_TYPE  uVirtDstAddr = uDstAddrReg + (ADDR2_TYPE)uDstBase;
-        uint32_t    cLeftSrcPage = (GUEST_PAGE_SIZE - (uVirtSrcAddr & GUEST_PAGE_OFFSET_MASK)) / (OP_SIZE / 8);
+        uint32_t    cLeftSrcPage = iemStrInstrElementsLeftInPage(uVirtSrcAddr, OP_SIZE / 8, cbIncr);
         if (cLeftSrcPage > uCounterReg)
             cLeftSrcPage = uCounterReg;
-        uint32_t    cLeftDstPage = (GUEST_PAGE_SIZE - (uVirtDstAddr & GUEST_PAGE_OFFSET_MASK)) / (OP_SIZE / 8);
+        uint32_t    cLeftDstPage = iemStrInstrElementsLeftInPage(uVirtDstAddr, OP_SIZE / 8, cbIncr);
         uint32_t    cLeftPage = RT_MIN(cLeftSrcPage, cLeftDstPage);
 
         if (   cLeftPage > 0 /* can be null if unaligned, do one fallback round. */
-            && cbIncr > 0    /** @todo Implement reverse direction string ops. */
-            && (   IS_64_BIT_CODE(pVCpu)
-                || (   uSrcAddrReg < pSrcHid->u32Limit
-                    && uSrcAddrReg + (cLeftPage * (OP_SIZE / 8)) <= pSrcHid->u32Limit
-                    && uDstAddrReg < pVCpu->cpum.GstCtx.es.u32Limit
-                    && uDstAddrReg + (cLeftPage * (OP_SIZE / 8)) <= pVCpu->cpum.GstCtx.es.u32Limit)
-               )
+            && (  cbIncr > 0
+                ? (   IS_64_BIT_CODE(pVCpu)
+                   || (   uSrcAddrReg < pSrcHid->u32Limit
+                       && uSrcAddrReg + (cLeftPage * (OP_SIZE / 8)) <= pSrcHid->u32Limit
+                       && uDstAddrReg < pVCpu->cpum.GstCtx.es.u32Limit
+                       && uDstAddrReg + (cLeftPage * (OP_SIZE / 8)) <= pVCpu->cpum.GstCtx.es.u32Limit))
+                :    (cLeftPage - 1) * (OP_SIZE / 8) <= RT_MIN(uSrcAddrReg, uDstAddrReg) /* no register wraparound */
+                  && (   IS_64_BIT_CODE(pVCpu)
+                      || (   uSrcAddrReg + (OP_SIZE / 8) <= pSrcHid->u32Limit
+                          && uDstAddrReg + (OP_SIZE / 8) <= pVCpu->cpum.GstCtx.es.u32Limit)))
            )
         {
+            /* The block starts at the lowest address, which is the current
+               one when going forward and the last element when going backwards. */
+            uint32_t const cbBlock        = cLeftPage * (OP_SIZE / 8);
+            ADDR2_TYPE const offBlockBack = cbIncr > 0 ? 0 : cbBlock - (OP_SIZE / 8);
+
             RTGCPHYS GCPhysSrcMem;
-            rcStrict = iemMemPageTranslateAndCheckAccess(pVCpu, uVirtSrcAddr, OP_SIZE / 8, IEM_ACCESS_DATA_R, &GCPhysSrcMem);
+            rcStrict = iemMemPageTranslateAndCheckAccess(pVCpu, uVirtSrcAddr - offBlockBack, OP_SIZE / 8, IEM_ACCESS_DATA_R,
+                                                         &GCPhysSrcMem);
             if (rcStrict != VINF_SUCCESS)
                 return rcStrict;
 
             RTGCPHYS GCPhysDstMem;
-            rcStrict = iemMemPageTranslateAndCheckAccess(pVCpu, uVirtDstAddr, OP_SIZE / 8, IEM_ACCESS_DATA_W, &GCPhysDstMem);
+            rcStrict = iemMemPageTranslateAndCheckAccess(pVCpu, uVirtDstAddr - offBlockBack, OP_SIZE / 8, IEM_ACCESS_DATA_W,
+                                                         &GCPhysDstMem);
             if (rcStrict != VINF_SUCCESS)
                 return rcStrict;
 
@@ -817,18 +867,38 @@ IEM_CIMPL_DEF_1(RT_CONCAT4(iemCImpl_rep_movs_op,OP_SIZE,_addr,ADDR_SIZE), uint8_
                     Assert(   (GCPhysSrcMem         >> GUEST_PAGE_SHIFT) != (GCPhysDstMem         >> GUEST_PAGE_SHIFT)
                            || ((uintptr_t)puSrcMem  >> GUEST_PAGE_SHIFT) == ((uintptr_t)puDstMem  >> GUEST_PAGE_SHIFT));
 
-                    /* Perform the operation exactly (don't use memcpy to avoid
-                       having to consider how its implementation would affect
-                       any overlapping source and destination area). */
-                    OP_TYPE const  *puSrcCur = puSrcMem;
-                    OP_TYPE        *puDstCur = puDstMem;
-                    uint32_t        cTodo    = cLeftPage;
-                    while (cTodo-- > 0)
-                        *puDstCur++ = *puSrcCur++;
+                    /* Perform the operation exactly.  A forward copy equals a
+                       memmove unless the destination starts inside the source
+                       block, and a backward copy likewise unless the source
+                       starts inside the destination block.  In those two cases
+                       the guest expects the element pattern to be replicated,
+                       so we do it one element at a time. */
+                    if (cbIncr > 0)
+                    {
+                        if ((uintptr_t)puDstMem - (uintptr_t)puSrcMem >= cbBlock)
+                            memmove(puDstMem, puSrcMem, cbBlock);
+                        else
+                        {
+                            OP_TYPE const  *puSrcCur = puSrcMem;
+                            OP_TYPE        *puDstCur = puDstMem;
+                            uint32_t        cTodo    = cLeftPage;
+                            while (cTodo-- > 0)
+                                *puDstCur++ = *puSrcCur++;
+                        }
+                    }
+                    else if ((uintptr_t)puSrcMem - (uintptr_t)puDstMem >= cbBlock)
+                        memmove(puDstMem, puSrcMem, cbBlock);
+                    else
+                    {
+                        uint32_t idx = cLeftPage;
+                        while (idx-- > 0)
+                            puDstMem[idx] = puSrcMem[idx];
+                    }
 
                     /* Update the registers. */
-                    pVCpu->cpum.GstCtx.ADDR_rSI = uSrcAddrReg += cLeftPage * cbIncr;
-                    pVCpu->cpum.GstCtx.ADDR_rDI = uDstAddrReg += cLeftPage * cbIncr;
+                    ADDR_TYPE const cbAdvance = cbIncr > 0 ? (ADDR_TYPE)cbBlock : (ADDR_TYPE)0 - (ADDR_TYPE)cbBlock;
+                    pVCpu->cpum.GstCtx.ADDR_rSI = uSrcAddrReg += cbAdvance;
+                    pVCpu->cpum.GstCtx.ADDR_rDI = uDstAddrReg += cbAdvance;
                     pVCpu->cpum.GstCtx.ADDR_rCX = uCounterReg -= cLeftPage;
 
                     iemMemPageUnmap(pVCpu, GCPhysSrcMem, IEM_ACCESS_DATA_R, puSrcMem, &PgLockSrcMem);
@@ -924,19 +994,27 @@ IEM_CIMPL_DEF_0(RT_CONCAT4(iemCImpl_stos_,OP_rAX,_m,ADDR_SIZE))
          * Do segmentation and virtual page stuff.
          */
         ADDR2_TYPE  uVirtAddr = uAddrReg + (ADDR2_TYPE)uBaseAddr;
-        uint32_t    cLeftPage = (GUEST_PAGE_SIZE - (uVirtAddr & GUEST_PAGE_OFFSET_MASK)) / (OP_SIZE / 8);
+        uint32_t    cLeftPage = iemStrInstrElementsLeftInPage(uVirtAddr, OP_SIZE / 8, cbIncr);
         if (cLeftPage > uCounterReg)
             cLeftPage = uCounterReg;
         if (   cLeftPage > 0 /* can be null if unaligned, do one fallback round. */
-            && cbIncr > 0    /** @todo Implement reverse direction string ops. */
-            && (   IS_64_BIT_CODE(pVCpu)
-                || (   uAddrReg < pVCpu->cpum.GstCtx.es.u32Limit
-                    && uAddrReg + (cLeftPage * (OP_SIZE / 8)) <= pVCpu->cpum.GstCtx.es.u32Limit)
-               )
+            && (  cbIncr > 0
+                ? (   IS_64_BIT_CODE(pVCpu)
+                   || (   uAddrReg < pVCpu->cpum.GstCtx.es.u32Limit
+                       && uAddrReg + (cLeftPage * (OP_SIZE / 8)) <= pVCpu->cpum.GstCtx.es.u32Limit))
+                :    (cLeftPage - 1) * (OP_SIZE / 8) <= uAddrReg /* no register wraparound */
+                  && (   IS_64_BIT_CODE(pVCpu)
+                      || uAddrReg + (OP_SIZE / 8) <= pVCpu->cpum.GstCtx.es.u32Limit))
            )
         {
+            /* The block starts at the lowest address; the fill order does not
+               matter once the whole block is mapped. */
+            uint32_t const  cbBlock   = cLeftPage * (OP_SIZE / 8);
+            ADDR_TYPE const cbAdvance = cbIncr > 0 ? (ADDR_TYPE)cbBlock : (ADDR_TYPE)0 - (ADDR_TYPE)cbBlock;
+
             RTGCPHYS GCPhysMem;
-            rcStrict = iemMemPageTranslateAndCheckAccess(pVCpu, uVirtAddr, OP_SIZE / 8, IEM_ACCESS_DATA_W, &GCPhysMem);
+            rcStrict = iemMemPageTranslateAndCheckAccess(pVCpu, cbIncr > 0 ? uVirtAddr : uVirtAddr - (cbBlock - OP_SIZE / 8),
+                                                         OP_SIZE / 8, IEM_ACCESS_DATA_W, &GCPhysMem);
             if (rcStrict != VINF_SUCCESS)
                 return rcStrict;
 
@@ -951,13 +1029,13 @@ IEM_CIMPL_DEF_0(RT_CONCAT4(iemCImpl_stos_,OP_rAX,_m,ADDR_SIZE))
             {
                 /* Update the regs first so we can loop on cLeftPage. */
                 pVCpu->cpum.GstCtx.ADDR_rCX = uCounterReg -= cLeftPage;
-                pVCpu->cpum.GstCtx.ADDR_rDI = uAddrReg    += cLeftPage * cbIncr;
+                pVCpu->cpum.GstCtx.ADDR_rDI = uAddrReg    += cbAdvance;
 
                 /* Do the memsetting. */
 #if OP_SIZE == 8
                 memset(puMem, uValue, cLeftPage);
-/*#elif OP_SIZE == 32
-                ASMMemFill32(puMem, cLeftPage * (OP_SIZE / 8), uValue);*/
+#elif OP_SIZE == 32
+                ASMMemFill32(puMem, cbBlock, uValue);
 #else
                 while (cLeftPage-- > 0)
                     *puMem++ = uValue;
@@ -983,7 +1061,7 @@ IEM_CIMPL_DEF_0(RT_CONCAT4(iemCImpl_stos_,OP_rAX,_m,ADDR_SIZE))
             else if (rcStrict == VERR_PGM_PHYS_TLB_UNASSIGNED)
             {
                 pVCpu->cpum.GstCtx.ADDR_rCX = uCounterReg -= cLeftPage;
-                pVCpu->cpum.GstCtx.ADDR_rDI = uAddrReg    += cLeftPage * cbIncr;
+                pVCpu->cpum.GstCtx.ADDR_rDI = uAddrReg    += cbAdvance;
                 if (uCounterReg == 0)
                     break;
                 if (!(uVirtAddr & (OP_SIZE / 8 - 1)))
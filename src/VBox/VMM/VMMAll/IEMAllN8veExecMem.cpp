@@ -90,6 +90,10 @@ extern "C" void *__deregister_frame_info(void *pvBegin);           /* (returns p
 # endif
 #endif
 
+#if defined(IN_RING3) && defined(RT_OS_LINUX)
+# include <sys/mman.h>
+#endif
+
 #include "IEMN8veRecompiler.h"
 
 
@@ -105,6 +109,24 @@ extern "C" void *__deregister_frame_info(void *pvBegin);           /* (returns p
 #define IEMEXECMEM_ALT_SUB_WITH_ALLOC_HEADER
 /** Use alternative pruning. */
 #define IEMEXECMEM_ALT_SUB_WITH_ALT_PRUNING
+/** Try back the chunks with large pages to reduce iTLB pressure when running
+ * large TB working sets.  This is only done on linux for now, as darwin
+ * requires the RW/RX dual mapping created by mach_vm_remap and windows
+ * requires a special privilege for large pages. */
+#if defined(IN_RING3) && defined(RT_OS_LINUX) && !defined(IEMEXECMEM_WITHOUT_LARGE_PAGES)
+# define IEMEXECMEM_WITH_LARGE_PAGES
+#endif
+/** The large page size we're aiming for, also used as the locality window when
+ * trying to place TBs near the ones they chain to. */
+#define IEMEXECMEM_LARGE_PAGE_SIZE              _2M
+#ifdef IEMEXECMEM_WITH_LARGE_PAGES
+# ifdef MAP_HUGE_SHIFT
+/** The MAP_HUGETLB page size selector for 2 MiB pages. */
+#  define IEMEXECMEM_MAP_HUGE_2MB               (21 << MAP_HUGE_SHIFT)
+# else
+#  define IEMEXECMEM_MAP_HUGE_2MB               0 /* default hugetlbfs page size */
+# endif
+#endif
 
 
 #if defined(IN_RING3) && !defined(RT_OS_WINDOWS)
@@ -221,6 +243,10 @@ typedef struct IEMEXECMEMCHUNK
     uint32_t                cFreeUnits;
     /** Hint were to start searching for free space in the allocation bitmap. */
     uint32_t                idxFreeHint;
+#ifdef IEMEXECMEM_WITH_LARGE_PAGES
+    /** How the chunk memory was allocated, IEMEXECMEMCHUNK_BACKING_XXX. */
+    uint8_t                 bBacking;
+#endif
     /** Pointer to the readable/writeable view of the memory chunk. */
     void                   *pvChunkRw;
     /** Pointer to the readable/executable view of the memory chunk. */
@@ -251,6 +277,20 @@ typedef struct IEMEXECMEMCHUNK
 /** Pointer to a memory chunk. */
 typedef IEMEXECMEMCHUNK *PIEMEXECMEMCHUNK;
 
+#ifdef IEMEXECMEM_WITH_LARGE_PAGES
+/** @name IEMEXECMEMCHUNK_BACKING_XXX - IEMEXECMEMCHUNK::bBacking values.
+ * @{ */
+/** Regular RTMemPageAllocEx memory. */
+# define IEMEXECMEMCHUNK_BACKING_PAGE_ALLOC     0
+/** Large page aligned mmap, but MADV_HUGEPAGE was refused. */
+# define IEMEXECMEMCHUNK_BACKING_MMAP           1
+/** Large page aligned mmap advised to use transparent huge pages. */
+# define IEMEXECMEMCHUNK_BACKING_THP            2
+/** hugetlbfs pages (MAP_HUGETLB). */
+# define IEMEXECMEMCHUNK_BACKING_HUGETLB        3
+/** @} */
+#endif
+
 
 /**
  * Executable memory allocator for the native recompiler.
@@ -303,10 +343,23 @@ typedef struct IEMEXECMEMALLOCATOR
     STAMPROFILE             StatPruneRecovered;
 #endif
 
+#ifdef IEMEXECMEM_WITH_LARGE_PAGES
+    /** Whether to try back new chunks with large pages (/IEM/ExecMemLargePages). */
+    bool                    fLargePages;
+    /** Number of chunks backed by hugetlbfs pages. */
+    uint32_t                cChunksHugeTlb;
+    /** Number of chunks backed by transparent huge pages. */
+    uint32_t                cChunksThp;
+#endif
+
 #ifdef VBOX_WITH_STATISTICS
     STAMPROFILE             StatAlloc;
     /** Total amount of memory not being usable currently due to IEMEXECMEM_ALT_SUB_ALLOC_UNIT_SIZE. */
     uint64_t                cbUnusable;
+    /** Allocations placed in the same large page as a TB they chain to. */
+    STAMCOUNTER             StatLocalityHits;
+    /** Allocations where there was no room near the TB they chain to. */
+    STAMCOUNTER             StatLocalityMisses;
 #endif
 
 
@@ -587,6 +640,72 @@ iemExecMemAllocatorAllocInChunk(PIEMEXECMEMALLOCATOR pExecMemAllocator, uint32_t
 }
 
 
+#ifdef IEMEXECMEM_ALT_SUB_WITH_ALLOC_HEADER
+/**
+ * Tries to allocate memory for @a pTb in the same large page as the code of a
+ * native TB it chains to.
+ *
+ * Keeping TBs that jump to each other together reduces the number of iTLB
+ * entries (and cache lines of the unwind/lookup paths) a hot loop spanning
+ * several TBs needs.  Only the first native TB found in the lookup table is
+ * considered, as this is on the allocation hot path.
+ *
+ * @returns Pointer to the readable/writeable memory, NULL if no suitable spot.
+ */
+static PIEMNATIVEINSTR
+iemExecMemAllocatorAllocNearChained(PIEMEXECMEMALLOCATOR pExecMemAllocator, uint32_t cbReq, PIEMTB pTb,
+                                    PIEMNATIVEINSTR *ppaExec, PCIEMNATIVEPERCHUNKCTX *ppChunkCtx)
+{
+    uint32_t const cLookupEntries = pTb->cTbLookupEntries;
+    for (uint32_t idxLookup = 0; idxLookup < cLookupEntries; idxLookup++)
+    {
+        PIEMTB const pTbNext = *IEMTB_GET_TB_LOOKUP_TAB_ENTRY(pTb, idxLookup);
+        if (   pTbNext
+            && pTbNext != pTb
+            && (pTbNext->fFlags & IEMTB_F_TYPE_MASK) == IEMTB_F_TYPE_NATIVE
+            && pTbNext->Native.paInstructions)
+        {
+            /*
+             * Locate the chunk and the large page of the TB we chain to.
+             * (The lookup entries may be stale, so validate the header.)
+             */
+            PIEMEXECMEMALLOCHDR const pHdr     = (PIEMEXECMEMALLOCHDR)pTbNext->Native.paInstructions - 1;
+            uint32_t const            idxChunk = pHdr->idxChunk;
+            if (   pHdr->uMagic != IEMEXECMEMALLOCHDR_MAGIC
+                || idxChunk >= pExecMemAllocator->cChunks)
+                return NULL;
+            uintptr_t const offChunk = (uintptr_t)pHdr - (uintptr_t)pExecMemAllocator->aChunks[idxChunk].pvChunkRx;
+            if (offChunk >= pExecMemAllocator->cbChunk)
+                return NULL;
+
+            uint32_t const cReqUnits = (cbReq + sizeof(IEMEXECMEMALLOCHDR) + IEMEXECMEM_ALT_SUB_ALLOC_UNIT_SIZE - 1)
+                                    >> IEMEXECMEM_ALT_SUB_ALLOC_UNIT_SHIFT;
+            if (cReqUnits <= pExecMemAllocator->aChunks[idxChunk].cFreeUnits)
+            {
+                uint32_t const cUnitsPerPage = RT_MIN(IEMEXECMEM_LARGE_PAGE_SIZE >> IEMEXECMEM_ALT_SUB_ALLOC_UNIT_SHIFT,
+                                                      pExecMemAllocator->cUnitsPerChunk);
+                uint32_t const idxFirst      = ((uint32_t)offChunk >> IEMEXECMEM_ALT_SUB_ALLOC_UNIT_SHIFT) & ~(cUnitsPerPage - 1);
+                uint64_t * const pbmAlloc    = &pExecMemAllocator->pbmAlloc[pExecMemAllocator->cBitmapElementsPerChunk * idxChunk];
+                void * const pvRet = iemExecMemAllocatorAllocInChunkInt(pExecMemAllocator, pbmAlloc, idxFirst, cUnitsPerPage,
+                                                                        cReqUnits, idxChunk, pTb, (void **)ppaExec, ppChunkCtx);
+                if (pvRet)
+                {
+# ifdef VBOX_WITH_STATISTICS
+                    pExecMemAllocator->cbUnusable += (cReqUnits << IEMEXECMEM_ALT_SUB_ALLOC_UNIT_SHIFT) - cbReq;
+# endif
+                    STAM_COUNTER_INC(&pExecMemAllocator->StatLocalityHits);
+                    return (PIEMNATIVEINSTR)pvRet;
+                }
+            }
+            STAM_COUNTER_INC(&pExecMemAllocator->StatLocalityMisses);
+            return NULL;
+        }
+    }
+    return NULL;
+}
+#endif /* IEMEXECMEM_ALT_SUB_WITH_ALLOC_HEADER */
+
+
 /**
  * Allocates @a cbReq bytes of executable memory.
  *
@@ -609,6 +728,21 @@ DECLHIDDEN(PIEMNATIVEINSTR) iemExecMemAllocatorAlloc(PVMCPU pVCpu, uint32_t cbRe
     AssertMsgReturn(cbReq > 32 && cbReq < _512K, ("%#x\n", cbReq), NULL);
     STAM_PROFILE_START(&pExecMemAllocator->StatAlloc, a);
 
+#ifdef IEMEXECMEM_ALT_SUB_WITH_ALLOC_HEADER
+    /*
+     * Try put it next to a TB it chains to first.
+     */
+    if (pTb && pTb->cTbLookupEntries > 0 && cbReq <= pExecMemAllocator->cbFree)
+    {
+        PIEMNATIVEINSTR const pRet = iemExecMemAllocatorAllocNearChained(pExecMemAllocator, cbReq, pTb, ppaExec, ppChunkCtx);
+        if (pRet)
+        {
+            STAM_PROFILE_STOP(&pExecMemAllocator->StatAlloc, a);
+            return pRet;
+        }
+    }
+#endif
+
     for (unsigned iIteration = 0;; iIteration++)
     {
         if (cbReq <= pExecMemAllocator->cbFree)
@@ -1443,6 +1577,58 @@ iemExecMemAllocatorInitAndRegisterUnwindInfoForChunk(PVMCPUCC pVCpu, PIEMEXECMEM
 #endif /* IN_RING3 */
 
 
+#ifdef IEMEXECMEM_WITH_LARGE_PAGES
+/**
+ * Tries to allocate a large page backed chunk.
+ *
+ * We first try hugetlbfs, which only works if the host admin has reserved
+ * pages for it, but then we are sure to get them.  Failing that, we create a
+ * large page aligned mapping and advise the kernel to back it with transparent
+ * huge pages.
+ *
+ * @returns Pointer to the read/write/exec chunk memory, NULL on failure.
+ * @param   cbChunk     The chunk size.
+ * @param   pbBacking   Where to return the IEMEXECMEMCHUNK_BACKING_XXX value.
+ */
+static void *iemExecMemAllocatorAllocLargePages(uint32_t cbChunk, uint8_t *pbBacking)
+{
+    if (cbChunk & (IEMEXECMEM_LARGE_PAGE_SIZE - 1))
+        return NULL;
+    int const fProt = PROT_READ | PROT_WRITE | PROT_EXEC;
+
+# ifdef MAP_HUGETLB
+    void *pvChunk = mmap(NULL, cbChunk, fProt, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | IEMEXECMEM_MAP_HUGE_2MB, -1, 0);
+    if (pvChunk != MAP_FAILED)
+    {
+        *pbBacking = IEMEXECMEMCHUNK_BACKING_HUGETLB;
+        return pvChunk;
+    }
+# endif
+
+    /* Over-allocate by one large page so we can align the chunk and trim the rest. */
+    size_t const    cbMapping = (size_t)cbChunk + IEMEXECMEM_LARGE_PAGE_SIZE;
+    uint8_t * const pbMapping = (uint8_t *)mmap(NULL, cbMapping, fProt, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if ((void *)pbMapping == MAP_FAILED)
+        return NULL;
+    uint8_t * const pbChunk = RT_ALIGN_PT(pbMapping, IEMEXECMEM_LARGE_PAGE_SIZE, uint8_t *);
+    size_t const    cbHead  = (size_t)(pbChunk - pbMapping);
+    size_t const    cbTail  = cbMapping - cbHead - cbChunk;
+    if (cbHead)
+        munmap(pbMapping, cbHead);
+    if (cbTail)
+        munmap(pbChunk + cbChunk, cbTail);
+
+# ifdef MADV_HUGEPAGE
+    if (madvise(pbChunk, cbChunk, MADV_HUGEPAGE) == 0)
+        *pbBacking = IEMEXECMEMCHUNK_BACKING_THP;
+    else
+# endif
+        *pbBacking = IEMEXECMEMCHUNK_BACKING_MMAP;
+    return pbChunk;
+}
+#endif /* IEMEXECMEM_WITH_LARGE_PAGES */
+
+
 /**
  * Adds another chunk to the executable memory allocator.
  *
@@ -1458,6 +1644,13 @@ static int iemExecMemAllocatorGrow(PVMCPUCC pVCpu, PIEMEXECMEMALLOCATOR pExecMem
     /* Allocate a chunk. */
 #ifdef RT_OS_DARWIN
     void *pvChunk = RTMemPageAllocEx(pExecMemAllocator->cbChunk, 0);
+#elif defined(IEMEXECMEM_WITH_LARGE_PAGES)
+    uint8_t bBacking = IEMEXECMEMCHUNK_BACKING_PAGE_ALLOC;
+    void   *pvChunk  = NULL;
+    if (pExecMemAllocator->fLargePages)
+        pvChunk = iemExecMemAllocatorAllocLargePages(pExecMemAllocator->cbChunk, &bBacking);
+    if (!pvChunk)
+        pvChunk = RTMemPageAllocEx(pExecMemAllocator->cbChunk, RTMEMPAGEALLOC_F_EXECUTABLE);
 #else
     void *pvChunk = RTMemPageAllocEx(pExecMemAllocator->cbChunk, RTMEMPAGEALLOC_F_EXECUTABLE);
 #endif
@@ -1517,6 +1710,9 @@ static int iemExecMemAllocatorGrow(PVMCPUCC pVCpu, PIEMEXECMEMALLOCATOR pExecMem
     pExecMemAllocator->aChunks[idxChunk].pvChunkRx    = pvChunkRx;
 #ifdef IN_RING3
     pExecMemAllocator->aChunks[idxChunk].pvUnwindInfo = NULL;
+#endif
+#ifdef IEMEXECMEM_WITH_LARGE_PAGES
+    pExecMemAllocator->aChunks[idxChunk].bBacking     = bBacking;
 #endif
     pExecMemAllocator->aChunks[idxChunk].cFreeUnits   = pExecMemAllocator->cUnitsPerChunk;
     pExecMemAllocator->aChunks[idxChunk].idxFreeHint  = 0;
@@ -1563,15 +1759,114 @@ static int iemExecMemAllocatorGrow(PVMCPUCC pVCpu, PIEMEXECMEMALLOCATOR pExecMem
         Assert(krc == KERN_SUCCESS);
 # endif
 
-        RTMemPageFree(pvChunk, pExecMemAllocator->cbChunk);
+# ifdef IEMEXECMEM_WITH_LARGE_PAGES
+        if (bBacking != IEMEXECMEMCHUNK_BACKING_PAGE_ALLOC)
+            munmap(pvChunk, pExecMemAllocator->cbChunk);
+        else
+# endif
+            RTMemPageFree(pvChunk, pExecMemAllocator->cbChunk);
         return rc;
     }
 #endif
 
+#ifdef IEMEXECMEM_WITH_LARGE_PAGES
+    if (bBacking == IEMEXECMEMCHUNK_BACKING_HUGETLB)
+        pExecMemAllocator->cChunksHugeTlb++;
+    else if (bBacking == IEMEXECMEMCHUNK_BACKING_THP)
+        pExecMemAllocator->cChunksThp++;
+    if (idxChunk == 0)
+        LogRel(("IEM: Executable memory chunk #0 (%#x bytes) at %p is backed by %s\n", pExecMemAllocator->cbChunk, pvChunk,
+                  bBacking == IEMEXECMEMCHUNK_BACKING_HUGETLB ? "hugetlbfs pages"
+                : bBacking == IEMEXECMEMCHUNK_BACKING_THP     ? "transparent huge pages"
+                :                                               "small pages"));
+#endif
+
     return VINF_SUCCESS;
 }
 
 
+#ifdef IN_RING3
+/**
+ * Gathers free space fragmentation figures for the statistics callbacks.
+ *
+ * @param   pExecMemAllocator   The allocator.
+ * @param   pcFreeExtents       Where to return the number of free extents.
+ * @param   pcbFree             Where to return the total free bytes.
+ * @param   pcbLargestFree      Where to return the size of the largest free
+ *                              extent in bytes.
+ */
+static void iemExecMemAllocatorQueryFragmentation(PIEMEXECMEMALLOCATOR pExecMemAllocator, uint32_t *pcFreeExtents,
+                                                  uint64_t *pcbFree, uint32_t *pcbLargestFree)
+{
+    uint32_t       cFreeExtents   = 0;
+    uint64_t       cFreeUnits     = 0;
+    uint32_t       cLargestUnits  = 0;
+    uint32_t const cUnitsPerChunk = pExecMemAllocator->cUnitsPerChunk;
+    uint32_t const cChunks        = pExecMemAllocator->cChunks;
+    for (uint32_t idxChunk = 0; idxChunk < cChunks; idxChunk++)
+    {
+        uint64_t * const pbmAlloc = &pExecMemAllocator->pbmAlloc[pExecMemAllocator->cBitmapElementsPerChunk * idxChunk];
+        int iBit = ASMBitFirstClear(pbmAlloc, cUnitsPerChunk);
+        while (iBit >= 0)
+        {
+            int const      iBitEnd = ASMBitNextSet(pbmAlloc, cUnitsPerChunk, (uint32_t)iBit);
+            uint32_t const cUnits  = (iBitEnd >= 0 ? (uint32_t)iBitEnd : cUnitsPerChunk) - (uint32_t)iBit;
+            cFreeExtents += 1;
+            cFreeUnits   += cUnits;
+            if (cUnits > cLargestUnits)
+                cLargestUnits = cUnits;
+            if (iBitEnd < 0)
+                break;
+            iBit = ASMBitNextClear(pbmAlloc, cUnitsPerChunk, (uint32_t)iBitEnd);
+        }
+    }
+    *pcFreeExtents  = cFreeExtents;
+    *pcbFree        = cFreeUnits << IEMEXECMEM_ALT_SUB_ALLOC_UNIT_SHIFT;
+    *pcbLargestFree = cLargestUnits << IEMEXECMEM_ALT_SUB_ALLOC_UNIT_SHIFT;
+}
+
+
+/**
+ * @callback_method_impl{FNSTAMR3CALLBACKPRINT, Number of free extents.}
+ */
+static DECLCALLBACK(void) iemExecMemAllocatorStatsPrintFreeExtents(PVM pVM, void *pvSample, char *pszBuf, size_t cchBuf)
+{
+    uint32_t cFreeExtents, cbLargestFree;
+    uint64_t cbFree;
+    iemExecMemAllocatorQueryFragmentation((PIEMEXECMEMALLOCATOR)pvSample, &cFreeExtents, &cbFree, &cbLargestFree);
+    RTStrPrintf(pszBuf, cchBuf, "%u", cFreeExtents);
+    RT_NOREF(pVM);
+}
+
+
+/**
+ * @callback_method_impl{FNSTAMR3CALLBACKPRINT, Size of the largest free extent.}
+ */
+static DECLCALLBACK(void) iemExecMemAllocatorStatsPrintLargestFree(PVM pVM, void *pvSample, char *pszBuf, size_t cchBuf)
+{
+    uint32_t cFreeExtents, cbLargestFree;
+    uint64_t cbFree;
+    iemExecMemAllocatorQueryFragmentation((PIEMEXECMEMALLOCATOR)pvSample, &cFreeExtents, &cbFree, &cbLargestFree);
+    RTStrPrintf(pszBuf, cchBuf, "%u", cbLargestFree);
+    RT_NOREF(pVM);
+}
+
+
+/**
+ * @callback_method_impl{FNSTAMR3CALLBACKPRINT,
+ *      Percentage of the free memory not in the largest free extent.}
+ */
+static DECLCALLBACK(void) iemExecMemAllocatorStatsPrintFragmentation(PVM pVM, void *pvSample, char *pszBuf, size_t cchBuf)
+{
+    uint32_t cFreeExtents, cbLargestFree;
+    uint64_t cbFree;
+    iemExecMemAllocatorQueryFragmentation((PIEMEXECMEMALLOCATOR)pvSample, &cFreeExtents, &cbFree, &cbLargestFree);
+    RTStrPrintf(pszBuf, cchBuf, "%u", cbFree ? (uint32_t)(100 - cbLargestFree * UINT64_C(100) / cbFree) : 0);
+    RT_NOREF(pVM);
+}
+#endif /* IN_RING3 */
+
+
 /**
  * Initializes the executable memory allocator for native recompilation on the
  * calling EMT.
@@ -1583,8 +1878,9 @@ static int iemExecMemAllocatorGrow(PVMCPUCC pVCpu, PIEMEXECMEMALLOCATOR pExecMem
  * @param   cbInitial   The initial allocator size.
  * @param   cbChunk     The chunk size, 0 or UINT32_MAX for default (@a cbMax
  *                      dependent).
+ * @param   fLargePages Whether to try back the chunks with large pages.
  */
-int iemExecMemAllocatorInit(PVMCPU pVCpu, uint64_t cbMax, uint64_t cbInitial, uint32_t cbChunk) RT_NOEXCEPT
+int iemExecMemAllocatorInit(PVMCPU pVCpu, uint64_t cbMax, uint64_t cbInitial, uint32_t cbChunk, bool fLargePages) RT_NOEXCEPT
 {
     /*
      * Validate input.
@@ -1659,6 +1955,11 @@ int iemExecMemAllocatorInit(PVMCPU pVCpu, uint64_t cbMax, uint64_t cbInitial, ui
     pExecMemAllocator->cbAllocated  = 0;
 #ifdef VBOX_WITH_STATISTICS
     pExecMemAllocator->cbUnusable   = 0;
+#endif
+#ifdef IEMEXECMEM_WITH_LARGE_PAGES
+    pExecMemAllocator->fLargePages  = fLargePages;
+#else
+    RT_NOREF(fLargePages);
 #endif
     pExecMemAllocator->pbmAlloc                 = (uint64_t *)((uintptr_t)pExecMemAllocator + offBitmaps);
     pExecMemAllocator->cUnitsPerChunk           = cbChunk >> IEMEXECMEM_ALT_SUB_ALLOC_UNIT_SHIFT;
@@ -1709,11 +2010,33 @@ int iemExecMemAllocatorInit(PVMCPU pVCpu, uint64_t cbMax, uint64_t cbInitial, ui
                      "Number of bytes current free",            "/IEM/CPU%u/re/ExecMem/cbFree", pVCpu->idCpu);
     STAMR3RegisterFU(pUVM, &pExecMemAllocator->cbTotal,         STAMTYPE_U64, STAMVISIBILITY_ALWAYS, STAMUNIT_BYTES,
                      "Total number of byte",                    "/IEM/CPU%u/re/ExecMem/cbTotal", pVCpu->idCpu);
+#ifdef IEMEXECMEM_WITH_LARGE_PAGES
+    STAMR3RegisterFU(pUVM, &pExecMemAllocator->cChunksHugeTlb,  STAMTYPE_U32, STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,
+                     "Chunks backed by hugetlbfs pages",        "/IEM/CPU%u/re/ExecMem/cChunksHugeTlb", pVCpu->idCpu);
+    STAMR3RegisterFU(pUVM, &pExecMemAllocator->cChunksThp,      STAMTYPE_U32, STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,
+                     "Chunks backed by transparent huge pages", "/IEM/CPU%u/re/ExecMem/cChunksThp", pVCpu->idCpu);
+#endif
+#ifdef IN_RING3
+    PVM const pVM = pVCpu->CTX_SUFF(pVM);
+    STAMR3RegisterCallback(pVM, pExecMemAllocator, STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,
+                           NULL, iemExecMemAllocatorStatsPrintFreeExtents,
+                           "Number of free extents",                 "/IEM/CPU%u/re/ExecMem/Frag/cFreeExtents", pVCpu->idCpu);
+    STAMR3RegisterCallback(pVM, pExecMemAllocator, STAMVISIBILITY_ALWAYS, STAMUNIT_BYTES,
+                           NULL, iemExecMemAllocatorStatsPrintLargestFree,
+                           "Size of the largest free extent",        "/IEM/CPU%u/re/ExecMem/Frag/cbLargestFree", pVCpu->idCpu);
+    STAMR3RegisterCallback(pVM, pExecMemAllocator, STAMVISIBILITY_ALWAYS, STAMUNIT_PCT,
+                           NULL, iemExecMemAllocatorStatsPrintFragmentation,
+                           "Free memory outside the largest free extent", "/IEM/CPU%u/re/ExecMem/Frag/Pct", pVCpu->idCpu);
+#endif
 #ifdef VBOX_WITH_STATISTICS
     STAMR3RegisterFU(pUVM, &pExecMemAllocator->cbUnusable,      STAMTYPE_U64, STAMVISIBILITY_ALWAYS, STAMUNIT_BYTES,
                      "Total number of bytes being unusable",    "/IEM/CPU%u/re/ExecMem/cbUnusable", pVCpu->idCpu);
     STAMR3RegisterFU(pUVM, &pExecMemAllocator->StatAlloc,       STAMTYPE_PROFILE, STAMVISIBILITY_ALWAYS, STAMUNIT_TICKS_PER_CALL,
                      "Profiling the allocator",                 "/IEM/CPU%u/re/ExecMem/ProfAlloc", pVCpu->idCpu);
+    STAMR3RegisterFU(pUVM, &pExecMemAllocator->StatLocalityHits, STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,
+                     "Allocations placed next to a TB they chain to", "/IEM/CPU%u/re/ExecMem/LocalityHits", pVCpu->idCpu);
+    STAMR3RegisterFU(pUVM, &pExecMemAllocator->StatLocalityMisses, STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,
+                     "No room next to the TB chained to",       "/IEM/CPU%u/re/ExecMem/LocalityMisses", pVCpu->idCpu);
 #endif
 #ifdef IEMEXECMEM_ALT_SUB_WITH_ALT_PRUNING
     STAMR3RegisterFU(pUVM, &pExecMemAllocator->StatPruneProf,   STAMTYPE_PROFILE, STAMVISIBILITY_ALWAYS, STAMUNIT_TICKS_PER_CALL,
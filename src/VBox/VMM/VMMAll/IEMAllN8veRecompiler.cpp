@@ -59,8 +59,12 @@
 #include <VBox/dis.h>
 #include <VBox/param.h>
 #include <iprt/assert.h>
+#include <iprt/critsect.h>
 #include <iprt/mem.h>
+#include <iprt/semaphore.h>
 #include <iprt/string.h>
+#include <iprt/thread.h>
+#include <iprt/time.h>
 #if   defined(RT_ARCH_AMD64)
 # include <iprt/x86.h>
 #elif defined(RT_ARCH_ARM64)
@@ -2231,12 +2235,10 @@ static void iemNativeTerm(PIEMRECOMPILERSTATE pReNative)
  * @param   pTb     The TB that's about to be recompiled.  When this is NULL,
  *                  the recompiler state is for emitting the common per-chunk
  *                  code from iemNativeRecompileAttachExecMemChunkCtx.
- * @thread  EMT(pVCpu)
+ * @thread  EMT(pVCpu) or a background recompiler thread (iemNativeBgThread).
  */
 static PIEMRECOMPILERSTATE iemNativeInit(PVMCPUCC pVCpu, PCIEMTB pTb)
 {
-    VMCPU_ASSERT_EMT(pVCpu);
-
     PIEMRECOMPILERSTATE pReNative = (PIEMRECOMPILERSTATE)RTMemAllocZ(sizeof(*pReNative));
     AssertReturn(pReNative, NULL);
 
@@ -3158,7 +3160,7 @@ DECL_HIDDEN_THROW(uint32_t) iemNativeRegFlushDirtyGuestByHostRegShadow(PIEMRECOM
 static uint8_t iemNativeRegAllocFindFree(PIEMRECOMPILERSTATE pReNative, uint32_t *poff, bool fPreferVolatile,
                                          uint32_t fRegMask = IEMNATIVE_HST_GREG_MASK & ~IEMNATIVE_REG_FIXED_MASK)
 {
-    STAM_COUNTER_INC(&pReNative->pVCpu->iem.s.StatNativeRegFindFree);
+    IEMNATIVE_STAM_COUNTER_INC(&pReNative->pVCpu->iem.s.StatNativeRegFindFree);
     Assert(!(fRegMask & ~IEMNATIVE_HST_GREG_MASK));
     Assert(!(fRegMask & IEMNATIVE_REG_FIXED_MASK));
 
@@ -3168,7 +3170,7 @@ static uint8_t iemNativeRegAllocFindFree(PIEMRECOMPILERSTATE pReNative, uint32_t
     uint32_t fRegs = ~pReNative->Core.bmHstRegs & fRegMask;
     if (fRegs)
     {
-        STAM_COUNTER_INC(&pReNative->pVCpu->iem.s.StatNativeRegFindFreeNoVar);
+        IEMNATIVE_STAM_COUNTER_INC(&pReNative->pVCpu->iem.s.StatNativeRegFindFreeNoVar);
 
 #ifdef IEMNATIVE_WITH_LIVENESS_ANALYSIS
         /*
@@ -3213,7 +3215,7 @@ static uint8_t iemNativeRegAllocFindFree(PIEMRECOMPILERSTATE pReNative, uint32_t
                 *poff = iemNativeRegFlushDirtyGuest(pReNative, *poff, fToFreeMask);
 #endif
 
-                STAM_COUNTER_INC(&pReNative->pVCpu->iem.s.StatNativeRegFindFreeLivenessUnshadowed);
+                IEMNATIVE_STAM_COUNTER_INC(&pReNative->pVCpu->iem.s.StatNativeRegFindFreeLivenessUnshadowed);
                 iemNativeRegFlushGuestShadows(pReNative, fToFreeMask);
                 Assert(fRegs == (~pReNative->Core.bmHstRegs & fRegMask)); /* this shall not change. */
 
@@ -3221,7 +3223,7 @@ static uint8_t iemNativeRegAllocFindFree(PIEMRECOMPILERSTATE pReNative, uint32_t
                 uint32_t const fUnshadowedRegs = fRegs & ~pReNative->Core.bmHstRegsWithGstShadow;
                 if (fUnshadowedRegs)
                 {
-                    STAM_COUNTER_INC(&pReNative->pVCpu->iem.s.StatNativeRegFindFreeLivenessHelped);
+                    IEMNATIVE_STAM_COUNTER_INC(&pReNative->pVCpu->iem.s.StatNativeRegFindFreeLivenessHelped);
                     return (fPreferVolatile
                             ? ASMBitFirstSetU32(fUnshadowedRegs)
                             : ASMBitLastSetU32(  fUnshadowedRegs & ~IEMNATIVE_CALL_VOLATILE_GREG_MASK
@@ -3260,7 +3262,7 @@ static uint8_t iemNativeRegAllocFindFree(PIEMRECOMPILERSTATE pReNative, uint32_t
      * We do two rounds here, first evacuating variables we don't need to be
      * saved on the stack, then in the second round move things to the stack.
      */
-    STAM_REL_COUNTER_INC(&pReNative->pVCpu->iem.s.StatNativeRegFindFreeVar);
+    IEMNATIVE_STAM_REL_COUNTER_INC(&pReNative->pVCpu->iem.s.StatNativeRegFindFreeVar);
     for (uint32_t iLoop = 0; iLoop < 2; iLoop++)
     {
         uint32_t fVars = pReNative->Core.bmVars;
@@ -4916,7 +4918,7 @@ DECL_HIDDEN_THROW(uint32_t) iemNativeSimdRegFlushDirtyGuestByHostSimdRegShadow(P
 static uint8_t iemNativeSimdRegAllocFindFree(PIEMRECOMPILERSTATE pReNative, uint32_t *poff, bool fPreferVolatile,
                                              uint32_t fRegMask = IEMNATIVE_HST_SIMD_REG_MASK & ~IEMNATIVE_SIMD_REG_FIXED_MASK)
 {
-    STAM_COUNTER_INC(&pReNative->pVCpu->iem.s.StatNativeSimdRegFindFree);
+    IEMNATIVE_STAM_COUNTER_INC(&pReNative->pVCpu->iem.s.StatNativeSimdRegFindFree);
     Assert(!(fRegMask & ~IEMNATIVE_HST_SIMD_REG_MASK));
     Assert(!(fRegMask & IEMNATIVE_SIMD_REG_FIXED_MASK));
 
@@ -4926,7 +4928,7 @@ static uint8_t iemNativeSimdRegAllocFindFree(PIEMRECOMPILERSTATE pReNative, uint
     uint32_t fRegs = ~pReNative->Core.bmHstSimdRegs & fRegMask;
     if (fRegs)
     {
-        STAM_COUNTER_INC(&pReNative->pVCpu->iem.s.StatNativeSimdRegFindFreeNoVar);
+        IEMNATIVE_STAM_COUNTER_INC(&pReNative->pVCpu->iem.s.StatNativeSimdRegFindFreeNoVar);
 
 #if 0 /** @todo def IEMNATIVE_WITH_LIVENESS_ANALYSIS */
         /*
@@ -4959,7 +4961,7 @@ static uint8_t iemNativeSimdRegAllocFindFree(PIEMRECOMPILERSTATE pReNative, uint
             /* If it matches any shadowed registers. */
             if (pReNative->Core.bmGstRegShadows & fToFreeMask)
             {
-                STAM_COUNTER_INC(&pReNative->pVCpu->iem.s.StatNativeSimdRegFindFreeLivenessUnshadowed);
+                IEMNATIVE_STAM_COUNTER_INC(&pReNative->pVCpu->iem.s.StatNativeSimdRegFindFreeLivenessUnshadowed);
                 iemNativeRegFlushGuestShadows(pReNative, fToFreeMask);
                 Assert(fRegs == (~pReNative->Core.bmHstRegs & fRegMask)); /* this shall not change. */
 
@@ -4967,7 +4969,7 @@ static uint8_t iemNativeSimdRegAllocFindFree(PIEMRECOMPILERSTATE pReNative, uint
                 uint32_t const fUnshadowedRegs = fRegs & ~pReNative->Core.bmHstRegsWithGstShadow;
                 if (fUnshadowedRegs)
                 {
-                    STAM_COUNTER_INC(&pReNative->pVCpu->iem.s.StatNativeSimdRegFindFreeLivenessHelped);
+                    IEMNATIVE_STAM_COUNTER_INC(&pReNative->pVCpu->iem.s.StatNativeSimdRegFindFreeLivenessHelped);
                     return (fPreferVolatile
                             ? ASMBitFirstSetU32(fUnshadowedRegs)
                             : ASMBitLastSetU32(  fUnshadowedRegs & ~IEMNATIVE_CALL_VOLATILE_GREG_MASK
@@ -5007,7 +5009,7 @@ static uint8_t iemNativeSimdRegAllocFindFree(PIEMRECOMPILERSTATE pReNative, uint
      * We do two rounds here, first evacuating variables we don't need to be
      * saved on the stack, then in the second round move things to the stack.
      */
-    STAM_REL_COUNTER_INC(&pReNative->pVCpu->iem.s.StatNativeSimdRegFindFreeVar);
+    IEMNATIVE_STAM_REL_COUNTER_INC(&pReNative->pVCpu->iem.s.StatNativeSimdRegFindFreeVar);
     for (uint32_t iLoop = 0; iLoop < 2; iLoop++)
     {
         uint32_t fVars = pReNative->Core.bmVars;
@@ -5777,7 +5779,7 @@ DECL_HIDDEN_THROW(uint32_t) iemNativeEmitPcWritebackSlow(PIEMRECOMPILERSTATE pRe
     Log4(("iemNativeEmitPcWritebackSlow: offPc=%#RX64 -> 0; off=%#x; idxInstr=%u cInstrsSkipped=%u\n",
           pReNative->Core.offPc, off, idxInstr, cInstrsSkipped));
 
-    STAM_COUNTER_ADD(&pReNative->pVCpu->iem.s.StatNativePcUpdateDelayed, cInstrsSkipped);
+    IEMNATIVE_STAM_COUNTER_ADD(&pReNative->pVCpu->iem.s.StatNativePcUpdateDelayed, cInstrsSkipped);
 
 #  ifdef IEMNATIVE_WITH_TB_DEBUG_INFO
     iemNativeDbgInfoAddNativeOffset(pReNative, off);
@@ -9935,35 +9937,20 @@ DECLHIDDEN(PCIEMNATIVEPERCHUNKCTX) iemNativeRecompileAttachExecMemChunkCtx(PVMCP
 #endif /* IEMNATIVE_WITH_RECOMPILER_PER_CHUNK_TAIL_CODE */
 
 /**
- * Recompiles the given threaded TB into a native one.
+ * Recompiler phase 1: Liveness analysis and code emitting.
  *
- * In case of failure the translation block will be returned as-is.
+ * This only works on the recompiler state and the (read-only) threaded calls
+ * of the TB, so it can be done by a background recompiler thread.  The
+ * per-VCPU statistics it updates via IEMRECOMPILERSTATE::pVCpu must therefore
+ * use the atomic IEMNATIVE_STAM_XXX macros.
  *
- * @returns pTb.
- * @param   pVCpu   The cross context virtual CPU structure of the calling
- *                  thread.
- * @param   pTb     The threaded translation to recompile to native.
+ * @returns Number of native instructions emitted, UINT32_MAX on failure.
+ * @param   pReNative   The native recompiler state (initialized for @a pTb).
+ * @param   pTb         The threaded translation to recompile to native.
  */
-DECLHIDDEN(PIEMTB) iemNativeRecompile(PVMCPUCC pVCpu, PIEMTB pTb) RT_NOEXCEPT
+static uint32_t iemNativeRecompileBody(PIEMRECOMPILERSTATE pReNative, PCIEMTB pTb) RT_NOEXCEPT
 {
-#if 0 /* For profiling the native recompiler code. */
-l_profile_again:
-#endif
-    STAM_REL_PROFILE_START(&pVCpu->iem.s.StatNativeRecompilation, a);
-
-    /*
-     * The first time thru, we allocate the recompiler state and save it,
-     * all the other times we'll just reuse the saved one after a quick reset.
-     */
-    PIEMRECOMPILERSTATE pReNative = pVCpu->iem.s.pNativeRecompilerStateR3;
-    if (RT_LIKELY(pReNative))
-        iemNativeReInit(pReNative, pTb);
-    else
-    {
-        pReNative = iemNativeInit(pVCpu, pTb);
-        AssertReturn(pReNative, pTb);
-        pVCpu->iem.s.pNativeRecompilerStateR3 = pReNative; /* save it */
-    }
+    PVMCPUCC const pVCpu = pReNative->pVCpu;
 
 #ifdef IEMNATIVE_WITH_LIVENESS_ANALYSIS
     /*
@@ -9979,11 +9966,11 @@ l_profile_again:
             while (idxCall > cAlloc)
                 cAlloc *= 2;
             void *pvNew = RTMemRealloc(pReNative->paLivenessEntries, sizeof(pReNative->paLivenessEntries[0]) * cAlloc);
-            AssertReturn(pvNew, pTb);
+            AssertReturn(pvNew, UINT32_MAX);
             pReNative->paLivenessEntries     = (PIEMLIVENESSENTRY)pvNew;
             pReNative->cLivenessEntriesAlloc = cAlloc;
         }
-        AssertReturn(idxCall > 0, pTb);
+        AssertReturn(idxCall > 0, UINT32_MAX);
         PIEMLIVENESSENTRY const paLivenessEntries = pReNative->paLivenessEntries;
 
         /* The initial (final) entry. */
@@ -10016,9 +10003,6 @@ l_profile_again:
      * for aborting if an error happens.
      */
     uint32_t        cCallsLeft = pTb->Thrd.cCalls;
-#ifdef LOG_ENABLED
-    uint32_t const  cCallsOrg  = cCallsLeft;
-#endif
     uint32_t        off        = 0;
     int             rc         = VINF_SUCCESS;
     IEMNATIVE_TRY_SETJMP(pReNative, rc)
@@ -10167,10 +10151,10 @@ l_profile_again:
 #endif
         }
 
-        STAM_REL_PROFILE_ADD_PERIOD(&pVCpu->iem.s.StatNativeCallsRecompiled, cRecompiledCalls);
-        STAM_REL_PROFILE_ADD_PERIOD(&pVCpu->iem.s.StatNativeCallsThreaded,   cThreadedCalls);
+        IEMNATIVE_STAM_REL_PROFILE_ADD_PERIOD(&pVCpu->iem.s.StatNativeCallsRecompiled, cRecompiledCalls);
+        IEMNATIVE_STAM_REL_PROFILE_ADD_PERIOD(&pVCpu->iem.s.StatNativeCallsThreaded,   cThreadedCalls);
         if (!cThreadedCalls)
-            STAM_REL_COUNTER_INC(&pVCpu->iem.s.StatNativeFullyRecompiledTbs);
+            IEMNATIVE_STAM_REL_COUNTER_INC(&pVCpu->iem.s.StatNativeFullyRecompiledTbs);
 
 #ifdef VBOX_WITH_STATISTICS
         off = iemNativeEmitNativeTbExitStats(pReNative, off, RT_UOFFSETOF(VMCPUCC, iem.s.StatNativeTbFinished));
@@ -10310,7 +10294,7 @@ l_profile_again:
     IEMNATIVE_CATCH_LONGJMP_BEGIN(pReNative, rc);
     {
         Log(("iemNativeRecompile: Caught %Rrc while recompiling!\n", rc));
-        return pTb;
+        return UINT32_MAX;
     }
     IEMNATIVE_CATCH_LONGJMP_END(pReNative);
     Assert(off <= pReNative->cInstrBufAlloc);
@@ -10318,24 +10302,38 @@ l_profile_again:
     /*
      * Make sure all labels has been defined.
      */
-    PIEMNATIVELABEL const paLabels = pReNative->paLabels;
 #ifdef VBOX_STRICT
+    PIEMNATIVELABEL const paLabels = pReNative->paLabels;
     uint32_t const        cLabels  = pReNative->cLabels;
     for (uint32_t i = 0; i < cLabels; i++)
-        AssertMsgReturn(paLabels[i].off < off, ("i=%d enmType=%d\n", i, paLabels[i].enmType), pTb);
+        AssertMsgReturn(paLabels[i].off < off, ("i=%d enmType=%d\n", i, paLabels[i].enmType), UINT32_MAX);
 #endif
+    return off;
+}
 
-#if 0 /* For profiling the native recompiler code. */
-    if (pTb->Thrd.cCalls >= 136)
-    {
-        STAM_REL_PROFILE_STOP(&pVCpu->iem.s.StatNativeRecompilation, a);
-        goto l_profile_again;
-    }
-#endif
 
+/**
+ * Recompiler phase 2: Installs the code emitted by iemNativeRecompileBody.
+ *
+ * This allocates executable memory, copies over the code, applies the fixups
+ * and converts the translation block to native.  In case of failure the
+ * translation block is left as-is.
+ *
+ * @param   pVCpu       The cross context virtual CPU structure of the calling
+ *                      thread.
+ * @param   pReNative   The native recompiler state holding the emitted code.
+ * @param   pTb         The threaded translation to convert.
+ * @param   off         The number of native instructions emitted.
+ * @thread  EMT(pVCpu)
+ */
+static void iemNativeRecompileInstall(PVMCPUCC pVCpu, PIEMRECOMPILERSTATE pReNative, PIEMTB pTb, uint32_t off) RT_NOEXCEPT
+{
     /*
      * Allocate executable memory, copy over the code we've generated.
      */
+#ifdef LOG_ENABLED
+    uint32_t const        cCallsOrg    = pTb->Thrd.cCalls;
+#endif
     PIEMTBALLOCATOR const pTbAllocator = pVCpu->iem.s.pTbAllocatorR3;
     if (pTbAllocator->pDelayedFreeHead)
         iemTbAllocatorProcessDelayedFrees(pVCpu, pVCpu->iem.s.pTbAllocatorR3);
@@ -10350,12 +10348,16 @@ l_profile_again:
     PIEMNATIVEINSTR const paFinalInstrBuf   = iemExecMemAllocatorAlloc(pVCpu, off * sizeof(IEMNATIVEINSTR), pTb,
                                                                        &paFinalInstrBufRx, NULL);
 #endif
-    AssertReturn(paFinalInstrBuf, pTb);
+    AssertReturnVoid(paFinalInstrBuf);
     memcpy(paFinalInstrBuf, pReNative->pInstrBuf, off * sizeof(paFinalInstrBuf[0]));
 
     /*
      * Apply fixups.
      */
+    PIEMNATIVELABEL const paLabels   = pReNative->paLabels;
+#ifdef VBOX_STRICT
+    uint32_t const        cLabels    = pReNative->cLabels;
+#endif
     PIEMNATIVEFIXUP const paFixups   = pReNative->paFixups;
     uint32_t const        cFixups    = pReNative->cFixups;
     for (uint32_t i = 0; i < cFixups; i++)
@@ -10474,8 +10476,505 @@ l_profile_again:
     }
 #endif
     /*iemNativeDisassembleTb(pTb, DBGFR3InfoLogRelHlp());*/
+}
+
+
+/**
+ * Recompiles the given threaded TB into a native one.
+ *
+ * In case of failure the translation block will be returned as-is.
+ *
+ * @returns pTb.
+ * @param   pVCpu   The cross context virtual CPU structure of the calling
+ *                  thread.
+ * @param   pTb     The threaded translation to recompile to native.
+ */
+DECLHIDDEN(PIEMTB) iemNativeRecompile(PVMCPUCC pVCpu, PIEMTB pTb) RT_NOEXCEPT
+{
+#if 0 /* For profiling the native recompiler code. */
+l_profile_again:
+#endif
+    STAM_REL_PROFILE_START(&pVCpu->iem.s.StatNativeRecompilation, a);
+
+    /*
+     * The first time thru, we allocate the recompiler state and save it,
+     * all the other times we'll just reuse the saved one after a quick reset.
+     */
+    PIEMRECOMPILERSTATE pReNative = pVCpu->iem.s.pNativeRecompilerStateR3;
+    if (RT_LIKELY(pReNative))
+        iemNativeReInit(pReNative, pTb);
+    else
+    {
+        pReNative = iemNativeInit(pVCpu, pTb);
+        AssertReturn(pReNative, pTb);
+        pVCpu->iem.s.pNativeRecompilerStateR3 = pReNative; /* save it */
+    }
+
+    uint32_t const off = iemNativeRecompileBody(pReNative, pTb);
+    if (off != UINT32_MAX)
+    {
+#if 0 /* For profiling the native recompiler code. */
+        if (pTb->Thrd.cCalls >= 136)
+        {
+            STAM_REL_PROFILE_STOP(&pVCpu->iem.s.StatNativeRecompilation, a);
+            goto l_profile_again;
+        }
+#endif
+
+        iemNativeRecompileInstall(pVCpu, pReNative, pTb, off);
+    }
 
     STAM_REL_PROFILE_STOP(&pVCpu->iem.s.StatNativeRecompilation, a);
     return pTb;
 }
 
+
+
+
+/*********************************************************************************************************************************
+*   Background Recompilation                                                                                                     *
+*********************************************************************************************************************************/
+
+/** Max number of background recompiler threads. */
+#define IEMNATIVEBG_MAX_THREADS     16
+/** Max number of background recompile jobs (queued, in progress or waiting
+ *  to be installed) at any one time. */
+#define IEMNATIVEBG_MAX_JOBS        32
+
+/** Background recompile job state. */
+typedef enum IEMNATIVEBGJOBSTATE
+{
+    kIemNativeBgJobState_Free = 0,
+    kIemNativeBgJobState_Queued,
+    kIemNativeBgJobState_Running,
+    kIemNativeBgJobState_Done
+} IEMNATIVEBGJOBSTATE;
+
+/**
+ * Background recompile job.
+ */
+typedef struct IEMNATIVEBGJOB
+{
+    /** Next job on the free list, the work queue or the done list. */
+    struct IEMNATIVEBGJOB  *pNext;
+    /** The EMT owning the TB. */
+    PVMCPUCC                pVCpu;
+    /** The threaded TB to recompile.  NULL if cancelled (iemNativeBgCancel). */
+    PIEMTB                  pTb;
+    /** The recompiler state holding the emitted code when done. */
+    PIEMRECOMPILERSTATE     pReNative;
+    /** RTTimeNanoTS() when the job was queued. */
+    uint64_t                nsQueued;
+    /** TSC ticks spent recompiling on the worker thread (for
+     *  IEMCPU::StatNativeBgRecompilation, added by the EMT when installing). */
+    uint64_t                cTicksCompile;
+    /** Number of native instructions emitted, UINT32_MAX on failure. */
+    uint32_t                off;
+    /** The job state. */
+    IEMNATIVEBGJOBSTATE     enmState;
+    /** Set by iemNativeBgCancel when it is waiting on hEvtDone for the worker
+     *  to finish with the job. */
+    bool                    fCancelWaiter;
+    /** Signalled by the worker when it's done with a job if fCancelWaiter is
+     *  set.  Only the owning EMT ever waits on it. */
+    RTSEMEVENT              hEvtDone;
+} IEMNATIVEBGJOB;
+/** Pointer to a background recompile job. */
+typedef IEMNATIVEBGJOB *PIEMNATIVEBGJOB;
+
+/**
+ * The background recompiler thread pool (one per VM).
+ *
+ * All the lists, the job states and the IEMCPU::pNativeBgDoneR3 lists are
+ * protected by the critical section.  The actual recompilation is done
+ * outside it.
+ */
+typedef struct IEMNATIVEBGPOOL
+{
+    /** Lock protecting the pool and job lists. */
+    RTCRITSECT              CritSect;
+    /** Event the worker threads wait on for new work. */
+    RTSEMEVENT              hEvtWork;
+    /** Set when the workers should terminate. */
+    bool volatile           fTerminate;
+    /** Number of worker threads. */
+    uint32_t                cThreads;
+    /** Work queue head (oldest). */
+    PIEMNATIVEBGJOB         pQueueHead;
+    /** Work queue tail (newest). */
+    PIEMNATIVEBGJOB         pQueueTail;
+    /** Free jobs. */
+    PIEMNATIVEBGJOB         pFreeHead;
+    /** Number of recompiler states in apFreeStates. */
+    uint32_t                cFreeStates;
+    /** Recompiler states available for reuse by the workers. */
+    PIEMRECOMPILERSTATE     apFreeStates[IEMNATIVEBG_MAX_JOBS];
+    /** The jobs. */
+    IEMNATIVEBGJOB          aJobs[IEMNATIVEBG_MAX_JOBS];
+    /** The worker threads. */
+    RTTHREAD                ahThreads[IEMNATIVEBG_MAX_THREADS];
+} IEMNATIVEBGPOOL;
+/** Pointer to the background recompiler thread pool. */
+typedef IEMNATIVEBGPOOL *PIEMNATIVEBGPOOL;
+
+
+/**
+ * @callback_method_impl{FNRTTHREAD, Background recompiler worker thread.}
+ */
+static DECLCALLBACK(int) iemNativeBgThread(RTTHREAD hThreadSelf, void *pvUser)
+{
+    PIEMNATIVEBGPOOL const pPool = (PIEMNATIVEBGPOOL)pvUser;
+    RT_NOREF(hThreadSelf);
+
+    while (!ASMAtomicReadBool(&pPool->fTerminate))
+    {
+        /*
+         * Grab the next job that hasn't been cancelled, along with a
+         * recompiler state if there is one to reuse.
+         */
+        PIEMRECOMPILERSTATE pReNative = NULL;
+        RTCritSectEnter(&pPool->CritSect);
+        PIEMNATIVEBGJOB pJob;
+        while ((pJob = pPool->pQueueHead) != NULL)
+        {
+            pPool->pQueueHead = pJob->pNext;
+            if (!pPool->pQueueHead)
+                pPool->pQueueTail = NULL;
+            if (pJob->pTb)
+                break;
+            pJob->enmState  = kIemNativeBgJobState_Free;
+            pJob->pNext     = pPool->pFreeHead;
+            pPool->pFreeHead = pJob;
+        }
+        if (pJob)
+        {
+            pJob->enmState = kIemNativeBgJobState_Running;
+            if (pPool->cFreeStates > 0)
+                pReNative = pPool->apFreeStates[--pPool->cFreeStates];
+        }
+        RTCritSectLeave(&pPool->CritSect);
+
+        if (!pJob)
+        {
+            RTSemEventWait(pPool->hEvtWork, RT_INDEFINITE_WAIT);
+            continue;
+        }
+
+        /*
+         * Do the liveness analysis and code emitting.  The TB cannot be freed
+         * while we're at it, iemNativeBgCancel waits for us to finish.
+         */
+        PVMCPUCC const pVCpu     = pJob->pVCpu;
+        PIEMTB const   pTb       = pJob->pTb;
+        uint64_t const uTscStart = ASMReadTSC();
+        if (pReNative)
+        {
+            pReNative->pVCpu = pVCpu;
+            iemNativeReInit(pReNative, pTb);
+        }
+        else
+            pReNative = iemNativeInit(pVCpu, pTb);
+        uint32_t const off = pReNative ? iemNativeRecompileBody(pReNative, pTb) : UINT32_MAX;
+        uint64_t const cTicksCompile = ASMReadTSC() - uTscStart;
+
+        /*
+         * Hand it over to the EMT for installing.
+         */
+        RTCritSectEnter(&pPool->CritSect);
+        pJob->pReNative = pReNative;
+        pJob->off       = off;
+        pJob->cTicksCompile = cTicksCompile;
+        pJob->enmState  = kIemNativeBgJobState_Done;
+        pJob->pNext     = pVCpu->iem.s.pNativeBgDoneR3;
+        pVCpu->iem.s.pNativeBgDoneR3 = pJob;
+        ASMAtomicIncU32(&pVCpu->iem.s.cNativeBgDone);
+        if (pJob->fCancelWaiter)
+        {
+            pJob->fCancelWaiter = false;
+            RTSemEventSignal(pJob->hEvtDone);
+        }
+        RTCritSectLeave(&pPool->CritSect);
+    }
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Queues a threaded TB for native recompilation on a background thread.
+ *
+ * The TB is marked with IEMTB_F_NATIVE_BG_QUEUED and continues to be executed
+ * as threaded code until the EMT installs the native code in
+ * iemNativeBgInstallCompleted.
+ *
+ * @returns true if queued, false if the queue is full.
+ * @param   pVCpu   The cross context virtual CPU structure of the calling
+ *                  thread.
+ * @param   pTb     The threaded TB to recompile.
+ * @thread  EMT(pVCpu)
+ */
+DECLHIDDEN(bool) iemNativeBgQueue(PVMCPUCC pVCpu, PIEMTB pTb) RT_NOEXCEPT
+{
+    PIEMNATIVEBGPOOL const pPool = pVCpu->CTX_SUFF(pVM)->iem.s.pNativeBgPoolR3;
+    Assert(pPool);
+    Assert((pTb->fFlags & (IEMTB_F_TYPE_MASK | IEMTB_F_NATIVE_BG_QUEUED)) == IEMTB_F_TYPE_THREADED);
+
+    RTCritSectEnter(&pPool->CritSect);
+    PIEMNATIVEBGJOB const pJob = pPool->pFreeHead;
+    if (pJob)
+    {
+        pPool->pFreeHead = pJob->pNext;
+        pJob->pNext      = NULL;
+        pJob->pVCpu      = pVCpu;
+        pJob->pTb        = pTb;
+        pJob->pReNative  = NULL;
+        pJob->nsQueued   = RTTimeNanoTS();
+        pJob->off        = UINT32_MAX;
+        pJob->cTicksCompile = 0;
+        pJob->enmState   = kIemNativeBgJobState_Queued;
+        pJob->fCancelWaiter = false;
+        if (pPool->pQueueTail)
+            pPool->pQueueTail->pNext = pJob;
+        else
+            pPool->pQueueHead = pJob;
+        pPool->pQueueTail = pJob;
+        pTb->fFlags |= IEMTB_F_NATIVE_BG_QUEUED;
+    }
+    RTCritSectLeave(&pPool->CritSect);
+
+    if (pJob)
+    {
+        RTSemEventSignal(pPool->hEvtWork);
+        STAM_REL_COUNTER_INC(&pVCpu->iem.s.StatNativeBgQueued);
+        return true;
+    }
+    STAM_REL_COUNTER_INC(&pVCpu->iem.s.StatNativeBgQueueFull);
+    return false;
+}
+
+
+/**
+ * Cancels the background recompilation of a TB that's about to be freed or
+ * has been made obsolete.
+ *
+ * If a worker is currently recompiling the TB we have to wait for it to
+ * finish, as it is reading the threaded calls.  A job that's done but not yet
+ * installed is detached from the TB, iemNativeBgInstallCompleted skips it.
+ *
+ * @param   pVCpu   The cross context virtual CPU structure of the calling
+ *                  thread.
+ * @param   pTb     The TB (IEMTB_F_NATIVE_BG_QUEUED is set).
+ * @thread  EMT(pVCpu)
+ */
+DECLHIDDEN(void) iemNativeBgCancel(PVMCPUCC pVCpu, PIEMTB pTb) RT_NOEXCEPT
+{
+    PIEMNATIVEBGPOOL const pPool = pVCpu->CTX_SUFF(pVM)->iem.s.pNativeBgPoolR3;
+    pTb->fFlags &= ~IEMTB_F_NATIVE_BG_QUEUED;
+    AssertReturnVoid(pPool);
+
+    for (;;)
+    {
+        PIEMNATIVEBGJOB pJobBusy = NULL;
+        RTCritSectEnter(&pPool->CritSect);
+        for (unsigned i = 0; i < RT_ELEMENTS(pPool->aJobs); i++)
+            if (pPool->aJobs[i].pTb == pTb && pPool->aJobs[i].enmState != kIemNativeBgJobState_Free)
+            {
+                if (pPool->aJobs[i].enmState == kIemNativeBgJobState_Running)
+                {
+                    pJobBusy = &pPool->aJobs[i];
+                    pJobBusy->fCancelWaiter = true;
+                }
+                else
+                    pPool->aJobs[i].pTb = NULL;
+                break;
+            }
+        RTCritSectLeave(&pPool->CritSect);
+        if (!pJobBusy)
+            break;
+
+        /* The job cannot be recycled before we've seen it done, as only this
+           EMT installs it.  Go round again to detach it from the TB. */
+        int rc = RTSemEventWait(pJobBusy->hEvtDone, RT_INDEFINITE_WAIT);
+        AssertRC(rc);
+    }
+    STAM_REL_COUNTER_INC(&pVCpu->iem.s.StatNativeBgCancelled);
+}
+
+
+/**
+ * Installs the native code produced by the background recompiler threads.
+ *
+ * Called by the EMT between TBs when IEMCPU::cNativeBgDone is non-zero.  The
+ * TBs are converted from threaded to native in place, so the TB cache and
+ * lookup tables need no updating.
+ *
+ * @param   pVCpu   The cross context virtual CPU structure of the calling
+ *                  thread.
+ * @thread  EMT(pVCpu)
+ */
+DECLHIDDEN(void) iemNativeBgInstallCompleted(PVMCPUCC pVCpu) RT_NOEXCEPT
+{
+    PIEMNATIVEBGPOOL const pPool = pVCpu->CTX_SUFF(pVM)->iem.s.pNativeBgPoolR3;
+    AssertReturnVoid(pPool);
+
+    RTCritSectEnter(&pPool->CritSect);
+    PIEMNATIVEBGJOB pJobs = pVCpu->iem.s.pNativeBgDoneR3;
+    pVCpu->iem.s.pNativeBgDoneR3 = NULL;
+    ASMAtomicWriteU32(&pVCpu->iem.s.cNativeBgDone, 0);
+    RTCritSectLeave(&pPool->CritSect);
+
+    /*
+     * Install the code.  Only this EMT can cancel a job once it is done, so
+     * IEMNATIVEBGJOB::pTb is stable here.  Note that installing the code may
+     * free other TBs (delayed frees, pruning) and cancel their jobs further
+     * down the list, so pTb must be reloaded for each job.  TBs made obsolete
+     * while queued were detached by iemTbAlloctorScheduleForFree.
+     */
+    uint64_t const nsNow = RTTimeNanoTS();
+    PIEMNATIVEBGJOB pJobLast = NULL;
+    for (PIEMNATIVEBGJOB pJob = pJobs; pJob; pJob = pJob->pNext)
+    {
+        STAM_REL_PROFILE_ADD_PERIOD(&pVCpu->iem.s.StatNativeBgRecompilation, pJob->cTicksCompile);
+
+        PIEMTB const pTb = pJob->pTb;
+        if (pTb)
+        {
+            Assert(pTb->fFlags & IEMTB_F_NATIVE_BG_QUEUED);
+            Assert(pTb->GCPhysPc != NIL_RTGCPHYS);
+            pTb->fFlags &= ~IEMTB_F_NATIVE_BG_QUEUED;
+            pJob->pTb = NULL;
+            if (pJob->off != UINT32_MAX)
+            {
+                STAM_REL_PROFILE_START(&pVCpu->iem.s.StatNativeBgInstall, a);
+                iemNativeRecompileInstall(pVCpu, pJob->pReNative, pTb, pJob->off);
+                STAM_REL_PROFILE_STOP(&pVCpu->iem.s.StatNativeBgInstall, a);
+                if ((pTb->fFlags & IEMTB_F_TYPE_MASK) == IEMTB_F_TYPE_NATIVE)
+                {
+                    STAM_REL_COUNTER_INC(&pVCpu->iem.s.StatNativeBgInstalled);
+                    STAM_REL_PROFILE_ADD_PERIOD(&pVCpu->iem.s.StatNativeBgLatency, nsNow - pJob->nsQueued);
+                }
+                else
+                    STAM_REL_COUNTER_INC(&pVCpu->iem.s.StatNativeBgFailed);
+            }
+            else
+                STAM_REL_COUNTER_INC(&pVCpu->iem.s.StatNativeBgFailed);
+        }
+        pJobLast = pJob;
+    }
+
+    /*
+     * Return the jobs and recompiler states to the pool.
+     */
+    if (pJobLast)
+    {
+        RTCritSectEnter(&pPool->CritSect);
+        for (PIEMNATIVEBGJOB pJob = pJobs; pJob; pJob = pJob->pNext)
+        {
+            pJob->enmState = kIemNativeBgJobState_Free;
+            if (pJob->pReNative)
+            {
+                Assert(pPool->cFreeStates < RT_ELEMENTS(pPool->apFreeStates));
+                pPool->apFreeStates[pPool->cFreeStates++] = pJob->pReNative;
+                pJob->pReNative = NULL;
+            }
+        }
+        pJobLast->pNext  = pPool->pFreeHead;
+        pPool->pFreeHead = pJobs;
+        RTCritSectLeave(&pPool->CritSect);
+    }
+}
+
+
+/**
+ * Creates the background recompiler thread pool.
+ *
+ * @returns VBox status code.
+ * @param   pVM         The cross context VM structure.
+ * @param   cThreads    Number of worker threads to create.
+ */
+int iemNativeBgInit(PVM pVM, uint32_t cThreads) RT_NOEXCEPT
+{
+    AssertReturn(cThreads > 0 && cThreads <= IEMNATIVEBG_MAX_THREADS, VERR_OUT_OF_RANGE);
+    AssertReturn(!pVM->iem.s.pNativeBgPoolR3, VERR_WRONG_ORDER);
+
+    PIEMNATIVEBGPOOL const pPool = (PIEMNATIVEBGPOOL)RTMemAllocZ(sizeof(*pPool));
+    AssertReturn(pPool, VERR_NO_MEMORY);
+    int rc = RTCritSectInit(&pPool->CritSect);
+    if (RT_SUCCESS(rc))
+    {
+        rc = RTSemEventCreate(&pPool->hEvtWork);
+        if (RT_SUCCESS(rc))
+        {
+            for (unsigned i = RT_ELEMENTS(pPool->aJobs); i-- > 0;)
+            {
+                pPool->aJobs[i].pNext = pPool->pFreeHead;
+                pPool->pFreeHead      = &pPool->aJobs[i];
+            }
+            for (unsigned i = 0; i < RT_ELEMENTS(pPool->aJobs) && RT_SUCCESS(rc); i++)
+                rc = RTSemEventCreate(&pPool->aJobs[i].hEvtDone);
+        }
+        if (RT_SUCCESS(rc))
+        {
+            pVM->iem.s.pNativeBgPoolR3 = pPool;
+            for (uint32_t i = 0; i < cThreads; i++)
+            {
+                rc = RTThreadCreateF(&pPool->ahThreads[i], iemNativeBgThread, pPool, 0 /*cbStack*/,
+                                     RTTHREADTYPE_DEFAULT, RTTHREADFLAGS_WAITABLE, "IemN8veBg%u", i);
+                if (RT_FAILURE(rc))
+                {
+                    LogRel(("IEM: Failed to create background recompiler thread #%u: %Rrc\n", i, rc));
+                    break;
+                }
+                pPool->cThreads = i + 1;
+            }
+            if (pPool->cThreads > 0)
+            {
+                LogRel(("IEM: Native recompilation on %u background thread(s)\n", pPool->cThreads));
+                return VINF_SUCCESS;
+            }
+            pVM->iem.s.pNativeBgPoolR3 = NULL;
+        }
+        for (unsigned i = 0; i < RT_ELEMENTS(pPool->aJobs); i++)
+            RTSemEventDestroy(pPool->aJobs[i].hEvtDone); /* NIL (zero) is fine */
+        RTSemEventDestroy(pPool->hEvtWork);
+        RTCritSectDelete(&pPool->CritSect);
+    }
+    RTMemFree(pPool);
+    return rc;
+}
+
+
+/**
+ * Stops the background recompiler threads and frees the pool.
+ *
+ * @param   pVM         The cross context VM structure.
+ */
+void iemNativeBgTerm(PVM pVM) RT_NOEXCEPT
+{
+    PIEMNATIVEBGPOOL const pPool = pVM->iem.s.pNativeBgPoolR3;
+    if (!pPool)
+        return;
+
+    ASMAtomicWriteBool(&pPool->fTerminate, true);
+    for (uint32_t i = 0; i < pPool->cThreads; i++)
+    {
+        int rc;
+        do
+        {
+            RTSemEventSignal(pPool->hEvtWork);
+            rc = RTThreadWait(pPool->ahThreads[i], RT_MS_1SEC / 10, NULL);
+        } while (rc == VERR_TIMEOUT);
+    }
+    pVM->iem.s.pNativeBgPoolR3 = NULL;
+
+    for (unsigned i = 0; i < RT_ELEMENTS(pPool->aJobs); i++)
+        if (pPool->aJobs[i].pReNative)
+            iemNativeTerm(pPool->aJobs[i].pReNative);
+    while (pPool->cFreeStates > 0)
+        iemNativeTerm(pPool->apFreeStates[--pPool->cFreeStates]);
+
+    for (unsigned i = 0; i < RT_ELEMENTS(pPool->aJobs); i++)
+        RTSemEventDestroy(pPool->aJobs[i].hEvtDone);
+    RTSemEventDestroy(pPool->hEvtWork);
+    RTCritSectDelete(&pPool->CritSect);
+    RTMemFree(pPool);
+}
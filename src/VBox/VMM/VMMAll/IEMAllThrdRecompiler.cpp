@@ -82,7 +82,6 @@
 #include <iprt/assert.h>
 #include <iprt/mem.h>
 #include <iprt/string.h>
-#include <iprt/sort.h>
 #include <iprt/x86.h>
 
 #ifndef TST_IEM_CHECK_MC
@@ -443,22 +442,59 @@ RTGCPTR iemOpHlpCalcRmEffAddrJmpEx(PVMCPUCC pVCpu, uint8_t bRm, uint32_t cbImmAn
 *   Translation Block Cache.                                                                                                     *
 *********************************************************************************************************************************/
 
-/** @callback_method_impl{FNRTSORTCMP, Compare two TBs for pruning sorting purposes.}  */
-static DECLCALLBACK(int) iemTbCachePruneCmpTb(void const *pvElement1, void const *pvElement2, void *pvUser)
+/** Hashes a physical PC into IEMTBALLOCATOR::aGCPhysEvicted. */
+#define IEMTBALLOC_EVICTED_HASH(a_GCPhysPc) \
+    (((uint32_t)(a_GCPhysPc) ^ (uint32_t)((a_GCPhysPc) >> 6)) & (RT_ELEMENTS(((IEMTBALLOCATOR *)0)->aGCPhysEvicted) - 1))
+
+
+/**
+ * Updates the eviction statistics for a TB that is about to be evicted.
+ */
+DECL_FORCE_INLINE(void) iemTbAllocatorNoteEviction(PIEMTBALLOCATOR pTbAllocator, PCIEMTB pTb)
+{
+    STAM_COUNTER_INC(&pTbAllocator->StatEvicted);
+    if ((pTb->fFlags & IEMTB_F_TYPE_MASK) == IEMTB_F_TYPE_NATIVE)
+        STAM_COUNTER_INC(&pTbAllocator->StatEvictedNative);
+#ifdef VBOX_WITH_STATISTICS
+    pTbAllocator->aGCPhysEvicted[IEMTBALLOC_EVICTED_HASH(pTb->GCPhysPc)] = pTb->GCPhysPc;
+#else
+    RT_NOREF(pTbAllocator, pTb);
+#endif
+}
+
+
+/**
+ * Gets the value the usage count (IEMTB::cUsed) of a TB is aged towards.
+ *
+ * This is zero, except for threaded TBs that have reached the native
+ * recompilation threshold and are not queued for background recompilation,
+ * i.e. ones where the native recompilation failed.  Those only age down to the
+ * threshold, as the lookup code would otherwise retry the recompilation each
+ * time the count comes around to it again.
+ */
+DECL_FORCE_INLINE(uint32_t) iemTbUseCountFloor(PVMCPUCC pVCpu, PCIEMTB pTb)
 {
-    PCIEMTB const  pTb1 = (PCIEMTB)pvElement1;
-    PCIEMTB const  pTb2 = (PCIEMTB)pvElement2;
-    uint32_t const cMsSinceUse1 = (uint32_t)(uintptr_t)pvUser - pTb1->msLastUsed;
-    uint32_t const cMsSinceUse2 = (uint32_t)(uintptr_t)pvUser - pTb2->msLastUsed;
-    if (cMsSinceUse1 != cMsSinceUse2)
-        return cMsSinceUse1 < cMsSinceUse2 ? -1 : 1;
-    if (pTb1->cUsed != pTb2->cUsed)
-        return pTb1->cUsed > pTb2->cUsed ? -1 : 1;
-    if ((pTb1->fFlags & IEMTB_F_TYPE_MASK) != (pTb2->fFlags & IEMTB_F_TYPE_MASK))
-        return (pTb1->fFlags & IEMTB_F_TYPE_MASK) == IEMTB_F_TYPE_NATIVE ? -1 : 1;
+#ifdef VBOX_WITH_IEM_NATIVE_RECOMPILER
+    uint32_t const cThreshold = pVCpu->iem.s.uTbNativeRecompileAtUsedCount;
+    if (   pTb->cUsed >= cThreshold
+        && (pTb->fFlags & (IEMTB_F_TYPE_MASK | IEMTB_F_NATIVE_BG_QUEUED)) == IEMTB_F_TYPE_THREADED)
+        return cThreshold;
+#endif
+    RT_NOREF(pVCpu, pTb);
     return 0;
 }
 
+
+/**
+ * Ages the usage count of a TB by halving its distance to
+ * iemTbUseCountFloor.
+ */
+DECL_FORCE_INLINE(void) iemTbAgeUseCount(PVMCPUCC pVCpu, PIEMTB pTb)
+{
+    uint32_t const cFloor = iemTbUseCountFloor(pVCpu, pTb);
+    pTb->cUsed = cFloor + ((pTb->cUsed - cFloor) >> 1);
+}
+
 #ifdef VBOX_STRICT
 /**
  * Assertion helper that checks a collisions list count.
@@ -510,18 +546,44 @@ DECL_NO_INLINE(static, void) iemTbCacheAddWithPruning(PVMCPUCC pVCpu, PIEMTBCACH
         } while (pTbCollision);
 
     /*
-     * Sort it by most recently used and usage count.
+     * Evict the cold TBs in the older half of the list (new TBs are inserted
+     * at the head, so the list is ordered by age), i.e. those used less than
+     * the list average.  The usage counts of the ones we keep are aged, the
+     * same way as the CLOCK hand does it (see iemTbAllocatorClockSweep), so
+     * TBs that were hot a long time ago eventually become candidates too.
+     *
+     * The evicted TBs are freed before creating the new list, because
+     * otherwise the free code will scan the list for each one without ever
+     * finding it.
      */
-    RTSortApvShell((void **)apSortedTbs, cInserted, iemTbCachePruneCmpTb, (void *)(uintptr_t)pVCpu->iem.s.msRecompilerPollNow);
-
-    /* We keep half the list for now. Perhaps a bit aggressive... */
-    uintptr_t const cKeep = cInserted / 2;
-
-    /* First free up the TBs we don't wish to keep (before creating the new
-       list because otherwise the free code will scan the list for each one
-       without ever finding it). */
-    for (uintptr_t idx = cKeep; idx < cInserted; idx++)
-        iemTbAllocatorFree(pVCpu, apSortedTbs[idx]);
+    uint64_t cUsedTotal = 0;
+    for (uintptr_t idx = 0; idx < cInserted; idx++)
+        cUsedTotal += apSortedTbs[idx]->cUsed - iemTbUseCountFloor(pVCpu, apSortedTbs[idx]);
+    uint32_t const        cUsedAvg     = cInserted ? (uint32_t)(cUsedTotal / cInserted) : 0;
+    uintptr_t const       idxOldHalf   = cInserted / 2;
+    PIEMTBALLOCATOR const pTbAllocator = pVCpu->iem.s.pTbAllocatorR3;
+    uintptr_t             cKeep        = 0;
+    for (uintptr_t idx = 0; idx < cInserted; idx++)
+    {
+        PIEMTB const pTbCur = apSortedTbs[idx];
+        if (idx < idxOldHalf || pTbCur->cUsed - iemTbUseCountFloor(pVCpu, pTbCur) > cUsedAvg)
+        {
+            iemTbAgeUseCount(pVCpu, pTbCur);
+            apSortedTbs[cKeep++] = pTbCur;
+        }
+        else
+        {
+            iemTbAllocatorNoteEviction(pTbAllocator, pTbCur);
+            iemTbAllocatorFree(pVCpu, pTbCur);
+        }
+    }
+    if (cKeep >= cInserted && cKeep > 0)
+    {
+        /* Everything is equally hot, so make room by dropping the oldest one. */
+        cKeep--;
+        iemTbAllocatorNoteEviction(pTbAllocator, apSortedTbs[cKeep]);
+        iemTbAllocatorFree(pVCpu, apSortedTbs[cKeep]);
+    }
 
     /* Then chain the new TB together with the ones we like to keep of the
        existing ones and insert this list into the hash table. */
@@ -619,6 +681,83 @@ static bool iemTbCacheRemove(PIEMTBCACHE pTbCache, PIEMTB pTb)
 }
 
 
+#ifdef VBOX_WITH_IEM_NATIVE_RECOMPILER
+/**
+ * Checks whether a threaded TB that just became hot should be re-recorded as a
+ * superblock instead of being natively recompiled as-is.
+ *
+ * This is the case when the TB was ended for capacity or pending IRQ reasons
+ * (IEMTB_F_SUPERBLOCK_CANDIDATE) and the final call has already been chained
+ * to a following TB via its lookup table entry, i.e. the fall-thru edge is
+ * actually taken.  Re-recording from the same PC lets iemThreadedCompile follow
+ * the trace across the former TB boundary, so the native recompiler can keep
+ * guest registers shadowed in host registers and skip a TB exit + lookup.
+ *
+ * No special invalidation is needed for superblocks, they are ordinary TBs with
+ * opcode checks and physical page tracking covering all their ranges.
+ *
+ * @returns true if it should be re-recorded, false if not.
+ * @param   pVCpu   The cross context virtual CPU structure of the calling
+ *                  thread.
+ * @param   pTb     The threaded translation block.
+ */
+DECL_FORCE_INLINE(bool) iemTbCacheShouldFormSuperblock(PVMCPUCC pVCpu, PCIEMTB pTb)
+{
+    if (   (pTb->fFlags & IEMTB_F_SUPERBLOCK_CANDIDATE)
+        && (pVCpu->iem.s.fTbSuperblock & IEMCPU_TB_SUPERBLOCK_F_ENABLED))
+    {
+        Assert((pTb->fFlags & IEMTB_F_TYPE_MASK) == IEMTB_F_TYPE_THREADED);
+        uint8_t const        uTbLookup   = pTb->Thrd.paCalls[pTb->Thrd.cCalls - 1].uTbLookup;
+        PIEMTB const * const papTbLookup = IEMTB_GET_TB_LOOKUP_TAB_ENTRY(pTb, IEM_TB_LOOKUP_TAB_GET_IDX(uTbLookup));
+        for (unsigned i = 0; i < IEM_TB_LOOKUP_TAB_GET_SIZE(uTbLookup); i++)
+            if (papTbLookup[i])
+                return true;
+    }
+    return false;
+}
+
+
+/**
+ * Discards a hot superblock candidate TB so that iemThreadedCompile will
+ * re-record it as a superblock.
+ *
+ * @returns NULL (for tail calling by iemTbCacheLookup).
+ * @param   pVCpu   The cross context virtual CPU structure of the calling
+ *                  thread.
+ * @param   pTb     The threaded translation block to discard.
+ */
+static PIEMTB iemTbCacheDiscardForSuperblock(PVMCPUCC pVCpu, PIEMTB pTb)
+{
+    pVCpu->iem.s.fTbSuperblock |= IEMCPU_TB_SUPERBLOCK_F_PENDING;
+    iemThreadedTbObsolete(pVCpu, pTb, true /*fSafeToFree*/); /* Not executing, we're between TBs. */
+    return NULL;
+}
+#endif /* VBOX_WITH_IEM_NATIVE_RECOMPILER */
+
+
+#ifdef VBOX_WITH_IEM_NATIVE_RECOMPILER
+/**
+ * Native recompiles a threaded TB that just reached the use count threshold.
+ *
+ * When background recompilation is enabled, the TB is queued for one of the
+ * helper threads and we continue executing the threaded code till the native
+ * code has been installed by iemNativeBgInstallCompleted.  If the queue is
+ * full, or background recompilation is disabled, it is done synchronously.
+ *
+ * @returns The TB to execute.
+ */
+DECL_FORCE_INLINE(PIEMTB) iemTbCacheNativeRecompile(PVMCPUCC pVCpu, PIEMTB pTb)
+{
+    if (pTb->fFlags & IEMTB_F_NATIVE_BG_QUEUED) /* the use count may come around again after aging */
+        return pTb;
+    if (   !pVCpu->CTX_SUFF(pVM)->iem.s.pNativeBgPoolR3
+        || !iemNativeBgQueue(pVCpu, pTb))
+        return iemNativeRecompile(pVCpu, pTb);
+    return pTb;
+}
+#endif
+
+
 /**
  * Looks up a TB for the given PC and flags in the cache.
  *
@@ -659,8 +798,14 @@ static PIEMTB iemTbCacheLookup(PVMCPUCC pVCpu, PIEMTBCACHE pTbCache,
                         Log10(("TB lookup: fFlags=%#x GCPhysPc=%RGp: %p (@ %p)\n", fFlags, GCPhysPc, pTb, ppTbLookup));
                         return pTb;
                     }
-                    Log10(("TB lookup: fFlags=%#x GCPhysPc=%RGp: %p (@ %p) - recompiling\n", fFlags, GCPhysPc, pTb, ppTbLookup));
-                    return iemNativeRecompile(pVCpu, pTb);
+                    if (!iemTbCacheShouldFormSuperblock(pVCpu, pTb))
+                    {
+                        Log10(("TB lookup: fFlags=%#x GCPhysPc=%RGp: %p (@ %p) - recompiling\n", fFlags, GCPhysPc, pTb, ppTbLookup));
+                        return iemTbCacheNativeRecompile(pVCpu, pTb);
+                    }
+                    Log10(("TB lookup: fFlags=%#x GCPhysPc=%RGp: %p (@ %p) - superblock\n", fFlags, GCPhysPc, pTb, ppTbLookup));
+                    *ppTbLookup = NULL;
+                    return iemTbCacheDiscardForSuperblock(pVCpu, pTb);
 #else
                     Log10(("TB lookup: fFlags=%#x GCPhysPc=%RGp: %p (@ %p)\n", fFlags, GCPhysPc, pTb, ppTbLookup));
                     return pTb;
@@ -700,10 +845,18 @@ static PIEMTB iemTbCacheLookup(PVMCPUCC pVCpu, PIEMTBCACHE pTbCache,
                                IEMTBCACHE_PTR_GET_COUNT(pTbCache->apHash[idxHash]) ));
                         return pTb;
                     }
-                    Log10(("TB lookup: fFlags=%#x GCPhysPc=%RGp idxHash=%#x: %p (@ %d / %d) - recompiling\n",
+                    if (!iemTbCacheShouldFormSuperblock(pVCpu, pTb))
+                    {
+                        Log10(("TB lookup: fFlags=%#x GCPhysPc=%RGp idxHash=%#x: %p (@ %d / %d) - recompiling\n",
+                               fFlags, GCPhysPc, idxHash, pTb, IEMTBCACHE_PTR_GET_COUNT(pTbCache->apHash[idxHash]) - cLeft,
+                               IEMTBCACHE_PTR_GET_COUNT(pTbCache->apHash[idxHash]) ));
+                        return iemTbCacheNativeRecompile(pVCpu, pTb);
+                    }
+                    Log10(("TB lookup: fFlags=%#x GCPhysPc=%RGp idxHash=%#x: %p (@ %d / %d) - superblock\n",
                            fFlags, GCPhysPc, idxHash, pTb, IEMTBCACHE_PTR_GET_COUNT(pTbCache->apHash[idxHash]) - cLeft,
                            IEMTBCACHE_PTR_GET_COUNT(pTbCache->apHash[idxHash]) ));
-                    return iemNativeRecompile(pVCpu, pTb);
+                    *ppTbLookup = NULL;
+                    return iemTbCacheDiscardForSuperblock(pVCpu, pTb);
 #else
                     Log10(("TB lookup: fFlags=%#x GCPhysPc=%RGp idxHash=%#x: %p (@ %d / %d)\n",
                            fFlags, GCPhysPc, idxHash, pTb, IEMTBCACHE_PTR_GET_COUNT(pTbCache->apHash[idxHash]) - cLeft,
@@ -771,10 +924,12 @@ static PIEMTB iemTbCacheLookup(PVMCPUCC pVCpu, PIEMTBCACHE pTbCache,
  * @param   cbMaxExec       The max size of the executable memory allocator.
  * @param   cbChunkExec     The chunk size for executable memory allocator. Zero
  *                          or UINT32_MAX for automatically determining this.
+ * @param   fExecLargePages Whether to try back the executable memory with
+ *                          large pages.
  * @thread  EMT
  */
 DECLCALLBACK(int) iemTbInit(PVMCC pVM, uint32_t cInitialTbs, uint32_t cMaxTbs,
-                            uint64_t cbInitialExec, uint64_t cbMaxExec, uint32_t cbChunkExec)
+                            uint64_t cbInitialExec, uint64_t cbMaxExec, uint32_t cbChunkExec, bool fExecLargePages)
 {
     PVMCPUCC pVCpu = VMMGetCpu(pVM);
     Assert(!pVCpu->iem.s.pTbCacheR3);
@@ -823,6 +978,9 @@ DECLCALLBACK(int) iemTbInit(PVMCC pVM, uint32_t cInitialTbs, uint32_t cMaxTbs,
     pTbAllocator->cbPerChunk    = cbPerChunk;
     pTbAllocator->cMaxTbs       = cMaxTbs;
     pTbAllocator->pTbsFreeHead  = NULL;
+    pTbAllocator->cEvictHighWater = cMaxTbs - cMaxTbs / 16;
+    for (unsigned i = 0; i < RT_ELEMENTS(pTbAllocator->aGCPhysEvicted); i++)
+        pTbAllocator->aGCPhysEvicted[i] = NIL_RTGCPHYS;
 #ifdef IEMTB_SIZE_IS_POWER_OF_TWO
     pTbAllocator->fChunkMask    = cTbsPerChunk - 1;
     pTbAllocator->cChunkShift   = cChunkShift;
@@ -887,10 +1045,10 @@ DECLCALLBACK(int) iemTbInit(PVMCC pVM, uint32_t cInitialTbs, uint32_t cMaxTbs,
      * Initialize the native executable memory allocator.
      */
 #ifdef VBOX_WITH_IEM_NATIVE_RECOMPILER
-    int rc = iemExecMemAllocatorInit(pVCpu, cbMaxExec, cbInitialExec, cbChunkExec);
+    int rc = iemExecMemAllocatorInit(pVCpu, cbMaxExec, cbInitialExec, cbChunkExec, fExecLargePages);
     AssertLogRelRCReturn(rc, rc);
 #else
-    RT_NOREF(cbMaxExec, cbInitialExec, cbChunkExec);
+    RT_NOREF(cbMaxExec, cbInitialExec, cbChunkExec, fExecLargePages);
 #endif
 
     return VINF_SUCCESS;
@@ -911,6 +1069,17 @@ static void iemTbAllocatorFreeInner(PVMCPUCC pVCpu, PIEMTBALLOCATOR pTbAllocator
         Assert(pTbOther != pTb);
 #endif
 
+#ifdef VBOX_WITH_IEM_NATIVE_RECOMPILER
+    /*
+     * Cancel any pending background recompilation, as it may be accessing
+     * the threaded calls we're about to free.
+     */
+    if (!(pTb->fFlags & IEMTB_F_NATIVE_BG_QUEUED))
+    { /* likely */ }
+    else
+        iemNativeBgCancel(pVCpu, pTb);
+#endif
+
     /*
      * Unlink the TB from the hash table.
      */
@@ -1022,6 +1191,18 @@ static void iemTbAlloctorScheduleForFree(PVMCPUCC pVCpu, PIEMTB pTb)
     pTb->GCPhysPc  = NIL_RTGCPHYS;
     pTb->x86.fAttr = UINT16_MAX;
 
+#ifdef VBOX_WITH_IEM_NATIVE_RECOMPILER
+    /*
+     * Detach it from any pending background recompilation, the result would
+     * otherwise be installed into a TB on the delayed free list (or worse,
+     * after it has been freed by iemNativeRecompileInstall processing it).
+     */
+    if (!(pTb->fFlags & IEMTB_F_NATIVE_BG_QUEUED))
+    { /* likely */ }
+    else
+        iemNativeBgCancel(pVCpu, pTb);
+#endif
+
     pTb->pNext = pTbAllocator->pDelayedFreeHead;
     pTbAllocator->pDelayedFreeHead = pTb;
 }
@@ -1161,6 +1342,117 @@ DECL_FORCE_INLINE(PIEMTB) iemTbAllocatorAllocCore(PIEMTBALLOCATOR const pTbAlloc
 }
 
 
+/**
+ * Evicts TB from the allocator, advancing the CLOCK hand.
+ *
+ * This is a generalized CLOCK algorithm where the TB usage count (IEMTB::cUsed)
+ * serves as reference indicator.  When the hand passes an in-use TB with a
+ * non-zero usage count, the count is halved (see iemTbAgeUseCount) and the TB
+ * is spared, so frequently used TBs survive a number of laps proportional to
+ * how much they are used, while ones that have not been looked up since the
+ * hand last passed them are evicted.  Native TBs make up a protected segment:
+ * as they are considerably more expensive to recreate, they are only evicted
+ * once they have gone unused for two laps.
+ *
+ * TBs that were created or used during the current millisecond are always
+ * spared, as is the TB currently executing.
+ *
+ * @returns Number of TBs freed.
+ * @param   pVCpu           The cross context virtual CPU structure of the
+ *                          calling thread.
+ * @param   pTbAllocator    The TB allocator.
+ * @param   cMaxScan        The max number of TB slots to advance the hand over.
+ * @param   cWanted         The number of TBs to free before stopping.
+ * @param   fForce          Whether to evict the least used TB encountered if
+ *                          the sweep didn't turn up any cold ones.
+ */
+static uint32_t iemTbAllocatorClockSweep(PVMCPUCC pVCpu, PIEMTBALLOCATOR const pTbAllocator,
+                                         uint32_t cMaxScan, uint32_t cWanted, bool fForce)
+{
+    uint32_t const msNow     = pVCpu->iem.s.msRecompilerPollNow;
+    uint32_t const cTotalTbs = pTbAllocator->cTotalTbs;
+    PCIEMTB const  pCurTb    = pVCpu->iem.s.pCurTbR3;
+    uint32_t       idxTb     = pTbAllocator->iClockHand < cTotalTbs ? pTbAllocator->iClockHand : 0;
+    uint32_t       cFreed    = 0;
+    uint32_t       idxLeast  = UINT32_MAX;
+    uint32_t       cLeast    = UINT32_MAX;
+    for (uint32_t cScanned = 0; cScanned < cMaxScan && cFreed < cWanted; cScanned++)
+    {
+        uint32_t const idxChunk   = IEMTBALLOC_IDX_TO_CHUNK(pTbAllocator, idxTb);
+        uint32_t const idxInChunk = IEMTBALLOC_IDX_TO_INDEX_IN_CHUNK(pTbAllocator, idxTb, idxChunk);
+        PIEMTB const   pTb        = &pTbAllocator->aChunks[idxChunk].paTbs[idxInChunk];
+        if ((pTb->fFlags & IEMTB_F_TYPE_MASK) && pTb != pCurTb)
+        {
+            uint32_t const cUsed = pTb->cUsed - iemTbUseCountFloor(pVCpu, pTb);
+            if (   cUsed == 0
+                && pTb->msLastUsed != msNow
+                && (   (pTb->fFlags & IEMTB_F_TYPE_MASK) != IEMTB_F_TYPE_NATIVE
+                    || (int32_t)(pTb->msLastUsed - pTbAllocator->msClockPrevLap) < 0))
+            {
+                iemTbAllocatorNoteEviction(pTbAllocator, pTb);
+                iemTbAllocatorFreeInner(pVCpu, pTbAllocator, pTb, idxChunk, idxInChunk);
+                cFreed++;
+            }
+            else
+            {
+                if (cUsed < cLeast)
+                {
+                    cLeast   = cUsed;
+                    idxLeast = idxTb;
+                }
+                iemTbAgeUseCount(pVCpu, pTb);
+                STAM_COUNTER_INC(&pTbAllocator->StatEvictSpared);
+            }
+        }
+
+        if (++idxTb < cTotalTbs)
+        { /* likely */ }
+        else
+        {
+            idxTb = 0;
+            pTbAllocator->msClockPrevLap = pTbAllocator->msClockLap;
+            pTbAllocator->msClockLap     = msNow;
+            pTbAllocator->cClockLaps    += 1;
+        }
+    }
+    pTbAllocator->iClockHand = idxTb;
+
+    /*
+     * If everything we looked at was hot and we must free something,
+     * sacrifice the least used one.
+     */
+    if (!cFreed && fForce && idxLeast != UINT32_MAX)
+    {
+        uint32_t const idxChunk   = IEMTBALLOC_IDX_TO_CHUNK(pTbAllocator, idxLeast);
+        uint32_t const idxInChunk = IEMTBALLOC_IDX_TO_INDEX_IN_CHUNK(pTbAllocator, idxLeast, idxChunk);
+        PIEMTB const   pTb        = &pTbAllocator->aChunks[idxChunk].paTbs[idxInChunk];
+        iemTbAllocatorNoteEviction(pTbAllocator, pTb);
+        iemTbAllocatorFreeInner(pVCpu, pTbAllocator, pTb, idxChunk, idxInChunk);
+        cFreed++;
+    }
+    return cFreed;
+}
+
+
+/**
+ * Incremental eviction step for iemTbAllocatorAlloc.
+ *
+ * Called when the number of TBs in use is above the high-water mark so that
+ * the cost of eviction is spread over many allocations instead of stalling
+ * the allocation that finds the allocator full.
+ */
+static void iemTbAllocatorEvictStep(PVMCPUCC pVCpu, PIEMTBALLOCATOR const pTbAllocator)
+{
+    if (pTbAllocator->cAllocatedChunks >= pTbAllocator->cMaxChunks)
+    {
+        STAM_PROFILE_START(&pTbAllocator->StatEvictStep, a);
+        if (iemTbAllocatorClockSweep(pVCpu, pTbAllocator, 32 /*cMaxScan*/, 2 /*cWanted*/, false /*fForce*/))
+            pVCpu->iem.s.ppTbLookupEntryR3 = &pVCpu->iem.s.pTbLookupEntryDummyR3; /* Flush the TB lookup entry pointer. */
+        STAM_PROFILE_STOP(&pTbAllocator->StatEvictStep, a);
+    }
+}
+
+
 /**
  * Slow path for iemTbAllocatorAlloc.
  */
@@ -1177,67 +1469,12 @@ static PIEMTB iemTbAllocatorAllocSlow(PVMCPUCC pVCpu, PIEMTBALLOCATOR const pTbA
     }
 
     /*
-     * We have to prune stuff. Sigh.
-     *
-     * This requires scanning for older TBs and kick them out.  Not sure how to
-     * best do this as we don't want to maintain any list of TBs ordered by last
-     * usage time. But one reasonably simple approach would be that each time we
-     * get here we continue a sequential scan of the allocation chunks,
-     * considering just a smallish number of TBs and freeing a fixed portion of
-     * them.  Say, we consider the next 128 TBs, freeing the least recently used
-     * in out of groups of 4 TBs, resulting in 32 free TBs.
+     * We have to evict stuff.  The incremental eviction in iemTbAllocatorAlloc
+     * didn't keep up, so do a bounded sweep freeing a batch of cold TBs at
+     * once, falling back on the least used one if nothing is cold.
      */
     STAM_PROFILE_START(&pTbAllocator->StatPrune, a);
-    uint32_t const msNow          = pVCpu->iem.s.msRecompilerPollNow;
-    uint32_t const cTbsToPrune    = 128;
-    uint32_t const cTbsPerGroup   = 4;
-    uint32_t       cFreedTbs      = 0;
-#ifdef IEMTB_SIZE_IS_POWER_OF_TWO
-    uint32_t       idxTbPruneFrom = pTbAllocator->iPruneFrom & ~(uint32_t)(cTbsToPrune - 1); /* Stay within a chunk! */
-#else
-    uint32_t       idxTbPruneFrom = pTbAllocator->iPruneFrom;
-#endif
-    if (idxTbPruneFrom >= pTbAllocator->cMaxTbs)
-        idxTbPruneFrom = 0;
-    for (uint32_t i = 0; i < cTbsToPrune; i += cTbsPerGroup, idxTbPruneFrom += cTbsPerGroup)
-    {
-        uint32_t idxChunk   = IEMTBALLOC_IDX_TO_CHUNK(pTbAllocator, idxTbPruneFrom);
-        uint32_t idxInChunk = IEMTBALLOC_IDX_TO_INDEX_IN_CHUNK(pTbAllocator, idxTbPruneFrom, idxChunk);
-        PIEMTB   pTb        = &pTbAllocator->aChunks[idxChunk].paTbs[idxInChunk];
-        uint32_t cMsAge     = msNow - pTb->msLastUsed;
-        Assert(pTb->fFlags & IEMTB_F_TYPE_MASK);
-
-        for (uint32_t j = 1, idxChunk2 = idxChunk, idxInChunk2 = idxInChunk + 1; j < cTbsPerGroup; j++, idxInChunk2++)
-        {
-#ifndef IEMTB_SIZE_IS_POWER_OF_TWO
-            if (idxInChunk2 < pTbAllocator->cTbsPerChunk)
-            { /* likely */ }
-            else
-            {
-                idxInChunk2 = 0;
-                idxChunk2  += 1;
-                if (idxChunk2 >= pTbAllocator->cAllocatedChunks)
-                    idxChunk2 = 0;
-            }
-#endif
-            PIEMTB   const pTb2    = &pTbAllocator->aChunks[idxChunk2].paTbs[idxInChunk2];
-            uint32_t const cMsAge2 = msNow - pTb2->msLastUsed;
-            if (   cMsAge2 > cMsAge
-                || (cMsAge2 == cMsAge && pTb2->cUsed < pTb->cUsed))
-            {
-                Assert(pTb2->fFlags & IEMTB_F_TYPE_MASK);
-                pTb        = pTb2;
-                idxChunk   = idxChunk2;
-                idxInChunk = idxInChunk2;
-                cMsAge     = cMsAge2;
-            }
-        }
-
-        /* Free the TB. */
-        iemTbAllocatorFreeInner(pVCpu, pTbAllocator, pTb, idxChunk, idxInChunk);
-        cFreedTbs++; /* paranoia */
-    }
-    pTbAllocator->iPruneFrom = idxTbPruneFrom;
+    uint32_t const cFreedTbs = iemTbAllocatorClockSweep(pVCpu, pTbAllocator, 512 /*cMaxScan*/, 32 /*cWanted*/, true /*fForce*/);
     STAM_PROFILE_STOP(&pTbAllocator->StatPrune, a);
 
     /* Flush the TB lookup entry pointer. */
@@ -1275,7 +1512,14 @@ DECL_FORCE_INLINE(PIEMTB) iemTbAllocatorAlloc(PVMCPUCC pVCpu, bool fThreaded)
 
     /* If the allocator is full, take slow code path.*/
     if (RT_LIKELY(pTbAllocator->cInUseTbs < pTbAllocator->cTotalTbs))
+    {
+        /* Start evicting cold TBs ahead of time when getting close to the limit. */
+        if (pTbAllocator->cInUseTbs < pTbAllocator->cEvictHighWater)
+        { /* likely */ }
+        else
+            iemTbAllocatorEvictStep(pVCpu, pTbAllocator);
         return iemTbAllocatorAllocCore(pTbAllocator, fThreaded);
+    }
     return iemTbAllocatorAllocSlow(pVCpu, pTbAllocator, fThreaded);
 }
 
@@ -1283,13 +1527,12 @@ DECL_FORCE_INLINE(PIEMTB) iemTbAllocatorAlloc(PVMCPUCC pVCpu, bool fThreaded)
 /**
  * This is called when we're out of space for native TBs.
  *
- * This uses a variation on the pruning in iemTbAllocatorAllocSlow.
- * The difference is that we only prune native TBs and will only free any if
- * there are least two in a group.  The conditions under which we're called are
- * different - there will probably be free TBs in the table when we're called.
- * Therefore we increase the group size and max scan length, though we'll stop
- * scanning once we've reached the requested size (@a cNeededInstrs) and freed
- * up at least 8 TBs.
+ * Unlike iemTbAllocatorClockSweep, this only looks at native TBs.  The table is
+ * scanned in groups of 16 TBs and the oldest native TB in each group is freed,
+ * provided there are at least two native TBs in the group.  There will probably
+ * be free TBs in the table when we're called, so we scan up to 1024 TBs, but
+ * stop once we've freed at least 8 TBs and one of them was at least as large
+ * as the request (@a cNeededInstrs).
  */
 void iemTbAllocatorFreeupNativeSpace(PVMCPUCC pVCpu, uint32_t cNeededInstrs)
 {
@@ -1357,6 +1600,7 @@ void iemTbAllocatorFreeupNativeSpace(PVMCPUCC pVCpu, uint32_t cNeededInstrs)
         if (cNativeTbs >= 2)
         {
             cMaxInstrs = RT_MAX(cMaxInstrs, pTb->Native.cInstructions);
+            iemTbAllocatorNoteEviction(pTbAllocator, pTb);
             iemTbAllocatorFreeInner(pVCpu, pTbAllocator, pTb, idxChunk, idxInChunk);
             cFreedTbs++;
             if (cFreedTbs >= 8 && cMaxInstrs >= cNeededInstrs)
@@ -1649,7 +1893,7 @@ static PIEMTB iemThreadedTbAlloc(PVMCC pVM, PVMCPUCC pVCpu, RTGCPHYS GCPhysPc, u
     PIEMTB pTb = (PIEMTB)RTMemAllocZ(sizeof(IEMTB));
     if (pTb)
     {
-        unsigned const cCalls = 256;
+        unsigned const cCalls = 512; /* Ordinary TBs only use half of this, superblocks all of it. */
         pTb->Thrd.paCalls = (PIEMTHRDEDCALLENTRY)RTMemAlloc(sizeof(IEMTHRDEDCALLENTRY) * cCalls);
         if (pTb->Thrd.paCalls)
         {
@@ -1792,6 +2036,18 @@ static void iemThreadedTbAdd(PVMCPUCC pVCpu, PIEMTBCACHE pTbCache, PIEMTB pTb)
     STAM_REL_PROFILE_ADD_PERIOD(&pVCpu->iem.s.StatTbInstr,         pTb->cInstructions);
     STAM_REL_PROFILE_ADD_PERIOD(&pVCpu->iem.s.StatTbLookupEntries, pTb->cTbLookupEntries);
     STAM_REL_PROFILE_ADD_PERIOD(&pVCpu->iem.s.StatTbThreadedCalls, pTb->Thrd.cCalls);
+#ifdef VBOX_WITH_STATISTICS
+    /* Eviction churn: Did we just recompile something we recently threw out? */
+    PIEMTBALLOCATOR const pTbAllocator = pVCpu->iem.s.pTbAllocatorR3;
+    uint32_t const        idxEvicted   = IEMTBALLOC_EVICTED_HASH(pTb->GCPhysPc);
+    if (pTbAllocator->aGCPhysEvicted[idxEvicted] != pTb->GCPhysPc)
+    { /* likely */ }
+    else
+    {
+        pTbAllocator->aGCPhysEvicted[idxEvicted] = NIL_RTGCPHYS;
+        STAM_COUNTER_INC(&pTbAllocator->StatRecompiledAfterEvict);
+    }
+#endif
     if (LogIs12Enabled())
     {
         Log12(("TB added: %p %RGp LB %#x fl=%#x idxHash=%#x cRanges=%u cInstr=%u cCalls=%u\n",
@@ -2804,6 +3060,14 @@ static VBOXSTRICTRC iemThreadedCompile(PVMCC pVM, PVMCPUCC pVCpu, RTGCPHYS GCPhy
        functions may get at it. */
     pVCpu->iem.s.pCurTbR3 = pTb;
 
+    /* Superblocks (see iemTbCacheShouldFormSuperblock) may use the whole
+       compile TB, while ordinary TBs are limited to half of it. */
+    bool const     fSuperblock  = RT_BOOL(pVCpu->iem.s.fTbSuperblock & IEMCPU_TB_SUPERBLOCK_F_PENDING);
+    pVCpu->iem.s.fTbSuperblock &= ~IEMCPU_TB_SUPERBLOCK_F_PENDING;
+    uint32_t const cMaxCalls    = fSuperblock ? pTb->Thrd.cAllocated : pTb->Thrd.cAllocated / 2;
+    uint32_t const cbMaxOpcodes = fSuperblock ? pVCpu->iem.s.cbOpcodesAllocated : pVCpu->iem.s.cbOpcodesAllocated / 2;
+    bool           fCandidate   = false;
+
 #if 0
     /* Make sure the CheckIrq condition matches the one in EM. */
     iemThreadedCompileCheckIrqAfter(pVCpu, pTb);
@@ -2881,17 +3145,22 @@ static VBOXSTRICTRC iemThreadedCompile(PVMCC pVM, PVMCPUCC pVCpu, RTGCPHYS GCPhy
         if (pVCpu->iem.s.cInstrTillIrqCheck > 0)
             pVCpu->iem.s.cInstrTillIrqCheck--;
         else if (!iemThreadedCompileCheckIrqAfter(pVCpu, pTb))
+        {
+            fCandidate = true;
             break;
+        }
 
-        /* Still space in the TB? */
-        if (   pTb->Thrd.cCalls + 5 < pTb->Thrd.cAllocated
-            && pTb->cbOpcodes + 16 <= pVCpu->iem.s.cbOpcodesAllocated
-            && pTb->cTbLookupEntries < 127)
+        /* Still space in the TB? (IEMTB::cInstructions is 8-bit.) */
+        if (   pTb->Thrd.cCalls + 5 < cMaxCalls
+            && pTb->cbOpcodes + 16 <= cbMaxOpcodes
+            && pTb->cTbLookupEntries < 127
+            && pTb->cInstructions < UINT8_MAX - 4)
             iemThreadedCompileInitDecoder(pVCpu, true /*fReInit*/, 0);
         else
         {
             Log8(("%04x:%08RX64: End TB - %u instr, %u calls, %u opcode bytes, %u TB lookup entries - full\n",
                   uCsLog, uRipLog, pTb->cInstructions, pTb->Thrd.cCalls, pTb->cbOpcodes, pTb->cTbLookupEntries));
+            fCandidate = true;
             break;
         }
         iemThreadedCompileReInitOpcodeFetching(pVCpu);
@@ -2916,6 +3185,20 @@ static VBOXSTRICTRC iemThreadedCompile(PVMCC pVM, PVMCPUCC pVCpu, RTGCPHYS GCPhy
         pTb->cTbLookupEntries -= 1;
     }
 
+    /*
+     * Mark superblocks and superblock candidates.
+     */
+    if (fSuperblock)
+    {
+        pTb->fFlags |= IEMTB_F_SUPERBLOCK;
+        STAM_REL_COUNTER_INC(&pVCpu->iem.s.StatTbSuperblocksFormed);
+    }
+    else if (fCandidate)
+    {
+        pTb->fFlags |= IEMTB_F_SUPERBLOCK_CANDIDATE;
+        STAM_REL_COUNTER_INC(&pVCpu->iem.s.StatTbSuperblockCandidates);
+    }
+
     /*
      * Duplicate the TB into a completed one and link it.
      */
@@ -3516,6 +3799,13 @@ VMM_INT_DECL(VBOXSTRICTRC) IEMExecRecompiler(PVMCC pVM, PVMCPUCC pVCpu, bool fWa
                 RTGCPHYS const GCPhysPc = iemGetPcWithPhysAndCode(pVCpu);
                 if (RT_LIKELY(pVCpu->iem.s.pbInstrBuf != NULL))
                 {
+#ifdef VBOX_WITH_IEM_NATIVE_RECOMPILER
+                    /* Install native code produced by the background recompiler threads. */
+                    if (!pVCpu->iem.s.cNativeBgDone)
+                    { /* likely */ }
+                    else
+                        iemNativeBgInstallCompleted(pVCpu);
+#endif
                     uint32_t const fExtraFlags = iemGetTbFlagsForCurrentPc(pVCpu);
                     PIEMTB const   pTb         = iemTbCacheLookup(pVCpu, pTbCache, GCPhysPc, fExtraFlags);
                     if (pTb)
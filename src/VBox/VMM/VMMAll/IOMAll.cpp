@@ -112,49 +112,80 @@ VMMDECL(VBOXSTRICTRC) IOMIOPortRead(PVMCC pVM, PVMCPU pVCpu, RTIOPORT Port, uint
             return VINF_IOM_R3_IOPORT_READ;
         }
 #endif
-        void           *pvUser       = pRegEntry->pvUser;
+        void             *pvUser              = pRegEntry->pvUser;
+        PFNIOMIOPORTNEWIN pfnInSharedCallback = pRegEntry->pfnInSharedCallback;
+        PPDMCRITSECTRW    pCritSectRw         = pRegEntry->pCritSectRw;
         IOM_UNLOCK_SHARED(pVM);
         AssertPtr(pDevIns);
         AssertPtr(pfnInCallback);
 
         /*
-         * Call the device.
+         * Call the device, trying the shared IN handler first if there is one.
          */
-        VBOXSTRICTRC rcStrict = PDMCritSectEnter(pVM, pDevIns->CTX_SUFF(pCritSectRo), VINF_IOM_R3_IOPORT_READ);
-        if (rcStrict == VINF_SUCCESS)
+        VBOXSTRICTRC rcStrict;
+        if (!pfnInSharedCallback)
+            rcStrict = VINF_IOM_READ_NEEDS_EXCLUSIVE;
+        else
+        {
+            rcStrict = PDMCritSectRwEnterShared(pVM, pCritSectRw, VINF_IOM_R3_IOPORT_READ);
+            if (rcStrict == VINF_SUCCESS)
+            {
+                STAM_PROFILE_START(&pStats->CTX_SUFF_Z(ProfIn), a);
+                rcStrict = pfnInSharedCallback(pDevIns, pvUser, fFlags & IOM_IOPORT_F_ABS ? Port : offPort,
+                                               pu32Value, (unsigned)cbValue);
+                STAM_PROFILE_STOP(&pStats->CTX_SUFF_Z(ProfIn), a);
+                PDMCritSectRwLeaveShared(pVM, pCritSectRw);
+                if (rcStrict != VINF_IOM_READ_NEEDS_EXCLUSIVE)
+                    STAM_COUNTER_INC(&pVM->iom.s.StatIoPortInShared);
+                else
+                    STAM_COUNTER_INC(&pVM->iom.s.StatIoPortInSharedFallback);
+            }
+            else
+            {
+                STAM_COUNTER_INC(&pStats->InRZToR3);
+                return rcStrict;
+            }
+        }
+        if (rcStrict == VINF_IOM_READ_NEEDS_EXCLUSIVE)
         {
+            rcStrict = PDMCritSectEnter(pVM, pDevIns->CTX_SUFF(pCritSectRo), VINF_IOM_R3_IOPORT_READ);
+            if (rcStrict == VINF_SUCCESS)
+            { /* likely */ }
+            else
+            {
+                STAM_COUNTER_INC(&pStats->InRZToR3);
+                return rcStrict;
+            }
             STAM_PROFILE_START(&pStats->CTX_SUFF_Z(ProfIn), a);
             rcStrict = pfnInCallback(pDevIns, pvUser, fFlags & IOM_IOPORT_F_ABS ? Port : offPort, pu32Value, (unsigned)cbValue);
             STAM_PROFILE_STOP(&pStats->CTX_SUFF_Z(ProfIn), a);
             PDMCritSectLeave(pVM, pDevIns->CTX_SUFF(pCritSectRo));
+        }
 
 #ifndef IN_RING3
-            if (rcStrict == VINF_IOM_R3_IOPORT_READ)
-                STAM_COUNTER_INC(&pStats->InRZToR3);
-            else
+        if (rcStrict == VINF_IOM_R3_IOPORT_READ)
+            STAM_COUNTER_INC(&pStats->InRZToR3);
+        else
 #endif
+        {
+            STAM_COUNTER_INC(&pStats->CTX_SUFF_Z(In));
+            STAM_COUNTER_INC(&iomIoPortGetStats(pVM, pRegEntry, 0)->Total);
+            if (rcStrict == VERR_IOM_IOPORT_UNUSED)
             {
-                STAM_COUNTER_INC(&pStats->CTX_SUFF_Z(In));
-                STAM_COUNTER_INC(&iomIoPortGetStats(pVM, pRegEntry, 0)->Total);
-                if (rcStrict == VERR_IOM_IOPORT_UNUSED)
+                /* make return value */
+                rcStrict = VINF_SUCCESS;
+                switch (cbValue)
                 {
-                    /* make return value */
-                    rcStrict = VINF_SUCCESS;
-                    switch (cbValue)
-                    {
-                        case 1: *(uint8_t  *)pu32Value = 0xff; break;
-                        case 2: *(uint16_t *)pu32Value = 0xffff; break;
-                        case 4: *(uint32_t *)pu32Value = UINT32_C(0xffffffff); break;
-                        default:
-                            AssertMsgFailedReturn(("Invalid I/O port size %d. Port=%d\n", cbValue, Port), VERR_IOM_INVALID_IOPORT_SIZE);
-                    }
+                    case 1: *(uint8_t  *)pu32Value = 0xff; break;
+                    case 2: *(uint16_t *)pu32Value = 0xffff; break;
+                    case 4: *(uint32_t *)pu32Value = UINT32_C(0xffffffff); break;
+                    default:
+                        AssertMsgFailedReturn(("Invalid I/O port size %d. Port=%d\n", cbValue, Port), VERR_IOM_INVALID_IOPORT_SIZE);
                 }
-           }
-            Log3(("IOMIOPortRead: Port=%RTiop *pu32=%08RX32 cb=%d rc=%Rrc\n", Port, *pu32Value, cbValue, VBOXSTRICTRC_VAL(rcStrict)));
-            STAM_COUNTER_INC(&iomIoPortGetStats(pVM, pRegEntry, 0)->Total);
+            }
         }
-        else
-            STAM_COUNTER_INC(&pStats->InRZToR3);
+        Log3(("IOMIOPortRead: Port=%RTiop *pu32=%08RX32 cb=%d rc=%Rrc\n", Port, *pu32Value, cbValue, VBOXSTRICTRC_VAL(rcStrict)));
+        STAM_COUNTER_INC(&iomIoPortGetStats(pVM, pRegEntry, 0)->Total);
         return rcStrict;
     }
 
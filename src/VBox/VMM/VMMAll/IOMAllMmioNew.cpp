@@ -618,6 +618,51 @@ DECLINLINE(VBOXSTRICTRC) iomMmioDoRead(PVMCC pVM, CTX_SUFF(PIOMMMIOENTRY) pRegEn
     return rcStrict;
 }
 
+
+/**
+ * Wrapper which does a read using the shared read handler.
+ *
+ * Only accesses which iomMmioDoRead would pass straight to the device are
+ * handled here, everything else is left to the regular read handler.
+ *
+ * @returns Strict VBox status code.
+ * @retval  VINF_IOM_READ_NEEDS_EXCLUSIVE if the read must be done by the
+ *          regular read handler while owning the device critical section.
+ * @retval  @a rcBusy if the read/write critical section is busy (R0 only).
+ */
+DECLINLINE(VBOXSTRICTRC) iomMmioDoReadShared(PVMCC pVM, CTX_SUFF(PIOMMMIOENTRY) pRegEntry, RTGCPHYS GCPhys, RTGCPHYS offRegion,
+                                             void *pvValue, uint32_t cbValue, int rcBusy IOM_MMIO_STATS_COMMA_DECL)
+{
+    if (   (   cbValue == 4
+            && !(GCPhys & 3))
+        || (pRegEntry->fFlags & IOMMMIO_FLAGS_READ_MODE) == IOMMMIO_FLAGS_READ_PASSTHRU
+        || (    cbValue == 8
+            && !(GCPhys & 7)
+            && (pRegEntry->fFlags & IOMMMIO_FLAGS_READ_MODE) == IOMMMIO_FLAGS_READ_DWORD_QWORD ) )
+    { /* likely */ }
+    else
+        return VINF_IOM_READ_NEEDS_EXCLUSIVE;
+
+    VBOXSTRICTRC rcStrict = PDMCritSectRwEnterShared(pVM, pRegEntry->pCritSectRw, rcBusy);
+    if (rcStrict == VINF_SUCCESS)
+    {
+        rcStrict = pRegEntry->pfnReadSharedCallback(pRegEntry->pDevIns, pRegEntry->pvUser,
+                                                    !(pRegEntry->fFlags & IOMMMIO_FLAGS_ABS) ? offRegion : GCPhys,
+                                                    pvValue, cbValue);
+        PDMCritSectRwLeaveShared(pVM, pRegEntry->pCritSectRw);
+        switch (VBOXSTRICTRC_VAL(rcStrict))
+        {
+            case VINF_IOM_READ_NEEDS_EXCLUSIVE:
+                STAM_COUNTER_INC(&pVM->iom.s.StatMmioReadSharedFallback);
+                return rcStrict;
+            case VINF_IOM_MMIO_UNUSED_FF: rcStrict = iomMMIODoReadFFs(pvValue, cbValue IOM_MMIO_STATS_COMMA_ARG); break;
+            case VINF_IOM_MMIO_UNUSED_00: rcStrict = iomMMIODoRead00s(pvValue, cbValue IOM_MMIO_STATS_COMMA_ARG); break;
+        }
+        STAM_COUNTER_INC(&pVM->iom.s.StatMmioReadShared);
+    }
+    return rcStrict;
+}
+
 #ifndef IN_RING3
 
 /**
@@ -949,7 +994,34 @@ DECLCALLBACK(VBOXSTRICTRC) iomMmioHandlerNew(PVMCC pVM, PVMCPUCC pVCpu, RTGCPHYS
      *
      * Note! All returns goes thru the one return statement at the end of the
      *       function in order to correctly maintaint the recursion counter.
+     *       The shared read path below is the exception and restores it itself.
      */
+    if (   enmAccessType == PGMACCESSTYPE_READ
+        && pRegEntry->pfnReadSharedCallback)
+    {
+        /*
+         * Read using the shared read handler, only holding the read/write
+         * critical section it was registered with in shared mode.
+         */
+        VBOXSTRICTRC rcStrict = iomMmioDoReadShared(pVM, pRegEntry, GCPhysFault, offRegion, pvBuf, (uint32_t)cbBuf,
+                                                    rcToRing3 IOM_MMIO_STATS_COMMA_ARG);
+        if (rcStrict != VINF_IOM_READ_NEEDS_EXCLUSIVE)
+        {
+#ifndef IN_RING3
+            if (rcStrict == VINF_IOM_R3_MMIO_READ)
+            {
+                STAM_COUNTER_INC(&pStats->ReadRZToR3);
+                STAM_COUNTER_INC(&pVM->iom.s.StatMmioReadsR0ToR3);
+            }
+            else
+#endif
+                STAM_COUNTER_INC(&pStats->Reads);
+            STAM_PROFILE_STOP(&pStats->CTX_SUFF_Z(ProfRead), Prf);
+            pVCpu->iom.s.cMmioRecursionDepth = idxDepth;
+            return rcStrict;
+        }
+    }
+
     VBOXSTRICTRC rcStrict = PDMCritSectEnter(pVM, pDevIns->CTX_SUFF(pCritSectRo), rcToRing3);
     if (rcStrict == VINF_SUCCESS)
     {
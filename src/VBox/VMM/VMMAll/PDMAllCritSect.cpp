@@ -47,7 +47,7 @@
 #if defined(IN_RING3) || defined(IN_RING0)
 # include <iprt/semaphore.h>
 #endif
-#ifdef IN_RING0
+#if defined(IN_RING3) || defined(IN_RING0)
 # include <iprt/time.h>
 #endif
 #if defined(IN_RING3) || defined(IN_RING0)
@@ -583,6 +583,38 @@ DECL_FORCE_INLINE(int) pdmCritSectEnter(PVMCC pVM, PPDMCRITSECT pCritSect, int r
 }
 
 
+#ifdef IN_RING3
+static int pdmCritSectTryEnter(PVMCC pVM, PPDMCRITSECT pCritSect, PCRTLOCKVALSRCPOS pSrcPos);
+
+/**
+ * Ring-3 enter worker used when contention profiling is enabled for the
+ * critical section.
+ *
+ * @returns See pdmCritSectEnter and pdmCritSectTryEnter.
+ * @param   pVM                 The cross context VM structure.
+ * @param   pCritSect           The PDM critical section to enter.
+ * @param   rcBusy              See pdmCritSectEnter.
+ * @param   fTryOnly            Set if called by the try-enter APIs.
+ * @param   pSrcPos             The source position of the lock operation.
+ * @param   uCaller             The return address of the API caller or the
+ *                              location ID passed to the debug APIs.
+ */
+DECL_NO_INLINE(static, int) pdmR3CritSectEnterProfiled(PVMCC pVM, PPDMCRITSECT pCritSect, int rcBusy, bool fTryOnly,
+                                                        PCRTLOCKVALSRCPOS pSrcPos, uintptr_t uCaller)
+{
+    RTNATIVETHREAD const hOwner      = pCritSect->s.Core.NativeThreadOwner;
+    bool const           fContended  = hOwner != NIL_RTNATIVETHREAD && hOwner != RTThreadNativeSelf();
+    uint64_t const       nsStartWait = fContended && !fTryOnly ? RTTimeNanoTS() : 0;
+
+    int const rc = !fTryOnly ? pdmCritSectEnter(pVM, pCritSect, rcBusy, pSrcPos) : pdmCritSectTryEnter(pVM, pCritSect, pSrcPos);
+    if (   rc == VINF_SUCCESS
+        && pCritSect->s.Core.cNestings == 1)
+        pdmR3CritSectProfEntered(pCritSect->s.pProfR3, uCaller, nsStartWait);
+    return rc;
+}
+#endif /* IN_RING3 */
+
+
 /**
  * Enters a PDM critical section.
  *
@@ -609,11 +641,18 @@ DECL_FORCE_INLINE(int) pdmCritSectEnter(PVMCC pVM, PPDMCRITSECT pCritSect, int r
 VMMDECL(DECL_CHECK_RETURN_NOT_R3(int)) PDMCritSectEnter(PVMCC pVM, PPDMCRITSECT pCritSect, int rcBusy)
 {
 #ifndef PDMCRITSECT_STRICT
-    return pdmCritSectEnter(pVM, pCritSect, rcBusy, NULL);
+    PCRTLOCKVALSRCPOS const pSrcPos = NULL;
 #else
     RTLOCKVALSRCPOS SrcPos = RTLOCKVALSRCPOS_INIT_NORMAL_API();
-    return pdmCritSectEnter(pVM, pCritSect, rcBusy, &SrcPos);
+    PCRTLOCKVALSRCPOS const pSrcPos = &SrcPos;
 #endif
+#ifdef IN_RING3
+    if (RT_LIKELY(!pCritSect->s.pProfR3))
+    { /* likely */ }
+    else
+        return pdmR3CritSectEnterProfiled(pVM, pCritSect, rcBusy, false /*fTryOnly*/, pSrcPos, (uintptr_t)ASMReturnAddress());
+#endif
+    return pdmCritSectEnter(pVM, pCritSect, rcBusy, pSrcPos);
 }
 
 
@@ -641,11 +680,19 @@ PDMCritSectEnterDebug(PVMCC pVM, PPDMCRITSECT pCritSect, int rcBusy, RTHCUINTPTR
 {
 #ifdef PDMCRITSECT_STRICT
     RTLOCKVALSRCPOS SrcPos = RTLOCKVALSRCPOS_INIT_DEBUG_API();
-    return pdmCritSectEnter(pVM, pCritSect, rcBusy, &SrcPos);
+    PCRTLOCKVALSRCPOS const pSrcPos = &SrcPos;
 #else
     NOREF(uId); RT_SRC_POS_NOREF();
-    return pdmCritSectEnter(pVM, pCritSect, rcBusy, NULL);
+    PCRTLOCKVALSRCPOS const pSrcPos = NULL;
 #endif
+#ifdef IN_RING3
+    if (RT_LIKELY(!pCritSect->s.pProfR3))
+    { /* likely */ }
+    else
+        return pdmR3CritSectEnterProfiled(pVM, pCritSect, rcBusy, false /*fTryOnly*/, pSrcPos,
+                                          uId ? (uintptr_t)uId : (uintptr_t)ASMReturnAddress());
+#endif
+    return pdmCritSectEnter(pVM, pCritSect, rcBusy, pSrcPos);
 }
 
 
@@ -730,11 +777,19 @@ static int pdmCritSectTryEnter(PVMCC pVM, PPDMCRITSECT pCritSect, PCRTLOCKVALSRC
 VMMDECL(DECL_CHECK_RETURN(int)) PDMCritSectTryEnter(PVMCC pVM, PPDMCRITSECT pCritSect)
 {
 #ifndef PDMCRITSECT_STRICT
-    return pdmCritSectTryEnter(pVM, pCritSect, NULL);
+    PCRTLOCKVALSRCPOS const pSrcPos = NULL;
 #else
     RTLOCKVALSRCPOS SrcPos = RTLOCKVALSRCPOS_INIT_NORMAL_API();
-    return pdmCritSectTryEnter(pVM, pCritSect, &SrcPos);
+    PCRTLOCKVALSRCPOS const pSrcPos = &SrcPos;
 #endif
+#ifdef IN_RING3
+    if (RT_LIKELY(!pCritSect->s.pProfR3))
+    { /* likely */ }
+    else
+        return pdmR3CritSectEnterProfiled(pVM, pCritSect, VERR_SEM_BUSY, true /*fTryOnly*/, pSrcPos,
+                                          (uintptr_t)ASMReturnAddress());
+#endif
+    return pdmCritSectTryEnter(pVM, pCritSect, pSrcPos);
 }
 
 
@@ -759,11 +814,19 @@ PDMCritSectTryEnterDebug(PVMCC pVM, PPDMCRITSECT pCritSect, RTHCUINTPTR uId, RT_
 {
 #ifdef PDMCRITSECT_STRICT
     RTLOCKVALSRCPOS SrcPos = RTLOCKVALSRCPOS_INIT_DEBUG_API();
-    return pdmCritSectTryEnter(pVM, pCritSect, &SrcPos);
+    PCRTLOCKVALSRCPOS const pSrcPos = &SrcPos;
 #else
     NOREF(uId); RT_SRC_POS_NOREF();
-    return pdmCritSectTryEnter(pVM, pCritSect, NULL);
+    PCRTLOCKVALSRCPOS const pSrcPos = NULL;
+#endif
+#ifdef IN_RING3
+    if (RT_LIKELY(!pCritSect->s.pProfR3))
+    { /* likely */ }
+    else
+        return pdmR3CritSectEnterProfiled(pVM, pCritSect, VERR_SEM_BUSY, true /*fTryOnly*/, pSrcPos,
+                                          uId ? (uintptr_t)uId : (uintptr_t)ASMReturnAddress());
 #endif
+    return pdmCritSectTryEnter(pVM, pCritSect, pSrcPos);
 }
 
 
@@ -864,6 +927,11 @@ VMMDECL(int) PDMCritSectLeave(PVMCC pVM, PPDMCRITSECT pCritSect)
 # endif
     Assert(!pCritSect->s.Core.pValidatorRec || pCritSect->s.Core.pValidatorRec->hThread == NIL_RTTHREAD);
 
+    if (RT_LIKELY(!pCritSect->s.pProfR3))
+    { /* likely */ }
+    else
+        pdmR3CritSectProfLeaving(pCritSect->s.pProfR3);
+
 # ifdef PDMCRITSECT_WITH_LESS_ATOMIC_STUFF
     //pCritSect->s.Core.cNestings = 0; /* not really needed */
     pCritSect->s.Core.NativeThreadOwner = NIL_RTNATIVETHREAD;
@@ -48,7 +48,7 @@
 # include <iprt/semaphore.h>
 # include <iprt/thread.h>
 #endif
-#ifdef IN_RING0
+#if defined(IN_RING3) || defined(IN_RING0)
 # include <iprt/time.h>
 #endif
 #ifdef RT_ARCH_AMD64
@@ -1529,6 +1529,41 @@ static int pdmCritSectRwEnterExcl(PVMCC pVM, PPDMCRITSECTRW pThis, int rcBusy, b
 }
 
 
+#ifdef IN_RING3
+/**
+ * Ring-3 exclusive enter worker used when contention profiling is enabled for
+ * the critical section.
+ *
+ * @returns See pdmCritSectRwEnterExcl.
+ * @param   pVM         The cross context VM structure.
+ * @param   pThis       Pointer to the read/write critical section.
+ * @param   rcBusy      The busy return code for ring-0 and ring-3.
+ * @param   fTryOnly    Only try enter it, don't wait.
+ * @param   pSrcPos     The source position. (Can be NULL.)
+ * @param   fNoVal      No validation records.
+ * @param   uCaller     The return address of the API caller.
+ */
+DECL_NO_INLINE(static, int) pdmR3CritSectRwEnterExclProfiled(PVMCC pVM, PPDMCRITSECTRW pThis, int rcBusy, bool fTryOnly,
+                                                              PCRTLOCKVALSRCPOS pSrcPos, bool fNoVal, uintptr_t uCaller)
+{
+    RTNATIVETHREAD hNativeWriter;
+    ASMAtomicUoReadHandle(&pThis->s.Core.u.s.hNativeWriter, &hNativeWriter);
+    uint64_t const u64State    = PDMCRITSECTRW_READ_STATE(&pThis->s.Core.u.s.u64State);
+    bool const     fContended  = hNativeWriter != NIL_RTNATIVETHREAD
+                               ? hNativeWriter != RTThreadNativeSelf()
+                               :    (u64State & RTCSRW_DIR_MASK) == (RTCSRW_DIR_READ << RTCSRW_DIR_SHIFT)
+                                 && (u64State & RTCSRW_CNT_RD_MASK) != 0;
+    uint64_t const nsStartWait = fContended && !fTryOnly ? RTTimeNanoTS() : 0;
+
+    int const rc = pdmCritSectRwEnterExcl(pVM, pThis, rcBusy, fTryOnly, pSrcPos, fNoVal);
+    if (   rc == VINF_SUCCESS
+        && pThis->s.Core.cWriteRecursions == 1)
+        pdmR3CritSectProfEntered(pThis->s.pProfR3, uCaller, nsStartWait);
+    return rc;
+}
+#endif /* IN_RING3 */
+
+
 /**
  * Try enter a critical section with exclusive (write) access.
  *
@@ -1552,11 +1587,19 @@ static int pdmCritSectRwEnterExcl(PVMCC pVM, PPDMCRITSECTRW pThis, int rcBusy, b
 VMMDECL(int) PDMCritSectRwEnterExcl(PVMCC pVM, PPDMCRITSECTRW pThis, int rcBusy)
 {
 #if !defined(PDMCRITSECTRW_STRICT) || !defined(IN_RING3)
-    return pdmCritSectRwEnterExcl(pVM, pThis, rcBusy, false /*fTryAgain*/, NULL,    false /*fNoVal*/);
+    PCRTLOCKVALSRCPOS const pSrcPos = NULL;
 #else
     RTLOCKVALSRCPOS SrcPos = RTLOCKVALSRCPOS_INIT_NORMAL_API();
-    return pdmCritSectRwEnterExcl(pVM, pThis, rcBusy, false /*fTryAgain*/, &SrcPos, false /*fNoVal*/);
+    PCRTLOCKVALSRCPOS const pSrcPos = &SrcPos;
 #endif
+#ifdef IN_RING3
+    if (RT_LIKELY(!pThis->s.pProfR3))
+    { /* likely */ }
+    else
+        return pdmR3CritSectRwEnterExclProfiled(pVM, pThis, rcBusy, false /*fTryAgain*/, pSrcPos, false /*fNoVal*/,
+                                                (uintptr_t)ASMReturnAddress());
+#endif
+    return pdmCritSectRwEnterExcl(pVM, pThis, rcBusy, false /*fTryAgain*/, pSrcPos, false /*fNoVal*/);
 }
 
 
@@ -1586,11 +1629,19 @@ VMMDECL(int) PDMCritSectRwEnterExclDebug(PVMCC pVM, PPDMCRITSECTRW pThis, int rc
 {
     NOREF(uId); NOREF(pszFile); NOREF(iLine); NOREF(pszFunction);
 #if !defined(PDMCRITSECTRW_STRICT) || !defined(IN_RING3)
-    return pdmCritSectRwEnterExcl(pVM, pThis, rcBusy, false /*fTryAgain*/, NULL,    false /*fNoVal*/);
+    PCRTLOCKVALSRCPOS const pSrcPos = NULL;
 #else
     RTLOCKVALSRCPOS SrcPos = RTLOCKVALSRCPOS_INIT_DEBUG_API();
-    return pdmCritSectRwEnterExcl(pVM, pThis, rcBusy, false /*fTryAgain*/, &SrcPos, false /*fNoVal*/);
+    PCRTLOCKVALSRCPOS const pSrcPos = &SrcPos;
 #endif
+#ifdef IN_RING3
+    if (RT_LIKELY(!pThis->s.pProfR3))
+    { /* likely */ }
+    else
+        return pdmR3CritSectRwEnterExclProfiled(pVM, pThis, rcBusy, false /*fTryAgain*/, pSrcPos, false /*fNoVal*/,
+                                                (uintptr_t)ASMReturnAddress());
+#endif
+    return pdmCritSectRwEnterExcl(pVM, pThis, rcBusy, false /*fTryAgain*/, pSrcPos, false /*fNoVal*/);
 }
 
 
@@ -1613,11 +1664,19 @@ VMMDECL(int) PDMCritSectRwEnterExclDebug(PVMCC pVM, PPDMCRITSECTRW pThis, int rc
 VMMDECL(int) PDMCritSectRwTryEnterExcl(PVMCC pVM, PPDMCRITSECTRW pThis)
 {
 #if !defined(PDMCRITSECTRW_STRICT) || !defined(IN_RING3)
-    return pdmCritSectRwEnterExcl(pVM, pThis, VERR_SEM_BUSY, true /*fTryAgain*/, NULL,    false /*fNoVal*/);
+    PCRTLOCKVALSRCPOS const pSrcPos = NULL;
 #else
     RTLOCKVALSRCPOS SrcPos = RTLOCKVALSRCPOS_INIT_NORMAL_API();
-    return pdmCritSectRwEnterExcl(pVM, pThis, VERR_SEM_BUSY, true /*fTryAgain*/, &SrcPos, false /*fNoVal*/);
+    PCRTLOCKVALSRCPOS const pSrcPos = &SrcPos;
 #endif
+#ifdef IN_RING3
+    if (RT_LIKELY(!pThis->s.pProfR3))
+    { /* likely */ }
+    else
+        return pdmR3CritSectRwEnterExclProfiled(pVM, pThis, VERR_SEM_BUSY, true /*fTryAgain*/, pSrcPos, false /*fNoVal*/,
+                                                (uintptr_t)ASMReturnAddress());
+#endif
+    return pdmCritSectRwEnterExcl(pVM, pThis, VERR_SEM_BUSY, true /*fTryAgain*/, pSrcPos, false /*fNoVal*/);
 }
 
 
@@ -1643,11 +1702,19 @@ VMMDECL(int) PDMCritSectRwTryEnterExclDebug(PVMCC pVM, PPDMCRITSECTRW pThis, RTH
 {
     NOREF(uId); NOREF(pszFile); NOREF(iLine); NOREF(pszFunction);
 #if !defined(PDMCRITSECTRW_STRICT) || !defined(IN_RING3)
-    return pdmCritSectRwEnterExcl(pVM, pThis, VERR_SEM_BUSY, true /*fTryAgain*/, NULL,    false /*fNoVal*/);
+    PCRTLOCKVALSRCPOS const pSrcPos = NULL;
 #else
     RTLOCKVALSRCPOS SrcPos = RTLOCKVALSRCPOS_INIT_DEBUG_API();
-    return pdmCritSectRwEnterExcl(pVM, pThis, VERR_SEM_BUSY, true /*fTryAgain*/, &SrcPos, false /*fNoVal*/);
+    PCRTLOCKVALSRCPOS const pSrcPos = &SrcPos;
+#endif
+#ifdef IN_RING3
+    if (RT_LIKELY(!pThis->s.pProfR3))
+    { /* likely */ }
+    else
+        return pdmR3CritSectRwEnterExclProfiled(pVM, pThis, VERR_SEM_BUSY, true /*fTryAgain*/, pSrcPos, false /*fNoVal*/,
+                                                (uintptr_t)ASMReturnAddress());
 #endif
+    return pdmCritSectRwEnterExcl(pVM, pThis, VERR_SEM_BUSY, true /*fTryAgain*/, pSrcPos, false /*fNoVal*/);
 }
 
 
@@ -1665,6 +1732,11 @@ VMMDECL(int) PDMCritSectRwTryEnterExclDebug(PVMCC pVM, PPDMCRITSECTRW pThis, RTH
  */
 VMMR3DECL(int) PDMR3CritSectRwEnterExclEx(PVM pVM, PPDMCRITSECTRW pThis, bool fCallRing3)
 {
+    if (RT_LIKELY(!pThis->s.pProfR3))
+    { /* likely */ }
+    else
+        return pdmR3CritSectRwEnterExclProfiled(pVM, pThis, VERR_SEM_BUSY, false /*fTryAgain*/, NULL, fCallRing3 /*fNoVal*/,
+                                                (uintptr_t)ASMReturnAddress());
     return pdmCritSectRwEnterExcl(pVM, pThis, VERR_SEM_BUSY, false /*fTryAgain*/, NULL, fCallRing3 /*fNoVal*/);
 }
 #endif /* IN_RING3 */
@@ -1743,6 +1815,12 @@ static int pdmCritSectRwLeaveExclWorker(PVMCC pVM, PPDMCRITSECTRW pThis, bool fN
             return rc9;
     }
 #endif
+#ifdef IN_RING3
+    if (RT_LIKELY(!pThis->s.pProfR3))
+    { /* likely */ }
+    else
+        pdmR3CritSectProfLeaving(pThis->s.pProfR3);
+#endif
 
 
 #ifdef RTASM_HAVE_CMP_WRITE_U128
@@ -41,6 +41,9 @@
 #include <iprt/asm.h>
 #include <iprt/assert.h>
 #include <iprt/string.h>
+#ifdef VBOX_WITH_STATISTICS
+# include <iprt/time.h>
+#endif
 
 
 /*********************************************************************************************************************************
@@ -109,18 +112,35 @@
 #endif
 
 
+/**
+ * Calculates the size of the allocation bitmap and ring for a queue.
+ *
+ * @param   cItems      Number of items in the queue.
+ * @param   pcbBitmap   Where to return the bitmap size (multiple of 64).
+ * @param   pcbRing     Where to return the ring size (multiple of 64).
+ */
+void pdmQueueCalcLayout(uint32_t cItems, uint32_t *pcbBitmap, uint32_t *pcbRing)
+{
+    Assert(cItems > 0 && cItems <= PDMQUEUE_MAX_ITEMS);
+    uint32_t const cRingEntries = cItems > 1 ? RT_BIT_32(ASMBitLastSetU32(cItems - 1)) : 1;
+    *pcbBitmap = RT_ALIGN_32(RT_ALIGN_32(cItems, 64) / 8, 64); /* keep bitmap in it's own cacheline  */
+    *pcbRing   = RT_ALIGN_32(cRingEntries * sizeof(uint32_t), 64);
+}
+
+
 /**
  * Commmon function for initializing the shared queue structure.
  */
-void pdmQueueInit(PPDMQUEUE pQueue, uint32_t cbBitmap, uint32_t cbItem, uint32_t cItems,
+void pdmQueueInit(PPDMQUEUE pQueue, uint32_t cbBitmap, uint32_t cbRing, uint32_t cbItem, uint32_t cItems,
                   const char *pszName, PDMQUEUETYPE enmType, RTR3PTR pfnCallback, RTR3PTR pvOwner)
 {
     Assert(cbBitmap * 8 >= cItems);
+    Assert(cbRing / sizeof(uint32_t) >= cItems);
 
     pQueue->u32Magic            = PDMQUEUE_MAGIC;
     pQueue->cbItem              = cbItem;
     pQueue->cItems              = cItems;
-    pQueue->offItems            = RT_UOFFSETOF(PDMQUEUE, bmAlloc) + cbBitmap;
+    pQueue->offItems            = RT_UOFFSETOF(PDMQUEUE, bmAlloc) + cbBitmap + cbRing;
     pQueue->rcOkay              = VINF_SUCCESS;
     pQueue->u32Padding          = 0;
     pQueue->hTimer              = NIL_TMTIMERHANDLE;
@@ -129,11 +149,18 @@ void pdmQueueInit(PPDMQUEUE pQueue, uint32_t cbBitmap, uint32_t cbItem, uint32_t
     pQueue->u.Gen.pfnCallback   = pfnCallback;
     pQueue->u.Gen.pvOwner       = pvOwner;
     RTStrCopy(pQueue->szName, sizeof(pQueue->szName), pszName);
-    pQueue->iPending            = UINT32_MAX;
-    RT_BZERO(pQueue->bmAlloc, cbBitmap);
+    pQueue->idxRingProducer     = 0;
+    pQueue->idxRingConsumer     = 0;
+    pQueue->fRingMask           = cItems > 1 ? RT_BIT_32(ASMBitLastSetU32(cItems - 1)) - 1 : 0;
+    pQueue->offRing             = RT_UOFFSETOF(PDMQUEUE, bmAlloc) + cbBitmap;
+    pQueue->fKickPending        = false;
+    pQueue->fPollMode           = false;
+    pQueue->cTimerInserts       = 0;
+    Assert((pQueue->fRingMask + 1) * sizeof(uint32_t) <= cbRing);
+    RT_BZERO(pQueue->bmAlloc, cbBitmap + cbRing);
     ASMBitSetRange(pQueue->bmAlloc, 0, cItems);
 
-    uint8_t *pbItem = (uint8_t *)&pQueue->bmAlloc[0] + cbBitmap;
+    uint8_t *pbItem = (uint8_t *)pQueue + pQueue->offItems;
     while (cItems-- > 0)
     {
         ((PPDMQUEUEITEMCORE)pbItem)->u64View = UINT64_C(0xfeedfeedfeedfeed);
@@ -144,6 +171,19 @@ void pdmQueueInit(PPDMQUEUE pQueue, uint32_t cbBitmap, uint32_t cbItem, uint32_t
 }
 
 
+/**
+ * Checks if there are items ready for the consumer.
+ *
+ * @returns true if the ring entry at the consumer index has been published.
+ * @param   pQueue      The shared queue structure.
+ */
+bool pdmQueueIsPending(PPDMQUEUE pQueue)
+{
+    uint32_t volatile const *pauRing = (uint32_t volatile const *)((uint8_t *)pQueue + pQueue->offRing);
+    return pauRing[ASMAtomicUoReadU32(&pQueue->idxRingConsumer) & pQueue->fRingMask] != 0;
+}
+
+
 /**
  * Allocate an item from a queue, extended version.
  *
@@ -266,19 +306,35 @@ VMMDECL(int) PDMQueueInsert(PVMCC pVM, PDMQUEUEHANDLE hQueue, void *pvOwner, PPD
     AssertReturn(ASMBitTest(pQueue->bmAlloc, iInsert) == false, VERR_INVALID_PARAMETER);
 
     /*
-     * Append the item to the pending list.
+     * Claim a ring entry and publish the item in it.  The consumer stops at
+     * entries that have been claimed but not yet published, so per-producer
+     * ordering is preserved.
      */
-    for (;;)
+#ifdef VBOX_WITH_STATISTICS
+    pInsert->u64View = RTTimeNanoTS();
+#endif
+    uint32_t const            idxRing = ASMAtomicIncU32(&pQueue->idxRingProducer) - 1;
+    uint32_t volatile * const puEntry = (uint32_t volatile *)((uint8_t *)pQueue + pQueue->offRing)
+                                      + (idxRing & pQueue->fRingMask);
+    AssertReturn(*puEntry == 0, pQueue->rcOkay = VERR_INTERNAL_ERROR_2);
+    ASMAtomicWriteU32(puEntry, (uint32_t)iInsert + 1);
+
+    /*
+     * Wake up the consumer.  Only the first insert after the consumer has
+     * started flushing needs to do this.  Interval queues leave it to the
+     * timer while inserts are frequent enough to be worth batching.
+     */
+    bool fKick = true;
+    if (pQueue->hTimer != NIL_TMTIMERHANDLE)
     {
-        uint32_t const iOldPending = ASMAtomicUoReadU32(&pQueue->iPending);
-        pInsert->iNext = iOldPending;
-        if (ASMAtomicCmpXchgU32(&pQueue->iPending, iInsert, iOldPending))
-            break;
-        ASMNopPause();
+        ASMAtomicIncU32(&pQueue->cTimerInserts);
+        fKick = !ASMAtomicUoReadBool(&pQueue->fPollMode);
     }
-
-    if (pQueue->hTimer == NIL_TMTIMERHANDLE)
+    if (fKick && !ASMAtomicXchgBool(&pQueue->fKickPending, true))
+    {
         pdmQueueSetFF(pVM);
+        STAM_REL_COUNTER_INC(&pQueue->StatKicks);
+    }
     STAM_REL_COUNTER_INC(&pQueue->StatInsert);
     STAM_STATS({ ASMAtomicIncU32(&pQueue->cStatPending); });
 
@@ -308,7 +364,7 @@ VMMDECL(int) PDMQueueFlushIfNecessary(PVMCC pVM, PDMQUEUEHANDLE hQueue, void *pv
     /*
      * Check and maybe flush.
      */
-    if (ASMAtomicUoReadU32(&pQueue->iPending) != UINT32_MAX)
+    if (pdmQueueIsPending(pQueue))
     {
         pdmQueueSetFF(pVM);
         return VINF_SUCCESS;
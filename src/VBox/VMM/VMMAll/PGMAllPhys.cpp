@@ -2265,6 +2265,7 @@ int pgmPhysAllocPage(PVMCC pVM, PPGMPAGE pPage, RTGCPHYS GCPhys)
         Log(("PGM: Replaced shared page %#x at %RGp with %#x / %RHp\n", PGM_PAGE_GET_PAGEID(pPage),
              GCPhys, pVM->pgm.s.aHandyPages[iHandyPage].idPage, HCPhys));
         STAM_COUNTER_INC(&pVM->pgm.s.Stats.CTX_MID_Z(Stat,PageReplaceShared));
+        STAM_REL_COUNTER_INC(&pVM->pgm.s.StatPageDedupBroken);
         pVM->pgm.s.cSharedPages--;
 
         /* Grab the address of the page so we can make a copy later on. (safe) */
@@ -2495,6 +2496,63 @@ int pgmPhysRecheckLargePage(PVMCC pVM, RTGCPHYS GCPhys, PPGMPAGE pLargePage)
     return VERR_PGM_INVALID_LARGE_PAGE_RANGE;
 }
 
+
+/**
+ * Checks whether a 2 MB range of 4 KB backed RAM can be coalesced into a
+ * large page.
+ *
+ * All pages must be plain RAM that is either allocated or zero, without any
+ * access handlers or mapping locks, and not already part of a large page.
+ *
+ * @returns The following VBox status codes.
+ * @retval  VINF_SUCCESS if the range can be coalesced.
+ * @retval  VERR_PGM_INVALID_LARGE_PAGE_RANGE if it can't.
+ *
+ * @param   pVM         The cross context VM structure.
+ * @param   GCPhys      The 2 MB aligned guest physical address.
+ * @param   pcAllocated Where to return the number of allocated (i.e. not
+ *                      zero) pages in the range.  Optional.
+ *
+ * @remarks Must be called from within the PGM critical section.
+ */
+int pgmPhysIsCoalescableLargePageRange(PVMCC pVM, RTGCPHYS GCPhys, uint32_t *pcAllocated)
+{
+    PGM_LOCK_ASSERT_OWNER(pVM);
+    Assert(!(GCPhys & X86_PAGE_2M_OFFSET_MASK));
+
+    uint32_t cAllocated = 0;
+    for (unsigned i = 0; i < _2M / GUEST_PAGE_SIZE; i++, GCPhys += GUEST_PAGE_SIZE)
+    {
+        PPGMPAGE pPage;
+        int rc = pgmPhysGetPageEx(pVM, GCPhys, &pPage);
+        if (RT_FAILURE(rc))
+            return VERR_PGM_INVALID_LARGE_PAGE_RANGE;
+
+        if (   PGM_PAGE_GET_TYPE(pPage) != PGMPAGETYPE_RAM
+            || PGM_PAGE_GET_HNDL_PHYS_STATE(pPage) != PGM_PAGE_HNDL_PHYS_STATE_NONE
+            || PGM_PAGE_GET_READ_LOCKS(pPage) != 0
+            || PGM_PAGE_GET_WRITE_LOCKS(pPage) != 0
+            || PGM_PAGE_GET_PDE_TYPE(pPage) == PGM_PAGE_PDE_TYPE_PDE
+            || PGM_PAGE_GET_PDE_TYPE(pPage) == PGM_PAGE_PDE_TYPE_PDE_DISABLED)
+            return VERR_PGM_INVALID_LARGE_PAGE_RANGE;
+
+        switch (PGM_PAGE_GET_STATE(pPage))
+        {
+            case PGM_PAGE_STATE_ALLOCATED:
+                cAllocated++;
+                break;
+            case PGM_PAGE_STATE_ZERO:
+                break;
+            default: /* shared, write monitored and ballooned pages are left alone */
+                return VERR_PGM_INVALID_LARGE_PAGE_RANGE;
+        }
+    }
+
+    if (pcAllocated)
+        *pcAllocated = cAllocated;
+    return VINF_SUCCESS;
+}
+
 #endif /* PGM_WITH_LARGE_PAGES */
 
 
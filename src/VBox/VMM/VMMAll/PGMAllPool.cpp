@@ -5300,6 +5300,49 @@ int pgmPoolFlushPage(PPGMPOOL pPool, PPGMPOOLPAGE pPage, bool fFlush)
 }
 
 
+/**
+ * Flushes the physical page tables covering a 2 MB guest physical range.
+ *
+ * This is used after the range has been coalesced into a large page so that
+ * the next SyncPT call on the range will install a 2 MB PDE.
+ * pgmPoolFlushPageByGCPhys ignores the *_FOR_PHYS kinds, so we do our own
+ * hash lookup here.
+ *
+ * @returns Number of pool pages flushed.
+ * @param   pVM         The cross context VM structure.
+ * @param   GCPhys2M    The 2 MB aligned guest physical address.
+ *
+ * @remarks Must be called from within the PGM critical section.
+ */
+uint32_t pgmPoolFlushPhysPTsFor2MRange(PVMCC pVM, RTGCPHYS GCPhys2M)
+{
+    PPGMPOOL pPool = pVM->pgm.s.CTX_SUFF(pPool);
+    PGM_LOCK_ASSERT_OWNER(pVM);
+    Assert(!(GCPhys2M & X86_PAGE_2M_OFFSET_MASK));
+
+    uint32_t cFlushed = 0;
+    unsigned i        = pPool->aiHash[PGMPOOL_HASH(GCPhys2M)];
+    while (i != NIL_PGMPOOL_IDX)
+    {
+        PPGMPOOLPAGE pPage = &pPool->aPages[i];
+        if (   pPage->GCPhys == GCPhys2M
+            && (   pPage->enmKind == PGMPOOLKIND_EPT_PT_FOR_PHYS
+                || pPage->enmKind == PGMPOOLKIND_PAE_PT_FOR_PHYS)
+            && !pgmPoolIsPageLocked(pPage))
+        {
+            pgmPoolFlushPage(pPool, pPage);
+            cFlushed++;
+
+            /* The hash chain may have changed, restart the scan. */
+            i = pPool->aiHash[PGMPOOL_HASH(GCPhys2M)];
+            continue;
+        }
+        i = pPage->iNext;
+    }
+    return cFlushed;
+}
+
+
 /**
  * Frees a usage of a pool page.
  *
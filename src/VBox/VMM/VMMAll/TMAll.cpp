@@ -467,9 +467,71 @@ DECLINLINE(bool) tmTimerTryWithLink(PTMTIMERQUEUECC pQueueCC, PTMTIMERQUEUE pQue
 }
 
 
+/**
+ * Looks up a timer to start the active list insertion walk from.
+ *
+ * @returns Timer linked into the active list expiring no later than
+ *          @a u64Expire, NULL if the timer wheel has no usable hint.
+ * @param   pQueueCC        The current context queue (same as @a pQueue for
+ *                          ring-3).
+ * @param   pQueue          The shared queue data.
+ * @param   u64Expire       The expiration time of the timer being inserted.
+ */
+DECL_FORCE_INLINE(PTMTIMER) tmTimerQueueWheelLookup(PTMTIMERQUEUECC pQueueCC, PTMTIMERQUEUE pQueue, uint64_t u64Expire)
+{
+    unsigned cShift = pQueue->cWheelShift;
+    for (unsigned iLevel = 0; iLevel < TMTIMERQUEUE_WHEEL_LEVELS; iLevel++, cShift += TMTIMERQUEUE_WHEEL_SLOTS_SHIFT)
+    {
+        /* Probe the slot of the new timer and the ones preceeding it.  The
+           epoch check skips hints left behind by earlier wheel revolutions. */
+        uint64_t       uEpoch  = u64Expire >> cShift;
+        unsigned const cProbes = (unsigned)RT_MIN(uEpoch + 1, TMTIMERQUEUE_WHEEL_PROBES);
+        for (unsigned iProbe = 0; iProbe < cProbes; iProbe++, uEpoch--)
+        {
+            uint32_t const idxHint = pQueue->aidxWheel[iLevel][uEpoch & (TMTIMERQUEUE_WHEEL_SLOTS - 1)];
+            PTMTIMER const pHint   = tmTimerQueueValidateHint(pQueueCC, pQueue, idxHint, u64Expire);
+            if (pHint && (pHint->u64Expire >> cShift) == uEpoch)
+                return pHint;
+        }
+    }
+    return NULL;
+}
+
+
+/**
+ * Records a newly linked timer in the timer wheel.
+ *
+ * Each slot keeps the latest expiring timer, as that's the one closest to
+ * where the timers of the following slots are inserted.
+ *
+ * @param   pQueueCC        The current context queue (same as @a pQueue for
+ *                          ring-3).
+ * @param   pQueue          The shared queue data.
+ * @param   idxTimer        The index of the timer.
+ * @param   u64Expire       The timer expiration time.
+ */
+DECL_FORCE_INLINE(void) tmTimerQueueWheelInsert(PTMTIMERQUEUECC pQueueCC, PTMTIMERQUEUE pQueue, uint32_t idxTimer, uint64_t u64Expire)
+{
+    unsigned cShift = pQueue->cWheelShift;
+    for (unsigned iLevel = 0; iLevel < TMTIMERQUEUE_WHEEL_LEVELS; iLevel++, cShift += TMTIMERQUEUE_WHEEL_SLOTS_SHIFT)
+    {
+        uint32_t * const pidxSlot = &pQueue->aidxWheel[iLevel][(u64Expire >> cShift) & (TMTIMERQUEUE_WHEEL_SLOTS - 1)];
+        PTMTIMER const   pCur     = tmTimerQueueValidateHint(pQueueCC, pQueue, *pidxSlot, UINT64_MAX);
+        if (   !pCur
+            || (pCur->u64Expire >> cShift) != (u64Expire >> cShift)
+            || pCur->u64Expire <= u64Expire)
+            *pidxSlot = idxTimer;
+    }
+}
+
+
 /**
  * Links a timer into the active list of a timer queue.
  *
+ * The list is kept sorted by expire time.  Instead of walking it from the head,
+ * the walk starts at the tail or a timer wheel hint when one is available, so
+ * the cost is independent of the number of active timers in the common cases.
+ *
  * @param   pVM             The cross context VM structure.
  * @param   pQueueCC        The current context queue (same as @a pQueue for
  *                          ring-3).
@@ -487,42 +549,73 @@ DECL_FORCE_INLINE(void) tmTimerQueueLinkActive(PVMCC pVM, PTMTIMERQUEUECC pQueue
     Assert(pTimer->enmState == TMTIMERSTATE_ACTIVE || pQueue->enmClock != TMCLOCK_VIRTUAL_SYNC); /* (active is not a stable state) */
     RT_NOREF(pVM);
 
-    PTMTIMER pCur = tmTimerQueueGetHead(pQueueCC, pQueue);
+    uint32_t const idxTimer = (uint32_t)(pTimer - &pQueueCC->paTimers[0]);
+    PTMTIMER       pCur     = tmTimerQueueGetHead(pQueueCC, pQueue);
     if (pCur)
     {
-        for (;; pCur = tmTimerGetNext(pQueueCC, pCur))
+        if (pCur->u64Expire > u64Expire)
+        {
+            tmTimerSetNext(pQueueCC, pTimer, pCur);
+            tmTimerSetPrev(pQueueCC, pCur, pTimer);
+            tmTimerQueueSetHead(pQueueCC, pQueue, pTimer);
+            ASMAtomicWriteU64(&pQueue->u64Expire, u64Expire);
+            STAM_COUNTER_INC(&pQueue->StatLinkHead);
+            DBGFTRACE_U64_TAG2(pVM, u64Expire, "tmTimerQueueLinkActive head", pTimer->szName);
+        }
+        else
         {
-            if (pCur->u64Expire > u64Expire)
+            /*
+             * Pick the starting point: the tail if we're appending, otherwise
+             * the closest timer wheel hint, falling back on the head.
+             */
+            PTMTIMER pStart = tmTimerQueueValidateHint(pQueueCC, pQueue, pQueue->idxActiveTail, u64Expire);
+            if (pStart && pStart->idxNext == UINT32_MAX)
+                STAM_COUNTER_INC(&pQueue->StatLinkTail);
+            else if ((pStart = tmTimerQueueWheelLookup(pQueueCC, pQueue, u64Expire)) != NULL)
+                STAM_COUNTER_INC(&pQueue->StatLinkWheel);
+            else
+                STAM_COUNTER_INC(&pQueue->StatLinkScan);
+            if (pStart)
+                pCur = pStart;
+
+            /*
+             * Walk forward to the last timer expiring no later than the new one
+             * and link it in after that.
+             */
+            PTMTIMER pNext;
+#ifdef VBOX_WITH_STATISTICS
+            uint32_t cSteps = 0;
+#endif
+            while ((pNext = tmTimerGetNext(pQueueCC, pCur)) != NULL && pNext->u64Expire <= u64Expire)
             {
-                const PTMTIMER pPrev = tmTimerGetPrev(pQueueCC, pCur);
-                tmTimerSetNext(pQueueCC, pTimer, pCur);
-                tmTimerSetPrev(pQueueCC, pTimer, pPrev);
-                if (pPrev)
-                    tmTimerSetNext(pQueueCC, pPrev, pTimer);
-                else
-                {
-                    tmTimerQueueSetHead(pQueueCC, pQueue, pTimer);
-                    ASMAtomicWriteU64(&pQueue->u64Expire, u64Expire);
-                    DBGFTRACE_U64_TAG2(pVM, u64Expire, "tmTimerQueueLinkActive head", pTimer->szName);
-                }
-                tmTimerSetPrev(pQueueCC, pCur, pTimer);
-                return;
+                pCur = pNext;
+#ifdef VBOX_WITH_STATISTICS
+                cSteps++;
+#endif
             }
-            if (pCur->idxNext == UINT32_MAX)
+            STAM_COUNTER_ADD(&pQueue->StatLinkSteps, cSteps);
+
+            tmTimerSetNext(pQueueCC, pTimer, pNext);
+            tmTimerSetPrev(pQueueCC, pTimer, pCur);
+            tmTimerSetNext(pQueueCC, pCur, pTimer);
+            if (pNext)
+                tmTimerSetPrev(pQueueCC, pNext, pTimer);
+            else
             {
-                tmTimerSetNext(pQueueCC, pCur, pTimer);
-                tmTimerSetPrev(pQueueCC, pTimer, pCur);
+                pQueue->idxActiveTail = idxTimer;
                 DBGFTRACE_U64_TAG2(pVM, u64Expire, "tmTimerQueueLinkActive tail", pTimer->szName);
-                return;
             }
         }
     }
     else
     {
         tmTimerQueueSetHead(pQueueCC, pQueue, pTimer);
+        pQueue->idxActiveTail = idxTimer;
         ASMAtomicWriteU64(&pQueue->u64Expire, u64Expire);
         DBGFTRACE_U64_TAG2(pVM, u64Expire, "tmTimerQueueLinkActive empty", pTimer->szName);
     }
+
+    tmTimerQueueWheelInsert(pQueueCC, pQueue, idxTimer, u64Expire);
 }
 
 
@@ -161,6 +161,7 @@ static int dbgfR0TracerCreateWorker(PGVM pGVM, uint32_t cbRingBuf, RTRGPTR RCPtr
         pTracerIns->pSharedR0->idEvt            = 0;
         pTracerIns->pSharedR0->cbRingBuf        = cbRingBuf;
         pTracerIns->pSharedR0->fEvtsWaiting     = false;
+        pTracerIns->pSharedR0->fEvtsEnabled     = DBGF_TRACER_EVT_F_ALL;
         pTracerIns->pSharedR0->fFlushThrdActive = false;
 
         /*
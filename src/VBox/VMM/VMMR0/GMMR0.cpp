@@ -453,6 +453,28 @@ typedef struct GMMCHUNKTLB
 typedef GMMCHUNKTLB *PGMMCHUNKTLB;
 
 
+/**
+ * Entry in the content hash table used by GMMR0MergeDuplicatePage.
+ *
+ * The entry only records the last page seen with a given hash.  Whether that
+ * page is a shared page one can merge with, or just a private page that hints
+ * at a duplicate, is determined by looking at the page itself, so stale
+ * entries are harmless.
+ */
+typedef struct GMMDEDUPENTRY
+{
+    /** The content hash (ring-3 supplied). */
+    uint32_t            u32Hash;
+    /** The page id, NIL_GMM_PAGEID if unused. */
+    uint32_t            idPage;
+} GMMDEDUPENTRY;
+/** Pointer to a content hash table entry. */
+typedef GMMDEDUPENTRY *PGMMDEDUPENTRY;
+
+/** The number of entries in the content hash table (power of two). */
+#define GMM_DEDUP_HASH_ENTRIES          _64K
+
+
 /**
  * The GMM instance data.
  */
@@ -504,6 +526,11 @@ typedef struct GMM
     /** The chunk list.  For simplifying the cleanup process and avoid tree
      * traversal. */
     RTLISTANCHOR        ChunkList;
+#ifdef VBOX_WITH_PAGE_SHARING
+    /** The content hash table for duplicate page merging, allocated on first
+     * use (GMM_DEDUP_HASH_ENTRIES entries). */
+    PGMMDEDUPENTRY      paDedupHash;
+#endif
 
     /** The maximum number of pages we're allowed to allocate.
      * @gcfgm{GMM/MaxPages,64-bit, Direct.}
@@ -893,6 +920,12 @@ GMMR0DECL(void) GMMR0Term(void)
         pGMM->aChunkMtx[iMtx].hMtx = NIL_RTSEMFASTMUTEX;
     }
 
+#ifdef VBOX_WITH_PAGE_SHARING
+    /* The duplicate page merging hash table. */
+    RTMemFree(pGMM->paDedupHash);
+    pGMM->paDedupHash = NULL;
+#endif
+
     /* Finally the instance data itself. */
     RTMemFree(pGMM);
     LogFlow(("GMMTerm: done\n"));
@@ -5348,6 +5381,130 @@ GMMR0DECL(int) GMMR0SharedModuleCheckPage(PGVM pGVM, PGMMSHAREDMODULE pModule, u
 }
 
 
+/**
+ * Merges a private page with an identical shared page, if one is known.
+ *
+ * This is the guest additions independent counterpart to
+ * GMMR0SharedModuleCheckPage.  Pages are looked up in a global content hash
+ * table keyed by a hash supplied by ring-3:
+ *  - If the entry refers to a shared page with identical content, the private
+ *    page is freed and the shared page is returned in pPageDesc.
+ *  - If the entry refers to some other private page, the hash suggests this
+ *    page has a duplicate, so it is converted into a shared page that the
+ *    other page (and any later ones) can be merged with.
+ *  - Otherwise the page is just recorded in the table.
+ *
+ * @remarks ASSUMES the caller has acquired the GMM semaphore!!
+ *
+ * @returns VBox status code.
+ * @param   pGVM        Pointer to the GVM instance data.
+ * @param   u32Hash     The content hash of the page.
+ * @param   pPageDesc   Page descriptor.  On return idPage is NIL_GMM_PAGEID if
+ *                      nothing changed, otherwise it and HCPhys refer to the
+ *                      shared page now backing the guest page.
+ */
+GMMR0DECL(int) GMMR0MergeDuplicatePage(PGVM pGVM, uint32_t u32Hash, PGMMSHAREDPAGEDESC pPageDesc)
+{
+    PGMM    pGMM;
+    GMM_GET_VALID_INSTANCE(pGMM, VERR_GMM_INSTANCE);
+    pPageDesc->u32StrictChecksum = 0;
+
+    uint32_t const idPage = pPageDesc->idPage;
+    if (pGMM->fBoundMemoryMode)
+    {
+        pPageDesc->idPage = NIL_GMM_PAGEID;
+        return VINF_SUCCESS;
+    }
+
+    if (!pGMM->paDedupHash)
+    {
+        pGMM->paDedupHash = (PGMMDEDUPENTRY)RTMemAllocZ(sizeof(pGMM->paDedupHash[0]) * GMM_DEDUP_HASH_ENTRIES);
+        AssertReturn(pGMM->paDedupHash, VERR_NO_MEMORY);
+    }
+    PGMMDEDUPENTRY const pEntry = &pGMM->paDedupHash[u32Hash & (GMM_DEDUP_HASH_ENTRIES - 1)];
+
+    PGMMPAGE pLocalPage = gmmR0GetPage(pGMM, idPage);
+    AssertMsgReturn(pLocalPage && GMM_PAGE_IS_PRIVATE(pLocalPage) && pLocalPage->Private.hGVM == pGVM->hSelf,
+                    ("idPage=%#x GCPhys=%RGp\n", idPage, pPageDesc->GCPhys), VERR_PGM_PHYS_INVALID_PAGE_ID);
+
+    PGMMPAGE pPage;
+    if (   pEntry->u32Hash != u32Hash
+        || pEntry->idPage  == NIL_GMM_PAGEID
+        || pEntry->idPage  == idPage
+        || (pPage = gmmR0GetPage(pGMM, pEntry->idPage)) == NULL
+        || GMM_PAGE_IS_FREE(pPage))
+    {
+        /* Nothing (valid) known about this content yet, remember this page. */
+        pEntry->u32Hash   = u32Hash;
+        pEntry->idPage    = idPage;
+        pPageDesc->idPage = NIL_GMM_PAGEID;
+        return VINF_SUCCESS;
+    }
+
+    if (GMM_PAGE_IS_PRIVATE(pPage))
+    {
+        /*
+         * Someone else has the same hash, so make this page the shared copy.
+         * The hash may of course collide; a needlessly shared page only costs
+         * a copy-on-write fault should it be written to.
+         */
+        Log(("GMMR0MergeDuplicatePage: converting %#x (GCPhys=%RGp) to shared; hash %#x also seen for %#x\n",
+             idPage, pPageDesc->GCPhys, u32Hash, pEntry->idPage));
+        gmmR0ConvertToSharedPage(pGMM, pGVM, pPageDesc->HCPhys, idPage, pLocalPage, pPageDesc);
+        pEntry->idPage = idPage;
+        return VINF_SUCCESS;
+    }
+
+    /*
+     * A shared page with the same hash.  Compare the content.
+     */
+    Assert(GMM_PAGE_IS_SHARED(pPage));
+    PGMMCHUNK pChunk = gmmR0GetChunk(pGMM, idPage >> GMM_CHUNKID_SHIFT);
+    AssertMsgReturn(pChunk, ("idPage=%#x\n", idPage), VERR_PGM_PHYS_INVALID_PAGE_ID);
+    uint8_t *pbChunk;
+    AssertMsgReturn(gmmR0IsChunkMapped(pGMM, pGVM, pChunk, (PRTR3PTR)&pbChunk),
+                    ("idPage=%#x\n", idPage), VERR_PGM_PHYS_INVALID_PAGE_ID);
+    uint8_t const *pbLocalPage = pbChunk + ((idPage & GMM_PAGEID_IDX_MASK) << GUEST_PAGE_SHIFT);
+
+    pChunk = gmmR0GetChunk(pGMM, pEntry->idPage >> GMM_CHUNKID_SHIFT);
+    Assert(pChunk); /* can't fail as gmmR0GetPage succeeded. */
+    if (!gmmR0IsChunkMapped(pGMM, pGVM, pChunk, (PRTR3PTR)&pbChunk))
+    {
+        int rc = gmmR0MapChunk(pGMM, pGVM, pChunk, false /*fRelaxedSem*/, (PRTR3PTR)&pbChunk);
+        AssertRCReturn(rc, rc);
+    }
+    uint8_t const *pbSharedPage = pbChunk + ((pEntry->idPage & GMM_PAGEID_IDX_MASK) << GUEST_PAGE_SHIFT);
+
+    if (memcmp(pbSharedPage, pbLocalPage, GUEST_PAGE_SIZE))
+    {
+        /* Hash collision or stale entry: let this page take over the slot so
+           the content that is around now gets a chance to be merged. */
+        Log(("GMMR0MergeDuplicatePage: %#x differs from shared page %#x (hash %#x)\n", idPage, pEntry->idPage, u32Hash));
+        pEntry->idPage    = idPage;
+        pPageDesc->idPage = NIL_GMM_PAGEID;
+        return VINF_SUCCESS;
+    }
+
+#ifdef VBOX_STRICT
+    pPageDesc->u32StrictChecksum = RTCrc32(pbSharedPage, GUEST_PAGE_SIZE);
+#endif
+
+    /*
+     * Free the local page and reference the shared one instead.
+     */
+    GMMFREEPAGEDESC PageDesc;
+    PageDesc.idPage = idPage;
+    int rc = gmmR0FreePages(pGMM, pGVM, 1, &PageDesc, GMMACCOUNT_BASE);
+    AssertRCReturn(rc, rc);
+
+    gmmR0UseSharedPage(pGMM, pGVM, pPage);
+
+    pPageDesc->HCPhys = ((uint64_t)pPage->Shared.pfn) << GUEST_PAGE_SHIFT;
+    pPageDesc->idPage = pEntry->idPage;
+    return VINF_SUCCESS;
+}
+
+
 /**
  * RTAvlGCPtrDestroy callback.
  *
@@ -5514,6 +5671,61 @@ GMMR0DECL(int) GMMR0CheckSharedModules(PGVM pGVM, VMCPUID idCpu)
 #endif
 }
 
+
+/**
+ * VMMR0 request wrapper for merging duplicate pages.
+ *
+ * Hands the pages to PGMR0SharedPageMerge with the GMM semaphore held, which
+ * in turn calls GMMR0MergeDuplicatePage for each of them and updates the PGM
+ * page tracking.  The caller (ring-3) holds the PGM lock and has all the
+ * other EMTs waiting in a rendezvous.
+ *
+ * @returns VBox status code.
+ * @param   pGVM        The global (ring-0) VM structure.
+ * @param   idCpu       The calling EMT number.
+ * @param   pReq        Pointer to the request packet.
+ * @thread  EMT(idCpu)
+ */
+GMMR0DECL(int) GMMR0MergeDuplicatePagesReq(PGVM pGVM, VMCPUID idCpu, PGMMMERGEPAGESREQ pReq)
+{
+    /*
+     * Validate input and get the basics.
+     */
+    AssertPtrReturn(pReq, VERR_INVALID_POINTER);
+    AssertMsgReturn(pReq->Hdr.cbReq >= RT_UOFFSETOF(GMMMERGEPAGESREQ, aPages[0]),
+                    ("%#x < %#x\n", pReq->Hdr.cbReq, RT_UOFFSETOF(GMMMERGEPAGESREQ, aPages[0])),
+                    VERR_INVALID_PARAMETER);
+    AssertMsgReturn(pReq->cPages > 0 && pReq->cPages <= GMM_MERGE_PAGES_MAX, ("%#x\n", pReq->cPages),
+                    VERR_INVALID_PARAMETER);
+    AssertMsgReturn(pReq->Hdr.cbReq == RT_UOFFSETOF_DYN(GMMMERGEPAGESREQ, aPages[pReq->cPages]),
+                    ("%#x != %#x\n", pReq->Hdr.cbReq, RT_UOFFSETOF_DYN(GMMMERGEPAGESREQ, aPages[pReq->cPages])),
+                    VERR_INVALID_PARAMETER);
+    pReq->cMerged    = 0;
+    pReq->cConverted = 0;
+
+#ifdef VBOX_WITH_PAGE_SHARING
+    PGMM pGMM;
+    GMM_GET_VALID_INSTANCE(pGMM, VERR_GMM_INSTANCE);
+    int rc = GVMMR0ValidateGVMandEMT(pGVM, idCpu);
+    if (RT_FAILURE(rc))
+        return rc;
+
+    gmmR0MutexAcquire(pGMM);
+    if (GMM_CHECK_SANITY_UPON_ENTERING(pGMM))
+    {
+        rc = PGMR0SharedPageMerge(pGVM, idCpu, pReq);
+        GMM_CHECK_SANITY_UPON_LEAVING(pGMM);
+    }
+    else
+        rc = VERR_GMM_IS_NOT_SANE;
+    gmmR0MutexRelease(pGMM);
+    return rc;
+#else
+    RT_NOREF(pGVM, idCpu);
+    return VERR_NOT_IMPLEMENTED;
+#endif
+}
+
 #ifdef VBOX_STRICT
 
 /**
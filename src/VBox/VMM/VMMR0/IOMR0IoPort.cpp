@@ -128,6 +128,8 @@ VMMR0_INT_DECL(int)  IOMR0IoPortSetUpContext(PGVM pGVM, PPDMDEVINS pDevIns, IOMI
     pGVM->iomr0.s.paIoPortRegs[hIoPorts].pfnInCallback      = pfnIn;
     pGVM->iomr0.s.paIoPortRegs[hIoPorts].pfnOutStrCallback  = pfnOutStr;
     pGVM->iomr0.s.paIoPortRegs[hIoPorts].pfnInStrCallback   = pfnInStr;
+    pGVM->iomr0.s.paIoPortRegs[hIoPorts].pfnInSharedCallback = NULL;
+    pGVM->iomr0.s.paIoPortRegs[hIoPorts].pCritSectRw        = NULL;
     pGVM->iomr0.s.paIoPortRegs[hIoPorts].cPorts             = cPorts;
     pGVM->iomr0.s.paIoPortRegs[hIoPorts].fFlags             = fFlags;
 #ifdef VBOX_WITH_STATISTICS
@@ -144,6 +146,44 @@ VMMR0_INT_DECL(int)  IOMR0IoPortSetUpContext(PGVM pGVM, PPDMDEVINS pDevIns, IOMI
 }
 
 
+/**
+ * Implements PDMDEVHLPR0::pfnIoPortSetInShared.
+ *
+ * @param   pGVM            The global (ring-0) VM structure.
+ * @param   pDevIns         The device instance.
+ * @param   hIoPorts        The I/O port handle (already set up for ring-0).
+ * @param   pCritSectRw     The read/write critical section protecting the
+ *                          state accessed by @a pfnInShared.
+ * @param   pfnInShared     The shared IN handler.
+ * @thread  EMT(0)
+ * @note    Only callable at VM creation time.
+ * @sa      IOMR3IoPortSetInShared
+ */
+VMMR0_INT_DECL(int)  IOMR0IoPortSetInShared(PGVM pGVM, PPDMDEVINS pDevIns, IOMIOPORTHANDLE hIoPorts,
+                                            PPDMCRITSECTRW pCritSectRw, PFNIOMIOPORTNEWIN pfnInShared)
+{
+    /*
+     * Validate input and state.
+     */
+    VM_ASSERT_EMT0_RETURN(pGVM, VERR_VM_THREAD_NOT_EMT);
+    VM_ASSERT_STATE_RETURN(pGVM, VMSTATE_CREATING, VERR_VM_INVALID_VM_STATE);
+    AssertReturn(hIoPorts < pGVM->iomr0.s.cIoPortAlloc, VERR_IOM_INVALID_IOPORT_HANDLE);
+    AssertReturn(hIoPorts < pGVM->iom.s.cIoPortRegs, VERR_IOM_INVALID_IOPORT_HANDLE);
+    AssertPtrReturn(pDevIns, VERR_INVALID_HANDLE);
+    AssertReturn(pGVM->iomr0.s.paIoPortRegs[hIoPorts].pDevIns == pDevIns, VERR_WRONG_ORDER);
+    AssertPtrReturn(pfnInShared, VERR_INVALID_POINTER);
+    AssertPtrReturn(pCritSectRw, VERR_INVALID_POINTER);
+    AssertReturn(PDMCritSectRwIsInitialized(pCritSectRw), VERR_INVALID_PARAMETER);
+
+    /*
+     * Do the job.
+     */
+    pGVM->iomr0.s.paIoPortRegs[hIoPorts].pCritSectRw         = pCritSectRw;
+    pGVM->iomr0.s.paIoPortRegs[hIoPorts].pfnInSharedCallback = pfnInShared;
+    return VINF_SUCCESS;
+}
+
+
 /**
  * Grows the I/O port registration (all contexts) and lookup tables.
  *
@@ -169,17 +209,18 @@ VMMR0_INT_DECL(int) IOMR0IoPortGrowRegistrationTables(PGVM pGVM, uint64_t cReqMi
     AssertReturn(pGVM->iom.s.cIoPortRegs >= pGVM->iomr0.s.cIoPortMax, VERR_IOM_IOPORT_IPE_3);
 
     /*
-     * Allocate the new tables.  We use a single allocation for the three tables (ring-0,
-     * ring-3, lookup) and does a partial mapping of the result to ring-3.
+     * Allocate the new tables.  We use a single allocation for the four tables (ring-0,
+     * ring-3, lookup, direct) and does a partial mapping of the result to ring-3.
      */
     uint32_t const cbRing0  = RT_ALIGN_32(cNewEntries * sizeof(IOMIOPORTENTRYR0),     HOST_PAGE_SIZE);
     uint32_t const cbRing3  = RT_ALIGN_32(cNewEntries * sizeof(IOMIOPORTENTRYR3),     HOST_PAGE_SIZE);
-    uint32_t const cbShared = RT_ALIGN_32(cNewEntries * sizeof(IOMIOPORTLOOKUPENTRY), HOST_PAGE_SIZE);
+    uint32_t const cbLookup = RT_ALIGN_32(cNewEntries * sizeof(IOMIOPORTLOOKUPENTRY), HOST_PAGE_SIZE);
+    uint32_t const cbShared = cbLookup + RT_ALIGN_32(IOM_IOPORT_DIRECT_SIZE, HOST_PAGE_SIZE);
     uint32_t const cbNew    = cbRing0 + cbRing3 + cbShared;
 
     /* Use the rounded up space as best we can. */
     cNewEntries = RT_MIN(RT_MIN(cbRing0 / sizeof(IOMIOPORTENTRYR0), cbRing3 / sizeof(IOMIOPORTENTRYR3)),
-                         cbShared / sizeof(IOMIOPORTLOOKUPENTRY));
+                         cbLookup / sizeof(IOMIOPORTLOOKUPENTRY));
 
     RTR0MEMOBJ hMemObj;
     int rc = RTR0MemObjAllocPage(&hMemObj, cbNew, false /*fExecutable*/);
@@ -198,6 +239,7 @@ VMMR0_INT_DECL(int) IOMR0IoPortGrowRegistrationTables(PGVM pGVM, uint64_t cReqMi
             PIOMIOPORTENTRYR0     const paRing0    = (PIOMIOPORTENTRYR0)RTR0MemObjAddress(hMemObj);
             PIOMIOPORTENTRYR3     const paRing3    = (PIOMIOPORTENTRYR3)((uintptr_t)paRing0 + cbRing0);
             PIOMIOPORTLOOKUPENTRY const paLookup   = (PIOMIOPORTLOOKUPENTRY)((uintptr_t)paRing3 + cbRing3);
+            uint32_t *            const pau32Direct = (uint32_t *)((uintptr_t)paLookup + cbLookup);
             RTR3UINTPTR           const uAddrRing3 = RTR0MemObjAddressR3(hMapObj);
 
             /*
@@ -208,6 +250,7 @@ VMMR0_INT_DECL(int) IOMR0IoPortGrowRegistrationTables(PGVM pGVM, uint64_t cReqMi
                 memcpy(paRing0,  pGVM->iomr0.s.paIoPortRegs,      sizeof(paRing0[0])  * cOldEntries);
                 memcpy(paRing3,  pGVM->iomr0.s.paIoPortRing3Regs, sizeof(paRing3[0])  * cOldEntries);
                 memcpy(paLookup, pGVM->iomr0.s.paIoPortLookup,    sizeof(paLookup[0]) * cOldEntries);
+                memcpy(pau32Direct, pGVM->iomr0.s.pau32IoPortDirect, IOM_IOPORT_DIRECT_SIZE);
             }
 
             size_t i = cbRing0 / sizeof(*paRing0);
@@ -240,8 +283,10 @@ VMMR0_INT_DECL(int) IOMR0IoPortGrowRegistrationTables(PGVM pGVM, uint64_t cReqMi
             pGVM->iomr0.s.paIoPortRegs      = paRing0;
             pGVM->iomr0.s.paIoPortRing3Regs = paRing3;
             pGVM->iomr0.s.paIoPortLookup    = paLookup;
+            pGVM->iomr0.s.pau32IoPortDirect = pau32Direct;
             pGVM->iom.s.paIoPortRegs        = uAddrRing3;
             pGVM->iom.s.paIoPortLookup      = uAddrRing3 + cbRing3;
+            pGVM->iom.s.pau32IoPortDirect   = uAddrRing3 + cbRing3 + cbLookup;
             pGVM->iom.s.cIoPortAlloc        = cNewEntries;
             pGVM->iomr0.s.cIoPortAlloc      = cNewEntries;
 
@@ -126,6 +126,8 @@ VMMR0_INT_DECL(int)  IOMR0MmioSetUpContext(PGVM pGVM, PPDMDEVINS pDevIns, IOMMMI
     pGVM->iomr0.s.paMmioRegs[hRegion].pfnWriteCallback  = pfnWrite;
     pGVM->iomr0.s.paMmioRegs[hRegion].pfnReadCallback   = pfnRead;
     pGVM->iomr0.s.paMmioRegs[hRegion].pfnFillCallback   = pfnFill;
+    pGVM->iomr0.s.paMmioRegs[hRegion].pfnReadSharedCallback = NULL;
+    pGVM->iomr0.s.paMmioRegs[hRegion].pCritSectRw       = NULL;
     pGVM->iomr0.s.paMmioRegs[hRegion].fFlags            = fFlags;
 #ifdef VBOX_WITH_STATISTICS
     uint16_t const idxStats = pGVM->iomr0.s.paMmioRing3Regs[hRegion].idxStats;
@@ -141,6 +143,46 @@ VMMR0_INT_DECL(int)  IOMR0MmioSetUpContext(PGVM pGVM, PPDMDEVINS pDevIns, IOMMMI
 }
 
 
+/**
+ * Implements PDMDEVHLPR0::pfnMmioSetReadShared.
+ *
+ * @param   pGVM            The global (ring-0) VM structure.
+ * @param   pDevIns         The device instance.
+ * @param   hRegion         The MMIO region handle (already set up for
+ *                          ring-0).
+ * @param   pCritSectRw     The read/write critical section protecting the
+ *                          state accessed by @a pfnReadShared.
+ * @param   pfnReadShared   The shared read handler.
+ * @thread  EMT(0)
+ * @note    Only callable at VM creation time.
+ * @sa      IOMR3MmioSetReadShared
+ */
+VMMR0_INT_DECL(int)  IOMR0MmioSetReadShared(PGVM pGVM, PPDMDEVINS pDevIns, IOMMMIOHANDLE hRegion,
+                                            PPDMCRITSECTRW pCritSectRw, PFNIOMMMIONEWREAD pfnReadShared)
+{
+    /*
+     * Validate input and state.
+     */
+    VM_ASSERT_EMT0_RETURN(pGVM, VERR_VM_THREAD_NOT_EMT);
+    VM_ASSERT_STATE_RETURN(pGVM, VMSTATE_CREATING, VERR_VM_INVALID_VM_STATE);
+    AssertReturn(hRegion < pGVM->iomr0.s.cMmioAlloc, VERR_IOM_INVALID_MMIO_HANDLE);
+    AssertReturn(hRegion < pGVM->iom.s.cMmioRegs, VERR_IOM_INVALID_MMIO_HANDLE);
+    AssertPtrReturn(pDevIns, VERR_INVALID_HANDLE);
+    AssertReturn(pGVM->iomr0.s.paMmioRegs[hRegion].pDevIns == pDevIns, VERR_WRONG_ORDER);
+    AssertReturn(pGVM->iomr0.s.paMmioRegs[hRegion].pfnReadCallback, VERR_WRONG_ORDER);
+    AssertPtrReturn(pfnReadShared, VERR_INVALID_POINTER);
+    AssertPtrReturn(pCritSectRw, VERR_INVALID_POINTER);
+    AssertReturn(PDMCritSectRwIsInitialized(pCritSectRw), VERR_INVALID_PARAMETER);
+
+    /*
+     * Do the job.
+     */
+    pGVM->iomr0.s.paMmioRegs[hRegion].pCritSectRw           = pCritSectRw;
+    pGVM->iomr0.s.paMmioRegs[hRegion].pfnReadSharedCallback = pfnReadShared;
+    return VINF_SUCCESS;
+}
+
+
 /**
  * Grows the MMIO registration (all contexts) and lookup tables.
  *
@@ -166,17 +208,18 @@ VMMR0_INT_DECL(int) IOMR0MmioGrowRegistrationTables(PGVM pGVM, uint64_t cReqMinE
     AssertReturn(pGVM->iom.s.cMmioRegs >= pGVM->iomr0.s.cMmioMax, VERR_IOM_MMIO_IPE_3);
 
     /*
-     * Allocate the new tables.  We use a single allocation for the three tables (ring-0,
-     * ring-3, lookup) and does a partial mapping of the result to ring-3.
+     * Allocate the new tables.  We use a single allocation for the four tables (ring-0,
+     * ring-3, lookup, page map) and does a partial mapping of the result to ring-3.
      */
     uint32_t const cbRing0  = RT_ALIGN_32(cNewEntries * sizeof(IOMMMIOENTRYR0),     HOST_PAGE_SIZE);
     uint32_t const cbRing3  = RT_ALIGN_32(cNewEntries * sizeof(IOMMMIOENTRYR3),     HOST_PAGE_SIZE);
-    uint32_t const cbShared = RT_ALIGN_32(cNewEntries * sizeof(IOMMMIOLOOKUPENTRY), HOST_PAGE_SIZE);
+    uint32_t const cbLookup = RT_ALIGN_32(cNewEntries * sizeof(IOMMMIOLOOKUPENTRY), HOST_PAGE_SIZE);
+    uint32_t const cbShared = cbLookup + RT_ALIGN_32(IOM_MMIO_PAGE_MAP_SIZE, HOST_PAGE_SIZE);
     uint32_t const cbNew    = cbRing0 + cbRing3 + cbShared;
 
     /* Use the rounded up space as best we can. */
     cNewEntries = RT_MIN(RT_MIN(cbRing0 / sizeof(IOMMMIOENTRYR0), cbRing3 / sizeof(IOMMMIOENTRYR3)),
-                         cbShared / sizeof(IOMMMIOLOOKUPENTRY));
+                         cbLookup / sizeof(IOMMMIOLOOKUPENTRY));
 
     RTR0MEMOBJ hMemObj;
     int rc = RTR0MemObjAllocPage(&hMemObj, cbNew, false /*fExecutable*/);
@@ -195,6 +238,7 @@ VMMR0_INT_DECL(int) IOMR0MmioGrowRegistrationTables(PGVM pGVM, uint64_t cReqMinE
             PIOMMMIOENTRYR0       const paRing0    = (PIOMMMIOENTRYR0)RTR0MemObjAddress(hMemObj);
             PIOMMMIOENTRYR3       const paRing3    = (PIOMMMIOENTRYR3)((uintptr_t)paRing0 + cbRing0);
             PIOMMMIOLOOKUPENTRY   const paLookup   = (PIOMMMIOLOOKUPENTRY)((uintptr_t)paRing3 + cbRing3);
+            uint64_t volatile *   const pau64PageMap = (uint64_t volatile *)((uintptr_t)paLookup + cbLookup);
             RTR3UINTPTR           const uAddrRing3 = RTR0MemObjAddressR3(hMapObj);
 
             /*
@@ -237,8 +281,10 @@ VMMR0_INT_DECL(int) IOMR0MmioGrowRegistrationTables(PGVM pGVM, uint64_t cReqMinE
             pGVM->iomr0.s.paMmioRegs      = paRing0;
             pGVM->iomr0.s.paMmioRing3Regs = paRing3;
             pGVM->iomr0.s.paMmioLookup    = paLookup;
+            pGVM->iomr0.s.pau64MmioPageMap = pau64PageMap;
             pGVM->iom.s.paMmioRegs        = uAddrRing3;
             pGVM->iom.s.paMmioLookup      = uAddrRing3 + cbRing3;
+            pGVM->iom.s.pau64MmioPageMap  = uAddrRing3 + cbRing3 + cbLookup;
             pGVM->iom.s.cMmioAlloc        = cNewEntries;
             pGVM->iomr0.s.cMmioAlloc      = cNewEntries;
 
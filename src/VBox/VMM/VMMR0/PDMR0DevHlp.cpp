@@ -97,6 +97,24 @@ static DECLCALLBACK(int) pdmR0DevHlp_IoPortSetUpContextEx(PPDMDEVINS pDevIns, IO
 }
 
 
+/** @interface_method_impl{PDMDEVHLPR0,pfnIoPortSetInShared} */
+static DECLCALLBACK(int) pdmR0DevHlp_IoPortSetInShared(PPDMDEVINS pDevIns, IOMIOPORTHANDLE hIoPorts,
+                                                       PPDMCRITSECTRW pCritSectRw, PFNIOMIOPORTNEWIN pfnInShared)
+{
+    PDMDEV_ASSERT_DEVINS(pDevIns);
+    LogFlow(("pdmR0DevHlp_IoPortSetInShared: caller='%s'/%d: hIoPorts=%#x pCritSectRw=%p pfnInShared=%p\n",
+             pDevIns->pReg->szName, pDevIns->iInstance, hIoPorts, pCritSectRw, pfnInShared));
+    PGVM pGVM = pDevIns->Internal.s.pGVM;
+    VM_ASSERT_EMT0_RETURN(pGVM, VERR_VM_THREAD_NOT_EMT);
+    VM_ASSERT_STATE_RETURN(pGVM, VMSTATE_CREATING, VERR_VM_INVALID_VM_STATE);
+
+    int rc = IOMR0IoPortSetInShared(pGVM, pDevIns, hIoPorts, pCritSectRw, pfnInShared);
+
+    LogFlow(("pdmR0DevHlp_IoPortSetInShared: caller='%s'/%d: returns %Rrc\n", pDevIns->pReg->szName, pDevIns->iInstance, rc));
+    return rc;
+}
+
+
 /** @interface_method_impl{PDMDEVHLPR0,pfnMmioSetUpContextEx} */
 static DECLCALLBACK(int) pdmR0DevHlp_MmioSetUpContextEx(PPDMDEVINS pDevIns, IOMMMIOHANDLE hRegion, PFNIOMMMIONEWWRITE pfnWrite,
                                                         PFNIOMMMIONEWREAD pfnRead, PFNIOMMMIONEWFILL pfnFill, void *pvUser)
@@ -115,6 +133,24 @@ static DECLCALLBACK(int) pdmR0DevHlp_MmioSetUpContextEx(PPDMDEVINS pDevIns, IOMM
 }
 
 
+/** @interface_method_impl{PDMDEVHLPR0,pfnMmioSetReadShared} */
+static DECLCALLBACK(int) pdmR0DevHlp_MmioSetReadShared(PPDMDEVINS pDevIns, IOMMMIOHANDLE hRegion,
+                                                       PPDMCRITSECTRW pCritSectRw, PFNIOMMMIONEWREAD pfnReadShared)
+{
+    PDMDEV_ASSERT_DEVINS(pDevIns);
+    LogFlow(("pdmR0DevHlp_MmioSetReadShared: caller='%s'/%d: hRegion=%#x pCritSectRw=%p pfnReadShared=%p\n",
+             pDevIns->pReg->szName, pDevIns->iInstance, hRegion, pCritSectRw, pfnReadShared));
+    PGVM pGVM = pDevIns->Internal.s.pGVM;
+    VM_ASSERT_EMT0_RETURN(pGVM, VERR_VM_THREAD_NOT_EMT);
+    VM_ASSERT_STATE_RETURN(pGVM, VMSTATE_CREATING, VERR_VM_INVALID_VM_STATE);
+
+    int rc = IOMR0MmioSetReadShared(pGVM, pDevIns, hRegion, pCritSectRw, pfnReadShared);
+
+    LogFlow(("pdmR0DevHlp_MmioSetReadShared: caller='%s'/%d: returns %Rrc\n", pDevIns->pReg->szName, pDevIns->iInstance, rc));
+    return rc;
+}
+
+
 /** @interface_method_impl{PDMDEVHLPR0,pfnMmio2SetUpContext} */
 static DECLCALLBACK(int) pdmR0DevHlp_Mmio2SetUpContext(PPDMDEVINS pDevIns, PGMMMIO2HANDLE hRegion,
                                                        size_t offSub, size_t cbSub, void **ppvMapping)
@@ -1419,7 +1455,9 @@ extern DECLEXPORT(const PDMDEVHLPR0) g_pdmR0DevHlp =
 {
     PDM_DEVHLPR0_VERSION,
     pdmR0DevHlp_IoPortSetUpContextEx,
+    pdmR0DevHlp_IoPortSetInShared,
     pdmR0DevHlp_MmioSetUpContextEx,
+    pdmR0DevHlp_MmioSetReadShared,
     pdmR0DevHlp_Mmio2SetUpContext,
     pdmR0DevHlp_PCIPhysRead,
     pdmR0DevHlp_PCIPhysWrite,
@@ -1532,7 +1570,9 @@ extern DECLEXPORT(const PDMDEVHLPR0) g_pdmR0DevHlpTracing =
 {
     PDM_DEVHLPR0_VERSION,
     pdmR0DevHlpTracing_IoPortSetUpContextEx,
+    pdmR0DevHlpTracing_IoPortSetInShared,
     pdmR0DevHlpTracing_MmioSetUpContextEx,
+    pdmR0DevHlpTracing_MmioSetReadShared,
     pdmR0DevHlp_Mmio2SetUpContext,
     pdmR0DevHlpTracing_PCIPhysRead,
     pdmR0DevHlpTracing_PCIPhysWrite,
@@ -213,6 +213,23 @@ pdmR0DevHlpTracing_IoPortSetUpContextEx(PPDMDEVINS pDevIns, IOMIOPORTHANDLE hIoP
 }
 
 
+/**
+ * @interface_method_impl{PDMDEVHLPR0,pfnIoPortSetInShared}
+ *
+ * The shared handler is not registered when tracing, so that all reads take
+ * the regular (traced) path.
+ */
+DECL_HIDDEN_CALLBACK(int) pdmR0DevHlpTracing_IoPortSetInShared(PPDMDEVINS pDevIns, IOMIOPORTHANDLE hIoPorts,
+                                                               PPDMCRITSECTRW pCritSectRw, PFNIOMIOPORTNEWIN pfnInShared)
+{
+    PDMDEV_ASSERT_DEVINS(pDevIns);
+    LogFlow(("pdmR0DevHlp_IoPortSetInShared: caller='%s'/%d: hIoPorts=%#x pCritSectRw=%p pfnInShared=%p - ignored\n",
+             pDevIns->pReg->szName, pDevIns->iInstance, hIoPorts, pCritSectRw, pfnInShared));
+    RT_NOREF(pDevIns, hIoPorts, pCritSectRw, pfnInShared);
+    return VINF_SUCCESS;
+}
+
+
 /** @interface_method_impl{PDMDEVHLPR0,pfnMmioSetUpContextEx} */
 DECL_HIDDEN_CALLBACK(int)
 pdmR0DevHlpTracing_MmioSetUpContextEx(PPDMDEVINS pDevIns, IOMMMIOHANDLE hRegion, PFNIOMMMIONEWWRITE pfnWrite,
@@ -254,6 +271,22 @@ pdmR0DevHlpTracing_MmioSetUpContextEx(PPDMDEVINS pDevIns, IOMMMIOHANDLE hRegion,
 }
 
 
+/**
+ * @interface_method_impl{PDMDEVHLPR0,pfnMmioSetReadShared}
+ *
+ * Ignored when tracing, see pdmR0DevHlpTracing_IoPortSetInShared.
+ */
+DECL_HIDDEN_CALLBACK(int) pdmR0DevHlpTracing_MmioSetReadShared(PPDMDEVINS pDevIns, IOMMMIOHANDLE hRegion,
+                                                               PPDMCRITSECTRW pCritSectRw, PFNIOMMMIONEWREAD pfnReadShared)
+{
+    PDMDEV_ASSERT_DEVINS(pDevIns);
+    LogFlow(("pdmR0DevHlp_MmioSetReadShared: caller='%s'/%d: hRegion=%#x pCritSectRw=%p pfnReadShared=%p - ignored\n",
+             pDevIns->pReg->szName, pDevIns->iInstance, hRegion, pCritSectRw, pfnReadShared));
+    RT_NOREF(pDevIns, hRegion, pCritSectRw, pfnReadShared);
+    return VINF_SUCCESS;
+}
+
+
 /** @interface_method_impl{PDMDEVHLPR0,pfnPhysRead} */
 DECL_HIDDEN_CALLBACK(int)
 pdmR0DevHlpTracing_PhysRead(PPDMDEVINS pDevIns, RTGCPHYS GCPhys, void *pvBuf, size_t cbRead, uint32_t fFlags)
@@ -111,9 +111,12 @@ VMMR0_INT_DECL(int) PDMR0QueueCreateReqHandler(PGVM pGVM, PPDMQUEUECREATEREQ pRe
     /*
      * Calculate the memory needed and allocate it.
      */
-    uint32_t const cbBitmap = RT_ALIGN_32(RT_ALIGN_32(pReq->cItems, 64 /*uint64_t*/) / 8, 64 /*cache line */);
+    uint32_t cbBitmap;
+    uint32_t cbRing;
+    pdmQueueCalcLayout(pReq->cItems, &cbBitmap, &cbRing);
     uint32_t const cbQueue  = RT_UOFFSETOF(PDMQUEUE, bmAlloc)
                             + cbBitmap
+                            + cbRing
                             + pReq->cbItem * pReq->cItems;
 
     RTR0MEMOBJ hMemObj = NIL_RTR0MEMOBJ;
@@ -125,7 +128,7 @@ VMMR0_INT_DECL(int) PDMR0QueueCreateReqHandler(PGVM pGVM, PPDMQUEUECREATEREQ pRe
         /*
          * Initialize the queue.
          */
-        pdmQueueInit(pQueue, cbBitmap, pReq->cbItem, pReq->cItems, pReq->szName,
+        pdmQueueInit(pQueue, cbBitmap, cbRing, pReq->cbItem, pReq->cItems, pReq->szName,
                      (PDMQUEUETYPE)pReq->enmType, pReq->pfnCallback, pReq->pvOwner);
 
         /*
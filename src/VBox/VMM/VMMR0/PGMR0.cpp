@@ -589,6 +589,73 @@ VMMR0_INT_DECL(int) PGMR0PhysFlushHandyPages(PGVM pGVM, VMCPUID idCpu)
 }
 
 
+/**
+ * Allocates a large page from GMM, backing off when that gets slow.
+ *
+ * If an allocation takes more than 100ms, further allocations are held off for
+ * a while so the host OS can reshuffle memory and make some more large pages
+ * available.  Large pages are disabled if an allocation takes over a second or
+ * GMM says they aren't supported.
+ *
+ * @returns VBox status code.
+ * @retval  VERR_TRY_AGAIN if large page allocations are currently held off.
+ *
+ * @param   pGVM        The global (ring-0) VM structure.
+ * @param   idCpu       The ID of the calling EMT.
+ * @param   pidPage     Where to return the GMM page ID of the first page.
+ * @param   pHCPhys     Where to return the host physical address.
+ *
+ * @thread  EMT(idCpu)
+ *
+ * @remarks Must be called from within the PGM critical section.
+ */
+static int pgmR0PhysAllocLargePageWithBackoff(PGVM pGVM, VMCPUID idCpu, uint32_t *pidPage, PRTHCPHYS pHCPhys)
+{
+    uint64_t const nsAllocStart = RTTimeNanoTS();
+    if (nsAllocStart < pGVM->pgm.s.nsLargePageRetry)
+    {
+        LogFlowFunc(("returns VERR_TRY_AGAIN - %RU64 ns left of hold off period\n", pGVM->pgm.s.nsLargePageRetry - nsAllocStart));
+        return VERR_TRY_AGAIN;
+    }
+
+    int const rc = GMMR0AllocateLargePage(pGVM, idCpu, _2M, pidPage, pHCPhys);
+
+    uint64_t const nsAllocEnd = RTTimeNanoTS();
+    uint64_t const cNsElapsed = nsAllocEnd - nsAllocStart;
+    STAM_REL_PROFILE_ADD_PERIOD(&pGVM->pgm.s.StatLargePageAlloc, cNsElapsed);
+    if (cNsElapsed < RT_NS_100MS)
+        pGVM->pgm.s.cLargePageLongAllocRepeats = 0;
+    else
+    {
+        STAM_REL_COUNTER_INC(&pGVM->pgm.s.StatLargePageOverflow);
+        pGVM->pgm.s.cLargePageLongAllocRepeats++;
+        if (cNsElapsed > RT_NS_1SEC)
+        {
+            LogRel(("PGMR0PhysAllocateLargePage: Disabling large pages after %'RU64 ns allocation time.\n", cNsElapsed));
+            PGMSetLargePageUsage(pGVM, false);
+        }
+        else
+        {
+            Log(("PGMR0PhysAllocateLargePage: Suspending large page allocations for %u sec after %'RU64 ns allocation time.\n",
+                 30 * pGVM->pgm.s.cLargePageLongAllocRepeats, cNsElapsed));
+            pGVM->pgm.s.nsLargePageRetry = nsAllocEnd + RT_NS_30SEC * pGVM->pgm.s.cLargePageLongAllocRepeats;
+        }
+    }
+
+    if (RT_FAILURE(rc))
+    {
+        Log(("PGMR0PhysAllocateLargePage: Failed: %Rrc\n", rc));
+        STAM_REL_COUNTER_INC(&pGVM->pgm.s.StatLargePageAllocFailed);
+        if (rc == VERR_NOT_SUPPORTED)
+        {
+            LogRel(("PGM: Disabling large pages because of VERR_NOT_SUPPORTED status.\n"));
+            PGMSetLargePageUsage(pGVM, false);
+        }
+    }
+    return rc;
+}
+
+
 /**
  * Allocate a large page at @a GCPhys.
  *
@@ -618,51 +685,9 @@ int pgmR0PhysAllocateLargePage(PGVM pGVM, VMCPUID idCpu, RTGCPHYS GCPhys)
 
     if (true) /** @todo pre-allocate 2-3 pages on the allocation thread. */
     {
-        uint64_t const nsAllocStart = RTTimeNanoTS();
-        if (nsAllocStart < pGVM->pgm.s.nsLargePageRetry)
-        {
-            LogFlowFunc(("returns VERR_TRY_AGAIN - %RU64 ns left of hold off period\n", pGVM->pgm.s.nsLargePageRetry - nsAllocStart));
-            return VERR_TRY_AGAIN;
-        }
-
-        int const rc = GMMR0AllocateLargePage(pGVM, idCpu, _2M, &idPage, &HCPhys);
-
-        uint64_t const nsAllocEnd = RTTimeNanoTS();
-        uint64_t const cNsElapsed = nsAllocEnd - nsAllocStart;
-        STAM_REL_PROFILE_ADD_PERIOD(&pGVM->pgm.s.StatLargePageAlloc, cNsElapsed);
-        if (cNsElapsed < RT_NS_100MS)
-            pGVM->pgm.s.cLargePageLongAllocRepeats = 0;
-        else
-        {
-            /* If a large page allocation takes more than 100ms back off for a
-               while so the host OS can reshuffle memory and make some more large
-               pages available.  However if it took over a second, just disable it. */
-            STAM_REL_COUNTER_INC(&pGVM->pgm.s.StatLargePageOverflow);
-            pGVM->pgm.s.cLargePageLongAllocRepeats++;
-            if (cNsElapsed > RT_NS_1SEC)
-            {
-                LogRel(("PGMR0PhysAllocateLargePage: Disabling large pages after %'RU64 ns allocation time.\n", cNsElapsed));
-                PGMSetLargePageUsage(pGVM, false);
-            }
-            else
-            {
-                Log(("PGMR0PhysAllocateLargePage: Suspending large page allocations for %u sec after %'RU64 ns allocation time.\n",
-                     30 * pGVM->pgm.s.cLargePageLongAllocRepeats, cNsElapsed));
-                pGVM->pgm.s.nsLargePageRetry = nsAllocEnd + RT_NS_30SEC * pGVM->pgm.s.cLargePageLongAllocRepeats;
-            }
-        }
-
+        int const rc = pgmR0PhysAllocLargePageWithBackoff(pGVM, idCpu, &idPage, &HCPhys);
         if (RT_FAILURE(rc))
-        {
-            Log(("PGMR0PhysAllocateLargePage: Failed: %Rrc\n", rc));
-            STAM_REL_COUNTER_INC(&pGVM->pgm.s.StatLargePageAllocFailed);
-            if (rc == VERR_NOT_SUPPORTED)
-            {
-                LogRel(("PGM: Disabling large pages because of VERR_NOT_SUPPORTED status.\n"));
-                PGMSetLargePageUsage(pGVM, false);
-            }
             return rc;
-        }
     }
 
     STAM_PROFILE_STOP_START(&pGVM->pgm.s.Stats.StatLargePageAlloc2, &pGVM->pgm.s.Stats.StatLargePageSetup, a);
@@ -785,6 +810,193 @@ VMMR0_INT_DECL(int) PGMR0PhysAllocateLargePage(PGVM pGVM, VMCPUID idCpu, RTGCPHY
 }
 
 
+/**
+ * Gets the ring-0 address of a guest RAM page for the coalescing code.
+ *
+ * @returns VBox status code.
+ * @param   pGVM        The global (ring-0) VM structure.
+ * @param   idPage      The GMM page ID.
+ * @param   HCPhys      The host physical address of the page.
+ * @param   ppv         Where to return the address.
+ */
+DECLINLINE(int) pgmR0PhysCoalesceMapPage(PGVM pGVM, uint32_t idPage, RTHCPHYS HCPhys, void **ppv)
+{
+#ifdef VBOX_WITH_LINEAR_HOST_PHYS_MEM
+    RT_NOREF(pGVM, idPage);
+    return SUPR0HCPhysToVirt(HCPhys, ppv);
+#else
+    RT_NOREF(HCPhys);
+    return GMMR0PageIdToVirt(pGVM, idPage, ppv);
+#endif
+}
+
+
+/**
+ * Replaces the 4 KB pages backing a 2 MB range of guest RAM with a freshly
+ * allocated large page.
+ *
+ * The content of allocated pages is copied over, zero pages are left as they
+ * are since the large page comes zeroed.  The old pages are returned to GMM
+ * and the shadow page tables covering the range are flushed so the next
+ * SyncPT can map the range using a 2 MB PDE.
+ *
+ * @returns VBox status code.
+ * @retval  VINF_SUCCESS on success.
+ * @retval  VERR_PGM_INVALID_LARGE_PAGE_RANGE if the range (no longer)
+ *          qualifies for coalescing.
+ * @retval  VERR_TRY_AGAIN if large page allocations are currently held off or
+ *          a live save is tracking dirty pages.
+ * @retval  VERR_NOT_SUPPORTED if large pages are (no longer) in use.
+ *
+ * @param   pGVM        The global (ring-0) VM structure.
+ * @param   idCpu       The ID of the calling EMT.
+ * @param   GCPhys      The 2 MB aligned guest physical address of the range.
+ *
+ * @thread  EMT(idCpu)
+ *
+ * @remarks The caller must make sure no other EMTs are executing guest code,
+ *          i.e. this must be called from an EMT rendezvous.
+ */
+VMMR0_INT_DECL(int) PGMR0PhysCoalesceLargePage(PGVM pGVM, VMCPUID idCpu, RTGCPHYS GCPhys)
+{
+    /*
+     * Validate inputs.
+     */
+    AssertReturn(idCpu < pGVM->cCpus, VERR_INVALID_CPU_ID);
+    AssertReturn(pGVM->aCpus[idCpu].hEMT == RTThreadNativeSelf(), VERR_NOT_OWNER);
+    AssertMsgReturn(!(GCPhys & X86_PAGE_2M_OFFSET_MASK), ("%RGp\n", GCPhys), VERR_INVALID_PARAMETER);
+
+    PGMMFREEPAGEDESC paFree = (PGMMFREEPAGEDESC)RTMemTmpAlloc(sizeof(paFree[0]) * (_2M / GUEST_PAGE_SIZE));
+    AssertReturn(paFree, VERR_NO_TMP_MEMORY);
+
+    int rc = PGM_LOCK(pGVM);
+    AssertRCReturnStmt(rc, RTMemTmpFree(paFree), rc);
+
+    /*
+     * Recheck everything now that we own the lock.  Large pages may have been
+     * disabled by a slow allocation earlier in the pass, a live save may have
+     * started since ring-3 looked, and ring-3 only did a quick scan of the range.
+     */
+    if (!PGMIsUsingLargePages(pGVM))
+        rc = VERR_NOT_SUPPORTED;
+    else if (pGVM->pgm.s.LiveSave.fActive)
+        rc = VERR_TRY_AGAIN;
+    else
+        rc = pgmPhysIsCoalescableLargePageRange(pGVM, GCPhys, NULL);
+    if (RT_FAILURE(rc))
+    {
+        PGM_UNLOCK(pGVM);
+        RTMemTmpFree(paFree);
+        return rc;
+    }
+
+    /*
+     * Allocate the large page.  It comes zeroed.  This is subject to the same
+     * hold off and disabling logic as demand allocations.
+     */
+    RTHCPHYS HCPhys = NIL_GMMPAGEDESC_PHYS;
+    uint32_t idPage = NIL_GMM_PAGEID;
+    rc = pgmR0PhysAllocLargePageWithBackoff(pGVM, idCpu, &idPage, &HCPhys);
+    if (RT_FAILURE(rc))
+    {
+        Log(("PGMR0PhysCoalesceLargePage: GCPhys=%RGp: allocation failed: %Rrc\n", GCPhys, rc));
+        PGM_UNLOCK(pGVM);
+        RTMemTmpFree(paFree);
+        return rc;
+    }
+
+    /*
+     * Copy the content of the allocated pages.  We do this in a separate pass
+     * so we can back out without having touched any PGM state.
+     */
+    RTGCPHYS GCPhysCur = GCPhys;
+    for (uint32_t i = 0; i < _2M / GUEST_PAGE_SIZE; i++, GCPhysCur += GUEST_PAGE_SIZE)
+    {
+        PPGMPAGE const pPage = pgmPhysGetPage(pGVM, GCPhysCur);
+        if (PGM_PAGE_GET_STATE(pPage) == PGM_PAGE_STATE_ALLOCATED)
+        {
+            void *pvSrc = NULL;
+            void *pvDst = NULL;
+            rc = pgmR0PhysCoalesceMapPage(pGVM, PGM_PAGE_GET_PAGEID(pPage), PGM_PAGE_GET_HCPHYS(pPage), &pvSrc);
+            if (RT_SUCCESS(rc))
+                rc = pgmR0PhysCoalesceMapPage(pGVM, idPage + i, HCPhys + i * GUEST_PAGE_SIZE, &pvDst);
+            if (RT_FAILURE(rc))
+            {
+                AssertLogRelMsgFailed(("PGMR0PhysCoalesceLargePage: GCPhys=%RGp: mapping failed: %Rrc\n", GCPhysCur, rc));
+                GMMR0FreeLargePage(pGVM, idCpu, idPage);
+                PGM_UNLOCK(pGVM);
+                RTMemTmpFree(paFree);
+                return rc;
+            }
+            memcpy(pvDst, pvSrc, GUEST_PAGE_SIZE);
+        }
+    }
+
+    /*
+     * Enter the new pages into PGM, evicting all shadow PTEs referencing the
+     * old ones and collecting the old page IDs for freeing.
+     */
+    bool     fFlushTLBs = false;
+    uint32_t cFree      = 0;
+    uint32_t cZero      = 0;
+    GCPhysCur = GCPhys;
+    for (uint32_t i = 0; i < _2M / GUEST_PAGE_SIZE; i++, GCPhysCur += GUEST_PAGE_SIZE)
+    {
+        PPGMPAGE const pPage = pgmPhysGetPage(pGVM, GCPhysCur);
+
+        if (PGM_PAGE_GET_TRACKING(pPage) != 0)
+        {
+            VBOXSTRICTRC rc3 = pgmPoolTrackUpdateGCPhys(pGVM, GCPhysCur, pPage, true /*fFlushPTEs*/, &fFlushTLBs);
+            Log(("PGMR0PhysCoalesceLargePage: GCPhys=%RGp: tracking=%#x rc3=%Rrc\n",
+                 GCPhysCur, PGM_PAGE_GET_TRACKING(pPage), VBOXSTRICTRC_VAL(rc3))); RT_NOREF(rc3);
+            PGM_PAGE_SET_PTE_INDEX(pGVM, pPage, 0);
+            PGM_PAGE_SET_TRACKING(pGVM, pPage, 0);
+        }
+
+        if (PGM_PAGE_GET_STATE(pPage) == PGM_PAGE_STATE_ALLOCATED)
+            paFree[cFree++].idPage = PGM_PAGE_GET_PAGEID(pPage);
+        else
+            cZero++;
+
+        PGM_PAGE_SET_HCPHYS(pGVM, pPage, HCPhys + i * GUEST_PAGE_SIZE);
+        PGM_PAGE_SET_STATE(pGVM, pPage, PGM_PAGE_STATE_ALLOCATED);
+        PGM_PAGE_SET_PDE_TYPE(pGVM, pPage, PGM_PAGE_PDE_TYPE_PDE);
+        PGM_PAGE_SET_PAGEID(pGVM, pPage, idPage + i);
+    }
+
+    pGVM->pgm.s.cZeroPages    -= cZero;
+    pGVM->pgm.s.cPrivatePages += cZero;
+    pGVM->pgm.s.cLargePages++;
+
+    /*
+     * Return the old pages to GMM.
+     */
+    if (cFree > 0)
+    {
+        rc = GMMR0FreePages(pGVM, idCpu, cFree, paFree, GMMACCOUNT_BASE);
+        AssertLogRelMsg(RT_SUCCESS(rc), ("PGMR0PhysCoalesceLargePage: GCPhys=%RGp: GMMR0FreePages(%u) -> %Rrc\n",
+                                         GCPhys, cFree, rc));
+    }
+
+    /*
+     * Get rid of the page tables mapping the range so SyncPT will install a
+     * 2 MB PDE, and flush all the TLBs.
+     */
+    pgmPoolFlushPhysPTsFor2MRange(pGVM, GCPhys);
+    PGM_INVL_ALL_VCPU_TLBS(pGVM);
+    pgmPhysInvalidatePageMapTLB(pGVM, true /*fInRendezvous*/);
+    IEMTlbInvalidateAllPhysicalAllCpus(pGVM, idCpu, IEMTLBPHYSFLUSHREASON_ALLOCATED_LARGE);
+
+    STAM_REL_COUNTER_INC(&pGVM->pgm.s.StatLargePageCoalesced);
+    Log(("PGMR0PhysCoalesceLargePage: GCPhys=%RGp -> HCPhys=%RHp idPage=%#x (%u copied, %u zero)\n",
+         GCPhys, HCPhys, idPage, cFree, cZero));
+
+    PGM_UNLOCK(pGVM);
+    RTMemTmpFree(paFree);
+    return VINF_SUCCESS;
+}
+
+
 /**
  * Locate a MMIO2 range.
  *
@@ -45,6 +45,63 @@
 
 
 #ifdef VBOX_WITH_PAGE_SHARING
+/**
+ * Updates the PGM page tracking after GMM turned the page into a shared page
+ * or replaced it by an existing shared page.
+ *
+ * The PGM lock shall be taken prior to calling this method.
+ *
+ * @returns true if the backing was replaced, false if the page was converted.
+ * @param   pVM                 The cross context VM structure.
+ * @param   pVCpu               The cross context virtual CPU structure of the
+ *                              calling EMT.
+ * @param   pPage               The PGM page.
+ * @param   pPageDesc           The page descriptor as returned by GMM.
+ * @param   pfFlushTLBs         Where to indicate that TLBs must be flushed.
+ *                              Not touched if not.
+ */
+static bool pgmR0SharedPageUpdate(PVMCC pVM, PVMCPUCC pVCpu, PPGMPAGE pPage, PGMMSHAREDPAGEDESC pPageDesc, bool *pfFlushTLBs)
+{
+    Assert(PGM_PAGE_GET_STATE(pPage) == PGM_PAGE_STATE_ALLOCATED);
+
+    /* Page was either replaced by an existing shared version of it or
+       converted into a read-only shared page, so, clear all references. */
+    bool fFlush = false;
+    int rc = pgmPoolTrackUpdateGCPhys(pVM, pPageDesc->GCPhys, pPage, true /* clear the entries */, &fFlush);
+    Assert(   rc == VINF_SUCCESS
+           || (   VMCPU_FF_IS_SET(pVCpu, VMCPU_FF_PGM_SYNC_CR3)
+               && (pVCpu->pgm.s.fSyncFlags & PGM_SYNC_CLEAR_PGM_POOL)));
+    if (rc == VINF_SUCCESS && fFlush)
+        *pfFlushTLBs = true;
+    RT_NOREF(pVCpu);
+
+    bool const fReplaced = pPageDesc->HCPhys != PGM_PAGE_GET_HCPHYS(pPage);
+    if (fReplaced)
+    {
+        /* Update the physical address and page id now. */
+        PGM_PAGE_SET_HCPHYS(pVM, pPage, pPageDesc->HCPhys);
+        PGM_PAGE_SET_PAGEID(pVM, pPage, pPageDesc->idPage);
+
+        /* Invalidate page map TLB entry for this page too. */
+        pgmPhysInvalidatePageMapTLBEntry(pVM, pPageDesc->GCPhys);
+        IEMTlbInvalidateAllPhysicalAllCpus(pVM, NIL_VMCPUID, IEMTLBPHYSFLUSHREASON_SHARED);
+        pVM->pgm.s.cReusedSharedPages++;
+    }
+    /* else: nothing changed (== this page is now a shared
+       page), so no need to flush anything. */
+
+    pVM->pgm.s.cSharedPages++;
+    pVM->pgm.s.cPrivatePages--;
+    PGM_PAGE_SET_STATE(pVM, pPage, PGM_PAGE_STATE_SHARED);
+
+# ifdef VBOX_STRICT /* check sum hack */
+    pPage->s.u2Unused0 = pPageDesc->u32StrictChecksum        & 3;
+    //pPage->s.u2Unused1 = (pPageDesc->u32StrictChecksum >> 8) & 3;
+# endif
+    return fReplaced;
+}
+
+
 /**
  * Check a registered module for shared page changes.
  *
@@ -113,41 +170,8 @@ VMMR0DECL(int) PGMR0SharedModuleCheck(PVMCC pVM, PGVM pGVM, VMCPUID idCpu, PGMMS
 
                         Log(("PGMR0SharedModuleCheck: shared page gst virt=%RGv phys=%RGp host %RHp->%RHp\n",
                              GCPtrPage, PageDesc.GCPhys, PGM_PAGE_GET_HCPHYS(pPage), PageDesc.HCPhys));
-
-                        /* Page was either replaced by an existing shared
-                           version of it or converted into a read-only shared
-                           page, so, clear all references. */
-                        bool fFlush = false;
-                        rc = pgmPoolTrackUpdateGCPhys(pVM, PageDesc.GCPhys, pPage, true /* clear the entries */, &fFlush);
-                        Assert(   rc == VINF_SUCCESS
-                               || (   VMCPU_FF_IS_SET(pVCpu, VMCPU_FF_PGM_SYNC_CR3)
-                                   && (pVCpu->pgm.s.fSyncFlags & PGM_SYNC_CLEAR_PGM_POOL)));
-                        if (rc == VINF_SUCCESS)
-                            fFlushTLBs |= fFlush;
+                        pgmR0SharedPageUpdate(pVM, pVCpu, pPage, &PageDesc, &fFlushTLBs);
                         fFlushRemTLBs = true;
-
-                        if (PageDesc.HCPhys != PGM_PAGE_GET_HCPHYS(pPage))
-                        {
-                            /* Update the physical address and page id now. */
-                            PGM_PAGE_SET_HCPHYS(pVM, pPage, PageDesc.HCPhys);
-                            PGM_PAGE_SET_PAGEID(pVM, pPage, PageDesc.idPage);
-
-                            /* Invalidate page map TLB entry for this page too. */
-                            pgmPhysInvalidatePageMapTLBEntry(pVM, PageDesc.GCPhys);
-                            IEMTlbInvalidateAllPhysicalAllCpus(pVM, NIL_VMCPUID, IEMTLBPHYSFLUSHREASON_SHARED);
-                            pVM->pgm.s.cReusedSharedPages++;
-                        }
-                        /* else: nothing changed (== this page is now a shared
-                           page), so no need to flush anything. */
-
-                        pVM->pgm.s.cSharedPages++;
-                        pVM->pgm.s.cPrivatePages--;
-                        PGM_PAGE_SET_STATE(pVM, pPage, PGM_PAGE_STATE_SHARED);
-
-# ifdef VBOX_STRICT /* check sum hack */
-                        pPage->s.u2Unused0 = PageDesc.u32StrictChecksum        & 3;
-                        //pPage->s.u2Unused1 = (PageDesc.u32StrictChecksum >> 8) & 3;
-# endif
                     }
                 }
             }
@@ -179,5 +203,75 @@ VMMR0DECL(int) PGMR0SharedModuleCheck(PVMCC pVM, PGVM pGVM, VMCPUID idCpu, PGMMS
 
     return rc;
 }
+
+
+/**
+ * Merges the given pages with identical shared pages, independent of any
+ * registered modules.
+ *
+ * Called by GMMR0MergeDuplicatePagesReq with the GMM semaphore held.  The PGM
+ * lock shall be taken prior to calling this method, and all other EMTs must be
+ * parked so nobody writes to the pages while they are being compared.
+ *
+ * Pages that changed state since ring-3 picked them are silently skipped.
+ *
+ * @returns VBox status code.
+ * @param   pGVM                Pointer to the GVM instance data.
+ * @param   idCpu               The ID of the calling virtual CPU.
+ * @param   pReq                The request, cMerged and cConverted are updated.
+ */
+VMMR0DECL(int) PGMR0SharedPageMerge(PGVM pGVM, VMCPUID idCpu, PGMMMERGEPAGESREQ pReq)
+{
+    PVMCPUCC    pVCpu         = &pGVM->aCpus[idCpu];
+    int         rc            = VINF_SUCCESS;
+    bool        fFlushTLBs    = false;
+    bool        fFlushRemTLBs = false;
+
+    PGM_LOCK_ASSERT_OWNER(pGVM);    /* Grabbed by pgmR3PageDedupRendezvous before calling into ring-0. */
+
+    for (uint32_t iPage = 0; iPage < pReq->cPages; iPage++)
+    {
+        RTGCPHYS const GCPhys = pReq->aPages[iPage].GCPhys & ~(RTGCPHYS)GUEST_PAGE_OFFSET_MASK;
+        PPGMPAGE const pPage  = pgmPhysGetPage(pGVM, GCPhys);
+        if (   !pPage
+            || PGM_PAGE_GET_TYPE(pPage)       != PGMPAGETYPE_RAM
+            || PGM_PAGE_GET_STATE(pPage)      != PGM_PAGE_STATE_ALLOCATED
+            || PGM_PAGE_GET_PAGEID(pPage)     != pReq->aPages[iPage].idPage
+            || PGM_PAGE_GET_PDE_TYPE(pPage)   == PGM_PAGE_PDE_TYPE_PDE
+            || PGM_PAGE_HAS_ANY_HANDLERS(pPage)
+            || PGM_PAGE_GET_READ_LOCKS(pPage)  != 0
+            || PGM_PAGE_GET_WRITE_LOCKS(pPage) != 0)
+            continue;
+
+        GMMSHAREDPAGEDESC PageDesc;
+        PageDesc.idPage = PGM_PAGE_GET_PAGEID(pPage);
+        PageDesc.HCPhys = PGM_PAGE_GET_HCPHYS(pPage);
+        PageDesc.GCPhys = GCPhys;
+        rc = GMMR0MergeDuplicatePage(pGVM, pReq->aPages[iPage].u32Hash, &PageDesc);
+        if (RT_FAILURE(rc))
+            break;
+        if (PageDesc.idPage == NIL_GMM_PAGEID)
+            continue;
+
+        Log(("PGMR0SharedPageMerge: shared page phys=%RGp host %RHp->%RHp\n", GCPhys, PGM_PAGE_GET_HCPHYS(pPage), PageDesc.HCPhys));
+        if (pgmR0SharedPageUpdate(pGVM, pVCpu, pPage, &PageDesc, &fFlushTLBs))
+            pReq->cMerged++;
+        else
+            pReq->cConverted++;
+        fFlushRemTLBs = true;
+    }
+
+    /*
+     * Do TLB flushing if necessary.
+     */
+    if (fFlushTLBs)
+        PGM_INVL_ALL_VCPU_TLBS(pGVM);
+
+    if (fFlushRemTLBs)
+        for (VMCPUID idCurCpu = 0; idCurCpu < pGVM->cCpus; idCurCpu++)
+            CPUMSetChangedFlags(&pGVM->aCpus[idCurCpu], CPUM_CHANGED_GLOBAL_TLB_FLUSH);
+
+    return rc;
+}
 #endif /* VBOX_WITH_PAGE_SHARING */
 
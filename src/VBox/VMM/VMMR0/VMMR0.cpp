@@ -1901,6 +1901,12 @@ DECL_NO_INLINE(static, int) vmmR0EntryExWorker(PGVM pGVM, VMCPUID idCpu, VMMR0OP
             rc = PGMR0PhysAllocateLargePage(pGVM, idCpu, u64Arg);
             break;
 
+        case VMMR0_DO_PGM_COALESCE_LARGE_PAGE:
+            if (idCpu == NIL_VMCPUID)
+                return VERR_INVALID_CPU_ID;
+            rc = PGMR0PhysCoalesceLargePage(pGVM, idCpu, u64Arg);
+            break;
+
         case VMMR0_DO_PGM_PHYS_SETUP_IOMMU:
             if (idCpu != 0)
                 return VERR_INVALID_CPU_ID;
@@ -2038,6 +2044,14 @@ DECL_NO_INLINE(static, int) vmmR0EntryExWorker(PGVM pGVM, VMCPUID idCpu, VMMR0OP
             rc = GMMR0CheckSharedModules(pGVM, idCpu);
             break;
         }
+
+        case VMMR0_DO_GMM_MERGE_DUPLICATE_PAGES:
+            if (idCpu == NIL_VMCPUID)
+                return VERR_INVALID_CPU_ID;
+            if (u64Arg)
+                return VERR_INVALID_PARAMETER;
+            rc = GMMR0MergeDuplicatePagesReq(pGVM, idCpu, (PGMMMERGEPAGESREQ)pReqHdr);
+            break;
 #endif
 
 #if defined(VBOX_STRICT) && HC_ARCH_BITS == 64
@@ -38,6 +38,7 @@
 #define LOG_GROUP LOG_GROUP_DBGF
 #include <VBox/vmm/dbgf.h>
 #include "DBGFInternal.h"
+#include <VBox/vmm/em.h>
 #include <VBox/vmm/mm.h>
 #include <VBox/vmm/uvm.h>
 #include <VBox/vmm/vm.h>
@@ -61,6 +62,12 @@
 
 /** Maximum stack frame depth. */
 #define DBGF_SAMPLE_REPORT_FRAME_DEPTH_MAX 64
+/** Maximum stack frame depth recorded in the sample ring (continuous mode). */
+#define DBGF_SAMPLE_REPORT_RING_DEPTH_MAX  32
+/** Default number of samples kept per VCPU in continuous mode. */
+#define DBGF_SAMPLE_REPORT_RING_SAMPLES_DEF _1K
+/** Maximum number of samples kept per VCPU in continuous mode. */
+#define DBGF_SAMPLE_REPORT_RING_SAMPLES_MAX _64K
 
 
 /*********************************************************************************************************************************
@@ -106,6 +113,24 @@ typedef struct DBGFSAMPLEFRAME
 typedef const DBGFSAMPLEFRAME *PCDBGFSAMPLEFRAME;
 
 
+/**
+ * A single entry in the per VCPU sample ring used in continuous mode.
+ */
+typedef struct DBGFSAMPLERINGENTRY
+{
+    /** The execution engine state of the EMT when the sample was taken (EMSTATE). */
+    uint32_t                        enmEmState;
+    /** Number of valid frames in aFramePCs. */
+    uint32_t                        cFrames;
+    /** The flat guest PC of each frame, innermost first. */
+    RTGCUINTPTR                     aFramePCs[DBGF_SAMPLE_REPORT_RING_DEPTH_MAX];
+} DBGFSAMPLERINGENTRY;
+/** Pointer to a sample ring entry. */
+typedef DBGFSAMPLERINGENTRY *PDBGFSAMPLERINGENTRY;
+/** Pointer to a const sample ring entry. */
+typedef const DBGFSAMPLERINGENTRY *PCDBGFSAMPLERINGENTRY;
+
+
 /**
  * Per VCPU sample report data.
  */
@@ -113,6 +138,11 @@ typedef struct DBGFSAMPLEREPORTVCPU
 {
     /** The root frame. */
     DBGFSAMPLEFRAME                 FrameRoot;
+    /** The sample ring (continuous mode only). */
+    PDBGFSAMPLERINGENTRY            paRing;
+    /** Total number of samples recorded in the ring, the next entry to write
+     * is this modulo DBGFSAMPLEREPORTINT::cRingEntries. */
+    uint64_t                        cRingSamples;
 } DBGFSAMPLEREPORTVCPU;
 /** Pointer to the per VCPU sample report data. */
 typedef DBGFSAMPLEREPORTVCPU *PDBGFSAMPLEREPORTVCPU;
@@ -147,6 +177,10 @@ typedef struct DBGFSAMPLEREPORTINT
     char                             *pszReport;
     /** Number of EMTs having a guest sample operation queued. */
     volatile uint32_t                cEmtsActive;
+    /** Number of entries in each per VCPU sample ring (continuous mode). */
+    uint32_t                         cRingEntries;
+    /** Mutex protecting the sample rings against concurrent exports. */
+    RTSEMFASTMUTEX                   hMtxRing;
     /** Array of per VCPU samples collected. */
     DBGFSAMPLEREPORTVCPU             aCpus[1];
 } DBGFSAMPLEREPORTINT;
@@ -156,6 +190,22 @@ typedef DBGFSAMPLEREPORTINT *PDBGFSAMPLEREPORTINT;
 typedef const DBGFSAMPLEREPORTINT *PCDBGFSAMPLEREPORTINT;
 
 
+/**
+ * Aggregated folded stack, a node in the string space used during export.
+ */
+typedef struct DBGFSAMPLEFOLDEDSTACK
+{
+    /** The string space core, the string is the folded stack. */
+    RTSTRSPACECORE                   Core;
+    /** Number of samples with this stack. */
+    uint64_t                         cSamples;
+    /** The folded stack string. */
+    char                             szStack[1];
+} DBGFSAMPLEFOLDEDSTACK;
+/** Pointer to an aggregated folded stack. */
+typedef DBGFSAMPLEFOLDEDSTACK *PDBGFSAMPLEFOLDEDSTACK;
+
+
 /**
  * Structure to pass to DBGFR3Info() and for doing all other
  * output during fatal dump.
@@ -282,7 +332,13 @@ static void dbgfR3SampleReportFrameFree(PDBGFSAMPLEFRAME pFrame)
 static void dbgfR3SampleReportDestroy(PDBGFSAMPLEREPORTINT pThis)
 {
     for (uint32_t i = 0; i < pThis->pUVM->cCpus; i++)
+    {
         dbgfR3SampleReportFrameFree(&pThis->aCpus[i].FrameRoot);
+        if (pThis->aCpus[i].paRing)
+            MMR3HeapFree(pThis->aCpus[i].paRing);
+    }
+    if (pThis->hMtxRing != NIL_RTSEMFASTMUTEX)
+        RTSemFastMutexDestroy(pThis->hMtxRing);
     MMR3HeapFree(pThis);
 }
 
@@ -403,6 +459,199 @@ static void dbgfR3SampleReportDumpFrame(PCDBGFINFOHLP pHlp, PUVM pUVM, PCDBGFSAM
 }
 
 
+/**
+ * Creates the textual report from the collected frame trees and the device
+ * state once sampling was stopped.
+ *
+ * @param   pThis                    Pointer to the sample report instance.
+ */
+static void dbgfR3SampleReportGenerate(PDBGFSAMPLEREPORTINT pThis)
+{
+    DBGFSAMPLEREPORTINFOHLP Hlp;
+    PCDBGFINFOHLP           pHlp = &Hlp.Core;
+
+    dbgfR3SampleReportInfoHlpInit(&Hlp);
+
+    /* Some early dump code. */
+    for (uint32_t i = 0; i < pThis->pUVM->cCpus; i++)
+    {
+        PCDBGFSAMPLEREPORTVCPU pSampleVCpu = &pThis->aCpus[i];
+
+        pHlp->pfnPrintf(pHlp, "Sample report for vCPU %u:\n", i);
+        dbgfR3SampleReportDumpFrame(pHlp, pThis->pUVM, &pSampleVCpu->FrameRoot, 0);
+    }
+
+    /* Shameless copy from VMMGuruMeditation.cpp */
+    static struct
+    {
+        const char *pszInfo;
+        const char *pszArgs;
+    } const     aInfo[] =
+    {
+        { "mappings",        NULL },
+        { "mode",            "all" },
+        { "handlers",        "phys virt hyper stats" },
+        { "timers",          NULL },
+        { "activetimers",    NULL },
+    };
+    for (unsigned i = 0; i < RT_ELEMENTS(aInfo); i++)
+    {
+        pHlp->pfnPrintf(pHlp,
+                        "!!\n"
+                        "!! {%s, %s}\n"
+                        "!!\n",
+                        aInfo[i].pszInfo, aInfo[i].pszArgs);
+        DBGFR3Info(pThis->pUVM, aInfo[i].pszInfo, aInfo[i].pszArgs, pHlp);
+    }
+
+    /* All other info items */
+    DBGFR3InfoMulti(pThis->pUVM->pVM,
+                    "*",
+                    "mappings|hma|cpum|cpumguest|cpumguesthwvirt|cpumguestinstr|cpumhyper|cpumhost|cpumvmxfeat|mode|cpuid"
+                    "|pgmpd|pgmcr3|timers|activetimers|handlers|help|cfgm",
+                    "!!\n"
+                    "!! {%s}\n"
+                    "!!\n",
+                    pHlp);
+
+
+    /* done */
+    pHlp->pfnPrintf(pHlp,
+                    "!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!\n");
+
+    if (pThis->pszReport)
+        RTMemFree(pThis->pszReport);
+    pThis->pszReport = Hlp.pachBuf;
+    Hlp.pachBuf = NULL;
+    dbgfR3SampleReportInfoHlpDelete(&Hlp);
+}
+
+
+/**
+ * Returns the pseudo frame name for the given execution engine state which
+ * forms the host side root of every folded stack.
+ *
+ * @returns Pseudo frame name.
+ * @param   enmEmState              The EM state recorded with the sample.
+ */
+static const char *dbgfR3SampleReportEmStateName(uint32_t enmEmState)
+{
+    switch ((EMSTATE)enmEmState)
+    {
+        case EMSTATE_HM:                        return "[hm]";
+        case EMSTATE_NEM:                       return "[nem]";
+        case EMSTATE_IEM:                       return "[iem]";
+        case EMSTATE_RECOMPILER:                return "[recompiler]";
+        case EMSTATE_HALTED:                    return "[halted]";
+        case EMSTATE_WAIT_SIPI:                 return "[wait-sipi]";
+        case EMSTATE_SUSPENDED:                 return "[suspended]";
+        case EMSTATE_DEBUG_GUEST_RAW:
+        case EMSTATE_DEBUG_GUEST_HM:
+        case EMSTATE_DEBUG_GUEST_IEM:
+        case EMSTATE_DEBUG_GUEST_RECOMPILER:
+        case EMSTATE_DEBUG_GUEST_NEM:
+        case EMSTATE_DEBUG_HYPER:               return "[debug]";
+        default:                                return "[other]";
+    }
+}
+
+
+/**
+ * Formats the name of a single frame for the folded stack format.
+ *
+ * @returns Number of characters written to the buffer.
+ * @param   pUVM                    The usermode VM handle.
+ * @param   GCPtrPC                 The flat guest PC of the frame.
+ * @param   pszBuf                  Where to store the name.
+ * @param   cbBuf                   Size of the buffer.
+ */
+static size_t dbgfR3SampleReportFoldedFrameName(PUVM pUVM, RTGCUINTPTR GCPtrPC, char *pszBuf, size_t cbBuf)
+{
+    DBGFADDRESS Addr;
+    RTGCINTPTR  offDisp;
+    RTDBGMOD    hMod;
+    RTDBGSYMBOL Sym;
+    int rc = DBGFR3AsSymbolByAddr(pUVM, DBGF_AS_GLOBAL, DBGFR3AddrFromFlat(pUVM, &Addr, GCPtrPC),
+                                  RTDBGSYMADDR_FLAGS_LESS_OR_EQUAL | RTDBGSYMADDR_FLAGS_SKIP_ABS_IN_DEFERRED,
+                                  &offDisp, &Sym, &hMod);
+    if (RT_FAILURE(rc))
+        return RTStrPrintf(pszBuf, cbBuf, "%RGv", GCPtrPC);
+
+    size_t const cch = RTStrPrintf(pszBuf, cbBuf, "%s!%s", hMod != NIL_RTDBGMOD ? RTDbgModName(hMod) : "?", Sym.szName);
+    RTDbgModRelease(hMod);
+
+    /* Semicolons and spaces are the separators of the folded format. */
+    for (size_t off = 0; off < cch; off++)
+        if (pszBuf[off] == ';' || pszBuf[off] == ' ')
+            pszBuf[off] = '_';
+    return cch;
+}
+
+
+/**
+ * @callback_method_impl{FNRTSTRSPACECALLBACK, Writes a folded stack line to the stream.}
+ */
+static DECLCALLBACK(int) dbgfR3SampleReportFoldedWrite(PRTSTRSPACECORE pStr, void *pvUser)
+{
+    PDBGFSAMPLEFOLDEDSTACK pStack = RT_FROM_MEMBER(pStr, DBGFSAMPLEFOLDEDSTACK, Core);
+    return RTStrmPrintf((PRTSTREAM)pvUser, "%s %RU64\n", pStack->szStack, pStack->cSamples) >= 0
+         ? VINF_SUCCESS : VERR_WRITE_ERROR;
+}
+
+
+/**
+ * @callback_method_impl{FNRTSTRSPACECALLBACK, Frees a folded stack.}
+ */
+static DECLCALLBACK(int) dbgfR3SampleReportFoldedFree(PRTSTRSPACECORE pStr, void *pvUser)
+{
+    RT_NOREF(pvUser);
+    RTMemFree(RT_FROM_MEMBER(pStr, DBGFSAMPLEFOLDEDSTACK, Core));
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Records a guest stack sample of the calling EMT in its sample ring (continuous mode).
+ *
+ * @param   pThis                   Pointer to the sample report instance.
+ * @param   pVCpu                   The cross context virtual CPU structure of the calling EMT.
+ */
+static void dbgfR3SampleReportSampleRing(PDBGFSAMPLEREPORTINT pThis, PVMCPU pVCpu)
+{
+    RTGCUINTPTR aFramePCs[DBGF_SAMPLE_REPORT_RING_DEPTH_MAX];
+    uint32_t    cFrames = 0;
+
+    /*
+     * Walk the guest stack first, a failure still gets recorded with the
+     * execution state only so halted or unwalkable VCPUs show up in the profile.
+     */
+    PCDBGFSTACKFRAME pFrameFirst;
+    int rc = DBGFR3StackWalkBegin(pThis->pUVM, pVCpu->idCpu, DBGFCODETYPE_GUEST, &pFrameFirst);
+    if (RT_SUCCESS(rc))
+    {
+        for (PCDBGFSTACKFRAME pStackFrame = pFrameFirst;
+             pStackFrame && cFrames < RT_ELEMENTS(aFramePCs);
+             pStackFrame = DBGFR3StackWalkNext(pStackFrame))
+            aFramePCs[cFrames++] = pStackFrame->AddrPC.FlatPtr;
+        DBGFR3StackWalkEnd(pFrameFirst);
+    }
+    else
+        LogRelMax(10, ("Sampling guest stack on VCPU %u failed with rc=%Rrc\n", pVCpu->idCpu, rc));
+
+    /*
+     * Commit it to the ring, overwriting the oldest sample once it is full.
+     */
+    PDBGFSAMPLEREPORTVCPU pSampleVCpu = &pThis->aCpus[pVCpu->idCpu];
+    RTSemFastMutexRequest(pThis->hMtxRing);
+    PDBGFSAMPLERINGENTRY pEntry = &pSampleVCpu->paRing[pSampleVCpu->cRingSamples % pThis->cRingEntries];
+    pEntry->enmEmState = (uint32_t)EMGetState(pVCpu);
+    pEntry->cFrames    = cFrames;
+    memcpy(&pEntry->aFramePCs[0], &aFramePCs[0], cFrames * sizeof(aFramePCs[0]));
+    pSampleVCpu->cRingSamples++;
+    RTSemFastMutexRelease(pThis->hMtxRing);
+}
+
+
 /**
  * Worker for dbgfR3SampleReportTakeSample(), doing the work in an EMT rendezvous point on
  * each VCPU.
@@ -414,55 +663,61 @@ static DECLCALLBACK(void) dbgfR3SampleReportSample(PDBGFSAMPLEREPORTINT pThis)
     PVM pVM = pThis->pUVM->pVM;
     PVMCPU pVCpu = VMMGetCpu(pVM);
 
-    PCDBGFSTACKFRAME pFrameFirst;
-    int rc = DBGFR3StackWalkBegin(pThis->pUVM, pVCpu->idCpu, DBGFCODETYPE_GUEST, &pFrameFirst);
-    if (RT_SUCCESS(rc))
+    int rc;
+    if (pThis->fFlags & DBGF_SAMPLE_REPORT_F_CONTINUOUS)
+        dbgfR3SampleReportSampleRing(pThis, pVCpu);
+    else
     {
-        DBGFADDRESS aFrameAddresses[DBGF_SAMPLE_REPORT_FRAME_DEPTH_MAX];
-        uint32_t idxFrame = 0;
+        PCDBGFSTACKFRAME pFrameFirst;
+        rc = DBGFR3StackWalkBegin(pThis->pUVM, pVCpu->idCpu, DBGFCODETYPE_GUEST, &pFrameFirst);
+        if (RT_SUCCESS(rc))
+        {
+            DBGFADDRESS aFrameAddresses[DBGF_SAMPLE_REPORT_FRAME_DEPTH_MAX];
+            uint32_t idxFrame = 0;
 
-        PDBGFSAMPLEFRAME pFrame = &pThis->aCpus[pVCpu->idCpu].FrameRoot;
-        pFrame->cSamples++;
+            PDBGFSAMPLEFRAME pFrame = &pThis->aCpus[pVCpu->idCpu].FrameRoot;
+            pFrame->cSamples++;
 
-        for (PCDBGFSTACKFRAME pStackFrame = pFrameFirst;
-             pStackFrame && idxFrame < RT_ELEMENTS(aFrameAddresses);
-             pStackFrame = DBGFR3StackWalkNext(pStackFrame))
-        {
-            if (pThis->fFlags & DBGF_SAMPLE_REPORT_F_STACK_REVERSE)
+            for (PCDBGFSTACKFRAME pStackFrame = pFrameFirst;
+                 pStackFrame && idxFrame < RT_ELEMENTS(aFrameAddresses);
+                 pStackFrame = DBGFR3StackWalkNext(pStackFrame))
             {
-                PDBGFSAMPLEFRAME pFrameNext = dbgfR3SampleReportFrameFindByAddr(pFrame, &pStackFrame->AddrPC);
-                if (!pFrameNext)
-                    pFrameNext = dbgfR3SampleReportAddFrameByAddr(pThis->pUVM, pFrame, &pStackFrame->AddrPC);
+                if (pThis->fFlags & DBGF_SAMPLE_REPORT_F_STACK_REVERSE)
+                {
+                    PDBGFSAMPLEFRAME pFrameNext = dbgfR3SampleReportFrameFindByAddr(pFrame, &pStackFrame->AddrPC);
+                    if (!pFrameNext)
+                        pFrameNext = dbgfR3SampleReportAddFrameByAddr(pThis->pUVM, pFrame, &pStackFrame->AddrPC);
+                    else
+                        pFrameNext->cSamples++;
+
+                    pFrame = pFrameNext;
+                }
                 else
-                    pFrameNext->cSamples++;
+                    aFrameAddresses[idxFrame] = pStackFrame->AddrPC;
 
-                pFrame = pFrameNext;
+                idxFrame++;
             }
-            else
-                aFrameAddresses[idxFrame] = pStackFrame->AddrPC;
-
-            idxFrame++;
-        }
 
-        DBGFR3StackWalkEnd(pFrameFirst);
+            DBGFR3StackWalkEnd(pFrameFirst);
 
-        if (!(pThis->fFlags & DBGF_SAMPLE_REPORT_F_STACK_REVERSE))
-        {
-            /* Walk the frame stack backwards and construct the call stack. */
-            while (idxFrame--)
+            if (!(pThis->fFlags & DBGF_SAMPLE_REPORT_F_STACK_REVERSE))
             {
-                PDBGFSAMPLEFRAME pFrameNext = dbgfR3SampleReportFrameFindByAddr(pFrame, &aFrameAddresses[idxFrame]);
-                if (!pFrameNext)
-                    pFrameNext = dbgfR3SampleReportAddFrameByAddr(pThis->pUVM, pFrame, &aFrameAddresses[idxFrame]);
-                else
-                    pFrameNext->cSamples++;
-
-                pFrame = pFrameNext;
+                /* Walk the frame stack backwards and construct the call stack. */
+                while (idxFrame--)
+                {
+                    PDBGFSAMPLEFRAME pFrameNext = dbgfR3SampleReportFrameFindByAddr(pFrame, &aFrameAddresses[idxFrame]);
+                    if (!pFrameNext)
+                        pFrameNext = dbgfR3SampleReportAddFrameByAddr(pThis->pUVM, pFrame, &aFrameAddresses[idxFrame]);
+                    else
+                        pFrameNext->cSamples++;
+
+                    pFrame = pFrameNext;
+                }
             }
         }
+        else
+            LogRelMax(10, ("Sampling guest stack on VCPU %u failed with rc=%Rrc\n", pVCpu->idCpu, rc));
     }
-    else
-        LogRelMax(10, ("Sampling guest stack on VCPU %u failed with rc=%Rrc\n", pVCpu->idCpu, rc));
 
     /* Last EMT finishes the report when sampling was stopped. */
     uint32_t cEmtsActive = ASMAtomicDecU32(&pThis->cEmtsActive);
@@ -472,63 +727,9 @@ static DECLCALLBACK(void) dbgfR3SampleReportSample(PDBGFSAMPLEREPORTINT pThis)
         rc = RTTimerDestroy(pThis->hTimer); AssertRC(rc); RT_NOREF(rc);
         pThis->hTimer = NULL;
 
-        DBGFSAMPLEREPORTINFOHLP Hlp;
-        PCDBGFINFOHLP           pHlp = &Hlp.Core;
-
-        dbgfR3SampleReportInfoHlpInit(&Hlp);
-
-        /* Some early dump code. */
-        for (uint32_t i = 0; i < pThis->pUVM->cCpus; i++)
-        {
-            PCDBGFSAMPLEREPORTVCPU pSampleVCpu = &pThis->aCpus[i];
-
-            pHlp->pfnPrintf(pHlp, "Sample report for vCPU %u:\n", i);
-            dbgfR3SampleReportDumpFrame(pHlp, pThis->pUVM, &pSampleVCpu->FrameRoot, 0);
-        }
-
-        /* Shameless copy from VMMGuruMeditation.cpp */
-        static struct
-        {
-            const char *pszInfo;
-            const char *pszArgs;
-        } const     aInfo[] =
-        {
-            { "mappings",        NULL },
-            { "mode",            "all" },
-            { "handlers",        "phys virt hyper stats" },
-            { "timers",          NULL },
-            { "activetimers",    NULL },
-        };
-        for (unsigned i = 0; i < RT_ELEMENTS(aInfo); i++)
-        {
-            pHlp->pfnPrintf(pHlp,
-                            "!!\n"
-                            "!! {%s, %s}\n"
-                            "!!\n",
-                            aInfo[i].pszInfo, aInfo[i].pszArgs);
-            DBGFR3Info(pVM->pUVM, aInfo[i].pszInfo, aInfo[i].pszArgs, pHlp);
-        }
-
-        /* All other info items */
-        DBGFR3InfoMulti(pVM,
-                        "*",
-                        "mappings|hma|cpum|cpumguest|cpumguesthwvirt|cpumguestinstr|cpumhyper|cpumhost|cpumvmxfeat|mode|cpuid"
-                        "|pgmpd|pgmcr3|timers|activetimers|handlers|help|cfgm",
-                        "!!\n"
-                        "!! {%s}\n"
-                        "!!\n",
-                        pHlp);
-
-
-        /* done */
-        pHlp->pfnPrintf(pHlp,
-                        "!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!\n");
-
-        if (pThis->pszReport)
-            RTMemFree(pThis->pszReport);
-        pThis->pszReport = Hlp.pachBuf;
-        Hlp.pachBuf = NULL;
-        dbgfR3SampleReportInfoHlpDelete(&Hlp);
+        /* The continuous mode keeps everything in the sample rings for exporting. */
+        if (!(pThis->fFlags & DBGF_SAMPLE_REPORT_F_CONTINUOUS))
+            dbgfR3SampleReportGenerate(pThis);
 
         ASMAtomicXchgU32((volatile uint32_t *)&pThis->enmState, DBGFSAMPLEREPORTSTATE_READY);
 
@@ -551,7 +752,8 @@ static DECLCALLBACK(void) dbgfR3SampleReportTakeSample(PRTTIMER pTimer, void *pv
 {
     PDBGFSAMPLEREPORTINT pThis = (PDBGFSAMPLEREPORTINT)pvUser;
 
-    if (pThis->cSampleUsLeft != UINT32_MAX)
+    if (   pThis->cSampleUsLeft != UINT32_MAX
+        && pThis->cSampleUsLeft != UINT64_MAX)
     {
         int rc = VINF_SUCCESS;
         uint64_t cUsSampled = iTick * pThis->cSampleIntervalUs; /** @todo Wrong if the timer resolution is different from what we've requested. */
@@ -596,9 +798,30 @@ static DECLCALLBACK(void) dbgfR3SampleReportTakeSample(PRTTIMER pTimer, void *pv
  * @param   phSample                Where to return the handle to the sample report on success.
  */
 VMMR3DECL(int) DBGFR3SampleReportCreate(PUVM pUVM, uint32_t cSampleIntervalUs, uint32_t fFlags, PDBGFSAMPLEREPORT phSample)
+{
+    return DBGFR3SampleReportCreateEx(pUVM, cSampleIntervalUs, 0 /*cRingSamples*/, fFlags, phSample);
+}
+
+
+/**
+ * Creates a new sample report instance for the specified VM, extended version.
+ *
+ * @returns VBox status code.
+ * @param   pUVM                    The usermode VM handle.
+ * @param   cSampleIntervalUs       The sample interval in micro seconds.
+ * @param   cRingSamples            Number of samples to keep per VCPU when
+ *                                  DBGF_SAMPLE_REPORT_F_CONTINUOUS is given,
+ *                                  0 for the default.  Ignored otherwise.
+ * @param   fFlags                  Combination of DBGF_SAMPLE_REPORT_F_XXX.
+ * @param   phSample                Where to return the handle to the sample report on success.
+ */
+VMMR3DECL(int) DBGFR3SampleReportCreateEx(PUVM pUVM, uint32_t cSampleIntervalUs, uint32_t cRingSamples, uint32_t fFlags,
+                                          PDBGFSAMPLEREPORT phSample)
 {
     UVM_ASSERT_VALID_EXT_RETURN(pUVM, VERR_INVALID_VM_HANDLE);
     AssertReturn(!(fFlags & ~DBGF_SAMPLE_REPORT_F_VALID_MASK), VERR_INVALID_PARAMETER);
+    AssertReturn(cSampleIntervalUs > 0, VERR_INVALID_PARAMETER);
+    AssertReturn(cRingSamples <= DBGF_SAMPLE_REPORT_RING_SAMPLES_MAX, VERR_OUT_OF_RANGE);
     AssertPtrReturn(phSample, VERR_INVALID_POINTER);
 
     int rc = VINF_SUCCESS;
@@ -612,6 +835,8 @@ VMMR3DECL(int) DBGFR3SampleReportCreate(PUVM pUVM, uint32_t cSampleIntervalUs, u
         pThis->cSampleIntervalUs = cSampleIntervalUs;
         pThis->enmState          = DBGFSAMPLEREPORTSTATE_READY;
         pThis->cEmtsActive       = 0;
+        pThis->cRingEntries      = 0;
+        pThis->hMtxRing          = NIL_RTSEMFASTMUTEX;
 
         for (uint32_t i = 0; i < pUVM->cCpus; i++)
         {
@@ -619,6 +844,27 @@ VMMR3DECL(int) DBGFR3SampleReportCreate(PUVM pUVM, uint32_t cSampleIntervalUs, u
             pThis->aCpus[i].FrameRoot.cSamples     = 0;
             pThis->aCpus[i].FrameRoot.cFramesValid = 0;
             pThis->aCpus[i].FrameRoot.cFramesMax   = 0;
+            pThis->aCpus[i].paRing                 = NULL;
+            pThis->aCpus[i].cRingSamples           = 0;
+        }
+
+        /* The continuous mode keeps a bounded ring of raw samples per VCPU instead of the frame tree. */
+        if (fFlags & DBGF_SAMPLE_REPORT_F_CONTINUOUS)
+        {
+            pThis->cRingEntries = cRingSamples ? cRingSamples : DBGF_SAMPLE_REPORT_RING_SAMPLES_DEF;
+            rc = RTSemFastMutexCreate(&pThis->hMtxRing);
+            for (uint32_t i = 0; i < pUVM->cCpus && RT_SUCCESS(rc); i++)
+            {
+                pThis->aCpus[i].paRing = (PDBGFSAMPLERINGENTRY)MMR3HeapAllocU(pUVM, MM_TAG_DBGF,
+                                                                              sizeof(DBGFSAMPLERINGENTRY) * pThis->cRingEntries);
+                if (!pThis->aCpus[i].paRing)
+                    rc = VERR_NO_MEMORY;
+            }
+            if (RT_FAILURE(rc))
+            {
+                dbgfR3SampleReportDestroy(pThis);
+                return rc;
+            }
         }
 
         *phSample = pThis;
@@ -677,7 +923,8 @@ VMMR3DECL(uint32_t) DBGFR3SampleReportRelease(DBGFSAMPLEREPORT hSample)
  * @returns VBox status code.
  * @param   hSample                 Sample report handle.
  * @param   cSampleUs               Number of microseconds to sample at the interval given during creation.
- *                                  Use UINT32_MAX to sample for an indefinite amount of time.
+ *                                  Use UINT32_MAX or UINT64_MAX to sample for an indefinite amount of time,
+ *                                  which is what DBGF_SAMPLE_REPORT_F_CONTINUOUS is meant for.
  * @param   pfnProgress             Optional progress callback.
  * @param   pvUser                  Opaque user data to pass to the progress callback.
  */
@@ -780,3 +1027,101 @@ VMMR3DECL(int) DBGFR3SampleReportDumpToFile(DBGFSAMPLEREPORT hSample, const char
     return rc;
 }
 
+
+/**
+ * Exports the samples currently held in the per VCPU rings in the folded stack
+ * format, one line per unique stack followed by the number of samples.
+ *
+ * The output can be fed directly to the usual flame graph tools.  Every stack
+ * starts with the VCPU and the execution engine state of the EMT, followed by
+ * the guest frames from the outermost to the innermost one.  This can be called
+ * while sampling is in progress.
+ *
+ * @returns VBox status code.
+ * @retval  VERR_INVALID_STATE if the report wasn't created with DBGF_SAMPLE_REPORT_F_CONTINUOUS.
+ * @param   hSample                 Sample report handle.
+ * @param   pszFilename             The filename to write the folded stacks to.
+ */
+VMMR3DECL(int) DBGFR3SampleReportDumpFoldedToFile(DBGFSAMPLEREPORT hSample, const char *pszFilename)
+{
+    PDBGFSAMPLEREPORTINT pThis = hSample;
+    AssertPtrReturn(pThis, VERR_INVALID_HANDLE);
+    AssertPtrReturn(pszFilename, VERR_INVALID_POINTER);
+    AssertReturn(pThis->fFlags & DBGF_SAMPLE_REPORT_F_CONTINUOUS, VERR_INVALID_STATE);
+
+    PUVM pUVM = pThis->pUVM;
+    PDBGFSAMPLERINGENTRY paSnapshot = (PDBGFSAMPLERINGENTRY)RTMemAlloc(sizeof(*paSnapshot) * pThis->cRingEntries);
+    char                *pszStack   = (char *)RTMemAlloc(_8K);
+    if (!paSnapshot || !pszStack)
+    {
+        RTMemFree(paSnapshot);
+        RTMemFree(pszStack);
+        return VERR_NO_MEMORY;
+    }
+
+    /*
+     * Aggregate identical stacks.
+     */
+    int        rc       = VINF_SUCCESS;
+    RTSTRSPACE StrSpace = NULL;
+    for (VMCPUID idCpu = 0; idCpu < pUVM->cCpus && RT_SUCCESS(rc); idCpu++)
+    {
+        /* Work on a snapshot so the EMTs don't have to wait for the symbol lookups. */
+        RTSemFastMutexRequest(pThis->hMtxRing);
+        uint32_t const cEntries = (uint32_t)RT_MIN(pThis->aCpus[idCpu].cRingSamples, pThis->cRingEntries);
+        memcpy(paSnapshot, pThis->aCpus[idCpu].paRing, cEntries * sizeof(*paSnapshot));
+        RTSemFastMutexRelease(pThis->hMtxRing);
+
+        for (uint32_t i = 0; i < cEntries && RT_SUCCESS(rc); i++)
+        {
+            PCDBGFSAMPLERINGENTRY pEntry = &paSnapshot[i];
+            size_t off = RTStrPrintf(pszStack, _8K, "vcpu%u;%s", idCpu, dbgfR3SampleReportEmStateName(pEntry->enmEmState));
+            for (uint32_t idxFrame = pEntry->cFrames; idxFrame-- > 0 && off < _8K - 2;)
+            {
+                pszStack[off++] = ';';
+                off += dbgfR3SampleReportFoldedFrameName(pUVM, pEntry->aFramePCs[idxFrame], &pszStack[off], _8K - off);
+            }
+
+            PRTSTRSPACECORE pStr = RTStrSpaceGet(&StrSpace, pszStack);
+            if (pStr)
+                RT_FROM_MEMBER(pStr, DBGFSAMPLEFOLDEDSTACK, Core)->cSamples++;
+            else
+            {
+                PDBGFSAMPLEFOLDEDSTACK pStack = (PDBGFSAMPLEFOLDEDSTACK)RTMemAlloc(RT_UOFFSETOF_DYN(DBGFSAMPLEFOLDEDSTACK,
+                                                                                                   szStack[off + 1]));
+                if (pStack)
+                {
+                    memcpy(pStack->szStack, pszStack, off + 1);
+                    pStack->Core.pszString = pStack->szStack;
+                    pStack->cSamples       = 1;
+                    bool fInserted = RTStrSpaceInsert(&StrSpace, &pStack->Core);
+                    Assert(fInserted); RT_NOREF(fInserted);
+                }
+                else
+                    rc = VERR_NO_MEMORY;
+            }
+        }
+    }
+
+    /*
+     * Write them out.
+     */
+    if (RT_SUCCESS(rc))
+    {
+        PRTSTREAM hStream;
+        rc = RTStrmOpen(pszFilename, "w", &hStream);
+        if (RT_SUCCESS(rc))
+        {
+            rc = RTStrSpaceEnumerate(&StrSpace, dbgfR3SampleReportFoldedWrite, hStream);
+            int rc2 = RTStrmClose(hStream);
+            if (RT_SUCCESS(rc))
+                rc = rc2;
+        }
+    }
+
+    RTStrSpaceDestroy(&StrSpace, dbgfR3SampleReportFoldedFree, NULL);
+    RTMemFree(pszStack);
+    RTMemFree(paSnapshot);
+    return rc;
+}
+
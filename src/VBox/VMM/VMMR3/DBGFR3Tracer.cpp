@@ -46,6 +46,7 @@
 #include <iprt/alloca.h>
 #include <iprt/asm.h>
 #include <iprt/assert.h>
+#include <iprt/ctype.h>
 #include <iprt/path.h>
 #include <iprt/semaphore.h>
 #include <iprt/string.h>
@@ -62,15 +63,49 @@
 /*********************************************************************************************************************************
 *   Global Variables                                                                                                             *
 *********************************************************************************************************************************/
+/**
+ * Event filter class names accepted by the /DBGF/TracerEvtFilter config value.
+ */
+static const struct
+{
+    /** The class name. */
+    const char                     *pszName;
+    /** The event mask for the class. */
+    uint32_t                        fEvts;
+} g_aTracerEvtFilterClasses[] =
+{
+    { "mmio",           RT_BIT_32(DBGFTRACEREVT_MMIO_READ) | RT_BIT_32(DBGFTRACEREVT_MMIO_WRITE) | RT_BIT_32(DBGFTRACEREVT_MMIO_FILL) },
+    { "mmio-read",      RT_BIT_32(DBGFTRACEREVT_MMIO_READ) },
+    { "mmio-write",     RT_BIT_32(DBGFTRACEREVT_MMIO_WRITE) },
+    { "mmio-fill",      RT_BIT_32(DBGFTRACEREVT_MMIO_FILL) },
+    { "ioport",         RT_BIT_32(DBGFTRACEREVT_IOPORT_READ) | RT_BIT_32(DBGFTRACEREVT_IOPORT_WRITE)
+                      | RT_BIT_32(DBGFTRACEREVT_IOPORT_READ_STR) | RT_BIT_32(DBGFTRACEREVT_IOPORT_WRITE_STR) },
+    { "ioport-read",    RT_BIT_32(DBGFTRACEREVT_IOPORT_READ) },
+    { "ioport-write",   RT_BIT_32(DBGFTRACEREVT_IOPORT_WRITE) },
+    { "ioport-str",     RT_BIT_32(DBGFTRACEREVT_IOPORT_READ_STR) | RT_BIT_32(DBGFTRACEREVT_IOPORT_WRITE_STR) },
+    { "irq",            RT_BIT_32(DBGFTRACEREVT_IRQ) },
+    { "msi",            RT_BIT_32(DBGFTRACEREVT_IOAPIC_MSI) },
+    { "gcphys",         RT_BIT_32(DBGFTRACEREVT_GCPHYS_READ) | RT_BIT_32(DBGFTRACEREVT_GCPHYS_WRITE) },
+    { "gcphys-read",    RT_BIT_32(DBGFTRACEREVT_GCPHYS_READ) },
+    { "gcphys-write",   RT_BIT_32(DBGFTRACEREVT_GCPHYS_WRITE) },
+    { "all",            DBGF_TRACER_EVT_F_ALL }
+};
+
+
 /** The event descriptors written to the trace log. */
 
+static const RTTRACELOGEVTITEMDESC g_EvtSrcRegisterEvtItems[] =
+{
+    {"szName",         "The event source name (zero terminated)",               RTTRACELOGTYPE_RAWDATA, DBGF_TRACER_EVT_PAYLOAD_SZ}
+};
+
 static const RTTRACELOGEVTDESC g_EvtSrcRegisterEvtDesc =
 {
     "EvtSrc.Register",
     "An event source was registered",
     RTTRACELOGEVTSEVERITY_DEBUG,
-    0,
-    NULL
+    RT_ELEMENTS(g_EvtSrcRegisterEvtItems),
+    &g_EvtSrcRegisterEvtItems[0]
 };
 
 
@@ -595,8 +630,12 @@ static int dbgfR3TracerEvtProcess(PDBGFTRACERINSR3 pThis, PDBGFTRACEREVTHDR pEvt
     {
         case DBGFTRACEREVT_SRC_REGISTER:
         {
+            /* The payload contains the zero terminated (and possibly truncated) event source name. */
+            char *pszName = (char *)(pEvtHdr + 1);
+            pszName[DBGF_TRACER_EVT_PAYLOAD_SZ - 1] = '\0';
+
             rc = RTTraceLogWrEvtAddL(pThis->hTraceLog, &g_EvtSrcRegisterEvtDesc, RTTRACELOG_WR_ADD_EVT_F_GRP_START,
-                                     pEvtHdr->hEvtSrc, 0 /*uParentGrpId*/);
+                                     pEvtHdr->hEvtSrc, 0 /*uParentGrpId*/, pszName);
             break;
         }
         case DBGFTRACEREVT_SRC_DEREGISTER:
@@ -729,7 +768,7 @@ static int dbgfR3TracerEvtProcess(PDBGFTRACERINSR3 pThis, PDBGFTRACEREVTHDR pEvt
         {
             PCDBGFTRACEREVTIOAPICMSI pEvtIoApicMsi = (PCDBGFTRACEREVTIOAPICMSI)(pEvtHdr + 1);
 
-            rc = RTTraceLogWrEvtAddL(pThis->hTraceLog, &g_DevIrqEvtDesc, 0 /*fFlags*/,
+            rc = RTTraceLogWrEvtAddL(pThis->hTraceLog, &g_DevIoApicMsiEvtDesc, 0 /*fFlags*/,
                                      pEvtHdr->idEvt, pEvtHdr->hEvtSrc, pEvtIoApicMsi->GCPhys, pEvtIoApicMsi->u32Val);
             break;
         }
@@ -921,10 +960,11 @@ static int dbgfR3TracerInitR3(PDBGFTRACERINSR3 pThis, const char *pszTraceFilePa
  * @param   fR0Enabled              Flag whether the tracer should have R0 support enabled.
  * @param   pszTraceFilePath        The path of the trace file to create.
  * @param   cbRingBuf               Size of the ring buffer in bytes.
+ * @param   fEvtsEnabled            Mask of events to record, see DBGF_TRACER_EVT_F_XXX.
  * @param   ppDbgfTracerR3          Where to store the pointer to the tracer on success.
  */
 static int dbgfR3TracerCreate(PVM pVM, bool fR0Enabled, const char *pszTraceFilePath,
-                              uint32_t cbRingBuf, PDBGFTRACERINSR3 *ppDbgfTracerR3)
+                              uint32_t cbRingBuf, uint32_t fEvtsEnabled, PDBGFTRACERINSR3 *ppDbgfTracerR3)
 {
     PDBGFTRACERINSR3 pThis = NULL;
 
@@ -977,8 +1017,12 @@ static int dbgfR3TracerCreate(PVM pVM, bool fR0Enabled, const char *pszTraceFile
         pThis->pSharedR3->cbRingBuf        = cbRingBuf;
         pThis->pSharedR3->fEvtsWaiting     = false;
         pThis->pSharedR3->fFlushThrdActive = false;
+        pThis->pSharedR3->fEvtsEnabled     = DBGF_TRACER_EVT_F_ALL;
     }
 
+    /* Apply the record time event filter (the ring-0 part initializes it to record everything). */
+    ASMAtomicWriteU32(&pThis->pSharedR3->fEvtsEnabled, fEvtsEnabled | DBGF_TRACER_EVT_F_ALWAYS);
+
     /* Initialize the rest of the R3 tracer instance and spin up the flush thread. */
     int rc = dbgfR3TracerInitR3(pThis, pszTraceFilePath);
     if (RT_SUCCESS(rc))
@@ -993,6 +1037,65 @@ static int dbgfR3TracerCreate(PVM pVM, bool fR0Enabled, const char *pszTraceFile
 }
 
 
+/**
+ * Parses the record time event filter string.
+ *
+ * The filter is a comma or space separated list of event classes (see
+ * g_aTracerEvtFilterClasses), a leading '!' removes the class from the mask.
+ *
+ * @returns VBox status code.
+ * @param   pszFilter               The filter string, NULL or empty for all events.
+ * @param   pfEvtsEnabled           Where to return the event mask.
+ */
+static int dbgfR3TracerParseEvtFilter(const char *pszFilter, uint32_t *pfEvtsEnabled)
+{
+    pszFilter = RTStrStripL(pszFilter ? pszFilter : "");
+    if (!*pszFilter)
+    {
+        *pfEvtsEnabled = DBGF_TRACER_EVT_F_ALL;
+        return VINF_SUCCESS;
+    }
+
+    /* A filter starting with an exclusion works on top of all events. */
+    uint32_t fEvts = *pszFilter == '!' ? DBGF_TRACER_EVT_F_ALL : 0;
+    while (*pszFilter)
+    {
+        while (*pszFilter == ',' || RT_C_IS_SPACE(*pszFilter))
+            pszFilter++;
+        if (!*pszFilter)
+            break;
+
+        bool const fExclude = *pszFilter == '!';
+        if (fExclude)
+            pszFilter++;
+
+        size_t cchClass = 0;
+        while (pszFilter[cchClass] && pszFilter[cchClass] != ',' && !RT_C_IS_SPACE(pszFilter[cchClass]))
+            cchClass++;
+
+        uint32_t i;
+        for (i = 0; i < RT_ELEMENTS(g_aTracerEvtFilterClasses); i++)
+            if (   strlen(g_aTracerEvtFilterClasses[i].pszName) == cchClass
+                && !RTStrNICmp(g_aTracerEvtFilterClasses[i].pszName, pszFilter, cchClass))
+                break;
+        if (i >= RT_ELEMENTS(g_aTracerEvtFilterClasses))
+        {
+            LogRel(("DBGF: Unknown tracer event filter class '%.*s'\n", (int)cchClass, pszFilter));
+            return VERR_INVALID_PARAMETER;
+        }
+
+        if (fExclude)
+            fEvts &= ~g_aTracerEvtFilterClasses[i].fEvts;
+        else
+            fEvts |= g_aTracerEvtFilterClasses[i].fEvts;
+        pszFilter += cchClass;
+    }
+
+    *pfEvtsEnabled = fEvts;
+    return VINF_SUCCESS;
+}
+
+
 /**
  * Initializes and configures the tracer if configured.
  *
@@ -1016,21 +1119,37 @@ DECLHIDDEN(int) dbgfR3TracerInit(PVM pVM)
     {
         bool fR0Enabled;
         uint32_t cbRingBuf = 0;
+        uint32_t fEvtsEnabled = DBGF_TRACER_EVT_F_ALL;
         char *pszTraceFilePath = NULL;
+        char *pszEvtFilter = NULL;
         rc = CFGMR3QueryBoolDef(pDbgfNode, "TracerR0Enabled", &fR0Enabled, false);
         if (RT_SUCCESS(rc))
             rc = CFGMR3QueryU32Def(pDbgfNode, "TracerRingBufSz", &cbRingBuf, _4M);
         if (RT_SUCCESS(rc))
             rc = CFGMR3QueryStringAlloc(pDbgfNode, "TracerFilePath", &pszTraceFilePath);
+        /** @cfgm{/DBGF/TracerEvtFilter, string, all}
+         * Comma separated list of event classes to record (mmio, mmio-read, mmio-write,
+         * mmio-fill, ioport, ioport-read, ioport-write, ioport-str, irq, msi, gcphys,
+         * gcphys-read, gcphys-write, all), prefix a class with '!' to exclude it.
+         * Event source and region management events are always recorded.  Dropping
+         * the guest memory events keeps the tracing overhead low for register level
+         * analysis. */
+        if (RT_SUCCESS(rc))
+            rc = CFGMR3QueryStringAllocDef(pDbgfNode, "TracerEvtFilter", &pszEvtFilter, NULL);
+        if (RT_SUCCESS(rc))
+            rc = dbgfR3TracerParseEvtFilter(pszEvtFilter, &fEvtsEnabled);
         if (RT_SUCCESS(rc))
         {
             AssertLogRelMsgReturn(cbRingBuf && cbRingBuf == (size_t)cbRingBuf,
                                   ("Tracing ringbuffer size %#RX64 is invalid\n", cbRingBuf),
                                   VERR_INVALID_PARAMETER);
 
-            rc = dbgfR3TracerCreate(pVM, fR0Enabled, pszTraceFilePath, cbRingBuf, &pUVM->dbgf.s.pTracerR3);
+            LogRel(("DBGF: Tracer event mask %#RX32\n", fEvtsEnabled | DBGF_TRACER_EVT_F_ALWAYS));
+            rc = dbgfR3TracerCreate(pVM, fR0Enabled, pszTraceFilePath, cbRingBuf, fEvtsEnabled, &pUVM->dbgf.s.pTracerR3);
         }
 
+        if (pszEvtFilter)
+            MMR3HeapFree(pszEvtFilter);
         if (pszTraceFilePath)
         {
             MMR3HeapFree(pszTraceFilePath);
@@ -1093,8 +1212,13 @@ VMMR3_INT_DECL(int) DBGFR3TracerRegisterEvtSrc(PVM pVM, const char *pszName, PDB
 
     DBGFTRACEREVTSRC hEvtSrc = ASMAtomicIncU64((volatile uint64_t *)&pThis->hEvtSrcNext) - 1;
 
+    /* The name goes into the payload so the trace log can be attributed to devices later on. */
+    char szName[DBGF_TRACER_EVT_PAYLOAD_SZ];
+    RT_ZERO(szName);
+    RTStrCopy(szName, sizeof(szName), pszName);
+
     int rc = dbgfTracerR3EvtPostSingle(pVM, pThis, hEvtSrc, DBGFTRACEREVT_SRC_REGISTER,
-                                       NULL /*pvEvtDesc*/, 0 /*cbEvtDesc*/, NULL /*pidEvt*/);
+                                       &szName[0], sizeof(szName), NULL /*pidEvt*/);
     if (RT_SUCCESS(rc))
         *phEvtSrc = hEvtSrc;
 
@@ -431,6 +431,19 @@ GMMR3DECL(int)  GMMR3CheckSharedModules(PVM pVM)
 }
 
 
+/**
+ * @see GMMR0MergeDuplicatePagesReq
+ */
+GMMR3DECL(int) GMMR3MergeDuplicatePages(PVM pVM, PGMMMERGEPAGESREQ pReq)
+{
+    pReq->Hdr.u32Magic = SUPVMMR0REQHDR_MAGIC;
+    pReq->Hdr.cbReq    = RT_UOFFSETOF_DYN(GMMMERGEPAGESREQ, aPages[pReq->cPages]);
+    pReq->cMerged      = 0;
+    pReq->cConverted   = 0;
+    return VMMR3CallR0(pVM, VMMR0_DO_GMM_MERGE_DUPLICATE_PAGES, 0, &pReq->Hdr);
+}
+
+
 #if defined(VBOX_STRICT) && HC_ARCH_BITS == 64
 /**
  * @see GMMR0FindDuplicatePage
@@ -189,6 +189,14 @@ VMMR3DECL(int)      IEMR3Init(PVM pVM)
                           "InitialExecMemSize value %'RU64 (%#RX64) is out of range (max %'RU64)",
                           cbInitialExec, cbInitialExec, cbMaxExec);
 
+    /** @cfgm{/IEM/ExecMemLargePages, bool, true}
+     * Whether to try back the executable memory chunks with large pages where
+     * the host supports it (currently linux only: hugetlbfs, then transparent
+     * huge pages). */
+    bool fExecLargePages = true;
+    rc = CFGMR3QueryBoolDef(pIem, "ExecMemLargePages", &fExecLargePages, true);
+    AssertLogRelRCReturn(rc, rc);
+
     /** @cfgm{/IEM/NativeRecompileAtUsedCount, uint32_t, 16}
      * The translation block use count value to do native recompilation at.
      * Set to zero to disable native recompilation. */
@@ -196,6 +204,26 @@ VMMR3DECL(int)      IEMR3Init(PVM pVM)
     rc = CFGMR3QueryU32Def(pIem, "NativeRecompileAtUsedCount", &uTbNativeRecompileAtUsedCount, 16);
     AssertLogRelRCReturn(rc, rc);
 
+    /** @cfgm{/IEM/NativeRecompileThreads, uint32_t, 0}
+     * Number of background threads to do native recompilation on.  When zero,
+     * native recompilation is done synchronously by the EMT.  Otherwise the
+     * EMT queues hot threaded TBs for the background threads and keeps
+     * executing the threaded code till the native code is ready. */
+    uint32_t cNativeRecompileThreads = 0;
+    rc = CFGMR3QueryU32Def(pIem, "NativeRecompileThreads", &cNativeRecompileThreads, 0);
+    AssertLogRelRCReturn(rc, rc);
+    if (cNativeRecompileThreads > 16)
+        return VMSetError(pVM, VERR_OUT_OF_RANGE, RT_SRC_POS,
+                          "NativeRecompileThreads value %u is out of range (max 16)", cNativeRecompileThreads);
+
+    /** @cfgm{/IEM/RecompilerSuperblocks, bool, false}
+     * Whether to re-record hot threaded translation blocks that were ended for
+     * capacity or pending interrupt reasons as larger superblocks spanning the
+     * following block(s), before doing native recompilation of them. */
+    bool fTbSuperblocks = false;
+    rc = CFGMR3QueryBoolDef(pIem, "RecompilerSuperblocks", &fTbSuperblocks, false);
+    AssertLogRelRCReturn(rc, rc);
+
 #endif /* VBOX_WITH_IEM_RECOMPILER*/
 
     /*
@@ -300,6 +328,7 @@ VMMR3DECL(int)      IEMR3Init(PVM pVM)
          */
         pVCpu->iem.s.uRegFpCtrl                    = IEMNATIVE_SIMD_FP_CTRL_REG_NOT_MODIFIED;
         pVCpu->iem.s.uTbNativeRecompileAtUsedCount = uTbNativeRecompileAtUsedCount;
+        pVCpu->iem.s.fTbSuperblock                 = fTbSuperblocks ? IEMCPU_TB_SUPERBLOCK_F_ENABLED : 0;
 #endif
 
 #ifdef IEM_WITH_TLB_TRACE
@@ -322,9 +351,20 @@ VMMR3DECL(int)      IEMR3Init(PVM pVM)
      * This is done by each EMT to try get more optimal thread/numa locality of
      * the allocations.
      */
-    rc = VMR3ReqCallWait(pVM, VMCPUID_ALL, (PFNRT)iemTbInit, 6,
-                         pVM, cInitialTbs, cMaxTbs, cbInitialExec, cbMaxExec, cbChunkExec);
+    rc = VMR3ReqCallWait(pVM, VMCPUID_ALL, (PFNRT)iemTbInit, 7,
+                         pVM, cInitialTbs, cMaxTbs, cbInitialExec, cbMaxExec, cbChunkExec, fExecLargePages);
     AssertLogRelRCReturn(rc, rc);
+
+# ifdef VBOX_WITH_IEM_NATIVE_RECOMPILER
+    /*
+     * Start the background recompiler threads if configured.
+     */
+    if (cNativeRecompileThreads > 0 && uTbNativeRecompileAtUsedCount > 0)
+    {
+        rc = iemNativeBgInit(pVM, cNativeRecompileThreads);
+        AssertLogRelRCReturn(rc, rc);
+    }
+# endif
 #endif
 
     /*
@@ -400,6 +440,13 @@ VMMR3DECL(int)      IEMR3Init(PVM pVM)
         STAMR3RegisterF(pVM, &pVCpu->iem.s.CodeTlb.cTlbInvlPgLargeNonGlobal, STAMTYPE_U32_RESET, STAMVISIBILITY_ALWAYS, STAMUNIT_NONE,
                         "Code TLB page invlpg scanning for non-global large pages", "/IEM/CPU%u/Tlb/Code/InvlPg/LargeNonGlobal", idCpu);
 
+        STAMR3RegisterF(pVM, &pVCpu->iem.s.CodeTlb.cTlbVictimHits, STAMTYPE_U32_RESET, STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,
+                        "Code TLB misses satisfied by the victim buffer", "/IEM/CPU%u/Tlb/Code/Misses/VictimHits", idCpu);
+        STAMR3RegisterF(pVM, &pVCpu->iem.s.CodeTlb.cTlbLargePageHits, STAMTYPE_U32_RESET, STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,
+                        "Code TLB misses satisfied by a large page entry", "/IEM/CPU%u/Tlb/Code/Misses/LargePageHits", idCpu);
+        STAMR3RegisterF(pVM, &pVCpu->iem.s.CodeTlb.cTlbConflictEvictions, STAMTYPE_U32_RESET, STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,
+                        "Code TLB valid entries evicted by conflicting loads", "/IEM/CPU%u/Tlb/Code/ConflictEvictions", idCpu);
+
         STAMR3RegisterF(pVM, &pVCpu->iem.s.CodeTlb.cTlbCoreMisses,      STAMTYPE_U64_RESET, STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,
                         "Code TLB misses",                              "/IEM/CPU%u/Tlb/Code/Misses", idCpu);
         STAMR3RegisterF(pVM, &pVCpu->iem.s.CodeTlb.cTlbCoreGlobalLoads, STAMTYPE_U64_RESET, STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,
@@ -495,6 +542,13 @@ VMMR3DECL(int)      IEMR3Init(PVM pVM)
         STAMR3RegisterF(pVM, &pVCpu->iem.s.DataTlb.cTlbInvlPgLargeNonGlobal, STAMTYPE_U32_RESET, STAMVISIBILITY_ALWAYS, STAMUNIT_NONE,
                         "Data TLB page invlpg scanning for non-global large pages", "/IEM/CPU%u/Tlb/Data/InvlPg/LargeNonGlobal", idCpu);
 
+        STAMR3RegisterF(pVM, &pVCpu->iem.s.DataTlb.cTlbVictimHits, STAMTYPE_U32_RESET, STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,
+                        "Data TLB misses satisfied by the victim buffer", "/IEM/CPU%u/Tlb/Data/Misses/VictimHits", idCpu);
+        STAMR3RegisterF(pVM, &pVCpu->iem.s.DataTlb.cTlbLargePageHits, STAMTYPE_U32_RESET, STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,
+                        "Data TLB misses satisfied by a large page entry", "/IEM/CPU%u/Tlb/Data/Misses/LargePageHits", idCpu);
+        STAMR3RegisterF(pVM, &pVCpu->iem.s.DataTlb.cTlbConflictEvictions, STAMTYPE_U32_RESET, STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,
+                        "Data TLB valid entries evicted by conflicting loads", "/IEM/CPU%u/Tlb/Data/ConflictEvictions", idCpu);
+
         STAMR3RegisterF(pVM, &pVCpu->iem.s.DataTlb.cTlbCoreMisses,      STAMTYPE_U64_RESET, STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,
                         "Data TLB core misses (iemMemMap, direct iemMemMapJmp (not safe path))",
                         "/IEM/CPU%u/Tlb/Data/Misses/Core", idCpu);
@@ -630,7 +684,19 @@ VMMR3DECL(int)      IEMR3Init(PVM pVM)
 # ifdef VBOX_WITH_STATISTICS
         STAMR3RegisterF(pVM, (void *)&pTbAllocator->StatPrune,          STAMTYPE_PROFILE,   STAMVISIBILITY_ALWAYS, STAMUNIT_TICKS_PER_CALL,
                         "Time spent freeing up TBs when full at alloc", "/IEM/CPU%u/re/TbPruningAlloc", idCpu);
+        STAMR3RegisterF(pVM, (void *)&pTbAllocator->StatEvictStep,      STAMTYPE_PROFILE,   STAMVISIBILITY_ALWAYS, STAMUNIT_TICKS_PER_CALL,
+                        "Time spent on incremental TB eviction",        "/IEM/CPU%u/re/TbEvict/Step", idCpu);
+        STAMR3RegisterF(pVM, (void *)&pTbAllocator->StatEvicted,        STAMTYPE_COUNTER,   STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,
+                        "TBs evicted",                                  "/IEM/CPU%u/re/TbEvict/Evicted", idCpu);
+        STAMR3RegisterF(pVM, (void *)&pTbAllocator->StatEvictedNative,  STAMTYPE_COUNTER,   STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,
+                        "Native TBs evicted",                           "/IEM/CPU%u/re/TbEvict/EvictedNative", idCpu);
+        STAMR3RegisterF(pVM, (void *)&pTbAllocator->StatEvictSpared,    STAMTYPE_COUNTER,   STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,
+                        "TBs spared and aged by the CLOCK hand",        "/IEM/CPU%u/re/TbEvict/Spared", idCpu);
+        STAMR3RegisterF(pVM, (void *)&pTbAllocator->StatRecompiledAfterEvict, STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,
+                        "TBs recompiled for a recently evicted PC (churn)", "/IEM/CPU%u/re/TbEvict/Recompiled", idCpu);
 # endif
+        STAMR3RegisterF(pVM, (void *)&pTbAllocator->cClockLaps,         STAMTYPE_U32,   STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,
+                        "Laps completed by the TB eviction CLOCK hand", "/IEM/CPU%u/re/TbEvict/cLaps", idCpu);
         STAMR3RegisterF(pVM, (void *)&pTbAllocator->StatPruneNative,    STAMTYPE_PROFILE,   STAMVISIBILITY_ALWAYS, STAMUNIT_TICKS_PER_CALL,
                         "Time spent freeing up native TBs when out of executable memory", "/IEM/CPU%u/re/ExecMem/TbPruningNative", idCpu);
         STAMR3RegisterF(pVM, (void *)&pTbAllocator->cAllocatedChunks,   STAMTYPE_U16,   STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,
@@ -691,6 +757,11 @@ VMMR3DECL(int)      IEMR3Init(PVM pVM)
         STAMR3RegisterF(pVM, (void *)&pVCpu->iem.s.StatTbLoopInTbDetected, STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,
                         "Detected loop within TB", "/IEM/CPU%u/re/LoopInTbDetected", idCpu);
 
+        STAMR3RegisterF(pVM, (void *)&pVCpu->iem.s.StatTbSuperblockCandidates, STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,
+                        "Threaded TBs ended for capacity or pending IRQ reasons", "/IEM/CPU%u/re/SuperblockCandidates", idCpu);
+        STAMR3RegisterF(pVM, (void *)&pVCpu->iem.s.StatTbSuperblocksFormed, STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,
+                        "Hot TBs re-recorded as superblocks",           "/IEM/CPU%u/re/SuperblocksFormed", idCpu);
+
         STAMR3RegisterF(pVM, (void *)&pVCpu->iem.s.StatNativeExecMemInstrBufAllocFailed, STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,
                         "Number of times the exec memory allocator failed to allocate a large enough buffer",
                         "/IEM/CPU%u/re/NativeExecMemInstrBufAllocFailed", idCpu);
@@ -708,7 +779,29 @@ VMMR3DECL(int)      IEMR3Init(PVM pVM)
         STAMR3RegisterF(pVM, (void *)&pVCpu->iem.s.StatTbNativeCode, STAMTYPE_PROFILE, STAMVISIBILITY_ALWAYS, STAMUNIT_BYTES_PER_TB,
                         "Size of native code per TB",                   "/IEM/CPU%u/re/NativeCodeSizePerTb", idCpu);
         STAMR3RegisterF(pVM, (void *)&pVCpu->iem.s.StatNativeRecompilation, STAMTYPE_PROFILE, STAMVISIBILITY_ALWAYS, STAMUNIT_TICKS_PER_CALL,
-                        "Profiling iemNativeRecompile()",               "/IEM/CPU%u/re/NativeRecompilation", idCpu);
+                        "Profiling synchronous iemNativeRecompile() on the EMT", "/IEM/CPU%u/re/NativeRecompilation", idCpu);
+
+        STAMR3RegisterF(pVM, (void *)&pVCpu->iem.s.StatNativeBgRecompilation, STAMTYPE_PROFILE, STAMVISIBILITY_USED, STAMUNIT_TICKS_PER_CALL,
+                        "Recompiling a TB on a background thread (added when installed)",
+                        "/IEM/CPU%u/re/NativeBg/Recompilation", idCpu);
+        STAMR3RegisterF(pVM, (void *)&pVCpu->iem.s.StatNativeBgInstall, STAMTYPE_PROFILE, STAMVISIBILITY_USED, STAMUNIT_TICKS_PER_CALL,
+                        "Installing the native code of a background recompiled TB on the EMT",
+                        "/IEM/CPU%u/re/NativeBg/Install", idCpu);
+        STAMR3RegisterF(pVM, (void *)&pVCpu->iem.s.StatNativeBgLatency, STAMTYPE_PROFILE, STAMVISIBILITY_USED, STAMUNIT_NS_PER_OCCURENCE,
+                        "Time from queuing a TB for background recompilation till installing it",
+                        "/IEM/CPU%u/re/NativeBg/Latency", idCpu);
+        STAMR3RegisterF(pVM, (void *)&pVCpu->iem.s.StatNativeBgQueued, STAMTYPE_COUNTER, STAMVISIBILITY_USED, STAMUNIT_OCCURENCES,
+                        "TBs queued for background recompilation",      "/IEM/CPU%u/re/NativeBg/Queued", idCpu);
+        STAMR3RegisterF(pVM, (void *)&pVCpu->iem.s.StatNativeBgQueueFull, STAMTYPE_COUNTER, STAMVISIBILITY_USED, STAMUNIT_OCCURENCES,
+                        "Times the queue was full and the TB was recompiled synchronously",
+                        "/IEM/CPU%u/re/NativeBg/QueueFull", idCpu);
+        STAMR3RegisterF(pVM, (void *)&pVCpu->iem.s.StatNativeBgInstalled, STAMTYPE_COUNTER, STAMVISIBILITY_USED, STAMUNIT_OCCURENCES,
+                        "Background recompiled TBs installed",          "/IEM/CPU%u/re/NativeBg/Installed", idCpu);
+        STAMR3RegisterF(pVM, (void *)&pVCpu->iem.s.StatNativeBgFailed, STAMTYPE_COUNTER, STAMVISIBILITY_USED, STAMUNIT_OCCURENCES,
+                        "Background recompilations that failed",        "/IEM/CPU%u/re/NativeBg/Failed", idCpu);
+        STAMR3RegisterF(pVM, (void *)&pVCpu->iem.s.StatNativeBgCancelled, STAMTYPE_COUNTER, STAMVISIBILITY_USED, STAMUNIT_OCCURENCES,
+                        "Background recompilations cancelled because the TB was freed",
+                        "/IEM/CPU%u/re/NativeBg/Cancelled", idCpu);
 
 # ifdef VBOX_WITH_IEM_NATIVE_RECOMPILER
 #  ifdef VBOX_WITH_STATISTICS
@@ -1055,6 +1148,9 @@ VMMR3DECL(int)      IEMR3Init(PVM pVM)
 VMMR3DECL(int)      IEMR3Term(PVM pVM)
 {
     NOREF(pVM);
+#ifdef VBOX_WITH_IEM_NATIVE_RECOMPILER
+    iemNativeBgTerm(pVM);
+#endif
 #ifdef IEM_WITH_TLB_TRACE
     for (VMCPUID idCpu = 0; idCpu < pVM->cCpus; idCpu++)
     {
@@ -187,6 +187,8 @@ VMMR3_INT_DECL(int) IOMR3Init(PVM pVM)
     STAM_REG(pVM, &pVM->iom.s.StatIoPortInS,        STAMTYPE_COUNTER, "/IOM/IoPortINS",         STAMUNIT_OCCURENCES, "Number of INS instructions (attempts)");
     STAM_REG(pVM, &pVM->iom.s.StatIoPortOutS,       STAMTYPE_COUNTER, "/IOM/IoPortOUT",         STAMUNIT_OCCURENCES, "Number of OUT instructions (attempts)");
     STAM_REG(pVM, &pVM->iom.s.StatIoPortOutS,       STAMTYPE_COUNTER, "/IOM/IoPortOUTS",        STAMUNIT_OCCURENCES, "Number of OUTS instructions (attempts)");
+    STAM_REG(pVM, &pVM->iom.s.StatIoPortInShared,   STAMTYPE_COUNTER, "/IOM/IoPortINShared",    STAMUNIT_OCCURENCES, "Number of IN instructions completed by a shared handler.");
+    STAM_REG(pVM, &pVM->iom.s.StatIoPortInSharedFallback, STAMTYPE_COUNTER, "/IOM/IoPortINSharedFallback", STAMUNIT_OCCURENCES, "Number of IN instructions a shared handler passed on to the exclusive one.");
 
     STAM_REG(pVM, &pVM->iom.s.StatMmioHandlerR3,    STAMTYPE_COUNTER, "/IOM/MmioHandlerR3",     STAMUNIT_OCCURENCES, "Number of calls to iomMmioHandlerNew from ring-3.");
     STAM_REG(pVM, &pVM->iom.s.StatMmioHandlerR0,    STAMTYPE_COUNTER, "/IOM/MmioHandlerR0",     STAMUNIT_OCCURENCES, "Number of calls to iomMmioHandlerNew from ring-0.");
@@ -197,6 +199,11 @@ VMMR3_INT_DECL(int) IOMR3Init(PVM pVM)
     STAM_REG(pVM, &pVM->iom.s.StatMmioPhysHandler,  STAMTYPE_PROFILE, "/IOM/MmioPhysHandler",   STAMUNIT_TICKS_PER_CALL, "Number of calls to IOMR0MmioPhysHandler.");
     STAM_REG(pVM, &pVM->iom.s.StatMmioCommitsDirect,STAMTYPE_COUNTER, "/IOM/MmioCommitsDirect", STAMUNIT_OCCURENCES, "Number of ring-3 MMIO commits direct to handler via handle hint.");
     STAM_REG(pVM, &pVM->iom.s.StatMmioCommitsPgm,   STAMTYPE_COUNTER, "/IOM/MmioCommitsPgm",    STAMUNIT_OCCURENCES, "Number of ring-3 MMIO commits via PGM.");
+    STAM_REG(pVM, &pVM->iom.s.StatMmioLookupHint,   STAMTYPE_COUNTER, "/IOM/MmioLookupHint",    STAMUNIT_OCCURENCES, "MMIO lookups resolved by the per-vCPU hint.");
+    STAM_REG(pVM, &pVM->iom.s.StatMmioLookupPageMap,STAMTYPE_COUNTER, "/IOM/MmioLookupPageMap", STAMUNIT_OCCURENCES, "MMIO lookups resolved by the page map.");
+    STAM_REG(pVM, &pVM->iom.s.StatMmioLookupSearch, STAMTYPE_COUNTER, "/IOM/MmioLookupSearch",  STAMUNIT_OCCURENCES, "MMIO lookups requiring a binary search.");
+    STAM_REG(pVM, &pVM->iom.s.StatMmioReadShared,   STAMTYPE_COUNTER, "/IOM/MmioReadShared",    STAMUNIT_OCCURENCES, "Number of MMIO reads completed by a shared handler.");
+    STAM_REG(pVM, &pVM->iom.s.StatMmioReadSharedFallback, STAMTYPE_COUNTER, "/IOM/MmioReadSharedFallback", STAMUNIT_OCCURENCES, "Number of MMIO reads a shared handler passed on to the exclusive one.");
     STAM_REL_REG(pVM, &pVM->iom.s.StatMmioStaleMappings,   STAMTYPE_COUNTER, "/IOM/MmioMappingsStale",              STAMUNIT_TICKS_PER_CALL, "Number of times iomMmioHandlerNew got a call for a remapped range at the old mapping.");
     STAM_REL_REG(pVM, &pVM->iom.s.StatMmioTooDeepRecursion, STAMTYPE_COUNTER, "/IOM/MmioTooDeepRecursion",          STAMUNIT_OCCURENCES,     "Number of times iomMmioHandlerNew detected too deep recursion and took default action.");
     STAM_REG(pVM, &pVM->iom.s.StatMmioDevLockContentionR0, STAMTYPE_COUNTER, "/IOM/MmioDevLockContentionR0",        STAMUNIT_OCCURENCES,     "Number of device lock contention force return to ring-3.");
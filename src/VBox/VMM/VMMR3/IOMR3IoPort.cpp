@@ -297,20 +297,21 @@ static int iomR3IoPortGrowTable(PVM pVM, uint32_t cNewEntries)
         AssertReturn(cNewEntries >= cOldEntries, VERR_IOM_IOPORT_IPE_1);
 
         /*
-         * Allocate the new tables.  We use a single allocation for the three tables (ring-0,
-         * ring-3, lookup) and does a partial mapping of the result to ring-3.
+         * Allocate the new tables.  We use a single allocation for the three tables (ring-3,
+         * lookup, direct).
          */
         uint32_t const cbRing3  = RT_ALIGN_32(cNewEntries * sizeof(IOMIOPORTENTRYR3),     HOST_PAGE_SIZE);
-        uint32_t const cbShared = RT_ALIGN_32(cNewEntries * sizeof(IOMIOPORTLOOKUPENTRY), HOST_PAGE_SIZE);
-        uint32_t const cbNew    = cbRing3 + cbShared;
+        uint32_t const cbLookup = RT_ALIGN_32(cNewEntries * sizeof(IOMIOPORTLOOKUPENTRY), HOST_PAGE_SIZE);
+        uint32_t const cbNew    = cbRing3 + cbLookup + RT_ALIGN_32(IOM_IOPORT_DIRECT_SIZE, HOST_PAGE_SIZE);
 
         /* Use the rounded up space as best we can. */
-        cNewEntries = RT_MIN(cbRing3 / sizeof(IOMIOPORTENTRYR3), cbShared / sizeof(IOMIOPORTLOOKUPENTRY));
+        cNewEntries = RT_MIN(cbRing3 / sizeof(IOMIOPORTENTRYR3), cbLookup / sizeof(IOMIOPORTLOOKUPENTRY));
 
         PIOMIOPORTENTRYR3 const paRing3 = (PIOMIOPORTENTRYR3)RTMemPageAllocZ(cbNew);
         if (paRing3)
         {
-            PIOMIOPORTLOOKUPENTRY const paLookup = (PIOMIOPORTLOOKUPENTRY)((uintptr_t)paRing3 + cbRing3);
+            PIOMIOPORTLOOKUPENTRY const paLookup    = (PIOMIOPORTLOOKUPENTRY)((uintptr_t)paRing3 + cbRing3);
+            uint32_t *            const pau32Direct = (uint32_t *)((uintptr_t)paLookup + cbLookup);
 
             /*
              * Copy over the old info and initialize the idxSelf and idxStats members.
@@ -319,6 +320,7 @@ static int iomR3IoPortGrowTable(PVM pVM, uint32_t cNewEntries)
             {
                 memcpy(paRing3,  pVM->iom.s.paIoPortRegs,    sizeof(paRing3[0])  * cOldEntries);
                 memcpy(paLookup, pVM->iom.s.paIoPortLookup,  sizeof(paLookup[0]) * cOldEntries);
+                memcpy(pau32Direct, pVM->iom.s.pau32IoPortDirect, IOM_IOPORT_DIRECT_SIZE);
             }
 
             size_t i = cbRing3 / sizeof(*paRing3);
@@ -335,11 +337,13 @@ static int iomR3IoPortGrowTable(PVM pVM, uint32_t cNewEntries)
 
             pVM->iom.s.paIoPortRegs     = paRing3;
             pVM->iom.s.paIoPortLookup   = paLookup;
+            pVM->iom.s.pau32IoPortDirect = pau32Direct;
             pVM->iom.s.cIoPortAlloc     = cNewEntries;
 
             RTMemPageFree(pvFree,
                             RT_ALIGN_32(cOldEntries * sizeof(IOMIOPORTENTRYR3),     HOST_PAGE_SIZE)
-                          + RT_ALIGN_32(cOldEntries * sizeof(IOMIOPORTLOOKUPENTRY), HOST_PAGE_SIZE));
+                          + RT_ALIGN_32(cOldEntries * sizeof(IOMIOPORTLOOKUPENTRY), HOST_PAGE_SIZE)
+                          + RT_ALIGN_32(IOM_IOPORT_DIRECT_SIZE,                     HOST_PAGE_SIZE));
 
             rc = VINF_SUCCESS;
         }
@@ -430,6 +434,8 @@ VMMR3_INT_DECL(int)  IOMR3IoPortCreate(PVM pVM, PPDMDEVINS pDevIns, RTIOPORT cPo
     pVM->iom.s.paIoPortRegs[idx].pfnInCallback      = pfnIn     ? pfnIn     : iomR3IOPortDummyNewIn;
     pVM->iom.s.paIoPortRegs[idx].pfnOutStrCallback  = pfnOutStr ? pfnOutStr : iomR3IOPortDummyNewOutStr;
     pVM->iom.s.paIoPortRegs[idx].pfnInStrCallback   = pfnInStr  ? pfnInStr  : iomR3IOPortDummyNewInStr;
+    pVM->iom.s.paIoPortRegs[idx].pfnInSharedCallback = NULL;
+    pVM->iom.s.paIoPortRegs[idx].pCritSectRw        = NULL;
     pVM->iom.s.paIoPortRegs[idx].pszDesc            = pszDesc;
     pVM->iom.s.paIoPortRegs[idx].paExtDescs         = paExtDescs;
     pVM->iom.s.paIoPortRegs[idx].pPciDev            = pPciDev;
@@ -544,6 +550,10 @@ VMMR3_INT_DECL(int)  IOMR3IoPortMap(PVM pVM, PPDMDEVINS pDevIns, IOMIOPORTHANDLE
         pRegEntry->uPort   = uPort;
         pRegEntry->fMapped = true;
 
+        uint32_t const uDirect = IOM_IOPORT_DIRECT_MAKE(hIoPorts, uPort);
+        for (uint32_t iPort = uPort; iPort <= uLastPort; iPort++)
+            pVM->iom.s.pau32IoPortDirect[iPort] = uDirect;
+
 #ifdef VBOX_WITH_STATISTICS
         /* Don't register stats here when we're creating the VM as the
            statistics table may still be reallocated. */
@@ -648,6 +658,8 @@ VMMR3_INT_DECL(int)  IOMR3IoPortUnmap(PVM pVM, PPDMDEVINS pDevIns, IOMIOPORTHAND
                 if (i + 1 < cEntries)
                     memmove(pEntry, pEntry + 1, sizeof(*pEntry) * (cEntries - i - 1));
                 pVM->iom.s.cIoPortLookupEntries = cEntries - 1;
+                for (uint32_t iPort = uPort; iPort <= uLastPort; iPort++)
+                    pVM->iom.s.pau32IoPortDirect[iPort] = 0;
                 pRegEntry->uPort   = UINT16_MAX;
                 pRegEntry->fMapped = false;
                 rc = VINF_SUCCESS;
@@ -714,6 +726,57 @@ VMMR3_INT_DECL(int)  IOMR3IoPortValidateHandle(PVM pVM, PPDMDEVINS pDevIns, IOMI
 }
 
 
+/**
+ * Sets up a shared IN handler for the I/O ports @a hIoPorts.
+ *
+ * IN accesses to the ports are first offered to @a pfnInShared, which is
+ * called while holding @a pCritSectRw in shared mode and without entering the
+ * device critical section.  Several EMTs can thus read the ports concurrently.
+ * When the handler returns VINF_IOM_READ_NEEDS_EXCLUSIVE, IOM retries the
+ * access the normal way, i.e. calling the regular IN handler while owning the
+ * device critical section.
+ *
+ * The device is responsible for entering @a pCritSectRw exclusively whenever
+ * it modifies state @a pfnInShared depends on in a way that must not be seen
+ * half done.  It does so while owning the device critical section, so
+ * @a pfnInShared must not enter it, and the critical section is left before
+ * the regular IN handler is called.
+ *
+ * @returns VBox status code.
+ * @param   pVM             The cross context VM structure.
+ * @param   pDevIns         The device which owns @a hIoPorts.
+ * @param   hIoPorts        The I/O port handle.
+ * @param   pCritSectRw     The read/write critical section protecting the
+ *                          state accessed by @a pfnInShared.
+ * @param   pfnInShared     The shared IN handler.
+ * @thread  EMT(0)
+ * @note    Only callable at VM creation time.
+ */
+VMMR3_INT_DECL(int)  IOMR3IoPortSetInShared(PVM pVM, PPDMDEVINS pDevIns, IOMIOPORTHANDLE hIoPorts,
+                                            PPDMCRITSECTRW pCritSectRw, PFNIOMIOPORTNEWIN pfnInShared)
+{
+    /*
+     * Validate input and state.
+     */
+    VM_ASSERT_EMT0_RETURN(pVM, VERR_VM_THREAD_NOT_EMT);
+    VM_ASSERT_STATE_RETURN(pVM, VMSTATE_CREATING, VERR_VM_INVALID_VM_STATE);
+    AssertPtrReturn(pDevIns, VERR_INVALID_HANDLE);
+    AssertReturn(hIoPorts < RT_MIN(pVM->iom.s.cIoPortRegs, pVM->iom.s.cIoPortAlloc), VERR_IOM_INVALID_IOPORT_HANDLE);
+    PIOMIOPORTENTRYR3 const pRegEntry = &pVM->iom.s.paIoPortRegs[hIoPorts];
+    AssertReturn(pRegEntry->pDevIns == pDevIns, VERR_IOM_INVALID_IOPORT_HANDLE);
+    AssertPtrReturn(pfnInShared, VERR_INVALID_POINTER);
+    AssertPtrReturn(pCritSectRw, VERR_INVALID_POINTER);
+    AssertReturn(PDMCritSectRwIsInitialized(pCritSectRw), VERR_INVALID_PARAMETER);
+
+    /*
+     * Do the job.
+     */
+    pRegEntry->pCritSectRw         = pCritSectRw;
+    pRegEntry->pfnInSharedCallback = pfnInShared;
+    return VINF_SUCCESS;
+}
+
+
 /**
  * Gets the mapping address of I/O ports @a hIoPorts.
  *
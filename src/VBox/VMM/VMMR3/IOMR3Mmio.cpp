@@ -209,20 +209,21 @@ static int iomR3MmioGrowTable(PVM pVM, uint32_t cNewEntries)
         AssertReturn(cNewEntries >= cOldEntries, VERR_IOM_MMIO_IPE_1);
 
         /*
-         * Allocate the new tables.  We use a single allocation for the three tables (ring-0,
-         * ring-3, lookup) and does a partial mapping of the result to ring-3.
+         * Allocate the new tables.  We use a single allocation for the three tables (ring-3,
+         * lookup, page map).
          */
         uint32_t const cbRing3  = RT_ALIGN_32(cNewEntries * sizeof(IOMMMIOENTRYR3),     HOST_PAGE_SIZE);
-        uint32_t const cbShared = RT_ALIGN_32(cNewEntries * sizeof(IOMMMIOLOOKUPENTRY), HOST_PAGE_SIZE);
-        uint32_t const cbNew    = cbRing3 + cbShared;
+        uint32_t const cbLookup = RT_ALIGN_32(cNewEntries * sizeof(IOMMMIOLOOKUPENTRY), HOST_PAGE_SIZE);
+        uint32_t const cbNew    = cbRing3 + cbLookup + RT_ALIGN_32(IOM_MMIO_PAGE_MAP_SIZE, HOST_PAGE_SIZE);
 
         /* Use the rounded up space as best we can. */
-        cNewEntries = RT_MIN(cbRing3 / sizeof(IOMMMIOENTRYR3), cbShared / sizeof(IOMMMIOLOOKUPENTRY));
+        cNewEntries = RT_MIN(cbRing3 / sizeof(IOMMMIOENTRYR3), cbLookup / sizeof(IOMMMIOLOOKUPENTRY));
 
         PIOMMMIOENTRYR3 const paRing3 = (PIOMMMIOENTRYR3)RTMemPageAllocZ(cbNew);
         if (paRing3)
         {
-            PIOMMMIOLOOKUPENTRY const paLookup = (PIOMMMIOLOOKUPENTRY)((uintptr_t)paRing3 + cbRing3);
+            PIOMMMIOLOOKUPENTRY const paLookup     = (PIOMMMIOLOOKUPENTRY)((uintptr_t)paRing3 + cbRing3);
+            uint64_t volatile * const pau64PageMap = (uint64_t volatile *)((uintptr_t)paLookup + cbLookup);
 
             /*
              * Copy over the old info and initialize the idxSelf and idxStats members.
@@ -247,11 +248,13 @@ static int iomR3MmioGrowTable(PVM pVM, uint32_t cNewEntries)
 
             pVM->iom.s.paMmioRegs     = paRing3;
             pVM->iom.s.paMmioLookup   = paLookup;
+            pVM->iom.s.pau64MmioPageMap = pau64PageMap;
             pVM->iom.s.cMmioAlloc     = cNewEntries;
 
             RTMemPageFree(pvFree,
                             RT_ALIGN_32(cOldEntries * sizeof(IOMMMIOENTRYR3),     HOST_PAGE_SIZE)
-                          + RT_ALIGN_32(cOldEntries * sizeof(IOMMMIOLOOKUPENTRY), HOST_PAGE_SIZE));
+                          + RT_ALIGN_32(cOldEntries * sizeof(IOMMMIOLOOKUPENTRY), HOST_PAGE_SIZE)
+                          + RT_ALIGN_32(IOM_MMIO_PAGE_MAP_SIZE,                 HOST_PAGE_SIZE));
 
             rc = VINF_SUCCESS;
         }
@@ -342,6 +345,8 @@ VMMR3_INT_DECL(int)  IOMR3MmioCreate(PVM pVM, PPDMDEVINS pDevIns, RTGCPHYS cbReg
     pVM->iom.s.paMmioRegs[idx].pfnWriteCallback   = pfnWrite;
     pVM->iom.s.paMmioRegs[idx].pfnReadCallback    = pfnRead;
     pVM->iom.s.paMmioRegs[idx].pfnFillCallback    = pfnFill;
+    pVM->iom.s.paMmioRegs[idx].pfnReadSharedCallback = NULL;
+    pVM->iom.s.paMmioRegs[idx].pCritSectRw        = NULL;
     pVM->iom.s.paMmioRegs[idx].pszDesc            = pszDesc;
     pVM->iom.s.paMmioRegs[idx].pPciDev            = pPciDev;
     pVM->iom.s.paMmioRegs[idx].iPciRegion         = iPciRegion;
@@ -478,6 +483,7 @@ VMMR3_INT_DECL(int)  IOMR3MmioMap(PVM pVM, PVMCPU pVCpu, PPDMDEVINS pDevIns, IOM
         pEntry->GCPhysFirst = GCPhys;
         pEntry->GCPhysLast  = GCPhysLast;
         pVM->iom.s.cMmioLookupEntries = cEntries + 1;
+        RT_BZERO((void *)pVM->iom.s.pau64MmioPageMap, IOM_MMIO_PAGE_MAP_SIZE); /* lookup indexes shifted */
 
 #ifdef VBOX_WITH_STATISTICS
         /* Don't register stats here when we're creating the VM as the
@@ -580,6 +586,7 @@ VMMR3_INT_DECL(int) IOMR3MmioUnmap(PVM pVM, PVMCPU pVCpu, PPDMDEVINS pDevIns, IO
                 if (i + 1 < cEntries)
                     memmove(pEntry, pEntry + 1, sizeof(*pEntry) * (cEntries - i - 1));
                 pVM->iom.s.cMmioLookupEntries = cEntries - 1;
+                RT_BZERO((void *)pVM->iom.s.pau64MmioPageMap, IOM_MMIO_PAGE_MAP_SIZE); /* lookup indexes shifted */
 
                 rc = PGMR3PhysMmioUnmap(pVM, pVCpu, GCPhys, pRegEntry->cbRegion, pRegEntry->idRamRange);
                 AssertRC(rc);
@@ -654,6 +661,53 @@ VMMR3_INT_DECL(int)  IOMR3MmioValidateHandle(PVM pVM, PPDMDEVINS pDevIns, IOMMMI
 }
 
 
+/**
+ * Sets up a shared read handler for the MMIO region @a hRegion.
+ *
+ * Simple reads, i.e. the ones IOM would pass straight on to the regular read
+ * handler without splitting them up, are first offered to @a pfnReadShared.
+ * It is called while holding @a pCritSectRw in shared mode and without
+ * entering the device critical section.  When it returns
+ * VINF_IOM_READ_NEEDS_EXCLUSIVE, IOM retries the access the normal way.
+ *
+ * See IOMR3IoPortSetInShared for the device's locking obligations.
+ *
+ * @returns VBox status code.
+ * @param   pVM             The cross context VM structure.
+ * @param   pDevIns         The device which owns @a hRegion.
+ * @param   hRegion         The MMIO region handle.
+ * @param   pCritSectRw     The read/write critical section protecting the
+ *                          state accessed by @a pfnReadShared.
+ * @param   pfnReadShared   The shared read handler.
+ * @thread  EMT(0)
+ * @note    Only callable at VM creation time.
+ */
+VMMR3_INT_DECL(int)  IOMR3MmioSetReadShared(PVM pVM, PPDMDEVINS pDevIns, IOMMMIOHANDLE hRegion,
+                                            PPDMCRITSECTRW pCritSectRw, PFNIOMMMIONEWREAD pfnReadShared)
+{
+    /*
+     * Validate input and state.
+     */
+    VM_ASSERT_EMT0_RETURN(pVM, VERR_VM_THREAD_NOT_EMT);
+    VM_ASSERT_STATE_RETURN(pVM, VMSTATE_CREATING, VERR_VM_INVALID_VM_STATE);
+    AssertPtrReturn(pDevIns, VERR_INVALID_HANDLE);
+    AssertReturn(hRegion < RT_MIN(pVM->iom.s.cMmioRegs, pVM->iom.s.cMmioAlloc), VERR_IOM_INVALID_MMIO_HANDLE);
+    PIOMMMIOENTRYR3 const pRegEntry = &pVM->iom.s.paMmioRegs[hRegion];
+    AssertReturn(pRegEntry->pDevIns == pDevIns, VERR_IOM_INVALID_MMIO_HANDLE);
+    AssertReturn(pRegEntry->pfnReadCallback, VERR_WRONG_ORDER);
+    AssertPtrReturn(pfnReadShared, VERR_INVALID_POINTER);
+    AssertPtrReturn(pCritSectRw, VERR_INVALID_POINTER);
+    AssertReturn(PDMCritSectRwIsInitialized(pCritSectRw), VERR_INVALID_PARAMETER);
+
+    /*
+     * Do the job.
+     */
+    pRegEntry->pCritSectRw           = pCritSectRw;
+    pRegEntry->pfnReadSharedCallback = pfnReadShared;
+    return VINF_SUCCESS;
+}
+
+
 /**
  * Gets the mapping address of MMIO region @a hRegion.
  *
@@ -33,6 +33,7 @@
 #include "PDMInternal.h"
 #include <VBox/vmm/pdmcritsect.h>
 #include <VBox/vmm/pdmcritsectrw.h>
+#include <VBox/vmm/cfgm.h>
 #include <VBox/vmm/mm.h>
 #include <VBox/vmm/vm.h>
 #include <VBox/vmm/uvm.h>
@@ -44,8 +45,10 @@
 #include <iprt/assert.h>
 #include <iprt/getopt.h>
 #include <iprt/lockvalidator.h>
+#include <iprt/mem.h>
 #include <iprt/string.h>
 #include <iprt/thread.h>
+#include <iprt/time.h>
 
 
 /*********************************************************************************************************************************
@@ -53,8 +56,10 @@
 *********************************************************************************************************************************/
 static int pdmR3CritSectDeleteOne(PVM pVM, PUVM pUVM, PPDMCRITSECTINT pCritSect, PPDMCRITSECTINT pPrev, bool fFinal);
 static int pdmR3CritSectRwDeleteOne(PVM pVM, PUVM pUVM, PPDMCRITSECTRWINT pCritSect, PPDMCRITSECTRWINT pPrev, bool fFinal);
+static void pdmR3CritSectProfEnable(PUVM pUVM);
 static FNDBGFINFOARGVINT pdmR3CritSectInfo;
 static FNDBGFINFOARGVINT pdmR3CritSectRwInfo;
+static FNDBGFINFOARGVINT pdmR3CritSectProfInfo;
 
 
 
@@ -98,12 +103,33 @@ int pdmR3CritSectBothInitStatsAndInfo(PVM pVM)
     STAM_REL_REG(pVM, &pVM->pdm.s.StatCritSectRwSharedNonInterruptibleWaits, STAMTYPE_COUNTER, "/PDM/CritSectsRw/00-Shared-Non-interruptible-Waits-VINF_SUCCESS",
                  STAMUNIT_OCCURENCES, "Number of non-interruptible waits for rcBusy=VINF_SUCCESS in exclusive mode");
 
+    /*
+     * Contention profiling.
+     */
+    /** @cfgm{/PDM/CritSectProfiling, bool, false}
+     * Enables ring-3 contention profiling of the critical sections (exclusive
+     * access only for the read/write ones).  This records wait and hold time
+     * histograms together with the top owning call sites for each section, see
+     * the 'critsectprof' info item.  It can also be enabled at runtime using
+     * 'critsectprof --enable'. */
+    bool fCritSectProfiling = false;
+    int rc = CFGMR3QueryBoolDef(CFGMR3GetChild(CFGMR3GetRoot(pVM), "PDM"), "CritSectProfiling", &fCritSectProfiling, false);
+    AssertLogRelRCReturn(rc, rc);
+    if (fCritSectProfiling)
+    {
+        LogRel(("PDM: Critical section contention profiling enabled\n"));
+        pdmR3CritSectProfEnable(pVM->pUVM);
+    }
+
     /*
      * Info items.
      */
     DBGFR3InfoRegisterInternalArgv(pVM, "critsect", "Show critical section: critsect [-v] [pattern[...]]", pdmR3CritSectInfo, 0);
     DBGFR3InfoRegisterInternalArgv(pVM, "critsectrw", "Show read/write critical section: critsectrw [-v] [pattern[...]]",
                                    pdmR3CritSectRwInfo, 0);
+    DBGFR3InfoRegisterInternalArgv(pVM, "critsectprof",
+                                   "Show critical section contention profile: critsectprof [--enable] [--reset] [-v] [pattern[...]]",
+                                   pdmR3CritSectProfInfo, 0);
 
     return VINF_SUCCESS;
 }
@@ -150,6 +176,151 @@ VMMR3_INT_DECL(int) PDMR3CritSectBothTerm(PVM pVM)
 }
 
 
+/**
+ * Allocates and initializes contention profiling data for a critical section.
+ *
+ * @returns Pointer to the profiling data, NULL if out of memory.
+ */
+static PPDMCRITSECTPROF pdmR3CritSectProfAlloc(void)
+{
+    PPDMCRITSECTPROF pProf = (PPDMCRITSECTPROF)RTMemAllocZ(sizeof(*pProf));
+    if (pProf)
+        pProf->idxCallerOwner = UINT32_MAX;
+    return pProf;
+}
+
+
+/**
+ * Translates a nanosecond interval into a profiling histogram bucket.
+ *
+ * @returns Bucket index, the last one catches everything larger.
+ * @param   cNs         The interval.
+ */
+DECLINLINE(unsigned) pdmR3CritSectProfBucket(uint64_t cNs)
+{
+    unsigned const iBit = ASMBitLastSetU64(cNs);
+    return iBit ? RT_MIN(iBit - 1, PDMCRITSECTPROF_HIST_BUCKETS - 1) : 0;
+}
+
+
+/**
+ * Records a successful non-nested ring-3 enter of a profiled critical section.
+ *
+ * Called by the owner right after acquiring the section.
+ *
+ * @param   pProf           The profiling data of the critical section.
+ * @param   uCaller         The return address of the enter API caller, or the
+ *                          location ID given to the debug APIs (the device
+ *                          helpers pass on their caller's address there).
+ * @param   nsStartWait     RTTimeNanoTS() before the enter attempt if the
+ *                          section was owned by another thread, otherwise 0.
+ */
+void pdmR3CritSectProfEntered(PPDMCRITSECTPROF pProf, uintptr_t uCaller, uint64_t nsStartWait)
+{
+    uint64_t const nsNow = RTTimeNanoTS();
+    pProf->cEnters++;
+    if (nsStartWait)
+    {
+        uint64_t const cNsWait = nsNow - nsStartWait;
+        pProf->cContended++;
+        pProf->cNsWaitTotal += cNsWait;
+        if (cNsWait > pProf->cNsWaitMax)
+            pProf->cNsWaitMax = cNsWait;
+        pProf->acWait[pdmR3CritSectProfBucket(cNsWait)]++;
+    }
+
+    /*
+     * Look up the call site.  If not found, take over the entry with the fewest
+     * enters and inherit its count as error margin (space-saving top-K).
+     */
+    uint32_t idxMin = 0;
+    uint32_t idx;
+    for (idx = 0; idx < RT_ELEMENTS(pProf->aCallers); idx++)
+    {
+        if (pProf->aCallers[idx].uAddr == uCaller)
+            break;
+        if (pProf->aCallers[idx].cEnters < pProf->aCallers[idxMin].cEnters)
+            idxMin = idx;
+    }
+    if (idx >= RT_ELEMENTS(pProf->aCallers))
+    {
+        idx = idxMin;
+        PPDMCRITSECTPROFCALLER const pCaller = &pProf->aCallers[idx];
+        pCaller->uAddr      = uCaller;
+        pCaller->cErr       = pCaller->cEnters;
+        pCaller->cNsHeld    = 0;
+        pCaller->cNsHeldMax = 0;
+    }
+    pProf->aCallers[idx].cEnters++;
+
+    pProf->idxCallerOwner = idx;
+    pProf->nsEnter        = nsNow;
+}
+
+
+/**
+ * Records the hold time when leaving a profiled critical section for real.
+ *
+ * Called by the owner right before releasing the section.
+ *
+ * @param   pProf           The profiling data of the critical section.
+ */
+void pdmR3CritSectProfLeaving(PPDMCRITSECTPROF pProf)
+{
+    uint64_t const nsEnter = pProf->nsEnter;
+    if (nsEnter)
+    {
+        uint64_t const cNsHold = RTTimeNanoTS() - nsEnter;
+        pProf->nsEnter = 0;
+        pProf->cNsHoldTotal += cNsHold;
+        if (cNsHold > pProf->cNsHoldMax)
+            pProf->cNsHoldMax = cNsHold;
+        pProf->acHold[pdmR3CritSectProfBucket(cNsHold)]++;
+
+        uint32_t const idx = pProf->idxCallerOwner;
+        if (idx < RT_ELEMENTS(pProf->aCallers))
+        {
+            pProf->aCallers[idx].cNsHeld += cNsHold;
+            if (cNsHold > pProf->aCallers[idx].cNsHeldMax)
+                pProf->aCallers[idx].cNsHeldMax = cNsHold;
+        }
+        pProf->idxCallerOwner = UINT32_MAX;
+    }
+}
+
+
+/**
+ * Enables contention profiling for all current and future critical sections.
+ *
+ * @param   pUVM        The user mode VM handle.
+ */
+static void pdmR3CritSectProfEnable(PUVM pUVM)
+{
+    RTCritSectEnter(&pUVM->pdm.s.ListCritSect);
+    pUVM->pdm.s.fCritSectProfiling = true;
+
+    for (PPDMCRITSECTINT pCritSect = pUVM->pdm.s.pCritSects; pCritSect; pCritSect = pCritSect->pNext)
+        if (   !pCritSect->pProfR3
+            && !(pCritSect->Core.fFlags & RTCRITSECT_FLAGS_NOP))
+        {
+            PPDMCRITSECTPROF pProf = pdmR3CritSectProfAlloc();
+            if (pProf)
+                ASMAtomicWritePtr(&pCritSect->pProfR3, pProf);
+        }
+
+    for (PPDMCRITSECTRWINT pCritSect = pUVM->pdm.s.pRwCritSects; pCritSect; pCritSect = pCritSect->pNext)
+        if (   !pCritSect->pProfR3
+            && !(pCritSect->Core.fFlags & RTCRITSECT_FLAGS_NOP))
+        {
+            PPDMCRITSECTPROF pProf = pdmR3CritSectProfAlloc();
+            if (pProf)
+                ASMAtomicWritePtr(&pCritSect->pProfR3, pProf);
+        }
+
+    RTCritSectLeave(&pUVM->pdm.s.ListCritSect);
+}
+
+
 /**
  * Initializes a critical section and inserts it into the list.
  *
@@ -235,6 +406,7 @@ static int pdmR3CritSectInitOne(PVM pVM, PPDMCRITSECTINT pCritSect, void *pvKey,
                  */
                 PUVM pUVM = pVM->pUVM;
                 RTCritSectEnter(&pUVM->pdm.s.ListCritSect);
+                pCritSect->pProfR3 = pUVM->pdm.s.fCritSectProfiling ? pdmR3CritSectProfAlloc() : NULL;
                 pCritSect->pNext = pUVM->pdm.s.pCritSects;
                 pUVM->pdm.s.pCritSects = pCritSect;
                 RTCritSectLeave(&pUVM->pdm.s.ListCritSect);
@@ -344,6 +516,7 @@ static int pdmR3CritSectRwInitOne(PVM pVM, PPDMCRITSECTRWINT pCritSect, void *pv
                      */
                     PUVM pUVM = pVM->pUVM;
                     RTCritSectEnter(&pUVM->pdm.s.ListCritSect);
+                    pCritSect->pProfR3 = pUVM->pdm.s.fCritSectProfiling ? pdmR3CritSectProfAlloc() : NULL;
                     pCritSect->pNext = pUVM->pdm.s.pRwCritSects;
                     pUVM->pdm.s.pRwCritSects = pCritSect;
                     RTCritSectLeave(&pUVM->pdm.s.ListCritSect);
@@ -576,6 +749,8 @@ static int pdmR3CritSectDeleteOne(PVM pVM, PUVM pUVM, PPDMCRITSECTINT pCritSect,
     int rc = SUPSemEventClose(pVM->pSession, hEvent);
     AssertRC(rc);
     RTLockValidatorRecExclDestroy(&pCritSect->Core.pValidatorRec);
+    RTMemFree(pCritSect->pProfR3);
+    pCritSect->pProfR3 = NULL;
     pCritSect->pNext   = NULL;
     pCritSect->pvKey   = NULL;
     if (!fFinal)
@@ -644,6 +819,8 @@ static int pdmR3CritSectRwDeleteOne(PVM pVM, PUVM pUVM, PPDMCRITSECTRWINT pCritS
     RTLockValidatorRecSharedDestroy(&pCritSect->Core.pValidatorRead);
     RTLockValidatorRecExclDestroy(&pCritSect->Core.pValidatorWrite);
 
+    RTMemFree(pCritSect->pProfR3);
+    pCritSect->pProfR3 = NULL;
     pCritSect->pNext   = NULL;
     pCritSect->pvKey   = NULL;
     if (!fFinal)
@@ -1340,3 +1517,190 @@ static DECLCALLBACK(void) pdmR3CritSectRwInfo(PVM pVM, PCDBGFINFOHLP pHlp, int c
     return pdmR3CritSectInfoCommon(pVM, pHlp, cArgs, papszArgs, true);
 }
 
+
+
+/**
+ * Prints the contention profile of one critical section.
+ */
+static void pdmR3CritSectProfInfoOne(PCDBGFINFOHLP pHlp, const char *pszName, const char *pszKind, PPDMCRITSECTPROF pProf,
+                                     unsigned cVerbosity)
+{
+    /* Take a snapshot as the owner may update it concurrently. */
+    PDMCRITSECTPROF Prof;
+    memcpy(&Prof, pProf, sizeof(Prof));
+    if (!Prof.cEnters && cVerbosity <= 1)
+        return;
+
+    uint64_t const uPct = Prof.cEnters ? Prof.cContended * 10000 / Prof.cEnters : 0;
+    pHlp->pfnPrintf(pHlp, "'%s'%s: enters=%RU64 contended=%RU64 (%u.%02u%%)\n", pszName, pszKind, Prof.cEnters, Prof.cContended,
+                    (unsigned)(uPct / 100), (unsigned)(uPct % 100));
+    pHlp->pfnPrintf(pHlp, "  wait: total=%'RU64 ns avg=%'RU64 ns max=%'RU64 ns\n", Prof.cNsWaitTotal,
+                    Prof.cContended ? Prof.cNsWaitTotal / Prof.cContended : 0, Prof.cNsWaitMax);
+    pHlp->pfnPrintf(pHlp, "  hold: total=%'RU64 ns avg=%'RU64 ns max=%'RU64 ns\n", Prof.cNsHoldTotal,
+                    Prof.cEnters ? Prof.cNsHoldTotal / Prof.cEnters : 0, Prof.cNsHoldMax);
+
+    /*
+     * The histograms, non-zero buckets only.  Bucket N starts at 2^N ns.
+     */
+    static const char * const s_apszHist[2] = { "wait", "hold" };
+    for (unsigned iHist = 0; iHist < RT_ELEMENTS(s_apszHist); iHist++)
+    {
+        uint64_t const * const pacBuckets = iHist == 0 ? Prof.acWait : Prof.acHold;
+        unsigned cPrinted = 0;
+        for (unsigned iBucket = 0; iBucket < PDMCRITSECTPROF_HIST_BUCKETS; iBucket++)
+            if (pacBuckets[iBucket])
+            {
+                if (!cPrinted)
+                    pHlp->pfnPrintf(pHlp, "  %s histogram:", s_apszHist[iHist]);
+                else if (!(cPrinted % 6))
+                    pHlp->pfnPrintf(pHlp, "\n                 ");
+                pHlp->pfnPrintf(pHlp, " >=%RU64ns:%RU64", RT_BIT_64(iBucket), pacBuckets[iBucket]);
+                cPrinted++;
+            }
+        if (cPrinted)
+            pHlp->pfnPrintf(pHlp, "\n");
+    }
+
+    /*
+     * The top call sites, ordered by total hold time (selection sort, tiny array).
+     */
+    uint8_t aidxSorted[PDMCRITSECTPROF_CALLERS];
+    unsigned cCallers = 0;
+    for (unsigned i = 0; i < RT_ELEMENTS(Prof.aCallers); i++)
+        if (Prof.aCallers[i].uAddr)
+            aidxSorted[cCallers++] = (uint8_t)i;
+    for (unsigned i = 0; i + 1 < cCallers; i++)
+        for (unsigned j = i + 1; j < cCallers; j++)
+            if (Prof.aCallers[aidxSorted[j]].cNsHeld > Prof.aCallers[aidxSorted[i]].cNsHeld)
+            {
+                uint8_t const idxTmp = aidxSorted[i];
+                aidxSorted[i] = aidxSorted[j];
+                aidxSorted[j] = idxTmp;
+            }
+    unsigned const cMaxCallers = cVerbosity > 1 ? cCallers : RT_MIN(cCallers, 5);
+    for (unsigned i = 0; i < cMaxCallers; i++)
+    {
+        PDMCRITSECTPROFCALLER const *pCaller = &Prof.aCallers[aidxSorted[i]];
+        pHlp->pfnPrintf(pHlp, "  owner %RHv: enters=%RU64%s held=%'RU64 ns max=%'RU64 ns\n",
+                        (RTHCUINTPTR)pCaller->uAddr, pCaller->cEnters, pCaller->cErr ? "~" : "",
+                        pCaller->cNsHeld, pCaller->cNsHeldMax);
+    }
+}
+
+
+/**
+ * Displays, and optionally resets, the contention profile of the matching
+ * critical sections.
+ */
+static void pdmR3CritSectProfInfoWorker(PUVM pUVM, const char *pszPatterns, PCDBGFINFOHLP pHlp, unsigned cVerbosity,
+                                        bool fReset)
+{
+    size_t const cchPatterns = pszPatterns ? strlen(pszPatterns) : 0;
+    RTCritSectEnter(&pUVM->pdm.s.ListCritSect);
+
+    for (PPDMCRITSECTINT pCritSect = pUVM->pdm.s.pCritSects; pCritSect; pCritSect = pCritSect->pNext)
+    {
+        PPDMCRITSECTPROF const pProf = pCritSect->pProfR3;
+        if (   pProf
+            && (   !pszPatterns
+                || RTStrSimplePatternMultiMatch(pszPatterns, cchPatterns, pCritSect->pszName, RTSTR_MAX, NULL)))
+        {
+            if (!fReset)
+                pdmR3CritSectProfInfoOne(pHlp, pCritSect->pszName, "", pProf, cVerbosity);
+            else
+            {
+                RT_BZERO(pProf, sizeof(*pProf));
+                pProf->idxCallerOwner = UINT32_MAX;
+            }
+        }
+    }
+
+    for (PPDMCRITSECTRWINT pCritSect = pUVM->pdm.s.pRwCritSects; pCritSect; pCritSect = pCritSect->pNext)
+    {
+        PPDMCRITSECTPROF const pProf = pCritSect->pProfR3;
+        if (   pProf
+            && (   !pszPatterns
+                || RTStrSimplePatternMultiMatch(pszPatterns, cchPatterns, pCritSect->pszName, RTSTR_MAX, NULL)))
+        {
+            if (!fReset)
+                pdmR3CritSectProfInfoOne(pHlp, pCritSect->pszName, " (rw, exclusive)", pProf, cVerbosity);
+            else
+            {
+                RT_BZERO(pProf, sizeof(*pProf));
+                pProf->idxCallerOwner = UINT32_MAX;
+            }
+        }
+    }
+
+    RTCritSectLeave(&pUVM->pdm.s.ListCritSect);
+}
+
+
+/**
+ * @callback_method_impl{FNDBGFINFOARGVINT, critsectprof}
+ */
+static DECLCALLBACK(void) pdmR3CritSectProfInfo(PVM pVM, PCDBGFINFOHLP pHlp, int cArgs, char **papszArgs)
+{
+    PUVM pUVM = pVM->pUVM;
+
+    /*
+     * Process arguments.
+     */
+    static const RTGETOPTDEF s_aOptions[] =
+    {
+        {   "--enable",  'e', RTGETOPT_REQ_NOTHING },
+        {   "--reset",   'r', RTGETOPT_REQ_NOTHING },
+        {   "--verbose", 'v', RTGETOPT_REQ_NOTHING },
+    };
+    RTGETOPTSTATE State;
+    int rc = RTGetOptInit(&State, cArgs, papszArgs, s_aOptions, RT_ELEMENTS(s_aOptions), 0, RTGETOPTINIT_FLAGS_NO_STD_OPTS);
+    AssertRC(rc);
+
+    unsigned cVerbosity = 1;
+    unsigned cProcessed = 0;
+    bool     fReset     = false;
+
+    RTGETOPTUNION ValueUnion;
+    while ((rc = RTGetOpt(&State, &ValueUnion)) != 0)
+    {
+        switch (rc)
+        {
+            case 'e':
+                if (!pUVM->pdm.s.fCritSectProfiling)
+                {
+                    pdmR3CritSectProfEnable(pUVM);
+                    pHlp->pfnPrintf(pHlp, "Critical section contention profiling enabled.\n");
+                }
+                break;
+
+            case 'r':
+                fReset = true;
+                break;
+
+            case 'v':
+                cVerbosity++;
+                break;
+
+            case VINF_GETOPT_NOT_OPTION:
+                pdmR3CritSectProfInfoWorker(pUVM, ValueUnion.psz, pHlp, cVerbosity, fReset);
+                cProcessed++;
+                break;
+
+            default:
+                pHlp->pfnGetOptError(pHlp, rc, &ValueUnion, &State);
+                return;
+        }
+    }
+
+    if (!pUVM->pdm.s.fCritSectProfiling)
+    {
+        pHlp->pfnPrintf(pHlp, "Critical section contention profiling is disabled, use --enable or /PDM/CritSectProfiling.\n");
+        return;
+    }
+
+    /*
+     * If we did nothing above, dump (or reset) all.
+     */
+    if (!cProcessed)
+        pdmR3CritSectProfInfoWorker(pUVM, NULL, pHlp, cVerbosity, fReset);
+}
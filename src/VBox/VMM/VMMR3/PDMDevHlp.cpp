@@ -141,6 +141,24 @@ static DECLCALLBACK(uint32_t) pdmR3DevHlp_IoPortGetMappingAddress(PPDMDEVINS pDe
 }
 
 
+/** @interface_method_impl{PDMDEVHLPR3,pfnIoPortSetInShared} */
+static DECLCALLBACK(int) pdmR3DevHlp_IoPortSetInShared(PPDMDEVINS pDevIns, IOMIOPORTHANDLE hIoPorts,
+                                                       PPDMCRITSECTRW pCritSectRw, PFNIOMIOPORTNEWIN pfnInShared)
+{
+    PDMDEV_ASSERT_DEVINS(pDevIns);
+    LogFlow(("pdmR3DevHlp_IoPortSetInShared: caller='%s'/%d: hIoPorts=%#x pCritSectRw=%p pfnInShared=%p\n",
+             pDevIns->pReg->szName, pDevIns->iInstance, hIoPorts, pCritSectRw, pfnInShared));
+    PVM pVM = pDevIns->Internal.s.pVMR3;
+    VM_ASSERT_EMT0_RETURN(pVM, VERR_VM_THREAD_NOT_EMT);
+    VM_ASSERT_STATE_RETURN(pVM, VMSTATE_CREATING, VERR_VM_INVALID_VM_STATE);
+
+    int rc = IOMR3IoPortSetInShared(pVM, pDevIns, hIoPorts, pCritSectRw, pfnInShared);
+
+    LogFlow(("pdmR3DevHlp_IoPortSetInShared: caller='%s'/%d: returns %Rrc\n", pDevIns->pReg->szName, pDevIns->iInstance, rc));
+    return rc;
+}
+
+
 /** @interface_method_impl{PDMDEVHLPR3,pfnIoPortRead} */
 static DECLCALLBACK(VBOXSTRICTRC) pdmR3DevHlp_IoPortRead(PPDMDEVINS pDevIns, RTIOPORT Port, uint32_t *pu32Value, size_t cbValue)
 {
@@ -275,6 +293,24 @@ static DECLCALLBACK(RTGCPHYS) pdmR3DevHlp_MmioGetMappingAddress(PPDMDEVINS pDevI
 }
 
 
+/** @interface_method_impl{PDMDEVHLPR3,pfnMmioSetReadShared} */
+static DECLCALLBACK(int) pdmR3DevHlp_MmioSetReadShared(PPDMDEVINS pDevIns, IOMMMIOHANDLE hRegion,
+                                                       PPDMCRITSECTRW pCritSectRw, PFNIOMMMIONEWREAD pfnReadShared)
+{
+    PDMDEV_ASSERT_DEVINS(pDevIns);
+    LogFlow(("pdmR3DevHlp_MmioSetReadShared: caller='%s'/%d: hRegion=%#x pCritSectRw=%p pfnReadShared=%p\n",
+             pDevIns->pReg->szName, pDevIns->iInstance, hRegion, pCritSectRw, pfnReadShared));
+    PVM pVM = pDevIns->Internal.s.pVMR3;
+    VM_ASSERT_EMT0_RETURN(pVM, VERR_VM_THREAD_NOT_EMT);
+    VM_ASSERT_STATE_RETURN(pVM, VMSTATE_CREATING, VERR_VM_INVALID_VM_STATE);
+
+    int rc = IOMR3MmioSetReadShared(pVM, pDevIns, hRegion, pCritSectRw, pfnReadShared);
+
+    LogFlow(("pdmR3DevHlp_MmioSetReadShared: caller='%s'/%d: returns %Rrc\n", pDevIns->pReg->szName, pDevIns->iInstance, rc));
+    return rc;
+}
+
+
 /** @interface_method_impl{PDMDEVHLPR3,pfnMmio2Create} */
 static DECLCALLBACK(int) pdmR3DevHlp_Mmio2Create(PPDMDEVINS pDevIns, PPDMPCIDEV pPciDev, uint32_t iPciRegion, RTGCPHYS cbRegion,
                                                  uint32_t fFlags, const char *pszDesc, void **ppvMapping, PPGMMMIO2HANDLE phRegion)
@@ -1189,6 +1225,35 @@ static DECLCALLBACK(int) pdmR3DevHlp_PhysChangeMemBalloon(PPDMDEVINS pDevIns, bo
 }
 
 
+/** @interface_method_impl{PDMDEVHLPR3,pfnPhysChangeMemBalloonSync} */
+static DECLCALLBACK(int) pdmR3DevHlp_PhysChangeMemBalloonSync(PPDMDEVINS pDevIns, bool fInflate, unsigned cPages, RTGCPHYS *paPhysPage)
+{
+    PDMDEV_ASSERT_DEVINS(pDevIns);
+    LogFlow(("pdmR3DevHlp_PhysChangeMemBalloonSync: caller='%s'/%d: fInflate=%RTbool cPages=%u paPhysPage=%p\n",
+             pDevIns->pReg->szName, pDevIns->iInstance, fInflate, cPages, paPhysPage));
+
+    int rc = PGMR3PhysChangeMemBalloonSync(pDevIns->Internal.s.pVMR3, fInflate, cPages, paPhysPage);
+
+    Log(("pdmR3DevHlp_PhysChangeMemBalloonSync: caller='%s'/%d: returns %Rrc\n", pDevIns->pReg->szName, pDevIns->iInstance, rc));
+    return rc;
+}
+
+
+/** @interface_method_impl{PDMDEVHLPR3,pfnPhysFreeReportedPages} */
+static DECLCALLBACK(int) pdmR3DevHlp_PhysFreeReportedPages(PPDMDEVINS pDevIns, uint32_t cRanges, PCPGMPHYSRANGE paRanges,
+                                                           uint32_t *pcPagesFreed)
+{
+    PDMDEV_ASSERT_DEVINS(pDevIns);
+    LogFlow(("pdmR3DevHlp_PhysFreeReportedPages: caller='%s'/%d: cRanges=%u paRanges=%p\n",
+             pDevIns->pReg->szName, pDevIns->iInstance, cRanges, paRanges));
+
+    int rc = PGMR3PhysFreeReportedPages(pDevIns->Internal.s.pVMR3, cRanges, paRanges, pcPagesFreed);
+
+    Log(("pdmR3DevHlp_PhysFreeReportedPages: caller='%s'/%d: returns %Rrc\n", pDevIns->pReg->szName, pDevIns->iInstance, rc));
+    return rc;
+}
+
+
 /** @interface_method_impl{PDMDEVHLPR3,pfnCpuGetGuestArch} */
 static DECLCALLBACK(CPUMARCH) pdmR3DevHlp_CpuGetGuestArch(PPDMDEVINS pDevIns)
 {
@@ -3153,7 +3218,8 @@ static DECLCALLBACK(bool)     pdmR3DevHlp_CritSectYield(PPDMDEVINS pDevIns, PPDM
 static DECLCALLBACK(int)      pdmR3DevHlp_CritSectEnter(PPDMDEVINS pDevIns, PPDMCRITSECT pCritSect, int rcBusy)
 {
     PDMDEV_ASSERT_DEVINS(pDevIns);
-    return PDMCritSectEnter(pDevIns->Internal.s.pVMR3, pCritSect, rcBusy);
+    /* Pass on the device's address so contention profiling doesn't attribute everything to us. */
+    return PDMCritSectEnterDebug(pDevIns->Internal.s.pVMR3, pCritSect, rcBusy, (uintptr_t)ASMReturnAddress(), NULL, 0, NULL);
 }
 
 
@@ -3169,7 +3235,7 @@ static DECLCALLBACK(int)      pdmR3DevHlp_CritSectEnterDebug(PPDMDEVINS pDevIns,
 static DECLCALLBACK(int)      pdmR3DevHlp_CritSectTryEnter(PPDMDEVINS pDevIns, PPDMCRITSECT pCritSect)
 {
     PDMDEV_ASSERT_DEVINS(pDevIns);
-    return PDMCritSectTryEnter(pDevIns->Internal.s.pVMR3, pCritSect);
+    return PDMCritSectTryEnterDebug(pDevIns->Internal.s.pVMR3, pCritSect, (uintptr_t)ASMReturnAddress(), NULL, 0, NULL);
 }
 
 
@@ -4872,6 +4938,7 @@ const PDMDEVHLPR3 g_pdmR3DevHlpTrusted =
     pdmR3DevHlp_IoPortMap,
     pdmR3DevHlp_IoPortUnmap,
     pdmR3DevHlp_IoPortGetMappingAddress,
+    pdmR3DevHlp_IoPortSetInShared,
     pdmR3DevHlp_IoPortRead,
     pdmR3DevHlp_IoPortWrite,
     pdmR3DevHlp_MmioCreateEx,
@@ -4879,6 +4946,7 @@ const PDMDEVHLPR3 g_pdmR3DevHlpTrusted =
     pdmR3DevHlp_MmioUnmap,
     pdmR3DevHlp_MmioReduce,
     pdmR3DevHlp_MmioGetMappingAddress,
+    pdmR3DevHlp_MmioSetReadShared,
     pdmR3DevHlp_Mmio2Create,
     pdmR3DevHlp_Mmio2Destroy,
     pdmR3DevHlp_Mmio2Map,
@@ -5071,6 +5139,8 @@ const PDMDEVHLPR3 g_pdmR3DevHlpTrusted =
     pdmR3DevHlp_PhysGCPtr2GCPhys,
     pdmR3DevHlp_PhysIsGCPhysNormal,
     pdmR3DevHlp_PhysChangeMemBalloon,
+    pdmR3DevHlp_PhysChangeMemBalloonSync,
+    pdmR3DevHlp_PhysFreeReportedPages,
     pdmR3DevHlp_MMHeapAlloc,
     pdmR3DevHlp_MMHeapAllocZ,
     pdmR3DevHlp_MMHeapAPrintfV,
@@ -5271,6 +5341,7 @@ const PDMDEVHLPR3 g_pdmR3DevHlpTracing =
     pdmR3DevHlpTracing_IoPortMap,
     pdmR3DevHlpTracing_IoPortUnmap,
     pdmR3DevHlp_IoPortGetMappingAddress,
+    pdmR3DevHlpTracing_IoPortSetInShared,
     pdmR3DevHlp_IoPortRead,  /** @todo Needs tracing variants for ARM now. */
     pdmR3DevHlp_IoPortWrite, /** @todo Needs tracing variants for ARM now. */
     pdmR3DevHlpTracing_MmioCreateEx,
@@ -5278,6 +5349,7 @@ const PDMDEVHLPR3 g_pdmR3DevHlpTracing =
     pdmR3DevHlpTracing_MmioUnmap,
     pdmR3DevHlp_MmioReduce,
     pdmR3DevHlp_MmioGetMappingAddress,
+    pdmR3DevHlpTracing_MmioSetReadShared,
     pdmR3DevHlp_Mmio2Create,
     pdmR3DevHlp_Mmio2Destroy,
     pdmR3DevHlp_Mmio2Map,
@@ -5470,6 +5542,8 @@ const PDMDEVHLPR3 g_pdmR3DevHlpTracing =
     pdmR3DevHlp_PhysGCPtr2GCPhys,
     pdmR3DevHlp_PhysIsGCPhysNormal,
     pdmR3DevHlp_PhysChangeMemBalloon,
+    pdmR3DevHlp_PhysChangeMemBalloonSync,
+    pdmR3DevHlp_PhysFreeReportedPages,
     pdmR3DevHlp_MMHeapAlloc,
     pdmR3DevHlp_MMHeapAllocZ,
     pdmR3DevHlp_MMHeapAPrintfV,
@@ -5990,6 +6064,7 @@ const PDMDEVHLPR3 g_pdmR3DevHlpUnTrusted =
     pdmR3DevHlp_IoPortMap,
     pdmR3DevHlp_IoPortUnmap,
     pdmR3DevHlp_IoPortGetMappingAddress,
+    pdmR3DevHlp_IoPortSetInShared,
     pdmR3DevHlp_IoPortRead,
     pdmR3DevHlp_IoPortWrite,
     pdmR3DevHlp_MmioCreateEx,
@@ -5997,6 +6072,7 @@ const PDMDEVHLPR3 g_pdmR3DevHlpUnTrusted =
     pdmR3DevHlp_MmioUnmap,
     pdmR3DevHlp_MmioReduce,
     pdmR3DevHlp_MmioGetMappingAddress,
+    pdmR3DevHlp_MmioSetReadShared,
     pdmR3DevHlp_Mmio2Create,
     pdmR3DevHlp_Mmio2Destroy,
     pdmR3DevHlp_Mmio2Map,
@@ -6189,6 +6265,8 @@ const PDMDEVHLPR3 g_pdmR3DevHlpUnTrusted =
     pdmR3DevHlp_PhysGCPtr2GCPhys,
     pdmR3DevHlp_PhysIsGCPhysNormal,
     pdmR3DevHlp_PhysChangeMemBalloon,
+    pdmR3DevHlp_PhysChangeMemBalloonSync,
+    pdmR3DevHlp_PhysFreeReportedPages,
     pdmR3DevHlp_MMHeapAlloc,
     pdmR3DevHlp_MMHeapAllocZ,
     pdmR3DevHlp_MMHeapAPrintfV,
@@ -250,6 +250,23 @@ DECL_HIDDEN_CALLBACK(int) pdmR3DevHlpTracing_IoPortUnmap(PPDMDEVINS pDevIns, IOM
 }
 
 
+/**
+ * @interface_method_impl{PDMDEVHLPR3,pfnIoPortSetInShared}
+ *
+ * The shared handler is not registered when tracing, so that all reads take
+ * the regular (traced) path.
+ */
+DECL_HIDDEN_CALLBACK(int) pdmR3DevHlpTracing_IoPortSetInShared(PPDMDEVINS pDevIns, IOMIOPORTHANDLE hIoPorts,
+                                                               PPDMCRITSECTRW pCritSectRw, PFNIOMIOPORTNEWIN pfnInShared)
+{
+    PDMDEV_ASSERT_DEVINS(pDevIns);
+    LogFlow(("pdmR3DevHlp_IoPortSetInShared: caller='%s'/%d: hIoPorts=%#x pCritSectRw=%p pfnInShared=%p - ignored\n",
+             pDevIns->pReg->szName, pDevIns->iInstance, hIoPorts, pCritSectRw, pfnInShared));
+    RT_NOREF(pDevIns, hIoPorts, pCritSectRw, pfnInShared);
+    return VINF_SUCCESS;
+}
+
+
 /** @interface_method_impl{PDMDEVHLPR3,pfnMmioCreateEx} */
 DECL_HIDDEN_CALLBACK(int)
 pdmR3DevHlpTracing_MmioCreateEx(PPDMDEVINS pDevIns, RTGCPHYS cbRegion,
@@ -336,6 +353,22 @@ DECL_HIDDEN_CALLBACK(int) pdmR3DevHlpTracing_MmioUnmap(PPDMDEVINS pDevIns, IOMMM
 }
 
 
+/**
+ * @interface_method_impl{PDMDEVHLPR3,pfnMmioSetReadShared}
+ *
+ * Ignored when tracing, see pdmR3DevHlpTracing_IoPortSetInShared.
+ */
+DECL_HIDDEN_CALLBACK(int) pdmR3DevHlpTracing_MmioSetReadShared(PPDMDEVINS pDevIns, IOMMMIOHANDLE hRegion,
+                                                               PPDMCRITSECTRW pCritSectRw, PFNIOMMMIONEWREAD pfnReadShared)
+{
+    PDMDEV_ASSERT_DEVINS(pDevIns);
+    LogFlow(("pdmR3DevHlp_MmioSetReadShared: caller='%s'/%d: hRegion=%#x pCritSectRw=%p pfnReadShared=%p - ignored\n",
+             pDevIns->pReg->szName, pDevIns->iInstance, hRegion, pCritSectRw, pfnReadShared));
+    RT_NOREF(pDevIns, hRegion, pCritSectRw, pfnReadShared);
+    return VINF_SUCCESS;
+}
+
+
 /** @interface_method_impl{PDMDEVHLPR3,pfnPhysRead} */
 DECL_HIDDEN_CALLBACK(int)
 pdmR3DevHlpTracing_PhysRead(PPDMDEVINS pDevIns, RTGCPHYS GCPhys, void *pvBuf, size_t cbRead, uint32_t fFlags)
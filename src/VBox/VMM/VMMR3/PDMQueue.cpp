@@ -42,6 +42,7 @@
 #include <iprt/assert.h>
 #include <iprt/mem.h>
 #include <iprt/thread.h>
+#include <iprt/time.h>
 
 
 /*********************************************************************************************************************************
@@ -144,14 +145,17 @@ static int pdmR3QueueCreateLocked(PVM pVM, size_t cbItem, uint32_t cItems, uint3
     else
     {
         /* Do it here using the paged heap: */
-        uint32_t const cbBitmap = RT_ALIGN_32(RT_ALIGN_32(cItems, 64) / 8, 64); /* keep bitmap in it's own cacheline  */
+        uint32_t cbBitmap;
+        uint32_t cbRing;
+        pdmQueueCalcLayout(cItems, &cbBitmap, &cbRing);
         uint32_t const cbQueue  = RT_OFFSETOF(PDMQUEUE, bmAlloc)
                                 + cbBitmap
+                                + cbRing
                                 + (uint32_t)cbItem * cItems;
         pQueue = (PPDMQUEUE)RTMemPageAllocZ(cbQueue);
         if (!pQueue)
             return VERR_NO_PAGE_MEMORY;
-        pdmQueueInit(pQueue, cbBitmap, (uint32_t)cbItem, cItems, pszName, enmType, (RTR3PTR)uCallback, pvOwner);
+        pdmQueueInit(pQueue, cbBitmap, cbRing, (uint32_t)cbItem, cItems, pszName, enmType, (RTR3PTR)uCallback, pvOwner);
 
         uint32_t iQueue = pVM->pdm.s.cRing3Queues;
         if (iQueue >= pVM->pdm.s.cRing3QueuesAlloc)
@@ -222,7 +226,19 @@ static int pdmR3QueueCreateLocked(PVM pVM, size_t cbItem, uint32_t cItems, uint3
                     "Calls to pdmR3QueueFlush.",        "/PDM/Queue/%s/Flush",          pQueue->szName);
     STAMR3RegisterF(pVM, &pQueue->StatFlushLeftovers,   STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,
                     "Left over items after flush.",     "/PDM/Queue/%s/FlushLeftovers", pQueue->szName);
+    STAMR3RegisterF(pVM, &pQueue->StatKicks,            STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,
+                    "Consumer wakeups by inserts.",     "/PDM/Queue/%s/Kicks",          pQueue->szName);
+    STAMR3RegisterF(pVM, &pQueue->StatModeSwitches,     STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,
+                    "Poll/kick mode switches.",         "/PDM/Queue/%s/ModeSwitches",   pQueue->szName);
+    STAMR3RegisterF(pVM, (void *)&pQueue->fPollMode,    STAMTYPE_BOOL,    STAMVISIBILITY_ALWAYS, STAMUNIT_NONE,
+                    "Set when batching until the next tick.", "/PDM/Queue/%s/PollMode", pQueue->szName);
 #ifdef VBOX_WITH_STATISTICS
+    static const char * const s_apszLatency[PDMQUEUE_LATENCY_BUCKETS] =
+    { "0us", "1us", "10us", "100us", "1ms", "10ms", "100ms" };
+    for (uintptr_t i = 0; i < RT_ELEMENTS(pQueue->aStatLatency); i++)
+        STAMR3RegisterF(pVM, &pQueue->aStatLatency[i],  STAMTYPE_COUNTER, STAMVISIBILITY_USED, STAMUNIT_OCCURENCES,
+                        "Insert to flush latency, lower bound of the decade.", "/PDM/Queue/%s/Latency/%s",
+                        pQueue->szName, s_apszLatency[i]);
     STAMR3RegisterF(pVM, &pQueue->StatFlushPrf,         STAMTYPE_PROFILE, STAMVISIBILITY_ALWAYS, STAMUNIT_TICKS_PER_CALL,
                     "Profiling pdmR3QueueFlush.",       "/PDM/Queue/%s/FlushPrf",       pQueue->szName);
     STAMR3RegisterF(pVM, (void *)&pQueue->cStatPending, STAMTYPE_U32,     STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,
@@ -623,6 +639,32 @@ DECLINLINE(void) pdmR3QueueFreeItem(PPDMQUEUE pQueue, uint8_t *pbItems, uint32_t
 
 
 
+/**
+ * Hands one item to the queue consumer.
+ *
+ * @returns The consumer return value, false means stop.
+ * @param   pVM     The cross context VM structure.
+ * @param   pQueue  The queue.
+ * @param   pItem   The item.
+ */
+DECLINLINE(bool) pdmR3QueueConsumeItem(PVM pVM, PPDMQUEUE pQueue, PPDMQUEUEITEMCORE pItem)
+{
+    switch (pQueue->enmType)
+    {
+        case PDMQUEUETYPE_DEV:
+            return pQueue->u.Dev.pfnCallback(pQueue->u.Dev.pDevIns, pItem);
+        case PDMQUEUETYPE_DRV:
+            return pQueue->u.Drv.pfnCallback(pQueue->u.Drv.pDrvIns, pItem);
+        case PDMQUEUETYPE_INTERNAL:
+            return pQueue->u.Int.pfnCallback(pVM, pItem);
+        case PDMQUEUETYPE_EXTERNAL:
+            return pQueue->u.Ext.pfnCallback(pQueue->u.Ext.pvUser, pItem);
+        default:
+            AssertMsgFailedReturn(("Invalid queue type %d\n", pQueue->enmType), false);
+    }
+}
+
+
 /**
  * Process pending items in one queue.
  *
@@ -634,144 +676,64 @@ static int pdmR3QueueFlush(PVM pVM, PPDMQUEUE pQueue)
 {
     STAM_PROFILE_START(&pQueue->StatFlushPrf,p);
 
-    uint32_t const  cbItem  = pQueue->cbItem;
-    uint32_t const  cItems  = pQueue->cItems;
-    uint8_t * const pbItems = (uint8_t *)pQueue + pQueue->offItems;
+    uint32_t const            cbItem   = pQueue->cbItem;
+    uint32_t const            cItems   = pQueue->cItems;
+    uint32_t const            fMask    = pQueue->fRingMask;
+    uint8_t * const           pbItems  = (uint8_t *)pQueue + pQueue->offItems;
+    uint32_t volatile * const pauRing  = (uint32_t volatile *)((uint8_t *)pQueue + pQueue->offRing);
 
     /*
-     * Get the list and reverse it into a pointer list (inserted in LIFO order to avoid locking).
+     * Re-arm the kick before looking at the ring, so that any producer
+     * publishing an entry after we've stopped will wake us up again.
      */
-    uint32_t          cPending = 0;
-    PPDMQUEUEITEMCORE pHead    = NULL;
-    {
-        uint32_t iCur = ASMAtomicXchgU32(&pQueue->iPending, UINT32_MAX);
-        do
-        {
-            AssertMsgReturn(iCur < cItems, ("%#x vs %#x\n", iCur, cItems), pQueue->rcOkay = VERR_INTERNAL_ERROR_5);
-            AssertReturn(ASMBitTest(pQueue->bmAlloc, iCur) == false, pQueue->rcOkay = VERR_INTERNAL_ERROR_3);
-            PPDMQUEUEITEMCORE pCur = (PPDMQUEUEITEMCORE)&pbItems[iCur * cbItem];
-
-            iCur = pCur->iNext;
-            ASMCompilerBarrier(); /* paranoia */
-            pCur->pNext = pHead;
-            pHead = pCur;
-            cPending++;
-        } while (iCur != UINT32_MAX);
-    }
-    RT_NOREF(cPending);
+    ASMAtomicWriteBool(&pQueue->fKickPending, false);
 
     /*
-     * Feed the items to the consumer function.
+     * Feed the items to the consumer function in ring order.  We're the only
+     * consumer, so the consumer index can be updated without interlocking.
+     * An entry that has been claimed but not yet published ends the batch.
      */
-    Log2(("pdmR3QueueFlush: pQueue=%p enmType=%d pHead=%p cItems=%u\n", pQueue, pQueue->enmType, pHead, cPending));
-    switch (pQueue->enmType)
+#ifdef VBOX_WITH_STATISTICS
+    uint64_t const  nsNow    = RTTimeNanoTS();
+#endif
+    uint32_t        idxRing  = pQueue->idxRingConsumer;
+    uint32_t        cFlushed = 0;
+    for (;;)
     {
-        case PDMQUEUETYPE_DEV:
-            while (pHead)
-            {
-                if (!pQueue->u.Dev.pfnCallback(pQueue->u.Dev.pDevIns, pHead))
-                    break;
-                PPDMQUEUEITEMCORE pFree = pHead;
-                pHead = pHead->pNext;
-                ASMCompilerBarrier(); /* paranoia */
-                pdmR3QueueFreeItem(pQueue, pbItems, cbItem, pFree);
-            }
+        uint32_t volatile * const puEntry = &pauRing[idxRing & fMask];
+        uint32_t const            uEntry  = ASMAtomicReadU32(puEntry);
+        if (!uEntry)
             break;
+        uint32_t const iItem = uEntry - 1;
+        AssertMsgReturn(iItem < cItems, ("%#x vs %#x\n", iItem, cItems), pQueue->rcOkay = VERR_INTERNAL_ERROR_5);
+        AssertReturn(ASMBitTest(pQueue->bmAlloc, iItem) == false, pQueue->rcOkay = VERR_INTERNAL_ERROR_3);
+        PPDMQUEUEITEMCORE pItem = (PPDMQUEUEITEMCORE)&pbItems[iItem * cbItem];
 
-        case PDMQUEUETYPE_DRV:
-            while (pHead)
-            {
-                if (!pQueue->u.Drv.pfnCallback(pQueue->u.Drv.pDrvIns, pHead))
-                    break;
-                PPDMQUEUEITEMCORE pFree = pHead;
-                pHead = pHead->pNext;
-                ASMCompilerBarrier(); /* paranoia */
-                pdmR3QueueFreeItem(pQueue, pbItems, cbItem, pFree);
-            }
-            break;
-
-        case PDMQUEUETYPE_INTERNAL:
-            while (pHead)
-            {
-                if (!pQueue->u.Int.pfnCallback(pVM, pHead))
-                    break;
-                PPDMQUEUEITEMCORE pFree = pHead;
-                pHead = pHead->pNext;
-                ASMCompilerBarrier(); /* paranoia */
-                pdmR3QueueFreeItem(pQueue, pbItems, cbItem, pFree);
-            }
-            break;
-
-        case PDMQUEUETYPE_EXTERNAL:
-            while (pHead)
-            {
-                if (!pQueue->u.Ext.pfnCallback(pQueue->u.Ext.pvUser, pHead))
-                    break;
-                PPDMQUEUEITEMCORE pFree = pHead;
-                pHead = pHead->pNext;
-                ASMCompilerBarrier(); /* paranoia */
-                pdmR3QueueFreeItem(pQueue, pbItems, cbItem, pFree);
-            }
-            break;
-
-        default:
-            AssertMsgFailed(("Invalid queue type %d\n", pQueue->enmType));
-            break;
-    }
-
-    /*
-     * Success?
-     */
-    if (!pHead)
-    { /* likely */ }
-    else
-    {
-        /*
-         * Reverse the list and turn it back into index chain.
-         */
-        uint32_t iPendingHead = UINT32_MAX;
-        do
+#ifdef VBOX_WITH_STATISTICS
+        /* Insert to flush latency in decades starting at 1us (PDMQueueInsert stashed the timestamp in the core). */
+        uint64_t  cUsLatency = nsNow > pItem->u64View ? (nsNow - pItem->u64View) / RT_NS_1US : 0;
+        uintptr_t iBucket    = 0;
+        while (cUsLatency > 0 && iBucket < PDMQUEUE_LATENCY_BUCKETS - 1)
         {
-            PPDMQUEUEITEMCORE pInsert = pHead;
-            pHead = pHead->pNext;
-            ASMCompilerBarrier(); /* paranoia */
-            pInsert->iNext = iPendingHead;
-            iPendingHead = ((uintptr_t)pInsert - (uintptr_t)pbItems) / cbItem;
-        } while (pHead);
+            cUsLatency /= 10;
+            iBucket++;
+        }
+        STAM_COUNTER_INC(&pQueue->aStatLatency[iBucket]);
+#endif
 
-        /*
-         * Insert the list at the tail of the pending list.  If someone races
-         * us there, we have to join the new LIFO with the old.
-         */
-        for (;;)
+        if (!pdmR3QueueConsumeItem(pVM, pQueue, pItem))
         {
-            if (ASMAtomicCmpXchgU32(&pQueue->iPending, iPendingHead, UINT32_MAX))
-                break;
-
-            uint32_t const iNewPending = ASMAtomicXchgU32(&pQueue->iPending, UINT32_MAX);
-            if (iNewPending != UINT32_MAX)
-            {
-                /* Find the last entry and chain iPendingHead onto it. */
-                uint32_t iCur = iNewPending;
-                for (;;)
-                {
-                    AssertReturn(iCur < cItems, pQueue->rcOkay = VERR_INTERNAL_ERROR_2);
-                    AssertReturn(ASMBitTest(pQueue->bmAlloc, iCur) == false, pQueue->rcOkay = VERR_INTERNAL_ERROR_3);
-                    PPDMQUEUEITEMCORE pCur = (PPDMQUEUEITEMCORE)&pbItems[iCur * cbItem];
-                    iCur = pCur->iNext;
-                    if (iCur == UINT32_MAX)
-                    {
-                        pCur->iNext = iPendingHead;
-                        break;
-                    }
-                }
-
-                iPendingHead = iNewPending;
-            }
+            STAM_REL_COUNTER_INC(&pQueue->StatFlushLeftovers);
+            break;
         }
 
-        STAM_REL_COUNTER_INC(&pQueue->StatFlushLeftovers);
+        ASMAtomicWriteU32(puEntry, 0);
+        ASMAtomicWriteU32(&pQueue->idxRingConsumer, ++idxRing);
+        pdmR3QueueFreeItem(pQueue, pbItems, cbItem, pItem);
+        cFlushed++;
     }
+    Log2(("pdmR3QueueFlush: pQueue=%p enmType=%d cFlushed=%u\n", pQueue, pQueue->enmType, cFlushed));
+    RT_NOREF(cFlushed);
 
     STAM_PROFILE_STOP(&pQueue->StatFlushPrf,p);
     return VINF_SUCCESS;
@@ -811,9 +773,10 @@ VMMR3DECL(void) PDMR3QueueFlushAll(PVM pVM)
         {
             PPDMQUEUE pQueue = pVM->pdm.s.apRing0Queues[i];
             if (   pQueue
-                && pQueue->iPending != UINT32_MAX
-                && pQueue->hTimer == NIL_TMTIMERHANDLE
-                && pQueue->rcOkay == VINF_SUCCESS)
+                && (   pQueue->hTimer == NIL_TMTIMERHANDLE
+                    || ASMAtomicUoReadBool(&pQueue->fKickPending))
+                && pQueue->rcOkay == VINF_SUCCESS
+                && pdmQueueIsPending(pQueue))
                 pdmR3QueueFlush(pVM, pQueue);
         }
 
@@ -824,9 +787,10 @@ VMMR3DECL(void) PDMR3QueueFlushAll(PVM pVM)
         {
             PPDMQUEUE pQueue = pVM->pdm.s.papRing3Queues[i];
             if (   pQueue
-                && pQueue->iPending != UINT32_MAX
-                && pQueue->hTimer == NIL_TMTIMERHANDLE
-                && pQueue->rcOkay == VINF_SUCCESS)
+                && (   pQueue->hTimer == NIL_TMTIMERHANDLE
+                    || ASMAtomicUoReadBool(&pQueue->fKickPending))
+                && pQueue->rcOkay == VINF_SUCCESS
+                && pdmQueueIsPending(pQueue))
                 pdmR3QueueFlush(pVM, pQueue);
         }
 
@@ -850,8 +814,40 @@ static DECLCALLBACK(void) pdmR3QueueTimer(PVM pVM, TMTIMERHANDLE hTimer, void *p
     PPDMQUEUE pQueue = (PPDMQUEUE)pvUser;
     Assert(hTimer == pQueue->hTimer);
 
-    if (pQueue->iPending != UINT32_MAX)
-        pdmR3QueueFlush(pVM, pQueue);
+    /*
+     * Switch between batching inserts until the next tick (poll mode) and
+     * having each burst kick the EMT, based on the insert rate.
+     */
+    uint32_t const cInserts = ASMAtomicXchgU32(&pQueue->cTimerInserts, 0);
+    if (!pQueue->fPollMode)
+    {
+        if (cInserts >= PDMQUEUE_POLL_MODE_ENTER)
+        {
+            ASMAtomicWriteBool(&pQueue->fPollMode, true);
+            STAM_REL_COUNTER_INC(&pQueue->StatModeSwitches);
+        }
+    }
+    else if (cInserts <= PDMQUEUE_POLL_MODE_LEAVE)
+    {
+        ASMAtomicWriteBool(&pQueue->fPollMode, false);
+        STAM_REL_COUNTER_INC(&pQueue->StatModeSwitches);
+    }
+
+    /*
+     * The queue may also be flushed by PDMR3QueueFlushAll when a producer
+     * kicked it, so we have to serialize with that.  If it's busy, we leave
+     * it to the next tick.
+     */
+    if (!ASMAtomicBitTestAndSet(&pVM->pdm.s.fQueueFlushing, PDM_QUEUE_FLUSH_FLAG_ACTIVE_BIT))
+    {
+        if (pdmQueueIsPending(pQueue))
+            pdmR3QueueFlush(pVM, pQueue);
+        ASMAtomicBitClear(&pVM->pdm.s.fQueueFlushing, PDM_QUEUE_FLUSH_FLAG_ACTIVE_BIT);
+
+        /* Don't lose any flush requests made while we were holding the active bit. */
+        if (ASMBitTest(&pVM->pdm.s.fQueueFlushing, PDM_QUEUE_FLUSH_FLAG_PENDING_BIT))
+            VM_FF_SET(pVM, VM_FF_PDM_QUEUES);
+    }
 
     int rc = TMTimerSetMillies(pVM, hTimer, pQueue->cMilliesInterval);
     AssertRC(rc);
@@ -922,6 +922,61 @@ VMMR3DECL(int) PGMR3Init(PVM pVM)
     rc = CFGMR3QueryBoolDef(pCfgPGM, "ZeroRamPagesOnReset", &pVM->pgm.s.fZeroRamPagesOnReset, true);
     AssertLogRelRCReturn(rc, rc);
 
+    /** @cfgm{/PGM/LargePageCoalescing, boolean, false}
+     * Whether to periodically look for 2 MB guest RAM ranges backed by 4 KB
+     * pages and coalesce them into large pages.  Only effective when large
+     * pages are in use (i.e. HM with nested paging). */
+    rc = CFGMR3QueryBoolDef(pCfgPGM, "LargePageCoalescing", &pVM->pgm.s.fLargePageCoalescing, false);
+    AssertLogRelRCReturn(rc, rc);
+
+    /** @cfgm{/PGM/LargePageCoalesceIntervalMs, uint32_t, 1000, 10, 3600000, ms}
+     * The interval between large page coalescing passes. */
+    rc = CFGMR3QueryU32Def(pCfgPGM, "LargePageCoalesceIntervalMs", &pVM->pgm.s.cMsLargePageCoalesceInterval, 1000);
+    AssertLogRelRCReturn(rc, rc);
+    AssertLogRelMsgReturn(   pVM->pgm.s.cMsLargePageCoalesceInterval >= 10
+                          && pVM->pgm.s.cMsLargePageCoalesceInterval <= RT_MS_1HOUR,
+                          ("LargePageCoalesceIntervalMs=%u\n", pVM->pgm.s.cMsLargePageCoalesceInterval),
+                          VERR_OUT_OF_RANGE);
+
+    /** @cfgm{/PGM/LargePageCoalesceMaxRanges, uint32_t, 8, 1, 64}
+     * The max number of 2 MB ranges to coalesce in one pass.  Each range costs
+     * a large page allocation and a 2 MB copy with all EMTs halted, so keep
+     * this small. */
+    rc = CFGMR3QueryU32Def(pCfgPGM, "LargePageCoalesceMaxRanges", &pVM->pgm.s.cLargePageCoalesceMaxRanges, 8);
+    AssertLogRelRCReturn(rc, rc);
+    AssertLogRelMsgReturn(   pVM->pgm.s.cLargePageCoalesceMaxRanges >= 1
+                          && pVM->pgm.s.cLargePageCoalesceMaxRanges <= 64,
+                          ("LargePageCoalesceMaxRanges=%u\n", pVM->pgm.s.cLargePageCoalesceMaxRanges),
+                          VERR_OUT_OF_RANGE);
+    pVM->pgm.s.hLargePageCoalesceTimer = NIL_TMTIMERHANDLE;
+
+    /** @cfgm{/PGM/PageDedup, boolean, false}
+     * Whether to run the host-side duplicate page scanner, which merges guest
+     * RAM pages with identical content into shared copy-on-write pages without
+     * requiring guest additions.  Requires /PageFusionAllowed. */
+    rc = CFGMR3QueryBoolDef(pCfgPGM, "PageDedup", &pVM->pgm.s.fPageDedup, false);
+    AssertLogRelRCReturn(rc, rc);
+
+    /** @cfgm{/PGM/PageDedupIntervalMs, uint32_t, 1000, 100, 3600000, ms}
+     * The interval between duplicate page scanner passes. */
+    rc = CFGMR3QueryU32Def(pCfgPGM, "PageDedupIntervalMs", &pVM->pgm.s.cMsPageDedupInterval, 1000);
+    AssertLogRelRCReturn(rc, rc);
+    AssertLogRelMsgReturn(   pVM->pgm.s.cMsPageDedupInterval >= 100
+                          && pVM->pgm.s.cMsPageDedupInterval <= RT_MS_1HOUR,
+                          ("PageDedupIntervalMs=%u\n", pVM->pgm.s.cMsPageDedupInterval),
+                          VERR_OUT_OF_RANGE);
+
+    /** @cfgm{/PGM/PageDedupCpuPct, uint32_t, 1, 1, 50, %}
+     * How much of each interval the duplicate page scanner may spend with the
+     * EMTs halted.  The number of pages scanned per pass is adjusted to this. */
+    rc = CFGMR3QueryU32Def(pCfgPGM, "PageDedupCpuPct", &pVM->pgm.s.uPageDedupCpuPct, 1);
+    AssertLogRelRCReturn(rc, rc);
+    AssertLogRelMsgReturn(   pVM->pgm.s.uPageDedupCpuPct >= 1
+                          && pVM->pgm.s.uPageDedupCpuPct <= 50,
+                          ("PageDedupCpuPct=%u\n", pVM->pgm.s.uPageDedupCpuPct),
+                          VERR_OUT_OF_RANGE);
+    pVM->pgm.s.hPageDedupTimer = NIL_TMTIMERHANDLE;
+
     /*
      * Register callbacks, string formatters and the saved state data unit.
      */
@@ -1235,6 +1290,7 @@ static int pgmR3InitStats(PVM pVM)
     STAM_REL_REG(pVM, &pPGM->cHandyPages,                        STAMTYPE_U32,     "/PGM/Page/cHandyPages",              STAMUNIT_COUNT,     "The number of handy pages (not included in cAllPages).");
     STAM_REL_REG(pVM, &pPGM->cLargePages,                        STAMTYPE_U32,     "/PGM/Page/cLargePages",              STAMUNIT_COUNT,     "The number of large pages allocated (includes disabled).");
     STAM_REL_REG(pVM, &pPGM->cLargePagesDisabled,                STAMTYPE_U32,     "/PGM/Page/cLargePagesDisabled",      STAMUNIT_COUNT,     "The number of disabled large pages.");
+    STAM_REL_REG(pVM, &pPGM->uLargePageRatioPct,                 STAMTYPE_U32,     "/PGM/Page/LargePageRatio",           STAMUNIT_PCT,       "Percentage of private pages backed by enabled large pages (updated by coalescing).");
     STAM_REL_REG(pVM, &pPGM->ChunkR3Map.c,                       STAMTYPE_U32,     "/PGM/ChunkR3Map/c",                  STAMUNIT_COUNT,     "Number of mapped chunks.");
     STAM_REL_REG(pVM, &pPGM->ChunkR3Map.cMax,                    STAMTYPE_U32,     "/PGM/ChunkR3Map/cMax",               STAMUNIT_COUNT,     "Maximum number of mapped chunks.");
     STAM_REL_REG(pVM, &pPGM->cMappedChunks,                      STAMTYPE_U32,     "/PGM/ChunkR3Map/Mapped",             STAMUNIT_COUNT,     "Number of times we mapped a chunk.");
@@ -1245,6 +1301,13 @@ static int pgmR3InitStats(PVM pVM)
     STAM_REL_REG(pVM, &pPGM->StatLargePageRecheck,               STAMTYPE_COUNTER, "/PGM/LargePage/Recheck",             STAMUNIT_OCCURENCES, "The number of times we've rechecked a disabled large page.");
 
     STAM_REL_REG(pVM, &pPGM->StatShModCheck,                     STAMTYPE_PROFILE, "/PGM/ShMod/Check",                   STAMUNIT_TICKS_PER_CALL, "Profiles the shared module checking.");
+    STAM_REL_REG(pVM, &pPGM->StatPageDedupScanned,               STAMTYPE_COUNTER, "/PGM/PageDedup/Scanned",             STAMUNIT_PAGES,     "Pages hashed by the duplicate page scanner.");
+    STAM_REL_REG(pVM, &pPGM->StatPageDedupIdle,                  STAMTYPE_COUNTER, "/PGM/PageDedup/Idle",                STAMUNIT_PAGES,     "Pages found unchanged since the previous scan and submitted for merging.");
+    STAM_REL_REG(pVM, &pPGM->StatPageDedupMerged,                STAMTYPE_COUNTER, "/PGM/PageDedup/Merged",              STAMUNIT_PAGES,     "Pages merged with an identical shared page (memory saved).");
+    STAM_REL_REG(pVM, &pPGM->StatPageDedupConverted,             STAMTYPE_COUNTER, "/PGM/PageDedup/Converted",           STAMUNIT_PAGES,     "Pages converted into shared pages for others to merge with.");
+    STAM_REL_REG(pVM, &pPGM->StatPageDedupBroken,                STAMTYPE_COUNTER, "/PGM/PageDedup/BrokenShares",        STAMUNIT_PAGES,     "Shared pages replaced by a private copy on write (all kinds of sharing).");
+    STAM_REL_REG(pVM, &pPGM->cPageDedupPagesPerPass,             STAMTYPE_U32,     "/PGM/PageDedup/PagesPerPass",        STAMUNIT_PAGES,     "The current number of pages scanned per pass.");
+    STAM_REL_REG(pVM, &pPGM->StatPageDedup,                      STAMTYPE_PROFILE, "/PGM/PageDedup/Pass",                STAMUNIT_TICKS_PER_CALL, "Profiles the duplicate page scanner passes.");
     STAM_REL_REG(pVM, &pPGM->StatMmio2QueryAndResetDirtyBitmap,  STAMTYPE_PROFILE, "/PGM/Mmio2QueryAndResetDirtyBitmap", STAMUNIT_TICKS_PER_CALL, "Profiles calls to PGMR3PhysMmio2QueryAndResetDirtyBitmap (sans locking).");
 
     /* Live save */
@@ -1303,6 +1366,9 @@ static int pgmR3InitStats(PVM pVM)
     PGM_REG_COUNTER(&pPGM->StatLargePageOverflow,               "/PGM/LargePage/Overflow",            "The number of times allocating a large page took too long.");
     PGM_REG_COUNTER(&pPGM->StatLargePageTlbFlush,               "/PGM/LargePage/TlbFlush",            "The number of times a full VCPU TLB flush was required after a large allocation.");
     PGM_REG_COUNTER(&pPGM->StatLargePageZeroEvict,              "/PGM/LargePage/ZeroEvict",           "The number of zero page mappings we had to evict when allocating a large page.");
+    PGM_REG_COUNTER(&pPGM->StatLargePageCoalesced,              "/PGM/LargePage/Coalesced",           "The number of 2 MB ranges coalesced into large pages.");
+    PGM_REG_COUNTER(&pPGM->StatLargePageCoalesceFailed,         "/PGM/LargePage/CoalesceFailed",      "The number of failed attempts at coalescing a 2 MB range.");
+    PGM_REG_PROFILE(&pPGM->StatLargePageCoalesce,               "/PGM/LargePage/Coalesce",            "Profiles the large page coalescing passes.");
 #ifdef VBOX_WITH_STATISTICS
     PGM_REG_PROFILE(&pStats->StatLargePageAlloc2,               "/PGM/LargePage/Alloc2",              "Time spent allocating large pages.");
     PGM_REG_PROFILE(&pStats->StatLargePageSetup,                "/PGM/LargePage/Setup",               "Time spent setting up the newly allocated large pages.");
@@ -1812,6 +1878,15 @@ VMMR3_INT_DECL(int) PGMR3InitCompleted(PVM pVM, VMINITCOMPLETED enmWhat)
 #else
             AssertLogRelReturn(!pVM->pgm.s.fPciPassthrough, VERR_PGM_PCI_PASSTHRU_MISCONFIG);
 #endif
+            {
+                /* HM has decided on large page usage by now. */
+                int rc = pgmR3PhysLargePageCoalesceInit(pVM);
+                AssertRCReturn(rc, rc);
+#ifdef VBOX_WITH_PAGE_SHARING
+                rc = pgmR3PageDedupInit(pVM);
+                AssertRCReturn(rc, rc);
+#endif
+            }
             break;
 
         default:
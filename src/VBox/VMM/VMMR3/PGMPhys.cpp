@@ -63,6 +63,10 @@
 *********************************************************************************************************************************/
 /** The number of pages to free in one batch. */
 #define PGMPHYS_FREE_PAGE_BATCH_SIZE    128
+/** The minimum number of allocated pages a 2 MB range must have before we
+ * consider coalescing it into a large page.  Coalescing commits host memory for
+ * all the zero pages in the range, so sparsely used ranges are left alone. */
+#define PGMPHYS_COALESCE_MIN_ALLOCATED  (_2M / GUEST_PAGE_SIZE / 2)
 
 
 
@@ -5573,6 +5577,191 @@ VMMR3DECL(int) PGMR3PhysChangeMemBalloon(PVM pVM, bool fInflate, unsigned cPages
 #endif
 }
 
+/**
+ * Inflate or deflate a memory balloon, waiting for the change to complete.
+ *
+ * Unlike PGMR3PhysChangeMemBalloon this never postpones the job to a request
+ * packet in the SMP case, the pages have changed state when this returns.  This
+ * is what devices which must not hand the pages back to the guest before the
+ * host is done with them need.  The caller must not own any lock (like the IOM
+ * lock) which the other EMTs may be blocking on.
+ *
+ * @returns VBox status code.
+ * @param   pVM         The cross context VM structure.
+ * @param   fInflate    Inflate or deflate memory balloon
+ * @param   cPages      Number of pages to free
+ * @param   paPhysPage  Array of guest physical addresses
+ * @thread  EMT
+ */
+VMMR3DECL(int) PGMR3PhysChangeMemBalloonSync(PVM pVM, bool fInflate, unsigned cPages, RTGCPHYS *paPhysPage)
+{
+    /* This must match GMMR0Init; currently we only support memory ballooning on all 64-bit hosts except Mac OS X */
+#if HC_ARCH_BITS == 64 && (defined(RT_OS_WINDOWS) || defined(RT_OS_SOLARIS) || defined(RT_OS_LINUX) || defined(RT_OS_FREEBSD))
+    VM_ASSERT_EMT_RETURN(pVM, VERR_VM_THREAD_NOT_EMT);
+    if (!cPages)
+        return VINF_SUCCESS;
+    AssertPtrReturn(paPhysPage, VERR_INVALID_POINTER);
+    AssertReturn(!(paPhysPage[0] & 0xfff), VERR_INVALID_PARAMETER);
+
+    uintptr_t paUser[3];
+    paUser[0] = fInflate;
+    paUser[1] = cPages;
+    paUser[2] = (uintptr_t)paPhysPage;
+    int rc = VMMR3EmtRendezvous(pVM, VMMEMTRENDEZVOUS_FLAGS_TYPE_ONCE, pgmR3PhysChangeMemBalloonRendezvous, (void *)paUser);
+    AssertRC(rc);
+    return rc;
+
+#else
+    NOREF(pVM); NOREF(fInflate); NOREF(cPages); NOREF(paPhysPage);
+    return VERR_NOT_IMPLEMENTED;
+#endif
+}
+
+/**
+ * Argument package for pgmR3PhysFreeReportedPagesRendezvous.
+ */
+typedef struct PGMR3PHYSFREEREPORTEDARGS
+{
+    /** Number of ranges in paRanges. */
+    uint32_t            cRanges;
+    /** Number of pages actually replaced by the zero page (output). */
+    uint32_t            cPagesFreed;
+    /** The ranges reported free by the guest. */
+    PCPGMPHYSRANGE      paRanges;
+} PGMR3PHYSFREEREPORTEDARGS;
+/** Pointer to a pgmR3PhysFreeReportedPagesRendezvous argument package. */
+typedef PGMR3PHYSFREEREPORTEDARGS *PPGMR3PHYSFREEREPORTEDARGS;
+
+
+/**
+ * Rendezvous callback used by PGMR3PhysFreeReportedPages that replaces the
+ * backing of guest RAM pages the guest has reported as unused with the zero
+ * page.
+ *
+ * Unlike ballooning the pages are not taken away from the guest, they simply
+ * go back to the zero state and will be reallocated by the next write.  Pages
+ * that cannot be freed safely (large pages, pages with handlers or mapping
+ * locks, pages that are not allocated) are silently skipped, the guest does
+ * not expect anything back.
+ *
+ * This is only called on one of the EMTs while the other ones are waiting for
+ * it to complete this function.
+ *
+ * @returns VBox strict status code.
+ * @param   pVM         The cross context VM structure.
+ * @param   pVCpu       The cross context virtual CPU structure of the calling EMT. Unused.
+ * @param   pvUser      Pointer to a PGMR3PHYSFREEREPORTEDARGS structure.
+ */
+static DECLCALLBACK(VBOXSTRICTRC) pgmR3PhysFreeReportedPagesRendezvous(PVM pVM, PVMCPU pVCpu, void *pvUser)
+{
+    PPGMR3PHYSFREEREPORTEDARGS pArgs = (PPGMR3PHYSFREEREPORTEDARGS)pvUser;
+    RT_NOREF(pVCpu);
+
+    PGM_LOCK_VOID(pVM);
+
+    uint32_t            cPendingPages = 0;
+    PGMMFREEPAGESREQ    pReq;
+    int rc = GMMR3FreePagesPrepare(pVM, &pReq, PGMPHYS_FREE_PAGE_BATCH_SIZE, GMMACCOUNT_BASE);
+    if (RT_FAILURE(rc))
+    {
+        PGM_UNLOCK(pVM);
+        AssertLogRelRC(rc);
+        return rc;
+    }
+
+    bool fFlushTLBs = false;
+    for (uint32_t iRange = 0; iRange < pArgs->cRanges && RT_SUCCESS(rc); iRange++)
+    {
+        RTGCPHYS GCPhys = pArgs->paRanges[iRange].GCPhysStart & ~(RTGCPHYS)GUEST_PAGE_OFFSET_MASK;
+        uint64_t cPages = pArgs->paRanges[iRange].cPages;
+        for (; cPages > 0; cPages--, GCPhys += GUEST_PAGE_SIZE)
+        {
+            PPGMPAGE pPage = pgmPhysGetPage(pVM, GCPhys);
+            if (   !pPage
+                || PGM_PAGE_GET_TYPE(pPage) != PGMPAGETYPE_RAM
+                || !PGM_PAGE_IS_ALLOCATED(pPage)
+                || PGM_PAGE_HAS_ANY_HANDLERS(pPage)
+                || PGM_PAGE_GET_WRITE_LOCKS(pPage) != 0
+                || PGM_PAGE_GET_READ_LOCKS(pPage) != 0
+                || PGM_PAGE_GET_PDE_TYPE(pPage) == PGM_PAGE_PDE_TYPE_PDE
+                || PGM_PAGE_GET_PDE_TYPE(pPage) == PGM_PAGE_PDE_TYPE_PDE_DISABLED)
+                continue;
+
+            LogFlow(("pgmR3PhysFreeReportedPagesRendezvous: %RGp\n", GCPhys));
+
+            /* Flush the shadow PT if this page was used as a guest page table and
+               drop all shadow references to the current host page. */
+            pgmPoolFlushPageByGCPhys(pVM, GCPhys);
+            int rc2 = pgmPoolTrackUpdateGCPhys(pVM, GCPhys, pPage, true /*fFlushPTEs*/, &fFlushTLBs);
+            if (rc2 != VINF_SUCCESS)
+                continue; /* VINF_PGM_SYNC_CR3 - leave it be, the pool will be cleared anyway. */
+
+            rc = pgmPhysFreePage(pVM, pReq, &cPendingPages, pPage, GCPhys, PGMPAGETYPE_RAM);
+            if (RT_FAILURE(rc))
+                break;
+            Assert(PGM_PAGE_IS_ZERO(pPage));
+            pArgs->cPagesFreed++;
+        }
+    }
+
+    if (RT_SUCCESS(rc) && cPendingPages)
+        rc = GMMR3FreePagesPerform(pVM, pReq, cPendingPages);
+    GMMR3FreePagesCleanup(pReq);
+
+    PGM_UNLOCK(pVM);
+
+    if (fFlushTLBs)
+        PGM_INVL_ALL_VCPU_TLBS(pVM);
+
+    /* Flush the recompiler's TLB as well. */
+    if (pArgs->cPagesFreed)
+        for (VMCPUID i = 0; i < pVM->cCpus; i++)
+            CPUMSetChangedFlags(pVM->apCpusR3[i], CPUM_CHANGED_GLOBAL_TLB_FLUSH);
+
+    AssertLogRelRC(rc);
+    return rc;
+}
+
+
+/**
+ * Returns guest RAM pages the guest has reported as unused to the host,
+ * replacing their backing with the zero page.
+ *
+ * This is the free page reporting counterpart to PGMR3PhysChangeMemBalloon.
+ * The pages stay ordinary RAM and are not accounted as ballooned; the next
+ * guest write simply allocates a fresh page.  The caller must not return the
+ * ranges to the guest before this function has completed.
+ *
+ * @returns VBox status code.
+ * @retval  VERR_PGM_NOT_SUPPORTED_FOR_NEM_MODE in simplified memory mode.
+ * @param   pVM             The cross context VM structure.
+ * @param   cRanges         Number of ranges in @a paRanges.
+ * @param   paRanges        The guest physical ranges reported as free.
+ * @param   pcPagesFreed    Where to return the number of pages actually freed.
+ *                          Optional.
+ * @thread  EMT
+ */
+VMMR3DECL(int) PGMR3PhysFreeReportedPages(PVM pVM, uint32_t cRanges, PCPGMPHYSRANGE paRanges, uint32_t *pcPagesFreed)
+{
+    VM_ASSERT_EMT_RETURN(pVM, VERR_VM_THREAD_NOT_EMT);
+    AssertReturn(cRanges == 0 || RT_VALID_PTR(paRanges), VERR_INVALID_POINTER);
+    if (pcPagesFreed)
+        *pcPagesFreed = 0;
+    if (PGM_IS_IN_NEM_MODE(pVM))
+        return VERR_PGM_NOT_SUPPORTED_FOR_NEM_MODE;
+    if (!cRanges)
+        return VINF_SUCCESS;
+
+    PGMR3PHYSFREEREPORTEDARGS Args;
+    Args.cRanges     = cRanges;
+    Args.cPagesFreed = 0;
+    Args.paRanges    = paRanges;
+    int rc = VMMR3EmtRendezvous(pVM, VMMEMTRENDEZVOUS_FLAGS_TYPE_ONCE, pgmR3PhysFreeReportedPagesRendezvous, &Args);
+    if (pcPagesFreed)
+        *pcPagesFreed = Args.cPagesFreed;
+    return rc;
+}
+
 
 
 /*********************************************************************************************************************************
@@ -6259,6 +6448,184 @@ VMMR3DECL(int) PGMR3PhysAllocateHandyPages(PVM pVM)
 }
 
 
+/*********************************************************************************************************************************
+*   Large Page Coalescing                                                                                                        *
+*********************************************************************************************************************************/
+
+/**
+ * Rendezvous callback doing one large page coalescing pass.
+ *
+ * This is only called on one of the EMTs while the other ones are waiting for
+ * it to complete, so no guest code can write to the pages being copied.
+ *
+ * @returns VINF_SUCCESS (VBox strict status code).
+ * @param   pVM         The cross context VM structure.
+ * @param   pVCpu       The cross context virtual CPU structure of the calling EMT.
+ * @param   pvUser      Unused.
+ */
+static DECLCALLBACK(VBOXSTRICTRC) pgmR3PhysLargePageCoalesceRendezvous(PVM pVM, PVMCPU pVCpu, void *pvUser)
+{
+    RT_NOREF(pVCpu, pvUser);
+    STAM_PROFILE_START(&pVM->pgm.s.StatLargePageCoalesce, a);
+    PGM_LOCK_VOID(pVM);
+
+    /*
+     * Skip the pass if a live save is tracking dirty pages or we're no longer
+     * using large pages.  Both can change while the request is queued, so this
+     * must be checked here and not when queuing.
+     */
+    if (   pVM->pgm.s.LiveSave.fActive
+        || !PGMIsUsingLargePages(pVM))
+    {
+        PGM_UNLOCK(pVM);
+        STAM_PROFILE_STOP(&pVM->pgm.s.StatLargePageCoalesce, a);
+        return VINF_SUCCESS;
+    }
+
+    /*
+     * Walk the RAM ranges in address order starting where the previous pass
+     * stopped.  We limit both the number of ranges we coalesce and the number
+     * we inspect so a pass never keeps the EMTs waiting for too long.
+     */
+    uint32_t const cMaxRanges     = pVM->pgm.s.cLargePageCoalesceMaxRanges;
+    uint32_t       cChecksLeft    = cMaxRanges * 16;
+    uint32_t       cCoalesced     = 0;
+    RTGCPHYS const GCPhysStart    = pVM->pgm.s.GCPhysLargePageCoalesceNext;
+    RTGCPHYS       GCPhysResume   = 0; /* Wrap around unless we stop early. */
+    bool           fStop          = false;
+
+    uint32_t const cLookupEntries = RT_MIN(pVM->pgm.s.RamRangeUnion.cLookupEntries, RT_ELEMENTS(pVM->pgm.s.aRamRangeLookup));
+    for (uint32_t idxLookup = 0; idxLookup < cLookupEntries && !fStop; idxLookup++)
+    {
+        uint32_t const idRamRange = PGMRAMRANGELOOKUPENTRY_GET_ID(pVM->pgm.s.aRamRangeLookup[idxLookup]);
+        AssertContinue(idRamRange < RT_ELEMENTS(pVM->pgm.s.apRamRanges));
+        PPGMRAMRANGE const pRam = pVM->pgm.s.apRamRanges[idRamRange];
+        AssertContinue(pRam);
+        if (   PGM_RAM_RANGE_IS_AD_HOC(pRam)
+            || pRam->GCPhysLast < GCPhysStart)
+            continue;
+
+        for (RTGCPHYS GCPhys = RT_ALIGN_64(RT_MAX(pRam->GCPhys, GCPhysStart), _2M);
+             GCPhys + _2M - 1 <= pRam->GCPhysLast && GCPhys + _2M > GCPhys;
+             GCPhys += _2M)
+        {
+            if (cCoalesced >= cMaxRanges || cChecksLeft == 0)
+            {
+                GCPhysResume = GCPhys;
+                fStop = true;
+                break;
+            }
+            cChecksLeft--;
+
+            uint32_t cAllocated = 0;
+            int rc = pgmPhysIsCoalescableLargePageRange(pVM, GCPhys, &cAllocated);
+            if (   RT_FAILURE(rc)
+                || cAllocated < PGMPHYS_COALESCE_MIN_ALLOCATED)
+                continue;
+
+            rc = VMMR3CallR0(pVM, VMMR0_DO_PGM_COALESCE_LARGE_PAGE, GCPhys, NULL);
+            if (RT_SUCCESS(rc))
+                cCoalesced++;
+            else
+            {
+                Log(("pgmR3PhysLargePageCoalesceRendezvous: GCPhys=%RGp -> %Rrc\n", GCPhys, rc));
+                STAM_REL_COUNTER_INC(&pVM->pgm.s.StatLargePageCoalesceFailed);
+                if (rc != VERR_PGM_INVALID_LARGE_PAGE_RANGE)
+                {
+                    /* Out of large pages, held off, disabled or live saving;
+                       try again next time around. */
+                    GCPhysResume = GCPhys;
+                    fStop = true;
+                    break;
+                }
+            }
+        }
+    }
+    pVM->pgm.s.GCPhysLargePageCoalesceNext = GCPhysResume;
+
+    /* Update the large page ratio. */
+    uint32_t const cPrivatePages = pVM->pgm.s.cPrivatePages;
+    uint32_t const cLargePages   = pVM->pgm.s.cLargePages - RT_MIN(pVM->pgm.s.cLargePagesDisabled, pVM->pgm.s.cLargePages);
+    pVM->pgm.s.uLargePageRatioPct = cPrivatePages
+                                  ? (uint32_t)RT_MIN((uint64_t)cLargePages * (_2M / GUEST_PAGE_SIZE) * 100 / cPrivatePages, 100)
+                                  : 0;
+
+    PGM_UNLOCK(pVM);
+    STAM_PROFILE_STOP(&pVM->pgm.s.StatLargePageCoalesce, a);
+    if (cCoalesced)
+        LogRel2(("PGM: Coalesced %u ranges into large pages (%RGp..%RGp); large page ratio %u%%\n",
+                 cCoalesced, GCPhysStart, GCPhysResume, pVM->pgm.s.uLargePageRatioPct));
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Request worker queued by pgmR3PhysLargePageCoalesceTimer.
+ *
+ * @param   pVM         The cross context VM structure.
+ */
+static DECLCALLBACK(void) pgmR3PhysLargePageCoalesce(PVM pVM)
+{
+    /* Skip the pass if the VM isn't running or we're not using large pages any
+       more.  The rendezvous worker rechecks the latter and live saving. */
+    if (   VMR3GetState(pVM) == VMSTATE_RUNNING
+        && PGMIsUsingLargePages(pVM))
+    {
+        int rc = VMMR3EmtRendezvous(pVM, VMMEMTRENDEZVOUS_FLAGS_TYPE_ONCE, pgmR3PhysLargePageCoalesceRendezvous, NULL);
+        AssertRC(rc);
+    }
+
+    /* Re-arm the timer.  We do this after the pass so passes never pile up. */
+    int rc = TMTimerSetMillies(pVM, pVM->pgm.s.hLargePageCoalesceTimer, pVM->pgm.s.cMsLargePageCoalesceInterval);
+    AssertRC(rc);
+}
+
+
+/**
+ * @callback_method_impl{FNTMTIMERINT, Kicks off a large page coalescing pass.}
+ */
+static DECLCALLBACK(void) pgmR3PhysLargePageCoalesceTimer(PVM pVM, TMTIMERHANDLE hTimer, void *pvUser)
+{
+    RT_NOREF(hTimer, pvUser);
+    int rc = VMR3ReqCallNoWait(pVM, VMCPUID_ANY_QUEUE, (PFNRT)pgmR3PhysLargePageCoalesce, 1, pVM);
+    AssertRC(rc);
+}
+
+
+/**
+ * Sets up large page coalescing if configured and large pages are in use.
+ *
+ * @returns VBox status code.
+ * @param   pVM         The cross context VM structure.
+ * @thread  EMT(0)
+ */
+int pgmR3PhysLargePageCoalesceInit(PVM pVM)
+{
+    if (   !pVM->pgm.s.fLargePageCoalescing
+        || pVM->pgm.s.hLargePageCoalesceTimer != NIL_TMTIMERHANDLE)
+        return VINF_SUCCESS;
+    if (   !PGMIsUsingLargePages(pVM)
+        || VM_IS_NEM_ENABLED(pVM)
+        || SUPR3IsDriverless())
+    {
+        LogRel(("PGM: Large page coalescing not available (large pages %s, NEM %RTbool)\n",
+                PGMIsUsingLargePages(pVM) ? "enabled" : "disabled", VM_IS_NEM_ENABLED(pVM)));
+        return VINF_SUCCESS;
+    }
+
+    int rc = TMR3TimerCreate(pVM, TMCLOCK_REAL, pgmR3PhysLargePageCoalesceTimer, NULL,
+                             TMTIMER_FLAGS_NO_RING0 | TMTIMER_FLAGS_NO_CRIT_SECT,
+                             "PGM Large Page Coalescing", &pVM->pgm.s.hLargePageCoalesceTimer);
+    AssertLogRelRCReturn(rc, rc);
+    rc = TMTimerSetMillies(pVM, pVM->pgm.s.hLargePageCoalesceTimer, pVM->pgm.s.cMsLargePageCoalesceInterval);
+    AssertLogRelRCReturn(rc, rc);
+
+    LogRel(("PGM: Large page coalescing enabled: every %u ms, max %u ranges per pass\n",
+            pVM->pgm.s.cMsLargePageCoalesceInterval, pVM->pgm.s.cLargePageCoalesceMaxRanges));
+    return VINF_SUCCESS;
+}
+
+
 /*********************************************************************************************************************************
 *   Other Stuff                                                                                                                  *
 *********************************************************************************************************************************/
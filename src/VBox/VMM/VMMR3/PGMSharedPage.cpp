@@ -32,7 +32,9 @@
 #define LOG_GROUP LOG_GROUP_PGM_SHARED
 #define VBOX_WITHOUT_PAGING_BIT_FIELDS /* 64-bit bitfields are just asking for trouble. See @bugref{9841} and others. */
 #include <VBox/vmm/pgm.h>
+#include <VBox/vmm/mm.h>
 #include <VBox/vmm/stam.h>
+#include <VBox/vmm/tm.h>
 #include <VBox/vmm/uvm.h>
 #include "PGMInternal.h"
 #include <VBox/vmm/vmcc.h>
@@ -43,8 +45,10 @@
 #include <VBox/VMMDev.h>
 #include <iprt/asm.h>
 #include <iprt/assert.h>
+#include <iprt/crc.h>
 #include <iprt/mem.h>
 #include <iprt/string.h>
+#include <iprt/time.h>
 
 #include "PGMInline.h"
 
@@ -52,6 +56,34 @@
 #ifdef VBOX_WITH_PAGE_SHARING
 
 
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** The number of pages the duplicate page scanner starts out with per pass. */
+# define PGM_PAGE_DEDUP_INITIAL_PAGES_PER_PASS  _4K
+/** The min number of pages the duplicate page scanner checks per pass. */
+# define PGM_PAGE_DEDUP_MIN_PAGES_PER_PASS      256
+/** The max number of pages the duplicate page scanner checks per pass. */
+# define PGM_PAGE_DEDUP_MAX_PAGES_PER_PASS      _256K
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/**
+ * Duplicate page scanner state for a RAM range.
+ */
+typedef struct PGMPAGEDEDUPRANGE
+{
+    /** The number of pages pau32Hashes covers. */
+    uint32_t            cPages;
+    /** The page hashes from the previous pass, zero if not hashed. */
+    uint32_t           *pau32Hashes;
+} PGMPAGEDEDUPRANGE;
+/** Pointer to the duplicate page scanner state for a RAM range. */
+typedef PGMPAGEDEDUPRANGE *PPGMPAGEDEDUPRANGE;
+
+
 /*********************************************************************************************************************************
 *   Global Variables                                                                                                             *
 *********************************************************************************************************************************/
@@ -284,6 +316,262 @@ VMMR3DECL(int) PGMR3SharedModuleCheckAll(PVM pVM)
 }
 
 
+
+/*********************************************************************************************************************************
+*   Host-side Duplicate Page Merging                                                                                             *
+*********************************************************************************************************************************/
+
+/**
+ * Hands a batch of unchanged pages to GMM for merging.
+ *
+ * @returns VBox status code.
+ * @param   pVM         The cross context VM structure.
+ * @param   pReq        The request.  cPages is reset on return.
+ */
+static int pgmR3PageDedupSubmit(PVM pVM, PGMMMERGEPAGESREQ pReq)
+{
+    int rc = GMMR3MergeDuplicatePages(pVM, pReq);
+    if (RT_SUCCESS(rc))
+    {
+        STAM_REL_COUNTER_ADD(&pVM->pgm.s.StatPageDedupIdle, pReq->cPages);
+        STAM_REL_COUNTER_ADD(&pVM->pgm.s.StatPageDedupMerged, pReq->cMerged);
+        STAM_REL_COUNTER_ADD(&pVM->pgm.s.StatPageDedupConverted, pReq->cConverted);
+    }
+    else
+        LogRel(("PGM: Merging %u duplicate pages failed: %Rrc\n", pReq->cPages, rc));
+    pReq->cPages = 0;
+    return rc;
+}
+
+
+/**
+ * Rendezvous callback doing one duplicate page scanner pass.
+ *
+ * Hashes up to PGM::cPageDedupPagesPerPass private RAM pages, starting where
+ * the previous pass stopped.  Pages whose hash didn't change since the
+ * previous pass are considered idle and handed to GMM, which merges them with
+ * identical shared pages (see GMMR0MergeDuplicatePage).  The guest gets a
+ * private copy back when it writes to a shared page.
+ *
+ * This is only called on one of the EMTs while the other ones are waiting for
+ * it to complete, so no guest code can modify the pages being compared.
+ *
+ * @returns VINF_SUCCESS (VBox strict status code).
+ * @param   pVM         The cross context VM structure.
+ * @param   pVCpu       The cross context virtual CPU structure of the calling EMT.
+ * @param   pvUser      The request buffer (PGMMMERGEPAGESREQ).
+ */
+static DECLCALLBACK(VBOXSTRICTRC) pgmR3PageDedupRendezvous(PVM pVM, PVMCPU pVCpu, void *pvUser)
+{
+    PGMMMERGEPAGESREQ const pReq = (PGMMMERGEPAGESREQ)pvUser;
+    RT_NOREF(pVCpu);
+
+    /* Flush all pending handy page operations before changing any shared page assignments. */
+    int rc = PGMR3PhysAllocateHandyPages(pVM);
+    AssertRC(rc);
+
+    uint64_t const nsStart = RTTimeNanoTS();
+    STAM_REL_PROFILE_START(&pVM->pgm.s.StatPageDedup, a);
+    PGM_LOCK_VOID(pVM);
+    pgmR3PhysAssertSharedPageChecksums(pVM);
+
+    uint32_t       cLeft        = pVM->pgm.s.cPageDedupPagesPerPass;
+    uint32_t       cScanned     = 0;
+    RTGCPHYS const GCPhysStart  = pVM->pgm.s.GCPhysPageDedupNext;
+    RTGCPHYS       GCPhysResume = 0; /* Wrap around unless we stop early. */
+    bool           fStop        = false;
+    pReq->cPages = 0;
+
+    uint32_t const cLookupEntries = RT_MIN(pVM->pgm.s.RamRangeUnion.cLookupEntries, RT_ELEMENTS(pVM->pgm.s.aRamRangeLookup));
+    for (uint32_t idxLookup = 0; idxLookup < cLookupEntries && !fStop; idxLookup++)
+    {
+        uint32_t const idRamRange = PGMRAMRANGELOOKUPENTRY_GET_ID(pVM->pgm.s.aRamRangeLookup[idxLookup]);
+        AssertContinue(idRamRange < RT_ELEMENTS(pVM->pgm.s.apRamRanges));
+        PPGMRAMRANGE const pRam = pVM->pgm.s.apRamRanges[idRamRange];
+        AssertContinue(pRam);
+        if (   PGM_RAM_RANGE_IS_AD_HOC(pRam)
+            || pRam->GCPhysLast < GCPhysStart)
+            continue;
+
+        /* (Re-)allocate the hash array if the range is new or changed size. */
+        PPGMPAGEDEDUPRANGE const pRange = &pVM->pgm.s.paPageDedupRangesR3[idRamRange];
+        uint32_t const           cPages = (uint32_t)(pRam->cb >> GUEST_PAGE_SHIFT);
+        if (pRange->cPages != cPages)
+        {
+            MMR3HeapFree(pRange->pau32Hashes);
+            pRange->cPages      = 0;
+            pRange->pau32Hashes = (uint32_t *)MMR3HeapAllocZ(pVM, MM_TAG_PGM, sizeof(pRange->pau32Hashes[0]) * cPages);
+            if (!pRange->pau32Hashes)
+                continue;
+            pRange->cPages = cPages;
+        }
+
+        for (uint32_t iPage = GCPhysStart > pRam->GCPhys ? (uint32_t)((GCPhysStart - pRam->GCPhys) >> GUEST_PAGE_SHIFT) : 0;
+             iPage < cPages;
+             iPage++)
+        {
+            RTGCPHYS const GCPhys = pRam->GCPhys + ((RTGCPHYS)iPage << GUEST_PAGE_SHIFT);
+            if (!cLeft)
+            {
+                GCPhysResume = GCPhys;
+                fStop = true;
+                break;
+            }
+
+            PPGMPAGE const pPage = &pRam->aPages[iPage];
+            if (   PGM_PAGE_GET_TYPE(pPage)       != PGMPAGETYPE_RAM
+                || PGM_PAGE_GET_STATE(pPage)      != PGM_PAGE_STATE_ALLOCATED
+                || PGM_PAGE_GET_PDE_TYPE(pPage)   == PGM_PAGE_PDE_TYPE_PDE
+                || PGM_PAGE_HAS_ANY_HANDLERS(pPage)
+                || PGM_PAGE_GET_READ_LOCKS(pPage)  != 0
+                || PGM_PAGE_GET_WRITE_LOCKS(pPage) != 0)
+            {
+                pRange->pau32Hashes[iPage] = 0;
+                continue;
+            }
+            cLeft--;
+
+            void const *pvPage;
+            rc = pgmPhysPageMapReadOnly(pVM, pPage, GCPhys, &pvPage);
+            if (RT_FAILURE(rc))
+            {
+                pRange->pau32Hashes[iPage] = 0;
+                continue;
+            }
+            uint32_t u32Hash = RTCrc32(pvPage, GUEST_PAGE_SIZE);
+            if (!u32Hash)
+                u32Hash = 1;    /* zero means not hashed */
+            cScanned++;
+
+            /* Unchanged since the last pass? Then it's a merge candidate. */
+            if (pRange->pau32Hashes[iPage] == u32Hash)
+            {
+                PGMMMERGEPAGEDESC const pDesc = &pReq->aPages[pReq->cPages];
+                pDesc->GCPhys  = GCPhys;
+                pDesc->idPage  = PGM_PAGE_GET_PAGEID(pPage);
+                pDesc->u32Hash = u32Hash;
+                if (++pReq->cPages >= GMM_MERGE_PAGES_MAX)
+                {
+                    rc = pgmR3PageDedupSubmit(pVM, pReq);
+                    if (RT_FAILURE(rc))
+                    {
+                        GCPhysResume = GCPhys + GUEST_PAGE_SIZE;
+                        fStop = true;
+                        break;
+                    }
+                }
+            }
+            pRange->pau32Hashes[iPage] = u32Hash;
+        }
+    }
+    if (pReq->cPages)
+        pgmR3PageDedupSubmit(pVM, pReq);
+    pVM->pgm.s.GCPhysPageDedupNext = GCPhysResume;
+
+    pgmR3PhysAssertSharedPageChecksums(pVM);
+    PGM_UNLOCK(pVM);
+    STAM_REL_PROFILE_STOP(&pVM->pgm.s.StatPageDedup, a);
+    STAM_REL_COUNTER_ADD(&pVM->pgm.s.StatPageDedupScanned, cScanned);
+
+    /*
+     * Fit the amount of work per pass to the CPU budget: shrink in proportion
+     * when over it, grow gradually when well below it and there was more to do.
+     */
+    uint64_t const cNsElapsed    = RTTimeNanoTS() - nsStart;
+    uint64_t const cNsBudget     = (uint64_t)pVM->pgm.s.cMsPageDedupInterval * RT_NS_1MS / 100 * pVM->pgm.s.uPageDedupCpuPct;
+    uint32_t       cPagesPerPass = pVM->pgm.s.cPageDedupPagesPerPass;
+    if (cNsElapsed > cNsBudget)
+        cPagesPerPass = (uint32_t)RT_MAX((uint64_t)cPagesPerPass * cNsBudget / cNsElapsed, PGM_PAGE_DEDUP_MIN_PAGES_PER_PASS);
+    else if (cNsElapsed < cNsBudget / 2 && fStop && !cLeft)
+        cPagesPerPass = RT_MIN(cPagesPerPass + cPagesPerPass / 4, PGM_PAGE_DEDUP_MAX_PAGES_PER_PASS);
+    pVM->pgm.s.cPageDedupPagesPerPass = cPagesPerPass;
+
+    Log2(("pgmR3PageDedupRendezvous: %RGp..%RGp: scanned %u pages in %RU64 ns; next pass %u pages\n",
+          GCPhysStart, GCPhysResume, cScanned, cNsElapsed, cPagesPerPass));
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Request worker queued by pgmR3PageDedupTimer.
+ *
+ * @param   pVM         The cross context VM structure.
+ */
+static DECLCALLBACK(void) pgmR3PageDedup(PVM pVM)
+{
+    /* Skip the pass if the VM isn't running or a live save is tracking dirty
+       pages (see fPhysWriteMonitoringEngaged). */
+    if (   VMR3GetState(pVM) == VMSTATE_RUNNING
+        && !pVM->pgm.s.LiveSave.fActive
+        && !pVM->pgm.s.fPhysWriteMonitoringEngaged)
+    {
+        PGMMMERGEPAGESREQ pReq = (PGMMMERGEPAGESREQ)RTMemTmpAlloc(RT_UOFFSETOF_DYN(GMMMERGEPAGESREQ, aPages[GMM_MERGE_PAGES_MAX]));
+        if (pReq)
+        {
+            int rc = VMMR3EmtRendezvous(pVM, VMMEMTRENDEZVOUS_FLAGS_TYPE_ONCE, pgmR3PageDedupRendezvous, pReq);
+            AssertRC(rc);
+            RTMemTmpFree(pReq);
+        }
+    }
+
+    /* Re-arm the timer.  We do this after the pass so passes never pile up. */
+    int rc = TMTimerSetMillies(pVM, pVM->pgm.s.hPageDedupTimer, pVM->pgm.s.cMsPageDedupInterval);
+    AssertRC(rc);
+}
+
+
+/**
+ * @callback_method_impl{FNTMTIMERINT, Kicks off a duplicate page scanner pass.}
+ */
+static DECLCALLBACK(void) pgmR3PageDedupTimer(PVM pVM, TMTIMERHANDLE hTimer, void *pvUser)
+{
+    RT_NOREF(hTimer, pvUser);
+    int rc = VMR3ReqCallNoWait(pVM, VMCPUID_ANY_QUEUE, (PFNRT)pgmR3PageDedup, 1, pVM);
+    AssertRC(rc);
+}
+
+
+/**
+ * Sets up the duplicate page scanner if configured.
+ *
+ * @returns VBox status code.
+ * @param   pVM         The cross context VM structure.
+ * @thread  EMT(0)
+ */
+int pgmR3PageDedupInit(PVM pVM)
+{
+    if (   !pVM->pgm.s.fPageDedup
+        || pVM->pgm.s.hPageDedupTimer != NIL_TMTIMERHANDLE)
+        return VINF_SUCCESS;
+    if (   !pVM->pgm.s.fPageFusionAllowed
+        || PGM_IS_IN_NEM_MODE(pVM)
+        || SUPR3IsDriverless())
+    {
+        LogRel(("PGM: Duplicate page merging not available (page fusion %s, NEM mode %RTbool)\n",
+                pVM->pgm.s.fPageFusionAllowed ? "allowed" : "not allowed", PGM_IS_IN_NEM_MODE(pVM)));
+        return VINF_SUCCESS;
+    }
+
+    pVM->pgm.s.paPageDedupRangesR3 = (PPGMPAGEDEDUPRANGE)MMR3HeapAllocZ(pVM, MM_TAG_PGM,
+                                                                        sizeof(PGMPAGEDEDUPRANGE) * PGM_MAX_RAM_RANGES);
+    AssertReturn(pVM->pgm.s.paPageDedupRangesR3, VERR_NO_MEMORY);
+    pVM->pgm.s.cPageDedupPagesPerPass = PGM_PAGE_DEDUP_INITIAL_PAGES_PER_PASS;
+    pVM->pgm.s.GCPhysPageDedupNext    = 0;
+
+    int rc = TMR3TimerCreate(pVM, TMCLOCK_REAL, pgmR3PageDedupTimer, NULL,
+                             TMTIMER_FLAGS_NO_RING0 | TMTIMER_FLAGS_NO_CRIT_SECT,
+                             "PGM Duplicate Page Merging", &pVM->pgm.s.hPageDedupTimer);
+    AssertLogRelRCReturn(rc, rc);
+    rc = TMTimerSetMillies(pVM, pVM->pgm.s.hPageDedupTimer, pVM->pgm.s.cMsPageDedupInterval);
+    AssertLogRelRCReturn(rc, rc);
+
+    LogRel(("PGM: Duplicate page merging enabled: every %u ms, CPU budget %u%%%s\n",
+            pVM->pgm.s.cMsPageDedupInterval, pVM->pgm.s.uPageDedupCpuPct,
+            PGMIsUsingLargePages(pVM) ? " (large page backed RAM is not scanned)" : ""));
+    return VINF_SUCCESS;
+}
+
+
 # ifdef DEBUG
 /**
  * Query the state of a page in a shared module
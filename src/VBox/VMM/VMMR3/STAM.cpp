@@ -31,7 +31,10 @@
  * with a somewhat uniform way of accessing VMM statistics.  STAM sports a
  * couple of different APIs for accessing them: STAMR3EnumU, STAMR3SnapshotU,
  * STAMR3DumpU, STAMR3DumpToReleaseLogU and the debugger.  Main is exposing the
- * XML based one, STAMR3SnapshotU.
+ * XML based one, STAMR3SnapshotU, and the OpenMetrics one, STAMR3ExportCollect.
+ * The latter works on a cached set of descriptors (STAMR3ExportCreate) and can
+ * restrict the output to the samples changed since the previous call, which
+ * makes it suitable for frequent polling.
  *
  * The rest of the VMM together with the devices and drivers registers their
  * statistics with STAM giving them a name.  The name is hierarchical, the
@@ -69,6 +72,7 @@
 
 #include <iprt/assert.h>
 #include <iprt/asm.h>
+#include <iprt/ctype.h>
 #include <iprt/mem.h>
 #include <iprt/stream.h>
 #include <iprt/string.h>
@@ -80,6 +84,13 @@
 /** The maximum name length excluding the terminator. */
 #define STAM_MAX_NAME_LEN   239
 
+/** Magic value for STAMEXPORTINT::u32Magic (Grace Brewster Murray Hopper). */
+#define STAMEXPORT_MAGIC                UINT32_C(0x19061209)
+/** Magic value for STAMEXPORTINT::u32Magic after destruction. */
+#define STAMEXPORT_MAGIC_DEAD           UINT32_C(0x19920101)
+/** How many times STAMR3ExportCollect will try get a stable descriptor cache. */
+#define STAMEXPORT_MAX_RESOLVE_TRIES    8
+
 
 /*********************************************************************************************************************************
 *   Structures and Typedefs                                                                                                      *
@@ -129,6 +140,113 @@ typedef struct STAMR3SNAPSHOTONE
 } STAMR3SNAPSHOTONE, *PSTAMR3SNAPSHOTONE;
 
 
+/**
+ * The OpenMetrics family type of an exported sample.
+ */
+typedef enum STAMEXPORTKIND
+{
+    STAMEXPORTKIND_INVALID = 0,
+    /** Counter, one value output as NAME_total. */
+    STAMEXPORTKIND_COUNTER,
+    /** Gauge, one value. */
+    STAMEXPORTKIND_GAUGE,
+    /** Gauge with two values labelled part="a" and part="b". */
+    STAMEXPORTKIND_RATIO,
+    /** Summary, two values output as NAME_count and NAME_sum. */
+    STAMEXPORTKIND_SUMMARY
+} STAMEXPORTKIND;
+
+
+/**
+ * A cached sample descriptor of an exporter.
+ */
+typedef struct STAMEXPORTENTRY
+{
+    /** The sample descriptor. */
+    PSTAMDESC       pDesc;
+    /** Offset of the metric family name in the string table. */
+    uint32_t        offName;
+    /** Length of the metric family name. */
+    uint32_t        cchName;
+    /** Offset of the preformatted TYPE and HELP lines in the string table. */
+    uint32_t        offMeta;
+    /** Length of the preformatted TYPE and HELP lines. */
+    uint32_t        cchMeta;
+    /** The family type. */
+    STAMEXPORTKIND  enmKind;
+    /** Set if au64Prev is valid. */
+    bool            fHavePrev;
+    /** The values at the previous collection. */
+    uint64_t        au64Prev[2];
+} STAMEXPORTENTRY;
+/** Pointer to a cached sample descriptor of an exporter. */
+typedef STAMEXPORTENTRY *PSTAMEXPORTENTRY;
+
+
+/**
+ * A statistics exporter (STAMEXPORT).
+ */
+typedef struct STAMEXPORTINT
+{
+    /** Magic value (STAMEXPORT_MAGIC). */
+    uint32_t            u32Magic;
+    /** STAM_EXPORT_CREATE_F_XXX. */
+    uint32_t            fFlags;
+    /** The user mode VM structure (retained). */
+    PUVM                pUVM;
+    /** The pattern. */
+    char               *pszPat;
+    /** The registration generation the cache was resolved at. */
+    uint32_t            uGeneration;
+    /** Set if the cache has been resolved. */
+    bool                fResolved;
+    /** Number of cached samples. */
+    uint32_t            cEntries;
+    /** The cached samples. */
+    PSTAMEXPORTENTRY    paEntries;
+    /** String table with the names and metadata lines. */
+    char               *pszStrTab;
+    /** Bitmap of the refresh groups the cached samples belong to. */
+    uint64_t            bmRefreshGroups;
+    /** Size of the previous output, used as buffer size hint. */
+    size_t              cbLastOutput;
+    /** Number of collections done. */
+    uint64_t            cCollects;
+    /** Number of times the pattern was resolved. */
+    uint32_t            cResolves;
+} STAMEXPORTINT;
+/** Pointer to a statistics exporter. */
+typedef STAMEXPORTINT *PSTAMEXPORTINT;
+
+
+/**
+ * Argument package for stamR3ExportResolveOne.
+ */
+typedef struct STAMEXPORTRESOLVE
+{
+    /** The user mode VM structure. */
+    PUVM                pUVM;
+    /** The entries. */
+    PSTAMEXPORTENTRY    paEntries;
+    /** Number of entries. */
+    uint32_t            cEntries;
+    /** Number of allocated entries. */
+    uint32_t            cEntriesAlloc;
+    /** Whether to include HELP lines. */
+    bool                fWithDesc;
+    /** The registration generation. */
+    uint32_t            uGeneration;
+    /** Bitmap of the refresh groups of the samples. */
+    uint64_t            bmRefreshGroups;
+    /** The metric family names, for detecting clashes. */
+    RTSTRSPACE          NameSpace;
+    /** The string table being built. */
+    STAMR3SNAPSHOTONE   StrTab;
+} STAMEXPORTRESOLVE;
+/** Pointer to the argument package for stamR3ExportResolveOne. */
+typedef STAMEXPORTRESOLVE *PSTAMEXPORTRESOLVE;
+
+
 /**
  * Init record for a ring-0 statistic sample.
  */
@@ -160,12 +278,14 @@ static DECLCALLBACK(void)   stamR3EnumRelLogPrintf(PSTAMR3PRINTONEARGS pvArg, co
 static DECLCALLBACK(void)   stamR3EnumPrintf(PSTAMR3PRINTONEARGS pvArg, const char *pszFormat, ...);
 static int                  stamR3SnapshotOne(PSTAMDESC pDesc, void *pvArg);
 static int                  stamR3SnapshotPrintf(PSTAMR3SNAPSHOTONE pThis, const char *pszFormat, ...);
+static DECLCALLBACK(size_t) stamR3SnapshotOutput(void *pvArg, const char *pach, size_t cch);
 static int                  stamR3PrintOne(PSTAMDESC pDesc, void *pvArg);
 static int                  stamR3EnumOne(PSTAMDESC pDesc, void *pvArg);
 static bool                 stamR3MultiMatch(const char * const *papszExpressions, unsigned cExpressions, unsigned *piExpression, const char *pszName);
 static char **              stamR3SplitPattern(const char *pszPat, unsigned *pcExpressions, char **ppszCopy);
 static int                  stamR3EnumU(PUVM pUVM, const char *pszPat, bool fUpdateRing0, int (pfnCallback)(PSTAMDESC pDesc, void *pvArg), void *pvArg);
 static void                 stamR3Ring0StatsRegisterU(PUVM pUVM);
+static void                 stamR3RefreshGroup(PUVM pUVM, uint8_t iRefreshGroup, uint64_t *pbmRefreshedGroups);
 
 #ifdef VBOX_WITH_DEBUGGER
 static FNDBGCCMD            stamR3CmdStats;
@@ -2293,6 +2413,7 @@ static int stamR3RegisterU(PUVM pUVM, void *pvSample, PFNSTAMR3CALLBACKRESET pfn
         stamR3LookupIncUsage(pLookup);
 
         stamR3ResetOne(pNew, pUVM->pVM);
+        ASMAtomicIncU32(&pUVM->stam.s.uGeneration);
         rc = VINF_SUCCESS;
     }
     else
@@ -2307,10 +2428,12 @@ static int stamR3RegisterU(PUVM pUVM, void *pvSample, PFNSTAMR3CALLBACKRESET pfn
  * Destroys the statistics descriptor, unlinking it and freeing all resources.
  *
  * @returns VINF_SUCCESS
+ * @param   pUVM        Pointer to the user mode VM structure.
  * @param   pCur        The descriptor to destroy.
  */
-static int stamR3DestroyDesc(PSTAMDESC pCur)
+static int stamR3DestroyDesc(PUVM pUVM, PSTAMDESC pCur)
 {
+    ASMAtomicIncU32(&pUVM->stam.s.uGeneration);
     RTListNodeRemove(&pCur->ListEntry);
     pCur->pLookup->pDesc = NULL; /** @todo free lookup nodes once it's working. */
     stamR3LookupDecUsage(pCur->pLookup);
@@ -2356,7 +2479,7 @@ VMMR3DECL(int)  STAMR3DeregisterByAddr(PUVM pUVM, void *pvSample)
     RTListForEachSafe(&pUVM->stam.s.List, pCur, pNext, STAMDESC, ListEntry)
     {
         if (pCur->u.pv == pvSample)
-            rc = stamR3DestroyDesc(pCur);
+            rc = stamR3DestroyDesc(pUVM, pCur);
     }
 
     STAM_UNLOCK_WR(pUVM);
@@ -2389,7 +2512,7 @@ static int stamR3DeregisterByPattern(PUVM pUVM, const char *pszPat)
             PSTAMDESC pNext = RTListNodeGetNext(&pCur->ListEntry, STAMDESC, ListEntry);
 
             if (RTStrSimplePatternMatch(pszPat, pCur->pszName))
-                rc = stamR3DestroyDesc(pCur);
+                rc = stamR3DestroyDesc(pUVM, pCur);
 
             /* advance. */
             if (pCur == pLast)
@@ -2504,7 +2627,7 @@ VMMR3DECL(int)  STAMR3DeregisterByPrefix(PUVM pUVM, const char *pszPrefix)
             PSTAMDESC const pNext = RTListNodeGetNext(&pCur->ListEntry, STAMDESC, ListEntry);
             Assert(strncmp(pCur->pszName, pszPrefix, cchPrefix) == 0);
 
-            rc = stamR3DestroyDesc(pCur);
+            rc = stamR3DestroyDesc(pUVM, pCur);
 
             /* advance. */
             if (pCur == pLast)
@@ -3032,6 +3155,543 @@ VMMR3DECL(int)  STAMR3SnapshotFree(PUVM pUVM, char *pszSnapshot)
 }
 
 
+/**
+ * Reads the current value(s) of a sample for the exporter.
+ *
+ * @returns true if the sample should be considered, false if it's an unused
+ *          STAMVISIBILITY_USED sample that has never been exported.
+ * @param   pEntry      The export entry.
+ * @param   pau64       Where to return the values (two entries).
+ */
+static bool stamR3ExportReadSample(PSTAMEXPORTENTRY pEntry, uint64_t *pau64)
+{
+    PSTAMDESC const pDesc = pEntry->pDesc;
+    pau64[1] = 0;
+    switch (pDesc->enmType)
+    {
+        case STAMTYPE_COUNTER:
+            pau64[0] = pDesc->u.pCounter->c;
+            break;
+
+        case STAMTYPE_PROFILE:
+        case STAMTYPE_PROFILE_ADV:
+            pau64[0] = pDesc->u.pProfile->cPeriods;
+            pau64[1] = pDesc->u.pProfile->cTicks;
+            break;
+
+        case STAMTYPE_RATIO_U32:
+        case STAMTYPE_RATIO_U32_RESET:
+            pau64[0] = pDesc->u.pRatioU32->u32A;
+            pau64[1] = pDesc->u.pRatioU32->u32B;
+            break;
+
+        case STAMTYPE_U8:
+        case STAMTYPE_U8_RESET:
+        case STAMTYPE_X8:
+        case STAMTYPE_X8_RESET:
+            pau64[0] = *pDesc->u.pu8;
+            break;
+
+        case STAMTYPE_U16:
+        case STAMTYPE_U16_RESET:
+        case STAMTYPE_X16:
+        case STAMTYPE_X16_RESET:
+            pau64[0] = *pDesc->u.pu16;
+            break;
+
+        case STAMTYPE_U32:
+        case STAMTYPE_U32_RESET:
+        case STAMTYPE_X32:
+        case STAMTYPE_X32_RESET:
+            pau64[0] = *pDesc->u.pu32;
+            break;
+
+        case STAMTYPE_U64:
+        case STAMTYPE_U64_RESET:
+        case STAMTYPE_X64:
+        case STAMTYPE_X64_RESET:
+            pau64[0] = *pDesc->u.pu64;
+            break;
+
+        case STAMTYPE_BOOL:
+        case STAMTYPE_BOOL_RESET:
+            pau64[0] = *pDesc->u.pf;
+            break;
+
+        case STAMTYPE_INTERNAL_SUM:
+        {
+            PSTAMSUMSAMPLE const pSum = pDesc->u.pSum;
+            stamR3SumRefresh(pSum);
+            if (pSum->enmType == STAMTYPE_COUNTER)
+                pau64[0] = pSum->u.Counter.c;
+            else
+            {
+                pau64[0] = pSum->u.Profile.cPeriods;
+                pau64[1] = pSum->u.Profile.cTicks;
+            }
+            break;
+        }
+
+        case STAMTYPE_INTERNAL_PCT_OF_SUM:
+        {
+            PSTAMSUMSAMPLE const pSum = pDesc->u.pSum;
+            stamR3PctOfSumRefresh(pDesc, pSum);
+            pau64[0] = pSum->u.Counter.c;
+            break;
+        }
+
+        default:
+            AssertMsgFailedReturn(("%d\n", pDesc->enmType), false);
+    }
+
+    return pDesc->enmVisibility != STAMVISIBILITY_USED
+        || pEntry->fHavePrev
+        || pau64[0] != 0
+        || pau64[1] != 0;
+}
+
+
+/**
+ * Outputs one OpenMetrics sample line.
+ *
+ * @param   pState      The output buffer state.
+ * @param   pszName     The metric family name.
+ * @param   cchName     The length of the metric family name.
+ * @param   pszSuffix   The name suffix / labels, including the separating space.
+ * @param   cchSuffix   The length of the suffix.
+ * @param   uValue      The sample value.
+ */
+static void stamR3ExportOutputLine(PSTAMR3SNAPSHOTONE pState, const char *pszName, size_t cchName,
+                                   const char *pszSuffix, size_t cchSuffix, uint64_t uValue)
+{
+    char   szLine[STAM_MAX_NAME_LEN + 128];
+    Assert(cchName + cchSuffix + 22 < sizeof(szLine));
+    memcpy(szLine, pszName, cchName);
+    memcpy(&szLine[cchName], pszSuffix, cchSuffix);
+    size_t off = cchName + cchSuffix;
+    off += RTStrFormatU64(&szLine[off], sizeof(szLine) - off - 1, uValue, 10, 0, 0, 0);
+    szLine[off++] = '\n';
+    stamR3SnapshotOutput(pState, szLine, off);
+}
+
+
+/**
+ * Outputs the OpenMetrics family of an export entry.
+ *
+ * @param   pState      The output buffer state.
+ * @param   pThis       The exporter.
+ * @param   pEntry      The entry to output.
+ * @param   pau64       The values to output.
+ */
+static void stamR3ExportOutputEntry(PSTAMR3SNAPSHOTONE pState, PSTAMEXPORTINT pThis, PSTAMEXPORTENTRY pEntry,
+                                    uint64_t const *pau64)
+{
+    const char * const pszName = &pThis->pszStrTab[pEntry->offName];
+    size_t const       cchName = pEntry->cchName;
+    stamR3SnapshotOutput(pState, &pThis->pszStrTab[pEntry->offMeta], pEntry->cchMeta);
+    switch (pEntry->enmKind)
+    {
+        case STAMEXPORTKIND_COUNTER:
+            stamR3ExportOutputLine(pState, pszName, cchName, RT_STR_TUPLE("_total "), pau64[0]);
+            break;
+        case STAMEXPORTKIND_GAUGE:
+            stamR3ExportOutputLine(pState, pszName, cchName, RT_STR_TUPLE(" "), pau64[0]);
+            break;
+        case STAMEXPORTKIND_RATIO:
+            stamR3ExportOutputLine(pState, pszName, cchName, RT_STR_TUPLE("{part=\"a\"} "), pau64[0]);
+            stamR3ExportOutputLine(pState, pszName, cchName, RT_STR_TUPLE("{part=\"b\"} "), pau64[1]);
+            break;
+        case STAMEXPORTKIND_SUMMARY:
+            stamR3ExportOutputLine(pState, pszName, cchName, RT_STR_TUPLE("_count "), pau64[0]);
+            stamR3ExportOutputLine(pState, pszName, cchName, RT_STR_TUPLE("_sum "), pau64[1]);
+            break;
+        default:
+            AssertFailed();
+    }
+}
+
+
+/**
+ * @callback_method_impl{FNRTSTRSPACECALLBACK, Frees a name node of the exporter
+ *                      resolver.}
+ */
+static DECLCALLBACK(int) stamR3ExportFreeName(PRTSTRSPACECORE pStr, void *pvUser)
+{
+    RTMemFree(pStr);
+    NOREF(pvUser);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * stamR3EnumU callback employed by stamR3ExportResolve.
+ *
+ * @returns VBox status code, but it's interpreted as 0 == success / !0 == failure by enmR3Enum.
+ * @param   pDesc       The sample.
+ * @param   pvArg       The resolver state (STAMEXPORTRESOLVE).
+ */
+static int stamR3ExportResolveOne(PSTAMDESC pDesc, void *pvArg)
+{
+    PSTAMEXPORTRESOLVE const pArgs = (PSTAMEXPORTRESOLVE)pvArg;
+    pArgs->uGeneration = pArgs->pUVM->stam.s.uGeneration;
+
+    /*
+     * Map the sample type onto an OpenMetrics family type.
+     */
+    STAMEXPORTKIND enmKind;
+    const char    *pszType;
+    switch (pDesc->enmType)
+    {
+        case STAMTYPE_COUNTER:
+            enmKind = STAMEXPORTKIND_COUNTER;
+            break;
+        case STAMTYPE_PROFILE:
+        case STAMTYPE_PROFILE_ADV:
+            enmKind = STAMEXPORTKIND_SUMMARY;
+            break;
+        case STAMTYPE_RATIO_U32:
+        case STAMTYPE_RATIO_U32_RESET:
+            enmKind = STAMEXPORTKIND_RATIO;
+            break;
+        case STAMTYPE_INTERNAL_SUM:
+            enmKind = pDesc->u.pSum->enmType == STAMTYPE_COUNTER ? STAMEXPORTKIND_COUNTER : STAMEXPORTKIND_SUMMARY;
+            break;
+        case STAMTYPE_CALLBACK:
+            return VINF_SUCCESS; /* Free form text, can't be expressed as a number. */
+        default:
+            enmKind = STAMEXPORTKIND_GAUGE;
+            break;
+    }
+    switch (enmKind)
+    {
+        case STAMEXPORTKIND_COUNTER:    pszType = "counter"; break;
+        case STAMEXPORTKIND_SUMMARY:    pszType = "summary"; break;
+        default:                        pszType = "gauge";   break;
+    }
+
+    /*
+     * Grow the entry array if necessary.
+     */
+    if (pArgs->cEntries >= pArgs->cEntriesAlloc)
+    {
+        uint32_t const   cNew  = pArgs->cEntriesAlloc ? pArgs->cEntriesAlloc * 2 : 64;
+        PSTAMEXPORTENTRY paNew = (PSTAMEXPORTENTRY)RTMemRealloc(pArgs->paEntries, cNew * sizeof(paNew[0]));
+        if (!paNew)
+            return VERR_NO_MEMORY;
+        pArgs->paEntries     = paNew;
+        pArgs->cEntriesAlloc = cNew;
+    }
+
+    /*
+     * Translate the sample name into a metric family name: "vbox" followed
+     * by the name with everything but letters, digits and underscores
+     * replaced by underscores.  Clashes get a numeric suffix.
+     */
+    char   szName[STAM_MAX_NAME_LEN + 32];
+    size_t cchName = 4;
+    memcpy(szName, "vbox", 4);
+    for (const char *pszSrc = pDesc->pszName; *pszSrc && cchName < STAM_MAX_NAME_LEN + 4; pszSrc++)
+        szName[cchName++] = RT_C_IS_ALNUM(*pszSrc) ? *pszSrc : '_';
+    szName[cchName] = '\0';
+    for (uint32_t iSuffix = 2; RTStrSpaceGet(&pArgs->NameSpace, szName) != NULL; iSuffix++)
+        RTStrPrintf(&szName[cchName], sizeof(szName) - cchName, "_%u", iSuffix);
+    cchName = strlen(szName);
+
+    PRTSTRSPACECORE pStr = (PRTSTRSPACECORE)RTMemAlloc(sizeof(*pStr) + cchName + 1);
+    if (!pStr)
+        return VERR_NO_MEMORY;
+    pStr->pszString = (char *)memcpy(pStr + 1, szName, cchName + 1);
+    RTStrSpaceInsert(&pArgs->NameSpace, pStr);
+
+    /*
+     * Add the name and the preformatted metadata lines to the string table.
+     */
+    PSTAMEXPORTENTRY const pEntry = &pArgs->paEntries[pArgs->cEntries];
+    pEntry->pDesc       = pDesc;
+    pEntry->enmKind     = enmKind;
+    pEntry->fHavePrev   = false;
+    pEntry->au64Prev[0] = 0;
+    pEntry->au64Prev[1] = 0;
+    pEntry->cchName     = (uint32_t)cchName;
+    pEntry->offName     = (uint32_t)(pArgs->StrTab.psz - pArgs->StrTab.pszStart);
+    stamR3SnapshotOutput(&pArgs->StrTab, szName, cchName + 1);
+
+    pEntry->offMeta     = (uint32_t)(pArgs->StrTab.psz - pArgs->StrTab.pszStart);
+    stamR3SnapshotPrintf(&pArgs->StrTab, "# TYPE %s %s\n", szName, pszType);
+    if (pArgs->fWithDesc && pDesc->pszDesc)
+    {
+        /* The HELP text must have backslashes, double quotes and newlines escaped. */
+        stamR3SnapshotPrintf(&pArgs->StrTab, "# HELP %s ", szName);
+        const char *pszCur     = pDesc->pszDesc;
+        const char *pszBadChar = strpbrk(pszCur, "\\\"\n");
+        while (pszBadChar)
+        {
+            stamR3SnapshotPrintf(&pArgs->StrTab, "%.*s\\%c", pszBadChar - pszCur, pszCur, *pszBadChar == '\n' ? 'n' : *pszBadChar);
+            pszCur     = pszBadChar + 1;
+            pszBadChar = strpbrk(pszCur, "\\\"\n");
+        }
+        if (pDesc->enmUnit != STAMUNIT_NONE)
+            stamR3SnapshotPrintf(&pArgs->StrTab, "%s [%s]\n", pszCur, STAMR3GetUnit(pDesc->enmUnit));
+        else
+            stamR3SnapshotPrintf(&pArgs->StrTab, "%s\n", pszCur);
+    }
+    pEntry->cchMeta     = (uint32_t)(pArgs->StrTab.psz - pArgs->StrTab.pszStart) - pEntry->offMeta;
+
+    if (pDesc->iRefreshGroup != STAM_REFRESH_GRP_NONE)
+        pArgs->bmRefreshGroups |= RT_BIT_64(pDesc->iRefreshGroup);
+    pArgs->cEntries++;
+    return pArgs->StrTab.rc;
+}
+
+
+/**
+ * (Re-)resolves the pattern of an exporter into the descriptor cache.
+ *
+ * The previous values are discarded, so the next collection will output all
+ * samples.
+ *
+ * @returns VBox status code.
+ * @param   pUVM        The user mode VM handle.
+ * @param   pThis       The exporter.
+ */
+static int stamR3ExportResolve(PUVM pUVM, PSTAMEXPORTINT pThis)
+{
+    STAMEXPORTRESOLVE Args;
+    RT_ZERO(Args);
+    Args.pUVM           = pUVM;
+    Args.StrTab.pVM     = pUVM->pVM;
+    Args.StrTab.rc      = VINF_SUCCESS;
+    Args.fWithDesc      = RT_BOOL(pThis->fFlags & STAM_EXPORT_CREATE_F_WITH_DESC);
+    Args.uGeneration    = ASMAtomicReadU32(&pUVM->stam.s.uGeneration);
+
+    int rc = stamR3EnumU(pUVM, pThis->pszPat, false /* fUpdateRing0 */, stamR3ExportResolveOne, &Args);
+    RTStrSpaceDestroy(&Args.NameSpace, stamR3ExportFreeName, NULL);
+    if (RT_SUCCESS(rc))
+        rc = Args.StrTab.rc;
+    if (RT_SUCCESS(rc))
+    {
+        RTMemFree(pThis->paEntries);
+        RTMemFree(pThis->pszStrTab);
+        pThis->paEntries       = Args.paEntries;
+        pThis->cEntries        = Args.cEntries;
+        pThis->pszStrTab       = Args.StrTab.pszStart;
+        pThis->bmRefreshGroups = Args.bmRefreshGroups;
+        pThis->uGeneration     = Args.uGeneration;
+        pThis->fResolved       = true;
+        pThis->cResolves++;
+        LogFlow(("stamR3ExportResolve: '%s' -> %u samples, %zu bytes of strings\n",
+                 pThis->pszPat, Args.cEntries, (size_t)(Args.StrTab.psz - Args.StrTab.pszStart)));
+    }
+    else
+    {
+        RTMemFree(Args.paEntries);
+        RTMemFree(Args.StrTab.pszStart);
+    }
+    return rc;
+}
+
+
+/**
+ * Creates an exporter for the statistics matching the given pattern.
+ *
+ * The pattern is resolved into a cache of sample descriptors with the
+ * OpenMetrics names and metadata preformatted, making the periodic
+ * STAMR3ExportCollect calls much cheaper than STAMR3Snapshot.  The cache is
+ * automatically re-resolved when samples are registered or deregistered.
+ *
+ * The exporter keeps a reference to @a pUVM until destroyed.
+ *
+ * @returns VBox status code.
+ * @param   pUVM            The user mode VM handle.
+ * @param   pszPat          The name matching pattern, see STAMR3Snapshot.
+ *                          NULL means everything.
+ * @param   fFlags          STAM_EXPORT_CREATE_F_XXX.
+ * @param   phExport        Where to return the exporter handle.
+ */
+VMMR3DECL(int) STAMR3ExportCreate(PUVM pUVM, const char *pszPat, uint32_t fFlags, PSTAMEXPORT phExport)
+{
+    UVM_ASSERT_VALID_EXT_RETURN(pUVM, VERR_INVALID_VM_HANDLE);
+    VM_ASSERT_VALID_EXT_RETURN(pUVM->pVM, VERR_INVALID_VM_HANDLE);
+    AssertPtrNullReturn(pszPat, VERR_INVALID_POINTER);
+    AssertReturn(!(fFlags & ~STAM_EXPORT_CREATE_F_VALID_MASK), VERR_INVALID_FLAGS);
+    AssertPtrReturn(phExport, VERR_INVALID_POINTER);
+    *phExport = NIL_STAMEXPORT;
+
+    PSTAMEXPORTINT pThis = (PSTAMEXPORTINT)RTMemAllocZ(sizeof(*pThis));
+    if (!pThis)
+        return VERR_NO_MEMORY;
+    pThis->u32Magic = STAMEXPORT_MAGIC;
+    pThis->fFlags   = fFlags;
+    pThis->pUVM     = pUVM;
+    pThis->pszPat   = RTStrDup(pszPat && *pszPat ? pszPat : "*");
+    int rc = VERR_NO_STR_MEMORY;
+    if (pThis->pszPat)
+    {
+        rc = stamR3ExportResolve(pUVM, pThis);
+        if (RT_SUCCESS(rc))
+        {
+            VMR3RetainUVM(pUVM);
+            *phExport = pThis;
+            return VINF_SUCCESS;
+        }
+        RTStrFree(pThis->pszPat);
+    }
+    RTMemFree(pThis);
+    return rc;
+}
+
+
+/**
+ * Collects the current values of an exporter in the OpenMetrics text format.
+ *
+ * Each sample is output as a metric family named "vbox" followed by the
+ * sample name with non-alphanumerical characters replaced by underscores.
+ * Counters become counters, profiles become summaries (periods as count and
+ * ticks as sum), ratios become gauges with a "part" label, and the other
+ * numerical types become gauges.  Callback samples are not exported.
+ *
+ * The exporter handle serves as the cursor for
+ * STAM_EXPORT_COLLECT_F_CHANGED_ONLY, so it should only be used by one
+ * consumer.  The caller must serialize calls for the same handle.
+ *
+ * @returns VBox status code.
+ * @retval  VERR_TRY_AGAIN if the statistics kept changing while resolving.
+ * @param   pUVM            The user mode VM handle.
+ * @param   hExport         The exporter handle.
+ * @param   fFlags          STAM_EXPORT_COLLECT_F_XXX.
+ * @param   ppszMetrics     Where to return the metrics text.  Free using
+ *                          STAMR3SnapshotFree().
+ * @param   pcchMetrics     Where to return the length of the text (excluding
+ *                          the terminator).  Optional.
+ */
+VMMR3DECL(int) STAMR3ExportCollect(PUVM pUVM, STAMEXPORT hExport, uint32_t fFlags, char **ppszMetrics, size_t *pcchMetrics)
+{
+    UVM_ASSERT_VALID_EXT_RETURN(pUVM, VERR_INVALID_VM_HANDLE);
+    VM_ASSERT_VALID_EXT_RETURN(pUVM->pVM, VERR_INVALID_VM_HANDLE);
+    PSTAMEXPORTINT pThis = hExport;
+    AssertPtrReturn(pThis, VERR_INVALID_HANDLE);
+    AssertReturn(pThis->u32Magic == STAMEXPORT_MAGIC, VERR_INVALID_HANDLE);
+    AssertReturn(pThis->pUVM == pUVM, VERR_INVALID_VM_HANDLE);
+    AssertReturn(!(fFlags & ~STAM_EXPORT_COLLECT_F_VALID_MASK), VERR_INVALID_FLAGS);
+    AssertPtrReturn(ppszMetrics, VERR_INVALID_POINTER);
+    AssertPtrNullReturn(pcchMetrics, VERR_INVALID_POINTER);
+    *ppszMetrics = NULL;
+    if (pcchMetrics)
+        *pcchMetrics = 0;
+
+    /*
+     * Make sure the descriptor cache is up to date and refresh the ring-0
+     * statistics it covers.  Refreshing may register new samples (GVMM host
+     * CPUs), in which case we have to go around again.  We leave the loop
+     * owning the read lock.
+     */
+    for (uint32_t cTries = 0;; cTries++)
+    {
+        if (   !pThis->fResolved
+            || pThis->uGeneration != ASMAtomicReadU32(&pUVM->stam.s.uGeneration))
+        {
+            int rc = stamR3ExportResolve(pUVM, pThis);
+            if (RT_FAILURE(rc))
+                return rc;
+        }
+
+        STAM_LOCK_RD(pUVM);
+        if (pThis->bmRefreshGroups)
+        {
+            uint64_t bmRefreshedGroups = 0;
+            for (uint8_t iGroup = 0; iGroup < 64; iGroup++)
+                if (pThis->bmRefreshGroups & RT_BIT_64(iGroup))
+                    stamR3RefreshGroup(pUVM, iGroup, &bmRefreshedGroups);
+        }
+        if (pThis->uGeneration == pUVM->stam.s.uGeneration)
+            break;
+        STAM_UNLOCK_RD(pUVM);
+        if (cTries >= STAMEXPORT_MAX_RESOLVE_TRIES)
+            return VERR_TRY_AGAIN;
+    }
+
+    /*
+     * Produce the output.  The buffer is sized after the previous output to
+     * avoid reallocations in the steady state.
+     */
+    STAMR3SNAPSHOTONE State = { NULL, NULL, NULL, pUVM->pVM, 0, VINF_SUCCESS, false };
+    size_t const cbInitial = RT_ALIGN_Z(pThis->cbLastOutput + 64, _4K);
+    State.pszStart = State.psz = (char *)RTMemAlloc(cbInitial);
+    if (State.pszStart)
+    {
+        State.pszEnd      = State.pszStart + cbInitial;
+        State.cbAllocated = cbInitial;
+        *State.psz        = '\0';
+    }
+
+    bool const fChangedOnly = RT_BOOL(fFlags & STAM_EXPORT_COLLECT_F_CHANGED_ONLY);
+    uint32_t   cOutput      = 0;
+    for (uint32_t i = 0; i < pThis->cEntries && RT_SUCCESS(State.rc); i++)
+    {
+        PSTAMEXPORTENTRY const pEntry = &pThis->paEntries[i];
+        uint64_t au64[2];
+        if (stamR3ExportReadSample(pEntry, au64))
+        {
+            bool const fChanged = !pEntry->fHavePrev
+                               || au64[0] != pEntry->au64Prev[0]
+                               || au64[1] != pEntry->au64Prev[1];
+            pEntry->au64Prev[0] = au64[0];
+            pEntry->au64Prev[1] = au64[1];
+            pEntry->fHavePrev   = true;
+            if (fChanged || !fChangedOnly)
+            {
+                stamR3ExportOutputEntry(&State, pThis, pEntry, au64);
+                cOutput++;
+            }
+        }
+    }
+
+    STAM_UNLOCK_RD(pUVM);
+
+    stamR3SnapshotOutput(&State, RT_STR_TUPLE("# EOF\n"));
+    int rc = State.rc;
+    if (RT_SUCCESS(rc))
+    {
+        pThis->cbLastOutput = (size_t)(State.psz - State.pszStart);
+        pThis->cCollects++;
+        *ppszMetrics = State.pszStart;
+        if (pcchMetrics)
+            *pcchMetrics = pThis->cbLastOutput;
+        LogFlow(("STAMR3ExportCollect: %u of %u samples, %zu bytes\n", cOutput, pThis->cEntries, pThis->cbLastOutput));
+    }
+    else
+        RTMemFree(State.pszStart);
+    return rc;
+}
+
+
+/**
+ * Destroys an exporter created by STAMR3ExportCreate.
+ *
+ * @returns VBox status code.
+ * @param   hExport         The exporter handle.  NIL_STAMEXPORT is quietly
+ *                          ignored.
+ */
+VMMR3DECL(int) STAMR3ExportDestroy(STAMEXPORT hExport)
+{
+    PSTAMEXPORTINT pThis = hExport;
+    if (pThis == NIL_STAMEXPORT)
+        return VINF_SUCCESS;
+    AssertPtrReturn(pThis, VERR_INVALID_HANDLE);
+    AssertReturn(pThis->u32Magic == STAMEXPORT_MAGIC, VERR_INVALID_HANDLE);
+
+    pThis->u32Magic = STAMEXPORT_MAGIC_DEAD;
+    PUVM pUVM = pThis->pUVM;
+    RTMemFree(pThis->paEntries);
+    RTMemFree(pThis->pszStrTab);
+    RTStrFree(pThis->pszPat);
+    RTMemFree(pThis);
+
+    VMR3ReleaseUVM(pUVM);
+    return VINF_SUCCESS;
+}
+
+
 /**
  * Dumps the selected statistics to the log.
  *
@@ -240,7 +240,10 @@ VMM_INT_DECL(int) TMR3Init(PVM pVM)
         pVM->tm.s.aTimerQueues[i].enmClock          = (TMCLOCK)i;
         pVM->tm.s.aTimerQueues[i].u64Expire         = INT64_MAX;
         pVM->tm.s.aTimerQueues[i].idxActive         = UINT32_MAX;
+        pVM->tm.s.aTimerQueues[i].idxActiveTail     = UINT32_MAX;
         pVM->tm.s.aTimerQueues[i].idxSchedule       = UINT32_MAX;
+        pVM->tm.s.aTimerQueues[i].cWheelShift       = i == TMCLOCK_REAL ? 0 /* ms */ : TMTIMERQUEUE_WHEEL_SHIFT_NS;
+        memset(pVM->tm.s.aTimerQueues[i].aidxWheel, 0xff, sizeof(pVM->tm.s.aTimerQueues[i].aidxWheel));
         pVM->tm.s.aTimerQueues[i].idxFreeHint       = 1;
         pVM->tm.s.aTimerQueues[i].fBeingProcessed   = false;
         pVM->tm.s.aTimerQueues[i].fCannotGrow       = false;
@@ -727,6 +730,22 @@ VMM_INT_DECL(int) TMR3Init(PVM pVM)
     STAM_REG(pVM, &pVM->tm.s.aTimerQueues[TMCLOCK_VIRTUAL].StatDo,    STAMTYPE_PROFILE, "/TM/DoQueues/Virtual",            STAMUNIT_TICKS_PER_CALL, "Time spent on the virtual clock queue.");
     STAM_REG(pVM, &pVM->tm.s.aTimerQueues[TMCLOCK_VIRTUAL_SYNC].StatDo,STAMTYPE_PROFILE,"/TM/DoQueues/VirtualSync",        STAMUNIT_TICKS_PER_CALL, "Time spent on the virtual sync clock queue.");
     STAM_REG(pVM, &pVM->tm.s.aTimerQueues[TMCLOCK_REAL].StatDo,       STAMTYPE_PROFILE, "/TM/DoQueues/Real",               STAMUNIT_TICKS_PER_CALL, "Time spent on the real clock queue.");
+    for (uint32_t i = 0; i < RT_ELEMENTS(pVM->tm.s.aTimerQueues); i++)
+    {
+        PTMTIMERQUEUE const pQueue = &pVM->tm.s.aTimerQueues[i];
+        STAMR3RegisterF(pVM, &pQueue->StatLinkHead,   STAMTYPE_COUNTER, STAMVISIBILITY_USED, STAMUNIT_OCCURENCES,
+                        "Timers inserted at the head of the active list.",               "/TM/LinkActive/%s/Head", pQueue->szName);
+        STAMR3RegisterF(pVM, &pQueue->StatLinkTail,   STAMTYPE_COUNTER, STAMVISIBILITY_USED, STAMUNIT_OCCURENCES,
+                        "Insertions starting at the tail hint.",                          "/TM/LinkActive/%s/Tail", pQueue->szName);
+        STAMR3RegisterF(pVM, &pQueue->StatLinkWheel,  STAMTYPE_COUNTER, STAMVISIBILITY_USED, STAMUNIT_OCCURENCES,
+                        "Insertions starting at a timer wheel hint.",                     "/TM/LinkActive/%s/Wheel", pQueue->szName);
+        STAMR3RegisterF(pVM, &pQueue->StatLinkScan,   STAMTYPE_COUNTER, STAMVISIBILITY_USED, STAMUNIT_OCCURENCES,
+                        "Insertions without a usable hint, walking from the head.",      "/TM/LinkActive/%s/Scan", pQueue->szName);
+        STAMR3RegisterF(pVM, &pQueue->StatLinkSteps,  STAMTYPE_COUNTER, STAMVISIBILITY_USED, STAMUNIT_OCCURENCES,
+                        "Active list entries walked when inserting timers.",             "/TM/LinkActive/%s/Steps", pQueue->szName);
+        STAMR3RegisterF(pVM, &pQueue->StatRunExpired, STAMTYPE_COUNTER, STAMVISIBILITY_USED, STAMUNIT_OCCURENCES,
+                        "Expired timers delivered by the queue runner.",                 "/TM/DoQueues/%s/Expired", pQueue->szName);
+    }
 
     STAM_REG(pVM, &pVM->tm.s.StatPoll,                                STAMTYPE_COUNTER, "/TM/Poll",                            STAMUNIT_OCCURENCES, "TMTimerPoll calls.");
     STAM_REG(pVM, &pVM->tm.s.StatPollAlreadySet,                      STAMTYPE_COUNTER, "/TM/Poll/AlreadySet",                 STAMUNIT_OCCURENCES, "TMTimerPoll calls where the FF was already set.");
@@ -2047,21 +2066,7 @@ static int tmR3TimerDestroy(PVMCC pVM, PTMTIMERQUEUE pQueue, PTMTIMER pTimer)
      * Unlink from the active list.
      */
     if (fActive)
-    {
-        const PTMTIMER pPrev = tmTimerGetPrev(pQueue, pTimer);
-        const PTMTIMER pNext = tmTimerGetNext(pQueue, pTimer);
-        if (pPrev)
-            tmTimerSetNext(pQueue, pPrev, pNext);
-        else
-        {
-            tmTimerQueueSetHead(pQueue, pQueue, pNext);
-            pQueue->u64Expire = pNext ? pNext->u64Expire : INT64_MAX;
-        }
-        if (pNext)
-            tmTimerSetPrev(pQueue, pNext, pPrev);
-        pTimer->idxNext = UINT32_MAX;
-        pTimer->idxPrev = UINT32_MAX;
-    }
+        tmTimerQueueUnlinkActiveWorker(pQueue, pQueue, pTimer);
 
     /*
      * Unlink from the schedule list by running it.
@@ -2403,18 +2408,8 @@ static void tmR3TimerQueueRun(PVM pVM, PTMTIMERQUEUE pQueue, PTMTIMER pTimer)
             Assert(pTimer->idxScheduleNext == UINT32_MAX); /* this can trigger falsely */
 
             /* unlink */
-            const PTMTIMER pPrev = tmTimerGetPrev(pQueue, pTimer);
-            if (pPrev)
-                tmTimerSetNext(pQueue, pPrev, pNext);
-            else
-            {
-                tmTimerQueueSetHead(pQueue, pQueue, pNext);
-                pQueue->u64Expire = pNext ? pNext->u64Expire : INT64_MAX;
-            }
-            if (pNext)
-                tmTimerSetPrev(pQueue, pNext, pPrev);
-            pTimer->idxNext = UINT32_MAX;
-            pTimer->idxPrev = UINT32_MAX;
+            tmTimerQueueUnlinkActiveWorker(pQueue, pQueue, pTimer);
+            STAM_COUNTER_INC(&pQueue->StatRunExpired);
 
             /* fire */
             TM_SET_STATE(pTimer, TMTIMERSTATE_EXPIRED_DELIVER);
@@ -2638,6 +2633,7 @@ static void tmR3TimerQueueRunVirtualSync(PVM pVM)
 
         /* Unlink it, change the state and do the callout. */
         tmTimerQueueUnlinkActive(pVM, pQueue, pQueue, pTimer);
+        STAM_COUNTER_INC(&pQueue->StatRunExpired);
         TM_SET_STATE(pTimer, TMTIMERSTATE_EXPIRED_DELIVER);
         STAM_PROFILE_START(&pTimer->StatTimer, PrfTimer);
         switch (pTimer->enmType)
@@ -824,6 +824,31 @@ static int vmR3InitRing3(PVM pVM, PUVM pUVM)
         AssertRC(rc);
         rc = STAMR3RegisterF(pVM, &pUVM->aCpus[idCpu].vm.s.StatHaltTimers,          STAMTYPE_PROFILE, STAMVISIBILITY_ALWAYS, STAMUNIT_NS_PER_CALL, "Profiling halted state timer tasks.", "/PROF/CPU%d/VM/Halt/Timers", idCpu);
         AssertRC(rc);
+
+        rc = STAMR3RegisterF(pVM, &pUVM->aCpus[idCpu].vm.s.StatHaltAdaptiveWokeSpinning,  STAMTYPE_COUNTER, STAMVISIBILITY_USED, STAMUNIT_OCCURENCES, "Halts ended while spinning.",  "/PROF/CPU%d/VM/Halt/Adaptive/WokeSpinning", idCpu);
+        AssertRC(rc);
+        rc = STAMR3RegisterF(pVM, &pUVM->aCpus[idCpu].vm.s.StatHaltAdaptiveWokeYielding,  STAMTYPE_COUNTER, STAMVISIBILITY_USED, STAMUNIT_OCCURENCES, "Halts ended while yielding.",  "/PROF/CPU%d/VM/Halt/Adaptive/WokeYielding", idCpu);
+        AssertRC(rc);
+        rc = STAMR3RegisterF(pVM, &pUVM->aCpus[idCpu].vm.s.StatHaltAdaptiveWokeBlocked,   STAMTYPE_COUNTER, STAMVISIBILITY_USED, STAMUNIT_OCCURENCES, "Halts that blocked.",          "/PROF/CPU%d/VM/Halt/Adaptive/WokeBlocked", idCpu);
+        AssertRC(rc);
+        rc = STAMR3RegisterF(pVM, &pUVM->aCpus[idCpu].vm.s.StatHaltAdaptiveNotifySkipped, STAMTYPE_COUNTER, STAMVISIBILITY_USED, STAMUNIT_OCCURENCES, "Wake-up signals skipped because the EMT was spinning.", "/PROF/CPU%d/VM/Halt/Adaptive/NotifySkipped", idCpu);
+        AssertRC(rc);
+        rc = STAMR3RegisterF(pVM, &pUVM->aCpus[idCpu].vm.s.StatHaltAdaptiveSpin,          STAMTYPE_PROFILE, STAMVISIBILITY_USED, STAMUNIT_NS_PER_CALL, "Halts ended without blocking.", "/PROF/CPU%d/VM/Halt/Adaptive/Spin", idCpu);
+        AssertRC(rc);
+        rc = STAMR3RegisterF(pVM, &pUVM->aCpus[idCpu].vm.s.Halt.Adaptive.cNsSpin,         STAMTYPE_U64,     STAMVISIBILITY_USED, STAMUNIT_NS,          "Current spin+yield window.",   "/PROF/CPU%d/VM/Halt/Adaptive/SpinWindow", idCpu);
+        AssertRC(rc);
+        rc = STAMR3RegisterF(pVM, &pUVM->aCpus[idCpu].vm.s.Halt.Adaptive.cNsWakeLatencyAvg, STAMTYPE_U64,   STAMVISIBILITY_USED, STAMUNIT_NS,          "Average blocking wake-up latency.", "/PROF/CPU%d/VM/Halt/Adaptive/WakeLatencyAvg", idCpu);
+        AssertRC(rc);
+        for (unsigned iBucket = 0; iBucket < VMHALT_ADAPTIVE_BUCKETS; iBucket++)
+        {
+            uint32_t const cUs = iBucket ? RT_BIT_32(iBucket - 1) : 0;
+            rc = STAMR3RegisterF(pVM, &pUVM->aCpus[idCpu].vm.s.aStatHaltAdaptiveIdle[iBucket], STAMTYPE_COUNTER, STAMVISIBILITY_USED, STAMUNIT_OCCURENCES,
+                                 "Halt idle periods, lower bound.", "/PROF/CPU%d/VM/Halt/Adaptive/Idle/%05uus", idCpu, cUs);
+            AssertRC(rc);
+            rc = STAMR3RegisterF(pVM, &pUVM->aCpus[idCpu].vm.s.aStatHaltAdaptiveWakeLatency[iBucket], STAMTYPE_COUNTER, STAMVISIBILITY_USED, STAMUNIT_OCCURENCES,
+                                 "Blocking wake-up latency, lower bound.", "/PROF/CPU%d/VM/Halt/Adaptive/WakeLatency/%05uus", idCpu, cUs);
+            AssertRC(rc);
+        }
     }
 
     STAM_REG(pVM, &pUVM->vm.s.StatReqAllocNew,   STAMTYPE_COUNTER,     "/VM/Req/AllocNew",       STAMUNIT_OCCURENCES,        "Number of VMR3ReqAlloc returning a new packet.");
@@ -332,6 +332,7 @@ static const char *vmR3GetHaltMethodName(VMHALTMETHOD enmMethod)
         case VMHALTMETHOD_1:            return "method1";
         //case VMHALTMETHOD_2:            return "method2";
         case VMHALTMETHOD_GLOBAL_1:     return "global1";
+        case VMHALTMETHOD_ADAPTIVE:     return "adaptive";
         default:                        return "unknown";
     }
 }
@@ -1063,6 +1064,326 @@ static DECLCALLBACK(void) vmR3DefaultNotifyCpuFF(PUVMCPU pUVCpu, uint32_t fFlags
 }
 
 
+/**
+ * Gets the adaptive halt histogram bucket for a period.
+ *
+ * @returns Bucket index, see VMHALT_ADAPTIVE_BUCKETS.
+ * @param   cNs         The period in nanoseconds.
+ */
+DECLINLINE(unsigned) vmR3HaltAdaptiveBucket(uint64_t cNs)
+{
+    uint64_t const cUs = cNs / RT_NS_1US;
+    if (!cUs)
+        return 0;
+    return RT_MIN(ASMBitLastSetU64(cUs), VMHALT_ADAPTIVE_BUCKETS - 1);
+}
+
+
+/**
+ * Recalculates the spin+yield window of an EMT from its idle period histogram.
+ *
+ * For each candidate window T (0 and the bucket boundaries up to the
+ * configured max) the expected cost is the CPU burned while waiting,
+ * min(idle, T), plus the wake-up latency paid whenever the idle period turns
+ * out to be longer than T and we end up blocking.  The cheapest T wins.
+ *
+ * @param   pUVM        Pointer to the user mode VM structure.
+ * @param   pUVCpu      Pointer to the user mode VMCPU structure.
+ */
+static void vmR3HaltAdaptiveUpdate(PUVM pUVM, PUVMCPU pUVCpu)
+{
+    uint32_t * const pau32Weights = pUVCpu->vm.s.Halt.Adaptive.au32IdleWeights;
+    uint64_t const   uBurnW       = pUVM->vm.s.Halt.Adaptive.uBurnWeightCfg;
+    uint64_t const   uLatencyW    = pUVM->vm.s.Halt.Adaptive.uLatencyWeightCfg;
+    uint64_t const   cNsWakeCost  = pUVCpu->vm.s.Halt.Adaptive.cNsWakeLatencyAvg * uLatencyW;
+
+    uint64_t cTotal = 0;
+    for (unsigned i = 0; i < VMHALT_ADAPTIVE_BUCKETS; i++)
+        cTotal += pau32Weights[i];
+    if (!cTotal)
+        return;
+
+    /* Everything blocks: */
+    uint64_t cNsBest    = 0;
+    uint64_t uCostBest  = cTotal * cNsWakeCost;
+
+    /* Spin/yield until the end of bucket iWindow, block if still idle: */
+    uint64_t cBelow     = 0;    /* weight of periods ending within the window */
+    uint64_t uBurnBelow = 0;    /* their (mid-bucket) burn cost */
+    for (unsigned iWindow = 0; iWindow < VMHALT_ADAPTIVE_BUCKETS - 1; iWindow++)
+    {
+        uint64_t const cNsLow  = iWindow ? RT_NS_1US << (iWindow - 1) : 0;
+        uint64_t const cNsHigh = RT_NS_1US << iWindow;
+        if (cNsHigh > pUVM->vm.s.Halt.Adaptive.cNsSpinMaxCfg)
+            break;
+        cBelow     += pau32Weights[iWindow];
+        uBurnBelow += pau32Weights[iWindow] * ((cNsLow + cNsHigh) / 2) * uBurnW;
+
+        uint64_t const uCost = uBurnBelow + (cTotal - cBelow) * (cNsHigh * uBurnW + cNsWakeCost);
+        if (uCost < uCostBest)
+        {
+            uCostBest = uCost;
+            cNsBest   = cNsHigh;
+        }
+    }
+    pUVCpu->vm.s.Halt.Adaptive.cNsSpin = cNsBest;
+
+    /* Age the history so we follow changing workloads. */
+    if (cTotal > _4K)
+        for (unsigned i = 0; i < VMHALT_ADAPTIVE_BUCKETS; i++)
+            pau32Weights[i] /= 2;
+}
+
+
+/**
+ * Initialize the adaptive halt method.
+ *
+ * @return VBox status code.
+ * @param   pUVM            Pointer to the user mode VM structure.
+ */
+static DECLCALLBACK(int) vmR3HaltAdaptiveInit(PUVM pUVM)
+{
+    PCFGMNODE pCfg = CFGMR3GetChild(CFGMR3GetRoot(pUVM->pVM), "/VMM/HaltedAdaptive");
+
+    /*
+     * The profile decides the defaults.
+     */
+    char szProfile[16];
+    int rc = CFGMR3QueryStringDef(pCfg, "Profile", szProfile, sizeof(szProfile), "latency");
+    AssertLogRelRCReturn(rc, rc);
+    if (!RTStrICmp(szProfile, "latency"))
+    {
+        pUVM->vm.s.Halt.Adaptive.enmProfileCfg     = VMHALTADAPTIVEPROFILE_LATENCY;
+        pUVM->vm.s.Halt.Adaptive.cNsSpinMaxCfg     = 200000;
+        pUVM->vm.s.Halt.Adaptive.cNsYieldAfterCfg  =  50000;
+        pUVM->vm.s.Halt.Adaptive.uBurnWeightCfg    = 1;
+        pUVM->vm.s.Halt.Adaptive.uLatencyWeightCfg = 8;
+    }
+    else if (!RTStrICmp(szProfile, "density"))
+    {
+        pUVM->vm.s.Halt.Adaptive.enmProfileCfg     = VMHALTADAPTIVEPROFILE_DENSITY;
+        pUVM->vm.s.Halt.Adaptive.cNsSpinMaxCfg     =  20000;
+        pUVM->vm.s.Halt.Adaptive.cNsYieldAfterCfg  =   2000;
+        pUVM->vm.s.Halt.Adaptive.uBurnWeightCfg    = 4;
+        pUVM->vm.s.Halt.Adaptive.uLatencyWeightCfg = 1;
+    }
+    else
+    {
+        LogRel(("VMEmt: Invalid /VMM/HaltedAdaptive/Profile value '%s', expected 'latency' or 'density'\n", szProfile));
+        return VERR_INVALID_PARAMETER;
+    }
+    pUVM->vm.s.Halt.Adaptive.cNsBlockCostCfg = 30000;
+
+    /*
+     * Query overrides.
+     */
+    if (pCfg)
+    {
+        uint32_t u32;
+        if (RT_SUCCESS(CFGMR3QueryU32(pCfg, "SpinMax", &u32)))
+            pUVM->vm.s.Halt.Adaptive.cNsSpinMaxCfg = u32;
+        if (RT_SUCCESS(CFGMR3QueryU32(pCfg, "YieldAfter", &u32)))
+            pUVM->vm.s.Halt.Adaptive.cNsYieldAfterCfg = u32;
+        if (RT_SUCCESS(CFGMR3QueryU32(pCfg, "BlockCost", &u32)))
+            pUVM->vm.s.Halt.Adaptive.cNsBlockCostCfg = u32;
+    }
+    LogRel(("VMEmt: HaltedAdaptive config: %s SpinMax=%u YieldAfter=%u BlockCost=%u\n",
+            pUVM->vm.s.Halt.Adaptive.enmProfileCfg == VMHALTADAPTIVEPROFILE_LATENCY ? "latency" : "density",
+            pUVM->vm.s.Halt.Adaptive.cNsSpinMaxCfg, pUVM->vm.s.Halt.Adaptive.cNsYieldAfterCfg,
+            pUVM->vm.s.Halt.Adaptive.cNsBlockCostCfg));
+
+    /*
+     * Reset the per-EMT state.  We're called in a rendezvous, so the other
+     * EMTs aren't halting right now.
+     */
+    for (VMCPUID idCpu = 0; idCpu < pUVM->cCpus; idCpu++)
+    {
+        PUVMCPU pUVCpu = &pUVM->aCpus[idCpu];
+        RT_ZERO(pUVCpu->vm.s.Halt.Adaptive);
+        pUVCpu->vm.s.Halt.Adaptive.cNsWakeLatencyAvg = pUVM->vm.s.Halt.Adaptive.cNsBlockCostCfg;
+    }
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * The adaptive halt method - Spin, then yield, then block in ring-3, with the
+ * spin+yield window learned from the recent idle periods of the EMT.
+ */
+static DECLCALLBACK(int) vmR3HaltAdaptiveHalt(PUVMCPU pUVCpu, const uint32_t fMask, uint64_t u64Now)
+{
+    PUVM    pUVM  = pUVCpu->pUVM;
+    PVMCPU  pVCpu = pUVCpu->pVCpu;
+    PVM     pVM   = pUVCpu->pVM;
+
+    if (pUVCpu->vm.s.Halt.Adaptive.cHaltsUntilUpdate-- == 0)
+    {
+        pUVCpu->vm.s.Halt.Adaptive.cHaltsUntilUpdate = 16;
+        vmR3HaltAdaptiveUpdate(pUVM, pUVCpu);
+    }
+    uint64_t const cNsSpin       = pUVCpu->vm.s.Halt.Adaptive.cNsSpin;
+    uint64_t const cNsYieldAfter = RT_MIN(pUVM->vm.s.Halt.Adaptive.cNsYieldAfterCfg, cNsSpin);
+
+#if defined(VBOX_VMM_TARGET_ARMV8)
+    uint64_t const cNsVTimerActivate = TMCpuGetVTimerActivationNano(pVCpu);
+    const bool     fVTimerActive     = cNsVTimerActivate != UINT64_MAX;
+    uint64_t const u64VTimerDeadline = fVTimerActive ? u64Now + cNsVTimerActivate : UINT64_MAX;
+#endif
+
+    /*
+     * Halt loop.
+     */
+    int  rc       = VINF_SUCCESS;
+    bool fYielded = false;
+    bool fBlocked = false;
+    ASMAtomicWriteBool(&pUVCpu->vm.s.Halt.Adaptive.fSpinning, true);
+    ASMAtomicWriteBool(&pUVCpu->vm.s.fWait, true);
+    for (;;)
+    {
+        /*
+         * Work the timers and check if we can exit.
+         */
+        uint64_t const u64StartTimers   = RTTimeNanoTS();
+        TMR3TimerQueuesDo(pVM);
+        uint64_t const cNsElapsedTimers = RTTimeNanoTS() - u64StartTimers;
+        STAM_REL_PROFILE_ADD_PERIOD(&pUVCpu->vm.s.StatHaltTimers, cNsElapsedTimers);
+        if (    VM_FF_IS_ANY_SET(pVM, VM_FF_EXTERNAL_HALTED_MASK)
+            ||  VMCPU_FF_IS_ANY_SET(pVCpu, fMask))
+            break;
+
+        /*
+         * Estimate time left to the next event.
+         */
+        uint64_t u64Delta;
+        TMTimerPollGIP(pVM, pVCpu, &u64Delta);
+        if (    VM_FF_IS_ANY_SET(pVM, VM_FF_EXTERNAL_HALTED_MASK)
+            ||  VMCPU_FF_IS_ANY_SET(pVCpu, fMask))
+            break;
+
+        uint64_t const u64Cur  = RTTimeNanoTS();
+        uint64_t const cNsIdle = u64Cur - u64Now;
+#if defined(VBOX_VMM_TARGET_ARMV8)
+        if (u64Cur >= u64VTimerDeadline)
+            break;
+        u64Delta = RT_MIN(u64Delta, u64VTimerDeadline - u64Cur);
+#endif
+
+        /*
+         * Keep polling while inside the spin+yield window, or when the next
+         * event is so close that blocking would only make us late for it.
+         */
+        if (   cNsIdle  < cNsSpin
+            || u64Delta < pUVCpu->vm.s.Halt.Adaptive.cNsWakeLatencyAvg)
+        {
+            if (cNsIdle < cNsYieldAfter || u64Delta < pUVCpu->vm.s.Halt.Adaptive.cNsWakeLatencyAvg)
+                for (unsigned i = 0; i < 16; i++)
+                    ASMNopPause();
+            else
+            {
+                uint64_t const u64StartSchedYield   = RTTimeNanoTS();
+                RTThreadYield();
+                uint64_t const cNsElapsedSchedYield = RTTimeNanoTS() - u64StartSchedYield;
+                STAM_REL_PROFILE_ADD_PERIOD(&pUVCpu->vm.s.StatHaltYield, cNsElapsedSchedYield);
+                fYielded = true;
+            }
+            continue;
+        }
+
+        /*
+         * Block.  Notifiers skip the semaphore while we're spinning, so clear
+         * the indicator and recheck the FFs before going to sleep.
+         */
+        VMMR3YieldStop(pVM);
+        ASMAtomicWriteU64(&pUVCpu->vm.s.Halt.Adaptive.u64WakeupTS, 0);
+        ASMAtomicWriteBool(&pUVCpu->vm.s.Halt.Adaptive.fSpinning, false);
+        if (    VM_FF_IS_ANY_SET(pVM, VM_FF_EXTERNAL_HALTED_MASK)
+            ||  VMCPU_FF_IS_ANY_SET(pVCpu, fMask))
+            break;
+
+        uint64_t const u64StartSchedHalt   = RTTimeNanoTS();
+        rc = RTSemEventWaitEx(pUVCpu->vm.s.EventSemWait,
+                              RTSEMWAIT_FLAGS_RELATIVE | RTSEMWAIT_FLAGS_NANOSECS | RTSEMWAIT_FLAGS_RESUME,
+                              RT_MIN(u64Delta, RT_NS_1SEC));
+        uint64_t const u64EndSchedHalt     = RTTimeNanoTS();
+        uint64_t const cNsElapsedSchedHalt = u64EndSchedHalt - u64StartSchedHalt;
+        STAM_REL_PROFILE_ADD_PERIOD(&pUVCpu->vm.s.StatHaltBlock, cNsElapsedSchedHalt);
+        fBlocked = true;
+
+        /* Learn the wake-up latency if someone signalled us. */
+        uint64_t const u64WakeupTS = ASMAtomicXchgU64(&pUVCpu->vm.s.Halt.Adaptive.u64WakeupTS, 0);
+        if (u64WakeupTS && u64EndSchedHalt > u64WakeupTS)
+        {
+            uint64_t const cNsWakeLatency = u64EndSchedHalt - u64WakeupTS;
+            STAM_REL_COUNTER_INC(&pUVCpu->vm.s.aStatHaltAdaptiveWakeLatency[vmR3HaltAdaptiveBucket(cNsWakeLatency)]);
+            pUVCpu->vm.s.Halt.Adaptive.cNsWakeLatencyAvg = (pUVCpu->vm.s.Halt.Adaptive.cNsWakeLatencyAvg * 7 + cNsWakeLatency) / 8;
+        }
+
+        if (rc == VERR_TIMEOUT)
+            rc = VINF_SUCCESS;
+        else if (RT_FAILURE(rc))
+        {
+            rc = vmR3FatalWaitError(pUVCpu, "RTSemEventWaitEx->%Rrc\n", rc);
+            break;
+        }
+        ASMAtomicWriteBool(&pUVCpu->vm.s.Halt.Adaptive.fSpinning, true);
+    }
+    ASMAtomicWriteBool(&pUVCpu->vm.s.Halt.Adaptive.fSpinning, false);
+
+    /*
+     * Feed the idle period into the histogram.
+     */
+    uint64_t const cNsIdle = RTTimeNanoTS() - u64Now;
+    unsigned const iBucket = vmR3HaltAdaptiveBucket(cNsIdle);
+    pUVCpu->vm.s.Halt.Adaptive.au32IdleWeights[iBucket]++;
+    STAM_REL_COUNTER_INC(&pUVCpu->vm.s.aStatHaltAdaptiveIdle[iBucket]);
+    if (fBlocked)
+        STAM_REL_COUNTER_INC(&pUVCpu->vm.s.StatHaltAdaptiveWokeBlocked);
+    else
+    {
+        if (fYielded)
+            STAM_REL_COUNTER_INC(&pUVCpu->vm.s.StatHaltAdaptiveWokeYielding);
+        else
+            STAM_REL_COUNTER_INC(&pUVCpu->vm.s.StatHaltAdaptiveWokeSpinning);
+        STAM_REL_PROFILE_ADD_PERIOD(&pUVCpu->vm.s.StatHaltAdaptiveSpin, cNsIdle);
+    }
+
+#if defined(VBOX_VMM_TARGET_ARMV8)
+    if (fVTimerActive)
+    {
+        uint64_t const u64End = RTTimeNanoTS();
+        uint64_t const cNsVTimerLeft = u64End < u64VTimerDeadline ? u64VTimerDeadline - u64End : 0;
+        if (!cNsVTimerLeft)
+            VMCPU_FF_SET(pVCpu, VMCPU_FF_VTIMER_ACTIVATED);
+        TMCpuSetVTimerNextActivation(pVCpu, cNsVTimerLeft);
+    }
+#endif
+    ASMAtomicUoWriteBool(&pUVCpu->vm.s.fWait, false);
+    return rc;
+}
+
+
+/**
+ * The adaptive halt method - VMR3NotifyFF() worker.
+ *
+ * @param   pUVCpu          Pointer to the user mode VMCPU structure.
+ * @param   fFlags          Notification flags, VMNOTIFYFF_FLAGS_*.
+ */
+static DECLCALLBACK(void) vmR3HaltAdaptiveNotifyCpuFF(PUVMCPU pUVCpu, uint32_t fFlags)
+{
+    if (pUVCpu->vm.s.fWait)
+    {
+        /* A spinning EMT polls the FFs itself, no need for a syscall. */
+        if (ASMAtomicReadBool(&pUVCpu->vm.s.Halt.Adaptive.fSpinning))
+        {
+            STAM_REL_COUNTER_INC(&pUVCpu->vm.s.StatHaltAdaptiveNotifySkipped);
+            return;
+        }
+        ASMAtomicCmpXchgU64(&pUVCpu->vm.s.Halt.Adaptive.u64WakeupTS, RTTimeNanoTS(), 0);
+    }
+    vmR3DefaultNotifyCpuFF(pUVCpu, fFlags);
+}
+
+
 /**
  * Array with halt method descriptors.
  * VMINT::iHaltMethod contains an index into this array.
@@ -1091,6 +1412,7 @@ static const struct VMHALTMETHODDESC
     { VMHALTMETHOD_OLD,       false, NULL,                NULL,   vmR3HaltOldDoHalt,   vmR3DefaultWait,     vmR3DefaultNotifyCpuFF,     NULL },
     { VMHALTMETHOD_1,         false, vmR3HaltMethod1Init, NULL,   vmR3HaltMethod1Halt, vmR3DefaultWait,     vmR3DefaultNotifyCpuFF,     NULL },
     { VMHALTMETHOD_GLOBAL_1,   true, vmR3HaltGlobal1Init, NULL,   vmR3HaltGlobal1Halt, vmR3HaltGlobal1Wait, vmR3HaltGlobal1NotifyCpuFF, NULL },
+    { VMHALTMETHOD_ADAPTIVE,  false, vmR3HaltAdaptiveInit, NULL,  vmR3HaltAdaptiveHalt, vmR3DefaultWait,    vmR3HaltAdaptiveNotifyCpuFF, NULL },
 };
 
 
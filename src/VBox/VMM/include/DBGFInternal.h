@@ -475,6 +475,23 @@ AssertCompileSize(DBGFTRACEREVTHDR, DBGF_TRACER_EVT_HDR_SZ);
 #endif
 
 
+/** @name Tracer event filter masks for DBGFTRACERSHARED::fEvtsEnabled.
+ * @{ */
+/** Event source and region management events, always recorded so a trace can
+ * be attributed to devices and registers. */
+#define DBGF_TRACER_EVT_F_ALWAYS            (  RT_BIT_32(DBGFTRACEREVT_SRC_REGISTER) \
+                                             | RT_BIT_32(DBGFTRACEREVT_SRC_DEREGISTER) \
+                                             | RT_BIT_32(DBGFTRACEREVT_MMIO_REGION_CREATE) \
+                                             | RT_BIT_32(DBGFTRACEREVT_MMIO_MAP) \
+                                             | RT_BIT_32(DBGFTRACEREVT_MMIO_UNMAP) \
+                                             | RT_BIT_32(DBGFTRACEREVT_IOPORT_REGION_CREATE) \
+                                             | RT_BIT_32(DBGFTRACEREVT_IOPORT_MAP) \
+                                             | RT_BIT_32(DBGFTRACEREVT_IOPORT_UNMAP))
+/** All events. */
+#define DBGF_TRACER_EVT_F_ALL               (RT_BIT_32(DBGFTRACEREVT_GCPHYS_WRITE + 1) - RT_BIT_32(DBGFTRACEREVT_SRC_REGISTER))
+/** @} */
+
+
 /**
  * Tracer instance data, shared structure.
  */
@@ -491,6 +508,11 @@ typedef struct DBGFTRACERSHARED
     volatile bool                           fEvtsWaiting;
     /** Flag whether the flush thread is actively running or was kicked. */
     volatile bool                           fFlushThrdActive;
+    /** Padding. */
+    bool                                    afPadding0[2];
+    /** Mask of event types which get recorded (RT_BIT_32(DBGFTRACEREVT)),
+     * see DBGF_TRACER_EVT_F_XXX. */
+    volatile uint32_t                       fEvtsEnabled;
     /** Padding to a 64byte alignment. */
     uint8_t                                 abAlignment0[32];
 } DBGFTRACERSHARED;
@@ -591,6 +591,43 @@ AssertCompile(RT_BIT_32(IEMTLB_ENTRY_COUNT_AS_POWER_OF_TWO) == IEMTLB_ENTRY_COUN
  */
 #define IEMTLB_WITH_LARGE_PAGE_BITMAP
 
+/** Enable the TLB victim buffer and large page entries.
+ *
+ * The main TLB is direct mapped, so two hot pages mapping to the same slot
+ * will keep evicting each other.  The victim buffer is a small fully
+ * associative array receiving valid entries displaced by TLB loads, and the
+ * large page entries record each recently loaded 2/4 MB guest page so that
+ * misses on the other 4 KB parts of it don't require a page table walk.
+ *
+ * Both are only consulted on a main TLB miss (see iemTlbLookupSecondary), and a
+ * hit moves the entry (back) into the main TLB.  So, the inline TLB lookup code
+ * in IEMAllMemRWTmplInline.cpp.h and the native recompiler emitters are not
+ * affected, they'll find the entry in the main TLB on the next access.
+ */
+#define IEMTLB_WITH_VICTIM_BUFFER
+
+/** Number of entries in the victim buffer (IEMTLB::aVictims). */
+#define IEMTLB_VICTIM_COUNT                     8
+/** Number of large page entries (IEMTLB::aLargePages). */
+#define IEMTLB_LARGE_PAGE_COUNT                 4
+
+/**
+ * IEM TLB large page entry.
+ */
+typedef struct IEMTLBLARGEENTRY
+{
+    /** The large page address tag (offset bits clear) and TLB revision,
+     *  see IEMTLBENTRY::uTag. */
+    uint64_t                uTag;
+    /** The IEMTLBE_F_PT_XXX flags (w/o physical revision). */
+    uint64_t                fFlags;
+    /** The guest physical address of the large page. */
+    uint64_t                GCPhys;
+    /** The tag bits making up the offset into the large page. */
+    uint64_t                fTagOffMask;
+} IEMTLBLARGEENTRY;
+AssertCompileSize(IEMTLBLARGEENTRY, 32);
+
 /**
  * An IEM TLB.
  *
@@ -711,7 +748,18 @@ typedef struct IEMTLB
     /** Subset of cTlbInvlPg that involved global large pages. */
     uint32_t            cTlbInvlPgLargeGlobal;
 
-    uint32_t            au32Padding[13];
+    /** Misses satisfied by the victim buffer. */
+    uint32_t            cTlbVictimHits;
+    /** Misses satisfied by a large page entry (no page walk). */
+    uint32_t            cTlbLargePageHits;
+    /** Valid entries evicted by a TLB load (conflict misses to come). */
+    uint32_t            cTlbConflictEvictions;
+    /** Next victim buffer entry to replace (round robin). */
+    uint32_t            idxVictimNext;
+    /** Next large page entry to replace (round robin). */
+    uint32_t            idxLargePageNext;
+
+    uint32_t            au32Padding[8];
 
     /** The TLB entries.
      * Even entries are for PTE.G=0 and uses uTlbRevision.
@@ -722,6 +770,13 @@ typedef struct IEMTLB
      * This duplicates IEMTLBE_F_PT_LARGE_PAGE for each TLB entry. */
     uint64_t            bmLargePage[IEMTLB_ENTRY_COUNT * 2 / 64];
 #endif
+#ifdef IEMTLB_WITH_VICTIM_BUFFER
+    /** Victim buffer receiving valid entries displaced from aEntries.
+     * Uses the same tag format and revisions as aEntries. */
+    IEMTLBENTRY         aVictims[IEMTLB_VICTIM_COUNT];
+    /** Recently loaded large pages. */
+    IEMTLBLARGEENTRY    aLargePages[IEMTLB_LARGE_PAGE_COUNT];
+#endif
 } IEMTLB;
 AssertCompileSizeAlignment(IEMTLB, 64);
 #ifdef IEMTLB_WITH_LARGE_PAGE_BITMAP
@@ -1170,6 +1225,21 @@ typedef IEMTLBTRACEENTRY const *PCIEMTLBTRACEENTRY;
  * iemGetTbFlagsForCurrentPc(). */
 #define IEMTB_F_CS_LIM_CHECKS           UINT32_C(0x10000000)
 
+/** Set on threaded TBs that were ended for capacity or pending-IRQ reasons
+ * rather than by the guest code itself, i.e. TBs that may be re-recorded as a
+ * superblock spanning the following TB(s) once they get hot.
+ * @see IEMCPU::fTbSuperblock */
+#define IEMTB_F_SUPERBLOCK_CANDIDATE    UINT32_C(0x20000000)
+/** Set on TBs that were recorded as a superblock.  These are never re-formed. */
+#define IEMTB_F_SUPERBLOCK              UINT32_C(0x40000000)
+/** Mask of the superblock flags (not part of the lookup key). */
+#define IEMTB_F_SUPERBLOCK_MASK         UINT32_C(0x60000000)
+
+/** Set on threaded TBs that have been queued for native recompilation on a
+ * background thread (not part of the lookup key).
+ * @see iemNativeBgQueue */
+#define IEMTB_F_NATIVE_BG_QUEUED        UINT32_C(0x80000000)
+
 /** Mask of the IEMTB_F_XXX flags that are part of the TB lookup key.
  *
  * @note We skip all of IEM_F_X86_CTX_MASK, with the exception of SMM (which we
@@ -1182,7 +1252,9 @@ typedef IEMTLBTRACEENTRY const *PCIEMTLBTRACEENTRY;
  *       Since most OSes will not share code between rings, this shouldn't
  *       have any real effect on TB/memory/recompiling load.
  */
-#define IEMTB_F_KEY_MASK                ((UINT32_MAX & ~(IEM_F_X86_CTX_MASK | IEMTB_F_TYPE_MASK)) | IEM_F_X86_CTX_SMM)
+#define IEMTB_F_KEY_MASK                ((UINT32_MAX & ~(  IEM_F_X86_CTX_MASK | IEMTB_F_TYPE_MASK | IEMTB_F_SUPERBLOCK_MASK \
+                                                         | IEMTB_F_NATIVE_BG_QUEUED)) \
+                                         | IEM_F_X86_CTX_SMM)
 /** @} */
 
 AssertCompile( (IEM_F_MODE_X86_16BIT              & IEM_F_MODE_CPUMODE_MASK) == IEMMODE_16BIT);
@@ -1735,13 +1807,22 @@ typedef struct IEMTBALLOCATOR
     /** Statistics: Number of the cInUseTbs that are threaded ones. */
     uint32_t        cThreadedTbs;
 
-    /** Where to start pruning TBs from when we're out.
-     *  See iemTbAllocatorAllocSlow for details. */
-    uint32_t        iPruneFrom;
+    /** The CLOCK hand, i.e. the TB index the next eviction sweep starts at.
+     *  See iemTbAllocatorClockSweep for details. */
+    uint32_t        iClockHand;
     /** Where to start pruning native TBs from when we're out of executable memory.
      *  See iemTbAllocatorFreeupNativeSpace for details. */
     uint32_t        iPruneNativeFrom;
-    uint64_t        u64Padding;
+    /** The number of in-use TBs at which incremental eviction starts. */
+    uint32_t        cEvictHighWater;
+    /** The IEMCPU::msRecompilerPollNow value when the CLOCK hand started the
+     *  current lap. */
+    uint32_t        msClockLap;
+    /** The IEMCPU::msRecompilerPollNow value when the CLOCK hand started the
+     *  previous lap. */
+    uint32_t        msClockPrevLap;
+    /** Statistics: Number of laps completed by the CLOCK hand. */
+    uint32_t        cClockLaps;
 
     /** Statistics: Number of TB allocation calls. */
     STAMCOUNTER     StatAllocs;
@@ -1751,6 +1832,19 @@ typedef struct IEMTBALLOCATOR
     STAMPROFILE     StatPrune;
     /** Statistics: Time spend pruning native TBs. */
     STAMPROFILE     StatPruneNative;
+    /** Statistics: Time spent on incremental eviction while allocating. */
+    STAMPROFILE     StatEvictStep;
+    /** Statistics: Number of TBs evicted. */
+    STAMCOUNTER     StatEvicted;
+    /** Statistics: Number of native TBs evicted. */
+    STAMCOUNTER     StatEvictedNative;
+    /** Statistics: Number of TBs spared (and aged) by the CLOCK hand. */
+    STAMCOUNTER     StatEvictSpared;
+    /** Statistics: Number of TBs recompiled for a recently evicted PC. */
+    STAMCOUNTER     StatRecompiledAfterEvict;
+    /** Recently evicted TB PCs for the StatRecompiledAfterEvict statistics,
+     *  direct mapped using IEMTBALLOC_EVICTED_HASH. */
+    RTGCPHYS        aGCPhysEvicted[64];
 
     /** The delayed free list (see iemTbAlloctorScheduleForFree). */
     PIEMTB          pDelayedFreeHead;
@@ -2237,8 +2331,8 @@ typedef struct IEMCPU
     /** Indicates that the current instruction is an STI.  This is set by the
      * iemCImpl_sti code and subsequently cleared by the recompiler. */
     bool                    fTbCurInstrIsSti;
-    /** Spaced reserved for recompiler data / alignment. */
-    bool                    afRecompilerStuff1[1];
+    /** Superblock formation state, IEMCPU_TB_SUPERBLOCK_F_XXX. */
+    uint8_t                 fTbSuperblock;
     /** Number of instructions before we need emit an IRQ check call again.
      * This helps making sure we don't execute too long w/o checking for
      * interrupts and immediately following instructions that may enable
@@ -2275,6 +2369,14 @@ typedef struct IEMCPU
     R3PTRTYPE(struct IEMRECOMPILERSTATE *)  pNativeRecompilerStateR3;
     /** Dummy entry for ppTbLookupEntryR3. */
     R3PTRTYPE(PIEMTB)       pTbLookupEntryDummyR3;
+    /** Background native recompilation: Completed jobs waiting to be installed
+     * by this EMT.  Protected by the background recompiler pool lock.
+     * @see iemNativeBgInstallCompleted */
+    R3PTRTYPE(struct IEMNATIVEBGJOB *) pNativeBgDoneR3;
+    /** Background native recompilation: Number of entries on pNativeBgDoneR3,
+     * for checking without taking the lock. */
+    uint32_t volatile       cNativeBgDone;
+    uint32_t                u32NativeBgPadding;
 #ifdef IEMNATIVE_WITH_DELAYED_PC_UPDATING_DEBUG
     /** The debug code advances this register as if it was CPUMCTX::rip and we
      * didn't do delayed PC updating.  When CPUMCTX::rip is finally updated,
@@ -2310,6 +2412,10 @@ typedef struct IEMCPU
     STAMCOUNTER             StatTbLoopFullTbDetected;
     /** Statistics: Times a loop back to the start of the TB was detected, var 2. */
     STAMCOUNTER             StatTbLoopFullTbDetected2;
+    /** Statistics: Number of threaded TBs ended for capacity/IRQ reasons. */
+    STAMCOUNTER             StatTbSuperblockCandidates;
+    /** Statistics: Number of hot TBs re-recorded as superblocks. */
+    STAMCOUNTER             StatTbSuperblocksFormed;
     /** Exec memory allocator statistics: Number of times allocaintg executable memory failed. */
     STAMCOUNTER             StatNativeExecMemInstrBufAllocFailed;
     /** Native TB statistics: Number of fully recompiled TBs. */
@@ -2322,12 +2428,33 @@ typedef struct IEMCPU
     STAMPROFILE             StatTbThreadedCalls;
     /** Native TB statistics: Native code size per TB. */
     STAMPROFILE             StatTbNativeCode;
-    /** Native TB statistics: Profiling native recompilation. */
+    /** Native TB statistics: Profiling synchronous native recompilation on the
+     *  EMT (iemNativeRecompile). */
     STAMPROFILE             StatNativeRecompilation;
     /** Native TB statistics: Number of calls per TB that were recompiled properly. */
     STAMPROFILE             StatNativeCallsRecompiled;
     /** Native TB statistics: Number of threaded calls per TB that weren't recompiled. */
     STAMPROFILE             StatNativeCallsThreaded;
+    /** Background native recompilation: TSC ticks spent recompiling a TB on a
+     *  worker thread (liveness analysis and code emitting). */
+    STAMPROFILE             StatNativeBgRecompilation;
+    /** Background native recompilation: Profiling the EMT installing the
+     *  native code of a background recompiled TB. */
+    STAMPROFILE             StatNativeBgInstall;
+    /** Background native recompilation: Nanoseconds from queuing to installing. */
+    STAMPROFILE             StatNativeBgLatency;
+    /** Background native recompilation: Number of TBs queued. */
+    STAMCOUNTER             StatNativeBgQueued;
+    /** Background native recompilation: Times the queue was full and the TB was
+     *  recompiled synchronously instead. */
+    STAMCOUNTER             StatNativeBgQueueFull;
+    /** Background native recompilation: Number of TBs installed. */
+    STAMCOUNTER             StatNativeBgInstalled;
+    /** Background native recompilation: Number of jobs that failed. */
+    STAMCOUNTER             StatNativeBgFailed;
+    /** Background native recompilation: Number of jobs cancelled because the TB
+     *  was freed before the native code could be installed. */
+    STAMCOUNTER             StatNativeBgCancelled;
     /** Native recompiled execution: TLB hits for data fetches. */
     STAMCOUNTER             StatNativeTlbHitsForFetch;
     /** Native recompiled execution: TLB hits for data stores. */
@@ -2536,9 +2663,9 @@ typedef struct IEMCPU
     /** @} */
 
 #ifdef IEM_WITH_TLB_TRACE
-    uint64_t                au64Padding[4];
+    uint64_t                au64Padding[7];
 #else
-    uint64_t                au64Padding[6];
+    uint64_t                au64Padding[1];
 #endif
 
 #ifdef IEM_WITH_TLB_TRACE
@@ -2587,6 +2714,14 @@ typedef IEMCPU *PIEMCPU;
 /** Pointer to the const per-CPU IEM state. */
 typedef IEMCPU const *PCIEMCPU;
 
+/** @name IEMCPU_TB_SUPERBLOCK_F_XXX - IEMCPU::fTbSuperblock values.
+ * @{ */
+/** Superblock formation is enabled (CFGM /IEM/RecompilerSuperblocks). */
+#define IEMCPU_TB_SUPERBLOCK_F_ENABLED  UINT8_C(0x01)
+/** The next iemThreadedCompile call should record a superblock. */
+#define IEMCPU_TB_SUPERBLOCK_F_PENDING  UINT8_C(0x02)
+/** @} */
+
 /** @def IEMNATIVE_SIMD_FP_CTRL_REG_NOT_MODIFIED
  * Value indicating the TB didn't modified the floating point control register.
  * @note Neither FPCR nor MXCSR accept this as a valid value (MXCSR is not fully populated,
@@ -2777,6 +2912,11 @@ typedef struct IEM
     /** Set if the CPUID host call functionality is enabled.   */
     bool                    fCpuIdHostCall;
 #endif
+#ifdef VBOX_WITH_IEM_NATIVE_RECOMPILER
+    /** The background native recompiler thread pool, NULL if not enabled.
+     * @see iemNativeBgInit */
+    R3PTRTYPE(struct IEMNATIVEBGPOOL *) pNativeBgPoolR3;
+#endif
 } IEM;
 
 
@@ -6833,7 +6973,7 @@ extern const PFNIEMOP g_apfnIemThreadedRecompilerVecMap3[1024];
 DECLHIDDEN(int)     iemPollTimers(PVMCC pVM, PVMCPUCC pVCpu) RT_NOEXCEPT;
 
 DECLCALLBACK(int)   iemTbInit(PVMCC pVM, uint32_t cInitialTbs, uint32_t cMaxTbs,
-                              uint64_t cbInitialExec, uint64_t cbMaxExec, uint32_t cbChunkExec);
+                              uint64_t cbInitialExec, uint64_t cbMaxExec, uint32_t cbChunkExec, bool fExecLargePages);
 void                iemThreadedTbObsolete(PVMCPUCC pVCpu, PIEMTB pTb, bool fSafeToFree);
 DECLHIDDEN(void)    iemTbAllocatorFree(PVMCPUCC pVCpu, PIEMTB pTb);
 void                iemTbAllocatorProcessDelayedFrees(PVMCPUCC pVCpu, PIEMTBALLOCATOR pTbAllocator);
@@ -6910,8 +7050,14 @@ DECLHIDDEN(int)     iemThreadedCompileBackAtFirstInstruction(PVMCPU pVCpu, PIEMT
 /* Native recompiler public bits: */
 
 DECLHIDDEN(PIEMTB)  iemNativeRecompile(PVMCPUCC pVCpu, PIEMTB pTb) RT_NOEXCEPT;
+int                 iemNativeBgInit(PVM pVM, uint32_t cThreads) RT_NOEXCEPT;
+void                iemNativeBgTerm(PVM pVM) RT_NOEXCEPT;
+DECLHIDDEN(bool)    iemNativeBgQueue(PVMCPUCC pVCpu, PIEMTB pTb) RT_NOEXCEPT;
+DECLHIDDEN(void)    iemNativeBgCancel(PVMCPUCC pVCpu, PIEMTB pTb) RT_NOEXCEPT;
+DECLHIDDEN(void)    iemNativeBgInstallCompleted(PVMCPUCC pVCpu) RT_NOEXCEPT;
 DECLHIDDEN(void)    iemNativeDisassembleTb(PVMCPU pVCpu, PCIEMTB pTb, PCDBGFINFOHLP pHlp) RT_NOEXCEPT;
-int                 iemExecMemAllocatorInit(PVMCPU pVCpu, uint64_t cbMax, uint64_t cbInitial, uint32_t cbChunk) RT_NOEXCEPT;
+int                 iemExecMemAllocatorInit(PVMCPU pVCpu, uint64_t cbMax, uint64_t cbInitial, uint32_t cbChunk,
+                                            bool fLargePages) RT_NOEXCEPT;
 DECLHIDDEN(PIEMNATIVEINSTR) iemExecMemAllocatorAlloc(PVMCPU pVCpu, uint32_t cbReq, PIEMTB pTb, PIEMNATIVEINSTR *ppaExec,
                                                      struct IEMNATIVEPERCHUNKCTX const **ppChunkCtx) RT_NOEXCEPT;
 DECLHIDDEN(PIEMNATIVEINSTR) iemExecMemAllocatorAllocFromChunk(PVMCPU pVCpu, uint32_t idxChunk, uint32_t cbReq,
@@ -1533,6 +1533,49 @@ typedef struct IEMRECOMPILERSTATE
 typedef IEMRECOMPILERSTATE *PIEMRECOMPILERSTATE;
 
 
+/** @name Statistics updated during liveness analysis and code emitting.
+ *
+ * That part of the recompilation may run on a background recompiler thread
+ * (IEM/NativeRecompileThreads), concurrently with the EMT and other workers
+ * updating the same per-VCPU statistics, so these must use atomic updates.
+ * @{ */
+#ifndef VBOX_WITHOUT_RELEASE_STATISTICS
+# define IEMNATIVE_STAM_REL_COUNTER_INC(a_pCounter)             ASMAtomicIncU64(&(a_pCounter)->c)
+# define IEMNATIVE_STAM_REL_PROFILE_ADD_PERIOD(a_pProfile, a_cTicks) \
+    iemNativeStamProfileAddPeriodAtomic((a_pProfile), (a_cTicks))
+#else
+# define IEMNATIVE_STAM_REL_COUNTER_INC(a_pCounter)             do { } while (0)
+# define IEMNATIVE_STAM_REL_PROFILE_ADD_PERIOD(a_pProfile, a_cTicks) do { } while (0)
+#endif
+#ifdef VBOX_WITH_STATISTICS
+# define IEMNATIVE_STAM_COUNTER_INC(a_pCounter)                 ASMAtomicIncU64(&(a_pCounter)->c)
+# define IEMNATIVE_STAM_COUNTER_ADD(a_pCounter, a_cAddend)      ASMAtomicAddU64(&(a_pCounter)->c, (a_cAddend))
+#else
+# define IEMNATIVE_STAM_COUNTER_INC(a_pCounter)                 do { } while (0)
+# define IEMNATIVE_STAM_COUNTER_ADD(a_pCounter, a_cAddend)      do { } while (0)
+#endif
+/** @} */
+
+#ifndef VBOX_WITHOUT_RELEASE_STATISTICS
+/**
+ * Atomic variant of STAM_REL_PROFILE_ADD_PERIOD, see
+ * IEMNATIVE_STAM_REL_PROFILE_ADD_PERIOD.
+ */
+DECLINLINE(void) iemNativeStamProfileAddPeriodAtomic(PSTAMPROFILE pProfile, uint64_t cTicks)
+{
+    ASMAtomicAddU64(&pProfile->cTicks, cTicks);
+    ASMAtomicIncU64(&pProfile->cPeriods);
+    uint64_t uOld;
+    while (cTicks > (uOld = ASMAtomicReadU64(&pProfile->cTicksMax)))
+        if (ASMAtomicCmpXchgU64(&pProfile->cTicksMax, cTicks, uOld))
+            break;
+    while (cTicks < (uOld = ASMAtomicReadU64(&pProfile->cTicksMin)))
+        if (ASMAtomicCmpXchgU64(&pProfile->cTicksMin, cTicks, uOld))
+            break;
+}
+#endif
+
+
 /** @def IEMNATIVE_TRY_SETJMP
  * Wrapper around setjmp / try, hiding all the ugly differences.
  *
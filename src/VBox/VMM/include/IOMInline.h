@@ -31,6 +31,7 @@
 # pragma once
 #endif
 
+#include <iprt/asm.h>
 #include <iprt/errcore.h>
 
 /** @addtogroup grp_iom_int   Internals
@@ -50,75 +51,49 @@
  * @param   poffPort        Where to return the port offset relative to the
  *                          start of the I/O port range.
  * @param   pidxLastHint    Pointer to IOMCPU::idxIoPortLastRead or
- *                          IOMCPU::idxIoPortLastWrite.
+ *                          IOMCPU::idxIoPortLastWrite.  Updated with the
+ *                          registration index on success.
  *
  * @note    In ring-0 it is possible to get an uninitialized entry (pDevIns is
  *          NULL, cPorts is 0), in which case there should be ring-3 handlers
  *          for the entry.  Use IOMIOPORTENTRYR0::idxSelf to get the ring-3
  *          entry.
- *
- * @note    This code is almost identical to iomMmioGetEntry, so keep in sync.
  */
 DECLINLINE(CTX_SUFF(PIOMIOPORTENTRY)) iomIoPortGetEntry(PVMCC pVM, RTIOPORT uPort, PRTIOPORT poffPort, uint16_t *pidxLastHint)
 {
     Assert(IOM_IS_SHARED_LOCK_OWNER(pVM));
 
+    /*
+     * The direct table has an entry for each port, so this is a simple
+     * indexing operation.
+     */
 #ifdef IN_RING0
-    uint32_t               iEnd      = RT_MIN(pVM->iom.s.cIoPortLookupEntries, pVM->iomr0.s.cIoPortAlloc);
-    PCIOMIOPORTLOOKUPENTRY paLookup  = pVM->iomr0.s.paIoPortLookup;
+    uint32_t const * const pau32Direct = pVM->iomr0.s.pau32IoPortDirect;
 #else
-    uint32_t               iEnd      = pVM->iom.s.cIoPortLookupEntries;
-    PCIOMIOPORTLOOKUPENTRY paLookup  = pVM->iom.s.paIoPortLookup;
+    uint32_t const * const pau32Direct = pVM->iom.s.pau32IoPortDirect;
 #endif
-    if (iEnd > 0)
+    if (pau32Direct)
     {
-        uint32_t iFirst = 0;
-        uint32_t i      = *pidxLastHint;
-        if (i < iEnd)
-        { /* likely */ }
-        else
-            i = iEnd / 2;
-        for (;;)
+        uint32_t const uEntry = pau32Direct[uPort];
+        if (uEntry)
         {
-            PCIOMIOPORTLOOKUPENTRY pCur = &paLookup[i];
-            if (pCur->uFirstPort > uPort)
-            {
-                if (i > iFirst)
-                    iEnd = i;
-                else
-                    break;
-            }
-            else if (pCur->uLastPort < uPort)
-            {
-                i += 1;
-                if (i < iEnd)
-                    iFirst = i;
-                else
-                    break;
-            }
-            else
-            {
-                *pidxLastHint = (uint16_t)i;
-                *poffPort     = uPort - pCur->uFirstPort;
+            size_t const idx = (uint16_t)uEntry - 1;
+            *pidxLastHint = (uint16_t)idx;
+            *poffPort     = uPort - (RTIOPORT)(uEntry >> 16);
 
-                /*
-                 * Translate the 'idx' member into a pointer.
-                 */
-                size_t const idx = pCur->idx;
+            /*
+             * Translate the registration index into a pointer.
+             */
 #ifdef IN_RING0
-                AssertMsg(idx < pVM->iom.s.cIoPortRegs && idx < pVM->iomr0.s.cIoPortAlloc,
-                          ("%#zx vs %#x/%x (port %#x)\n", idx, pVM->iom.s.cIoPortRegs, pVM->iomr0.s.cIoPortMax, uPort));
-                if (idx < pVM->iomr0.s.cIoPortAlloc)
-                    return &pVM->iomr0.s.paIoPortRegs[idx];
+            AssertMsg(idx < pVM->iom.s.cIoPortRegs && idx < pVM->iomr0.s.cIoPortAlloc,
+                      ("%#zx vs %#x/%x (port %#x)\n", idx, pVM->iom.s.cIoPortRegs, pVM->iomr0.s.cIoPortMax, uPort));
+            if (idx < pVM->iomr0.s.cIoPortAlloc)
+                return &pVM->iomr0.s.paIoPortRegs[idx];
 #else
-                if (idx < pVM->iom.s.cIoPortRegs)
-                    return &pVM->iom.s.paIoPortRegs[idx];
-                AssertMsgFailed(("%#zx vs %#x (port %#x)\n", idx, pVM->iom.s.cIoPortRegs, uPort));
+            if (idx < pVM->iom.s.cIoPortRegs)
+                return &pVM->iom.s.paIoPortRegs[idx];
+            AssertMsgFailed(("%#zx vs %#x (port %#x)\n", idx, pVM->iom.s.cIoPortRegs, uPort));
 #endif
-                break;
-            }
-
-            i = iFirst + (iEnd - iFirst) / 2;
         }
     }
     *poffPort = 0;
@@ -171,7 +146,6 @@ DECLINLINE(PIOMIOPORTSTATSENTRY) iomIoPortGetStats(PVMCC pVM, CTX_SUFF(PIOMIOPOR
  *          NULL, cbRegion is 0), in which case there should be ring-3 handlers
  *          for the entry.  Use IOMMMIOENTRYR0::idxSelf to get the ring-3 entry.
  *
- * @note    This code is almost identical to iomIoPortGetEntry, so keep in sync.
  */
 DECLINLINE(CTX_SUFF(PIOMMMIOENTRY)) iomMmioGetEntry(PVMCC pVM, RTGCPHYS GCPhys, PRTGCPHYS poffRegion, uint16_t *pidxLastHint)
 {
@@ -186,54 +160,86 @@ DECLINLINE(CTX_SUFF(PIOMMMIOENTRY)) iomMmioGetEntry(PVMCC pVM, RTGCPHYS GCPhys,
 #endif
     if (iEnd > 0)
     {
-        uint32_t iFirst = 0;
-        uint32_t i      = *pidxLastHint;
-        if (i < iEnd)
-        { /* likely */ }
+        /*
+         * Try the per-vCPU hint first, then the page map, and finally do a
+         * binary search, updating both the hint and the page map on success.
+         */
+        uint32_t i = *pidxLastHint;
+        if (   i < iEnd
+            && paLookup[i].GCPhysFirst <= GCPhys
+            && paLookup[i].GCPhysLast  >= GCPhys)
+            STAM_COUNTER_INC(&pVM->iom.s.StatMmioLookupHint);
         else
-            i = iEnd / 2;
-        for (;;)
         {
-            PCIOMMMIOLOOKUPENTRY pCur = &paLookup[i];
-            if (pCur->GCPhysFirst > GCPhys)
-            {
-                if (i > iFirst)
-                    iEnd = i;
-                else
-                    break;
-            }
-            else if (pCur->GCPhysLast < GCPhys)
-            {
-                i += 1;
-                if (i < iEnd)
-                    iFirst = i;
-                else
-                    break;
-            }
+#ifdef IN_RING0
+            uint64_t volatile * const pau64PageMap = pVM->iomr0.s.pau64MmioPageMap;
+#else
+            uint64_t volatile * const pau64PageMap = pVM->iom.s.pau64MmioPageMap;
+#endif
+            uintptr_t const idxPageMap = IOM_MMIO_PAGE_MAP_IDX(GCPhys);
+            uint64_t const  uPageMap   = pau64PageMap[idxPageMap];
+            i = (uint32_t)(uint16_t)uPageMap - 1;
+            if (   (uPageMap >> 16) == (GCPhys >> GUEST_PAGE_SHIFT)
+                && i < iEnd
+                && paLookup[i].GCPhysFirst <= GCPhys
+                && paLookup[i].GCPhysLast  >= GCPhys)
+                STAM_COUNTER_INC(&pVM->iom.s.StatMmioLookupPageMap);
             else
             {
-                *pidxLastHint = (uint16_t)i;
-                *poffRegion   = GCPhys - pCur->GCPhysFirst;
+                STAM_COUNTER_INC(&pVM->iom.s.StatMmioLookupSearch);
+                uint32_t iFirst = 0;
+                i = iEnd / 2;
+                for (;;)
+                {
+                    PCIOMMMIOLOOKUPENTRY pCur = &paLookup[i];
+                    if (pCur->GCPhysFirst > GCPhys)
+                    {
+                        if (i > iFirst)
+                            iEnd = i;
+                        else
+                        {
+                            *poffRegion = 0;
+                            return NULL;
+                        }
+                    }
+                    else if (pCur->GCPhysLast < GCPhys)
+                    {
+                        i += 1;
+                        if (i < iEnd)
+                            iFirst = i;
+                        else
+                        {
+                            *poffRegion = 0;
+                            return NULL;
+                        }
+                    }
+                    else
+                        break;
+
+                    i = iFirst + (iEnd - iFirst) / 2;
+                }
+                ASMAtomicWriteU64(&pau64PageMap[idxPageMap], IOM_MMIO_PAGE_MAP_MAKE(GCPhys, i));
+            }
+        }
+
+        PCIOMMMIOLOOKUPENTRY pCur = &paLookup[i];
+        *pidxLastHint = (uint16_t)i;
+        *poffRegion   = GCPhys - pCur->GCPhysFirst;
 
-                /*
-                 * Translate the 'idx' member into a pointer.
-                 */
-                size_t const idx = pCur->idx;
+        /*
+         * Translate the 'idx' member into a pointer.
+         */
+        size_t const idx = pCur->idx;
 #ifdef IN_RING0
-                AssertMsg(idx < pVM->iom.s.cMmioRegs && idx < pVM->iomr0.s.cMmioAlloc,
-                          ("%#zx vs %#x/%x (GCPhys=%RGp)\n", idx, pVM->iom.s.cMmioRegs, pVM->iomr0.s.cMmioMax, GCPhys));
-                if (idx < pVM->iomr0.s.cMmioAlloc)
-                    return &pVM->iomr0.s.paMmioRegs[idx];
+        AssertMsg(idx < pVM->iom.s.cMmioRegs && idx < pVM->iomr0.s.cMmioAlloc,
+                  ("%#zx vs %#x/%x (GCPhys=%RGp)\n", idx, pVM->iom.s.cMmioRegs, pVM->iomr0.s.cMmioMax, GCPhys));
+        if (idx < pVM->iomr0.s.cMmioAlloc)
+            return &pVM->iomr0.s.paMmioRegs[idx];
 #else
-                if (idx < pVM->iom.s.cMmioRegs)
-                    return &pVM->iom.s.paMmioRegs[idx];
-                AssertMsgFailed(("%#zx vs %#x (GCPhys=%RGp)\n", idx, pVM->iom.s.cMmioRegs, GCPhys));
+        if (idx < pVM->iom.s.cMmioRegs)
+            return &pVM->iom.s.paMmioRegs[idx];
+        AssertMsgFailed(("%#zx vs %#x (GCPhys=%RGp)\n", idx, pVM->iom.s.cMmioRegs, GCPhys));
 #endif
-                break;
-            }
-
-            i = iFirst + (iEnd - iFirst) / 2;
-        }
     }
     *poffRegion = 0;
     return NULL;
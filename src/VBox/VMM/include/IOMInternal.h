@@ -71,6 +71,21 @@ typedef IOMIOPORTLOOKUPENTRY *PIOMIOPORTLOOKUPENTRY;
 /** Pointer to a const I/O port lookup table entry. */
 typedef IOMIOPORTLOOKUPENTRY const *PCIOMIOPORTLOOKUPENTRY;
 
+/** @name I/O port direct lookup table.
+ * The direct table has one 32-bit entry per I/O port, holding the registration
+ * index plus one in the low word (zero if unmapped) and the first port of the
+ * mapping in the high word.  It is kept up to date by IOMR3IoPortMap and
+ * IOMR3IoPortUnmap and lives right after the lookup table.
+ * @{ */
+/** Number of entries in the direct table. */
+#define IOM_IOPORT_DIRECT_ENTRIES               _64K
+/** Size of the direct table in bytes. */
+#define IOM_IOPORT_DIRECT_SIZE                  (IOM_IOPORT_DIRECT_ENTRIES * sizeof(uint32_t))
+/** Makes a direct table entry. */
+#define IOM_IOPORT_DIRECT_MAKE(a_idxReg, a_uFirstPort) \
+    ( ((uint32_t)(a_uFirstPort) << 16) | (uint32_t)((a_idxReg) + 1) )
+/** @} */
+
 /**
  * Ring-0 I/O port handle table entry.
  */
@@ -88,6 +103,11 @@ typedef struct IOMIOPORTENTRYR0
     R0PTRTYPE(PFNIOMIOPORTNEWOUTSTRING) pfnOutStrCallback;
     /** Pointer to string IN callback function. */
     R0PTRTYPE(PFNIOMIOPORTNEWINSTRING)  pfnInStrCallback;
+    /** Pointer to the IN callback function called while holding only
+     * pCritSectRw in shared mode, NULL if not used. */
+    R0PTRTYPE(PFNIOMIOPORTNEWIN)        pfnInSharedCallback;
+    /** The read/write critical section for pfnInSharedCallback. */
+    R0PTRTYPE(PPDMCRITSECTRW)           pCritSectRw;
     /** The entry of the first statistics entry, UINT16_MAX if no stats. */
     uint16_t                            idxStats;
     /** The number of ports covered by this entry, 0 if entry not used. */
@@ -119,6 +139,11 @@ typedef struct IOMIOPORTENTRYR3
     R3PTRTYPE(PFNIOMIOPORTNEWOUTSTRING) pfnOutStrCallback;
     /** Pointer to string IN callback function. */
     R3PTRTYPE(PFNIOMIOPORTNEWINSTRING)  pfnInStrCallback;
+    /** Pointer to the IN callback function called while holding only
+     * pCritSectRw in shared mode, NULL if not used. */
+    R3PTRTYPE(PFNIOMIOPORTNEWIN)        pfnInSharedCallback;
+    /** The read/write critical section for pfnInSharedCallback. */
+    R3PTRTYPE(PPDMCRITSECTRW)           pCritSectRw;
     /** Description / Name. For easing debugging. */
     R3PTRTYPE(const char *)             pszDesc;
     /** Extended port description table, optional. */
@@ -146,7 +171,7 @@ typedef struct IOMIOPORTENTRYR3
     /** Same as the handle index. */
     uint16_t                            idxSelf;
 } IOMIOPORTENTRYR3;
-AssertCompileSize(IOMIOPORTENTRYR3, 9 * sizeof(RTR3PTR) + 16);
+AssertCompileSize(IOMIOPORTENTRYR3, 11 * sizeof(RTR3PTR) + 16);
 /** Pointer to a ring-3 I/O port handle table entry. */
 typedef IOMIOPORTENTRYR3 *PIOMIOPORTENTRYR3;
 /** Pointer to a const ring-3 I/O port handle table entry. */
@@ -207,6 +232,25 @@ typedef IOMMMIOLOOKUPENTRY *PIOMMMIOLOOKUPENTRY;
 /** Pointer to a const MMIO lookup table entry. */
 typedef IOMMMIOLOOKUPENTRY const *PCIOMMMIOLOOKUPENTRY;
 
+/** @name MMIO page map.
+ * A direct mapped, page granular cache in front of the MMIO lookup table,
+ * filled on lookup and cleared whenever a region is mapped or unmapped.  The
+ * entries hold the guest page frame number in the upper 48 bits and the lookup
+ * table index plus one in the low 16 bits (zero if unused).  Since the hit is
+ * validated against the lookup entry, a stale entry only costs a miss.  The map
+ * lives right after the lookup table.
+ * @{ */
+/** Number of entries in the MMIO page map. */
+#define IOM_MMIO_PAGE_MAP_ENTRIES               512
+/** Size of the MMIO page map in bytes. */
+#define IOM_MMIO_PAGE_MAP_SIZE                  (IOM_MMIO_PAGE_MAP_ENTRIES * sizeof(uint64_t))
+/** Gets the page map index for an address. */
+#define IOM_MMIO_PAGE_MAP_IDX(a_GCPhys)         ( ((a_GCPhys) >> GUEST_PAGE_SHIFT) & (IOM_MMIO_PAGE_MAP_ENTRIES - 1) )
+/** Makes a page map entry. */
+#define IOM_MMIO_PAGE_MAP_MAKE(a_GCPhys, a_idxLookup) \
+    ( (((uint64_t)(a_GCPhys) >> GUEST_PAGE_SHIFT) << 16) | (uint64_t)((a_idxLookup) + 1) )
+/** @} */
+
 /**
  * Ring-0 MMIO handle table entry.
  */
@@ -224,6 +268,11 @@ typedef struct IOMMMIOENTRYR0
     R0PTRTYPE(PFNIOMMMIONEWREAD)        pfnReadCallback;
     /** Pointer to the fill callback function. */
     R0PTRTYPE(PFNIOMMMIONEWFILL)        pfnFillCallback;
+    /** Pointer to the read callback function called while holding only
+     * pCritSectRw in shared mode, NULL if not used. */
+    R0PTRTYPE(PFNIOMMMIONEWREAD)        pfnReadSharedCallback;
+    /** The read/write critical section for pfnReadSharedCallback. */
+    R0PTRTYPE(PPDMCRITSECTRW)           pCritSectRw;
     /** The entry of the first statistics entry, UINT16_MAX if no stats.
      * @note For simplicity, this is always copied from ring-3 for all entries at
      *       the end of VM creation. */
@@ -258,6 +307,11 @@ typedef struct IOMMMIOENTRYR3
     R3PTRTYPE(PFNIOMMMIONEWREAD)        pfnReadCallback;
     /** Pointer to the fill callback function. */
     R3PTRTYPE(PFNIOMMMIONEWFILL)        pfnFillCallback;
+    /** Pointer to the read callback function called while holding only
+     * pCritSectRw in shared mode, NULL if not used. */
+    R3PTRTYPE(PFNIOMMMIONEWREAD)        pfnReadSharedCallback;
+    /** The read/write critical section for pfnReadSharedCallback. */
+    R3PTRTYPE(PPDMCRITSECTRW)           pCritSectRw;
     /** Description / Name. For easing debugging. */
     R3PTRTYPE(const char *)             pszDesc;
     /** PCI device the registration is associated with. */
@@ -283,7 +337,7 @@ typedef struct IOMMMIOENTRYR3
     /** Same as the handle index. */
     uint16_t                            idxSelf;
 } IOMMMIOENTRYR3;
-AssertCompileSize(IOMMMIOENTRYR3, sizeof(RTGCPHYS) * 2 + 7 * sizeof(RTR3PTR) + 16);
+AssertCompileSize(IOMMMIOENTRYR3, sizeof(RTGCPHYS) * 2 + 9 * sizeof(RTR3PTR) + 16);
 /** Pointer to a ring-3 MMIO handle table entry. */
 typedef IOMMMIOENTRYR3 *PIOMMMIOENTRYR3;
 /** Pointer to a const ring-3 MMIO handle table entry. */
@@ -420,6 +474,8 @@ typedef struct IOM
     R3PTRTYPE(PIOMIOPORTENTRYR3)    paIoPortRegs;
     /** I/O port lookup table. */
     R3PTRTYPE(PIOMIOPORTLOOKUPENTRY) paIoPortLookup;
+    /** I/O port direct lookup table, IOM_IOPORT_DIRECT_ENTRIES entries. */
+    R3PTRTYPE(uint32_t *)           pau32IoPortDirect;
     /** Number of entries in the lookup table. */
     uint32_t                        cIoPortLookupEntries;
     /** Set if I/O port registrations are frozen. */
@@ -450,6 +506,8 @@ typedef struct IOM
     R3PTRTYPE(PIOMMMIOENTRYR3)      paMmioRegs;
     /** MMIO lookup table. */
     R3PTRTYPE(PIOMMMIOLOOKUPENTRY)  paMmioLookup;
+    /** MMIO page map, IOM_MMIO_PAGE_MAP_ENTRIES entries. */
+    R3PTRTYPE(uint64_t volatile *)  pau64MmioPageMap;
     /** Number of entries in the lookup table. */
     uint32_t                        cMmioLookupEntries;
     /** Set if MMIO registrations are frozen. */
@@ -473,6 +531,8 @@ typedef struct IOM
     STAMCOUNTER                     StatIoPortInS;
     STAMCOUNTER                     StatIoPortOutS;
     STAMCOUNTER                     StatIoPortCommits;
+    STAMCOUNTER                     StatIoPortInShared;
+    STAMCOUNTER                     StatIoPortInSharedFallback;
     /** @} */
 
     /** @name MMIO statistics.
@@ -489,6 +549,11 @@ typedef struct IOM
     STAMCOUNTER                     StatMmioStaleMappings;
     STAMCOUNTER                     StatMmioDevLockContentionR0;
     STAMCOUNTER                     StatMmioTooDeepRecursion;
+    STAMCOUNTER                     StatMmioLookupHint;
+    STAMCOUNTER                     StatMmioLookupPageMap;
+    STAMCOUNTER                     StatMmioLookupSearch;
+    STAMCOUNTER                     StatMmioReadShared;
+    STAMCOUNTER                     StatMmioReadSharedFallback;
     /** @} */
 } IOM;
 #ifdef IOM_WITH_CRIT_SECT_RW
@@ -514,6 +579,8 @@ typedef struct IOMR0PERVM
     R0PTRTYPE(PIOMIOPORTENTRYR0)    paIoPortRegs;
     /** I/O port lookup table. */
     R0PTRTYPE(PIOMIOPORTLOOKUPENTRY) paIoPortLookup;
+    /** I/O port direct lookup table. */
+    R0PTRTYPE(uint32_t *)           pau32IoPortDirect;
     /** I/O port registration table for ring-3.
      * Also mapped to ring-3 as IOM::paIoPortRegs. */
     R0PTRTYPE(PIOMIOPORTENTRYR3)    paIoPortRing3Regs;
@@ -547,6 +614,8 @@ typedef struct IOMR0PERVM
     R0PTRTYPE(PIOMMMIOENTRYR0)      paMmioRegs;
     /** MMIO lookup table. */
     R0PTRTYPE(PIOMMMIOLOOKUPENTRY)  paMmioLookup;
+    /** MMIO page map. */
+    R0PTRTYPE(uint64_t volatile *)  pau64MmioPageMap;
     /** MMIO registration table for ring-3.
      * Also mapped to ring-3 as IOM::paMmioRegs. */
     R0PTRTYPE(PIOMMMIOENTRYR3)      paMmioRing3Regs;
@@ -419,6 +419,70 @@ typedef struct PDMDRVINSINT
 } PDMDRVINSINT;
 
 
+/** Number of log2 nanosecond buckets in the critical section contention
+ * profiling histograms (PDMCRITSECTPROF::acWait, PDMCRITSECTPROF::acHold). */
+#define PDMCRITSECTPROF_HIST_BUCKETS        32
+/** Number of owner call sites tracked by PDMCRITSECTPROF. */
+#define PDMCRITSECTPROF_CALLERS             16
+
+/**
+ * Owner call site entry for the critical section contention profiling.
+ */
+typedef struct PDMCRITSECTPROFCALLER
+{
+    /** The return address of the enter API caller, 0 if the entry is free. */
+    RTR3UINTPTR                     uAddr;
+    /** Number of times this call site acquired the section.  This may be an
+     * over estimate when the entry replaced another one, see cErr. */
+    uint64_t                        cEnters;
+    /** The maximum over estimation of cEnters (space-saving top-K). */
+    uint64_t                        cErr;
+    /** Total nanoseconds the section was held when acquired from here. */
+    uint64_t                        cNsHeld;
+    /** Longest hold in nanoseconds when acquired from here. */
+    uint64_t                        cNsHeldMax;
+} PDMCRITSECTPROFCALLER;
+/** Pointer to a critical section profiling call site entry. */
+typedef PDMCRITSECTPROFCALLER *PPDMCRITSECTPROFCALLER;
+
+/**
+ * Ring-3 contention profiling data for a critical section.
+ *
+ * This is allocated for each critical section when /PDM/CritSectProfiling is
+ * enabled (or the 'critsectprof' info handler is asked to enable it) and only
+ * updated by the owner while in ring-3, so no atomic updates are required.
+ */
+typedef struct PDMCRITSECTPROF
+{
+    /** RTTimeNanoTS() when the section was last acquired in ring-3, 0 if not
+     * acquired thru the profiled path. */
+    uint64_t                        nsEnter;
+    /** The aCallers index of the current owner, UINT32_MAX if none. */
+    uint32_t                        idxCallerOwner;
+    uint32_t                        u32Padding;
+    /** Number of profiled (non-nested) enters. */
+    uint64_t                        cEnters;
+    /** Number of profiled enters which found the section owned by another thread. */
+    uint64_t                        cContended;
+    /** Total time spent waiting for the section (contended enters only). */
+    uint64_t                        cNsWaitTotal;
+    /** Longest wait. */
+    uint64_t                        cNsWaitMax;
+    /** Total time the section was held. */
+    uint64_t                        cNsHoldTotal;
+    /** Longest hold. */
+    uint64_t                        cNsHoldMax;
+    /** Wait time histogram, bucket N counts waits in the [2^N, 2^(N+1)) ns range. */
+    uint64_t                        acWait[PDMCRITSECTPROF_HIST_BUCKETS];
+    /** Hold time histogram, same layout as acWait. */
+    uint64_t                        acHold[PDMCRITSECTPROF_HIST_BUCKETS];
+    /** The top owner call sites. */
+    PDMCRITSECTPROFCALLER           aCallers[PDMCRITSECTPROF_CALLERS];
+} PDMCRITSECTPROF;
+/** Pointer to critical section contention profiling data. */
+typedef PDMCRITSECTPROF *PPDMCRITSECTPROF;
+
+
 /**
  * Private critical section data.
  */
@@ -463,6 +527,8 @@ typedef struct PDMCRITSECTINT
     STAMPROFILE                     StatContentionR3Wait;
     /** Profiling the time the section is locked. */
     STAMPROFILEADV                  StatLocked;
+    /** Ring-3 contention profiling data, NULL if not enabled. */
+    R3PTRTYPE(PPDMCRITSECTPROF)     pProfR3;
 } PDMCRITSECTINT;
 AssertCompileMemberAlignment(PDMCRITSECTINT, StatContentionRZLock, 8);
 /** Pointer to private critical section data. */
@@ -524,6 +590,9 @@ typedef struct PDMCRITSECTRWINT
     STAMCOUNTER                         StatR3EnterShared;
     /** Profiling the time the section is write locked. */
     STAMPROFILEADV                      StatWriteLocked;
+    /** Ring-3 contention profiling data for exclusive access, NULL if not
+     * enabled. */
+    R3PTRTYPE(PPDMCRITSECTPROF)         pProfR3;
 } PDMCRITSECTRWINT;
 AssertCompileMemberAlignment(PDMCRITSECTRWINT, StatContentionRZEnterExcl, 8);
 AssertCompileMemberAlignment(PDMCRITSECTRWINT, Core.u, 16);
@@ -1004,6 +1073,14 @@ typedef PDMMOD *PPDMMOD;
 #define PDMQUEUE_MAX_TOTAL_SIZE_R0  _8M
 /** Max total queue item size for ring-3 only queues. */
 #define PDMQUEUE_MAX_TOTAL_SIZE_R3  _32M
+/** Number of PDMQUEUE::aStatLatency buckets (decades starting at 1us). */
+#define PDMQUEUE_LATENCY_BUCKETS    7
+/** Inserts per timer interval at or above which an interval queue switches
+ * to polling (consumer only woken up by the timer). */
+#define PDMQUEUE_POLL_MODE_ENTER    8
+/** Inserts per timer interval at or below which an interval queue switches
+ * back to kicking the consumer on the first insert. */
+#define PDMQUEUE_POLL_MODE_LEAVE    2
 
 /**
  * Queue type.
@@ -1092,11 +1169,35 @@ typedef struct PDMQUEUE
     /** Unique queue name. */
     char                            szName[40];
 
-    /** LIFO of pending items (item index), UINT32_MAX if empty. */
-    uint32_t volatile               iPending;
+    /** Ring producer index (free running), the next ring entry to be claimed
+     * by PDMQueueInsert. */
+    uint32_t volatile               idxRingProducer;
+    /** Ring consumer index (free running), the next ring entry to be processed
+     * by pdmR3QueueFlush.  Only updated by the consumer. */
+    uint32_t volatile               idxRingConsumer;
+    /** Mask for translating ring indexes into entries (number of entries - 1). */
+    uint32_t                        fRingMask;
+    /** Offset of the ring relative to the PDMQUEUE structure.
+     *
+     * The ring is a bounded MPSC FIFO of item indexes plus one, zero meaning the
+     * entry is free or claimed but not yet published.  Producers claim entries by
+     * incrementing idxRingProducer and then publish the item index.  The ring has
+     * at least cItems entries, so since an item can only be in the ring once and
+     * is only freed after its entry has been consumed, it can never overflow. */
+    uint32_t                        offRing;
+    /** Set when the consumer has been kicked and not yet started flushing, so
+     * further inserts do not need to kick it again. */
+    bool volatile                   fKickPending;
+    /** Interval queues only: Set when polling (the timer wakes up the consumer),
+     * clear when inserts kick the consumer.  Adjusted by pdmR3QueueTimer. */
+    bool volatile                   fPollMode;
+    bool                            afPadding[2];
+    /** Interval queues only: Inserts since the last timer tick. */
+    uint32_t volatile               cTimerInserts;
 
     /** State: Pending items. */
     uint32_t volatile               cStatPending;
+    uint32_t                        u32Padding2;
     /** Stat: Times PDMQueueAlloc fails. */
     STAMCOUNTER                     StatAllocFailures;
     /** Stat: PDMQueueInsert calls. */
@@ -1105,14 +1206,20 @@ typedef struct PDMQUEUE
     STAMCOUNTER                     StatFlush;
     /** Stat: Queue flushes with pending items left over. */
     STAMCOUNTER                     StatFlushLeftovers;
+    /** Stat: Inserts that had to wake up the consumer. */
+    STAMCOUNTER                     StatKicks;
+    /** Stat: Interval queue poll/kick mode switches. */
+    STAMCOUNTER                     StatModeSwitches;
     /** State: Profiling the flushing. */
     STAMPROFILE                     StatFlushPrf;
-    uint64_t                        au64Padding[3];
+    /** Stat: Insert to consume latency histogram, decades starting at 1us. */
+    STAMCOUNTER                     aStatLatency[PDMQUEUE_LATENCY_BUCKETS];
+    uint64_t                        au64Padding[7];
 
     /** Allocation bitmap: Set bits means free, clear means allocated. */
     RT_FLEXIBLE_ARRAY_EXTENSION
     uint64_t                        bmAlloc[RT_FLEXIBLE_ARRAY];
-    /* The items follows after the end of the bitmap */
+    /* The ring follows after the end of the bitmap, then the items. */
 } PDMQUEUE;
 AssertCompileMemberAlignment(PDMQUEUE, bmAlloc, 64);
 /** Pointer to a PDM Queue. */
@@ -1659,6 +1766,9 @@ typedef struct PDMUSERPERVM
     R3PTRTYPE(PPDMCRITSECTINT)      pCritSects;
     /** List of initialized read/write critical sections. (LIFO) */
     R3PTRTYPE(PPDMCRITSECTRWINT)    pRwCritSects;
+    /** Set if critical section contention profiling is enabled
+     * (/PDM/CritSectProfiling). */
+    bool                            fCritSectProfiling;
     /** Head of the PDM Thread list. (singly linked) */
     R3PTRTYPE(PPDMTHREAD)           pThreads;
     /** Tail of the PDM Thread list. (singly linked) */
@@ -1755,6 +1865,8 @@ int         pdmR3CritSectRwInitDeviceAuto(  PVM pVM, PPDMDEVINS pDevIns, PPDMCRI
                                             const char *pszNameFmt, ...);
 int         pdmR3CritSectRwInitDriver(      PVM pVM, PPDMDRVINS pDrvIns, PPDMCRITSECTRW pCritSect, RT_SRC_POS_DECL,
                                             const char *pszNameFmt, ...);
+void        pdmR3CritSectProfEntered(PPDMCRITSECTPROF pProf, uintptr_t uCaller, uint64_t nsStartWait);
+void        pdmR3CritSectProfLeaving(PPDMCRITSECTPROF pProf);
 
 int         pdmR3DevInit(PVM pVM);
 int         pdmR3DevInitComplete(PVM pVM);
@@ -1781,7 +1893,9 @@ char       *pdmR3FileR3(const char *pszFile, bool fShared);
 int         pdmR3LoadR3U(PUVM pUVM, const char *pszFilename, const char *pszName);
 #endif /* IN_RING3 */
 
-void        pdmQueueInit(PPDMQUEUE pQueue, uint32_t cbBitmap, uint32_t cbItem, uint32_t cItems,
+void        pdmQueueCalcLayout(uint32_t cItems, uint32_t *pcbBitmap, uint32_t *pcbRing);
+bool        pdmQueueIsPending(PPDMQUEUE pQueue);
+void        pdmQueueInit(PPDMQUEUE pQueue, uint32_t cbBitmap, uint32_t cbRing, uint32_t cbItem, uint32_t cItems,
                          const char *pszName, PDMQUEUETYPE enmType, RTR3PTR pfnCallback, RTR3PTR pvOwner);
 
 #ifdef IN_RING3
@@ -1863,12 +1977,16 @@ DECL_HIDDEN_CALLBACK(int)  pdmR3DevHlpTracing_IoPortCreateEx(PPDMDEVINS pDevIns,
                                                              const char *pszDesc, PCIOMIOPORTDESC paExtDescs, PIOMIOPORTHANDLE phIoPorts);
 DECL_HIDDEN_CALLBACK(int)  pdmR3DevHlpTracing_IoPortMap(PPDMDEVINS pDevIns, IOMIOPORTHANDLE hIoPorts, RTIOPORT Port);
 DECL_HIDDEN_CALLBACK(int)  pdmR3DevHlpTracing_IoPortUnmap(PPDMDEVINS pDevIns, IOMIOPORTHANDLE hIoPorts);
+DECL_HIDDEN_CALLBACK(int)  pdmR3DevHlpTracing_IoPortSetInShared(PPDMDEVINS pDevIns, IOMIOPORTHANDLE hIoPorts,
+                                                                PPDMCRITSECTRW pCritSectRw, PFNIOMIOPORTNEWIN pfnInShared);
 DECL_HIDDEN_CALLBACK(int)  pdmR3DevHlpTracing_MmioCreateEx(PPDMDEVINS pDevIns, RTGCPHYS cbRegion,
                                                            uint32_t fFlags, PPDMPCIDEV pPciDev, uint32_t iPciRegion,
                                                            PFNIOMMMIONEWWRITE pfnWrite, PFNIOMMMIONEWREAD pfnRead, PFNIOMMMIONEWFILL pfnFill,
                                                            void *pvUser, const char *pszDesc, PIOMMMIOHANDLE phRegion);
 DECL_HIDDEN_CALLBACK(int)  pdmR3DevHlpTracing_MmioMap(PPDMDEVINS pDevIns, IOMMMIOHANDLE hRegion, RTGCPHYS GCPhys);
 DECL_HIDDEN_CALLBACK(int)  pdmR3DevHlpTracing_MmioUnmap(PPDMDEVINS pDevIns, IOMMMIOHANDLE hRegion);
+DECL_HIDDEN_CALLBACK(int)  pdmR3DevHlpTracing_MmioSetReadShared(PPDMDEVINS pDevIns, IOMMMIOHANDLE hRegion,
+                                                                PPDMCRITSECTRW pCritSectRw, PFNIOMMMIONEWREAD pfnReadShared);
 DECL_HIDDEN_CALLBACK(int)  pdmR3DevHlpTracing_PhysRead(PPDMDEVINS pDevIns, RTGCPHYS GCPhys, void *pvBuf, size_t cbRead, uint32_t fFlags);
 DECL_HIDDEN_CALLBACK(int)  pdmR3DevHlpTracing_PhysWrite(PPDMDEVINS pDevIns, RTGCPHYS GCPhys, const void *pvBuf, size_t cbWrite, uint32_t fFlags);
 DECL_HIDDEN_CALLBACK(int)  pdmR3DevHlpTracing_PCIPhysRead(PPDMDEVINS pDevIns, PPDMPCIDEV pPciDev, RTGCPHYS GCPhys, void *pvBuf, size_t cbRead, uint32_t fFlags);
@@ -1882,8 +2000,12 @@ DECL_HIDDEN_CALLBACK(int)  pdmR0DevHlpTracing_IoPortSetUpContextEx(PPDMDEVINS pD
                                                                    PFNIOMIOPORTNEWOUT pfnOut, PFNIOMIOPORTNEWIN pfnIn,
                                                                    PFNIOMIOPORTNEWOUTSTRING pfnOutStr, PFNIOMIOPORTNEWINSTRING pfnInStr,
                                                                    void *pvUser);
+DECL_HIDDEN_CALLBACK(int)  pdmR0DevHlpTracing_IoPortSetInShared(PPDMDEVINS pDevIns, IOMIOPORTHANDLE hIoPorts,
+                                                                PPDMCRITSECTRW pCritSectRw, PFNIOMIOPORTNEWIN pfnInShared);
 DECL_HIDDEN_CALLBACK(int)  pdmR0DevHlpTracing_MmioSetUpContextEx(PPDMDEVINS pDevIns, IOMMMIOHANDLE hRegion, PFNIOMMMIONEWWRITE pfnWrite,
                                                                  PFNIOMMMIONEWREAD pfnRead, PFNIOMMMIONEWFILL pfnFill, void *pvUser);
+DECL_HIDDEN_CALLBACK(int)  pdmR0DevHlpTracing_MmioSetReadShared(PPDMDEVINS pDevIns, IOMMMIOHANDLE hRegion,
+                                                                PPDMCRITSECTRW pCritSectRw, PFNIOMMMIONEWREAD pfnReadShared);
 DECL_HIDDEN_CALLBACK(int)  pdmR0DevHlpTracing_PhysRead(PPDMDEVINS pDevIns, RTGCPHYS GCPhys, void *pvBuf, size_t cbRead, uint32_t fFlags);
 DECL_HIDDEN_CALLBACK(int)  pdmR0DevHlpTracing_PhysWrite(PPDMDEVINS pDevIns, RTGCPHYS GCPhys, const void *pvBuf, size_t cbWrite, uint32_t fFlags);
 DECL_HIDDEN_CALLBACK(int)  pdmR0DevHlpTracing_PCIPhysRead(PPDMDEVINS pDevIns, PPDMPCIDEV pPciDev, RTGCPHYS GCPhys, void *pvBuf, size_t cbRead, uint32_t fFlags);
@@ -3089,10 +3089,10 @@ typedef struct PGM
     bool                            fZeroRamPagesOnReset;
     /** Large page enabled flag. */
     bool                            fUseLargePages;
+    /** Whether to periodically coalesce 4 KB backed RAM into large pages. */
+    bool                            fLargePageCoalescing;
     /** Alignment padding. */
 #ifndef VBOX_WITH_PGM_NEM_MODE
-    bool                            afAlignment2[2];
-#else
     bool                            afAlignment2[1];
 #endif
     /** The host paging mode. (This is what SUPLib reports.) */
@@ -3205,7 +3205,37 @@ typedef struct PGM
     uint64_t                        nsLargePageRetry;
     /** Number of repeated long allocation times.   */
     uint32_t                        cLargePageLongAllocRepeats;
-    uint32_t                        uPadding4;
+    /** Max number of 2 MB ranges to coalesce per pass. */
+    uint32_t                        cLargePageCoalesceMaxRanges;
+    /** Interval between coalescing passes, in milliseconds. */
+    uint32_t                        cMsLargePageCoalesceInterval;
+    /** The ratio of guest RAM backed by enabled large pages, in percent.
+     * Updated by each coalescing pass. */
+    uint32_t                        uLargePageRatioPct;
+    /** Where the next coalescing pass should resume its scan. */
+    RTGCPHYS                        GCPhysLargePageCoalesceNext;
+    /** Timer triggering the coalescing passes. */
+    TMTIMERHANDLE                   hLargePageCoalesceTimer;
+
+    /** @name Host-side duplicate page merging (PGMSharedPage.cpp).
+     * @{ */
+    /** Whether the duplicate page scanner is enabled. */
+    bool                            fPageDedup;
+    bool                            afPageDedupPadding[3];
+    /** Interval between scanner passes, in milliseconds. */
+    uint32_t                        cMsPageDedupInterval;
+    /** The CPU time budget of the scanner, in percent of the interval. */
+    uint32_t                        uPageDedupCpuPct;
+    /** The number of pages to scan in the next pass, adjusted to fit the budget. */
+    uint32_t                        cPageDedupPagesPerPass;
+    /** Where the next scanner pass should resume. */
+    RTGCPHYS                        GCPhysPageDedupNext;
+    /** Timer triggering the scanner passes. */
+    TMTIMERHANDLE                   hPageDedupTimer;
+    /** Per RAM range page hashes from the previous pass, indexed by RAM range ID
+     * (PGM_MAX_RAM_RANGES entries, ring-3 only). */
+    R3PTRTYPE(struct PGMPAGEDEDUPRANGE *) paPageDedupRangesR3;
+    /** @} */
 
     /**
      * Live save data.
@@ -3288,8 +3318,17 @@ typedef struct PGM
     STAMCOUNTER                     StatLargePageRecheck;   /**< The number of times we rechecked a disabled large page.*/
     STAMCOUNTER                     StatLargePageTlbFlush;  /**< The number of a full VCPU TLB flush was required after allocation. */
     STAMCOUNTER                     StatLargePageZeroEvict; /**< The number of zero page mappings we had to evict when allocating a large page. */
+    STAMCOUNTER                     StatLargePageCoalesced; /**< The number of 2 MB ranges coalesced into large pages. */
+    STAMCOUNTER                     StatLargePageCoalesceFailed; /**< The number of failed coalescing attempts. */
+    STAMPROFILE                     StatLargePageCoalesce;  /**< Profiles the coalescing passes. */
 
     STAMPROFILE                     StatShModCheck;         /**< Profiles shared module checks. */
+    STAMCOUNTER                     StatPageDedupScanned;   /**< The number of pages hashed by the duplicate page scanner. */
+    STAMCOUNTER                     StatPageDedupIdle;      /**< The number of unchanged pages submitted for merging. */
+    STAMCOUNTER                     StatPageDedupMerged;    /**< The number of pages merged with an identical shared page. */
+    STAMCOUNTER                     StatPageDedupConverted; /**< The number of pages converted into shared pages to merge with. */
+    STAMCOUNTER                     StatPageDedupBroken;    /**< The number of shared pages replaced by private copies on write. */
+    STAMPROFILE                     StatPageDedup;          /**< Profiles the duplicate page scanner passes. */
 
     STAMPROFILE                     StatMmio2QueryAndResetDirtyBitmap; /**< Profiling PGMR3PhysMmio2QueryAndResetDirtyBitmap. */
     /** @} */
@@ -3893,6 +3932,7 @@ int             pgmR0PhysAllocateHandyPages(PGVM pGVM, VMCPUID idCpu, bool fRing
 int             pgmR0PhysAllocateLargePage(PGVM pGVM, VMCPUID idCpu, RTGCPHYS GCPhys);
 #endif
 int             pgmPhysRecheckLargePage(PVMCC pVM, RTGCPHYS GCPhys, PPGMPAGE pLargePage);
+int             pgmPhysIsCoalescableLargePageRange(PVMCC pVM, RTGCPHYS GCPhys, uint32_t *pcAllocated);
 int             pgmPhysPageLoadIntoTlb(PVMCC pVM, RTGCPHYS GCPhys);
 int             pgmPhysPageLoadIntoTlbWithPage(PVMCC pVM, PPGMPAGE pPage, RTGCPHYS GCPhys);
 #ifdef IN_RING3
@@ -3950,6 +3990,8 @@ int             pgmR3PhysRamReset(PVM pVM);
 int             pgmR3PhysRomReset(PVM pVM);
 int             pgmR3PhysRamZeroAll(PVM pVM);
 int             pgmR3PhysChunkMap(PVM pVM, uint32_t idChunk, PPPGMCHUNKR3MAP ppChunk);
+int             pgmR3PhysLargePageCoalesceInit(PVM pVM);
+int             pgmR3PageDedupInit(PVM pVM);
 int             pgmR3PhysRamTerm(PVM pVM);
 void            pgmR3PhysRomTerm(PVM pVM);
 void            pgmR3PhysAssertSharedPageChecksums(PVM pVM);
@@ -3972,6 +4014,7 @@ void            pgmPoolFree(PVM pVM, RTHCPHYS HCPhys, uint16_t iUser, uint32_t i
 void            pgmPoolFreeByPage(PPGMPOOL pPool, PPGMPOOLPAGE pPage, uint16_t iUser, uint32_t iUserTable);
 int             pgmPoolFlushPage(PPGMPOOL pPool, PPGMPOOLPAGE pPage, bool fFlush = true /* DO NOT USE false UNLESS YOU KNOWN WHAT YOU'RE DOING!! */);
 void            pgmPoolFlushPageByGCPhys(PVM pVM, RTGCPHYS GCPhys);
+uint32_t        pgmPoolFlushPhysPTsFor2MRange(PVMCC pVM, RTGCPHYS GCPhys2M);
 PPGMPOOLPAGE    pgmPoolGetPage(PPGMPOOL pPool, RTHCPHYS HCPhys);
 PPGMPOOLPAGE    pgmPoolQueryPageForDbg(PPGMPOOL pPool, RTHCPHYS HCPhys);
 int             pgmPoolHCPhys2Ptr(PVM pVM, RTHCPHYS HCPhys, void **ppv);
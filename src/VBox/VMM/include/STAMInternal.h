@@ -191,8 +191,10 @@ typedef struct STAMUSERPERVM
     /** The number of registered host CPU leaves. */
     uint32_t                cRegisteredHostCpus;
 
-    /** Explicit alignment padding. */
-    uint32_t                uAlignment;
+    /** Registration generation, incremented whenever a sample is registered
+     * or deregistered.  Used by the exporters to detect stale descriptor
+     * caches.  Only modified while owning the write lock. */
+    uint32_t volatile       uGeneration;
     /** The copy of the GMM statistics. */
     GMMSTATS                GMMStats;
 } STAMUSERPERVM;
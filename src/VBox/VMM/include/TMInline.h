@@ -135,6 +135,88 @@ DECLINLINE(void) tmTimerSetNext(PTMTIMERQUEUECC pQueueCC, PTMTIMER pTimer, PTMTI
 }
 
 
+/**
+ * Validates an active list hint (TMTIMERQUEUE::aidxWheel,
+ * TMTIMERQUEUE::idxActiveTail).
+ *
+ * @returns Pointer to the hinted timer if it is linked into the active list,
+ *          has a stable state and does not expire after @a u64Expire.  NULL
+ *          if the hint cannot be used.
+ * @param   pQueueCC    The context specific queue data (same as @a pQueue for
+ *                      ring-3).
+ * @param   pQueue      The shared timer queue data.
+ * @param   idxHint     The hint to validate.
+ * @param   u64Expire   The expire time of the timer being inserted.
+ *
+ * @remarks Called while owning the relevant queue lock.
+ */
+DECLINLINE(PTMTIMER) tmTimerQueueValidateHint(PTMTIMERQUEUECC pQueueCC, PTMTIMERQUEUE pQueue, uint32_t idxHint, uint64_t u64Expire)
+{
+    if (idxHint - 1U < pQueueCC->cTimersAlloc - 1U)
+    {
+        PTMTIMER const pHint = &pQueueCC->paTimers[idxHint];
+        if (pHint->idxPrev != UINT32_MAX || tmTimerQueueGetHead(pQueueCC, pQueue) == pHint)
+        {
+            /* Read the expire time before the state, as TMTimerSet changes the
+               state before updating the expire time of an active timer. */
+            uint64_t const u64HintExpire = ASMAtomicReadU64(&pHint->u64Expire);
+            if (   u64HintExpire <= u64Expire
+                && ASMAtomicReadU32((uint32_t volatile *)&pHint->enmState) == TMTIMERSTATE_ACTIVE)
+                return pHint;
+        }
+    }
+    return NULL;
+}
+
+
+/**
+ * Unlinks a timer from the active list, no state assertions.
+ *
+ * This also drops any active list hints referring to the timer.
+ *
+ * @returns true if the head of the list changed, false if not.
+ * @param   pQueueCC    The context specific queue data (same as @a pQueue for
+ *                      ring-3).
+ * @param   pQueue      The shared timer queue data.
+ * @param   pTimer      The timer that needs unlinking.
+ *
+ * @remarks Called while owning the relevant queue lock.
+ */
+DECL_FORCE_INLINE(bool) tmTimerQueueUnlinkActiveWorker(PTMTIMERQUEUECC pQueueCC, PTMTIMERQUEUE pQueue, PTMTIMER pTimer)
+{
+    uint32_t const idxTimer = (uint32_t)(pTimer - &pQueueCC->paTimers[0]);
+    const PTMTIMER pPrev    = tmTimerGetPrev(pQueueCC, pTimer);
+    const PTMTIMER pNext    = tmTimerGetNext(pQueueCC, pTimer);
+    if (pPrev)
+        tmTimerSetNext(pQueueCC, pPrev, pNext);
+    else
+    {
+        tmTimerQueueSetHead(pQueueCC, pQueue, pNext);
+        pQueue->u64Expire = pNext ? pNext->u64Expire : INT64_MAX;
+    }
+    if (pNext)
+        tmTimerSetPrev(pQueueCC, pNext, pPrev);
+    else if (pQueue->idxActiveTail == idxTimer)
+        pQueue->idxActiveTail = pTimer->idxPrev;
+
+    /* Hand the wheel slots over to the predecessor if it falls into the same
+       slot, otherwise clear them.  Slots the timer claimed with a since
+       modified expire time are left behind and weeded out on lookup. */
+    uint64_t const u64Expire = pTimer->u64Expire;
+    unsigned       cShift    = pQueue->cWheelShift;
+    for (unsigned iLevel = 0; iLevel < TMTIMERQUEUE_WHEEL_LEVELS; iLevel++, cShift += TMTIMERQUEUE_WHEEL_SLOTS_SHIFT)
+    {
+        uint32_t * const pidxSlot = &pQueue->aidxWheel[iLevel][(u64Expire >> cShift) & (TMTIMERQUEUE_WHEEL_SLOTS - 1)];
+        if (*pidxSlot == idxTimer)
+            *pidxSlot = pPrev && (pPrev->u64Expire >> cShift) == (u64Expire >> cShift) ? pTimer->idxPrev : UINT32_MAX;
+    }
+
+    pTimer->idxNext = UINT32_MAX;
+    pTimer->idxPrev = UINT32_MAX;
+    return pPrev == NULL;
+}
+
+
 /**
  * Used to unlink a timer from the active list.
  *
@@ -156,20 +238,8 @@ DECL_FORCE_INLINE(void) tmTimerQueueUnlinkActive(PVMCC pVM, PTMTIMERQUEUECC pQue
 #endif
     RT_NOREF(pVM);
 
-    const PTMTIMER pPrev = tmTimerGetPrev(pQueueCC, pTimer);
-    const PTMTIMER pNext = tmTimerGetNext(pQueueCC, pTimer);
-    if (pPrev)
-        tmTimerSetNext(pQueueCC, pPrev, pNext);
-    else
-    {
-        tmTimerQueueSetHead(pQueueCC, pQueue, pNext);
-        pQueue->u64Expire = pNext ? pNext->u64Expire : INT64_MAX;
+    if (tmTimerQueueUnlinkActiveWorker(pQueueCC, pQueue, pTimer))
         DBGFTRACE_U64_TAG(pVM, pQueue->u64Expire, "tmTimerQueueUnlinkActive");
-    }
-    if (pNext)
-        tmTimerSetPrev(pQueueCC, pNext, pPrev);
-    pTimer->idxNext = UINT32_MAX;
-    pTimer->idxPrev = UINT32_MAX;
 }
 
 /** @def TMTIMER_HANDLE_TO_VARS_RETURN_EX
@@ -271,6 +271,20 @@ AssertCompileSizeAlignment(TMTIMER, 64);
 #endif
 
 
+/** @name Timer wheel hint configuration for TMTIMERQUEUE::aidxWheel.
+ * @{ */
+/** Number of levels in the timer wheel. */
+#define TMTIMERQUEUE_WHEEL_LEVELS       2
+/** Number of slots per wheel level (power of two). */
+#define TMTIMERQUEUE_WHEEL_SLOTS        32
+/** The log2 of TMTIMERQUEUE_WHEEL_SLOTS. */
+#define TMTIMERQUEUE_WHEEL_SLOTS_SHIFT  5
+/** Number of slots probed backwards per level when looking up a hint. */
+#define TMTIMERQUEUE_WHEEL_PROBES       8
+/** Default level 0 slot width shift for nanosecond and TSC tick clocks (~65us). */
+#define TMTIMERQUEUE_WHEEL_SHIFT_NS     16
+/** @} */
+
 /**
  * A timer queue, shared.
  */
@@ -311,8 +325,10 @@ typedef struct TMTIMERQUEUE
     bool volatile           fBeingProcessed;
     /** Set if we've disabled growing. */
     bool                    fCannotGrow;
+    /** The log2 of the level 0 timer wheel slot width (in enmClock ticks). */
+    uint8_t                 cWheelShift;
     /** Align on 64-byte boundrary. */
-    bool                    afAlignment1[2];
+    bool                    fAlignment1;
     /** The current max timer Hz hint. */
     uint32_t volatile       uMaxHzHint;
 
@@ -326,7 +342,33 @@ typedef struct TMTIMERQUEUE
     SUPSEMEVENT             hWorkerEvt;
     /** Absolute sleep deadline for the worker (enmClock time). */
     uint64_t volatile       tsWorkerWakeup;
-    uint64_t                u64Alignment2;
+    /** Hint: The last timer in the active list, UINT32_MAX if none. */
+    uint32_t                idxActiveTail;
+    uint32_t                u32Alignment2;
+
+    /** Timer wheel hints for tmTimerQueueLinkActive.
+     *
+     * This indexes the sorted active list by expire time so insertion can start
+     * walking next to where the timer belongs instead of at the head of the list.
+     * Level 0 slots are 2^cWheelShift clock ticks wide, each higher level is
+     * TMTIMERQUEUE_WHEEL_SLOTS times wider.  An entry is the index of the latest
+     * expiring active timer seen for the slot, or UINT32_MAX.  Entries are only
+     * hints and are validated before use, so stale ones just cost a lookup. */
+    uint32_t                aidxWheel[TMTIMERQUEUE_WHEEL_LEVELS][TMTIMERQUEUE_WHEEL_SLOTS];
+
+    /** tmTimerQueueLinkActive: Inserted at the head of the list. */
+    STAMCOUNTER             StatLinkHead;
+    /** tmTimerQueueLinkActive: Walk started at the tail hint. */
+    STAMCOUNTER             StatLinkTail;
+    /** tmTimerQueueLinkActive: Walk started at a timer wheel hint. */
+    STAMCOUNTER             StatLinkWheel;
+    /** tmTimerQueueLinkActive: No usable hint, walked from the head. */
+    STAMCOUNTER             StatLinkScan;
+    /** tmTimerQueueLinkActive: Number of list entries walked. */
+    STAMCOUNTER             StatLinkSteps;
+    /** Number of expired timers delivered by the queue runners. */
+    STAMCOUNTER             StatRunExpired;
+    uint64_t                au64Alignment3[2];
 
     /** Lock serializing the active timer list and associated work. */
     PDMCRITSECT             TimerLock;
@@ -154,12 +154,28 @@ typedef enum
     VMHALTMETHOD_1,
     /** The first go at a more global approach. */
     VMHALTMETHOD_GLOBAL_1,
+    /** Spin, yield or block depending on the learned idle period distribution. */
+    VMHALTMETHOD_ADAPTIVE,
     /** The end of valid methods. (not inclusive of course) */
     VMHALTMETHOD_END,
     /** The usual 32-bit max value. */
     VMHALTMETHOD_32BIT_HACK = 0x7fffffff
 } VMHALTMETHOD;
 
+/** Number of log2 buckets in the adaptive halt method histograms.
+ * Bucket 0 is for periods below 1us, bucket i covers [2^(i-1), 2^i) us and the
+ * last one everything from 16ms and up. */
+#define VMHALT_ADAPTIVE_BUCKETS     16
+
+/** Adaptive halt method tuning profiles. */
+typedef enum VMHALTADAPTIVEPROFILE
+{
+    /** Favour low wake-up latency, spending host CPU on spinning. */
+    VMHALTADAPTIVEPROFILE_LATENCY = 0,
+    /** Favour giving the host CPU back (overcommitted hosts). */
+    VMHALTADAPTIVEPROFILE_DENSITY
+} VMHALTADAPTIVEPROFILE;
+
 
 /**
  * VM Internal Data (part of the VM structure).
@@ -325,6 +341,28 @@ typedef struct VMINTUSERPERVM
             /** The threshold between spinning and blocking. */
             uint32_t                cNsSpinBlockThresholdCfg;
         }                           Global1;
+
+       /**
+        * Adaptive - Spin, then yield, then block, with the spin+yield window
+        * picked from the per-vCPU idle period histogram so that the expected
+        * cost of burning CPU and of a blocking wake-up is minimal.
+        */
+        struct
+        {
+            /** The tuning profile. */
+            VMHALTADAPTIVEPROFILE   enmProfileCfg;
+            /** Upper limit for the spin+yield window (ns). */
+            uint32_t                cNsSpinMaxCfg;
+            /** How much of the window is spent busy spinning before switching
+             *  to yielding (ns). */
+            uint32_t                cNsYieldAfterCfg;
+            /** Initial estimate of the blocking wake-up latency (ns). */
+            uint32_t                cNsBlockCostCfg;
+            /** Cost weight of a nanosecond spent spinning or yielding. */
+            uint32_t                uBurnWeightCfg;
+            /** Cost weight of a nanosecond of wake-up latency. */
+            uint32_t                uLatencyWeightCfg;
+        }                           Adaptive;
     }                               Halt;
 
     /** Pointer to the DBGC instance data. */
@@ -452,6 +490,27 @@ typedef struct VMINTUSERPERVMCPU
            uint64_t                 u64StartSpinTS;
        }                            Method34;
 # endif
+
+       /**
+        * Adaptive - see VMINTUSERPERVM::Halt::Adaptive.
+        */
+        struct
+        {
+            /** Set while the halt loop is spinning or yielding and polling the
+             *  FFs itself, so notifiers can skip signalling EventSemWait. */
+            bool volatile           fSpinning;
+            bool                    afAlignment[3];
+            /** Halts until the spin window is recalculated. */
+            uint32_t                cHaltsUntilUpdate;
+            /** The current spin+yield window (ns). */
+            uint64_t                cNsSpin;
+            /** Running average of the blocking wake-up latency (ns). */
+            uint64_t                cNsWakeLatencyAvg;
+            /** RTTimeNanoTS of the first wake-up signal while blocking, 0 if none. */
+            uint64_t volatile       u64WakeupTS;
+            /** Decaying idle period histogram the spin window is derived from. */
+            uint32_t                au32IdleWeights[VMHALT_ADAPTIVE_BUCKETS];
+        }                           Adaptive;
     }                               Halt;
 
     /** Profiling the halted state; yielding vs blocking.
@@ -464,9 +523,23 @@ typedef struct VMINTUSERPERVMCPU
     STAMPROFILE                     StatHaltTimers;
     STAMPROFILE                     StatHaltPoll;
     /** @} */
+
+    /** Adaptive halt method statistics.
+     * @{ */
+    STAMCOUNTER                     StatHaltAdaptiveWokeSpinning;
+    STAMCOUNTER                     StatHaltAdaptiveWokeYielding;
+    STAMCOUNTER                     StatHaltAdaptiveWokeBlocked;
+    STAMCOUNTER                     StatHaltAdaptiveNotifySkipped;
+    STAMPROFILE                     StatHaltAdaptiveSpin;
+    /** Idle period histogram (halt entry to wake-up). */
+    STAMCOUNTER                     aStatHaltAdaptiveIdle[VMHALT_ADAPTIVE_BUCKETS];
+    /** Blocking wake-up latency histogram (signal to running). */
+    STAMCOUNTER                     aStatHaltAdaptiveWakeLatency[VMHALT_ADAPTIVE_BUCKETS];
+    /** @} */
 } VMINTUSERPERVMCPU;
 AssertCompileMemberAlignment(VMINTUSERPERVMCPU, u64HaltsStartTS, 8);
 AssertCompileMemberAlignment(VMINTUSERPERVMCPU, Halt.Method12.cNSBlockedTooLongAvg, 8);
+AssertCompileMemberAlignment(VMINTUSERPERVMCPU, Halt.Adaptive.cNsSpin, 8);
 AssertCompileMemberAlignment(VMINTUSERPERVMCPU, StatHaltYield, 8);
 
 /** Pointer to the VM internal data kept in the UVM. */
@@ -52,6 +52,9 @@
 #include <iprt/vfs.h>
 #include <iprt/zip.h>
 #include <VBox/version.h>
+#ifdef RT_ARCH_AMD64
+# include <xmmintrin.h> /* _mm_getcsr, _mm_setcsr */
+#endif
 
 #include "tstIEMAImpl.h"
 
@@ -4609,6 +4612,98 @@ static void FpuBinaryR80Test(void)
 }
 
 
+/*
+ * FADD, FSUB, FMUL and FDIV with operands fitting the host double fast path,
+ * checking that neither the guest rounding mode nor the host MXCSR (which can
+ * hold the guest's while native TBs run) affect the outcome, and that the host
+ * MXCSR is left alone.
+ *
+ * The reference is the same operation with PE unmasked, which makes it go the
+ * SoftFloat way and only adds ES and B to the FSW when PE is raised.
+ */
+static void FpuBinaryR80HostMxcsrTest(void)
+{
+    if (!SubTestAndCheckIfEnabled("fpu-binary-r80-host-mxcsr"))
+        return;
+#ifdef RT_ARCH_AMD64
+    static struct { const char *pszName; PFNIEMAIMPLFPUR80 pfn; } const s_aFns[] =
+    {
+        { "fadd",  iemAImpl_fadd_r80_by_r80  },
+        { "fsub",  iemAImpl_fsub_r80_by_r80  },
+        { "fsubr", iemAImpl_fsubr_r80_by_r80 },
+        { "fmul",  iemAImpl_fmul_r80_by_r80  },
+        { "fdiv",  iemAImpl_fdiv_r80_by_r80  },
+        { "fdivr", iemAImpl_fdivr_r80_by_r80 },
+    };
+    static uint16_t const s_afFcwRc[] = { X86_FCW_RC_NEAREST, X86_FCW_RC_DOWN, X86_FCW_RC_UP, X86_FCW_RC_ZERO };
+    static uint32_t const s_afMxcsr[] =
+    {
+        X86_MXCSR_XCPT_MASK | X86_MXCSR_RC_NEAREST,
+        X86_MXCSR_XCPT_MASK | X86_MXCSR_RC_DOWN,
+        X86_MXCSR_XCPT_MASK | X86_MXCSR_RC_UP,
+        X86_MXCSR_XCPT_MASK | X86_MXCSR_RC_ZERO,
+        X86_MXCSR_XCPT_MASK | X86_MXCSR_RC_UP | X86_MXCSR_FZ | X86_MXCSR_DAZ,
+        X86_MXCSR_XCPT_MASK | X86_MXCSR_RC_ZERO | X86_MXCSR_PE | X86_MXCSR_UE,  /* sticky flags set */
+        X86_MXCSR_RC_NEAREST,                                                   /* all exceptions unmasked */
+    };
+
+    uint32_t const fMxcsrOrg = _mm_getcsr();
+    X86FXSTATE     State;
+    RT_ZERO(State);
+    for (uint32_t iTest = 0; iTest < 1024; iTest++)
+    {
+        /* Operands with at most 53 significant bits and exponents within the fast path range. */
+        RTFLOAT80U InVal1, InVal2;
+        InVal1.s.fSign     = RandU64() & 1;
+        InVal1.s.uMantissa = (RandU64() | RT_BIT_64(63)) & ~(RT_BIT_64(11) - 1);
+        InVal1.s.uExponent = (uint16_t)(RTFLOAT80U_EXP_BIAS + (int32_t)RTRandU32Ex(0, 128) - 64);
+        InVal2.s.fSign     = RandU64() & 1;
+        InVal2.s.uMantissa = (RandU64() | RT_BIT_64(63)) & ~(RT_BIT_64(11) - 1);
+        InVal2.s.uExponent = (uint16_t)(iTest & 1 ? InVal1.s.uExponent + (int32_t)RTRandU32Ex(0, 8) - 4 /* cancellation */
+                                                  : RTFLOAT80U_EXP_BIAS + (int32_t)RTRandU32Ex(0, 896) - 448);
+
+        for (size_t iFn = 0; iFn < RT_ELEMENTS(s_aFns); iFn++)
+            for (size_t iRc = 0; iRc < RT_ELEMENTS(s_afFcwRc); iRc++)
+            {
+                uint16_t const fFcw = X86_FCW_PC_53 | s_afFcwRc[iRc] | X86_FCW_XCPT_MASK;
+                IEMFPURESULT   ResRef = { RTFLOAT80U_INIT(0, 0, 0), 0 };
+                State.FCW = fFcw & ~X86_FCW_PM;
+                State.FSW = 0;
+                s_aFns[iFn].pfn(&State, &ResRef, &InVal1, &InVal2);
+                ResRef.FSW &= ~(X86_FSW_ES | X86_FSW_B);
+
+                for (size_t iMxcsr = 0; iMxcsr < RT_ELEMENTS(s_afMxcsr); iMxcsr++)
+                {
+                    IEMFPURESULT Res = { RTFLOAT80U_INIT(0, 0, 0), 0 };
+                    State.FCW = fFcw;
+                    State.FSW = 0;
+                    _mm_setcsr(s_afMxcsr[iMxcsr]);
+                    s_aFns[iFn].pfn(&State, &Res, &InVal1, &InVal2);
+                    uint32_t const fMxcsrAfter = _mm_getcsr();
+                    _mm_setcsr(fMxcsrOrg);
+
+                    if (   Res.FSW != ResRef.FSW
+                        || !RTFLOAT80U_ARE_IDENTICAL(&Res.r80Result, &ResRef.r80Result))
+                        RTTestFailed(g_hTest, "%s #%04u: fcw=%#06x mxcsr=%#x in1=%s in2=%s\n"
+                                              "                -> fsw=%#06x    %s\n"
+                                              "              expected %#06x    %s%s%s\n",
+                                     s_aFns[iFn].pszName, iTest, fFcw, s_afMxcsr[iMxcsr],
+                                     FormatR80(&InVal1), FormatR80(&InVal2),
+                                     Res.FSW, FormatR80(&Res.r80Result),
+                                     ResRef.FSW, FormatR80(&ResRef.r80Result), FswDiff(Res.FSW, ResRef.FSW),
+                                     !RTFLOAT80U_ARE_IDENTICAL(&Res.r80Result, &ResRef.r80Result) ? " - val" : "");
+                    if (fMxcsrAfter != s_afMxcsr[iMxcsr])
+                        RTTestFailed(g_hTest, "%s #%04u: fcw=%#06x: host mxcsr changed from %#x to %#x\n",
+                                     s_aFns[iFn].pszName, iTest, fFcw, s_afMxcsr[iMxcsr], fMxcsrAfter);
+                }
+            }
+    }
+#else
+    RTTestSkipped(g_hTest, "AMD64 only");
+#endif
+}
+
+
 /*
  * Binary FPU operations on one 80-bit floating point value and one 64-bit or 32-bit one.
  */
@@ -10206,6 +10301,7 @@ int main(int argc, char **argv)
         GROUP_ENTRY(CATEGORY_FPU_LD_ST,     FpuStMem,               "tstIEMAImplDataFpuLdSt-%s.bin.gz", 384), /* needs better coverage */
 
         GROUP_ENTRY(CATEGORY_FPU_BINARY_1,  FpuBinaryR80,           "tstIEMAImplDataFpuBinary1-%s.bin.gz", 0),
+        GROUP_ENTRY_MANUAL(CATEGORY_FPU_BINARY_1, FpuBinaryR80HostMxcsr),
         GROUP_ENTRY(CATEGORY_FPU_BINARY_1,  FpuBinaryFswR80,        "tstIEMAImplDataFpuBinary1-%s.bin.gz", 0),
         GROUP_ENTRY(CATEGORY_FPU_BINARY_1,  FpuBinaryEflR80,        "tstIEMAImplDataFpuBinary1-%s.bin.gz", 0),
 
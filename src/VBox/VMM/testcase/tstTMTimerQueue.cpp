@@ -0,0 +1,246 @@
+/* $Id: tstTMTimerQueue.cpp $ */
+/** @file
+ * TM Timer Queue Testcase & Benchmark.
+ */
+
+/*
+ * Copyright (C) 2024 Oracle and/or its affiliates.
+ *
+ * This file is part of VirtualBox base platform packages, as
+ * available from https://www.virtualbox.org.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, in version 3 of the
+ * License.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#define LOG_GROUP LOG_GROUP_TM
+#define VBOX_IN_VMM
+
+#include <VBox/vmm/tm.h>
+#include <VBox/vmm/pdmcritsect.h>
+#include "TMInternal.h"
+#include <VBox/vmm/vm.h>
+#include <VBox/vmm/uvm.h>
+#include <VBox/vmm/vmm.h>
+
+#include <VBox/err.h>
+#include <VBox/log.h>
+#include <iprt/assert.h>
+#include <iprt/initterm.h>
+#include <iprt/message.h>
+#include <iprt/rand.h>
+#include <iprt/string.h>
+#include <iprt/test.h>
+#include <iprt/time.h>
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+static RTTEST               g_hTest;
+/** The timers used by the tests. */
+static TMTIMERHANDLE        g_ahTimers[2048];
+/** The expire time of each timer in g_ahTimers. */
+static uint64_t             g_au64Expire[2048];
+
+
+/**
+ * @callback_method_impl{FNTMTIMERINT, Should never be called.}
+ */
+static DECLCALLBACK(void) tstTimerCallback(PVM pVM, TMTIMERHANDLE hTimer, void *pvUser)
+{
+    RTTestFailed(g_hTest, "Timer %#RX64 fired unexpectedly\n", hTimer);
+    RT_NOREF(pVM, pvUser);
+}
+
+
+/**
+ * Checks that the active list of the virtual clock queue is consistent and
+ * sorted by expire time.
+ *
+ * @returns Number of active timers.
+ * @param   pVM         The cross context VM structure.
+ */
+static uint32_t tstCheckActiveList(PVM pVM)
+{
+    PTMTIMERQUEUE const pQueue = &pVM->tm.s.aTimerQueues[TMCLOCK_VIRTUAL];
+    PDMCritSectEnter(pVM, &pQueue->TimerLock, VERR_IGNORED);
+
+    uint32_t cActive  = 0;
+    uint32_t idxPrev  = UINT32_MAX;
+    uint64_t u64Prev  = 0;
+    uint32_t idxTimer = pQueue->idxActive;
+    while (idxTimer != UINT32_MAX)
+    {
+        if (idxTimer >= pQueue->cTimersAlloc || cActive >= pQueue->cTimersAlloc)
+        {
+            RTTestFailed(g_hTest, "Active list corrupted: idxTimer=%#x cActive=%u\n", idxTimer, cActive);
+            break;
+        }
+        PTMTIMER const pTimer = &pQueue->paTimers[idxTimer];
+        if (pTimer->idxPrev != idxPrev)
+            RTTestFailed(g_hTest, "%s: idxPrev=%#x, expected %#x\n", pTimer->szName, pTimer->idxPrev, idxPrev);
+        if (pTimer->u64Expire < u64Prev)
+            RTTestFailed(g_hTest, "%s: u64Expire=%RU64 is before the previous timer (%RU64)\n",
+                         pTimer->szName, pTimer->u64Expire, u64Prev);
+        u64Prev = pTimer->u64Expire;
+        idxPrev = idxTimer;
+        idxTimer = pTimer->idxNext;
+        cActive++;
+    }
+
+    PDMCritSectLeave(pVM, &pQueue->TimerLock);
+    return cActive;
+}
+
+
+/**
+ * Re-arms timers and measures the cost.
+ *
+ * @param   pVM         The cross context VM structure.
+ * @param   pszName     The sub-test name.
+ * @param   cTimers     Number of timers to use.
+ * @param   cIterations Number of re-arm operations to do.
+ * @param   fPeriodic   Periodic re-arming (mostly appending) if true, random
+ *                      expire times if false.
+ */
+static void tstRearm(PVM pVM, const char *pszName, uint32_t cTimers, uint32_t cIterations, bool fPeriodic)
+{
+    RTTestSubF(g_hTest, "%s - %u timers", pszName, cTimers);
+    Assert(cTimers <= RT_ELEMENTS(g_ahTimers));
+
+    uint64_t const uNow    = TMTimerGet(pVM, g_ahTimers[0]);
+    uint64_t const cMsTick = TMTimerFromMilli(pVM, g_ahTimers[0], 1);
+
+    /* Arm them all. */
+    for (uint32_t i = 0; i < cTimers; i++)
+    {
+        g_au64Expire[i] = uNow + RTRandU64Ex(cMsTick, cMsTick * 1000);
+        RTTEST_CHECK_RC(g_hTest, TMTimerSet(pVM, g_ahTimers[i], g_au64Expire[i]), VINF_SUCCESS);
+    }
+    TMR3TimerQueuesDo(pVM);
+    RTTEST_CHECK(g_hTest, tstCheckActiveList(pVM) == cTimers);
+
+    /* Re-arm them. */
+    uint64_t const nsStart = RTTimeNanoTS();
+    for (uint32_t iIteration = 0; iIteration < cIterations; iIteration++)
+    {
+        uint32_t const i = fPeriodic ? iIteration % cTimers : RTRandU32Ex(0, cTimers - 1);
+        if (fPeriodic)
+            g_au64Expire[i] += cMsTick * (1 + i % 16);
+        else
+            g_au64Expire[i] = uNow + RTRandU64Ex(cMsTick, cMsTick * 1000);
+        TMTimerSet(pVM, g_ahTimers[i], g_au64Expire[i]);
+    }
+    uint64_t const cNsElapsed = RTTimeNanoTS() - nsStart;
+    RTTestValueF(g_hTest, cNsElapsed / cIterations, RTTESTUNIT_NS_PER_CALL, "%s re-arm, %u timers", pszName, cTimers);
+
+    TMR3TimerQueuesDo(pVM);
+    RTTEST_CHECK(g_hTest, tstCheckActiveList(pVM) == cTimers);
+
+    /* Stop them in random order and check the list as we go. */
+    for (uint32_t i = 0; i < cTimers; i++)
+    {
+        uint32_t const j = RTRandU32Ex(i, cTimers - 1);
+        TMTIMERHANDLE const hTimer = g_ahTimers[j];
+        g_ahTimers[j] = g_ahTimers[i];
+        g_ahTimers[i] = hTimer;
+        RTTEST_CHECK_RC(g_hTest, TMTimerStop(pVM, hTimer), VINF_SUCCESS);
+        if ((i & 63) == 0)
+            RTTEST_CHECK(g_hTest, tstCheckActiveList(pVM) == cTimers - i - 1);
+    }
+    TMR3TimerQueuesDo(pVM);
+    RTTEST_CHECK(g_hTest, tstCheckActiveList(pVM) == 0);
+
+    RTTestSubDone(g_hTest);
+}
+
+
+static DECLCALLBACK(int) tstTimerQueueEmt(PVM pVM, PUVM pUVM)
+{
+    RTTestSub(g_hTest, "Create timers");
+    for (uint32_t i = 0; i < RT_ELEMENTS(g_ahTimers); i++)
+    {
+        char szName[32];
+        RTStrPrintf(szName, sizeof(szName), "tst#%u", i);
+        RTTEST_CHECK_RC_RET(g_hTest, TMR3TimerCreate(pVM, TMCLOCK_VIRTUAL, tstTimerCallback, NULL,
+                                                     TMTIMER_FLAGS_NO_CRIT_SECT | TMTIMER_FLAGS_NO_RING0,
+                                                     szName, &g_ahTimers[i]),
+                            VINF_SUCCESS, VINF_SUCCESS);
+    }
+    RTTestSubDone(g_hTest);
+
+    static uint32_t const s_acTimers[] = { 1, 16, 128, 1024, RT_ELEMENTS(g_ahTimers) };
+    for (uint32_t i = 0; i < RT_ELEMENTS(s_acTimers); i++)
+    {
+        tstRearm(pVM, "Random",   s_acTimers[i], _256K, false /*fPeriodic*/);
+        tstRearm(pVM, "Periodic", s_acTimers[i], _256K, true  /*fPeriodic*/);
+    }
+
+    STAMR3Print(pUVM, "/TM/LinkActive/virtual/*");
+
+    for (uint32_t i = 0; i < RT_ELEMENTS(g_ahTimers); i++)
+        RTTEST_CHECK_RC(g_hTest, TMR3TimerDestroy(pVM, g_ahTimers[i]), VINF_SUCCESS);
+    return VINF_SUCCESS;
+}
+
+
+static void DoTests(void)
+{
+    PVM  pVM;
+    PUVM pUVM;
+    RTTESTI_CHECK_RC_OK_RETV(VMR3Create(1 /*cCpus*/, NULL, VMCREATE_F_DRIVERLESS, NULL, NULL, NULL, NULL, &pVM, &pUVM));
+
+    /*
+     * Do the tests.
+     */
+    RTTESTI_CHECK_RC(VMR3ReqCallWaitU(pUVM, 0, (PFNRT)tstTimerQueueEmt, 2, pVM, pUVM), VINF_SUCCESS);
+
+    /*
+     * Clean up.
+     */
+    RTTESTI_CHECK_RC_OK_RETV(VMR3PowerOff(pUVM));
+    RTTESTI_CHECK_RC_OK_RETV(VMR3Destroy(pUVM));
+    VMR3ReleaseUVM(pUVM);
+}
+
+
+int main(int argc, char **argv)
+{
+    /*
+     * We run the VMM in driverless mode to avoid needing to hardened the testcase
+     */
+    RTEXITCODE rcExit;
+    int rc = RTR3InitExe(argc, &argv, SUPR3INIT_F_DRIVERLESS << RTR3INIT_FLAGS_SUPLIB_SHIFT);
+    if (RT_SUCCESS(rc))
+    {
+        rc = RTTestCreate("tstTMTimerQueue", &g_hTest);
+        if (RT_SUCCESS(rc))
+        {
+            RTTestBanner(g_hTest);
+            DoTests();
+            rcExit = RTTestSummaryAndDestroy(g_hTest);
+        }
+        else
+            rcExit = RTMsgErrorExitFailure("RTTestCreate failed: %Rrc", rc);
+    }
+    else
+        rcExit = RTMsgInitFailure(rc);
+    return rcExit;
+}
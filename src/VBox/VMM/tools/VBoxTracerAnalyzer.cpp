@@ -0,0 +1,1172 @@
+/* $Id: VBoxTracerAnalyzer.cpp $ */
+/** @file
+ * VBoxTracerAnalyzer - Offline analyzer for DBGF tracer device I/O logs.
+ */
+
+/*
+ * Copyright (C) 2024 Oracle and/or its affiliates.
+ *
+ * This file is part of VirtualBox base platform packages, as
+ * available from https://www.virtualbox.org.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, in version 3 of the
+ * License.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include <iprt/tracelog.h>
+
+#include <iprt/asm.h>
+#include <iprt/assert.h>
+#include <iprt/avl.h>
+#include <iprt/err.h>
+#include <iprt/getopt.h>
+#include <iprt/initterm.h>
+#include <iprt/list.h>
+#include <iprt/message.h>
+#include <iprt/mem.h>
+#include <iprt/path.h>
+#include <iprt/sort.h>
+#include <iprt/stream.h>
+#include <iprt/string.h>
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** Number of buckets in the inter-arrival histogram (log2 of nanoseconds). */
+#define VBTA_HISTOGRAM_BUCKETS          48
+/** Maximum number of timeline buckets per device. */
+#define VBTA_TIMELINE_BUCKETS_MAX       _1M
+
+/** @name Report selection flags.
+ * @{ */
+#define VBTA_REPORT_F_SUMMARY           RT_BIT_32(0)
+#define VBTA_REPORT_F_HISTOGRAM         RT_BIT_32(1)
+#define VBTA_REPORT_F_HOT               RT_BIT_32(2)
+#define VBTA_REPORT_F_TIMELINE          RT_BIT_32(3)
+#define VBTA_REPORT_F_ALL               UINT32_C(0x0000000f)
+/** @} */
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/**
+ * Device I/O event classes the analyzer keeps statistics for.
+ */
+typedef enum VBTAEVTCLASS
+{
+    VBTAEVTCLASS_MMIO_READ = 0,
+    VBTAEVTCLASS_MMIO_WRITE,
+    VBTAEVTCLASS_MMIO_FILL,
+    VBTAEVTCLASS_IOPORT_READ,
+    VBTAEVTCLASS_IOPORT_WRITE,
+    VBTAEVTCLASS_IOPORT_READ_STR,
+    VBTAEVTCLASS_IOPORT_WRITE_STR,
+    VBTAEVTCLASS_IRQ,
+    VBTAEVTCLASS_MSI,
+    VBTAEVTCLASS_GCPHYS_READ,
+    VBTAEVTCLASS_GCPHYS_WRITE,
+    VBTAEVTCLASS_END
+} VBTAEVTCLASS;
+
+
+/**
+ * Output format.
+ */
+typedef enum VBTAFORMAT
+{
+    VBTAFORMAT_TEXT = 0,
+    VBTAFORMAT_JSON,
+    VBTAFORMAT_CSV
+} VBTAFORMAT;
+
+
+/**
+ * Per device (event source) statistics.
+ */
+typedef struct VBTADEV
+{
+    /** Node in the list of devices. */
+    RTLISTNODE                  NdDevs;
+    /** The event source handle of the device. */
+    uint64_t                    hEvtSrc;
+    /** The device name (from the event source registration). */
+    char                        szName[32];
+    /** Flag whether the event source registration was seen. */
+    bool                        fRegistered;
+    /** Number of events per class. */
+    uint64_t                    acEvts[VBTAEVTCLASS_END];
+    /** Total number of I/O events. */
+    uint64_t                    cEvts;
+    /** Number of bytes transferred. */
+    uint64_t                    cbXfer;
+    /** Timestamp of the first I/O event. */
+    uint64_t                    tsFirst;
+    /** Timestamp of the previous I/O event. */
+    uint64_t                    tsPrev;
+    /** Smallest inter-arrival time seen. */
+    uint64_t                    cNsInterMin;
+    /** Biggest inter-arrival time seen. */
+    uint64_t                    cNsInterMax;
+    /** Sum of all inter-arrival times. */
+    uint64_t                    cNsInterTotal;
+    /** Inter-arrival histogram, bucket N counts intervals in [2^N, 2^(N+1)) ns. */
+    uint64_t                    acInterArrival[VBTA_HISTOGRAM_BUCKETS];
+    /** Timeline buckets (I/O events per bucket). */
+    uint32_t                   *pacTimeline;
+    /** Number of timeline buckets allocated. */
+    uint32_t                    cTimelineBuckets;
+} VBTADEV;
+/** Pointer to the statistics of a device. */
+typedef VBTADEV *PVBTADEV;
+
+
+/**
+ * Register (region offset) statistics.
+ */
+typedef struct VBTAREG
+{
+    /** AVL node core, the key is made up by vbtaRegKey(). */
+    AVLU64NODECORE              Core;
+    /** The device owning the register. */
+    PVBTADEV                    pDev;
+    /** Flag whether this is an I/O port register. */
+    bool                        fIoPort;
+    /** The region handle. */
+    uint64_t                    hRegion;
+    /** The offset into the region. */
+    uint64_t                    off;
+    /** Number of reads. */
+    uint64_t                    cReads;
+    /** Number of writes. */
+    uint64_t                    cWrites;
+    /** The last value read or written. */
+    uint64_t                    uLastVal;
+} VBTAREG;
+/** Pointer to register statistics. */
+typedef VBTAREG *PVBTAREG;
+
+
+/**
+ * Region mapping state.
+ */
+typedef struct VBTAREGION
+{
+    /** AVL node core, the key is made up by vbtaRegionKey(). */
+    AVLU64NODECORE              Core;
+    /** The current base address, UINT64_MAX if not mapped. */
+    uint64_t                    uBase;
+} VBTAREGION;
+/** Pointer to a region mapping state. */
+typedef VBTAREGION *PVBTAREGION;
+
+
+/**
+ * The analyzer state.
+ */
+typedef struct VBTASTATE
+{
+    /** List of devices. */
+    RTLISTANCHOR                LstDevs;
+    /** Number of devices. */
+    uint32_t                    cDevs;
+    /** Register statistics tree. */
+    AVLU64TREE                  TreeRegs;
+    /** Number of registers in the tree. */
+    uint32_t                    cRegs;
+    /** Region mapping tree. */
+    AVLU64TREE                  TreeRegions;
+    /** Timestamp of the first event in the log. */
+    uint64_t                    tsStart;
+    /** Timestamp of the last event accounted. */
+    uint64_t                    tsLast;
+    /** Start of the analysis window relative to tsStart. */
+    uint64_t                    cNsFrom;
+    /** End of the analysis window relative to tsStart. */
+    uint64_t                    cNsTo;
+    /** Timeline bucket width in nanoseconds. */
+    uint64_t                    cNsTimelineBucket;
+    /** Number of events processed in total. */
+    uint64_t                    cEvtsTotal;
+    /** Number of I/O events from event sources without a registration record. */
+    uint64_t                    cEvtsOrphaned;
+} VBTASTATE;
+/** Pointer to the analyzer state. */
+typedef VBTASTATE *PVBTASTATE;
+
+
+/**
+ * Collector for the hot register table.
+ */
+typedef struct VBTAREGCOLLECT
+{
+    /** The array of register pointers. */
+    PVBTAREG                   *papRegs;
+    /** Number of entries used. */
+    uint32_t                    cRegs;
+} VBTAREGCOLLECT;
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+/** Event ID to class mapping, indexed by VBTAEVTCLASS. */
+static const struct
+{
+    /** The DBGF tracer event ID. */
+    const char                 *pszEvtId;
+    /** The short name used in the reports. */
+    const char                 *pszName;
+} g_aEvtClasses[VBTAEVTCLASS_END] =
+{
+    { "Dev.MmioRead",       "mmio-read"     },
+    { "Dev.MmioWrite",      "mmio-write"    },
+    { "Dev.MmioFill",       "mmio-fill"     },
+    { "Dev.IoPortRead",     "ioport-read"   },
+    { "Dev.IoPortWrite",    "ioport-write"  },
+    { "Dev.IoPortReadStr",  "ioport-rd-str" },
+    { "Dev.IoPortWriteStr", "ioport-wr-str" },
+    { "Dev.Irq",            "irq"           },
+    { "Dev.IoApicMsi",      "msi"           },
+    { "Dev.GCPhysRead",     "gcphys-read"   },
+    { "Dev.GCPhysWrite",    "gcphys-write"  },
+};
+
+
+
+/**
+ * Returns the register tree key for the given register.
+ */
+DECLINLINE(uint64_t) vbtaRegKey(bool fIoPort, uint64_t hRegion, uint64_t off)
+{
+    return (fIoPort ? RT_BIT_64(63) : 0) | ((hRegion & UINT64_C(0x7fffff)) << 40) | (off & UINT64_C(0xffffffffff));
+}
+
+
+/**
+ * Returns the region tree key for the given region.
+ */
+DECLINLINE(uint64_t) vbtaRegionKey(bool fIoPort, uint64_t hRegion)
+{
+    return (fIoPort ? RT_BIT_64(63) : 0) | (hRegion & ~RT_BIT_64(63));
+}
+
+
+/**
+ * Looks up the device for the given event source, creating it if necessary.
+ *
+ * @returns Pointer to the device statistics or NULL if out of memory.
+ * @param   pThis               The analyzer state.
+ * @param   hEvtSrc             The event source handle.
+ */
+static PVBTADEV vbtaDevGet(PVBTASTATE pThis, uint64_t hEvtSrc)
+{
+    PVBTADEV pIt;
+    RTListForEach(&pThis->LstDevs, pIt, VBTADEV, NdDevs)
+    {
+        if (pIt->hEvtSrc == hEvtSrc)
+            return pIt;
+    }
+
+    PVBTADEV pDev = (PVBTADEV)RTMemAllocZ(sizeof(*pDev));
+    if (pDev)
+    {
+        pDev->hEvtSrc     = hEvtSrc;
+        pDev->cNsInterMin = UINT64_MAX;
+        RTStrPrintf(pDev->szName, sizeof(pDev->szName), "evtsrc#%RU64", hEvtSrc);
+        RTListAppend(&pThis->LstDevs, &pDev->NdDevs);
+        pThis->cDevs++;
+    }
+    return pDev;
+}
+
+
+/**
+ * Queries an unsigned integer item of the given event.
+ *
+ * @returns The value, 0 if not present.
+ * @param   hEvt                The event handle.
+ * @param   pszName             The item name.
+ */
+static uint64_t vbtaEvtQueryU64(RTTRACELOGRDREVT hEvt, const char *pszName)
+{
+    RTTRACELOGEVTVAL Val;
+    int rc = RTTraceLogRdrEvtQueryVal(hEvt, pszName, &Val);
+    if (RT_FAILURE(rc))
+        return 0;
+
+    switch (Val.pItemDesc->enmType)
+    {
+        case RTTRACELOGTYPE_BOOL:   return Val.u.f;
+        case RTTRACELOGTYPE_UINT8:  return Val.u.u8;
+        case RTTRACELOGTYPE_INT8:   return (uint64_t)(int64_t)Val.u.i8;
+        case RTTRACELOGTYPE_UINT16: return Val.u.u16;
+        case RTTRACELOGTYPE_INT16:  return (uint64_t)(int64_t)Val.u.i16;
+        case RTTRACELOGTYPE_UINT32: return Val.u.u32;
+        case RTTRACELOGTYPE_INT32:  return (uint64_t)(int64_t)Val.u.i32;
+        case RTTRACELOGTYPE_UINT64: return Val.u.u64;
+        case RTTRACELOGTYPE_INT64:  return (uint64_t)Val.u.i64;
+        case RTTRACELOGTYPE_SIZE:   return Val.u.sz;
+        case RTTRACELOGTYPE_POINTER: return Val.u.uPtr;
+        default:
+            return 0;
+    }
+}
+
+
+/**
+ * Accounts a register access.
+ *
+ * @returns IPRT status code.
+ * @param   pThis               The analyzer state.
+ * @param   pDev                The device doing the access.
+ * @param   fIoPort             Flag whether this is an I/O port access.
+ * @param   fWrite              Flag whether this is a write.
+ * @param   hRegion             The region handle.
+ * @param   off                 The offset into the region.
+ * @param   uVal                The value read or written.
+ */
+static int vbtaRegAccess(PVBTASTATE pThis, PVBTADEV pDev, bool fIoPort, bool fWrite, uint64_t hRegion,
+                         uint64_t off, uint64_t uVal)
+{
+    uint64_t const uKey = vbtaRegKey(fIoPort, hRegion, off);
+    PVBTAREG pReg = (PVBTAREG)RTAvlU64Get(&pThis->TreeRegs, uKey);
+    if (!pReg)
+    {
+        pReg = (PVBTAREG)RTMemAllocZ(sizeof(*pReg));
+        if (!pReg)
+            return VERR_NO_MEMORY;
+        pReg->Core.Key = uKey;
+        pReg->pDev     = pDev;
+        pReg->fIoPort  = fIoPort;
+        pReg->hRegion  = hRegion;
+        pReg->off      = off;
+        RTAvlU64Insert(&pThis->TreeRegs, &pReg->Core);
+        pThis->cRegs++;
+    }
+
+    if (fWrite)
+        pReg->cWrites++;
+    else
+        pReg->cReads++;
+    pReg->uLastVal = uVal;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Records the mapping state of a region.
+ *
+ * @returns IPRT status code.
+ * @param   pThis               The analyzer state.
+ * @param   fIoPort             Flag whether this is an I/O port region.
+ * @param   hRegion             The region handle.
+ * @param   uBase               The base address, UINT64_MAX when unmapped.
+ */
+static int vbtaRegionMap(PVBTASTATE pThis, bool fIoPort, uint64_t hRegion, uint64_t uBase)
+{
+    uint64_t const uKey = vbtaRegionKey(fIoPort, hRegion);
+    PVBTAREGION pRegion = (PVBTAREGION)RTAvlU64Get(&pThis->TreeRegions, uKey);
+    if (!pRegion)
+    {
+        pRegion = (PVBTAREGION)RTMemAllocZ(sizeof(*pRegion));
+        if (!pRegion)
+            return VERR_NO_MEMORY;
+        pRegion->Core.Key = uKey;
+        RTAvlU64Insert(&pThis->TreeRegions, &pRegion->Core);
+    }
+    pRegion->uBase = uBase;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Returns the last known base address of the given region.
+ *
+ * @returns Base address, UINT64_MAX if unknown or not mapped.
+ * @param   pThis               The analyzer state.
+ * @param   fIoPort             Flag whether this is an I/O port region.
+ * @param   hRegion             The region handle.
+ */
+static uint64_t vbtaRegionGetBase(PVBTASTATE pThis, bool fIoPort, uint64_t hRegion)
+{
+    PVBTAREGION pRegion = (PVBTAREGION)RTAvlU64Get(&pThis->TreeRegions, vbtaRegionKey(fIoPort, hRegion));
+    return pRegion ? pRegion->uBase : UINT64_MAX;
+}
+
+
+/**
+ * Accounts an I/O event in the per device rate, histogram and timeline data.
+ *
+ * @returns IPRT status code.
+ * @param   pThis               The analyzer state.
+ * @param   pDev                The device.
+ * @param   enmClass            The event class.
+ * @param   tsEvt               The event timestamp.
+ * @param   cbXfer              Number of bytes transferred.
+ */
+static int vbtaDevAccount(PVBTASTATE pThis, PVBTADEV pDev, VBTAEVTCLASS enmClass, uint64_t tsEvt, uint64_t cbXfer)
+{
+    pDev->acEvts[enmClass]++;
+    pDev->cbXfer += cbXfer;
+
+    if (pDev->cEvts++)
+    {
+        uint64_t const cNsInter = tsEvt > pDev->tsPrev ? tsEvt - pDev->tsPrev : 0;
+        unsigned iBucket = cNsInter ? ASMBitLastSetU64(cNsInter) - 1 : 0;
+        if (iBucket >= VBTA_HISTOGRAM_BUCKETS)
+            iBucket = VBTA_HISTOGRAM_BUCKETS - 1;
+        pDev->acInterArrival[iBucket]++;
+        pDev->cNsInterTotal += cNsInter;
+        pDev->cNsInterMin = RT_MIN(pDev->cNsInterMin, cNsInter);
+        pDev->cNsInterMax = RT_MAX(pDev->cNsInterMax, cNsInter);
+    }
+    else
+        pDev->tsFirst = tsEvt;
+    pDev->tsPrev = tsEvt;
+
+    /* The timeline. */
+    uint64_t const idxBucket = (tsEvt - pThis->tsStart - pThis->cNsFrom) / pThis->cNsTimelineBucket;
+    if (idxBucket >= VBTA_TIMELINE_BUCKETS_MAX)
+        return VINF_SUCCESS; /* Silently cut off, the summary is still correct. */
+    if (idxBucket >= pDev->cTimelineBuckets)
+    {
+        uint32_t const cBucketsNew = (uint32_t)RT_MIN(RT_ALIGN_64(idxBucket + 1, _4K), VBTA_TIMELINE_BUCKETS_MAX);
+        uint32_t *pacNew = (uint32_t *)RTMemRealloc(pDev->pacTimeline, cBucketsNew * sizeof(uint32_t));
+        if (!pacNew)
+            return VERR_NO_MEMORY;
+        RT_BZERO(&pacNew[pDev->cTimelineBuckets], (cBucketsNew - pDev->cTimelineBuckets) * sizeof(uint32_t));
+        pDev->pacTimeline      = pacNew;
+        pDev->cTimelineBuckets = cBucketsNew;
+    }
+    pDev->pacTimeline[idxBucket]++;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Processes a single trace log event.
+ *
+ * @returns IPRT status code.
+ * @param   pThis               The analyzer state.
+ * @param   hEvt                The event to process.
+ */
+static int vbtaEvtProcess(PVBTASTATE pThis, RTTRACELOGRDREVT hEvt)
+{
+    PCRTTRACELOGEVTDESC pEvtDesc = RTTraceLogRdrEvtGetDesc(hEvt);
+    uint64_t const      tsEvt    = RTTraceLogRdrEvtGetTs(hEvt);
+
+    if (!pThis->cEvtsTotal++)
+        pThis->tsStart = tsEvt;
+
+    /*
+     * Event source registration carries the device name and uses the event
+     * source handle as the group ID, everything else references it as parent.
+     */
+    if (!strcmp(pEvtDesc->pszId, "EvtSrc.Register"))
+    {
+        PVBTADEV pDev = vbtaDevGet(pThis, RTTraceLogRdrEvtGetGrpId(hEvt));
+        if (!pDev)
+            return VERR_NO_MEMORY;
+
+        RTTRACELOGEVTVAL Val;
+        int rc = RTTraceLogRdrEvtQueryVal(hEvt, "szName", &Val);
+        if (   RT_SUCCESS(rc)
+            && Val.u.RawData.cb
+            && Val.u.RawData.pb[0] != '\0')
+            RTStrCopyEx(pDev->szName, sizeof(pDev->szName), (const char *)Val.u.RawData.pb, Val.u.RawData.cb);
+        pDev->fRegistered = true;
+        return VINF_SUCCESS;
+    }
+
+    uint64_t const hEvtSrc = RTTraceLogRdrEvtGetParentGrpId(hEvt);
+    if (!strcmp(pEvtDesc->pszId, "Dev.MmioMap"))
+        return vbtaRegionMap(pThis, false /*fIoPort*/, vbtaEvtQueryU64(hEvt, "hMmioRegion"),
+                             vbtaEvtQueryU64(hEvt, "GCPhysMmioBase"));
+    if (!strcmp(pEvtDesc->pszId, "Dev.MmioUnmap"))
+        return vbtaRegionMap(pThis, false /*fIoPort*/, vbtaEvtQueryU64(hEvt, "hMmioRegion"), UINT64_MAX);
+    if (!strcmp(pEvtDesc->pszId, "Dev.IoPortMap"))
+        return vbtaRegionMap(pThis, true /*fIoPort*/, vbtaEvtQueryU64(hEvt, "hIoPorts"),
+                             vbtaEvtQueryU64(hEvt, "IoPortBase"));
+    if (!strcmp(pEvtDesc->pszId, "Dev.IoPortUnmap"))
+        return vbtaRegionMap(pThis, true /*fIoPort*/, vbtaEvtQueryU64(hEvt, "hIoPorts"), UINT64_MAX);
+
+    unsigned enmClass;
+    for (enmClass = 0; enmClass < VBTAEVTCLASS_END; enmClass++)
+        if (!strcmp(pEvtDesc->pszId, g_aEvtClasses[enmClass].pszEvtId))
+            break;
+    if (enmClass == VBTAEVTCLASS_END)
+        return VINF_SUCCESS; /* Region creation, data continuation records and such. */
+
+    /* Apply the time window. */
+    uint64_t const cNsRel = tsEvt - pThis->tsStart;
+    if (   cNsRel < pThis->cNsFrom
+        || cNsRel > pThis->cNsTo)
+        return VINF_SUCCESS;
+    pThis->tsLast = tsEvt;
+
+    PVBTADEV pDev = vbtaDevGet(pThis, hEvtSrc);
+    if (!pDev)
+        return VERR_NO_MEMORY;
+    if (!pDev->fRegistered)
+        pThis->cEvtsOrphaned++;
+
+    int rc = VINF_SUCCESS;
+    uint64_t cbXfer = 0;
+    switch (enmClass)
+    {
+        case VBTAEVTCLASS_MMIO_READ:
+        case VBTAEVTCLASS_MMIO_WRITE:
+            cbXfer = vbtaEvtQueryU64(hEvt, "cbXfer");
+            rc = vbtaRegAccess(pThis, pDev, false /*fIoPort*/, enmClass == VBTAEVTCLASS_MMIO_WRITE,
+                               vbtaEvtQueryU64(hEvt, "hMmioRegion"), vbtaEvtQueryU64(hEvt, "offMmio"),
+                               vbtaEvtQueryU64(hEvt, "u64Val"));
+            break;
+        case VBTAEVTCLASS_MMIO_FILL:
+            cbXfer = vbtaEvtQueryU64(hEvt, "cbItem") * vbtaEvtQueryU64(hEvt, "cItems");
+            rc = vbtaRegAccess(pThis, pDev, false /*fIoPort*/, true /*fWrite*/, vbtaEvtQueryU64(hEvt, "hMmioRegion"),
+                               vbtaEvtQueryU64(hEvt, "offMmio"), vbtaEvtQueryU64(hEvt, "u32Val"));
+            break;
+        case VBTAEVTCLASS_IOPORT_READ:
+        case VBTAEVTCLASS_IOPORT_WRITE:
+            cbXfer = vbtaEvtQueryU64(hEvt, "cbXfer");
+            rc = vbtaRegAccess(pThis, pDev, true /*fIoPort*/, enmClass == VBTAEVTCLASS_IOPORT_WRITE,
+                               vbtaEvtQueryU64(hEvt, "hIoPorts"), vbtaEvtQueryU64(hEvt, "offPort"),
+                               vbtaEvtQueryU64(hEvt, "u32Val"));
+            break;
+        case VBTAEVTCLASS_IOPORT_READ_STR:
+        case VBTAEVTCLASS_IOPORT_WRITE_STR:
+            cbXfer = vbtaEvtQueryU64(hEvt, "cbItem") * vbtaEvtQueryU64(hEvt, "cTransfersRet");
+            rc = vbtaRegAccess(pThis, pDev, true /*fIoPort*/, enmClass == VBTAEVTCLASS_IOPORT_WRITE_STR,
+                               vbtaEvtQueryU64(hEvt, "hIoPorts"), vbtaEvtQueryU64(hEvt, "offPort"), 0 /*uVal*/);
+            break;
+        case VBTAEVTCLASS_GCPHYS_READ:
+        case VBTAEVTCLASS_GCPHYS_WRITE:
+            cbXfer = vbtaEvtQueryU64(hEvt, "cbXfer");
+            break;
+        default:
+            break;
+    }
+
+    if (RT_SUCCESS(rc))
+        rc = vbtaDevAccount(pThis, pDev, (VBTAEVTCLASS)enmClass, tsEvt, cbXfer);
+    return rc;
+}
+
+
+/**
+ * Reads the whole trace log and gathers the statistics.
+ *
+ * @returns IPRT status code.
+ * @param   pThis               The analyzer state.
+ * @param   pszInput            The trace log file.
+ */
+static int vbtaProcessLog(PVBTASTATE pThis, const char *pszInput)
+{
+    RTTRACELOGRDR hTraceLogRdr = NIL_RTTRACELOGRDR;
+    int rc = RTTraceLogRdrCreateFromFile(&hTraceLogRdr, pszInput);
+    if (RT_FAILURE(rc))
+        return RTMsgErrorRc(rc, "Failed to open trace log '%s': %Rrc", pszInput, rc);
+
+    for (;;)
+    {
+        RTTRACELOGRDRPOLLEVT enmEvt = RTTRACELOGRDRPOLLEVT_INVALID;
+        rc = RTTraceLogRdrEvtPoll(hTraceLogRdr, &enmEvt, 0 /*cMsTimeout*/);
+        if (RT_FAILURE(rc))
+        {
+            if (rc == VERR_EOF)
+                rc = VINF_SUCCESS;
+            else
+                RTMsgError("Reading the trace log failed with %Rrc", rc);
+            break;
+        }
+
+        if (enmEvt == RTTRACELOGRDRPOLLEVT_TRACE_EVENT_RECVD)
+        {
+            RTTRACELOGRDREVT hEvt;
+            rc = RTTraceLogRdrQueryLastEvt(hTraceLogRdr, &hEvt);
+            if (RT_SUCCESS(rc))
+                rc = vbtaEvtProcess(pThis, hEvt);
+            if (RT_FAILURE(rc))
+            {
+                RTMsgError("Processing event failed with %Rrc", rc);
+                break;
+            }
+        }
+    }
+
+    RTTraceLogRdrDestroy(hTraceLogRdr);
+    return rc;
+}
+
+
+/**
+ * Returns the duration covered by the device statistics in nanoseconds.
+ */
+static uint64_t vbtaDevGetDuration(PVBTADEV pDev)
+{
+    return pDev->cEvts > 1 ? pDev->tsPrev - pDev->tsFirst : 0;
+}
+
+
+/**
+ * Returns the event rate of the given device in events per second.
+ */
+static uint64_t vbtaDevGetRate(PVBTADEV pDev)
+{
+    uint64_t const cNs = vbtaDevGetDuration(pDev);
+    return cNs ? (uint64_t)((double)pDev->cEvts * RT_NS_1SEC / (double)cNs) : 0;
+}
+
+
+/**
+ * Returns the number of used timeline buckets of the given device.
+ */
+static uint32_t vbtaDevGetTimelineUsed(PVBTADEV pDev)
+{
+    uint32_t cBuckets = pDev->cTimelineBuckets;
+    while (cBuckets && !pDev->pacTimeline[cBuckets - 1])
+        cBuckets--;
+    return cBuckets;
+}
+
+
+/**
+ * Returns the number of used histogram buckets of the given device.
+ */
+static unsigned vbtaDevGetHistogramUsed(PVBTADEV pDev)
+{
+    unsigned cBuckets = VBTA_HISTOGRAM_BUCKETS;
+    while (cBuckets && !pDev->acInterArrival[cBuckets - 1])
+        cBuckets--;
+    return cBuckets;
+}
+
+
+/**
+ * @callback_method_impl{AVLU64CALLBACK, Collects the registers into an array.}
+ */
+static DECLCALLBACK(int) vbtaRegCollect(PAVLU64NODECORE pNode, void *pvUser)
+{
+    VBTAREGCOLLECT *pCollect = (VBTAREGCOLLECT *)pvUser;
+    pCollect->papRegs[pCollect->cRegs++] = (PVBTAREG)pNode;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @callback_method_impl{FNRTSORTCMP, Sorts registers by access count in descending order.}
+ */
+static DECLCALLBACK(int) vbtaRegCmp(void const *pvElement1, void const *pvElement2, void *pvUser)
+{
+    RT_NOREF(pvUser);
+    PVBTAREG pReg1 = (PVBTAREG)pvElement1;
+    PVBTAREG pReg2 = (PVBTAREG)pvElement2;
+    uint64_t const c1 = pReg1->cReads + pReg1->cWrites;
+    uint64_t const c2 = pReg2->cReads + pReg2->cWrites;
+    if (c1 != c2)
+        return c1 > c2 ? -1 : 1;
+    return pReg1->Core.Key < pReg2->Core.Key ? -1 : pReg1->Core.Key > pReg2->Core.Key ? 1 : 0;
+}
+
+
+/**
+ * Writes the per device summary.
+ */
+static void vbtaReportSummary(PVBTASTATE pThis, PRTSTREAM pStrm, VBTAFORMAT enmFormat)
+{
+    PVBTADEV pDev;
+    if (enmFormat == VBTAFORMAT_TEXT)
+    {
+        RTStrmPrintf(pStrm, "Summary: %RU64 events, %u devices, %RU64 ns traced\n",
+                     pThis->cEvtsTotal, pThis->cDevs, pThis->tsLast - pThis->tsStart);
+        RTStrmPrintf(pStrm, "%-24s %12s %12s %14s %12s %12s %12s\n",
+                     "Device", "Events", "Events/s", "Bytes", "MinGap(ns)", "AvgGap(ns)", "MaxGap(ns)");
+    }
+    else if (enmFormat == VBTAFORMAT_CSV)
+    {
+        RTStrmPrintf(pStrm, "device,events,events_per_sec,bytes,min_gap_ns,avg_gap_ns,max_gap_ns");
+        for (unsigned i = 0; i < VBTAEVTCLASS_END; i++)
+            RTStrmPrintf(pStrm, ",%s", g_aEvtClasses[i].pszName);
+        RTStrmPrintf(pStrm, "\n");
+    }
+    else
+        RTStrmPrintf(pStrm, "  \"summary\": [\n");
+
+    bool fFirst = true;
+    RTListForEach(&pThis->LstDevs, pDev, VBTADEV, NdDevs)
+    {
+        if (!pDev->cEvts)
+            continue;
+
+        uint64_t const cNsMin = pDev->cEvts > 1 ? pDev->cNsInterMin : 0;
+        uint64_t const cNsAvg = pDev->cEvts > 1 ? pDev->cNsInterTotal / (pDev->cEvts - 1) : 0;
+        switch (enmFormat)
+        {
+            case VBTAFORMAT_TEXT:
+                RTStrmPrintf(pStrm, "%-24s %12RU64 %12RU64 %14RU64 %12RU64 %12RU64 %12RU64\n",
+                             pDev->szName, pDev->cEvts, vbtaDevGetRate(pDev), pDev->cbXfer,
+                             cNsMin, cNsAvg, pDev->cNsInterMax);
+                for (unsigned i = 0; i < VBTAEVTCLASS_END; i++)
+                    if (pDev->acEvts[i])
+                        RTStrmPrintf(pStrm, "    %-20s %12RU64\n", g_aEvtClasses[i].pszName, pDev->acEvts[i]);
+                break;
+            case VBTAFORMAT_CSV:
+                RTStrmPrintf(pStrm, "%s,%RU64,%RU64,%RU64,%RU64,%RU64,%RU64",
+                             pDev->szName, pDev->cEvts, vbtaDevGetRate(pDev), pDev->cbXfer,
+                             cNsMin, cNsAvg, pDev->cNsInterMax);
+                for (unsigned i = 0; i < VBTAEVTCLASS_END; i++)
+                    RTStrmPrintf(pStrm, ",%RU64", pDev->acEvts[i]);
+                RTStrmPrintf(pStrm, "\n");
+                break;
+            case VBTAFORMAT_JSON:
+                RTStrmPrintf(pStrm, "%s    { \"device\": \"%s\", \"events\": %RU64, \"events_per_sec\": %RU64, \"bytes\": %RU64, "
+                             "\"min_gap_ns\": %RU64, \"avg_gap_ns\": %RU64, \"max_gap_ns\": %RU64, \"classes\": {",
+                             fFirst ? "" : ",\n", pDev->szName, pDev->cEvts, vbtaDevGetRate(pDev), pDev->cbXfer,
+                             cNsMin, cNsAvg, pDev->cNsInterMax);
+                for (unsigned i = 0; i < VBTAEVTCLASS_END; i++)
+                    RTStrmPrintf(pStrm, "%s\"%s\": %RU64", i ? ", " : " ", g_aEvtClasses[i].pszName, pDev->acEvts[i]);
+                RTStrmPrintf(pStrm, " } }");
+                break;
+        }
+        fFirst = false;
+    }
+
+    if (enmFormat == VBTAFORMAT_JSON)
+        RTStrmPrintf(pStrm, "\n  ]");
+    else
+        RTStrmPrintf(pStrm, "\n");
+}
+
+
+/**
+ * Writes the per device inter-arrival histograms.
+ */
+static void vbtaReportHistogram(PVBTASTATE pThis, PRTSTREAM pStrm, VBTAFORMAT enmFormat)
+{
+    if (enmFormat == VBTAFORMAT_TEXT)
+        RTStrmPrintf(pStrm, "Inter-arrival histograms (bucket N: [2^N, 2^(N+1)) ns):\n");
+    else if (enmFormat == VBTAFORMAT_CSV)
+        RTStrmPrintf(pStrm, "device,bucket_ns,count\n");
+    else
+        RTStrmPrintf(pStrm, "  \"histogram\": [\n");
+
+    bool fFirst = true;
+    PVBTADEV pDev;
+    RTListForEach(&pThis->LstDevs, pDev, VBTADEV, NdDevs)
+    {
+        if (pDev->cEvts < 2)
+            continue;
+
+        unsigned const cBuckets = vbtaDevGetHistogramUsed(pDev);
+        uint64_t cMax = 1;
+        for (unsigned i = 0; i < cBuckets; i++)
+            cMax = RT_MAX(cMax, pDev->acInterArrival[i]);
+
+        if (enmFormat == VBTAFORMAT_TEXT)
+            RTStrmPrintf(pStrm, "%s:\n", pDev->szName);
+        else if (enmFormat == VBTAFORMAT_JSON)
+            RTStrmPrintf(pStrm, "%s    { \"device\": \"%s\", \"buckets\": [", fFirst ? "" : ",\n", pDev->szName);
+
+        for (unsigned i = 0; i < cBuckets; i++)
+        {
+            uint64_t const cNsBucket = RT_BIT_64(i);
+            switch (enmFormat)
+            {
+                case VBTAFORMAT_TEXT:
+                {
+                    char szBar[41];
+                    size_t const cchBar = (size_t)(pDev->acInterArrival[i] * (sizeof(szBar) - 1) / cMax);
+                    memset(szBar, '#', cchBar);
+                    szBar[cchBar] = '\0';
+                    RTStrmPrintf(pStrm, "  >= %14RU64 ns %12RU64 %s\n", cNsBucket, pDev->acInterArrival[i], szBar);
+                    break;
+                }
+                case VBTAFORMAT_CSV:
+                    RTStrmPrintf(pStrm, "%s,%RU64,%RU64\n", pDev->szName, cNsBucket, pDev->acInterArrival[i]);
+                    break;
+                case VBTAFORMAT_JSON:
+                    RTStrmPrintf(pStrm, "%s{ \"ns\": %RU64, \"count\": %RU64 }", i ? ", " : " ",
+                                 cNsBucket, pDev->acInterArrival[i]);
+                    break;
+            }
+        }
+
+        if (enmFormat == VBTAFORMAT_JSON)
+            RTStrmPrintf(pStrm, " ] }");
+        fFirst = false;
+    }
+
+    if (enmFormat == VBTAFORMAT_JSON)
+        RTStrmPrintf(pStrm, "\n  ]");
+    else
+        RTStrmPrintf(pStrm, "\n");
+}
+
+
+/**
+ * Writes the hot register table.
+ */
+static int vbtaReportHot(PVBTASTATE pThis, PRTSTREAM pStrm, VBTAFORMAT enmFormat, uint32_t cTop)
+{
+    VBTAREGCOLLECT Collect;
+    Collect.cRegs   = 0;
+    Collect.papRegs = (PVBTAREG *)RTMemAlloc(RT_MAX(pThis->cRegs, 1) * sizeof(PVBTAREG));
+    if (!Collect.papRegs)
+        return VERR_NO_MEMORY;
+    RTAvlU64DoWithAll(&pThis->TreeRegs, true /*fFromLeft*/, vbtaRegCollect, &Collect);
+    RTSortApvShell((void **)Collect.papRegs, Collect.cRegs, vbtaRegCmp, NULL);
+
+    if (enmFormat == VBTAFORMAT_TEXT)
+        RTStrmPrintf(pStrm, "Hot registers (top %u of %u):\n%-24s %-6s %10s %10s %18s %12s %12s %18s\n",
+                     RT_MIN(cTop, Collect.cRegs), Collect.cRegs,
+                     "Device", "Space", "Region", "Offset", "Address", "Reads", "Writes", "LastValue");
+    else if (enmFormat == VBTAFORMAT_CSV)
+        RTStrmPrintf(pStrm, "device,space,region,offset,address,reads,writes,last_value\n");
+    else
+        RTStrmPrintf(pStrm, "  \"hot\": [\n");
+
+    for (uint32_t i = 0; i < RT_MIN(cTop, Collect.cRegs); i++)
+    {
+        PVBTAREG pReg = Collect.papRegs[i];
+        uint64_t const uBase = vbtaRegionGetBase(pThis, pReg->fIoPort, pReg->hRegion);
+        uint64_t const uAddr = uBase != UINT64_MAX ? uBase + pReg->off : UINT64_MAX;
+        const char *pszSpace = pReg->fIoPort ? "ioport" : "mmio";
+        switch (enmFormat)
+        {
+            case VBTAFORMAT_TEXT:
+                RTStrmPrintf(pStrm, "%-24s %-6s %#10RX64 %#10RX64 %#18RX64 %12RU64 %12RU64 %#18RX64\n",
+                             pReg->pDev->szName, pszSpace, pReg->hRegion, pReg->off, uAddr,
+                             pReg->cReads, pReg->cWrites, pReg->uLastVal);
+                break;
+            case VBTAFORMAT_CSV:
+                RTStrmPrintf(pStrm, "%s,%s,%#RX64,%#RX64,%#RX64,%RU64,%RU64,%#RX64\n",
+                             pReg->pDev->szName, pszSpace, pReg->hRegion, pReg->off, uAddr,
+                             pReg->cReads, pReg->cWrites, pReg->uLastVal);
+                break;
+            case VBTAFORMAT_JSON:
+                RTStrmPrintf(pStrm, "%s    { \"device\": \"%s\", \"space\": \"%s\", \"region\": %RU64, \"offset\": %RU64, "
+                             "\"address\": %RU64, \"reads\": %RU64, \"writes\": %RU64, \"last_value\": %RU64 }",
+                             i ? ",\n" : "", pReg->pDev->szName, pszSpace, pReg->hRegion, pReg->off, uAddr,
+                             pReg->cReads, pReg->cWrites, pReg->uLastVal);
+                break;
+        }
+    }
+
+    if (enmFormat == VBTAFORMAT_JSON)
+        RTStrmPrintf(pStrm, "\n  ]");
+    else
+        RTStrmPrintf(pStrm, "\n");
+
+    RTMemFree(Collect.papRegs);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Writes the per device timelines.
+ */
+static void vbtaReportTimeline(PVBTASTATE pThis, PRTSTREAM pStrm, VBTAFORMAT enmFormat)
+{
+    if (enmFormat == VBTAFORMAT_TEXT)
+        RTStrmPrintf(pStrm, "Timeline (%RU64 us buckets, events per bucket):\n", pThis->cNsTimelineBucket / RT_NS_1US);
+    else if (enmFormat == VBTAFORMAT_CSV)
+        RTStrmPrintf(pStrm, "device,start_ns,events\n");
+    else
+        RTStrmPrintf(pStrm, "  \"timeline_bucket_ns\": %RU64,\n  \"timeline\": [\n", pThis->cNsTimelineBucket);
+
+    bool fFirst = true;
+    PVBTADEV pDev;
+    RTListForEach(&pThis->LstDevs, pDev, VBTADEV, NdDevs)
+    {
+        uint32_t const cBuckets = vbtaDevGetTimelineUsed(pDev);
+        if (!cBuckets)
+            continue;
+
+        if (enmFormat == VBTAFORMAT_TEXT)
+            RTStrmPrintf(pStrm, "%s:\n", pDev->szName);
+        else if (enmFormat == VBTAFORMAT_JSON)
+            RTStrmPrintf(pStrm, "%s    { \"device\": \"%s\", \"events\": [", fFirst ? "" : ",\n", pDev->szName);
+
+        for (uint32_t i = 0; i < cBuckets; i++)
+        {
+            uint64_t const cNsStart = pThis->cNsFrom + i * pThis->cNsTimelineBucket;
+            switch (enmFormat)
+            {
+                case VBTAFORMAT_TEXT:
+                    if (pDev->pacTimeline[i])
+                        RTStrmPrintf(pStrm, "  %16RU64 ns %10RU32\n", cNsStart, pDev->pacTimeline[i]);
+                    break;
+                case VBTAFORMAT_CSV:
+                    RTStrmPrintf(pStrm, "%s,%RU64,%RU32\n", pDev->szName, cNsStart, pDev->pacTimeline[i]);
+                    break;
+                case VBTAFORMAT_JSON:
+                    RTStrmPrintf(pStrm, "%s%RU32", i ? ", " : " ", pDev->pacTimeline[i]);
+                    break;
+            }
+        }
+
+        if (enmFormat == VBTAFORMAT_JSON)
+            RTStrmPrintf(pStrm, " ] }");
+        fFirst = false;
+    }
+
+    if (enmFormat == VBTAFORMAT_JSON)
+        RTStrmPrintf(pStrm, "\n  ]");
+    else
+        RTStrmPrintf(pStrm, "\n");
+}
+
+
+/**
+ * @callback_method_impl{AVLU64CALLBACK, Frees a tree node.}
+ */
+static DECLCALLBACK(int) vbtaNodeFree(PAVLU64NODECORE pNode, void *pvUser)
+{
+    RT_NOREF(pvUser);
+    RTMemFree(pNode);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Frees all resources of the analyzer state.
+ */
+static void vbtaStateDestroy(PVBTASTATE pThis)
+{
+    PVBTADEV pDev, pDevNext;
+    RTListForEachSafe(&pThis->LstDevs, pDev, pDevNext, VBTADEV, NdDevs)
+    {
+        RTListNodeRemove(&pDev->NdDevs);
+        RTMemFree(pDev->pacTimeline);
+        RTMemFree(pDev);
+    }
+    RTAvlU64Destroy(&pThis->TreeRegs, vbtaNodeFree, NULL);
+    RTAvlU64Destroy(&pThis->TreeRegions, vbtaNodeFree, NULL);
+}
+
+
+/**
+ * Parses the report selection.
+ *
+ * @returns Report flags, 0 on error.
+ * @param   pszReports          Comma separated list of reports.
+ */
+static uint32_t vbtaParseReports(const char *pszReports)
+{
+    static const struct { const char *pszName; uint32_t fReport; } s_aReports[] =
+    {
+        { "summary",    VBTA_REPORT_F_SUMMARY   },
+        { "histogram",  VBTA_REPORT_F_HISTOGRAM },
+        { "hot",        VBTA_REPORT_F_HOT       },
+        { "timeline",   VBTA_REPORT_F_TIMELINE  },
+        { "all",        VBTA_REPORT_F_ALL       },
+    };
+
+    uint32_t fReports = 0;
+    while (*pszReports)
+    {
+        const char *pszEnd = strchr(pszReports, ',');
+        size_t const cch = pszEnd ? (size_t)(pszEnd - pszReports) : strlen(pszReports);
+        unsigned i;
+        for (i = 0; i < RT_ELEMENTS(s_aReports); i++)
+            if (   strlen(s_aReports[i].pszName) == cch
+                && !strncmp(s_aReports[i].pszName, pszReports, cch))
+                break;
+        if (i == RT_ELEMENTS(s_aReports))
+            return 0;
+        fReports |= s_aReports[i].fReport;
+        pszReports += cch + (pszEnd ? 1 : 0);
+    }
+    return fReports;
+}
+
+
+int main(int argc, char **argv)
+{
+    int rc = RTR3InitExe(argc, &argv, 0);
+    if (RT_FAILURE(rc))
+        return RTMsgInitFailure(rc);
+
+    /*
+     * Parse arguments.
+     */
+    static const RTGETOPTDEF s_aOptions[] =
+    {
+        { "--input",                'i', RTGETOPT_REQ_STRING },
+        { "--output",               'o', RTGETOPT_REQ_STRING },
+        { "--format",               'f', RTGETOPT_REQ_STRING },
+        { "--report",               'r', RTGETOPT_REQ_STRING },
+        { "--from-ns",              'F', RTGETOPT_REQ_UINT64 },
+        { "--to-ns",                'T', RTGETOPT_REQ_UINT64 },
+        { "--top",                  't', RTGETOPT_REQ_UINT32 },
+        { "--timeline-bucket-us",   'b', RTGETOPT_REQ_UINT64 },
+        { "--help",                 'h', RTGETOPT_REQ_NOTHING },
+        { "--version",              'V', RTGETOPT_REQ_NOTHING },
+    };
+
+    const char *pszInput  = NULL;
+    const char *pszOutput = NULL;
+    VBTAFORMAT  enmFormat = VBTAFORMAT_TEXT;
+    uint32_t    fReports  = VBTA_REPORT_F_SUMMARY | VBTA_REPORT_F_HOT;
+    uint32_t    cTop      = 32;
+
+    VBTASTATE State;
+    RT_ZERO(State);
+    RTListInit(&State.LstDevs);
+    State.cNsTo             = UINT64_MAX;
+    State.cNsTimelineBucket = RT_NS_1MS;
+
+    RTGETOPTUNION   ValueUnion;
+    RTGETOPTSTATE   GetState;
+    RTGetOptInit(&GetState, argc, argv, s_aOptions, RT_ELEMENTS(s_aOptions), 1, RTGETOPTINIT_FLAGS_OPTS_FIRST);
+    while ((rc = RTGetOpt(&GetState, &ValueUnion)))
+    {
+        switch (rc)
+        {
+            case 'h':
+                RTPrintf("Usage: %s [options] --input <trace log>\n"
+                         "\n"
+                         "Analyzes device I/O trace logs written by the DBGF tracer (/DBGF/TracerFilePath).\n"
+                         "\n"
+                         "Options:\n"
+                         "  -i,--input=<file>\n"
+                         "      The trace log to analyze\n"
+                         "  -o,--output=<file>\n"
+                         "      Where to write the report to, default is stdout\n"
+                         "  -f,--format=<text|json|csv>\n"
+                         "      The report format, default is text\n"
+                         "  -r,--report=<summary,histogram,hot,timeline,all>\n"
+                         "      Comma separated list of reports to generate, default is summary,hot\n"
+                         "  -F,--from-ns=<ns>, -T,--to-ns=<ns>\n"
+                         "      Only analyze the I/O events in the given window (relative to the first event)\n"
+                         "  -t,--top=<count>\n"
+                         "      Number of entries in the hot register table, default is 32\n"
+                         "  -b,--timeline-bucket-us=<us>\n"
+                         "      Timeline bucket width in microseconds, default is 1000\n"
+                         "  -h, -?, --help\n"
+                         "      Display this help text and exit successfully.\n"
+                         "  -V, --version\n"
+                         "      Display the revision and exit successfully.\n"
+                         , RTPathFilename(argv[0]));
+                return RTEXITCODE_SUCCESS;
+            case 'V':
+                RTPrintf("$Revision$\n");
+                return RTEXITCODE_SUCCESS;
+
+            case 'i':
+                pszInput = ValueUnion.psz;
+                break;
+            case 'o':
+                pszOutput = ValueUnion.psz;
+                break;
+            case 'f':
+                if (!strcmp(ValueUnion.psz, "text"))
+                    enmFormat = VBTAFORMAT_TEXT;
+                else if (!strcmp(ValueUnion.psz, "json"))
+                    enmFormat = VBTAFORMAT_JSON;
+                else if (!strcmp(ValueUnion.psz, "csv"))
+                    enmFormat = VBTAFORMAT_CSV;
+                else
+                    return RTMsgErrorExit(RTEXITCODE_SYNTAX, "Unknown format '%s'", ValueUnion.psz);
+                break;
+            case 'r':
+                fReports = vbtaParseReports(ValueUnion.psz);
+                if (!fReports)
+                    return RTMsgErrorExit(RTEXITCODE_SYNTAX, "Invalid report selection '%s'", ValueUnion.psz);
+                break;
+            case 'F':
+                State.cNsFrom = ValueUnion.u64;
+                break;
+            case 'T':
+                State.cNsTo = ValueUnion.u64;
+                break;
+            case 't':
+                cTop = ValueUnion.u32;
+                break;
+            case 'b':
+                if (!ValueUnion.u64 || ValueUnion.u64 > UINT64_MAX / RT_NS_1US)
+                    return RTMsgErrorExit(RTEXITCODE_SYNTAX, "Invalid timeline bucket width %RU64", ValueUnion.u64);
+                State.cNsTimelineBucket = ValueUnion.u64 * RT_NS_1US;
+                break;
+            default:
+                return RTGetOptPrintError(rc, &ValueUnion);
+        }
+    }
+
+    if (!pszInput)
+        return RTMsgErrorExit(RTEXITCODE_SYNTAX, "An input path must be given");
+    if (State.cNsFrom > State.cNsTo)
+        return RTMsgErrorExit(RTEXITCODE_SYNTAX, "The analysis window is empty");
+
+    /*
+     * Gather the statistics.
+     */
+    RTEXITCODE rcExit = RTEXITCODE_SUCCESS;
+    rc = vbtaProcessLog(&State, pszInput);
+    if (RT_SUCCESS(rc))
+    {
+        PRTSTREAM pStrm = g_pStdOut;
+        if (pszOutput)
+            rc = RTStrmOpen(pszOutput, "w", &pStrm);
+        if (RT_SUCCESS(rc))
+        {
+            /*
+             * Write the reports.
+             */
+            if (enmFormat == VBTAFORMAT_JSON)
+                RTStrmPrintf(pStrm, "{\n  \"events\": %RU64,\n  \"duration_ns\": %RU64,\n  \"orphaned_events\": %RU64",
+                             State.cEvtsTotal, State.tsLast - State.tsStart, State.cEvtsOrphaned);
+
+            static const uint32_t s_afOrder[] =
+            { VBTA_REPORT_F_SUMMARY, VBTA_REPORT_F_HISTOGRAM, VBTA_REPORT_F_HOT, VBTA_REPORT_F_TIMELINE };
+            for (unsigned i = 0; i < RT_ELEMENTS(s_afOrder) && RT_SUCCESS(rc); i++)
+            {
+                if (!(fReports & s_afOrder[i]))
+                    continue;
+                if (enmFormat == VBTAFORMAT_JSON)
+                    RTStrmPrintf(pStrm, ",\n");
+                switch (s_afOrder[i])
+                {
+                    case VBTA_REPORT_F_SUMMARY:   vbtaReportSummary(&State, pStrm, enmFormat); break;
+                    case VBTA_REPORT_F_HISTOGRAM: vbtaReportHistogram(&State, pStrm, enmFormat); break;
+                    case VBTA_REPORT_F_HOT:       rc = vbtaReportHot(&State, pStrm, enmFormat, cTop); break;
+                    case VBTA_REPORT_F_TIMELINE:  vbtaReportTimeline(&State, pStrm, enmFormat); break;
+                }
+            }
+
+            if (enmFormat == VBTAFORMAT_JSON)
+                RTStrmPrintf(pStrm, "\n}\n");
+
+            if (RT_FAILURE(rc))
+                rcExit = RTMsgErrorExit(RTEXITCODE_FAILURE, "Writing the report failed with %Rrc", rc);
+            if (pszOutput)
+                RTStrmClose(pStrm);
+        }
+        else
+            rcExit = RTMsgErrorExit(RTEXITCODE_FAILURE, "Failed to create '%s': %Rrc", pszOutput, rc);
+    }
+    else
+        rcExit = RTEXITCODE_FAILURE;
+
+    vbtaStateDestroy(&State);
+    return rcExit;
+}
+
@@ -0,0 +1,202 @@
+; $Id: bs3-iem-bench-1-asm.asm $
+;; @file
+; BS3Kit - bs3-iem-bench-1, assembly loops.
+;
+
+;
+; Copyright (C) 2024 Oracle and/or its affiliates.
+;
+; This file is part of VirtualBox base platform packages, as
+; available from https://www.virtualbox.org.
+;
+; This program is free software; you can redistribute it and/or
+; modify it under the terms of the GNU General Public License
+; as published by the Free Software Foundation, in version 3 of the
+; License.
+;
+; This program is distributed in the hope that it will be useful, but
+; WITHOUT ANY WARRANTY; without even the implied warranty of
+; MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+; General Public License for more details.
+;
+; You should have received a copy of the GNU General Public License
+; along with this program; if not, see <https://www.gnu.org/licenses>.
+;
+; The contents of this file may alternatively be used under the terms
+; of the Common Development and Distribution License Version 1.0
+; (CDDL), a copy of it is provided in the "COPYING.CDDL" file included
+; in the VirtualBox distribution, in which case the provisions of the
+; CDDL are applicable instead of those of the GPL.
+;
+; You may elect to license modified versions of this file under the
+; terms and conditions of either the GPL or the CDDL or both.
+;
+; SPDX-License-Identifier: GPL-3.0-only OR CDDL-1.0
+;
+
+
+
+;*********************************************************************************************************************************
+;*  Header Files                                                                                                                 *
+;*********************************************************************************************************************************
+%include "bs3kit.mac"
+
+
+BS3_BEGIN_TEXT64
+        BS3_SET_BITS 64
+
+;
+; All the workers take the iteration count in rcx, a buffer address in rdx and
+; the buffer size in r8 (power of two, at least 4KB).  The return value is
+; some kind of result to keep the loops honest.
+;
+; The number of instructions in each loop iteration must match the
+; cInstrsPerIteration values in bs3-iem-bench-1.c64.
+;
+
+
+;;
+; Integer ALU loop, 12 instructions per iteration.
+;
+BS3_PROC_BEGIN NAME(bs3IemBench1_Integer)
+        mov     eax, 1
+        mov     edx, 2
+        mov     r8d, 3
+        mov     r9d, 4
+        mov     r10d, 5
+.loop:
+        add     rax, rdx
+        xor     rdx, r8
+        sub     r8, r9
+        imul    r9, r10
+        lea     r10, [r10 + rax * 2 + 7]
+        shl     r9, 3
+        or      rdx, r10
+        shr     rax, 1
+        and     r8, rax
+        inc     r10
+        dec     rcx
+        jnz     .loop
+        add     rax, r9
+        ret
+BS3_PROC_END   NAME(bs3IemBench1_Integer)
+
+
+;;
+; Memory load/store loop, 10 instructions per iteration.
+;
+BS3_PROC_BEGIN NAME(bs3IemBench1_Memory)
+        dec     r8                      ; offset mask
+        xor     eax, eax
+        xor     r9d, r9d
+.loop:
+        mov     r10, [rdx + r9]
+        add     rax, r10
+        mov     r11, [rdx + r9 + 8]
+        xor     rax, r11
+        mov     [rdx + r9 + 16], rax
+        add     [rdx + r9 + 24], r10
+        add     r9, 32
+        and     r9, r8
+        dec     rcx
+        jnz     .loop
+        ret
+BS3_PROC_END   NAME(bs3IemBench1_Memory)
+
+
+;;
+; Unpredictable branches driven by an LCG, 12 instructions per iteration
+; regardless of the path taken.
+;
+BS3_PROC_BEGIN NAME(bs3IemBench1_Branchy)
+        mov     rax, 0x0123456789abcdef
+        mov     r10, 6364136223846793005
+        mov     r11, 1442695040888963407
+        xor     r9d, r9d
+.loop:
+        imul    rax, r10
+        add     rax, r11
+        bt      rax, 33
+        jc      .odd
+        add     r9, rax
+        jmp     .next
+.odd:
+        sub     r9, rax
+        nop
+.next:
+        bt      rax, 47
+        jnc     .even2
+        rol     r9, 1
+        jmp     .next2
+.even2:
+        ror     r9, 3
+        nop
+.next2:
+        dec     rcx
+        jnz     .loop
+        mov     rax, r9
+        ret
+BS3_PROC_END   NAME(bs3IemBench1_Branchy)
+
+
+;;
+; SSE/SSE2 arithmetic loop, 10 instructions per iteration.
+;
+; Only uses xmm0 thru xmm5 as the others are callee saved.  Requires
+; CR4.OSFXSR to be set.
+;
+BS3_PROC_BEGIN NAME(bs3IemBench1_Sse)
+        mov     eax, 1
+        cvtsi2sd xmm0, rax
+        movlhps xmm0, xmm0              ; xmm0 = 1.0, 1.0
+        movapd  xmm1, xmm0
+        movapd  xmm2, xmm0
+        movapd  xmm3, xmm0
+        xorps   xmm4, xmm4
+        movdqa  xmm5, xmm0
+.loop:
+        addpd   xmm1, xmm0
+        mulpd   xmm2, xmm0
+        subpd   xmm3, xmm0
+        maxpd   xmm3, xmm2
+        minpd   xmm2, xmm1
+        paddq   xmm4, xmm5
+        pxor    xmm5, xmm4
+        addsd   xmm1, xmm0
+        dec     rcx
+        jnz     .loop
+        cvttsd2si rax, xmm1
+        ret
+BS3_PROC_END   NAME(bs3IemBench1_Sse)
+
+
+;;
+; String instruction loop, 10 instructions per iteration.  Each iteration
+; fills the first half of the buffer with REP STOSQ and then copies it to
+; the second half with REP MOVSQ.
+;
+BS3_PROC_BEGIN NAME(bs3IemBench1_String)
+        push    rsi
+        push    rdi
+        mov     r9, rcx
+        shr     r8, 1                   ; half the buffer
+        mov     r10, r8
+        shr     r10, 3                  ; qwords per half
+        cld
+.loop:
+        mov     rdi, rdx
+        mov     rcx, r10
+        mov     rax, r9
+        rep stosq
+        mov     rsi, rdx
+        lea     rdi, [rdx + r8]
+        mov     rcx, r10
+        rep movsq
+        dec     r9
+        jnz     .loop
+        mov     rax, [rdx + r8]
+        pop     rdi
+        pop     rsi
+        ret
+BS3_PROC_END   NAME(bs3IemBench1_String)
+
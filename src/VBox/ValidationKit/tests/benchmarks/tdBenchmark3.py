@@ -0,0 +1,258 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+# $Id: tdBenchmark3.py $
+
+"""
+VirtualBox Validation Kit - IEM emulation throughput benchmarks.
+
+Runs the bs3-iem-bench-1 synthetic workloads and a selection of the bs3
+instruction testcases on the IEM interpreter, the threaded recompiler and
+the native recompiler, reporting wall time and the relevant IEM statistics
+(instruction count, TLB hit rates, TB compile time, executable memory use)
+as test values.
+"""
+
+__copyright__ = \
+"""
+Copyright (C) 2024 Oracle and/or its affiliates.
+
+This file is part of VirtualBox base platform packages, as
+available from https://www.virtualbox.org.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, in version 3 of the
+License.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <https://www.gnu.org/licenses>.
+
+The contents of this file may alternatively be used under the terms
+of the Common Development and Distribution License Version 1.0
+(CDDL), a copy of it is provided in the "COPYING.CDDL" file included
+in the VirtualBox distribution, in which case the provisions of the
+CDDL are applicable instead of those of the GPL.
+
+You may elect to license modified versions of this file under the
+terms and conditions of either the GPL or the CDDL or both.
+
+SPDX-License-Identifier: GPL-3.0-only OR CDDL-1.0
+"""
+__version__ = "$Revision: 159771 $"
+
+
+# Standard Python imports.
+import os;
+import re;
+import sys;
+
+# Only the main script needs to modify the path.
+try:    __file__                            # pylint: disable=used-before-assignment
+except: __file__ = sys.argv[0];
+g_ksValidationKitDir = os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__))));
+sys.path.append(g_ksValidationKitDir);
+
+# Validation Kit imports.
+from common     import constants;
+from common     import utils;
+from testdriver import reporter;
+from testdriver import vbox;
+from testdriver import vboxtestvms;
+
+
+## The IEM flavours we benchmark, mapped to the virtualization mode used and the
+## value of IEM/NativeRecompileAtUsedCount (None = default).
+g_kdIemFlavours = {
+    'interpreter': ( 'interpreter', None, ),
+    'threaded':    ( 'recompiler',  '0', ),            # Zero disables native recompilation.
+    'native':      ( 'recompiler',  None, ),
+};
+
+
+class IemBenchTestVm(vboxtestvms.BootSectorTestVm):
+    """
+    A Boot Sector Test VM which is configured to run one specific IEM flavour.
+    """
+
+    def __init__(self, oSet, oTestDriver, sImage, sFlavour, f64BitRequired = True):
+        sVirtMode, self.sNativeRecompileAtUsedCount = g_kdIemFlavours[sFlavour];
+        vboxtestvms.BootSectorTestVm.__init__(self,
+                                              oSet,
+                                              'tst-%s-%s' % (sImage, sFlavour,),
+                                              os.path.join(oTestDriver.sVBoxBootSectors, sImage + '.img'),
+                                              [ sVirtMode, ],
+                                              f64BitRequired);
+        self.sImage   = sImage;
+        self.sFlavour = sFlavour;
+
+    def _childVmReconfig(self, oTestDrv, oVM, oSession):
+        _ = oTestDrv;
+        _ = oVM;
+        if self.sNativeRecompileAtUsedCount is not None:
+            return oSession.setExtraData('VBoxInternal/IEM/NativeRecompileAtUsedCount', self.sNativeRecompileAtUsedCount);
+        return True;
+
+
+class tdBenchmark3(vbox.TestDriver):
+    """
+    IEM emulation throughput benchmarks.
+    """
+
+    ## The images to run, with the 64-bit requirement flag.
+    kaoImages = [
+        ( 'bs3-iem-bench-1',        True, ),
+        ( 'bs3-cpu-basic-2',        False, ),
+        ( 'bs3-cpu-generated-1',    False, ),
+        ( 'bs3-cpu-instr-2',        True, ),
+    ];
+
+    ## Statistics pulled out of the release log of each run, see _reportStats.
+    ## Matches counter lines ("name value unit") and profile lines
+    ## ("name avg unit (total unit, periods unit, max n, min n)").
+    kRegExStat = re.compile(r'(/IEM/CPU0/[^ \t]+)[ \t]+([0-9]+) [^ \t(]+(?:[ \t]+\([ \t]*([0-9]+) [^,]+,[ \t]*([0-9]+) )?');
+
+    def __init__(self):
+        vbox.TestDriver.__init__(self);
+        for sImage, f64BitRequired in self.kaoImages:
+            for sFlavour in g_kdIemFlavours:
+                self.oTestVmSet.aoTestVms.append(IemBenchTestVm(self.oTestVmSet, self, sImage, sFlavour, f64BitRequired));
+
+
+    #
+    # Overridden methods.
+    #
+
+
+    def actionConfig(self):
+        self._detectValidationKit();
+        return self.oTestVmSet.actionConfig(self);
+
+    def actionExecute(self):
+        return self.oTestVmSet.actionExecute(self, self.testOneCfg);
+
+
+
+    #
+    # Test execution helpers.
+    #
+
+    def _parseStats(self, sLogFile):
+        """
+        Parses the statistics dump at the end of the VM release log.
+
+        Returns a dictionary mapping the statistics name to a (value, total, periods)
+        tuple, where the last two are None for anything but profiles.
+        """
+        dStats = {};
+        try:
+            with open(sLogFile, 'r') as oFile: # pylint: disable=unspecified-encoding
+                fInStats = False;
+                for sLine in oFile:
+                    if not fInStats:
+                        fInStats = sLine.find('**** Statistics ****') >= 0;
+                    elif sLine.find('End of statistics') >= 0:
+                        break;
+                    else:
+                        oMatch = self.kRegExStat.search(sLine);
+                        if oMatch is not None:
+                            dStats[oMatch.group(1)] = ( int(oMatch.group(2)),
+                                                        int(oMatch.group(3)) if oMatch.group(3) is not None else None,
+                                                        int(oMatch.group(4)) if oMatch.group(4) is not None else None, );
+        except:
+            reporter.errorXcpt('sLogFile=%s' % (sLogFile,));
+        return dStats;
+
+    def _reportStats(self, oTestVm, dStats, cMsElapsed):
+        """
+        Reports the wall time and interesting IEM statistics as test values.
+        """
+        reporter.testValue('Wall time', cMsElapsed, constants.valueunit.g_asNames[constants.valueunit.MS]);
+
+        def getValue(sName):
+            tValue = dStats.get('/IEM/CPU0/' + sName);
+            return tValue[0] if tValue is not None else None;
+
+        cInstructions = getValue('cInstructions');
+        if cInstructions is not None:
+            reporter.testValue('Guest instructions', cInstructions, constants.valueunit.g_asNames[constants.valueunit.INSTRS]);
+            if cMsElapsed > 0:
+                reporter.testValue('Guest instruction rate', cInstructions * 1000 // cMsElapsed,
+                                   constants.valueunit.g_asNames[constants.valueunit.INSTRS_PER_SEC]);
+
+        for sTlb in ('Code', 'Data',):
+            cHits   = getValue('Tlb/%s/Hits' % (sTlb,));
+            cMisses = getValue('Tlb/%s/Misses' % (sTlb,));
+            if cHits is not None and cMisses is not None and cHits + cMisses > 0:
+                reporter.testValue('%s TLB hit rate' % (sTlb,), cHits * 1000000 // (cHits + cMisses),
+                                   constants.valueunit.g_asNames[constants.valueunit.PPM]);
+
+        if oTestVm.sFlavour != 'interpreter':
+            for sName, sDesc in (('re/cTbAllocatedThreaded', 'Threaded TBs'), ('re/cTbAllocatedNative', 'Native TBs'),):
+                cValue = getValue(sName);
+                if cValue is not None:
+                    reporter.testValue(sDesc, cValue, constants.valueunit.g_asNames[constants.valueunit.OCCURRENCES]);
+
+            tCompile = dStats.get('/IEM/CPU0/re/NativeRecompilation');
+            if tCompile is not None and tCompile[1] is not None:
+                reporter.testValue('TB compile time',  tCompile[1], constants.valueunit.g_asNames[constants.valueunit.TICKS]);
+                reporter.testValue('TB compile calls', tCompile[2], constants.valueunit.g_asNames[constants.valueunit.CALLS]);
+                reporter.testValue('TB compile avg',   tCompile[0], constants.valueunit.g_asNames[constants.valueunit.TICKS_PER_CALL]);
+
+            for sName, sDesc in (('re/ExecMem/cbAllocated', 'Exec memory allocated'), ('re/ExecMem/cbTotal', 'Exec memory total'),):
+                cbValue = getValue(sName);
+                if cbValue is not None:
+                    reporter.testValue(sDesc, cbValue, constants.valueunit.g_asNames[constants.valueunit.BYTES]);
+        return True;
+
+    def testOneCfg(self, oVM, oTestVm):
+        """
+        Runs the specified VM thru the benchmark and reports the results.
+
+        Returns a success indicator on the general test execution. This is not
+        the actual test result.
+        """
+        fRc = False;
+
+        sXmlFile = self.prepareResultFile();
+        asEnv = [ 'IPRT_TEST_FILE=' + sXmlFile];
+
+        self.logVmInfo(oVM);
+        msStart  = utils.timestampMilli();
+        oSession = self.startVm(oVM, sName = oTestVm.sVmName, asEnv = asEnv);
+        if oSession is not None:
+            cMsTimeout = 30 * 60000;
+            if not reporter.isLocal(): ## @todo need to figure a better way of handling timeouts on the testboxes ...
+                cMsTimeout = self.adjustTimeoutMs(180 * 60000);
+
+            oRc = self.waitForTasks(cMsTimeout);
+            cMsElapsed = utils.timestampMilli() - msStart;
+            if oRc == oSession:
+                fRc = oSession.assertPoweredOff();
+            else:
+                reporter.error('oRc=%s, expected %s' % (oRc, oSession));
+
+            reporter.addSubXmlFile(sXmlFile);
+
+            # The statistics are dumped to the release log when the VM is destroyed,
+            # so grab the log file name now and parse it after terminating the session.
+            sLogFile = None;
+            try:
+                sLogFile = oVM.queryLogFilename(0);
+            except:
+                reporter.logXcpt();
+            self.terminateVmBySession(oSession);
+
+            if fRc and sLogFile:
+                fRc = self._reportStats(oTestVm, self._parseStats(sLogFile), cMsElapsed);
+        return fRc;
+
+
+
+if __name__ == '__main__':
+    sys.exit(tdBenchmark3().main(sys.argv));
+
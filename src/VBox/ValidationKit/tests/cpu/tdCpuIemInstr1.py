@@ -61,13 +61,16 @@ class IemTestVm(vboxtestvms.BootSectorTestVm):
     A Boot Sector Test VM which is configured to run in IEM mode only.
     """
 
-    def __init__(self, oSet, oTestDriver, sVmName, asVirtModesSup = None, f64BitRequired = True):
+    def __init__(self, oSet, oTestDriver, sVmName, asVirtModesSup = None, f64BitRequired = True, cRecompilerThreads = 0,
+                 cMaxTbs = 0):
         vboxtestvms.BootSectorTestVm.__init__(self,
                                               oSet,
-                                              'tst-' + sVmName,
+                                              'tst-' + sVmName + ('-maxtbs-%u' % (cMaxTbs,) if cMaxTbs > 0 else ''),
                                               os.path.join(oTestDriver.sVBoxBootSectors, sVmName + '.img'),
                                               asVirtModesSup,
                                               f64BitRequired);
+        self.cRecompilerThreads = cRecompilerThreads;
+        self.cMaxTbs            = cMaxTbs;
 
     def _childVmReconfig(self, oTestDrv, oVM, oSession):
         _ = oTestDrv;
@@ -76,6 +79,10 @@ class IemTestVm(vboxtestvms.BootSectorTestVm):
         # Make sure the testcase runs in a sensible timeframe but we still excercise the recompiler.
         fRc =         oSession.setExtraData('VBoxInternal/Devices/VMMDev/0/Config/TestingThresholdNativeRecompiler', '2');
         fRc = fRc and oSession.setExtraData('VBoxInternal/IEM/NativeRecompileAtUsedCount', '1');
+        if self.cRecompilerThreads > 0:
+            fRc = fRc and oSession.setExtraData('VBoxInternal/IEM/NativeRecompileThreads', str(self.cRecompilerThreads));
+        if self.cMaxTbs > 0:
+            fRc = fRc and oSession.setExtraData('VBoxInternal/IEM/MaxTbCount', str(self.cMaxTbs));
 
         return fRc;
 
@@ -100,6 +107,10 @@ class tdCpuIemInstr1(vbox.TestDriver):
             IemTestVm(self.oTestVmSet, self, 'bs3-cpu-state64-1'),
             IemTestVm(self.oTestVmSet, self, 'bs3-cpu-weird-1'),
             IemTestVm(self.oTestVmSet, self, 'bs3-fpustate-1'),
+            IemTestVm(self.oTestVmSet, self, 'bs3-iem-tb-1', cRecompilerThreads = 2),
+            # Minimum TB count so the bs3-iem-tb-1 eviction sub-test keeps the allocator full.
+            IemTestVm(self.oTestVmSet, self, 'bs3-iem-tb-1', cMaxTbs = 16384),
+            IemTestVm(self.oTestVmSet, self, 'bs3-iem-strinstr-1'),
         ]);
 
 